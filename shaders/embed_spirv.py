@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Writes a C source embedding compiled SPIR-V modules, looked up by file name.
+
+Usage: embed_spirv.py OUTPUT.c INPUT.spv...
+"""
+
+import os
+import struct
+import sys
+
+
+def main():
+    output, inputs = sys.argv[1], sys.argv[2:]
+    lines = [
+        '// Generated by shaders/embed_spirv.py. Do not edit.',
+        '#include "renderer/embedded_shaders.h"',
+        '',
+    ]
+    entries = []
+    for index, path in enumerate(inputs):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if len(data) % 4 != 0:
+            sys.exit(f'{path}: SPIR-V size {len(data)} is not a multiple of 4')
+        # SPIR-V is a stream of little-endian words; emitting them as numbers keeps the
+        # array correct on big-endian hosts too.
+        words = struct.unpack(f'<{len(data) // 4}I', data)
+        lines.append(f'static const uint32_t shader_{index}[] = {{')
+        for start in range(0, len(words), 8):
+            chunk = words[start:start + 8]
+            lines.append('    ' + ', '.join(f'0x{w:08x}u' for w in chunk) + ',')
+        lines.append('};')
+        lines.append('')
+        entries.append(f'    {{"{os.path.basename(path)}", shader_{index}, sizeof(shader_{index})}},')
+
+    lines.append('const EmbeddedShader dcat_embedded_shaders[] = {')
+    lines.extend(entries)
+    lines.append('};')
+    lines.append('const size_t dcat_embedded_shader_count =')
+    lines.append('    sizeof(dcat_embedded_shaders) / sizeof(dcat_embedded_shaders[0]);')
+
+    with open(output, 'w', newline='\n') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -7,20 +7,54 @@
 
 #include "core/app.h"
 #include "core/args.h"
+#include "core/background_task.h"
+#include "core/change_tracker.h"
+#include "core/frame_pacer.h"
+#include "core/frame_profiler.h"
+#include "core/frame_server.h"
+#include "core/frame_writer.h"
+#include "core/hot_reload.h"
+#include "core/render_scale.h"
+#include "core/replay.h"
+#include "core/scene_loader.h"
 #include "core/signals.h"
 #include "core/threading.h"
 #include "core/time_utils.h"
 #include "graphics/camera.h"
+#include "graphics/mesh_edit.h"
 #include "graphics/model.h"
+#include "graphics/skydome.h"
 #include "graphics/texture_loader.h"
 #include "input/input_handler.h"
 #include "renderer/vulkan_renderer.h"
+#include "terminal/block_encoder.h"
 #include "terminal/chafa_driver.h"
 #include "terminal/driver_factory.h"
+#include "terminal/iterm2_encoder.h"
+#include "terminal/kitty_direct.h"
 #include "terminal/output_driver.h"
+#include "terminal/output_pipeline.h"
 #include "terminal/session.h"
+#include "terminal/sixel_encoder.h"
 #include "terminal/terminal.h"
 
+// Upper bound on an idle sleep. The input thread wakes the loop for input, SIGWINCH and
+// SIGINT, so this only bounds how long a missed wakeup goes unnoticed.
+#define IDLE_WAIT_TIMEOUT_MS 1000U
+// Headless RGBA/PNG frame size when -W/-H are not given
+#define HEADLESS_DEFAULT_SIZE 512U
+// Poses per second --gpu-animation bakes at without --animation-rate
+#define DEFAULT_BAKE_RATE 30.0F
+// Longest model path read from a --batch list on stdin
+#define BATCH_PATH_MAX 4096U
+// --latency auto: how long after the last input frames stay low latency
+#define LOW_LATENCY_HOLD_SECONDS 0.5
+
+_Static_assert(STATUS_GPU_STAGE_COUNT == VULKAN_GPU_STAGE_COUNT,
+               "the status bar shows every GPU stage");
+_Static_assert(FRAME_STAGE_GPU_READBACK - FRAME_STAGE_GPU_SKYDOME + 1 == VULKAN_GPU_STAGE_COUNT,
+               "the profiler records every GPU stage");
+
 typedef struct FatalReport {
     bool active;
     char message[512];
@@ -46,6 +80,7 @@ typedef struct RenderContext {
     uint32_t material_count;
     bool enable_lighting;
     bool use_triplanar_mapping;
+    FrameServer *frame_server; // --serve: where each finished frame also goes
 } RenderContext;
 
 typedef struct AnimationContext {
@@ -53,6 +88,15 @@ typedef struct AnimationContext {
     bool has_animations;
 } AnimationContext;
 
+// How much of the input thread's totals and command counters the render loop has applied
+typedef struct AppliedInput {
+    InputCommands commands;
+    unsigned int wireframe_toggles;
+    unsigned int next_animations;
+    unsigned int previous_animations;
+    unsigned int play_toggles;
+} AppliedInput;
+
 static float compute_model_scale_factor(const CameraSetup *camera_setup, float model_scale_arg) {
     if (camera_setup->model_scale <= 0.0F) {
         return 1.0F;
@@ -91,58 +135,49 @@ static float calculate_frame_fps(const float delta_time) {
     return delta_time > 0.0F ? 1.0F / delta_time : 0.0F;
 }
 
-static void pace_frame(const double frame_start_time, const double target_frame_time) {
-    if (target_frame_time <= 0.0) {
-        return;
+static bool apply_render_size(VulkanRenderer *renderer, OutputPipeline *output_pipeline,
+                              Camera *camera, const uint32_t new_width, const uint32_t new_height,
+                              uint32_t *width, uint32_t *height, mat4 view, mat4 projection) {
+    if (new_width == *width && new_height == *height) {
+        return true;
     }
 
-    const double frame_deadline = frame_start_time + target_frame_time;
-    for (;;) {
-        const double remaining = frame_deadline - get_time_seconds();
-        if (remaining <= 0.0) {
-            return;
-        }
-
-        if (remaining > 0.003) {
-            const unsigned int sleep_ms = (unsigned int)((remaining - 0.001) * 1000.0);
-            if (sleep_ms > 0) {
-                dcat_sleep_ms(sleep_ms);
-                continue;
-            }
-        }
+    // Queued frames may point into readback memory that the resize remaps.
+    if (vulkan_renderer_host_readback_active(renderer)) {
+        output_pipeline_flush(output_pipeline);
+    }
 
-        dcat_sleep_ms(0);
+    *width = new_width;
+    *height = new_height;
+    if (!vulkan_renderer_resize(renderer, *width, *height)) {
+        return false;
     }
+
+    camera_init(camera, *width, *height, camera->position, camera->target, CAMERA_FOV_DEGREES);
+    refresh_camera_matrices(camera, view, projection);
+    return true;
 }
 
 static bool resize_renderer_if_needed(const Args *args, const OutputDriver *output_driver,
-                                      VulkanRenderer *renderer, DcatMutex *shared_state_mutex,
-                                      Camera *camera, uint32_t *width, uint32_t *height, mat4 view,
+                                      OutputPipeline *output_pipeline, VulkanRenderer *renderer,
+                                      Camera *camera, const float render_scale,
+                                      uint32_t *display_width, uint32_t *display_height,
+                                      uint32_t *width, uint32_t *height, mat4 view,
                                       mat4 projection) {
     if (!signals_is_resize_pending()) {
         return true;
     }
 
     signals_clear_resize_pending();
+    // The terminal may reflow or clear on resize, so the last written cells are unknown.
+    output_pipeline_request_full_redraw(output_pipeline);
 
+    calculate_output_dimensions(args, output_driver, display_width, display_height);
     uint32_t new_width = 0;
     uint32_t new_height = 0;
-    calculate_output_dimensions(args, output_driver, &new_width, &new_height);
-    if (new_width == *width && new_height == *height) {
-        return true;
-    }
-
-    *width = new_width;
-    *height = new_height;
-    if (!vulkan_renderer_resize(renderer, *width, *height)) {
-        return false;
-    }
-
-    dcat_mutex_lock(shared_state_mutex);
-    camera_init(camera, *width, *height, camera->position, camera->target, 60.0F);
-    refresh_camera_matrices(camera, view, projection);
-    dcat_mutex_unlock(shared_state_mutex);
-    return true;
+    render_scale_apply(render_scale, *display_width, *display_height, &new_width, &new_height);
+    return apply_render_size(renderer, output_pipeline, camera, new_width, new_height, width,
+                             height, view, projection);
 }
 
 static const char *get_animation_name(const AnimationContext *anim_ctx, const Mesh *mesh,
@@ -258,44 +293,69 @@ static void process_input_devices(const KeyState *key_state, Camera *camera, con
     }
 }
 
-static bool render_frame(RenderContext *ctx, const AnimationContext *anim_ctx, const Mesh *mesh,
-                         mat4 *view, mat4 *projection, const OutputDriver *output_driver,
-                         bool show_status_bar, bool use_hash_characters, uint32_t width,
-                         uint32_t height, float fps, float move_speed, const vec3 camera_position,
-                         int current_animation_index) {
+// Renders one frame; *out_framebuffer is the finished frame the renderer's latency mode
+// returns, if any.
+static bool render_scene(RenderContext *ctx, const AnimationContext *anim_ctx, const Mesh *mesh,
+                         mat4 *view, mat4 *projection, const vec3 camera_position,
+                         const uint8_t **out_framebuffer) {
     mat4 mvp;
     glm_mat4_mul(*projection, *view, mvp);
     glm_mat4_mul(mvp, ctx->model_matrix, mvp);
 
-    const uint8_t *framebuffer = NULL;
     const mat4 *bone_matrix_ptr = NULL;
     uint32_t bone_count = 0;
 
-    if (anim_ctx->has_animations) {
+    // Baked poses are posed by the vertex shader (vulkan_renderer_set_baked_pose)
+    if (anim_ctx->has_animations && !mesh->baked_poses.rows) {
         bone_matrix_ptr = (const mat4 *)anim_ctx->bone_matrices;
         bone_count = (uint32_t)mesh->skeleton.bones.count;
     }
 
-    if (!vulkan_renderer_render(ctx->renderer, mesh, &mvp, &ctx->model_matrix, ctx->materials,
-                                ctx->material_count, ctx->enable_lighting, camera_position,
-                                ctx->use_triplanar_mapping, bone_matrix_ptr, bone_count, view,
-                                projection, &framebuffer)) {
+    return vulkan_renderer_render(ctx->renderer, mesh, &mvp, &ctx->model_matrix, ctx->materials,
+                                  ctx->material_count, ctx->enable_lighting, camera_position,
+                                  ctx->use_triplanar_mapping, bone_matrix_ptr, bone_count, view,
+                                  projection, out_framebuffer);
+}
+
+static bool render_frame(RenderContext *ctx, const AnimationContext *anim_ctx, const Mesh *mesh,
+                         mat4 *view, mat4 *projection, const OutputDriver *output_driver,
+                         OutputPipeline *output_pipeline, bool show_status_bar,
+                         bool use_hash_characters, uint32_t width, uint32_t height,
+                         uint32_t display_width, uint32_t display_height, float fps,
+                         float move_speed, const vec3 camera_position,
+                         int current_animation_index) {
+    const uint8_t *framebuffer = NULL;
+    if (!render_scene(ctx, anim_ctx, mesh, view, projection, camera_position, &framebuffer)) {
+        return false;
+    }
+
+    if (framebuffer && ctx->frame_server &&
+        !frame_server_publish(ctx->frame_server, framebuffer, width, height)) {
+        vulkan_renderer_set_error(ctx->renderer, VK_ERROR_OUT_OF_HOST_MEMORY,
+                                  "frame_server_publish", "Failed to queue frame for viewers");
         return false;
     }
 
     if (framebuffer) {
         const bool use_hash = (use_hash_characters && output_driver->uses_character_cells) != 0;
-        if (output_driver->uses_character_cells) {
-            safe_write("\x1b[?2026h", 8);
+        OutputStatus status = {
+            .fps = fps,
+            .move_speed = move_speed,
+            .camera_position = {camera_position[0], camera_position[1], camera_position[2]},
+        };
+        snprintf(status.animation_name, sizeof(status.animation_name), "%s",
+                 get_animation_name(anim_ctx, mesh, current_animation_index));
+        VulkanGpuTimings gpu_timings;
+        if (show_status_bar && vulkan_renderer_get_gpu_timings(ctx->renderer, &gpu_timings)) {
+            memcpy(status.gpu_ms, gpu_timings.stage_ms, sizeof(status.gpu_ms));
+            status.has_gpu_timings = true;
         }
-        output_driver->render_frame(framebuffer, width, height, use_hash);
-
-        if (show_status_bar) {
-            draw_status_bar(fps, move_speed, camera_position,
-                            get_animation_name(anim_ctx, mesh, current_animation_index));
-        }
-        if (output_driver->uses_character_cells) {
-            safe_write("\x1b[?2026l", 8);
+        if (!output_pipeline_submit(output_pipeline, framebuffer, width, height, display_width,
+                                    display_height, use_hash, show_status_bar, &status)) {
+            vulkan_renderer_set_error(ctx->renderer, VK_ERROR_OUT_OF_HOST_MEMORY,
+                                      "output_pipeline_submit",
+                                      "Failed to queue frame for output");
+            return false;
         }
     }
 
@@ -304,9 +364,15 @@ static bool render_frame(RenderContext *ctx, const AnimationContext *anim_ctx, c
 
 typedef struct AppContext {
     Args args;
+    HeadlessFormat headless;
     const OutputDriver *output_driver;
+    // Rendered size; below the display size while the adaptive scale is reduced
     uint32_t width;
     uint32_t height;
+    uint32_t display_width;
+    uint32_t display_height;
+    RenderScaleController render_scale;
+    bool adaptive_resolution;
 
     VulkanRenderer *renderer;
     Mesh mesh;
@@ -319,19 +385,62 @@ typedef struct AppContext {
     Texture *normal_textures;
     RenderMaterial *render_materials;
 
-    Mesh skydome_mesh;
     Texture skydome_texture;
     bool has_skydome;
 
+    // Startup work that overlaps the terminal probes and the renderer's bring-up
+    // (app_init). Until joined, each task alone touches the fields it fills in.
+    BackgroundTask model_import; // mesh, has_uvs, model_materials, model_material_count
+    bool model_imported;
+    BackgroundTask skydome_load; // skydome_texture, has_skydome
+    uint32_t skydome_size;
+
     mat4 *bone_matrices;
     AnimationState anim_state;
 
-    DcatMutex shared_state_mutex;
-    bool shared_state_mutex_initialized;
+    ChangeTracker scene_changes;
 
     DcatThread input_thread;
     bool input_thread_started;
     InputThreadData input_data;
+    InputCommands input_commands; // the input thread's own
+    InputSnapshot input_snapshot;
+    AppliedInput applied_input;
+    double last_input_time; // when apply_input last found input
+
+    OutputPipeline output_pipeline;
+
+    // --serve: the render loop's frames also go out to every connected viewer
+    FrameServer frame_server;
+    bool net_initialized;
+
+    // --progressive: set while the loader still has geometry or textures to hand over
+    SceneLoader scene_loader;
+    bool loading;
+
+    // --watch on an interactive run: reloads edited files once the model is fully loaded
+    HotReload hot_reload;
+    bool watch_files;
+
+    // --low-memory on a GPU backend: the model's CPU-side geometry and pixels are freed once
+    // a frame has uploaded them. The path is where released geometry is reloaded from.
+    bool low_memory;
+    bool host_data_released;
+    const char *model_path;
+
+    // --stats-json and --replay: per-stage frame timings, and the GPU frame last added to them
+    FrameProfiler profiler;
+    bool profiling;
+    uint64_t profiled_gpu_frame;
+
+    // --replay: the script stands in for the input thread, which publishes to ignored_input
+    // instead so that q still quits
+    ReplayScript replay_script;
+    ReplayPlayer replay_player;
+    bool replaying;
+    InputSnapshot ignored_input;
+    uint32_t replayed_frames;
+    double replay_seconds;
 
     TerminalSession terminal_session;
     FatalReport fatal_report;
@@ -340,45 +449,268 @@ typedef struct AppContext {
     mat4 model_matrix;
     float move_speed;
     double target_frame_time;
-    KeyState key_state;
+    FramePacer pacer;
     bool vips_initialized;
 } AppContext;
 
-void app_cleanup(AppContext *app) {
-    signals_request_quit();
-    if (app->input_thread_started) {
-        dcat_thread_join(app->input_thread);
+// Points render material `i` at the material's current textures
+static void fill_render_material(AppContext *app, const size_t i) {
+    RenderMaterial *render_material = &app->render_materials[i];
+    const MaterialInfo *material = &app->model_materials[i];
+    render_material->diffuse = &app->diffuse_textures[i];
+    render_material->normal = &app->normal_textures[i];
+    render_material->alpha_mode = material->alpha_mode;
+    render_material->specular_strength = material->specular_strength;
+    render_material->shininess = material->shininess;
+    memcpy(render_material->base_color, material->base_color, sizeof(float) * 4);
+    render_material->use_diffuse_alpha_as_luster =
+        ((render_material->alpha_mode == ALPHA_MODE_OPAQUE &&
+          app->diffuse_textures[i].has_transparency) != 0);
+}
+
+static void frame_scene_camera(AppContext *app) {
+    CameraSetup camera_setup;
+    mesh_camera_setup(&app->mesh, &camera_setup);
+
+    setup_model_transform(&app->mesh, &camera_setup, app->args.model_scale, app->model_matrix);
+
+    vec3 camera_position;
+    setup_camera_position(&camera_setup, app->args.model_scale, app->args.camera_distance,
+                          camera_position);
+
+    vec3 camera_target;
+    glm_vec3_zero(camera_target);
+
+    camera_init(&app->camera, app->width, app->height, camera_position, camera_target,
+                CAMERA_FOV_DEGREES);
+}
+
+// Creates the material resources for the mesh and materials in `app` and frames the model
+// with the camera. Without `load_textures`, every material starts with the default gray and
+// flat normal textures, for the progressive loader to replace.
+static bool setup_scene_model(AppContext *app, const char *model_path, const bool load_textures) {
+    animation_state_free(&app->anim_state);
+    app->has_animations = ((app->mesh.has_animations && app->mesh.animations.count > 0) != 0);
+
+    app->diffuse_textures = calloc(app->model_material_count, sizeof(Texture));
+    app->normal_textures = calloc(app->model_material_count, sizeof(Texture));
+    app->render_materials = calloc(app->model_material_count, sizeof(RenderMaterial));
+    if (!app->diffuse_textures || !app->normal_textures || !app->render_materials) {
+        fprintf(stderr, "Failed to allocate material resources\n");
+        return false;
     }
-    chafa_driver_cleanup();
-    terminal_session_end(&app->terminal_session);
-    if (app->fatal_report.active) {
-        fprintf(stderr, "%s\n", app->fatal_report.message);
+
+    if (load_textures) {
+        load_material_textures(model_path, app->args.texture_path, app->args.normal_map_path,
+                               app->model_materials, app->model_material_count,
+                               app->diffuse_textures, app->normal_textures, NULL, NULL, NULL);
     }
-    if (app->renderer) {
-        vulkan_renderer_wait_idle(app->renderer);
+    for (size_t i = 0; i < app->model_material_count; i++) {
+        if (!load_textures) {
+            texture_init_default(&app->diffuse_textures[i]);
+            texture_create_flat_normal_map(&app->normal_textures[i]);
+        }
+        fill_render_material(app, i);
     }
-    if (app->shared_state_mutex_initialized) {
-        dcat_mutex_destroy(&app->shared_state_mutex);
+
+    frame_scene_camera(app);
+    return true;
+}
+
+// Takes a model load_model put into `app` (`loaded`), loads its textures and frames it
+// with the camera.
+static bool adopt_scene_model(AppContext *app, const char *model_path, const bool loaded) {
+    if (!loaded) {
+        fprintf(stderr, "Failed to load model: %s\n", model_path);
+        return false;
     }
+    app->model_path = model_path;
+    return setup_scene_model(app, model_path, true);
+}
 
-    aligned_free(app->bone_matrices);
+// Loads a model with its materials and textures and frames it with the camera.
+static bool load_scene_model(AppContext *app, const char *model_path) {
+    return adopt_scene_model(app, model_path,
+                             load_model(model_path, &app->mesh, &app->has_uvs,
+                                        &app->model_materials, &app->model_material_count));
+}
+
+static void import_model_task(void *context) {
+    AppContext *app = context;
+    app->model_imported = load_model(app->args.model_path, &app->mesh, &app->has_uvs,
+                                     &app->model_materials, &app->model_material_count);
+}
+
+// The output pipeline reads frames in the driver's ring in place (OutputDriver.owns_frame)
+static bool output_holds_frame(void *context, const uint8_t *frame) {
+    return output_pipeline_holds_frame(context, frame);
+}
+
+static void load_skydome_task(void *context) {
+    AppContext *app = context;
+    app->has_skydome =
+        load_skydome(app->args.skydome_path, app->skydome_size, &app->skydome_texture);
+    vips_thread_shutdown();
+}
+
+// Starts a --progressive load. Until the geometry arrives the scene is empty, so the
+// first frames (skydome and status bar) go out without waiting for the import.
+static bool start_scene_loader(AppContext *app) {
+    animation_state_free(&app->anim_state);
+    frame_scene_camera(app);
+    app->model_path = app->args.model_path;
+    if (!scene_loader_start(&app->scene_loader, app->args.model_path, app->args.texture_path,
+                            app->args.normal_map_path, &app->scene_changes)) {
+        fprintf(stderr, "Failed to start model loader thread\n");
+        return false;
+    }
+    app->loading = true;
+    return true;
+}
+
+static void stop_scene_loader(AppContext *app) {
+    scene_loader_stop(&app->scene_loader);
+    app->loading = false;
+}
+
+// --watch: from here on, saved edits to the model or its texture files are swapped in
+static bool start_hot_reload(AppContext *app) {
+    return hot_reload_start(&app->hot_reload, app->model_path, app->args.texture_path,
+                            app->args.normal_map_path, app->model_materials,
+                            app->model_material_count, &app->scene_changes);
+}
+
+// Frees everything load_scene_model created, on the CPU and the GPU, leaving the
+// renderer ready for the next model.
+static void unload_scene_model(AppContext *app) {
+    // Texture decoding reads the materials freed below
+    stop_scene_loader(app);
+    hot_reload_stop(&app->hot_reload);
+    vulkan_renderer_release_model(app->renderer);
     if (app->diffuse_textures) {
         for (size_t i = 0; i < app->model_material_count; i++) {
             texture_free(&app->diffuse_textures[i]);
         }
         free(app->diffuse_textures);
+        app->diffuse_textures = NULL;
     }
     if (app->normal_textures) {
         for (size_t i = 0; i < app->model_material_count; i++) {
             texture_free(&app->normal_textures[i]);
         }
         free(app->normal_textures);
+        app->normal_textures = NULL;
     }
     free(app->render_materials);
-    texture_free(&app->skydome_texture);
-    mesh_free(&app->skydome_mesh);
-    mesh_free(&app->mesh);
+    app->render_materials = NULL;
     materials_free(app->model_materials, app->model_material_count);
+    app->model_materials = NULL;
+    app->model_material_count = 0;
+    mesh_free(&app->mesh);
+    mesh_init(&app->mesh);
+    app->has_uvs = false;
+    app->has_animations = false;
+    animation_state_free(&app->anim_state);
+    app->host_data_released = false;
+    app->model_path = NULL;
+}
+
+// Drops the CPU-side copies of the finished model after a frame has uploaded it; from then
+// on only the GPU holds them
+static void release_host_data(AppContext *app) {
+    if (!app->low_memory || app->host_data_released || app->loading) {
+        return;
+    }
+    mesh_release_geometry(&app->mesh);
+    for (size_t i = 0; i < app->model_material_count; i++) {
+        texture_release_pixels(&app->diffuse_textures[i]);
+        texture_release_pixels(&app->normal_textures[i]);
+    }
+    app->host_data_released = true;
+}
+
+// Reloads released geometry from the mesh cache if the renderer has to upload it again
+static bool restore_host_data(AppContext *app) {
+    if (!app->mesh.geometry_released || vulkan_renderer_has_mesh(app->renderer, &app->mesh)) {
+        return true;
+    }
+    if (!mesh_restore_geometry(&app->mesh, app->model_path)) {
+        record_fatal_report(&app->fatal_report, "Failed to reload released geometry of %s",
+                            app->model_path);
+        return false;
+    }
+    app->host_data_released = false;
+    return true;
+}
+
+// Writes the --stats-json summary; '-' is stdout, which the terminal session no longer uses
+static void write_profile(const AppContext *app) {
+    const char *path = app->args.stats_path;
+    const bool to_stdout = strcmp(path, "-") == 0;
+    FILE *stream = to_stdout ? stdout : fopen(path, "w");
+    if (!stream) {
+        fprintf(stderr, "Failed to open stats file: %s\n", path);
+        return;
+    }
+    if (!frame_profiler_write_json(&app->profiler, stream)) {
+        fprintf(stderr, "Failed to write stats file: %s\n", path);
+    }
+    if (!to_stdout) {
+        fclose(stream);
+    }
+}
+
+static void write_replay_report(const AppContext *app) {
+    const double fps =
+        app->replay_seconds > 0.0 ? (double)app->replayed_frames / app->replay_seconds : 0.0;
+    printf("Replayed %u frames in %.3f s (%.1f FPS)\n", app->replayed_frames,
+           app->replay_seconds, fps);
+    if (!frame_profiler_write_report(&app->profiler, stdout)) {
+        fprintf(stderr, "Failed to write replay report\n");
+    }
+}
+
+void app_cleanup(AppContext *app) {
+    // A failed app_init may leave them running
+    background_task_join(&app->model_import);
+    background_task_join(&app->skydome_load);
+    signals_request_quit();
+    if (app->input_thread_started) {
+        dcat_thread_join(app->input_thread);
+    }
+    output_pipeline_stop(&app->output_pipeline);
+    frame_server_stop(&app->frame_server);
+    if (app->net_initialized) {
+        dcat_net_cleanup();
+    }
+    chafa_driver_cleanup();
+    kitty_direct_cleanup();
+    sixel_cleanup();
+    iterm2_cleanup();
+    block_encoder_cleanup();
+    terminal_session_end(&app->terminal_session);
+    if (app->fatal_report.active) {
+        fprintf(stderr, "%s\n", app->fatal_report.message);
+    }
+    if (app->replaying) {
+        write_replay_report(app);
+    }
+    if (app->args.stats_path) {
+        write_profile(app);
+    }
+    if (app->renderer) {
+        vulkan_renderer_wait_idle(app->renderer);
+    }
+    // The loaders notify scene_changes, so they stop before that goes away
+    stop_scene_loader(app);
+    hot_reload_stop(&app->hot_reload);
+    change_tracker_destroy(&app->scene_changes);
+    replay_script_free(&app->replay_script);
+    frame_pacer_destroy(&app->pacer);
+
+    unload_scene_model(app);
+    aligned_free(app->bone_matrices);
+    texture_free(&app->skydome_texture);
     if (app->renderer) {
         vulkan_renderer_destroy(app->renderer);
     }
@@ -402,142 +734,855 @@ bool app_init(AppContext *app, const Args *args, const char *prog_name) {
     memset(app, 0, sizeof(AppContext));
 
     app->args = *args;
+    app->profiling = args->stats_path != NULL || args->replay_path != NULL;
+    frame_profiler_init(&app->profiler);
+    if (args->replay_path) {
+        if (!replay_script_load(&app->replay_script, args->replay_path)) {
+            return false;
+        }
+        replay_player_init(&app->replay_player, &app->replay_script);
+        // Headless runs have no input thread, but replay through its snapshot all the same
+        input_snapshot_init(&app->input_snapshot);
+        app->replaying = true;
+    }
 
 #ifdef NDEBUG
     g_log_set_handler("VIPS", G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL | G_LOG_FLAG_RECURSION,
                       dummy_log_handler, NULL);
 #endif
 
+    // Startup overlaps what does not depend on each other. The model imports on its own
+    // thread from here, while the terminal is probed and the renderer comes up; those two run
+    // in turn, since the render size comes from the terminal. The skydome decodes once that
+    // size is known, and textures wait for both the materials and the renderer's formats.
+    app->headless = args_headless_format(&app->args);
+    // A batch loads each of its models in turn from app_run_batch. Headless and replayed
+    // frames are the finished model, so only interactive runs load progressively.
+    const bool progressive =
+        app->args.progressive && app->headless == HEADLESS_FORMAT_NONE && !app->replaying;
+    const bool import_at_startup = !app->args.batch && !progressive;
+
+    animation_set_resample_rate(app->args.animation_rate);
+    // The import bakes animations for the skinned vertex shader before the renderer is known;
+    // a CPU renderer drops them once the import is joined
+    if (app->args.gpu_animation && !app->args.cpu_render) {
+        animation_set_bake_rate(app->args.animation_rate > 0.0F ? app->args.animation_rate
+                                                                : DEFAULT_BAKE_RATE);
+    }
+    mesh_init(&app->mesh);
+    if (import_at_startup) {
+        background_task_start(&app->model_import, import_model_task, app);
+    }
+
     if (VIPS_INIT(prog_name)) {
         fprintf(stderr, "Failed to initialize libvips\n");
         return false;
     }
 
     app->output_driver = driver_factory_get(&app->args);
+    // Raw and PNG frames are plain RGBA, whatever output mode was selected
+    const bool pixel_output =
+        app->headless == HEADLESS_FORMAT_RGBA || app->headless == HEADLESS_FORMAT_PNG;
 
     signals_init();
 
-    calculate_output_dimensions(&app->args, app->output_driver, &app->width, &app->height);
-
-    mesh_init(&app->mesh);
-    mesh_init(&app->skydome_mesh);
+    if (pixel_output) {
+        app->width = app->args.width > 0 ? (uint32_t)app->args.width : HEADLESS_DEFAULT_SIZE;
+        app->height = app->args.height > 0 ? (uint32_t)app->args.height : HEADLESS_DEFAULT_SIZE;
+    } else {
+        calculate_output_dimensions(&app->args, app->output_driver, &app->width, &app->height);
+    }
+    app->display_width = app->width;
+    app->display_height = app->height;
+    // Decoding past what the output can show only costs memory and upload bandwidth
+    texture_set_max_size(texture_max_size_for_output(app->width, app->height));
+
+    // Sized for the output at startup: a panorama much larger than the view only costs memory
+    if (app->args.skydome_path) {
+        app->skydome_size = skydome_size_for_output(app->height, glm_rad(CAMERA_FOV_DEGREES));
+        background_task_start(&app->skydome_load, load_skydome_task, app);
+    }
 
     app->renderer = vulkan_renderer_create(app->width, app->height);
-    if (!app->renderer || !vulkan_renderer_initialize(app->renderer)) {
+    bool renderer_ready = false;
+    if (app->renderer && !app->args.cpu_render) {
+        vulkan_renderer_set_device_preference(app->renderer, app->args.gpu_device);
+        renderer_ready = vulkan_renderer_initialize(app->renderer);
+        if (!renderer_ready) {
+            const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
+            fprintf(stderr, "No usable Vulkan device, rendering on the CPU%s%s\n",
+                    renderer_error ? ": " : "", renderer_error ? renderer_error : "");
+            // Start again from a renderer without the partly created device
+            vulkan_renderer_destroy(app->renderer);
+            app->renderer = vulkan_renderer_create(app->width, app->height);
+        }
+    }
+    if (app->renderer && !renderer_ready) {
+        renderer_ready = vulkan_renderer_initialize_cpu(app->renderer);
+    }
+    if (!renderer_ready) {
         const char *renderer_error =
             app->renderer ? vulkan_renderer_get_last_error(app->renderer) : NULL;
         fprintf(stderr, "%s\n",
                 renderer_error ? renderer_error : "Failed to initialize Vulkan renderer");
         return false;
     }
+    // Before any texture decodes, which then come out in the block formats the GPU samples
+    texture_set_gpu_formats(vulkan_renderer_texture_formats(app->renderer));
+    // The CPU backend draws from the host copies every frame
+    app->low_memory = app->args.low_memory && !vulkan_renderer_needs_host_data(app->renderer);
+    if (app->args.low_memory && !app->low_memory) {
+        fprintf(stderr, "--low-memory has no effect on the CPU renderer\n");
+    }
     vulkan_renderer_set_light_direction(app->renderer, (vec3){0.0F, -1.0F, -0.5F});
-
-    if (!load_model(app->args.model_path, &app->mesh, &app->has_uvs, &app->model_materials,
-                    &app->model_material_count)) {
-        fprintf(stderr, "Failed to load model: %s\n", app->args.model_path);
+    // Viewers encode RGBA frames for their own terminals, so a server reads back pixels
+    if (app->args.serve_address && app->output_driver->cell_format != OUTPUT_CELLS_NONE) {
+        app->output_driver = driver_factory_pixel_fallback(app->output_driver);
+    }
+    if (!pixel_output && app->output_driver->cell_format != OUTPUT_CELLS_NONE) {
+        const VulkanCellOutput cell_output =
+            app->output_driver->cell_format == OUTPUT_CELLS_QUADRANT_MONO
+                ? VULKAN_CELL_OUTPUT_QUADRANT_MONO
+                : VULKAN_CELL_OUTPUT_QUADRANT_COLOR;
+        if (!vulkan_renderer_set_cell_output(app->renderer, cell_output)) {
+            const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
+            fprintf(stderr, "GPU cells unavailable, encoding on the CPU%s%s\n",
+                    renderer_error ? ": " : "", renderer_error ? renderer_error : "");
+            app->output_driver = driver_factory_pixel_fallback(app->output_driver);
+            if (!vulkan_renderer_set_cell_output(app->renderer, VULKAN_CELL_OUTPUT_NONE)) {
+                fprintf(stderr, "Failed to create readback buffers\n");
+                return false;
+            }
+        }
+    }
+    // A character cell shows its 2x4 pixel block as about 2x2 samples, so finer mesh detail
+    // than that is never visible
+    if (!pixel_output && app->output_driver->uses_character_cells &&
+        !app->args.use_hash_characters) {
+        vulkan_renderer_set_lod_detail(app->renderer, (float)SYMBOL_CELL_SOURCE_WIDTH);
+    }
+    vulkan_renderer_set_backface_culling(app->renderer, app->args.cull_backfaces);
+    // Let the GPU read frames straight into the driver's shared memory when it can.
+    if (!pixel_output && app->output_driver->map_frame_ring &&
+        !vulkan_renderer_set_host_readback(app->renderer, app->output_driver->map_frame_ring)) {
+        const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
+        fprintf(stderr, "%s\n",
+                renderer_error ? renderer_error : "Failed to create readback buffers");
         return false;
     }
+    vulkan_renderer_set_frame_held(app->renderer, output_holds_frame, &app->output_pipeline);
 
-    animation_state_init(&app->anim_state);
     if (!initialize_bone_matrices(&app->bone_matrices)) {
         fprintf(stderr, "Failed to allocate bone matrices\n");
         return false;
     }
-    app->has_animations = ((app->mesh.has_animations && app->mesh.animations.count > 0) != 0);
 
-    app->diffuse_textures = calloc(app->model_material_count, sizeof(Texture));
-    app->normal_textures = calloc(app->model_material_count, sizeof(Texture));
-    app->render_materials = calloc(app->model_material_count, sizeof(RenderMaterial));
-    if (!app->diffuse_textures || !app->normal_textures || !app->render_materials) {
-        fprintf(stderr, "Failed to allocate material resources\n");
-        return false;
+    background_task_join(&app->model_import);
+    if (app->args.gpu_animation && vulkan_renderer_needs_host_data(app->renderer)) {
+        fprintf(stderr, "--gpu-animation has no effect on the CPU renderer\n");
+        animation_set_bake_rate(0.0F);
+        baked_poses_free(&app->mesh.baked_poses);
     }
-
-    for (size_t i = 0; i < app->model_material_count; i++) {
-        load_diffuse_texture(app->args.model_path, app->args.texture_path, &app->model_materials[i],
-                             &app->diffuse_textures[i]);
-        load_normal_texture(app->args.normal_map_path, &app->model_materials[i],
-                            &app->normal_textures[i]);
-
-        app->render_materials[i].diffuse = &app->diffuse_textures[i];
-        app->render_materials[i].normal = &app->normal_textures[i];
-        app->render_materials[i].alpha_mode = app->model_materials[i].alpha_mode;
-        app->render_materials[i].specular_strength = app->model_materials[i].specular_strength;
-        app->render_materials[i].shininess = app->model_materials[i].shininess;
-        memcpy(app->render_materials[i].base_color, app->model_materials[i].base_color,
-               sizeof(float) * 4);
-        app->render_materials[i].use_diffuse_alpha_as_luster =
-            ((app->render_materials[i].alpha_mode == ALPHA_MODE_OPAQUE &&
-              app->diffuse_textures[i].has_transparency) != 0);
+    // Texture decodes overlap the skydome's
+    if (import_at_startup && !adopt_scene_model(app, app->args.model_path, app->model_imported)) {
+        return false;
     }
 
-    app->has_skydome =
-        load_skydome(app->args.skydome_path, &app->skydome_mesh, &app->skydome_texture);
+    background_task_join(&app->skydome_load);
     if (app->has_skydome) {
-        if (!vulkan_renderer_set_skydome(app->renderer, &app->skydome_mesh,
-                                         &app->skydome_texture)) {
+        if (!vulkan_renderer_set_skydome(app->renderer, &app->skydome_texture)) {
             const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
             fprintf(stderr, "%s\n",
                     renderer_error ? renderer_error : "Failed to upload skydome resources");
             return false;
         }
+        if (app->low_memory) {
+            texture_release_pixels(&app->skydome_texture);
+        }
     }
 
-    CameraSetup camera_setup;
-    calculate_camera_setup(&app->mesh.vertices, &camera_setup);
-
-    setup_model_transform(&app->mesh, &camera_setup, app->args.model_scale, app->model_matrix);
-
-    vec3 camera_position;
-    setup_camera_position(&camera_setup, app->args.model_scale, app->args.camera_distance,
-                          camera_position);
-
-    vec3 camera_target;
-    glm_vec3_zero(camera_target);
-
     app->move_speed = 0.5F;
     app->target_frame_time = 1.0 / app->args.target_fps;
+    frame_pacer_init(&app->pacer, app->target_frame_time);
+    render_scale_init(&app->render_scale, app->target_frame_time);
+    app->adaptive_resolution =
+        (app->args.adaptive_resolution && app->output_driver->supports_render_scale) != 0;
 
-    camera_init(&app->camera, app->width, app->height, camera_position, camera_target, 60.0F);
+    if (!change_tracker_init(&app->scene_changes)) {
+        fprintf(stderr, "Failed to initialize scene change tracker\n");
+        return false;
+    }
+
+    if (progressive && !start_scene_loader(app)) {
+        return false;
+    }
 
-    if (!dcat_mutex_init(&app->shared_state_mutex)) {
-        fprintf(stderr, "Failed to initialize shared state mutex\n");
+    // A progressive load starts watching once it has handed everything over
+    app->watch_files = app->args.watch && app->headless == HEADLESS_FORMAT_NONE &&
+                       !app->replaying && !app->args.batch;
+    if (app->watch_files && !progressive && !start_hot_reload(app)) {
+        fprintf(stderr, "Failed to start watching %s\n", app->args.model_path);
         return false;
     }
-    app->shared_state_mutex_initialized = true;
+
+    // Headless runs write frames themselves: no terminal, output thread or input thread
+    if (app->headless != HEADLESS_FORMAT_NONE) {
+        return true;
+    }
+
+    if (app->args.serve_address) {
+        app->net_initialized = dcat_net_init();
+        if (!app->net_initialized ||
+            !frame_server_start(&app->frame_server, app->args.serve_address)) {
+            return false;
+        }
+        const uint16_t port = frame_server_port(&app->frame_server);
+        if (port != 0) {
+            fprintf(stderr, "Serving frames on %s (port %u)\n", app->args.serve_address,
+                    (unsigned int)port);
+        } else {
+            fprintf(stderr, "Serving frames on %s\n", app->args.serve_address);
+        }
+    }
 
     terminal_session_begin(&app->terminal_session, app->args.mouse_orbit);
 
-    app->input_data = (InputThreadData){&app->camera,
-                                        app->renderer,
-                                        &app->anim_state,
-                                        &app->mesh,
-                                        &app->shared_state_mutex,
+    if (!output_pipeline_start(&app->output_pipeline, app->output_driver,
+                               app->args.adaptive_output ? app->target_frame_time : 0.0,
+                               app->profiling ? &app->profiler : NULL)) {
+        record_fatal_report(&app->fatal_report, "Failed to start output thread");
+        return false;
+    }
+
+    input_snapshot_init(&app->input_snapshot);
+    input_snapshot_init(&app->ignored_input);
+    app->input_data = (InputThreadData){&app->input_commands,
+                                        app->replaying ? &app->ignored_input
+                                                       : &app->input_snapshot,
                                         app->args.fps_controls,
                                         app->args.mouse_orbit,
                                         app->args.mouse_sensitivity,
-                                        app->has_animations,
-                                        &app->key_state};
+                                        &app->scene_changes};
 
     if (!dcat_thread_create(&app->input_thread, input_thread_func, &app->input_data)) {
         record_fatal_report(&app->fatal_report, "Failed to start input thread");
         return false;
     }
     app->input_thread_started = true;
+    // A pixel mode taken from the capability cache is checked again, now that the input
+    // thread reads the replies; no frame has been written yet
+    chafa_driver_revalidate();
 
     return true;
 }
 
-int app_run_loop(AppContext *app) {
-    RenderContext render_ctx = {
+// The render loop and the output thread overlap, so a frame costs whichever of the
+// two is slower.
+static bool adapt_render_scale(AppContext *app, const double frame_start, mat4 view,
+                               mat4 projection) {
+    const double render_time = get_time_seconds() - frame_start;
+    const double write_time = output_pipeline_last_write_time(&app->output_pipeline);
+    const double frame_time = render_time > write_time ? render_time : write_time;
+    if (!render_scale_update(&app->render_scale, frame_time)) {
+        return true;
+    }
+
+    uint32_t new_width = 0;
+    uint32_t new_height = 0;
+    render_scale_apply(app->render_scale.scale, app->display_width, app->display_height,
+                       &new_width, &new_height);
+    return apply_render_size(app->renderer, &app->output_pipeline, &app->camera, new_width,
+                             new_height, &app->width, &app->height, view, projection);
+}
+
+static bool key_state_held(const KeyState *key_state) {
+    return key_state->w || key_state->a || key_state->s || key_state->d || key_state->i ||
+           key_state->j || key_state->k || key_state->l || key_state->space || key_state->shift ||
+           key_state->ctrl || key_state->q || key_state->v || key_state->b ||
+           key_state->mouse_dx != 0 || key_state->mouse_dy != 0;
+}
+
+// True while the scene moves on its own, so the next frame differs even without input.
+static bool scene_is_animating(AppContext *app) {
+    if (app->args.spin_speed != 0.0F && !app->args.fps_controls) {
+        return true;
+    }
+    return (app->has_animations && app->anim_state.playing) ||
+           (app->args.fps_controls && key_state_held(&app->applied_input.commands.keys));
+}
+
+// Once the scene settles, replaces a reduced-resolution frame with a full-resolution one
+// so the image left on screen while idle is sharp. Sets *frame_needed if it resized.
+static bool refine_settled_frame(AppContext *app, mat4 view, mat4 projection,
+                                 bool *frame_needed) {
+    if (!app->adaptive_resolution || app->render_scale.scale >= RENDER_SCALE_MAX) {
+        return true;
+    }
+    *frame_needed = true;
+    app->render_scale.scale = RENDER_SCALE_MAX;
+    render_scale_reset_history(&app->render_scale);
+    uint32_t new_width = 0;
+    uint32_t new_height = 0;
+    render_scale_apply(app->render_scale.scale, app->display_width, app->display_height,
+                       &new_width, &new_height);
+    return apply_render_size(app->renderer, &app->output_pipeline, &app->camera, new_width,
+                             new_height, &app->width, &app->height, view, projection);
+}
+
+static void init_render_context(AppContext *app, RenderContext *ctx) {
+    *ctx = (RenderContext){
         .renderer = app->renderer,
         .model_matrix = {{0}},
         .materials = app->render_materials,
         .material_count = (uint32_t)app->model_material_count,
         .enable_lighting = (!app->args.no_lighting) != 0,
         .use_triplanar_mapping = (!app->has_uvs) != 0,
+        .frame_server = app->frame_server.started ? &app->frame_server : NULL,
     };
-    glm_mat4_copy(app->model_matrix, render_ctx.model_matrix);
+    glm_mat4_copy(app->model_matrix, ctx->model_matrix);
+}
+
+// Swaps in whatever the progressive loader finished since the last frame: the geometry
+// with placeholder textures first, then each material's real textures. Returns false when
+// the model cannot be shown.
+static bool poll_scene_loader(AppContext *app, RenderContext *ctx, AnimationContext *anim_ctx,
+                              mat4 base_model_matrix) {
+    if (!app->loading) {
+        return true;
+    }
+
+    Mesh mesh;
+    bool has_uvs = false;
+    MaterialInfo *materials = NULL;
+    size_t material_count = 0;
+    bool failed = false;
+    if (scene_loader_take_geometry(&app->scene_loader, &mesh, &has_uvs, &materials,
+                                   &material_count, &failed)) {
+        mesh_free(&app->mesh);
+        app->mesh = mesh;
+        app->has_uvs = has_uvs;
+        app->model_materials = materials;
+        app->model_material_count = material_count;
+        const bool ready = setup_scene_model(app, app->args.model_path, false);
+        if (!ready) {
+            record_fatal_report(&app->fatal_report, "Failed to allocate material resources");
+            return false;
+        }
+        init_render_context(app, ctx);
+        glm_mat4_copy(ctx->model_matrix, base_model_matrix);
+        anim_ctx->has_animations = app->has_animations;
+    }
+    if (failed) {
+        record_fatal_report(&app->fatal_report, "Failed to load model: %s", app->args.model_path);
+        return false;
+    }
+
+    size_t material = 0;
+    Texture diffuse;
+    Texture normal;
+    bool textures_changed = false;
+    while (scene_loader_take_textures(&app->scene_loader, &material, &diffuse, &normal)) {
+        texture_free(&app->diffuse_textures[material]);
+        texture_free(&app->normal_textures[material]);
+        app->diffuse_textures[material] = diffuse;
+        app->normal_textures[material] = normal;
+        fill_render_material(app, material);
+        textures_changed = true;
+    }
+    if (textures_changed) {
+        vulkan_renderer_mark_materials_changed(app->renderer);
+    }
+
+    if (scene_loader_done(&app->scene_loader)) {
+        stop_scene_loader(app);
+        if (app->watch_files && !start_hot_reload(app)) {
+            record_fatal_report(&app->fatal_report, "Failed to start watching %s",
+                                app->args.model_path);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Moves the model a --watch reload re-imported into `app`. The camera and the model's place
+// stay as they are; materials the reload did not give new textures keep theirs, by index.
+static bool swap_in_reloaded_model(AppContext *app, HotReloadResult *result) {
+    const size_t count = result->material_count;
+    const size_t slots = count > 0 ? count : 1;
+    Texture *diffuse_textures = calloc(slots, sizeof(Texture));
+    Texture *normal_textures = calloc(slots, sizeof(Texture));
+    RenderMaterial *render_materials = calloc(slots, sizeof(RenderMaterial));
+    if (!diffuse_textures || !normal_textures || !render_materials) {
+        free(diffuse_textures);
+        free(normal_textures);
+        free(render_materials);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (result->replaced[i]) {
+            continue;
+        }
+        if (i < app->model_material_count) {
+            diffuse_textures[i] = app->diffuse_textures[i];
+            normal_textures[i] = app->normal_textures[i];
+            memset(&app->diffuse_textures[i], 0, sizeof(Texture));
+            memset(&app->normal_textures[i], 0, sizeof(Texture));
+        } else {
+            texture_init_default(&diffuse_textures[i]);
+            texture_create_flat_normal_map(&normal_textures[i]);
+        }
+    }
+    for (size_t i = 0; i < app->model_material_count; i++) {
+        texture_free(&app->diffuse_textures[i]);
+        texture_free(&app->normal_textures[i]);
+    }
+    free(app->diffuse_textures);
+    free(app->normal_textures);
+    free(app->render_materials);
+    materials_free(app->model_materials, app->model_material_count);
+    app->diffuse_textures = diffuse_textures;
+    app->normal_textures = normal_textures;
+    app->render_materials = render_materials;
+    app->model_materials = result->materials;
+    app->model_material_count = count;
+
+    // Only what the edit changed goes up to the GPU again when the sizes held
+    mesh_edit_diff(&app->mesh, &result->mesh);
+    mesh_free(&app->mesh);
+    app->mesh = result->mesh;
+    app->has_uvs = result->has_uvs;
+    result->has_model = false;
+    animation_state_free(&app->anim_state);
+    app->has_animations = ((app->mesh.has_animations && app->mesh.animations.count > 0) != 0);
+    app->host_data_released = false;
+    return true;
+}
+
+// Swaps in whatever --watch reloaded since the last frame. Returns false when the reloaded
+// model cannot be shown.
+static bool poll_hot_reload(AppContext *app, RenderContext *ctx, AnimationContext *anim_ctx) {
+    HotReloadResult result;
+    if (!app->hot_reload.started || !hot_reload_take(&app->hot_reload, &result)) {
+        return true;
+    }
+    if (result.has_model && !swap_in_reloaded_model(app, &result)) {
+        hot_reload_result_free(&result);
+        record_fatal_report(&app->fatal_report, "Failed to allocate material resources");
+        return false;
+    }
+    for (size_t i = 0; i < result.count && i < app->model_material_count; i++) {
+        if (result.replaced[i]) {
+            texture_free(&app->diffuse_textures[i]);
+            texture_free(&app->normal_textures[i]);
+            app->diffuse_textures[i] = result.diffuse[i];
+            app->normal_textures[i] = result.normal[i];
+            result.replaced[i] = false;
+        }
+    }
+    hot_reload_result_free(&result);
+    for (size_t i = 0; i < app->model_material_count; i++) {
+        fill_render_material(app, i);
+    }
+    vulkan_renderer_mark_materials_changed(app->renderer);
+
+    ctx->materials = app->render_materials;
+    ctx->material_count = (uint32_t)app->model_material_count;
+    ctx->use_triplanar_mapping = (!app->has_uvs) != 0;
+    anim_ctx->has_animations = app->has_animations;
+    return true;
+}
+
+static void profile_time(AppContext *app, const FrameStage stage, const double seconds) {
+    if (app->profiling) {
+        frame_profiler_add_time(&app->profiler, stage, seconds);
+    }
+}
+
+// Applies what the input thread published since the last frame to the camera, renderer and
+// animation state. The input thread only ever adds to its totals and counters, so this never
+// waits on it. Returns whether there was any input: a command, or a movement key held.
+static bool apply_input(AppContext *app, const float delta_time) {
+    InputSnapshot *snapshot = &app->input_snapshot;
+    AppliedInput *applied = &app->applied_input;
+    const InputCommands *latest = input_snapshot_read(snapshot);
+
+    const float yaw = (float)(latest->orbit_yaw - applied->commands.orbit_yaw);
+    const float pitch = (float)(latest->orbit_pitch - applied->commands.orbit_pitch);
+    if (yaw != 0.0F || pitch != 0.0F) {
+        camera_orbit(&app->camera, yaw, pitch);
+    }
+    const float pan_x = (float)(latest->pan_x - applied->commands.pan_x);
+    const float pan_y = (float)(latest->pan_y - applied->commands.pan_y);
+    if (pan_x != 0.0F || pan_y != 0.0F) {
+        camera_pan(&app->camera, pan_x, pan_y);
+    }
+    for (int64_t step = applied->commands.zoom_steps; step < latest->zoom_steps; step++) {
+        camera_zoom(&app->camera, ZOOM_AMOUNT);
+    }
+    for (int64_t step = applied->commands.zoom_steps; step > latest->zoom_steps; step--) {
+        camera_zoom(&app->camera, -ZOOM_AMOUNT);
+    }
+    bool active = yaw != 0.0F || pitch != 0.0F || pan_x != 0.0F || pan_y != 0.0F ||
+                  latest->zoom_steps != applied->commands.zoom_steps ||
+                  (app->args.fps_controls && key_state_held(&latest->keys));
+    applied->commands = *latest;
+    if (app->args.fps_controls || app->replaying) {
+        process_input_devices(&applied->commands.keys, &app->camera, delta_time,
+                              &app->move_speed);
+    }
+
+    const unsigned int wireframe_toggles = atomic_load(&snapshot->wireframe_toggles);
+    const bool wireframe_changed = wireframe_toggles != applied->wireframe_toggles;
+    if ((wireframe_toggles - applied->wireframe_toggles) % 2U != 0U) {
+        const bool wireframe = vulkan_renderer_get_wireframe_mode(app->renderer);
+        vulkan_renderer_set_wireframe_mode(app->renderer, (!wireframe) != 0);
+    }
+    applied->wireframe_toggles = wireframe_toggles;
+
+    const unsigned int next_animations = atomic_load(&snapshot->next_animations);
+    const unsigned int previous_animations = atomic_load(&snapshot->previous_animations);
+    const unsigned int play_toggles = atomic_load(&snapshot->play_toggles);
+    active = active || wireframe_changed || next_animations != applied->next_animations ||
+             previous_animations != applied->previous_animations ||
+             play_toggles != applied->play_toggles;
+    if (app->has_animations) {
+        AnimationState *state = &app->anim_state;
+        if (next_animations != applied->next_animations ||
+            previous_animations != applied->previous_animations) {
+            const int64_t count = (int64_t)app->mesh.animations.count;
+            const int64_t steps = (int64_t)(next_animations - applied->next_animations) -
+                                  (int64_t)(previous_animations - applied->previous_animations);
+            state->current_animation_index =
+                (int)((((state->current_animation_index + steps) % count) + count) % count);
+            state->current_time = 0.0F;
+        }
+        if ((play_toggles - applied->play_toggles) % 2U != 0U) {
+            state->playing = ((!state->playing) != 0);
+        }
+    }
+    applied->next_animations = next_animations;
+    applied->previous_animations = previous_animations;
+    applied->play_toggles = play_toggles;
+    return active;
+}
+
+// --replay: publishes the script's input for the next frame, `delta_time` seconds after the
+// last, for apply_input to pick up as it would the input thread's
+static void replay_input(AppContext *app, const float delta_time) {
+    ReplayPlayer *player = &app->replay_player;
+    replay_player_step(player, delta_time);
+    InputSnapshot *snapshot = &app->input_snapshot;
+    input_snapshot_publish(snapshot, &player->commands);
+    atomic_store(&snapshot->wireframe_toggles, player->wireframe_toggles);
+    atomic_store(&snapshot->next_animations, player->next_animations);
+    atomic_store(&snapshot->previous_animations, player->previous_animations);
+    atomic_store(&snapshot->play_toggles, player->play_toggles);
+}
+
+// Picks which frame the renderer returns next. Input wants to see its effect at once, so
+// --latency auto waits on each frame while input arrives, and on the first frame of a change
+// that came without input: a --progressive load, a --watch reload or a resize. The rest of
+// the time, spinning or playing an animation, it keeps frames in flight for throughput. A
+// settling frame, the last before the loop idles, is always waited on, whatever the mode.
+static void select_latency_mode(AppContext *app, const double now, const bool input_active,
+                                const bool scene_changed, const bool settling) {
+    if (input_active) {
+        app->last_input_time = now;
+    }
+    bool low = settling;
+    switch (args_latency_mode(&app->args)) {
+    case LATENCY_MODE_LOW:
+        low = true;
+        break;
+    case LATENCY_MODE_AUTO:
+        low = low || scene_changed || now - app->last_input_time < LOW_LATENCY_HOLD_SECONDS;
+        break;
+    default:
+        break;
+    }
+    vulkan_renderer_set_latency_mode(app->renderer,
+                                     low ? VULKAN_LATENCY_LOW : VULKAN_LATENCY_PIPELINED);
+}
+
+// Advances the animation by `delta_time` seconds and poses the mesh for the next frame: in
+// the vertex shader when it has baked poses, otherwise into bone_matrices
+static void advance_animation(AppContext *app, const float delta_time) {
+    const double animation_start = get_time_seconds();
+    if (app->mesh.baked_poses.rows) {
+        update_animation(&app->mesh, &app->anim_state, delta_time, NULL);
+        vulkan_renderer_set_baked_pose(app->renderer, app->anim_state.current_animation_index,
+                                       app->anim_state.current_time);
+    } else {
+        update_animation(&app->mesh, &app->anim_state, delta_time, app->bone_matrices);
+        vulkan_renderer_mark_pose_changed(app->renderer);
+    }
+    profile_time(app, FRAME_STAGE_ANIMATION, get_time_seconds() - animation_start);
+}
+
+// Adds the renderer's fence wait and recording time for the frame just rendered, and the GPU
+// stage times once a new frame's timestamps have been read back.
+static void profile_render(AppContext *app) {
+    if (!app->profiling) {
+        return;
+    }
+    VulkanHostTimings host;
+    vulkan_renderer_get_host_timings(app->renderer, &host);
+    frame_profiler_add_time(&app->profiler, FRAME_STAGE_FENCE_WAIT, host.fence_wait);
+    frame_profiler_add_time(&app->profiler, FRAME_STAGE_RECORD, host.record);
+    VulkanGpuTimings gpu;
+    if (vulkan_renderer_get_gpu_timings(app->renderer, &gpu) &&
+        gpu.frame != app->profiled_gpu_frame) {
+        app->profiled_gpu_frame = gpu.frame;
+        for (uint32_t i = 0; i < VULKAN_GPU_STAGE_COUNT; i++) {
+            frame_profiler_add_time(&app->profiler, (FrameStage)(FRAME_STAGE_GPU_SKYDOME + i),
+                                    gpu.stage_ms[i] / 1000.0);
+        }
+    }
+}
+
+static bool write_png_frame(FrameWriter *writer, const uint8_t *framebuffer, const uint32_t width,
+                            const uint32_t height, size_t *out_size) {
+    VipsImage *image = vips_image_new_from_memory(framebuffer, (size_t)width * height * 4U,
+                                                  (int)width, (int)height, 4, VIPS_FORMAT_UCHAR);
+    if (!image) {
+        fprintf(stderr, "Failed to wrap frame for PNG encoding: %s\n", vips_error_buffer());
+        return false;
+    }
+    void *png = NULL;
+    size_t png_size = 0;
+    // Thumbnails favour encode speed over size
+    const int result = vips_pngsave_buffer(image, &png, &png_size, "compression", 1, NULL);
+    g_object_unref(image);
+    if (result != 0) {
+        fprintf(stderr, "Failed to encode PNG: %s\n", vips_error_buffer());
+        return false;
+    }
+    const bool ok = frame_writer_write(writer, png, png_size);
+    g_free(png);
+    *out_size = png_size;
+    return ok;
+}
+
+static bool write_headless_frame(AppContext *app, FrameWriter *writer, const uint32_t index,
+                                 const uint8_t *framebuffer) {
+    if (!frame_writer_begin(writer, index)) {
+        return false;
+    }
+    bool ok = true;
+    size_t bytes = 0;
+    switch (app->headless) {
+    case HEADLESS_FORMAT_RGBA:
+        bytes = (size_t)app->width * app->height * 4U;
+        ok = frame_writer_write(writer, framebuffer, bytes);
+        break;
+    case HEADLESS_FORMAT_PNG:
+        ok = write_png_frame(writer, framebuffer, app->width, app->height, &bytes);
+        break;
+    case HEADLESS_FORMAT_ENCODED: {
+        // Every frame is written in full so each one stands alone
+        const bool use_hash =
+            (app->args.use_hash_characters && app->output_driver->uses_character_cells) != 0;
+        if (app->output_driver->invalidate) {
+            app->output_driver->invalidate();
+        }
+        terminal_set_output_fd(writer->fd);
+        terminal_set_display_size(app->width, app->height);
+        const double encode_start = get_time_seconds();
+        terminal_frame_begin();
+        app->output_driver->render_frame(framebuffer, app->width, app->height, use_hash);
+        const double write_start = get_time_seconds();
+        bytes = terminal_frame_end();
+        profile_time(app, FRAME_STAGE_ENCODE, write_start - encode_start);
+        profile_time(app, FRAME_STAGE_WRITE, get_time_seconds() - write_start);
+        terminal_set_output_fd(STDOUT_FILENO);
+        break;
+    }
+    case HEADLESS_FORMAT_NONE:
+    case HEADLESS_FORMAT_INVALID:
+        ok = false;
+        break;
+    }
+    if (app->profiling) {
+        frame_profiler_add_bytes(&app->profiler, bytes);
+    }
+    return frame_writer_end(writer) && ok;
+}
+
+// Renders --frames frames from the initial camera as fast as the GPU allows. Animation and
+// spin advance by a fixed 1/--fps step per frame, as does a --replay script, so output is
+// the same on every run; --turntable instead turns the model a full revolution across the
+// frames. `name` fills the %s of the output path in batch runs.
+static bool render_headless(AppContext *app, const char *name) {
+    RenderContext render_ctx;
+    init_render_context(app, &render_ctx);
+    AnimationContext anim_ctx = {app->bone_matrices, app->has_animations};
+    mat4 base_model_matrix;
+    glm_mat4_copy(render_ctx.model_matrix, base_model_matrix);
+
+    FrameWriter writer;
+    if (!frame_writer_open(&writer, app->args.output_path, name)) {
+        return false;
+    }
+
+    mat4 view;
+    mat4 projection;
+    refresh_camera_matrices(&app->camera, view, projection);
+    vec3 light_dir;
+    camera_forward_direction(&app->camera, light_dir);
+    glm_vec3_negate(light_dir);
+    vulkan_renderer_set_light_direction(app->renderer, light_dir);
+
+    const uint32_t frame_count = (uint32_t)app->args.frame_count;
+    const float frame_step = 1.0F / (float)app->args.target_fps;
+    const double start = get_time_seconds();
+    uint32_t written = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i < frame_count && ok && !signals_should_quit(); i++) {
+        const float angle = app->args.turntable
+                                ? 2.0F * (float)GLM_PI * (float)i / (float)frame_count
+                                : app->args.spin_speed * frame_step * (float)i;
+        if (angle != 0.0F) {
+            mat4 rotation_mat;
+            glm_rotate_make(rotation_mat, angle, (vec3){0.0F, 1.0F, 0.0F});
+            glm_mat4_mul(rotation_mat, base_model_matrix, render_ctx.model_matrix);
+        }
+        if (app->replaying) {
+            const double input_start = get_time_seconds();
+            replay_input(app, i == 0 ? 0.0F : frame_step);
+            apply_input(app, i == 0 ? 0.0F : frame_step);
+            profile_time(app, FRAME_STAGE_INPUT, get_time_seconds() - input_start);
+            camera_forward_direction(&app->camera, light_dir);
+            glm_vec3_negate(light_dir);
+            vulkan_renderer_set_light_direction(app->renderer, light_dir);
+            camera_view_matrix(&app->camera, view);
+        }
+        if (app->has_animations) {
+            advance_animation(app, i == 0 ? 0.0F : frame_step);
+        }
+
+        const uint8_t *framebuffer = NULL;
+        ok = restore_host_data(app) &&
+             render_scene(&render_ctx, &anim_ctx, &app->mesh, &view, &projection,
+                          app->camera.position, &framebuffer);
+        profile_render(app);
+        if (ok) {
+            release_host_data(app);
+        }
+        if (ok && framebuffer) {
+            ok = write_headless_frame(app, &writer, written++, framebuffer);
+        }
+    }
+
+    // Collect the frames still in flight
+    while (ok && written < frame_count && !signals_should_quit()) {
+        const uint8_t *framebuffer = NULL;
+        ok = vulkan_renderer_read_pending_frame(app->renderer, &framebuffer);
+        if (!ok || !framebuffer) {
+            break;
+        }
+        ok = write_headless_frame(app, &writer, written++, framebuffer);
+    }
+    frame_writer_close(&writer);
+    app->replayed_frames = written;
+    app->replay_seconds = get_time_seconds() - start;
+
+    if (!ok) {
+        const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
+        if (renderer_error) {
+            record_fatal_report(&app->fatal_report, "%s", renderer_error);
+        }
+        return false;
+    }
+    return true;
+}
+
+static int app_run_headless(AppContext *app) {
+    return render_headless(app, NULL) ? 0 : 1;
+}
+
+// Reads the next non-empty line of `stream` into `out`, without its line ending. Returns
+// false at the end of the input.
+static bool read_batch_line(FILE *stream, char *out, const size_t out_size) {
+    while (fgets(out, (int)out_size, stream)) {
+        size_t length = strlen(out);
+        if (length > 0 && out[length - 1] != '\n' && !feof(stream)) {
+            fprintf(stderr, "Skipping model path longer than %zu bytes\n", out_size - 2);
+            int c = 0;
+            while ((c = fgetc(stream)) != EOF && c != '\n') {
+            }
+            continue;
+        }
+        while (length > 0 && (out[length - 1] == '\n' || out[length - 1] == '\r')) {
+            out[--length] = '\0';
+        }
+        if (length > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int app_run_batch(AppContext *app, char *const *model_paths, const size_t model_count) {
+    const char *output_path = app->args.output_path;
+    if (output_path != NULL && strcmp(output_path, "-") != 0 &&
+        !frame_writer_path_uses_name(output_path)) {
+        // Each model reopens its output, so without %s every model would overwrite the last
+        fprintf(stderr, "--batch needs %%s in the output path to name each model's files\n");
+        return 1;
+    }
+
+    size_t attempted = 0;
+    size_t failed = 0;
+    char line[BATCH_PATH_MAX];
+    BatchNames names = {0};
+    while (!signals_should_quit()) {
+        const char *model_path = NULL;
+        if (model_count > 0) {
+            if (attempted == model_count) {
+                break;
+            }
+            model_path = model_paths[attempted];
+        } else if (read_batch_line(stdin, line, sizeof(line))) {
+            model_path = line;
+        } else {
+            break;
+        }
+        attempted++;
+
+        // A bad asset is reported and skipped; a rendering failure ends the batch
+        if (!load_scene_model(app, model_path)) {
+            failed++;
+            unload_scene_model(app);
+            continue;
+        }
+        // Models that share a file name, such as a/robot.glb and b/robot.gltf, get
+        // numbered names instead of overwriting each other's files
+        char name[BATCH_PATH_MAX];
+        const bool ok = batch_names_claim(&names, model_path, name, sizeof(name)) &&
+                        render_headless(app, name);
+        unload_scene_model(app);
+        if (!ok) {
+            fprintf(stderr, "Failed to render model: %s\n", model_path);
+            batch_names_free(&names);
+            return 1;
+        }
+    }
+    batch_names_free(&names);
+
+    if (failed > 0) {
+        fprintf(stderr, "%zu of %zu models failed to load\n", failed, attempted);
+        return 1;
+    }
+    return 0;
+}
+
+int app_run_loop(AppContext *app) {
+    if (app->headless != HEADLESS_FORMAT_NONE) {
+        return app_run_headless(app);
+    }
+
+    RenderContext render_ctx;
+    init_render_context(app, &render_ctx);
 
     AnimationContext anim_ctx = {app->bone_matrices, app->has_animations};
 
@@ -550,10 +1595,41 @@ int app_run_loop(AppContext *app) {
     refresh_camera_matrices(&app->camera, view, projection);
 
     double last_frame_time = get_time_seconds();
+    frame_pacer_reset(&app->pacer, last_frame_time);
+    // --latency auto shows the first frames as soon as they are drawn
+    app->last_input_time = last_frame_time;
+    bool frame_needed = true;
+    bool settling = false;
+    uint64_t rendered_generation = 0;
+    const double replay_start = last_frame_time;
+    const float replay_step = 1.0F / (float)app->args.target_fps;
 
     while (!signals_should_quit()) {
-        if (!resize_renderer_if_needed(&app->args, app->output_driver, app->renderer,
-                                       &app->shared_state_mutex, &app->camera, &app->width,
+        if (app->replaying && app->replayed_frames == (uint32_t)app->args.frame_count) {
+            break;
+        }
+        if (!frame_needed && !signals_is_resize_pending()) {
+            // Nothing on screen would change: sleep until input arrives. The input thread
+            // also wakes us for resize and quit requests, which signals cannot.
+            if (change_tracker_wait(&app->scene_changes, rendered_generation,
+                                    IDLE_WAIT_TIMEOUT_MS) == rendered_generation) {
+                continue;
+            }
+            // Resume as if one frame had passed rather than the whole idle period, on a
+            // cadence that starts now.
+            const double now = get_time_seconds();
+            last_frame_time = now - app->target_frame_time;
+            frame_pacer_reset(&app->pacer, now);
+        }
+
+        // Read before sampling the scene so a change made while rendering is not lost. Input,
+        // loaders and reloads all notify it.
+        const uint64_t frame_generation = change_tracker_generation(&app->scene_changes);
+        const bool scene_changed =
+            frame_generation != rendered_generation || signals_is_resize_pending();
+        if (!resize_renderer_if_needed(&app->args, app->output_driver, &app->output_pipeline,
+                                       app->renderer, &app->camera, app->render_scale.scale,
+                                       &app->display_width, &app->display_height, &app->width,
                                        &app->height, view, projection)) {
             const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
             record_fatal_report(&app->fatal_report, "%s",
@@ -562,10 +1638,19 @@ int app_run_loop(AppContext *app) {
             return 1;
         }
 
+        if (!poll_scene_loader(app, &render_ctx, &anim_ctx, base_model_matrix) ||
+            !poll_hot_reload(app, &render_ctx, &anim_ctx)) {
+            return 1;
+        }
+
         double frame_start = get_time_seconds();
         double frame_delta = frame_start - last_frame_time;
         last_frame_time = frame_start;
         float delta_time = (float)frame_delta;
+        if (app->replaying) {
+            // The scene advances by a fixed step however long frames take to render
+            delta_time = app->replayed_frames == 0 ? 0.0F : replay_step;
+        }
         float display_fps = calculate_frame_fps((float)frame_delta);
         vec3 camera_position_snapshot;
         int current_animation_index_snapshot = -1;
@@ -577,10 +1662,13 @@ int app_run_loop(AppContext *app) {
             glm_mat4_mul(rotation_mat, base_model_matrix, render_ctx.model_matrix);
         }
 
-        dcat_mutex_lock(&app->shared_state_mutex);
-        if (app->args.fps_controls) {
-            process_input_devices(&app->key_state, &app->camera, delta_time, &app->move_speed);
+        const double input_start = get_time_seconds();
+        if (app->replaying) {
+            replay_input(app, delta_time);
         }
+        const bool input_active = apply_input(app, delta_time);
+        profile_time(app, FRAME_STAGE_INPUT, get_time_seconds() - input_start);
+        select_latency_mode(app, frame_start, input_active, scene_changed, settling);
         vec3 camera_forward;
         camera_forward_direction(&app->camera, camera_forward);
         glm_vec3_negate(camera_forward);
@@ -588,14 +1676,17 @@ int app_run_loop(AppContext *app) {
         camera_view_matrix(&app->camera, view);
         glm_vec3_copy(app->camera.position, camera_position_snapshot);
         if (app->has_animations) {
-            update_animation(&app->mesh, &app->anim_state, delta_time, app->bone_matrices);
+            advance_animation(app, delta_time);
             current_animation_index_snapshot = app->anim_state.current_animation_index;
         }
-        dcat_mutex_unlock(&app->shared_state_mutex);
 
+        if (!restore_host_data(app)) {
+            return 1;
+        }
         if (!render_frame(&render_ctx, &anim_ctx, &app->mesh, &view, &projection,
-                          app->output_driver, app->args.show_status_bar,
-                          app->args.use_hash_characters, app->width, app->height, display_fps,
+                          app->output_driver, &app->output_pipeline, app->args.show_status_bar,
+                          app->args.use_hash_characters, app->width, app->height,
+                          app->display_width, app->display_height, display_fps,
                           app->move_speed, camera_position_snapshot,
                           current_animation_index_snapshot)) {
             const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
@@ -603,10 +1694,50 @@ int app_run_loop(AppContext *app) {
                                 renderer_error ? renderer_error : "Rendering failed");
             return 1;
         }
+        profile_render(app);
+        release_host_data(app);
 
-        pace_frame(frame_start, app->target_frame_time);
+        if (app->adaptive_resolution && !adapt_render_scale(app, frame_start, view, projection)) {
+            const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
+            record_fatal_report(&app->fatal_report, "%s",
+                                renderer_error ? renderer_error
+                                               : "Failed to resize Vulkan renderer");
+            return 1;
+        }
+
+        rendered_generation = frame_generation;
+        frame_needed = app->replaying || scene_is_animating(app);
+        if (!frame_needed && !refine_settled_frame(app, view, projection, &frame_needed)) {
+            const char *renderer_error = vulkan_renderer_get_last_error(app->renderer);
+            record_fatal_report(&app->fatal_report, "%s",
+                                renderer_error ? renderer_error
+                                               : "Failed to resize Vulkan renderer");
+            return 1;
+        }
+        // Pipelined, the frame just drawn is still in flight: the screen shows one from
+        // MAX_FRAMES_IN_FLIGHT renders earlier, or none after a resize. Before idling, one
+        // more frame in low latency puts the settled scene on screen.
+        settling = !frame_needed && !vulkan_renderer_needs_host_data(app->renderer) &&
+                   vulkan_renderer_get_latency_mode(app->renderer) == VULKAN_LATENCY_PIPELINED;
+        frame_needed = frame_needed || settling;
+
+        if (app->replaying) {
+            // A replay measures how fast frames come, so none waits for its deadline
+            app->replayed_frames++;
+            continue;
+        }
+        const double pace_start = get_time_seconds();
+        const uint32_t missed_deadlines = frame_pacer_wait(&app->pacer);
+        profile_time(app, FRAME_STAGE_PACE, get_time_seconds() - pace_start);
+        if (app->profiling) {
+            frame_profiler_add_missed_deadlines(&app->profiler, missed_deadlines);
+        }
     }
 
+    if (app->replaying) {
+        output_pipeline_flush(&app->output_pipeline);
+        app->replay_seconds = get_time_seconds() - replay_start;
+    }
     return 0;
 }
 
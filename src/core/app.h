@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "args.h"
 
@@ -11,4 +12,8 @@ void app_destroy(AppContext *app);
 // initialize libvips). Takes a copy of *args.
 bool app_init(AppContext *app, const Args *args, const char *prog_name);
 int app_run_loop(AppContext *app);
+// Renders each of `model_paths` headlessly in turn, reusing the renderer; with no paths the
+// list is read from stdin, one per line. Models that fail to load are skipped and make the
+// exit code nonzero.
+int app_run_batch(AppContext *app, char *const *model_paths, size_t model_count);
 void app_cleanup(AppContext *app);
@@ -1,4 +1,5 @@
 #include "args.h"
+#include "core/frame_server.h"
 #include "version.h"
 #include <errno.h>
 #include <float.h>
@@ -10,7 +11,7 @@
 #include <string.h>
 
 void print_usage(void) {
-    printf("Usage: dcat [OPTION]... [MODEL]\n\n"
+    printf("Usage: dcat [OPTION]... [MODEL]...\n\n"
            "  -t, --texture PATH         path to the texture file\n"
            "  -n, --normal-map PATH      path to normal image file\n"
            "      --skydome PATH         path to skydome texture file\n"
@@ -19,8 +20,22 @@ void print_usage(void) {
            "      --camera-distance DIST camera distance from origin\n"
            "      --model-scale SCALE    scale multiplier for the model\n"
            "      --spin SPEED           spin the model at specified speed (rad/s)\n"
+           "      --animation-rate HZ    resample animations to HZ poses per second on load\n"
+           "      --gpu-animation        bake animations on load and pose them on the GPU, at\n"
+           "                             --animation-rate or 30 poses per second\n"
            "  -f, --fps FPS              target frames per second\n"
+           "      --adaptive-resolution  lower the render resolution to hold the target FPS\n"
+           "      --adaptive-output      lower the frame rate and colors when the terminal's link\n"
+           "                             cannot carry full frames, e.g. over SSH\n"
+           "      --progressive          start drawing while the model loads, textures as each\n"
+           "                             one is decoded\n"
+           "      --watch                reload the model and its textures whenever their files\n"
+           "                             change on disk\n"
+           "      --low-memory           free the model's geometry and textures from memory once\n"
+           "                             they are on the GPU\n"
            "      --no-lighting          disable lighting calculations\n"
+           "      --cull-backfaces       skip triangles facing away from the camera; for closed\n"
+           "                             models, whose insides never show\n"
            "      --keyboard-controls    enable first-person camera controls\n"
            "      --mouse-orbit          enable mouse drag to orbit the model\n"
            "      --mouse-sensitivity S  mouse drag sensitivity\n"
@@ -32,6 +47,31 @@ void print_usage(void) {
            "  -P, --palette-characters   enable palette characters mode\n"
            "  -B, --block-characters     enable monochrome block characters mode\n"
            "      --hash-characters      use # for character modes\n"
+           "      --native-characters    use the built-in encoder for truecolor and block modes\n"
+           "      --gpu-cells            build truecolor and block mode cells on the GPU\n"
+           "      --cpu-render           render on the CPU instead of a Vulkan device\n"
+           "      --gpu DEVICE           Vulkan device index or name (default: the one that reads\n"
+           "                             frames back fastest)\n"
+           "      --headless FORMAT      render without a terminal: rgba, png or encoded\n"
+           "  -o, --output PATH          headless output file, '-' for stdout; a %%d in PATH\n"
+           "                             writes one file per frame\n"
+           "      --frames N             number of headless or replayed frames to render\n"
+           "      --turntable            rotate the model a full turn over the headless frames\n"
+           "      --batch                render every MODEL, or one path per line from stdin, on\n"
+           "                             a single device; a %%s in the output PATH is the model\n"
+           "                             name\n"
+           "      --stats-json PATH      on exit, write p50/p95/p99 times of each frame stage\n"
+           "                             and bytes written per frame as JSON, '-' for stdout\n"
+           "      --replay SCRIPT        play the camera motion and events in SCRIPT at a fixed\n"
+           "                             1/FPS step for --frames frames, as fast as they\n"
+           "                             render, then print frame stage times and bytes written\n"
+           "      --latency MODE         low shows each frame as soon as it is drawn; pipelined\n"
+           "                             keeps three frames in flight for throughput; auto, the\n"
+           "                             default, is low while input is arriving\n"
+           "      --serve ADDRESS        also send each frame to every viewer connected to\n"
+           "                             ADDRESS: HOST:PORT, or unix:PATH\n"
+           "      --connect ADDRESS      view the frames a --serve process sends, encoded for\n"
+           "                             this terminal; takes no MODEL\n"
            "  -h, --help                 display help\n"
            "  -V, --version              display version\n"
            "      --controls             display controls\n");
@@ -86,8 +126,16 @@ static const OptionSpec OPTIONS[] = {
     {NULL, "--camera-distance", OPT_FLOAT, offsetof(Args, camera_distance)},
     {NULL, "--model-scale", OPT_FLOAT, offsetof(Args, model_scale)},
     {NULL, "--spin", OPT_FLOAT, offsetof(Args, spin_speed)},
+    {NULL, "--animation-rate", OPT_FLOAT, offsetof(Args, animation_rate)},
+    {NULL, "--gpu-animation", OPT_FLAG, offsetof(Args, gpu_animation)},
     {"-f", "--fps", OPT_INT, offsetof(Args, target_fps)},
+    {NULL, "--adaptive-resolution", OPT_FLAG, offsetof(Args, adaptive_resolution)},
+    {NULL, "--adaptive-output", OPT_FLAG, offsetof(Args, adaptive_output)},
+    {NULL, "--progressive", OPT_FLAG, offsetof(Args, progressive)},
+    {NULL, "--watch", OPT_FLAG, offsetof(Args, watch)},
+    {NULL, "--low-memory", OPT_FLAG, offsetof(Args, low_memory)},
     {NULL, "--no-lighting", OPT_FLAG, offsetof(Args, no_lighting)},
+    {NULL, "--cull-backfaces", OPT_FLAG, offsetof(Args, cull_backfaces)},
     {NULL, "--keyboard-controls", OPT_FLAG, offsetof(Args, fps_controls)},
     {NULL, "--mouse-orbit", OPT_FLAG, offsetof(Args, mouse_orbit)},
     {NULL, "--mouse-sensitivity", OPT_FLOAT, offsetof(Args, mouse_sensitivity)},
@@ -99,6 +147,20 @@ static const OptionSpec OPTIONS[] = {
     {"-P", "--palette-characters", OPT_FLAG, offsetof(Args, use_palette_characters)},
     {"-B", "--block-characters", OPT_FLAG, offsetof(Args, use_block_characters)},
     {NULL, "--hash-characters", OPT_FLAG, offsetof(Args, use_hash_characters)},
+    {NULL, "--native-characters", OPT_FLAG, offsetof(Args, use_native_characters)},
+    {NULL, "--gpu-cells", OPT_FLAG, offsetof(Args, use_gpu_cells)},
+    {NULL, "--cpu-render", OPT_FLAG, offsetof(Args, cpu_render)},
+    {NULL, "--gpu", OPT_STRING, offsetof(Args, gpu_device)},
+    {NULL, "--headless", OPT_STRING, offsetof(Args, headless_format)},
+    {"-o", "--output", OPT_STRING, offsetof(Args, output_path)},
+    {NULL, "--frames", OPT_INT, offsetof(Args, frame_count)},
+    {NULL, "--turntable", OPT_FLAG, offsetof(Args, turntable)},
+    {NULL, "--batch", OPT_FLAG, offsetof(Args, batch)},
+    {NULL, "--stats-json", OPT_STRING, offsetof(Args, stats_path)},
+    {NULL, "--replay", OPT_STRING, offsetof(Args, replay_path)},
+    {NULL, "--latency", OPT_STRING, offsetof(Args, latency_mode)},
+    {NULL, "--serve", OPT_STRING, offsetof(Args, serve_address)},
+    {NULL, "--connect", OPT_STRING, offsetof(Args, connect_address)},
     {"-h", "--help", OPT_FLAG, offsetof(Args, show_help)},
     {"-V", "--version", OPT_FLAG, offsetof(Args, show_version)},
     {NULL, "--controls", OPT_FLAG, offsetof(Args, show_controls)}};
@@ -181,6 +243,7 @@ ArgsParseStatus parse_args(const int argc, char *argv[], Args *out) {
     out->model_scale = 1.0F;
     out->mouse_sensitivity = 0.02F;
     out->target_fps = 60;
+    out->frame_count = 1;
 
     for (int i = 1; i < argc; i++) {
         char *arg = argv[i];
@@ -223,8 +286,33 @@ ArgsParseStatus parse_args(const int argc, char *argv[], Args *out) {
     return ARGS_PARSE_OK;
 }
 
+size_t args_model_paths(const int argc, char *argv[], char **out) {
+    size_t count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            out[count++] = argv[i];
+            continue;
+        }
+        // parse_args already rejected unknown options and missing values
+        const OptionSpec *spec = find_option(argv[i]);
+        if (spec != NULL && spec->type != OPT_FLAG) {
+            i++;
+        }
+    }
+    return count;
+}
+
 bool validate_args(const Args *args) {
-    if (!args->model_path) {
+    // A viewer renders nothing. A batch without MODEL arguments reads its model list from
+    // stdin.
+    if (args->connect_address) {
+        if (args->model_path || args->serve_address || args->headless_format || args->batch ||
+            args->replay_path) {
+            fprintf(stderr, "--connect takes no MODEL and cannot be used with --serve, "
+                            "--headless, --batch or --replay\n");
+            return false;
+        }
+    } else if (!args->model_path && !args->batch) {
         fprintf(stderr, "Error: No model file specified\n");
         print_usage();
         return false;
@@ -264,6 +352,12 @@ bool validate_args(const Args *args) {
         return false;
     }
 
+    if (args->animation_rate < 0) {
+        fprintf(stderr, "Invalid animation rate: %f (must be 0 or greater)\n",
+                args->animation_rate);
+        return false;
+    }
+
     // The six render-mode flags each select one output driver; enabling more than one
     // leaves the choice to driver_factory precedence, which is almost certainly not
     // what the user meant.
@@ -277,5 +371,82 @@ bool validate_args(const Args *args) {
         return false;
     }
 
+    const HeadlessFormat headless = args_headless_format(args);
+    if (headless == HEADLESS_FORMAT_INVALID) {
+        fprintf(stderr, "Invalid headless format: %s (must be rgba, png or encoded)\n",
+                args->headless_format);
+        return false;
+    }
+
+    if ((headless != HEADLESS_FORMAT_NONE || args->replay_path) && args->frame_count <= 0) {
+        fprintf(stderr, "Invalid frame count: %d (must be greater than 0)\n", args->frame_count);
+        return false;
+    }
+
+    if (headless != HEADLESS_FORMAT_NONE) {
+        // Kitty shm frames are names of shared memory segments, meaningless in a file
+        if (headless == HEADLESS_FORMAT_ENCODED && args->use_kitty_shm) {
+            fprintf(stderr, "--kitty cannot be used with --headless encoded; use "
+                            "--kitty-direct\n");
+            return false;
+        }
+    } else if (args->output_path || args->turntable || args->batch) {
+        fprintf(stderr, "--output, --turntable and --batch require --headless\n");
+        return false;
+    }
+
+    if (args->replay_path && args->batch) {
+        fprintf(stderr, "--replay cannot be used with --batch\n");
+        return false;
+    }
+
+    if (args->serve_address && headless != HEADLESS_FORMAT_NONE) {
+        fprintf(stderr, "--serve cannot be used with --headless\n");
+        return false;
+    }
+
+    // Viewers refuse frames this large, so serving them would only show nothing
+    if (args->serve_address && args->width != -1 && args->height != -1 &&
+        (uint64_t)args->width * (uint64_t)args->height > FRAME_STREAM_MAX_PIXELS) {
+        fprintf(stderr, "--serve frames can have at most %u pixels (-W %d -H %d)\n",
+                FRAME_STREAM_MAX_PIXELS, args->width, args->height);
+        return false;
+    }
+
+    if (args_latency_mode(args) == LATENCY_MODE_INVALID) {
+        fprintf(stderr, "Invalid latency mode: %s (must be low, pipelined or auto)\n",
+                args->latency_mode);
+        return false;
+    }
+
     return true;
 }
+
+HeadlessFormat args_headless_format(const Args *args) {
+    if (!args->headless_format) {
+        return HEADLESS_FORMAT_NONE;
+    }
+    if (strcmp(args->headless_format, "rgba") == 0) {
+        return HEADLESS_FORMAT_RGBA;
+    }
+    if (strcmp(args->headless_format, "png") == 0) {
+        return HEADLESS_FORMAT_PNG;
+    }
+    if (strcmp(args->headless_format, "encoded") == 0) {
+        return HEADLESS_FORMAT_ENCODED;
+    }
+    return HEADLESS_FORMAT_INVALID;
+}
+
+LatencyMode args_latency_mode(const Args *args) {
+    if (!args->latency_mode || strcmp(args->latency_mode, "auto") == 0) {
+        return LATENCY_MODE_AUTO;
+    }
+    if (strcmp(args->latency_mode, "low") == 0) {
+        return LATENCY_MODE_LOW;
+    }
+    if (strcmp(args->latency_mode, "pipelined") == 0) {
+        return LATENCY_MODE_PIPELINED;
+    }
+    return LATENCY_MODE_INVALID;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef struct Args {
     char *model_path;
@@ -11,8 +12,23 @@ typedef struct Args {
     float camera_distance;
     float model_scale;
     float spin_speed;
+    // Resample animations to this many poses per second at load; 0 samples the keys
+    float animation_rate;
+    // Bake animations at load and pose them in the vertex shader
+    bool gpu_animation;
     int target_fps;
+    bool adaptive_resolution;
+    // Pace and cheapen terminal output to what the link to the terminal carries
+    bool adaptive_output;
+    // Show the model as soon as its geometry is in, before its textures are
+    bool progressive;
+    // Reload the model and its textures when their files change
+    bool watch;
+    // Free CPU-side geometry and pixels once they are uploaded
+    bool low_memory;
     bool no_lighting;
+    // Skip triangles facing away from the camera; only right for closed meshes
+    bool cull_backfaces;
     bool fps_controls;
     bool mouse_orbit;
     float mouse_sensitivity;
@@ -27,8 +43,50 @@ typedef struct Args {
     bool use_palette_characters;
     bool use_block_characters;
     bool use_hash_characters;
+    bool use_native_characters;
+    bool use_gpu_cells;
+    // Render with the built-in CPU rasterizer instead of a Vulkan device
+    bool cpu_render;
+    // Vulkan device to render on, by index or part of its name; NULL picks the fastest
+    char *gpu_device;
+    // Headless batch rendering: no terminal session, input thread or frame pacing
+    char *headless_format;
+    char *output_path;
+    int frame_count;
+    bool turntable;
+    // Render every MODEL argument (or stdin's list) in one process, one device
+    bool batch;
+    // Where per-stage frame timing percentiles are written as JSON on exit
+    char *stats_path;
+    // Script of camera motion and events to replay at a fixed timestep for frame_count frames
+    char *replay_path;
+    // Which frame the GPU renderer returns: low, pipelined or auto (the default)
+    char *latency_mode;
+    // Also stream every rendered frame to viewers that connect to this address
+    char *serve_address;
+    // Show the frames a --serve process streams to this address instead of rendering
+    char *connect_address;
 } Args;
 
+typedef enum HeadlessFormat {
+    HEADLESS_FORMAT_NONE,
+    HEADLESS_FORMAT_RGBA,
+    HEADLESS_FORMAT_PNG,
+    // Whatever the selected output mode writes to a terminal (sixel, chafa symbols, ...)
+    HEADLESS_FORMAT_ENCODED,
+    HEADLESS_FORMAT_INVALID,
+} HeadlessFormat;
+
+typedef enum LatencyMode {
+    // Low latency while input is arriving, pipelined otherwise
+    LATENCY_MODE_AUTO,
+    // Wait for each frame and show it: one frame from input to screen
+    LATENCY_MODE_LOW,
+    // Show the frame submitted MAX_FRAMES_IN_FLIGHT frames earlier, for throughput
+    LATENCY_MODE_PIPELINED,
+    LATENCY_MODE_INVALID,
+} LatencyMode;
+
 // Result of parsing the command line. The caller decides the process exit code,
 // so parse_args never calls exit() itself.
 typedef enum ArgsParseStatus {
@@ -41,6 +99,10 @@ typedef enum ArgsParseStatus {
 
 ArgsParseStatus parse_args(int argc, char *argv[], Args *out);
 
+// Collects every MODEL argument, in order, of a command line parse_args accepted. `out`
+// needs room for argc entries; returns how many were stored.
+size_t args_model_paths(int argc, char *argv[], char **out);
+
 void print_usage(void);
 
 void print_version(void);
@@ -49,3 +111,7 @@ void print_controls(void);
 
 // Validate parsed arguments
 bool validate_args(const Args *args);
+
+HeadlessFormat args_headless_format(const Args *args);
+
+LatencyMode args_latency_mode(const Args *args);
@@ -0,0 +1,32 @@
+#include "core/background_task.h"
+
+#ifdef _WIN32
+static unsigned __stdcall background_task_thread_func(void *arg) {
+#else
+static void *background_task_thread_func(void *arg) {
+#endif
+    BackgroundTask *task = arg;
+    task->func(task->context);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+void background_task_start(BackgroundTask *task, const BackgroundTaskFunc func, void *context) {
+    task->func = func;
+    task->context = context;
+    task->started = dcat_thread_create(&task->thread, background_task_thread_func, task);
+    if (!task->started) {
+        func(context);
+    }
+}
+
+void background_task_join(BackgroundTask *task) {
+    if (task->started) {
+        dcat_thread_join(task->thread);
+        task->started = false;
+    }
+}
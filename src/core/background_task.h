@@ -0,0 +1,23 @@
+#pragma once
+#include "core/threading.h"
+
+#include <stdbool.h>
+
+typedef void (*BackgroundTaskFunc)(void *context);
+
+// One function run on a thread of its own, so that it overlaps whatever the caller does
+// until it joins for the result. Only the task touches what `context` gives it until then.
+typedef struct BackgroundTask {
+    BackgroundTaskFunc func;
+    void *context;
+    DcatThread thread;
+    bool started;
+} BackgroundTask;
+
+// Starts func(context) on a new thread. When no thread can be created it runs right away
+// on the caller's, so the result is there at the join all the same.
+void background_task_start(BackgroundTask *task, BackgroundTaskFunc func, void *context);
+
+// Returns once the task has finished. Safe to call again, and on a zeroed task that was
+// never started.
+void background_task_join(BackgroundTask *task);
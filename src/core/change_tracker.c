@@ -0,0 +1,53 @@
+#include "core/change_tracker.h"
+
+#include <string.h>
+
+bool change_tracker_init(ChangeTracker *tracker) {
+    memset(tracker, 0, sizeof(*tracker));
+    if (!dcat_mutex_init(&tracker->mutex)) {
+        return false;
+    }
+    if (!dcat_cond_init(&tracker->cond)) {
+        dcat_mutex_destroy(&tracker->mutex);
+        return false;
+    }
+    tracker->initialized = true;
+    return true;
+}
+
+void change_tracker_destroy(ChangeTracker *tracker) {
+    if (!tracker->initialized) {
+        return;
+    }
+    dcat_cond_destroy(&tracker->cond);
+    dcat_mutex_destroy(&tracker->mutex);
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+void change_tracker_notify(ChangeTracker *tracker) {
+    if (!tracker || !tracker->initialized) {
+        return;
+    }
+    dcat_mutex_lock(&tracker->mutex);
+    tracker->generation++;
+    dcat_cond_signal(&tracker->cond);
+    dcat_mutex_unlock(&tracker->mutex);
+}
+
+uint64_t change_tracker_generation(ChangeTracker *tracker) {
+    dcat_mutex_lock(&tracker->mutex);
+    const uint64_t generation = tracker->generation;
+    dcat_mutex_unlock(&tracker->mutex);
+    return generation;
+}
+
+uint64_t change_tracker_wait(ChangeTracker *tracker, const uint64_t seen,
+                             const unsigned int timeout_ms) {
+    dcat_mutex_lock(&tracker->mutex);
+    if (tracker->generation == seen) {
+        dcat_cond_timed_wait(&tracker->cond, &tracker->mutex, timeout_ms);
+    }
+    const uint64_t generation = tracker->generation;
+    dcat_mutex_unlock(&tracker->mutex);
+    return generation;
+}
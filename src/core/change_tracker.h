@@ -0,0 +1,23 @@
+#pragma once
+#include "core/threading.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Counts changes to anything that affects the rendered image, so the render loop can
+// tell an unchanged scene apart and sleep until the next change.
+typedef struct ChangeTracker {
+    DcatMutex mutex;
+    DcatCond cond;
+    uint64_t generation;
+    bool initialized;
+} ChangeTracker;
+
+bool change_tracker_init(ChangeTracker *tracker);
+void change_tracker_destroy(ChangeTracker *tracker);
+void change_tracker_notify(ChangeTracker *tracker);
+uint64_t change_tracker_generation(ChangeTracker *tracker);
+// Blocks until the generation moves past `seen` or timeout_ms elapses, and returns the
+// current generation. Signals cannot wake a condition variable, so callers that also
+// react to signal flags should keep the timeout short.
+uint64_t change_tracker_wait(ChangeTracker *tracker, uint64_t seen, unsigned int timeout_ms);
@@ -0,0 +1,104 @@
+#include "core/frame_pacer.h"
+#include "core/time_utils.h"
+
+#include <errno.h>
+#include <math.h>
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+void frame_pacer_init(FramePacer *pacer, const double period) {
+    pacer->period = period > 0.0 ? period : 0.0;
+    pacer->next_deadline = 0.0;
+    pacer->missed_deadlines = 0;
+#ifdef _WIN32
+    // High-resolution timers need Windows 10 1803; older ones round to the timer tick
+    pacer->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                          TIMER_ALL_ACCESS);
+    if (!pacer->timer) {
+        pacer->timer = CreateWaitableTimerW(NULL, TRUE, NULL);
+    }
+#endif
+}
+
+void frame_pacer_destroy(FramePacer *pacer) {
+#ifdef _WIN32
+    if (pacer->timer) {
+        CloseHandle(pacer->timer);
+        pacer->timer = NULL;
+    }
+#else
+    (void)pacer;
+#endif
+}
+
+void frame_pacer_reset(FramePacer *pacer, const double now) {
+    pacer->next_deadline = now + pacer->period;
+}
+
+uint32_t frame_pacer_schedule(FramePacer *pacer, const double now, double *deadline) {
+    *deadline = now;
+    if (pacer->period <= 0.0) {
+        return 0;
+    }
+    if (pacer->next_deadline <= 0.0) {
+        frame_pacer_reset(pacer, now);
+        return 0;
+    }
+
+    const double due = pacer->next_deadline;
+    if (now < due) {
+        *deadline = due;
+        pacer->next_deadline = due + pacer->period;
+        return 0;
+    }
+    const double behind = floor((now - due) / pacer->period);
+    pacer->next_deadline = due + ((behind + 1.0) * pacer->period);
+    const uint32_t missed = behind < (double)(UINT32_MAX - 1U) ? (uint32_t)behind + 1U
+                                                               : UINT32_MAX;
+    pacer->missed_deadlines += missed;
+    return missed;
+}
+
+static void sleep_until(const FramePacer *pacer, const double deadline) {
+#ifdef _WIN32
+    const double remaining = deadline - get_time_seconds();
+    if (remaining <= 0.0) {
+        return;
+    }
+    if (pacer->timer) {
+        // Relative, in 100 ns units; the deadline itself stays absolute on the QPC clock
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(remaining * 1e7);
+        if (SetWaitableTimer(pacer->timer, &due, 0, NULL, NULL, FALSE)) {
+            WaitForSingleObject(pacer->timer, INFINITE);
+            return;
+        }
+    }
+    Sleep((DWORD)(remaining * 1000.0));
+#else
+    (void)pacer;
+    // get_time_seconds reads CLOCK_MONOTONIC, so the deadline is already on its timeline
+    struct timespec wake;
+    wake.tv_sec = (time_t)deadline;
+    wake.tv_nsec = (long)((deadline - (double)wake.tv_sec) * 1e9);
+    if (wake.tv_nsec >= 1000000000L) {
+        wake.tv_sec++;
+        wake.tv_nsec -= 1000000000L;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR) {
+    }
+#endif
+}
+
+uint32_t frame_pacer_wait(FramePacer *pacer) {
+    double deadline = 0.0;
+    const uint32_t missed = frame_pacer_schedule(pacer, get_time_seconds(), &deadline);
+    if (missed == 0) {
+        sleep_until(pacer, deadline);
+    }
+    return missed;
+}
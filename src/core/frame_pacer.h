@@ -0,0 +1,29 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Holds the render loop to a fixed cadence: frame n ends at start + n * period. Sleeps run to
+// absolute deadlines, so time spent rendering or waking late never adds up. A frame that
+// overruns its deadline skips the ones it missed rather than pushing every later frame back.
+typedef struct FramePacer {
+    double period;        // seconds; 0 paces nothing
+    double next_deadline; // on the get_time_seconds clock; 0 until the cadence starts
+    uint64_t missed_deadlines;
+#ifdef _WIN32
+    void *timer; // high-resolution waitable timer, or NULL to sleep in milliseconds
+#endif
+} FramePacer;
+
+void frame_pacer_init(FramePacer *pacer, double period);
+void frame_pacer_destroy(FramePacer *pacer);
+
+// Starts the cadence over from `now`, e.g. after idling
+void frame_pacer_reset(FramePacer *pacer, double now);
+
+// Moves to the deadline of the frame ending at `now` and returns how many deadlines it missed:
+// 0 when `now` is before it, and the caller should sleep until *deadline. Otherwise the next
+// frame starts at once and is due at the first deadline after `now`.
+uint32_t frame_pacer_schedule(FramePacer *pacer, double now, double *deadline);
+
+// Ends a frame: schedules it and sleeps until its deadline. Returns the deadlines missed.
+uint32_t frame_pacer_wait(FramePacer *pacer);
@@ -0,0 +1,140 @@
+#include "core/frame_profiler.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char *const STAGE_NAMES[FRAME_STAGE_COUNT] = {
+    "input",      "animation",   "fence_wait", "record",    "encode",       "write",
+    "pace_sleep", "gpu_skydome", "gpu_opaque", "gpu_blend", "gpu_readback",
+};
+
+static uint32_t bucket_index(const uint64_t value) {
+    if (value < PROFILE_HISTOGRAM_SUB_BUCKETS) {
+        return (uint32_t)value;
+    }
+    uint32_t shift = 0;
+    while ((value >> shift) >= 2U * PROFILE_HISTOGRAM_SUB_BUCKETS) {
+        shift++;
+    }
+    // value >> shift is in [SUB, 2 * SUB): its low bits pick the sub-bucket
+    const uint64_t index = ((uint64_t)(shift + 1U) * PROFILE_HISTOGRAM_SUB_BUCKETS) +
+                           ((value >> shift) - PROFILE_HISTOGRAM_SUB_BUCKETS);
+    return index < PROFILE_HISTOGRAM_BUCKETS ? (uint32_t)index : PROFILE_HISTOGRAM_BUCKETS - 1U;
+}
+
+static uint64_t bucket_midpoint(const uint32_t index) {
+    if (index < PROFILE_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+    const uint32_t shift = (index - PROFILE_HISTOGRAM_SUB_BUCKETS) / PROFILE_HISTOGRAM_SUB_BUCKETS;
+    const uint64_t sub = (index - PROFILE_HISTOGRAM_SUB_BUCKETS) % PROFILE_HISTOGRAM_SUB_BUCKETS;
+    const uint64_t lower = (PROFILE_HISTOGRAM_SUB_BUCKETS + sub) << shift;
+    return lower + ((UINT64_C(1) << shift) / 2U);
+}
+
+void profile_histogram_add(ProfileHistogram *histogram, const uint64_t value) {
+    histogram->buckets[bucket_index(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+uint64_t profile_histogram_percentile(const ProfileHistogram *histogram, const double fraction) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)ceil(fraction * (double)histogram->count);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank >= histogram->count) {
+        return histogram->max;
+    }
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            const uint64_t value = bucket_midpoint(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void frame_profiler_init(FrameProfiler *profiler) {
+    memset(profiler, 0, sizeof(*profiler));
+}
+
+void frame_profiler_add_time(FrameProfiler *profiler, const FrameStage stage,
+                             const double seconds) {
+    const double microseconds = seconds * 1e6;
+    profile_histogram_add(&profiler->stages[stage],
+                          microseconds > 0.0 ? (uint64_t)(microseconds + 0.5) : 0U);
+}
+
+void frame_profiler_add_bytes(FrameProfiler *profiler, const uint64_t bytes) {
+    profile_histogram_add(&profiler->bytes_written, bytes);
+}
+
+void frame_profiler_add_missed_deadlines(FrameProfiler *profiler, const uint32_t count) {
+    profiler->missed_deadlines += count;
+}
+
+// Histogram summary; `scale` converts the stored unit to the reported one
+static void write_summary(FILE *stream, const ProfileHistogram *histogram, const char *suffix,
+                          const double scale) {
+    const double mean =
+        histogram->count > 0 ? (double)histogram->sum / (double)histogram->count : 0.0;
+    fprintf(stream,
+            "{\"count\": %llu, \"mean%s\": %.3f, \"p50%s\": %.3f, \"p95%s\": %.3f, "
+            "\"p99%s\": %.3f, \"max%s\": %.3f}",
+            (unsigned long long)histogram->count, suffix, mean * scale, suffix,
+            (double)profile_histogram_percentile(histogram, 0.50) * scale, suffix,
+            (double)profile_histogram_percentile(histogram, 0.95) * scale, suffix,
+            (double)profile_histogram_percentile(histogram, 0.99) * scale, suffix,
+            (double)histogram->max * scale);
+}
+
+bool frame_profiler_write_json(const FrameProfiler *profiler, FILE *stream) {
+    fprintf(stream, "{\n  \"stages\": {\n");
+    for (uint32_t i = 0; i < FRAME_STAGE_COUNT; i++) {
+        fprintf(stream, "    \"%s\": ", STAGE_NAMES[i]);
+        write_summary(stream, &profiler->stages[i], "_ms", 1e-3);
+        fprintf(stream, "%s\n", i + 1 < FRAME_STAGE_COUNT ? "," : "");
+    }
+    fprintf(stream, "  },\n  \"bytes_per_frame\": ");
+    write_summary(stream, &profiler->bytes_written, "", 1.0);
+    fprintf(stream, ",\n  \"missed_deadlines\": %llu\n}\n",
+            (unsigned long long)profiler->missed_deadlines);
+    return fflush(stream) == 0 && !ferror(stream);
+}
+
+// One table row: count, mean, p50, p95, p99 and max, scaled like write_summary
+static void write_report_row(FILE *stream, const char *name, const ProfileHistogram *histogram,
+                             const double scale) {
+    const double mean =
+        histogram->count > 0 ? (double)histogram->sum / (double)histogram->count : 0.0;
+    fprintf(stream, "%-16s %8llu %12.3f %12.3f %12.3f %12.3f %12.3f\n", name,
+            (unsigned long long)histogram->count, mean * scale,
+            (double)profile_histogram_percentile(histogram, 0.50) * scale,
+            (double)profile_histogram_percentile(histogram, 0.95) * scale,
+            (double)profile_histogram_percentile(histogram, 0.99) * scale,
+            (double)histogram->max * scale);
+}
+
+bool frame_profiler_write_report(const FrameProfiler *profiler, FILE *stream) {
+    fprintf(stream, "%-16s %8s %12s %12s %12s %12s %12s\n", "stage (ms)", "frames", "mean", "p50",
+            "p95", "p99", "max");
+    for (uint32_t i = 0; i < FRAME_STAGE_COUNT; i++) {
+        if (profiler->stages[i].count > 0) {
+            write_report_row(stream, STAGE_NAMES[i], &profiler->stages[i], 1e-3);
+        }
+    }
+    write_report_row(stream, "bytes_per_frame", &profiler->bytes_written, 1.0);
+    fprintf(stream, "bytes written: %llu\nmissed deadlines: %llu\n",
+            (unsigned long long)profiler->bytes_written.sum,
+            (unsigned long long)profiler->missed_deadlines);
+    return fflush(stream) == 0 && !ferror(stream);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Values below 8 get a bucket each; above that every power of two is split into 8 buckets,
+// so a percentile is within 1/8 of the true value. 256 buckets reach past 2^34.
+#define PROFILE_HISTOGRAM_SUB_BUCKETS 8U
+#define PROFILE_HISTOGRAM_BUCKETS 256U
+
+// Fixed-size log-linear histogram of non-negative integers (microseconds, bytes)
+typedef struct ProfileHistogram {
+    uint32_t buckets[PROFILE_HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+} ProfileHistogram;
+
+void profile_histogram_add(ProfileHistogram *histogram, uint64_t value);
+// The value below which `fraction` (0..1) of the samples fall, to bucket precision: the
+// midpoint of the bucket holding that rank, capped at the largest sample, which is exact
+// for the top rank. 0 when empty.
+uint64_t profile_histogram_percentile(const ProfileHistogram *histogram, double fraction);
+
+// Per-frame stages of the render loop, in the order a frame runs them
+typedef enum FrameStage {
+    FRAME_STAGE_INPUT,       // applying what the input thread published
+    FRAME_STAGE_ANIMATION,   // update_animation
+    FRAME_STAGE_FENCE_WAIT,  // waiting for the frame slot's fence
+    FRAME_STAGE_RECORD,      // recording and submitting, or rasterizing on the CPU backend
+    FRAME_STAGE_ENCODE,      // the output driver turning the frame into terminal output
+    FRAME_STAGE_WRITE,       // flushing that output to the terminal
+    FRAME_STAGE_PACE,        // sleeping until the next frame is due
+    FRAME_STAGE_GPU_SKYDOME, // GPU stages, from the renderer's timestamp queries
+    FRAME_STAGE_GPU_OPAQUE,
+    FRAME_STAGE_GPU_BLEND,
+    FRAME_STAGE_GPU_READBACK,
+    FRAME_STAGE_COUNT,
+} FrameStage;
+
+// Stage durations and output size of every frame. Each histogram has a single writer, so
+// the render loop and the output thread record without locking; read it once both stop.
+typedef struct FrameProfiler {
+    ProfileHistogram stages[FRAME_STAGE_COUNT];
+    ProfileHistogram bytes_written;
+    uint64_t missed_deadlines; // frame deadlines the pacer could not meet
+} FrameProfiler;
+
+void frame_profiler_init(FrameProfiler *profiler);
+void frame_profiler_add_time(FrameProfiler *profiler, FrameStage stage, double seconds);
+void frame_profiler_add_bytes(FrameProfiler *profiler, uint64_t bytes);
+void frame_profiler_add_missed_deadlines(FrameProfiler *profiler, uint32_t count);
+// Writes count, mean, p50, p95, p99 and max of every stage (milliseconds) and of the bytes
+// written per frame, and the missed deadlines, as one JSON object.
+bool frame_profiler_write_json(const FrameProfiler *profiler, FILE *stream);
+// The same as a table for people, leaving out stages no frame went through.
+bool frame_profiler_write_report(const FrameProfiler *profiler, FILE *stream);
@@ -0,0 +1,267 @@
+#include "core/frame_server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How often the accept thread looks for a stop request between connections
+#define ACCEPT_POLL_MS 100U
+
+static void write_u32_le(uint8_t *out, const uint32_t value) {
+    out[0] = (uint8_t)(value & 0xFFU);
+    out[1] = (uint8_t)((value >> 8) & 0xFFU);
+    out[2] = (uint8_t)((value >> 16) & 0xFFU);
+    out[3] = (uint8_t)((value >> 24) & 0xFFU);
+}
+
+static uint32_t read_u32_le(const uint8_t *in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+void frame_stream_encode_header(const uint32_t width, const uint32_t height,
+                                uint8_t out[FRAME_STREAM_HEADER_BYTES]) {
+    memcpy(out, FRAME_STREAM_MAGIC, 4);
+    write_u32_le(out + 4, width);
+    write_u32_le(out + 8, height);
+}
+
+bool frame_stream_decode_header(const uint8_t header[FRAME_STREAM_HEADER_BYTES],
+                                uint32_t *width, uint32_t *height) {
+    if (memcmp(header, FRAME_STREAM_MAGIC, 4) != 0) {
+        return false;
+    }
+    *width = read_u32_le(header + 4);
+    *height = read_u32_le(header + 8);
+    return *width > 0 && *height > 0 && *width <= FRAME_STREAM_MAX_SIDE &&
+           *height <= FRAME_STREAM_MAX_SIDE &&
+           (uint64_t)*width * *height <= FRAME_STREAM_MAX_PIXELS;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall client_thread_func(void *arg) {
+#else
+static void *client_thread_func(void *arg) {
+#endif
+    FrameServerClient *client = arg;
+    FrameServer *server = client->server;
+    uint64_t sent_generation = 0;
+
+    dcat_mutex_lock(&server->mutex);
+    for (;;) {
+        while (!server->stopping &&
+               (server->latest < 0 || server->generation == sent_generation)) {
+            dcat_cond_wait(&server->cond, &server->mutex);
+        }
+        if (server->stopping) {
+            break;
+        }
+        FrameServerFrame *frame = &server->frames[server->latest];
+        frame->readers++;
+        sent_generation = server->generation;
+        dcat_mutex_unlock(&server->mutex);
+
+        const bool sent = dcat_net_send_all(client->socket, frame->data, frame->size);
+
+        dcat_mutex_lock(&server->mutex);
+        frame->readers--;
+        if (!sent) {
+            break;
+        }
+    }
+    client->finished = true;
+    dcat_mutex_unlock(&server->mutex);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// Joins the threads of viewers that disconnected, freeing their slots. Called with the
+// mutex held.
+static void reap_finished_clients(FrameServer *server) {
+    for (uint32_t i = 0; i < FRAME_SERVER_MAX_CLIENTS; i++) {
+        FrameServerClient *client = &server->clients[i];
+        if (client->active && client->finished) {
+            dcat_thread_join(client->thread);
+            dcat_net_close(client->socket);
+            client->active = false;
+        }
+    }
+}
+
+static void add_client(FrameServer *server, const DcatSocket socket) {
+    dcat_mutex_lock(&server->mutex);
+    reap_finished_clients(server);
+    FrameServerClient *client = NULL;
+    for (uint32_t i = 0; i < FRAME_SERVER_MAX_CLIENTS && !client; i++) {
+        if (!server->clients[i].active) {
+            client = &server->clients[i];
+        }
+    }
+    if (client) {
+        *client = (FrameServerClient){.server = server, .socket = socket};
+        client->active = dcat_thread_create(&client->thread, client_thread_func, client);
+    }
+    dcat_mutex_unlock(&server->mutex);
+
+    if (!client || !client->active) {
+        dcat_net_close(socket);
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall accept_thread_func(void *arg) {
+#else
+static void *accept_thread_func(void *arg) {
+#endif
+    FrameServer *server = arg;
+
+    for (;;) {
+        dcat_mutex_lock(&server->mutex);
+        const bool stopping = server->stopping;
+        dcat_mutex_unlock(&server->mutex);
+        if (stopping) {
+            break;
+        }
+        const int ready = dcat_net_wait_readable(server->listener, ACCEPT_POLL_MS);
+        if (ready < 0) {
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+        const DcatSocket socket = dcat_net_accept(server->listener);
+        if (socket != DCAT_INVALID_SOCKET) {
+            add_client(server, socket);
+        }
+    }
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool frame_server_start(FrameServer *server, const char *address) {
+    memset(server, 0, sizeof(*server));
+    server->address = address;
+    server->latest = -1;
+    server->listener = dcat_net_listen(address);
+    if (server->listener == DCAT_INVALID_SOCKET) {
+        return false;
+    }
+    if (!dcat_mutex_init(&server->mutex)) {
+        dcat_net_close(server->listener);
+        return false;
+    }
+    if (!dcat_cond_init(&server->cond)) {
+        dcat_mutex_destroy(&server->mutex);
+        dcat_net_close(server->listener);
+        return false;
+    }
+    if (!dcat_thread_create(&server->accept_thread, accept_thread_func, server)) {
+        fprintf(stderr, "Failed to start frame server thread\n");
+        dcat_cond_destroy(&server->cond);
+        dcat_mutex_destroy(&server->mutex);
+        dcat_net_close(server->listener);
+        return false;
+    }
+    server->started = true;
+    return true;
+}
+
+void frame_server_stop(FrameServer *server) {
+    if (!server->started) {
+        return;
+    }
+
+    dcat_mutex_lock(&server->mutex);
+    server->stopping = true;
+    dcat_cond_broadcast(&server->cond);
+    // Wakes client threads blocked sending to a viewer that stopped reading
+    for (uint32_t i = 0; i < FRAME_SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].active) {
+            dcat_net_shutdown(server->clients[i].socket);
+        }
+    }
+    dcat_mutex_unlock(&server->mutex);
+
+    dcat_thread_join(server->accept_thread);
+    for (uint32_t i = 0; i < FRAME_SERVER_MAX_CLIENTS; i++) {
+        FrameServerClient *client = &server->clients[i];
+        if (client->active) {
+            dcat_thread_join(client->thread);
+            dcat_net_close(client->socket);
+            client->active = false;
+        }
+    }
+    dcat_net_close(server->listener);
+    dcat_net_release_address(server->address);
+
+    for (uint32_t i = 0; i < FRAME_SERVER_FRAME_COUNT; i++) {
+        free(server->frames[i].data);
+    }
+    dcat_cond_destroy(&server->cond);
+    dcat_mutex_destroy(&server->mutex);
+    server->started = false;
+}
+
+bool frame_server_publish(FrameServer *server, const uint8_t *pixels, const uint32_t width,
+                          const uint32_t height) {
+    // Only client threads take frames, and only the latest, so a free frame stays free
+    // while it is filled outside the lock.
+    dcat_mutex_lock(&server->mutex);
+    FrameServerFrame *frame = NULL;
+    int index = 0;
+    for (; index < (int)FRAME_SERVER_FRAME_COUNT; index++) {
+        if (index != server->latest && server->frames[index].readers == 0) {
+            frame = &server->frames[index];
+            break;
+        }
+    }
+    dcat_mutex_unlock(&server->mutex);
+    if (!frame) {
+        return false;
+    }
+
+    const size_t pixel_bytes = (size_t)width * height * 4U;
+    const size_t size = FRAME_STREAM_HEADER_BYTES + pixel_bytes;
+    if (frame->capacity < size) {
+        uint8_t *data = realloc(frame->data, size);
+        if (!data) {
+            return false;
+        }
+        frame->data = data;
+        frame->capacity = size;
+    }
+    frame_stream_encode_header(width, height, frame->data);
+    memcpy(frame->data + FRAME_STREAM_HEADER_BYTES, pixels, pixel_bytes);
+    frame->size = size;
+
+    dcat_mutex_lock(&server->mutex);
+    server->latest = index;
+    server->generation++;
+    dcat_cond_broadcast(&server->cond);
+    dcat_mutex_unlock(&server->mutex);
+    return true;
+}
+
+uint32_t frame_server_client_count(FrameServer *server) {
+    uint32_t count = 0;
+    dcat_mutex_lock(&server->mutex);
+    for (uint32_t i = 0; i < FRAME_SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].active && !server->clients[i].finished) {
+            count++;
+        }
+    }
+    dcat_mutex_unlock(&server->mutex);
+    return count;
+}
+
+uint16_t frame_server_port(const FrameServer *server) {
+    return dcat_net_local_port(server->listener);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "core/threading.h"
+#include "platform/net.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream of frames from --serve to --connect viewers: each frame is a header, then
+// width * height RGBA pixels. The header is the magic, then the width and height as
+// little-endian 32-bit integers.
+#define FRAME_STREAM_MAGIC "DCF1"
+#define FRAME_STREAM_HEADER_BYTES 12U
+// Largest width or height a viewer accepts, as for -W/-H
+#define FRAME_STREAM_MAX_SIDE 65535U
+// Largest width * height a viewer accepts, far more than a terminal shows. A viewer allocates
+// the frame before reading it, so this bounds what any header can make it reserve.
+#define FRAME_STREAM_MAX_PIXELS (8192U * 8192U)
+
+void frame_stream_encode_header(uint32_t width, uint32_t height,
+                                uint8_t out[FRAME_STREAM_HEADER_BYTES]);
+// False for a header without the magic, with a side outside 1..FRAME_STREAM_MAX_SIDE or with
+// more than FRAME_STREAM_MAX_PIXELS pixels
+bool frame_stream_decode_header(const uint8_t header[FRAME_STREAM_HEADER_BYTES],
+                                uint32_t *width, uint32_t *height);
+
+#define FRAME_SERVER_MAX_CLIENTS 32U
+// Each client sends from at most one frame, the latest holds one, and publishing fills
+// another, so this many buffers always leave one free to publish into.
+#define FRAME_SERVER_FRAME_COUNT (FRAME_SERVER_MAX_CLIENTS + 2U)
+
+// A published frame, header included, shared by every client thread sending it
+typedef struct FrameServerFrame {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    uint32_t readers; // client threads sending it
+} FrameServerFrame;
+
+typedef struct FrameServerClient {
+    struct FrameServer *server;
+    DcatSocket socket;
+    DcatThread thread;
+    bool active;   // has a thread to join
+    bool finished; // its thread has returned
+} FrameServerClient;
+
+// Sends each rendered frame to every viewer connected to --serve's address, one thread per
+// viewer. Frames are shared, not copied per viewer, and a viewer still sending an older
+// frame skips straight to the latest, so a slow link drops frames for its own terminal
+// without holding back rendering or the other viewers.
+typedef struct FrameServer {
+    const char *address;
+    DcatSocket listener;
+    DcatThread accept_thread;
+    bool started;
+
+    FrameServerFrame frames[FRAME_SERVER_FRAME_COUNT];
+    int latest; // index into frames, -1 before the first publish
+    uint64_t generation;
+    bool stopping;
+    FrameServerClient clients[FRAME_SERVER_MAX_CLIENTS];
+
+    DcatMutex mutex;
+    DcatCond cond;
+} FrameServer;
+
+// `address` (see platform/net.h) must outlive the server. Prints why and returns false when
+// it cannot listen there.
+bool frame_server_start(FrameServer *server, const char *address);
+void frame_server_stop(FrameServer *server);
+// Copies the frame once for all viewers; one that connects later starts from the latest.
+// Only one thread may publish. False when out of memory.
+bool frame_server_publish(FrameServer *server, const uint8_t *pixels, uint32_t width,
+                          uint32_t height);
+uint32_t frame_server_client_count(FrameServer *server);
+// The TCP port listened on, e.g. the one picked for port 0; 0 for a Unix socket
+uint16_t frame_server_port(const FrameServer *server);
@@ -0,0 +1,257 @@
+#include "core/frame_writer.h"
+#include "platform/io.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_PATH_MAX 1024U
+#define FRAME_NUMBER_MAX_WIDTH 9
+
+typedef struct PathConversions {
+    int frame_numbers;
+    int names;
+} PathConversions;
+
+// Copies `pattern` into `out` with each frame-number conversion replaced by `frame_index`
+// and each %s by `name`, counting them. Fails on malformed conversions, on %s without a
+// name, or on truncation.
+static bool expand_path(const char *pattern, const uint32_t frame_index, const char *name,
+                        char *out, const size_t out_size, PathConversions *out_conversions) {
+    size_t length = 0;
+    PathConversions conversions = {0};
+    for (const char *p = pattern; *p != '\0'; p++) {
+        char piece[32];
+        const char *piece_data = piece;
+        size_t piece_length = 0;
+        if (*p != '%') {
+            piece[0] = *p;
+            piece_length = 1;
+        } else if (p[1] == '%') {
+            piece[0] = '%';
+            piece_length = 1;
+            p++;
+        } else if (p[1] == 's') {
+            if (name == NULL) {
+                return false;
+            }
+            piece_data = name;
+            piece_length = strlen(name);
+            conversions.names++;
+            p++;
+        } else {
+            p++;
+            const bool zero_pad = *p == '0';
+            if (zero_pad) {
+                p++;
+            }
+            int width = 0;
+            while (*p >= '0' && *p <= '9') {
+                width = (width * 10) + (*p - '0');
+                if (width > FRAME_NUMBER_MAX_WIDTH) {
+                    return false;
+                }
+                p++;
+            }
+            if (*p != 'd') {
+                return false;
+            }
+            const int written = snprintf(piece, sizeof(piece), zero_pad ? "%0*u" : "%*u", width,
+                                         (unsigned int)frame_index);
+            if (written < 0) {
+                return false;
+            }
+            piece_length = (size_t)written;
+            conversions.frame_numbers++;
+        }
+        if (length + piece_length >= out_size) {
+            return false;
+        }
+        memcpy(out + length, piece_data, piece_length);
+        length += piece_length;
+    }
+    out[length] = '\0';
+    *out_conversions = conversions;
+    return true;
+}
+
+bool frame_writer_format_path(const char *pattern, const uint32_t frame_index, const char *name,
+                              char *out, const size_t out_size) {
+    PathConversions conversions;
+    return expand_path(pattern, frame_index, name, out, out_size, &conversions) &&
+           conversions.frame_numbers == 1;
+}
+
+bool frame_writer_path_uses_name(const char *path) {
+    char expanded[FRAME_PATH_MAX];
+    PathConversions conversions;
+    return path != NULL && expand_path(path, 0, "", expanded, sizeof(expanded), &conversions) &&
+           conversions.names > 0;
+}
+
+static bool open_output(FrameWriter *writer, const char *path) {
+    writer->fd = dcat_open_write(path);
+    if (writer->fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    writer->owns_fd = true;
+    return true;
+}
+
+bool frame_writer_open(FrameWriter *writer, const char *path, const char *name) {
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = STDOUT_FILENO;
+    if (path == NULL || strcmp(path, "-") == 0) {
+        return true;
+    }
+
+    char expanded[FRAME_PATH_MAX];
+    PathConversions conversions;
+    if (!expand_path(path, 0, name, expanded, sizeof(expanded), &conversions) ||
+        conversions.frame_numbers > 1) {
+        fprintf(stderr,
+                "Invalid output path: %s (use at most one %%d, %%s only with --batch, %%%% for "
+                "a literal %%)\n",
+                path);
+        return false;
+    }
+    writer->path = path;
+    writer->name = name;
+    writer->per_frame = conversions.frame_numbers == 1;
+    return writer->per_frame || open_output(writer, expanded);
+}
+
+bool frame_writer_begin(FrameWriter *writer, const uint32_t frame_index) {
+    if (!writer->per_frame) {
+        return true;
+    }
+    char path[FRAME_PATH_MAX];
+    if (!frame_writer_format_path(writer->path, frame_index, writer->name, path, sizeof(path))) {
+        fprintf(stderr, "Output path too long: %s\n", writer->path);
+        return false;
+    }
+    return open_output(writer, path);
+}
+
+bool frame_writer_write(FrameWriter *writer, const void *data, const size_t size) {
+    const char *cursor = data;
+    size_t remaining = size;
+    while (remaining > 0) {
+        const ssize_t written = dcat_write(writer->fd, cursor, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Failed to write frame: %s\n", strerror(errno));
+            return false;
+        }
+        cursor += written;
+        remaining -= (size_t)written;
+    }
+    return true;
+}
+
+bool frame_writer_end(FrameWriter *writer) {
+    if (!writer->per_frame || !writer->owns_fd) {
+        return true;
+    }
+    writer->owns_fd = false;
+    const int result = dcat_close(writer->fd);
+    writer->fd = STDOUT_FILENO;
+    if (result != 0) {
+        fprintf(stderr, "Failed to close frame file: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void frame_writer_close(FrameWriter *writer) {
+    if (writer->owns_fd) {
+        dcat_close(writer->fd);
+    }
+    writer->owns_fd = false;
+    writer->fd = STDOUT_FILENO;
+}
+
+// The file name of `path` without its directory or extension
+static void model_name(const char *path, char *out, const size_t out_size) {
+    const char *base = path;
+    for (const char *p = path; *p != '\0'; p++) {
+        if (*p == '/' || *p == '\\') {
+            base = p + 1;
+        }
+    }
+    size_t length = strlen(base);
+    const char *extension = strrchr(base, '.');
+    if (extension != NULL && extension != base) {
+        length = (size_t)(extension - base);
+    }
+    if (length >= out_size) {
+        length = out_size - 1;
+    }
+    memcpy(out, base, length);
+    out[length] = '\0';
+}
+
+static bool batch_names_contain(const BatchNames *names, const char *name) {
+    for (size_t i = 0; i < names->count; i++) {
+        const char *a = names->names[i];
+        const char *b = name;
+        while (*a != '\0' && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool batch_names_claim(BatchNames *names, const char *path, char *out, const size_t out_size) {
+    char base[FRAME_PATH_MAX];
+    model_name(path, base, sizeof(base));
+    snprintf(out, out_size, "%s", base);
+    for (unsigned int suffix = 2; batch_names_contain(names, out); suffix++) {
+        char numbered[32];
+        const int numbered_length = snprintf(numbered, sizeof(numbered), "-%u", suffix);
+        if ((size_t)numbered_length >= out_size) {
+            return false;
+        }
+        // A name too long for `out` gives up its end to the suffix
+        size_t length = strlen(base);
+        if (length + (size_t)numbered_length >= out_size) {
+            length = out_size - 1U - (size_t)numbered_length;
+        }
+        snprintf(out, out_size, "%.*s%s", (int)length, base, numbered);
+    }
+
+    if (names->count == names->capacity) {
+        const size_t capacity = names->capacity > 0 ? names->capacity * 2U : 16U;
+        char **grown = realloc(names->names, capacity * sizeof(char *));
+        if (!grown) {
+            return false;
+        }
+        names->names = grown;
+        names->capacity = capacity;
+    }
+    const size_t length = strlen(out);
+    char *copy = malloc(length + 1U);
+    if (!copy) {
+        return false;
+    }
+    memcpy(copy, out, length + 1U);
+    names->names[names->count++] = copy;
+    return true;
+}
+
+void batch_names_free(BatchNames *names) {
+    for (size_t i = 0; i < names->count; i++) {
+        free(names->names[i]);
+    }
+    free(names->names);
+    memset(names, 0, sizeof(*names));
+}
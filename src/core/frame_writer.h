@@ -0,0 +1,48 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Destination for headless frames: stdout, one file holding every frame back to back, or
+// one file per frame when the path contains a frame-number conversion such as %04d. In
+// batch runs %s stands for the model name, giving each model its own files.
+typedef struct FrameWriter {
+    const char *path;
+    const char *name;
+    bool per_frame;
+    int fd;
+    bool owns_fd;
+} FrameWriter;
+
+// `path` NULL or "-" means stdout. Fails on a path with a malformed % conversion, or with
+// %s when `name` is NULL. `path` and `name` must outlive the writer.
+bool frame_writer_open(FrameWriter *writer, const char *path, const char *name);
+// Opens the file for `frame_index` in per-frame mode; a no-op otherwise.
+bool frame_writer_begin(FrameWriter *writer, uint32_t frame_index);
+bool frame_writer_write(FrameWriter *writer, const void *data, size_t size);
+// Closes the per-frame file; a no-op otherwise.
+bool frame_writer_end(FrameWriter *writer);
+void frame_writer_close(FrameWriter *writer);
+
+// Expands the single %d / %0Nd in `pattern` and any %s to `name` (%% is a literal percent).
+// Returns false when the pattern has no frame-number conversion, more than one, an
+// unsupported one, or %s with a NULL name.
+bool frame_writer_format_path(const char *pattern, uint32_t frame_index, const char *name,
+                              char *out, size_t out_size);
+// Whether `path` contains a model-name conversion (%s).
+bool frame_writer_path_uses_name(const char *path);
+
+// The names a batch run has given its models so far, so that two models with the same file
+// name do not write to the same files. Zero-initialized it holds none.
+typedef struct BatchNames {
+    char **names;
+    size_t count;
+    size_t capacity;
+} BatchNames;
+
+// Writes the file name of `path`, without its directory or extension, to `out` for the
+// output path's %s. When an earlier model already has that name, ignoring case as some
+// file systems do, "-2", "-3" and so on is appended until it is unique. Returns false when
+// out of memory or when `out` cannot hold a suffix.
+bool batch_names_claim(BatchNames *names, const char *path, char *out, size_t out_size);
+void batch_names_free(BatchNames *names);
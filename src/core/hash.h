@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static inline uint64_t dcat_hash_mix(uint64_t hash, const uint64_t word) {
+    hash ^= word * 0xff51afd7ed558ccdULL;
+    hash = (hash << 27) | (hash >> 37);
+    return hash * 0xc4ceb9fe1a85ec53ULL;
+}
+
+// Four independent lanes, so hashing keeps up with the page cache on large files. Used for
+// on-disk cache keys, so the result must stay stable across versions.
+static inline uint64_t dcat_hash_bytes(const uint8_t *data, const size_t size) {
+    uint64_t lanes[4] = {0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL, 0x94d049bb133111ebULL,
+                         0x2545f4914f6cdd1dULL};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t words[4];
+        memcpy(words, data + i, sizeof(words));
+        for (int lane = 0; lane < 4; lane++) {
+            lanes[lane] = dcat_hash_mix(lanes[lane], words[lane]);
+        }
+    }
+    uint64_t hash = (uint64_t)size;
+    for (int lane = 0; lane < 4; lane++) {
+        hash = dcat_hash_mix(hash, lanes[lane]);
+    }
+    for (; i < size; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i < 8 ? size - i : 8);
+        hash = dcat_hash_mix(hash, word);
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
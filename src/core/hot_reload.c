@@ -0,0 +1,350 @@
+#include "core/hot_reload.h"
+#include "graphics/texture_loader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vips/vips.h>
+
+// How long the thread waits for file changes before looking at `stopping` again
+#define HOT_RELOAD_WAIT_MS 100U
+
+static bool file_changed(const FileWatch *watch, const char *path) {
+    for (size_t i = 0; path && i < watch->file_count; i++) {
+        if (watch->files[i].changed && strcmp(watch->files[i].path, path) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Embedded images ("*0") live in the model file, so only a model reload changes them
+static bool embedded_path(const char *path) {
+    return path && path[0] == '*';
+}
+
+static bool same_path(const char *a, const char *b) {
+    return (!a || !b) ? a == b : strcmp(a, b) == 0;
+}
+
+static const char *diffuse_source(const HotReload *reload, const MaterialInfo *material) {
+    return reload->texture_path ? reload->texture_path : material->diffuse_path;
+}
+
+static const char *normal_source(const HotReload *reload, const MaterialInfo *material) {
+    return reload->normal_map_path ? reload->normal_map_path : material->normal_path;
+}
+
+// Whether a file the material's textures are decoded from is among the changed ones
+static bool material_files_changed(const HotReload *reload, const MaterialInfo *material) {
+    return file_changed(&reload->watch, diffuse_source(reload, material)) ||
+           file_changed(&reload->watch, normal_source(reload, material));
+}
+
+static void watch_material_textures(HotReload *reload) {
+    // A file that cannot be watched only misses its reloads
+    for (size_t i = 0; i < reload->material_count; i++) {
+        const char *sources[2] = {diffuse_source(reload, &reload->materials[i]),
+                                  normal_source(reload, &reload->materials[i])};
+        for (int k = 0; k < 2; k++) {
+            if (sources[k] && sources[k][0] != '\0' && !embedded_path(sources[k])) {
+                file_watch_add(&reload->watch, sources[k]);
+            }
+        }
+    }
+}
+
+static bool copy_materials(const MaterialInfo *source, const size_t count, MaterialInfo **out) {
+    *out = NULL;
+    if (count == 0) {
+        return true;
+    }
+    MaterialInfo *copy = calloc(count, sizeof(MaterialInfo));
+    if (!copy) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!material_info_copy(&source[i], &copy[i])) {
+            materials_free(copy, i);
+            return false;
+        }
+    }
+    *out = copy;
+    return true;
+}
+
+static bool result_init(HotReloadResult *result, const size_t count) {
+    memset(result, 0, sizeof(*result));
+    mesh_init(&result->mesh);
+    const size_t slots = count > 0 ? count : 1;
+    result->replaced = calloc(slots, sizeof(bool));
+    result->diffuse = calloc(slots, sizeof(Texture));
+    result->normal = calloc(slots, sizeof(Texture));
+    if (!result->replaced || !result->diffuse || !result->normal) {
+        hot_reload_result_free(result);
+        return false;
+    }
+    result->count = count;
+    return true;
+}
+
+// Decodes the textures of every material `result` marks replaced, out of `materials`, the way
+// the first load did
+static bool decode_textures(HotReload *reload, const MaterialInfo *materials,
+                            HotReloadResult *result) {
+    size_t count = 0;
+    for (size_t i = 0; i < result->count; i++) {
+        count += result->replaced[i] ? 1U : 0U;
+    }
+    if (count == 0) {
+        return true;
+    }
+    MaterialInfo *subset = malloc(count * sizeof(MaterialInfo));
+    Texture *diffuse = calloc(count, sizeof(Texture));
+    Texture *normal = calloc(count, sizeof(Texture));
+    const bool allocated = subset && diffuse && normal;
+    if (allocated) {
+        size_t k = 0;
+        for (size_t i = 0; i < result->count; i++) {
+            if (result->replaced[i]) {
+                subset[k++] = materials[i];
+            }
+        }
+        load_material_textures(reload->model_path, reload->texture_path,
+                               reload->normal_map_path, subset, count, diffuse, normal, NULL,
+                               NULL, &reload->stopping);
+        k = 0;
+        for (size_t i = 0; i < result->count; i++) {
+            if (result->replaced[i]) {
+                result->diffuse[i] = diffuse[k];
+                result->normal[i] = normal[k];
+                k++;
+            }
+        }
+    }
+    free(subset);
+    free(diffuse);
+    free(normal);
+    return allocated;
+}
+
+// Hands `result` to the render loop. A model replaces a pending result, carrying over the
+// textures it had for materials the model keeps; textures replace pending ones of the
+// same materials.
+static void publish(HotReload *reload, HotReloadResult *result) {
+    dcat_mutex_lock(&reload->mutex);
+    HotReloadResult *pending = &reload->pending;
+    if (!reload->has_pending) {
+        *pending = *result;
+        reload->has_pending = true;
+    } else if (result->has_model) {
+        for (size_t i = 0; i < result->count && i < pending->count; i++) {
+            if (!result->replaced[i] && pending->replaced[i]) {
+                result->diffuse[i] = pending->diffuse[i];
+                result->normal[i] = pending->normal[i];
+                result->replaced[i] = true;
+                pending->replaced[i] = false;
+            }
+        }
+        hot_reload_result_free(pending);
+        *pending = *result;
+    } else {
+        for (size_t i = 0; i < result->count && i < pending->count; i++) {
+            if (result->replaced[i]) {
+                if (pending->replaced[i]) {
+                    texture_free(&pending->diffuse[i]);
+                    texture_free(&pending->normal[i]);
+                }
+                pending->diffuse[i] = result->diffuse[i];
+                pending->normal[i] = result->normal[i];
+                pending->replaced[i] = true;
+                result->replaced[i] = false;
+            }
+        }
+        hot_reload_result_free(result);
+    }
+    memset(result, 0, sizeof(*result));
+    dcat_mutex_unlock(&reload->mutex);
+    change_tracker_notify(reload->changes);
+}
+
+static void reload_textures(HotReload *reload) {
+    HotReloadResult result;
+    if (!result_init(&result, reload->material_count)) {
+        return;
+    }
+    bool any = false;
+    for (size_t i = 0; i < reload->material_count; i++) {
+        result.replaced[i] = material_files_changed(reload, &reload->materials[i]);
+        any = any || result.replaced[i];
+    }
+    if (any && decode_textures(reload, reload->materials, &result)) {
+        publish(reload, &result);
+    } else {
+        hot_reload_result_free(&result);
+    }
+}
+
+static void reload_model(HotReload *reload) {
+    Mesh mesh;
+    mesh_init(&mesh);
+    bool has_uvs = false;
+    MaterialInfo *materials = NULL;
+    size_t count = 0;
+    // A model caught half-written fails to load; the write that completes it tries again
+    if (!load_model(reload->model_path, &mesh, &has_uvs, &materials, &count)) {
+        return;
+    }
+    HotReloadResult result;
+    MaterialInfo *copy = NULL;
+    if (!result_init(&result, count)) {
+        mesh_free(&mesh);
+        materials_free(materials, count);
+        return;
+    }
+    if (!copy_materials(materials, count, &copy)) {
+        hot_reload_result_free(&result);
+        mesh_free(&mesh);
+        materials_free(materials, count);
+        return;
+    }
+
+    // Materials naming the same images as before keep the textures they have
+    for (size_t i = 0; i < count; i++) {
+        const MaterialInfo *material = &materials[i];
+        const MaterialInfo *previous = i < reload->material_count ? &reload->materials[i] : NULL;
+        result.replaced[i] =
+            !previous || embedded_path(material->diffuse_path) ||
+            embedded_path(material->normal_path) ||
+            !same_path(material->diffuse_path, previous->diffuse_path) ||
+            !same_path(material->normal_path, previous->normal_path) ||
+            material_files_changed(reload, material);
+    }
+    if (!decode_textures(reload, materials, &result)) {
+        for (size_t i = 0; i < count; i++) {
+            result.replaced[i] = false;
+        }
+        hot_reload_result_free(&result);
+        mesh_free(&mesh);
+        materials_free(materials, count);
+        materials_free(copy, count);
+        return;
+    }
+
+    result.has_model = true;
+    result.mesh = mesh;
+    result.has_uvs = has_uvs;
+    result.materials = materials;
+    result.material_count = count;
+    materials_free(reload->materials, reload->material_count);
+    reload->materials = copy;
+    reload->material_count = count;
+    watch_material_textures(reload);
+    publish(reload, &result);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall hot_reload_thread_func(void *arg) {
+#else
+static void *hot_reload_thread_func(void *arg) {
+#endif
+    HotReload *reload = arg;
+    while (!atomic_load(&reload->stopping)) {
+        if (file_watch_wait(&reload->watch, HOT_RELOAD_WAIT_MS) == 0) {
+            continue;
+        }
+        // The model was watched first
+        if (reload->watch.files[0].changed) {
+            reload_model(reload);
+        } else {
+            reload_textures(reload);
+        }
+    }
+    vips_thread_shutdown();
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool hot_reload_start(HotReload *reload, const char *model_path, const char *texture_path,
+                      const char *normal_map_path, const MaterialInfo *materials,
+                      const size_t material_count, ChangeTracker *changes) {
+    memset(reload, 0, sizeof(*reload));
+    reload->model_path = model_path;
+    reload->texture_path = texture_path;
+    reload->normal_map_path = normal_map_path;
+    reload->changes = changes;
+    atomic_init(&reload->stopping, false);
+
+    if (!file_watch_init(&reload->watch)) {
+        return false;
+    }
+    if (!file_watch_add(&reload->watch, model_path) ||
+        !copy_materials(materials, material_count, &reload->materials)) {
+        file_watch_free(&reload->watch);
+        return false;
+    }
+    reload->material_count = material_count;
+    watch_material_textures(reload);
+
+    if (!dcat_mutex_init(&reload->mutex)) {
+        materials_free(reload->materials, reload->material_count);
+        file_watch_free(&reload->watch);
+        return false;
+    }
+    if (!dcat_thread_create(&reload->thread, hot_reload_thread_func, reload)) {
+        dcat_mutex_destroy(&reload->mutex);
+        materials_free(reload->materials, reload->material_count);
+        file_watch_free(&reload->watch);
+        return false;
+    }
+    reload->started = true;
+    return true;
+}
+
+bool hot_reload_take(HotReload *reload, HotReloadResult *out) {
+    dcat_mutex_lock(&reload->mutex);
+    const bool take = reload->has_pending;
+    if (take) {
+        *out = reload->pending;
+        memset(&reload->pending, 0, sizeof(reload->pending));
+        reload->has_pending = false;
+    }
+    dcat_mutex_unlock(&reload->mutex);
+    return take;
+}
+
+void hot_reload_result_free(HotReloadResult *result) {
+    for (size_t i = 0; result->replaced && i < result->count; i++) {
+        if (result->replaced[i]) {
+            texture_free(&result->diffuse[i]);
+            texture_free(&result->normal[i]);
+        }
+    }
+    free(result->replaced);
+    free(result->diffuse);
+    free(result->normal);
+    if (result->has_model) {
+        mesh_free(&result->mesh);
+        materials_free(result->materials, result->material_count);
+    }
+    memset(result, 0, sizeof(*result));
+}
+
+void hot_reload_stop(HotReload *reload) {
+    if (!reload->started) {
+        return;
+    }
+    atomic_store(&reload->stopping, true);
+    dcat_thread_join(reload->thread);
+    dcat_mutex_destroy(&reload->mutex);
+    if (reload->has_pending) {
+        hot_reload_result_free(&reload->pending);
+    }
+    materials_free(reload->materials, reload->material_count);
+    file_watch_free(&reload->watch);
+    memset(reload, 0, sizeof(*reload));
+}
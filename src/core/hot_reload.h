@@ -0,0 +1,69 @@
+#pragma once
+#include "core/change_tracker.h"
+#include "core/threading.h"
+#include "graphics/model.h"
+#include "graphics/texture.h"
+#include "platform/file_watch.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Everything reloaded since the render loop last took a result, for the materials in use
+// once it is applied
+typedef struct HotReloadResult {
+    // A re-imported model replaces the mesh and the materials; without one only textures do
+    bool has_model;
+    Mesh mesh;
+    bool has_uvs;
+    MaterialInfo *materials;
+    size_t material_count;
+    // One entry per material: when `replaced` is set, the pair replaces its textures;
+    // otherwise the material keeps the ones it has
+    bool *replaced;
+    Texture *diffuse;
+    Texture *normal;
+    size_t count;
+} HotReloadResult;
+
+// Watches the model and the texture files its materials name for --watch, and re-imports
+// whatever changed on a background thread: a changed model with its meshes and materials, a
+// changed image into only the materials that use it. The render loop takes finished reloads
+// and swaps them in; every delivery bumps `changes` so an idle loop wakes for it.
+typedef struct HotReload {
+    const char *model_path;
+    const char *texture_path;
+    const char *normal_map_path;
+    ChangeTracker *changes;
+
+    // The thread's own: the watched files, with the model first, and a copy of the
+    // materials in use once every delivered result is applied
+    FileWatch watch;
+    MaterialInfo *materials;
+    size_t material_count;
+
+    // Written by the thread, taken by the render loop under `mutex`
+    HotReloadResult pending;
+    bool has_pending;
+
+    atomic_bool stopping;
+    DcatMutex mutex;
+    DcatThread thread;
+    bool started;
+} HotReload;
+
+// Starts watching `model_path` and the textures of `materials`, which are copied; the
+// texture and normal map overrides may be NULL
+bool hot_reload_start(HotReload *reload, const char *model_path, const char *texture_path,
+                      const char *normal_map_path, const MaterialInfo *materials,
+                      size_t material_count, ChangeTracker *changes);
+
+// Moves out everything reloaded since the last call, as one result; false when nothing was
+bool hot_reload_take(HotReload *reload, HotReloadResult *out);
+
+// Frees what the render loop did not move out of `result`; a moved-out texture's `replaced`
+// entry must be cleared, and a moved-out model's `has_model`
+void hot_reload_result_free(HotReloadResult *result);
+
+// Joins the thread and frees whatever was not taken
+void hot_reload_stop(HotReload *reload);
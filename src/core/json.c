@@ -0,0 +1,441 @@
+#include "core/json.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_MAX_DEPTH 64
+
+typedef struct JsonParser {
+    const char *text;
+    size_t length;
+    size_t pos;
+    JsonToken *tokens;
+    size_t count;
+    size_t capacity;
+} JsonParser;
+
+static void skip_whitespace(JsonParser *p) {
+    while (p->pos < p->length) {
+        const char c = p->text[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            return;
+        }
+        p->pos++;
+    }
+}
+
+static int push_token(JsonParser *p, const JsonType type) {
+    if (p->count >= UINT32_MAX - 1U) {
+        return -1;
+    }
+    if (p->count == p->capacity) {
+        const size_t capacity = p->capacity ? p->capacity * 2 : 256;
+        JsonToken *tokens = realloc(p->tokens, capacity * sizeof(*tokens));
+        if (!tokens) {
+            return -1;
+        }
+        p->tokens = tokens;
+        p->capacity = capacity;
+    }
+    p->tokens[p->count] = (JsonToken){.type = type, .start = (uint32_t)p->pos};
+    return (int)p->count++;
+}
+
+static bool is_hex(const char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool parse_string(JsonParser *p) {
+    p->pos++;
+    const int token = push_token(p, JSON_STRING);
+    if (token < 0) {
+        return false;
+    }
+    while (p->pos < p->length) {
+        const unsigned char c = (unsigned char)p->text[p->pos];
+        if (c == '"') {
+            p->tokens[token].end = (uint32_t)p->pos;
+            p->tokens[token].next = (uint32_t)p->count;
+            p->pos++;
+            return true;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c == '\\') {
+            if (p->pos + 1 >= p->length) {
+                return false;
+            }
+            const char escape = p->text[p->pos + 1];
+            if (escape == 'u') {
+                if (p->pos + 6 > p->length) {
+                    return false;
+                }
+                for (size_t i = 2; i < 6; i++) {
+                    if (!is_hex(p->text[p->pos + i])) {
+                        return false;
+                    }
+                }
+                p->pos += 6;
+                continue;
+            }
+            if (!strchr("\"\\/bfnrt", escape)) {
+                return false;
+            }
+            p->pos += 2;
+            continue;
+        }
+        p->pos++;
+    }
+    return false;
+}
+
+static bool parse_number(JsonParser *p) {
+    const int token = push_token(p, JSON_NUMBER);
+    if (token < 0) {
+        return false;
+    }
+    const size_t start = p->pos;
+    if (p->pos < p->length && p->text[p->pos] == '-') {
+        p->pos++;
+    }
+    size_t digits = 0;
+    while (p->pos < p->length && p->text[p->pos] >= '0' && p->text[p->pos] <= '9') {
+        p->pos++;
+        digits++;
+    }
+    if (digits == 0) {
+        return false;
+    }
+    if (p->pos < p->length && p->text[p->pos] == '.') {
+        p->pos++;
+        digits = 0;
+        while (p->pos < p->length && p->text[p->pos] >= '0' && p->text[p->pos] <= '9') {
+            p->pos++;
+            digits++;
+        }
+        if (digits == 0) {
+            return false;
+        }
+    }
+    if (p->pos < p->length && (p->text[p->pos] == 'e' || p->text[p->pos] == 'E')) {
+        p->pos++;
+        if (p->pos < p->length && (p->text[p->pos] == '+' || p->text[p->pos] == '-')) {
+            p->pos++;
+        }
+        digits = 0;
+        while (p->pos < p->length && p->text[p->pos] >= '0' && p->text[p->pos] <= '9') {
+            p->pos++;
+            digits++;
+        }
+        if (digits == 0) {
+            return false;
+        }
+    }
+    p->tokens[token].start = (uint32_t)start;
+    p->tokens[token].end = (uint32_t)p->pos;
+    p->tokens[token].next = (uint32_t)p->count;
+    return true;
+}
+
+static bool parse_literal(JsonParser *p, const char *word, const JsonType type) {
+    const size_t length = strlen(word);
+    if (p->length - p->pos < length || memcmp(p->text + p->pos, word, length) != 0) {
+        return false;
+    }
+    const int token = push_token(p, type);
+    if (token < 0) {
+        return false;
+    }
+    p->pos += length;
+    p->tokens[token].end = (uint32_t)p->pos;
+    p->tokens[token].next = (uint32_t)p->count;
+    return true;
+}
+
+static bool parse_value(JsonParser *p, int depth);
+
+// Arrays and objects: `close` ends the list; objects alternate key strings and values
+static bool parse_container(JsonParser *p, const JsonType type, const int depth) {
+    if (depth >= JSON_MAX_DEPTH) {
+        return false;
+    }
+    const char close = type == JSON_OBJECT ? '}' : ']';
+    const int token = push_token(p, type);
+    if (token < 0) {
+        return false;
+    }
+    p->pos++;
+    skip_whitespace(p);
+    uint32_t size = 0;
+    if (p->pos < p->length && p->text[p->pos] == close) {
+        p->pos++;
+    } else {
+        for (;;) {
+            if (type == JSON_OBJECT) {
+                if (p->pos >= p->length || p->text[p->pos] != '"' || !parse_string(p)) {
+                    return false;
+                }
+                skip_whitespace(p);
+                if (p->pos >= p->length || p->text[p->pos] != ':') {
+                    return false;
+                }
+                p->pos++;
+            }
+            if (!parse_value(p, depth + 1)) {
+                return false;
+            }
+            size++;
+            skip_whitespace(p);
+            if (p->pos >= p->length) {
+                return false;
+            }
+            const char c = p->text[p->pos++];
+            if (c == close) {
+                break;
+            }
+            if (c != ',') {
+                return false;
+            }
+            skip_whitespace(p);
+        }
+    }
+    p->tokens[token].end = (uint32_t)p->pos;
+    p->tokens[token].size = size;
+    p->tokens[token].next = (uint32_t)p->count;
+    return true;
+}
+
+static bool parse_value(JsonParser *p, const int depth) {
+    skip_whitespace(p);
+    if (p->pos >= p->length) {
+        return false;
+    }
+    switch (p->text[p->pos]) {
+    case '{':
+        return parse_container(p, JSON_OBJECT, depth);
+    case '[':
+        return parse_container(p, JSON_ARRAY, depth);
+    case '"':
+        return parse_string(p);
+    case 't':
+        return parse_literal(p, "true", JSON_TRUE);
+    case 'f':
+        return parse_literal(p, "false", JSON_FALSE);
+    case 'n':
+        return parse_literal(p, "null", JSON_NULL);
+    default:
+        return parse_number(p);
+    }
+}
+
+bool json_parse(const char *text, const size_t length, JsonDocument *out) {
+    *out = (JsonDocument){0};
+    if (length >= UINT32_MAX) {
+        return false;
+    }
+    JsonParser p = {.text = text, .length = length};
+    bool ok = parse_value(&p, 0);
+    skip_whitespace(&p);
+    // Trailing NULs pad the JSON chunk of a binary glTF
+    while (ok && p.pos < p.length && (p.text[p.pos] == '\0' || p.text[p.pos] == ' ')) {
+        p.pos++;
+    }
+    ok = ok && p.pos == p.length;
+    if (!ok) {
+        free(p.tokens);
+        return false;
+    }
+    out->text = text;
+    out->tokens = p.tokens;
+    out->count = p.count;
+    return true;
+}
+
+void json_free(JsonDocument *doc) {
+    free(doc->tokens);
+    *doc = (JsonDocument){0};
+}
+
+static const JsonToken *token_at(const JsonDocument *doc, const int token) {
+    return token >= 0 && (size_t)token < doc->count ? &doc->tokens[token] : NULL;
+}
+
+static unsigned hex_value(const char c) {
+    if (c >= '0' && c <= '9') {
+        return (unsigned)(c - '0');
+    }
+    return (unsigned)((c | 0x20) - 'a' + 10);
+}
+
+// Unescapes the string `t` into `out` (NULL to only measure); returns the length in bytes.
+// \u escapes become UTF-8, surrogate pairs joined; a lone surrogate becomes U+FFFD.
+static size_t unescape(const char *text, const JsonToken *t, char *out) {
+    size_t length = 0;
+    for (uint32_t i = t->start; i < t->end;) {
+        char c = text[i];
+        if (c != '\\') {
+            if (out) {
+                out[length] = c;
+            }
+            length++;
+            i++;
+            continue;
+        }
+        c = text[i + 1];
+        if (c != 'u') {
+            static const char from[] = "\"\\/bfnrt";
+            static const char to[] = "\"\\/\b\f\n\r\t";
+            if (out) {
+                out[length] = to[strchr(from, c) - from];
+            }
+            length++;
+            i += 2;
+            continue;
+        }
+        uint32_t code = 0;
+        for (uint32_t k = 2; k < 6; k++) {
+            code = code << 4 | hex_value(text[i + k]);
+        }
+        i += 6;
+        if (code >= 0xD800 && code < 0xDC00 && i + 6 <= t->end && text[i] == '\\' &&
+            text[i + 1] == 'u') {
+            uint32_t low = 0;
+            for (uint32_t k = 2; k < 6; k++) {
+                low = low << 4 | hex_value(text[i + k]);
+            }
+            if (low >= 0xDC00 && low < 0xE000) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+        }
+        if (code >= 0xD800 && code < 0xE000) {
+            code = 0xFFFD;
+        }
+        unsigned char bytes[4];
+        size_t n;
+        if (code < 0x80) {
+            bytes[0] = (unsigned char)code;
+            n = 1;
+        } else if (code < 0x800) {
+            bytes[0] = (unsigned char)(0xC0 | code >> 6);
+            bytes[1] = (unsigned char)(0x80 | (code & 0x3F));
+            n = 2;
+        } else if (code < 0x10000) {
+            bytes[0] = (unsigned char)(0xE0 | code >> 12);
+            bytes[1] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | (code & 0x3F));
+            n = 3;
+        } else {
+            bytes[0] = (unsigned char)(0xF0 | code >> 18);
+            bytes[1] = (unsigned char)(0x80 | ((code >> 12) & 0x3F));
+            bytes[2] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+            bytes[3] = (unsigned char)(0x80 | (code & 0x3F));
+            n = 4;
+        }
+        if (out) {
+            memcpy(out + length, bytes, n);
+        }
+        length += n;
+    }
+    return length;
+}
+
+// Keys are compared raw when they hold no escapes, which is every key glTF defines
+static bool string_equals(const JsonDocument *doc, const JsonToken *t, const char *value) {
+    const size_t raw = t->end - t->start;
+    if (!memchr(doc->text + t->start, '\\', raw)) {
+        return strlen(value) == raw && memcmp(doc->text + t->start, value, raw) == 0;
+    }
+    char *unescaped = json_string_dup(doc, (int)(t - doc->tokens));
+    const bool equal = unescaped && strcmp(unescaped, value) == 0;
+    free(unescaped);
+    return equal;
+}
+
+int json_object_get(const JsonDocument *doc, const int object, const char *key) {
+    const JsonToken *t = token_at(doc, object);
+    if (!t || t->type != JSON_OBJECT) {
+        return -1;
+    }
+    uint32_t member = (uint32_t)object + 1;
+    for (uint32_t i = 0; i < t->size; i++) {
+        const uint32_t value = member + 1;
+        if (string_equals(doc, &doc->tokens[member], key)) {
+            return (int)value;
+        }
+        member = doc->tokens[value].next;
+    }
+    return -1;
+}
+
+int json_array_get(const JsonDocument *doc, const int array, const size_t index) {
+    const JsonToken *t = token_at(doc, array);
+    if (!t || t->type != JSON_ARRAY || index >= t->size) {
+        return -1;
+    }
+    uint32_t element = (uint32_t)array + 1;
+    for (size_t i = 0; i < index; i++) {
+        element = doc->tokens[element].next;
+    }
+    return (int)element;
+}
+
+size_t json_array_size(const JsonDocument *doc, const int array) {
+    const JsonToken *t = token_at(doc, array);
+    return t && t->type == JSON_ARRAY ? t->size : 0;
+}
+
+double json_number(const JsonDocument *doc, const int token, const double fallback) {
+    const JsonToken *t = token_at(doc, token);
+    if (!t || t->type != JSON_NUMBER) {
+        return fallback;
+    }
+    // By hand rather than strtod, whose decimal point follows the locale
+    const char *s = doc->text;
+    uint32_t i = t->start;
+    const bool negative = s[i] == '-';
+    i += negative;
+    double value = 0.0;
+    for (; i < t->end && s[i] >= '0' && s[i] <= '9'; i++) {
+        value = value * 10.0 + (s[i] - '0');
+    }
+    int exponent = 0;
+    if (i < t->end && s[i] == '.') {
+        for (i++; i < t->end && s[i] >= '0' && s[i] <= '9'; i++) {
+            value = value * 10.0 + (s[i] - '0');
+            exponent--;
+        }
+    }
+    if (i < t->end && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        const bool negative_exponent = s[i] == '-';
+        i += s[i] == '-' || s[i] == '+';
+        int e = 0;
+        for (; i < t->end && s[i] >= '0' && s[i] <= '9'; i++) {
+            e = e < 10000 ? e * 10 + (s[i] - '0') : e;
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+    value = exponent ? value * pow(10.0, exponent) : value;
+    return negative ? -value : value;
+}
+
+bool json_string_equals(const JsonDocument *doc, const int token, const char *value) {
+    const JsonToken *t = token_at(doc, token);
+    return t && t->type == JSON_STRING && string_equals(doc, t, value);
+}
+
+char *json_string_dup(const JsonDocument *doc, const int token) {
+    const JsonToken *t = token_at(doc, token);
+    if (!t || t->type != JSON_STRING) {
+        return NULL;
+    }
+    char *out = malloc(unescape(doc->text, t, NULL) + 1);
+    if (!out) {
+        return NULL;
+    }
+    out[unescape(doc->text, t, out)] = '\0';
+    return out;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A read-only JSON document parsed into a flat array of tokens, in document order. Values
+// refer into the source text, which must outlive the document. Token indices are ints;
+// -1 stands for "absent" and every accessor accepts it.
+typedef enum JsonType {
+    JSON_NULL,
+    JSON_FALSE,
+    JSON_TRUE,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+} JsonType;
+
+typedef struct JsonToken {
+    JsonType type;
+    // Source span: the whole value, without the quotes of a string
+    uint32_t start;
+    uint32_t end;
+    // Elements of an array, members of an object (each a key string then its value)
+    uint32_t size;
+    // Index of the first token after this value and everything inside it
+    uint32_t next;
+} JsonToken;
+
+typedef struct JsonDocument {
+    const char *text;
+    JsonToken *tokens;
+    size_t count;
+} JsonDocument;
+
+// Parses `length` bytes of `text`, which need not be NUL-terminated. False on malformed
+// input, nesting deeper than 64 levels, or when out of memory.
+bool json_parse(const char *text, size_t length, JsonDocument *out);
+void json_free(JsonDocument *doc);
+
+// The value of member `key` of an object; -1 when `object` is not an object or lacks it
+int json_object_get(const JsonDocument *doc, int object, const char *key);
+
+// Element `index` of an array; -1 when `array` is not an array or is shorter
+int json_array_get(const JsonDocument *doc, int array, size_t index);
+
+// Elements of an array; 0 for anything else
+size_t json_array_size(const JsonDocument *doc, int array);
+
+// The value of a number, or `fallback` when `token` is not one. Independent of the locale.
+double json_number(const JsonDocument *doc, int token, double fallback);
+
+// Whether `token` is a string equal to `value` once unescaped
+bool json_string_equals(const JsonDocument *doc, int token, const char *value);
+
+// The unescaped string, NUL-terminated, for the caller to free; NULL when `token` is not a
+// string or when out of memory
+char *json_string_dup(const JsonDocument *doc, int token);
@@ -0,0 +1,101 @@
+#include "core/render_scale.h"
+
+#include <math.h>
+
+#define RENDER_SCALE_SMOOTHING 0.2
+// Over budget past this ratio counts toward a downscale; under the lower ratio
+// counts toward an upscale. The gap between them is the hysteresis band.
+#define RENDER_SCALE_OVER_RATIO 1.1
+#define RENDER_SCALE_UNDER_RATIO 0.7
+#define RENDER_SCALE_DOWN_FRAMES 4U
+#define RENDER_SCALE_UP_FRAMES 30U
+#define RENDER_SCALE_COOLDOWN_FRAMES 10U
+#define RENDER_SCALE_UP_STEP 1.1F
+#define RENDER_SCALE_DOWN_MAX_STEP 0.6F
+#define RENDER_SCALE_MIN_DIMENSION 16U
+
+static float clamp_scale(const float scale) {
+    if (scale < RENDER_SCALE_MIN) {
+        return RENDER_SCALE_MIN;
+    }
+    if (scale > RENDER_SCALE_MAX) {
+        return RENDER_SCALE_MAX;
+    }
+    return scale;
+}
+
+void render_scale_init(RenderScaleController *controller, const double target_frame_time) {
+    *controller = (RenderScaleController){0};
+    controller->target_frame_time = target_frame_time;
+    controller->scale = RENDER_SCALE_MAX;
+}
+
+void render_scale_reset_history(RenderScaleController *controller) {
+    controller->has_average = false;
+    controller->frames_over = 0;
+    controller->frames_under = 0;
+    controller->cooldown = RENDER_SCALE_COOLDOWN_FRAMES;
+}
+
+bool render_scale_update(RenderScaleController *controller, const double frame_time) {
+    if (controller->target_frame_time <= 0.0 || frame_time <= 0.0) {
+        return false;
+    }
+
+    if (controller->has_average) {
+        controller->average_frame_time +=
+            (frame_time - controller->average_frame_time) * RENDER_SCALE_SMOOTHING;
+    } else {
+        controller->average_frame_time = frame_time;
+        controller->has_average = true;
+    }
+
+    if (controller->cooldown > 0) {
+        controller->cooldown--;
+        return false;
+    }
+
+    const double ratio = controller->average_frame_time / controller->target_frame_time;
+    controller->frames_over = ratio > RENDER_SCALE_OVER_RATIO ? controller->frames_over + 1U : 0U;
+    controller->frames_under =
+        ratio < RENDER_SCALE_UNDER_RATIO ? controller->frames_under + 1U : 0U;
+
+    float scale = controller->scale;
+    if (controller->frames_over >= RENDER_SCALE_DOWN_FRAMES) {
+        // Cost is roughly proportional to pixel count, so scale each axis by the
+        // square root of the overrun, but never drop more than one step at a time.
+        float step = (float)sqrt(1.0 / ratio);
+        if (step < RENDER_SCALE_DOWN_MAX_STEP) {
+            step = RENDER_SCALE_DOWN_MAX_STEP;
+        }
+        scale = clamp_scale(scale * step);
+    } else if (controller->frames_under >= RENDER_SCALE_UP_FRAMES) {
+        scale = clamp_scale(scale * RENDER_SCALE_UP_STEP);
+    } else {
+        return false;
+    }
+
+    if (fabsf(scale - controller->scale) < 0.01F) {
+        controller->frames_over = 0;
+        controller->frames_under = 0;
+        return false;
+    }
+
+    controller->scale = scale;
+    render_scale_reset_history(controller);
+    return true;
+}
+
+void render_scale_apply(const float scale, const uint32_t width, const uint32_t height,
+                        uint32_t *out_width, uint32_t *out_height) {
+    uint32_t scaled_width = (uint32_t)lroundf((float)width * scale);
+    uint32_t scaled_height = (uint32_t)lroundf((float)height * scale);
+    if (scaled_width < RENDER_SCALE_MIN_DIMENSION) {
+        scaled_width = width < RENDER_SCALE_MIN_DIMENSION ? width : RENDER_SCALE_MIN_DIMENSION;
+    }
+    if (scaled_height < RENDER_SCALE_MIN_DIMENSION) {
+        scaled_height = height < RENDER_SCALE_MIN_DIMENSION ? height : RENDER_SCALE_MIN_DIMENSION;
+    }
+    *out_width = scaled_width;
+    *out_height = scaled_height;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RENDER_SCALE_MIN 0.35F
+#define RENDER_SCALE_MAX 1.0F
+
+// Adjusts the internal render resolution to hold a frame-time budget. Frame times
+// are smoothed, and the scale only moves after several frames well outside the
+// budget, with a cooldown after each step, so it settles instead of oscillating.
+typedef struct RenderScaleController {
+    double target_frame_time;
+    double average_frame_time;
+    float scale;
+    uint32_t frames_over;
+    uint32_t frames_under;
+    uint32_t cooldown;
+    bool has_average;
+} RenderScaleController;
+
+void render_scale_init(RenderScaleController *controller, double target_frame_time);
+// Feeds the cost of one frame in seconds; returns true when the scale changed.
+bool render_scale_update(RenderScaleController *controller, double frame_time);
+// Forgets accumulated timings, e.g. after a resize changed the workload.
+void render_scale_reset_history(RenderScaleController *controller);
+void render_scale_apply(float scale, uint32_t width, uint32_t height, uint32_t *out_width,
+                        uint32_t *out_height);
@@ -0,0 +1,295 @@
+#include "core/replay.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAX_TOKENS 16
+#define REPLAY_MAX_TOKEN_LENGTH 32
+#define REPLAY_DEGREES_TO_RADIANS (3.14159265358979323846 / 180.0)
+
+typedef struct ReplayKey {
+    const char *name;
+    size_t offset;
+} ReplayKey;
+
+static const ReplayKey REPLAY_KEYS_BY_NAME[] = {
+    {"w", offsetof(KeyState, w)},         {"a", offsetof(KeyState, a)},
+    {"s", offsetof(KeyState, s)},         {"d", offsetof(KeyState, d)},
+    {"i", offsetof(KeyState, i)},         {"j", offsetof(KeyState, j)},
+    {"k", offsetof(KeyState, k)},         {"l", offsetof(KeyState, l)},
+    {"space", offsetof(KeyState, space)}, {"shift", offsetof(KeyState, shift)},
+    {"ctrl", offsetof(KeyState, ctrl)},   {"v", offsetof(KeyState, v)},
+    {"b", offsetof(KeyState, b)},
+};
+
+typedef struct ReplayLine {
+    char tokens[REPLAY_MAX_TOKENS][REPLAY_MAX_TOKEN_LENGTH];
+    uint32_t count;
+} ReplayLine;
+
+// Splits `line` (up to `end`) into whitespace-separated tokens, stopping at a '#'. False when
+// there are too many or one is too long.
+static bool tokenize(const char *line, const char *end, ReplayLine *out) {
+    out->count = 0;
+    const char *cursor = line;
+    while (cursor < end) {
+        while (cursor < end && isspace((unsigned char)*cursor)) {
+            cursor++;
+        }
+        if (cursor == end || *cursor == '#') {
+            break;
+        }
+        const char *start = cursor;
+        while (cursor < end && !isspace((unsigned char)*cursor) && *cursor != '#') {
+            cursor++;
+        }
+        const size_t length = (size_t)(cursor - start);
+        if (out->count == REPLAY_MAX_TOKENS || length >= REPLAY_MAX_TOKEN_LENGTH) {
+            return false;
+        }
+        memcpy(out->tokens[out->count], start, length);
+        out->tokens[out->count][length] = '\0';
+        out->count++;
+    }
+    return true;
+}
+
+static bool parse_frame(const char *token, uint32_t *out) {
+    if (!isdigit((unsigned char)token[0])) {
+        return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    const unsigned long value = strtoul(token, &end, 10);
+    if (errno != 0 || *end != '\0' || value > UINT32_MAX) {
+        return false;
+    }
+    *out = (uint32_t)value;
+    return true;
+}
+
+static bool parse_number(const char *token, double *out) {
+    char *end = NULL;
+    errno = 0;
+    const double value = strtod(token, &end);
+    if (errno != 0 || end == token || *end != '\0' || !isfinite(value)) {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+static bool parse_keys(const ReplayLine *line, KeyState *keys) {
+    memset(keys, 0, sizeof(*keys));
+    for (uint32_t i = 2; i < line->count; i++) {
+        bool found = false;
+        for (size_t k = 0; k < sizeof(REPLAY_KEYS_BY_NAME) / sizeof(REPLAY_KEYS_BY_NAME[0]);
+             k++) {
+            if (strcmp(line->tokens[i], REPLAY_KEYS_BY_NAME[k].name) == 0) {
+                *(bool *)((char *)keys + REPLAY_KEYS_BY_NAME[k].offset) = true;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Parses the command and arguments of a line whose frame is already in `event`
+static bool parse_event(const ReplayLine *line, ReplayEvent *event) {
+    const char *command = line->tokens[1];
+    if (strcmp(command, "orbit") == 0 || strcmp(command, "pan") == 0) {
+        const bool orbit = command[0] == 'o';
+        if (line->count != 4 || !parse_number(line->tokens[2], &event->x) ||
+            !parse_number(line->tokens[3], &event->y)) {
+            return false;
+        }
+        event->command = orbit ? REPLAY_ORBIT : REPLAY_PAN;
+        if (orbit) {
+            event->x *= REPLAY_DEGREES_TO_RADIANS;
+            event->y *= REPLAY_DEGREES_TO_RADIANS;
+        }
+        return true;
+    }
+    if (strcmp(command, "zoom") == 0) {
+        event->command = REPLAY_ZOOM;
+        return line->count == 3 && parse_number(line->tokens[2], &event->x);
+    }
+    if (strcmp(command, "keys") == 0) {
+        event->command = REPLAY_KEYS;
+        return parse_keys(line, &event->keys);
+    }
+    if (strcmp(command, "animation") == 0 && line->count == 3) {
+        if (strcmp(line->tokens[2], "next") == 0) {
+            event->command = REPLAY_NEXT_ANIMATION;
+            return true;
+        }
+        if (strcmp(line->tokens[2], "previous") == 0) {
+            event->command = REPLAY_PREVIOUS_ANIMATION;
+            return true;
+        }
+        return false;
+    }
+    if (strcmp(command, "play") == 0 || strcmp(command, "wireframe") == 0) {
+        event->command = command[0] == 'p' ? REPLAY_PLAY : REPLAY_WIREFRAME;
+        return line->count == 2;
+    }
+    return false;
+}
+
+static bool append_event(ReplayScript *script, size_t *capacity, const ReplayEvent *event) {
+    if (script->count == *capacity) {
+        const size_t grown_capacity = *capacity > 0 ? *capacity * 2U : 16U;
+        ReplayEvent *grown = realloc(script->events, grown_capacity * sizeof(ReplayEvent));
+        if (!grown) {
+            return false;
+        }
+        script->events = grown;
+        *capacity = grown_capacity;
+    }
+    script->events[script->count++] = *event;
+    return true;
+}
+
+bool replay_script_parse(ReplayScript *script, const char *text, const char *name) {
+    memset(script, 0, sizeof(*script));
+    size_t capacity = 0;
+    uint32_t line_number = 0;
+    const char *line_start = text;
+    while (*line_start != '\0') {
+        const char *line_end = strchr(line_start, '\n');
+        if (!line_end) {
+            line_end = line_start + strlen(line_start);
+        }
+        line_number++;
+
+        ReplayLine line;
+        ReplayEvent event = {0};
+        const bool tokenized = tokenize(line_start, line_end, &line);
+        if (tokenized && line.count == 0) {
+            line_start = *line_end != '\0' ? line_end + 1 : line_end;
+            continue;
+        }
+        if (!tokenized || line.count < 2 || !parse_frame(line.tokens[0], &event.frame) ||
+            !parse_event(&line, &event)) {
+            fprintf(stderr, "%s:%u: invalid replay event\n", name, line_number);
+            replay_script_free(script);
+            return false;
+        }
+        if (script->count > 0 && event.frame < script->events[script->count - 1].frame) {
+            fprintf(stderr, "%s:%u: replay events must be in frame order\n", name,
+                    line_number);
+            replay_script_free(script);
+            return false;
+        }
+        if (!append_event(script, &capacity, &event)) {
+            fprintf(stderr, "Failed to allocate replay events\n");
+            replay_script_free(script);
+            return false;
+        }
+        line_start = *line_end != '\0' ? line_end + 1 : line_end;
+    }
+    return true;
+}
+
+bool replay_script_load(ReplayScript *script, const char *path) {
+    memset(script, 0, sizeof(*script));
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open replay script: %s\n", path);
+        return false;
+    }
+    char *text = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    bool ok = true;
+    for (;;) {
+        if (capacity - size < 4096U) {
+            capacity = capacity > 0 ? capacity * 2U : 8192U;
+            char *grown = realloc(text, capacity);
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            text = grown;
+        }
+        const size_t read = fread(text + size, 1, capacity - size - 1U, file);
+        size += read;
+        if (read == 0) {
+            ok = !ferror(file);
+            break;
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "Failed to read replay script: %s\n", path);
+        free(text);
+        return false;
+    }
+    text[size] = '\0';
+    ok = replay_script_parse(script, text, path);
+    free(text);
+    return ok;
+}
+
+void replay_script_free(ReplayScript *script) {
+    free(script->events);
+    memset(script, 0, sizeof(*script));
+}
+
+void replay_player_init(ReplayPlayer *player, const ReplayScript *script) {
+    memset(player, 0, sizeof(*player));
+    player->script = script;
+}
+
+void replay_player_step(ReplayPlayer *player, const float delta_time) {
+    InputCommands *commands = &player->commands;
+    commands->orbit_yaw += player->orbit_rate[0] * delta_time;
+    commands->orbit_pitch += player->orbit_rate[1] * delta_time;
+    commands->pan_x += player->pan_rate[0] * delta_time;
+    commands->pan_y += player->pan_rate[1] * delta_time;
+    player->zoom_total += player->zoom_rate * delta_time;
+    commands->zoom_steps = (int64_t)floor(player->zoom_total);
+
+    const ReplayScript *script = player->script;
+    while (player->next_event < script->count &&
+           script->events[player->next_event].frame <= player->frame) {
+        const ReplayEvent *event = &script->events[player->next_event++];
+        switch (event->command) {
+        case REPLAY_ORBIT:
+            player->orbit_rate[0] = event->x;
+            player->orbit_rate[1] = event->y;
+            break;
+        case REPLAY_PAN:
+            player->pan_rate[0] = event->x;
+            player->pan_rate[1] = event->y;
+            break;
+        case REPLAY_ZOOM:
+            player->zoom_rate = event->x;
+            break;
+        case REPLAY_KEYS:
+            commands->keys = event->keys;
+            break;
+        case REPLAY_NEXT_ANIMATION:
+            player->next_animations++;
+            break;
+        case REPLAY_PREVIOUS_ANIMATION:
+            player->previous_animations++;
+            break;
+        case REPLAY_PLAY:
+            player->play_toggles++;
+            break;
+        case REPLAY_WIREFRAME:
+            player->wireframe_toggles++;
+            break;
+        }
+    }
+    player->frame++;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "input/input_handler.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --replay script: one event per line, "FRAME COMMAND [ARGUMENTS]", with frames in
+// non-decreasing order and '#' starting a comment. Motions hold from their frame until the
+// next event of the same kind changes them:
+//   orbit YAW PITCH    orbit the camera at YAW and PITCH degrees per second
+//   pan X Y            pan the camera at X and Y mouse-pan units per second
+//   zoom RATE          zoom in at RATE steps per second, out when negative
+//   keys [KEY...]      hold these keyboard controls (w a s d i j k l space shift ctrl v b),
+//                      releasing the rest
+// and the rest happen once, before FRAME is rendered:
+//   animation next     switch animation, as the 2 key does
+//   animation previous as the 1 key does
+//   play               pause or resume the animation
+//   wireframe          toggle wireframe
+typedef enum ReplayCommand {
+    REPLAY_ORBIT,
+    REPLAY_PAN,
+    REPLAY_ZOOM,
+    REPLAY_KEYS,
+    REPLAY_NEXT_ANIMATION,
+    REPLAY_PREVIOUS_ANIMATION,
+    REPLAY_PLAY,
+    REPLAY_WIREFRAME,
+} ReplayCommand;
+
+typedef struct ReplayEvent {
+    uint32_t frame;
+    ReplayCommand command;
+    double x; // orbit yaw in radians, pan x or zoom steps, per second
+    double y; // orbit pitch in radians or pan y, per second
+    KeyState keys;
+} ReplayEvent;
+
+typedef struct ReplayScript {
+    ReplayEvent *events;
+    size_t count;
+} ReplayScript;
+
+// Prints the file and line of the first malformed line and returns false.
+bool replay_script_load(ReplayScript *script, const char *path);
+// `text` is the whole script; `name` is what errors call it.
+bool replay_script_parse(ReplayScript *script, const char *text, const char *name);
+void replay_script_free(ReplayScript *script);
+
+// Plays a script into the totals and counters an input thread would publish, so the render
+// loop applies it through the same path as live input.
+typedef struct ReplayPlayer {
+    const ReplayScript *script;
+    size_t next_event;
+    uint32_t frame; // the frame the next step is for
+    double orbit_rate[2];
+    double pan_rate[2];
+    double zoom_rate;
+    double zoom_total; // fractional steps; commands.zoom_steps holds the whole ones
+    InputCommands commands;
+    unsigned int wireframe_toggles;
+    unsigned int next_animations;
+    unsigned int previous_animations;
+    unsigned int play_toggles;
+} ReplayPlayer;
+
+void replay_player_init(ReplayPlayer *player, const ReplayScript *script);
+// Advances the held motions by `delta_time` seconds, then runs the events due at the next
+// frame.
+void replay_player_step(ReplayPlayer *player, float delta_time);
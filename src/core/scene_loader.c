@@ -0,0 +1,180 @@
+#include "core/scene_loader.h"
+#include "graphics/texture_loader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vips/vips.h>
+
+static void texture_ready(void *context, const size_t material) {
+    SceneLoader *loader = context;
+    dcat_mutex_lock(&loader->mutex);
+    loader->textures[material].ready = true;
+    dcat_mutex_unlock(&loader->mutex);
+    change_tracker_notify(loader->changes);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall scene_loader_thread_func(void *arg) {
+#else
+static void *scene_loader_thread_func(void *arg) {
+#endif
+    SceneLoader *loader = arg;
+
+    Mesh mesh;
+    mesh_init(&mesh);
+    bool has_uvs = false;
+    MaterialInfo *materials = NULL;
+    size_t material_count = 0;
+    bool loaded = load_model(loader->model_path, &mesh, &has_uvs, &materials, &material_count);
+    const size_t slot_count = material_count > 0 ? material_count : 1;
+    SceneTextureSlot *textures = NULL;
+    Texture *diffuse_textures = NULL;
+    Texture *normal_textures = NULL;
+    if (loaded) {
+        textures = calloc(slot_count, sizeof(SceneTextureSlot));
+        diffuse_textures = calloc(slot_count, sizeof(Texture));
+        normal_textures = calloc(slot_count, sizeof(Texture));
+        if (!textures || !diffuse_textures || !normal_textures) {
+            fprintf(stderr, "Failed to allocate material resources\n");
+            free(textures);
+            free(diffuse_textures);
+            free(normal_textures);
+            textures = NULL;
+            diffuse_textures = NULL;
+            normal_textures = NULL;
+            materials_free(materials, material_count);
+            mesh_free(&mesh);
+            loaded = false;
+        }
+    }
+
+    dcat_mutex_lock(&loader->mutex);
+    if (loaded) {
+        loader->mesh = mesh;
+        loader->has_uvs = has_uvs;
+        loader->materials = materials;
+        loader->material_count = material_count;
+        loader->textures = textures;
+        loader->diffuse_textures = diffuse_textures;
+        loader->normal_textures = normal_textures;
+        loader->geometry_ready = true;
+    } else {
+        loader->failed = true;
+    }
+    dcat_mutex_unlock(&loader->mutex);
+    change_tracker_notify(loader->changes);
+
+    // The render loop now owns the materials, but cannot free them before joining us
+    if (loaded) {
+        load_material_textures(loader->model_path, loader->texture_path,
+                               loader->normal_map_path, materials, material_count,
+                               diffuse_textures, normal_textures, texture_ready, loader,
+                               &loader->cancelled);
+    }
+
+    dcat_mutex_lock(&loader->mutex);
+    loader->finished = true;
+    dcat_mutex_unlock(&loader->mutex);
+    change_tracker_notify(loader->changes);
+    vips_thread_shutdown();
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool scene_loader_start(SceneLoader *loader, const char *model_path, const char *texture_path,
+                        const char *normal_map_path, ChangeTracker *changes) {
+    memset(loader, 0, sizeof(*loader));
+    loader->model_path = model_path;
+    loader->texture_path = texture_path;
+    loader->normal_map_path = normal_map_path;
+    loader->changes = changes;
+    mesh_init(&loader->mesh);
+    atomic_init(&loader->cancelled, false);
+
+    if (!dcat_mutex_init(&loader->mutex)) {
+        return false;
+    }
+    if (!dcat_thread_create(&loader->thread, scene_loader_thread_func, loader)) {
+        dcat_mutex_destroy(&loader->mutex);
+        return false;
+    }
+    loader->started = true;
+    return true;
+}
+
+bool scene_loader_take_geometry(SceneLoader *loader, Mesh *out_mesh, bool *out_has_uvs,
+                                MaterialInfo **out_materials, size_t *out_material_count,
+                                bool *out_failed) {
+    dcat_mutex_lock(&loader->mutex);
+    *out_failed = loader->failed;
+    const bool take = loader->geometry_ready && !loader->geometry_taken;
+    if (take) {
+        *out_mesh = loader->mesh;
+        mesh_init(&loader->mesh);
+        *out_has_uvs = loader->has_uvs;
+        *out_materials = loader->materials;
+        *out_material_count = loader->material_count;
+        loader->geometry_taken = true;
+    }
+    dcat_mutex_unlock(&loader->mutex);
+    return take;
+}
+
+bool scene_loader_take_textures(SceneLoader *loader, size_t *out_material, Texture *out_diffuse,
+                                Texture *out_normal) {
+    dcat_mutex_lock(&loader->mutex);
+    bool take = false;
+    for (size_t i = 0; loader->geometry_taken && i < loader->material_count; i++) {
+        SceneTextureSlot *slot = &loader->textures[i];
+        if (slot->ready && !slot->taken) {
+            *out_material = i;
+            *out_diffuse = loader->diffuse_textures[i];
+            *out_normal = loader->normal_textures[i];
+            slot->taken = true;
+            loader->textures_taken++;
+            take = true;
+            break;
+        }
+    }
+    dcat_mutex_unlock(&loader->mutex);
+    return take;
+}
+
+bool scene_loader_done(SceneLoader *loader) {
+    dcat_mutex_lock(&loader->mutex);
+    const bool done = loader->finished && loader->geometry_taken &&
+                      loader->textures_taken == loader->material_count;
+    dcat_mutex_unlock(&loader->mutex);
+    return done;
+}
+
+void scene_loader_stop(SceneLoader *loader) {
+    if (!loader->started) {
+        return;
+    }
+
+    atomic_store(&loader->cancelled, true);
+    dcat_thread_join(loader->thread);
+    dcat_mutex_destroy(&loader->mutex);
+
+    for (size_t i = 0; loader->textures && i < loader->material_count; i++) {
+        if (!loader->textures[i].taken) {
+            texture_free(&loader->diffuse_textures[i]);
+            texture_free(&loader->normal_textures[i]);
+        }
+    }
+    free(loader->textures);
+    free(loader->diffuse_textures);
+    free(loader->normal_textures);
+    if (loader->geometry_ready && !loader->geometry_taken) {
+        mesh_free(&loader->mesh);
+        materials_free(loader->materials, loader->material_count);
+    }
+    memset(loader, 0, sizeof(*loader));
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "core/change_tracker.h"
+#include "core/threading.h"
+#include "graphics/model.h"
+#include "graphics/texture.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Hand-over state of one material's textures
+typedef struct SceneTextureSlot {
+    bool ready;
+    bool taken;
+} SceneTextureSlot;
+
+// Loads a model on a background thread for --progressive: first the geometry and
+// materials, then each material's textures. The render loop polls for finished pieces
+// and swaps them in; every delivery bumps `changes` so an idle loop wakes for it.
+typedef struct SceneLoader {
+    const char *model_path;
+    const char *texture_path;
+    const char *normal_map_path;
+    ChangeTracker *changes;
+
+    // Written by the loader thread, read by the render loop under `mutex`
+    Mesh mesh;
+    bool has_uvs;
+    MaterialInfo *materials;
+    size_t material_count;
+    // Decoded into directly; a material's pair is only read once its slot is ready
+    Texture *diffuse_textures;
+    Texture *normal_textures;
+    SceneTextureSlot *textures;
+    bool geometry_ready;
+    bool geometry_taken;
+    bool failed;
+    bool finished;
+    size_t textures_taken;
+
+    atomic_bool cancelled;
+    DcatMutex mutex;
+    DcatThread thread;
+    bool started;
+} SceneLoader;
+
+// Starts loading `model_path`; the texture and normal map overrides may be NULL
+bool scene_loader_start(SceneLoader *loader, const char *model_path, const char *texture_path,
+                        const char *normal_map_path, ChangeTracker *changes);
+
+// Once the geometry is loaded, moves the mesh and materials out and returns true; sets
+// *out_failed instead when the model could not be loaded. Texture decoding keeps reading
+// the materials, so they must outlive scene_loader_stop.
+bool scene_loader_take_geometry(SceneLoader *loader, Mesh *out_mesh, bool *out_has_uvs,
+                                MaterialInfo **out_materials, size_t *out_material_count,
+                                bool *out_failed);
+
+// Moves out one material's decoded textures that were not taken yet and returns true
+bool scene_loader_take_textures(SceneLoader *loader, size_t *out_material, Texture *out_diffuse,
+                                Texture *out_normal);
+
+// True once a successful load has had everything it produced taken
+bool scene_loader_done(SceneLoader *loader);
+
+// Cancels outstanding work, joins the thread and frees whatever was not taken
+void scene_loader_stop(SceneLoader *loader);
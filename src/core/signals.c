@@ -5,6 +5,7 @@
 #include <signal.h>
 #include <stdatomic.h>
 #ifndef _WIN32
+#include <fcntl.h>
 #include <unistd.h>
 #else
 #include <io.h>
@@ -15,6 +16,12 @@
 static atomic_bool g_running = true;
 static volatile sig_atomic_t g_resize_pending = 1;
 static volatile sig_atomic_t g_terminal_session_active = 0;
+// Signaled on every quit or resize request, for signals_wakeup_* waiters
+#ifdef _WIN32
+static HANDLE g_wakeup_event = NULL;
+#else
+static int g_wakeup_pipe[2] = {-1, -1};
+#endif
 
 static void set_atomic_flag(atomic_bool *flag, const bool value) {
     *flag = value;
@@ -24,18 +31,54 @@ static bool get_atomic_flag(const atomic_bool *flag) {
     return *flag;
 }
 
+// Async-signal-safe
+static void notify_wakeup(void) {
+#ifdef _WIN32
+    if (g_wakeup_event) {
+        SetEvent(g_wakeup_event);
+    }
+#else
+    if (g_wakeup_pipe[1] >= 0) {
+        const int saved_errno = errno;
+        const char byte = 0;
+        // A full pipe already wakes the reader, so a failed write loses nothing
+        const ssize_t written = write(g_wakeup_pipe[1], &byte, 1);
+        (void)written;
+        errno = saved_errno;
+    }
+#endif
+}
+
 static void signal_handler(const int sig) {
     (void)sig;
     set_atomic_flag(&g_running, false);
+    notify_wakeup();
 }
 
 #ifdef SIGWINCH
 static void resize_handler(int sig) {
     (void)sig;
     g_resize_pending = 1;
+    notify_wakeup();
 }
 #endif
 
+static void create_wakeup_channel(void) {
+#ifdef _WIN32
+    if (!g_wakeup_event) {
+        g_wakeup_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    }
+#else
+    if (g_wakeup_pipe[0] >= 0 || pipe(g_wakeup_pipe) != 0) {
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(g_wakeup_pipe[i], F_SETFL, fcntl(g_wakeup_pipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(g_wakeup_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+#endif
+}
+
 static void write_signal_literal(const int fd, const char *data, size_t size) {
     while (size > 0) {
 #ifdef _WIN32
@@ -98,6 +141,7 @@ static void fatal_signal_handler(const int sig) {
 void signals_init(void) {
     set_atomic_flag(&g_running, true);
     g_resize_pending = 0;
+    create_wakeup_channel();
 
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
@@ -136,6 +180,7 @@ bool signals_should_quit(void) {
 
 void signals_request_quit(void) {
     set_atomic_flag(&g_running, false);
+    notify_wakeup();
 }
 
 bool signals_is_resize_pending(void) {
@@ -148,6 +193,29 @@ void signals_clear_resize_pending(void) {
 
 void signals_request_resize(void) {
     g_resize_pending = 1;
+    notify_wakeup();
+}
+
+#ifdef _WIN32
+void *signals_wakeup_event(void) {
+    return g_wakeup_event;
+}
+#else
+int signals_wakeup_fd(void) {
+    return g_wakeup_pipe[0];
+}
+#endif
+
+void signals_drain_wakeup(void) {
+#ifdef _WIN32
+    if (g_wakeup_event) {
+        ResetEvent(g_wakeup_event);
+    }
+#else
+    char bytes[64];
+    while (g_wakeup_pipe[0] >= 0 && read(g_wakeup_pipe[0], bytes, sizeof(bytes)) > 0) {
+    }
+#endif
 }
 
 void signals_set_terminal_session_active(const bool active) {
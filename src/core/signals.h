@@ -7,5 +7,16 @@ void signals_request_quit(void);
 bool signals_is_resize_pending(void);
 void signals_clear_resize_pending(void);
 void signals_request_resize(void);
+
+// What a thread blocked on input also waits on, to wake for quit and resize requests: a
+// descriptor that polls readable on POSIX, an event HANDLE on Windows. -1 or NULL when it
+// could not be created, so waiters must fall back to a timeout.
+#ifdef _WIN32
+void *signals_wakeup_event(void);
+#else
+int signals_wakeup_fd(void);
+#endif
+// Clears the wakeups a waiter has woken for
+void signals_drain_wakeup(void);
 void signals_set_terminal_session_active(bool active);
 bool signals_is_terminal_session_active(void);
@@ -0,0 +1,241 @@
+#include "core/stream_client.h"
+#include "core/change_tracker.h"
+#include "core/frame_server.h"
+#include "core/signals.h"
+#include "core/threading.h"
+#include "core/time_utils.h"
+#include "input/input_handler.h"
+#include "platform/net.h"
+#include "terminal/block_encoder.h"
+#include "terminal/chafa_driver.h"
+#include "terminal/driver_factory.h"
+#include "terminal/iterm2_encoder.h"
+#include "terminal/kitty_direct.h"
+#include "terminal/output_pipeline.h"
+#include "terminal/session.h"
+#include "terminal/sixel_encoder.h"
+#include "terminal/terminal.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How long to wait for a frame before looking for quit and resize requests again
+#define STREAM_POLL_MS 100U
+
+typedef struct StreamClient {
+    const Args *args;
+    const OutputDriver *driver;
+    DcatSocket socket;
+    uint32_t display_width;
+    uint32_t display_height;
+    uint8_t *pixels; // the frame last received
+    size_t pixels_capacity;
+    uint8_t *scaled; // it resized to the display, for drivers that cannot stretch frames
+    size_t scaled_capacity;
+    double last_frame_time;
+
+    TerminalSession session;
+    OutputPipeline pipeline;
+    ChangeTracker changes;
+    InputCommands input_commands;
+    InputSnapshot input_snapshot;
+    InputThreadData input_data;
+    DcatThread input_thread;
+    bool input_thread_started;
+
+    // The first failure, printed once the terminal session has ended
+    char error[256];
+} StreamClient;
+
+static void report_error(StreamClient *client, const char *format, ...) {
+    if (client->error[0] != '\0') {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(client->error, sizeof(client->error), format, args);
+    va_end(args);
+}
+
+static bool reserve(uint8_t **buffer, size_t *capacity, const size_t size) {
+    if (*capacity >= size) {
+        return true;
+    }
+    uint8_t *grown = realloc(*buffer, size);
+    if (!grown) {
+        return false;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return true;
+}
+
+static void update_display_size(StreamClient *client) {
+    const bool use_hash = (client->args->use_hash_characters &&
+                           client->driver->uses_character_cells) != 0;
+    calculate_render_dimensions(client->args->width, client->args->height,
+                                !client->driver->uses_character_cells, use_hash,
+                                client->args->show_status_bar, &client->display_width,
+                                &client->display_height);
+}
+
+// Nearest-neighbour resize of an RGBA frame
+static void scale_frame(const uint8_t *src, const uint32_t src_width, const uint32_t src_height,
+                        uint8_t *dst, const uint32_t dst_width, const uint32_t dst_height) {
+    for (uint32_t y = 0; y < dst_height; y++) {
+        const uint32_t src_y = (uint32_t)(((uint64_t)y * src_height) / dst_height);
+        const uint32_t *src_row = (const uint32_t *)(src + ((size_t)src_y * src_width * 4U));
+        uint32_t *dst_row = (uint32_t *)(dst + ((size_t)y * dst_width * 4U));
+        for (uint32_t x = 0; x < dst_width; x++) {
+            dst_row[x] = src_row[((uint64_t)x * src_width) / dst_width];
+        }
+    }
+}
+
+// Reads the next frame and queues it for this terminal. False when the connection failed,
+// closed or sent something that is not a frame.
+static bool receive_frame(StreamClient *client) {
+    uint8_t header[FRAME_STREAM_HEADER_BYTES];
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (!dcat_net_recv_all(client->socket, header, sizeof(header))) {
+        report_error(client, "Connection to %s closed", client->args->connect_address);
+        return false;
+    }
+    if (!frame_stream_decode_header(header, &width, &height)) {
+        report_error(client, "%s is not sending dcat frames", client->args->connect_address);
+        return false;
+    }
+    const size_t size = (size_t)width * height * 4U;
+    if (!reserve(&client->pixels, &client->pixels_capacity, size)) {
+        report_error(client, "Failed to allocate a %ux%u frame", width, height);
+        return false;
+    }
+    if (!dcat_net_recv_all(client->socket, client->pixels, size)) {
+        report_error(client, "Connection to %s closed", client->args->connect_address);
+        return false;
+    }
+
+    const uint8_t *pixels = client->pixels;
+    if (!client->driver->supports_render_scale &&
+        (width != client->display_width || height != client->display_height)) {
+        const size_t scaled_size = (size_t)client->display_width * client->display_height * 4U;
+        if (!reserve(&client->scaled, &client->scaled_capacity, scaled_size)) {
+            report_error(client, "Failed to allocate a %ux%u frame", client->display_width,
+                         client->display_height);
+            return false;
+        }
+        scale_frame(client->pixels, width, height, client->scaled, client->display_width,
+                    client->display_height);
+        pixels = client->scaled;
+        width = client->display_width;
+        height = client->display_height;
+    }
+
+    const double now = get_time_seconds();
+    const double delta = now - client->last_frame_time;
+    client->last_frame_time = now;
+    const OutputStatus status = {.fps = delta > 0.0 ? (float)(1.0 / delta) : 0.0F};
+    const bool use_hash = (client->args->use_hash_characters &&
+                           client->driver->uses_character_cells) != 0;
+    if (!output_pipeline_submit(&client->pipeline, pixels, width, height,
+                                client->display_width, client->display_height, use_hash,
+                                client->args->show_status_bar, &status)) {
+        report_error(client, "Failed to queue frame for output");
+        return false;
+    }
+    return true;
+}
+
+static bool start_client(StreamClient *client) {
+    terminal_session_begin(&client->session, false);
+    const double adaptive_frame_time =
+        client->args->adaptive_output ? 1.0 / client->args->target_fps : 0.0;
+    if (!output_pipeline_start(&client->pipeline, client->driver, adaptive_frame_time, NULL)) {
+        report_error(client, "Failed to start output thread");
+        return false;
+    }
+    if (!change_tracker_init(&client->changes)) {
+        report_error(client, "Failed to initialize change tracker");
+        return false;
+    }
+    // Only for quitting with q: the camera belongs to the server
+    input_snapshot_init(&client->input_snapshot);
+    client->input_data = (InputThreadData){&client->input_commands,
+                                           &client->input_snapshot,
+                                           false,
+                                           false,
+                                           1.0F,
+                                           &client->changes};
+    if (!dcat_thread_create(&client->input_thread, input_thread_func, &client->input_data)) {
+        report_error(client, "Failed to start input thread");
+        return false;
+    }
+    client->input_thread_started = true;
+    // Before the first frame, with the input thread there to take the replies
+    chafa_driver_revalidate();
+    return true;
+}
+
+static void stop_client(StreamClient *client) {
+    signals_request_quit();
+    if (client->input_thread_started) {
+        dcat_thread_join(client->input_thread);
+    }
+    output_pipeline_stop(&client->pipeline);
+    chafa_driver_cleanup();
+    kitty_direct_cleanup();
+    sixel_cleanup();
+    iterm2_cleanup();
+    block_encoder_cleanup();
+    terminal_session_end(&client->session);
+    change_tracker_destroy(&client->changes);
+    free(client->pixels);
+    free(client->scaled);
+}
+
+int stream_client_run(const Args *args) {
+    if (!dcat_net_init()) {
+        return 1;
+    }
+    StreamClient client = {.args = args, .driver = driver_factory_get(args)};
+    // Cells are built by a GPU this process does not have
+    if (client.driver->cell_format != OUTPUT_CELLS_NONE) {
+        client.driver = driver_factory_pixel_fallback(client.driver);
+    }
+    client.socket = dcat_net_connect(args->connect_address);
+    if (client.socket == DCAT_INVALID_SOCKET) {
+        dcat_net_cleanup();
+        return 1;
+    }
+
+    signals_init();
+    update_display_size(&client);
+    client.last_frame_time = get_time_seconds();
+    bool ok = start_client(&client);
+    while (ok && !signals_should_quit()) {
+        if (signals_is_resize_pending()) {
+            signals_clear_resize_pending();
+            // The terminal may reflow or clear on resize, so the last written cells are unknown
+            output_pipeline_request_full_redraw(&client.pipeline);
+            update_display_size(&client);
+        }
+        const int ready = dcat_net_wait_readable(client.socket, STREAM_POLL_MS);
+        if (ready < 0) {
+            report_error(&client, "Connection to %s failed", args->connect_address);
+            ok = false;
+        } else if (ready > 0) {
+            ok = receive_frame(&client);
+        }
+    }
+
+    stop_client(&client);
+    dcat_net_close(client.socket);
+    dcat_net_cleanup();
+    if (client.error[0] != '\0') {
+        fprintf(stderr, "%s\n", client.error);
+    }
+    return ok ? 0 : 1;
+}
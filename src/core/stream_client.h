@@ -0,0 +1,8 @@
+#pragma once
+#include "core/args.h"
+
+// --connect: shows the frames a --serve process streams to args->connect_address, encoded
+// for this terminal with the output mode and size the args select. No model is loaded and
+// no renderer created. Returns the process exit code once the user quits (0) or the
+// connection fails or closes (1).
+int stream_client_run(const Args *args);
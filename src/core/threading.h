@@ -9,6 +9,7 @@
 #include <windows.h>
 
 typedef CRITICAL_SECTION DcatMutex;
+typedef CONDITION_VARIABLE DcatCond;
 typedef HANDLE DcatThread;
 typedef unsigned(__stdcall *DcatThreadFunc)(void *);
 
@@ -29,6 +30,32 @@ static void dcat_mutex_destroy(DcatMutex *mutex) {
     DeleteCriticalSection(mutex);
 }
 
+static bool dcat_cond_init(DcatCond *cond) {
+    InitializeConditionVariable(cond);
+    return true;
+}
+
+static void dcat_cond_wait(DcatCond *cond, DcatMutex *mutex) {
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+// Returns after a wakeup or once timeout_ms has elapsed, whichever comes first.
+static void dcat_cond_timed_wait(DcatCond *cond, DcatMutex *mutex, const unsigned int timeout_ms) {
+    SleepConditionVariableCS(cond, mutex, timeout_ms);
+}
+
+static void dcat_cond_signal(DcatCond *cond) {
+    WakeConditionVariable(cond);
+}
+
+static void dcat_cond_broadcast(DcatCond *cond) {
+    WakeAllConditionVariable(cond);
+}
+
+static void dcat_cond_destroy(DcatCond *cond) {
+    (void)cond;
+}
+
 static bool dcat_thread_create(DcatThread *thread, const DcatThreadFunc func, void *arg) {
     const uintptr_t handle = _beginthreadex(NULL, 0, func, arg, 0, NULL);
     if (handle == 0) {
@@ -50,12 +77,20 @@ static void dcat_sleep_ms(const unsigned int ms) {
     Sleep(ms);
 }
 
+static unsigned int dcat_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1U;
+}
+
 #else
 
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
 
 typedef pthread_mutex_t DcatMutex;
+typedef pthread_cond_t DcatCond;
 typedef pthread_t DcatThread;
 typedef void *(*DcatThreadFunc)(void *);
 
@@ -75,6 +110,39 @@ static inline void dcat_mutex_destroy(DcatMutex *mutex) {
     pthread_mutex_destroy(mutex);
 }
 
+static inline bool dcat_cond_init(DcatCond *cond) {
+    return pthread_cond_init(cond, NULL) == 0;
+}
+
+static inline void dcat_cond_wait(DcatCond *cond, DcatMutex *mutex) {
+    pthread_cond_wait(cond, mutex);
+}
+
+static inline void dcat_cond_timed_wait(DcatCond *cond, DcatMutex *mutex,
+                                        const unsigned int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(timeout_ms / 1000U);
+    deadline.tv_nsec += (long)(timeout_ms % 1000U) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(cond, mutex, &deadline);
+}
+
+static inline void dcat_cond_signal(DcatCond *cond) {
+    pthread_cond_signal(cond);
+}
+
+static inline void dcat_cond_broadcast(DcatCond *cond) {
+    pthread_cond_broadcast(cond);
+}
+
+static inline void dcat_cond_destroy(DcatCond *cond) {
+    pthread_cond_destroy(cond);
+}
+
 static inline bool dcat_thread_create(DcatThread *thread, DcatThreadFunc func, void *arg) {
     return pthread_create(thread, NULL, func, arg) == 0;
 }
@@ -90,4 +158,9 @@ static inline void dcat_sleep_ms(unsigned int ms) {
     nanosleep(&ts, NULL);
 }
 
+static inline unsigned int dcat_cpu_count(void) {
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1U;
+}
+
 #endif
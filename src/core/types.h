@@ -169,11 +169,29 @@ typedef struct Mat4Array {
     size_t capacity;
 } Mat4Array;
 
+#define MAX_SUBMESH_LODS 4
+
+// A simplified level of a sub-mesh; its indices follow every full-detail range
+typedef struct SubMeshLod {
+    uint32_t index_offset;
+    uint32_t index_count;
+    float error; // how far, in model units, the surface may have moved
+} SubMeshLod;
+
 // Sub-mesh: a range of indices sharing one material
 typedef struct SubMesh {
     uint32_t index_offset;
     uint32_t index_count;
     uint32_t material_index;
+    // Level 0 is the range above; lods[i - 1] is level i, coarsest last
+    uint32_t lod_count;
+    SubMeshLod lods[MAX_SUBMESH_LODS - 1];
+    // Bounding sphere in model space, used to project the level errors
+    float bounds_center[3];
+    float bounds_radius;
+    // Range of Mesh::meshlets splitting the full-detail range; empty for small sub-meshes
+    uint32_t meshlet_offset;
+    uint32_t meshlet_count;
 } SubMesh;
 
 typedef struct SubMeshArray {
@@ -182,6 +200,27 @@ typedef struct SubMeshArray {
     size_t capacity;
 } SubMeshArray;
 
+// A run of nearby triangles of one sub-mesh, culled as a unit. Laid out for std430, as the
+// culling shader reads it.
+typedef struct Meshlet {
+    // Bounding sphere in model space
+    float center[3];
+    float radius;
+    // Every triangle's normal lies within a cone around cone_axis; cone_cutoff is the sine
+    // of its half angle, or 1 when the triangles face too many ways to be culled as one
+    float cone_axis[3];
+    float cone_cutoff;
+    uint32_t index_offset;
+    uint32_t index_count;
+    uint32_t padding[2];
+} Meshlet;
+
+typedef struct MeshletArray {
+    Meshlet *data;
+    size_t count;
+    size_t capacity;
+} MeshletArray;
+
 // Alpha blending modes
 typedef enum AlphaMode { ALPHA_MODE_OPAQUE, ALPHA_MODE_MASK, ALPHA_MODE_BLEND } AlphaMode;
 
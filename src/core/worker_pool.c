@@ -0,0 +1,114 @@
+#include "core/worker_pool.h"
+
+#include <string.h>
+
+// Runs claimed tasks until none are left. Called and returns with the mutex held.
+static void drain_tasks(WorkerPool *pool) {
+    while (pool->next_index < pool->task_count) {
+        const uint32_t index = pool->next_index++;
+        const WorkerPoolTask task = pool->task;
+        void *context = pool->context;
+        dcat_mutex_unlock(&pool->mutex);
+        task(context, index);
+        dcat_mutex_lock(&pool->mutex);
+        if (--pool->remaining == 0) {
+            dcat_cond_broadcast(&pool->done_cond);
+        }
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall worker_thread_func(void *arg) {
+#else
+static void *worker_thread_func(void *arg) {
+#endif
+    WorkerPool *pool = arg;
+
+    dcat_mutex_lock(&pool->mutex);
+    while (!pool->stopping) {
+        if (pool->next_index < pool->task_count) {
+            drain_tasks(pool);
+            continue;
+        }
+        dcat_cond_wait(&pool->work_cond, &pool->mutex);
+    }
+    dcat_mutex_unlock(&pool->mutex);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool worker_pool_init(WorkerPool *pool, uint32_t thread_count) {
+    memset(pool, 0, sizeof(*pool));
+    if (thread_count > WORKER_POOL_MAX_THREADS) {
+        thread_count = WORKER_POOL_MAX_THREADS;
+    }
+
+    if (!dcat_mutex_init(&pool->mutex)) {
+        return false;
+    }
+    if (!dcat_cond_init(&pool->work_cond)) {
+        dcat_mutex_destroy(&pool->mutex);
+        return false;
+    }
+    if (!dcat_cond_init(&pool->done_cond)) {
+        dcat_cond_destroy(&pool->work_cond);
+        dcat_mutex_destroy(&pool->mutex);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < thread_count; i++) {
+        if (!dcat_thread_create(&pool->threads[i], worker_thread_func, pool)) {
+            break;
+        }
+        pool->thread_count++;
+    }
+    return true;
+}
+
+void worker_pool_run(WorkerPool *pool, const uint32_t count, const WorkerPoolTask task,
+                     void *context) {
+    if (count == 0) {
+        return;
+    }
+    if (pool->thread_count == 0 || count == 1) {
+        for (uint32_t i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+
+    dcat_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->context = context;
+    pool->task_count = count;
+    pool->next_index = 0;
+    pool->remaining = count;
+    dcat_cond_broadcast(&pool->work_cond);
+
+    drain_tasks(pool);
+    while (pool->remaining > 0) {
+        dcat_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+    pool->task_count = 0;
+    pool->next_index = 0;
+    dcat_mutex_unlock(&pool->mutex);
+}
+
+void worker_pool_destroy(WorkerPool *pool) {
+    dcat_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    dcat_cond_broadcast(&pool->work_cond);
+    dcat_mutex_unlock(&pool->mutex);
+    for (uint32_t i = 0; i < pool->thread_count; i++) {
+        dcat_thread_join(pool->threads[i]);
+    }
+
+    dcat_cond_destroy(&pool->done_cond);
+    dcat_cond_destroy(&pool->work_cond);
+    dcat_mutex_destroy(&pool->mutex);
+    memset(pool, 0, sizeof(*pool));
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "core/threading.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define WORKER_POOL_MAX_THREADS 32
+
+typedef void (*WorkerPoolTask)(void *context, uint32_t index);
+
+// Fixed set of threads that run indexed tasks on demand. The calling thread takes
+// part in every run, so a pool with zero threads still works, just serially.
+typedef struct WorkerPool {
+    DcatThread threads[WORKER_POOL_MAX_THREADS];
+    uint32_t thread_count;
+
+    DcatMutex mutex;
+    DcatCond work_cond;
+    DcatCond done_cond;
+    WorkerPoolTask task;
+    void *context;
+    uint32_t task_count;
+    uint32_t next_index;
+    uint32_t remaining;
+    bool stopping;
+} WorkerPool;
+
+bool worker_pool_init(WorkerPool *pool, uint32_t thread_count);
+// Calls task(context, i) for every i in [0, count) and returns once all have finished.
+void worker_pool_run(WorkerPool *pool, uint32_t count, WorkerPoolTask task, void *context);
+void worker_pool_destroy(WorkerPool *pool);
@@ -1,15 +1,45 @@
 #include "animation.h"
 #include "model.h"
+#include <float.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Frames times channels one animation may resample to, about 40 MiB of tracks
+#define MAX_ANIMATION_SAMPLES (1U << 20)
+
+// How far animation_compress lets a track stray from its keys: positions by this fraction of
+// the typical bone's offset from its parent, rotations by this many radians, and scales by
+// this much
+#define COMPRESS_POSITION_TOLERANCE 1e-3F
+#define COMPRESS_ROTATION_TOLERANCE 1e-3F
+#define COMPRESS_SCALE_TOLERANCE 1e-3F
+// Most keys one pair of kept keys may stand in for, which bounds the fitting work
+#define COMPRESS_MAX_SPAN 256U
+// Largest magnitude of the three components a unit quaternion keeps besides its largest
+#define SMALLEST_THREE_RANGE 0.70710678F
+// Most a rotation moves, in radians, when encode_rotation rounds each of its three
+// components by up to half a 15-bit step: sqrt(6) steps of quaternion distance, with the
+// angle about twice the distance
+#define ROTATION_QUANTIZATION_ERROR (2.0F * 2.4494897F * SMALLEST_THREE_RANGE / 32767.0F)
+
+static float resample_rate = 0.0F;
+static float bake_rate = 0.0F;
+
 void animation_state_init(AnimationState *state) {
     state->current_animation_index = 0;
     state->current_time = 0.0F;
     state->playing = true;
     state->last_animation_index = -1;
     state->last_computed_time = -1.0F;
+    state->key_cursors = NULL;
+    state->key_cursor_count = 0;
+    state->cursor_animation = -1;
+}
+
+void animation_state_free(AnimationState *state) {
+    free(state->key_cursors);
+    animation_state_init(state);
 }
 
 void bone_map_init(BoneMap *map) {
@@ -133,8 +163,39 @@ static int find_key_index(const void *data, const size_t count, const size_t str
     return left;
 }
 
+// find_key_index starting from the key `cursor` found last time, then storing the result
+// there. Sequential playback lands on the same or the next key, which skips the search.
+static int find_key_index_near(const void *data, const size_t count, const size_t stride,
+                               const float time, uint32_t *cursor) {
+    if (!cursor) {
+        return find_key_index(data, count, stride, time);
+    }
+
+    const char *keys = data;
+    const size_t start = *cursor;
+    if (start < count && time > *(const float *)keys &&
+        *(const float *)(keys + (start * stride)) <= time) {
+        for (size_t index = start; index < count && index <= start + 1; index++) {
+            if (index + 1 == count || time < *(const float *)(keys + ((index + 1) * stride))) {
+                *cursor = (uint32_t)index;
+                return (int)index;
+            }
+        }
+    }
+
+    const int index = find_key_index(data, count, stride, time);
+    *cursor = (uint32_t)index;
+    return index;
+}
+
+// How far `time` is from a key at `start` towards the next at `end`
+static float key_blend(const float start, const float end, const float time) {
+    const float span = end - start;
+    return span > 0.00001F ? clampf((time - start) / span, 0.0F, 1.0F) : 0.0F;
+}
+
 static void interpolate_vec3_keys(const VectorKeyArray *keys, float time, const vec3 default_value,
-                                  vec3 out) {
+                                  uint32_t *cursor, vec3 out) {
     if (keys->count == 0) {
         glm_vec3_copy((float *)default_value, out);
         return;
@@ -144,7 +205,7 @@ static void interpolate_vec3_keys(const VectorKeyArray *keys, float time, const
         return;
     }
 
-    const int index = find_key_index(keys->data, keys->count, sizeof(VectorKey), time);
+    const int index = find_key_index_near(keys->data, keys->count, sizeof(VectorKey), time, cursor);
     const int next_index = index + 1;
 
     if (next_index >= (int)keys->count) {
@@ -152,25 +213,20 @@ static void interpolate_vec3_keys(const VectorKeyArray *keys, float time, const
         return;
     }
 
-    const float delta_time = keys->data[next_index].time - keys->data[index].time;
-    float factor = 0.0F;
-    if (delta_time > 0.00001F) {
-        factor = (time - keys->data[index].time) / delta_time;
-    }
-    factor = clampf(factor, 0.0F, 1.0F);
-
+    const float factor = key_blend(keys->data[index].time, keys->data[next_index].time, time);
     glm_vec3_lerp(keys->data[index].value, keys->data[next_index].value, factor, out);
 }
 
 void interpolate_position(const VectorKeyArray *keys, const float time, vec3 out) {
-    interpolate_vec3_keys(keys, time, (vec3){0.0F, 0.0F, 0.0F}, out);
+    interpolate_vec3_keys(keys, time, (vec3){0.0F, 0.0F, 0.0F}, NULL, out);
 }
 
 void interpolate_scale(const VectorKeyArray *keys, const float time, vec3 out) {
-    interpolate_vec3_keys(keys, time, (vec3){1.0F, 1.0F, 1.0F}, out);
+    interpolate_vec3_keys(keys, time, (vec3){1.0F, 1.0F, 1.0F}, NULL, out);
 }
 
-void interpolate_rotation(const QuaternionKeyArray *keys, const float time, versor out) {
+static void interpolate_quat_keys(const QuaternionKeyArray *keys, const float time,
+                                  uint32_t *cursor, versor out) {
     if (keys->count == 0) {
         glm_quat_identity(out);
         return;
@@ -180,7 +236,8 @@ void interpolate_rotation(const QuaternionKeyArray *keys, const float time, vers
         return;
     }
 
-    const int index = find_key_index(keys->data, keys->count, sizeof(QuaternionKey), time);
+    const int index =
+        find_key_index_near(keys->data, keys->count, sizeof(QuaternionKey), time, cursor);
     const int next_index = index + 1;
 
     if (next_index >= (int)keys->count) {
@@ -188,13 +245,7 @@ void interpolate_rotation(const QuaternionKeyArray *keys, const float time, vers
         return;
     }
 
-    const float delta_time = keys->data[next_index].time - keys->data[index].time;
-    float factor = 0.0F;
-    if (delta_time > 0.00001F) {
-        factor = (time - keys->data[index].time) / delta_time;
-    }
-    factor = clampf(factor, 0.0F, 1.0F);
-
+    const float factor = key_blend(keys->data[index].time, keys->data[next_index].time, time);
     versor start;
     versor end;
     glm_quat_copy(keys->data[index].value, start);
@@ -208,91 +259,478 @@ void interpolate_rotation(const QuaternionKeyArray *keys, const float time, vers
     glm_quat_normalize(out);
 }
 
-static void compute_bone_transform(const Skeleton *skeleton, const Animation *animation,
-                                   int bone_index, float time, mat4 parent_transform,
-                                   mat4 *bone_matrices) {
-    const BoneNode *node = &skeleton->bone_hierarchy.data[bone_index];
-    mat4 node_transform;
-    glm_mat4_copy((vec4 *)node->transformation, node_transform);
+void interpolate_rotation(const QuaternionKeyArray *keys, const float time, versor out) {
+    interpolate_quat_keys(keys, time, NULL, out);
+}
+
+static const float *track_times(const CompressedTracks *compressed, const CompressedTrack *track) {
+    return (const float *)((const uint8_t *)compressed->tracks + track->times);
+}
+
+static const uint16_t *track_values(const CompressedTracks *compressed,
+                                    const CompressedTrack *track) {
+    return (const uint16_t *)((const uint8_t *)compressed->tracks + track->values);
+}
+
+static void decode_vector(const CompressedTrack *track, const uint16_t *value, vec3 out) {
+    for (int i = 0; i < 3; i++) {
+        out[i] = track->value[i] + ((float)value[i] * track->step[i]);
+    }
+}
+
+// Smallest three: each component but the largest in 15 bits, and which one is the largest
+// in the low bits of the first two. The largest is positive, so it follows from the rest.
+static void decode_rotation(const uint16_t *value, versor out) {
+    const int largest = (value[0] & 1U) | ((value[1] & 1U) << 1);
+    float sum = 0.0F;
+    int component = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) {
+            continue;
+        }
+        const float unit = (float)(value[component++] >> 1) / 32767.0F;
+        out[i] = ((unit * 2.0F) - 1.0F) * SMALLEST_THREE_RANGE;
+        sum += out[i] * out[i];
+    }
+    out[largest] = sqrtf(fmaxf(1.0F - sum, 0.0F));
+}
 
-    // Fast O(1) lookup using hash map instead of O(n) linear search
-    const BoneAnimation *bone_anim = NULL;
-    if (animation->bone_anim_map.count > 0) {
-        const int anim_idx = bone_anim_map_find(&animation->bone_anim_map, node->name);
-        if (anim_idx >= 0 && anim_idx < (int)animation->bone_animations.count) {
-            bone_anim = &animation->bone_animations.data[anim_idx];
+static void encode_rotation(const versor rotation, uint16_t *out) {
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(rotation[i]) > fabsf(rotation[largest])) {
+            largest = i;
+        }
+    }
+    const float sign = rotation[largest] < 0.0F ? -1.0F : 1.0F;
+    int component = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) {
+            continue;
         }
+        const float unit = ((rotation[i] * sign / SMALLEST_THREE_RANGE) + 1.0F) * 0.5F;
+        out[component++] = (uint16_t)(lroundf(clampf(unit, 0.0F, 1.0F) * 32767.0F) << 1);
     }
+    out[0] |= (uint16_t)(largest & 1);
+    out[1] |= (uint16_t)((largest >> 1) & 1);
+}
 
-    if (bone_anim) {
-        vec3 position;
-        vec3 scale;
-        versor rotation;
+// interpolate_vec3_keys for a compressed track, decoding the two keys around `time`
+static void interpolate_vector_track(const CompressedTracks *compressed,
+                                     const CompressedTrack *track, const float time,
+                                     const vec3 default_value, uint32_t *cursor, vec3 out) {
+    if (track->key_count <= 1) {
+        glm_vec3_copy(track->key_count == 0 ? (float *)default_value : (float *)track->value,
+                      out);
+        return;
+    }
+
+    const float *times = track_times(compressed, track);
+    const uint16_t *values = track_values(compressed, track);
+    const int index = find_key_index_near(times, track->key_count, sizeof(float), time, cursor);
+    vec3 start;
+    decode_vector(track, &values[(size_t)index * 3], start);
+    if ((uint32_t)index + 1 >= track->key_count) {
+        glm_vec3_copy(start, out);
+        return;
+    }
 
-        if (bone_anim->position_keys.count == 0) {
-            glm_vec3_copy((float *)node->initial_position, position);
+    vec3 end;
+    decode_vector(track, &values[((size_t)index + 1) * 3], end);
+    glm_vec3_lerp(start, end, key_blend(times[index], times[index + 1], time), out);
+}
+
+// interpolate_quat_keys for a compressed track
+static void interpolate_rotation_track(const CompressedTracks *compressed,
+                                       const CompressedTrack *track, const float time,
+                                       uint32_t *cursor, versor out) {
+    if (track->key_count <= 1) {
+        if (track->key_count == 0) {
+            glm_quat_identity(out);
         } else {
-            interpolate_position(&bone_anim->position_keys, time, position);
+            glm_quat_copy((float *)track->value, out);
         }
+        return;
+    }
 
-        if (bone_anim->rotation_keys.count == 0) {
-            glm_quat_copy((float *)node->initial_rotation, rotation);
-        } else {
-            interpolate_rotation(&bone_anim->rotation_keys, time, rotation);
+    const float *times = track_times(compressed, track);
+    const uint16_t *values = track_values(compressed, track);
+    const int index = find_key_index_near(times, track->key_count, sizeof(float), time, cursor);
+    versor start;
+    decode_rotation(&values[(size_t)index * 3], start);
+    if ((uint32_t)index + 1 >= track->key_count) {
+        glm_quat_copy(start, out);
+        return;
+    }
+
+    versor end;
+    decode_rotation(&values[((size_t)index + 1) * 3], end);
+    if (glm_quat_dot(start, end) < 0.0F) {
+        glm_vec4_negate(end);
+    }
+    glm_quat_slerp(start, end, key_blend(times[index], times[index + 1], time), out);
+    glm_quat_normalize(out);
+}
+
+size_t animation_channel_count(const Animation *animation) {
+    return animation->compressed ? animation->compressed->channel_count
+                                 : animation->bone_animations.count;
+}
+
+// ANIMATION_KEYS_* of the kinds of keys channel `channel` has
+static uint8_t channel_keys(const Animation *animation, const size_t channel) {
+    size_t counts[3];
+    if (animation->compressed) {
+        const CompressedTrack *tracks = &animation->compressed->tracks[channel * 3];
+        for (int i = 0; i < 3; i++) {
+            counts[i] = tracks[i].key_count;
         }
+    } else {
+        const BoneAnimation *bone_anim = &animation->bone_animations.data[channel];
+        counts[0] = bone_anim->position_keys.count;
+        counts[1] = bone_anim->rotation_keys.count;
+        counts[2] = bone_anim->scale_keys.count;
+    }
+    return (uint8_t)((counts[0] > 0 ? ANIMATION_KEYS_POSITION : 0U) |
+                     (counts[1] > 0 ? ANIMATION_KEYS_ROTATION : 0U) |
+                     (counts[2] > 0 ? ANIMATION_KEYS_SCALE : 0U));
+}
 
-        if (bone_anim->scale_keys.count == 0) {
-            glm_vec3_copy((float *)node->initial_scale, scale);
-        } else {
-            interpolate_scale(&bone_anim->scale_keys, time, scale);
+// Channel `channel` at `time`, from its compressed tracks or its keys; kinds without keys
+// come out as the identity. `cursors` holds the position, rotation and scale cursors, or is
+// NULL.
+static void sample_channel(const Animation *animation, const size_t channel, const float time,
+                           uint32_t *cursors, vec3 position, versor rotation, vec3 scale) {
+    uint32_t *position_cursor = cursors ? &cursors[0] : NULL;
+    uint32_t *rotation_cursor = cursors ? &cursors[1] : NULL;
+    uint32_t *scale_cursor = cursors ? &cursors[2] : NULL;
+    const CompressedTracks *compressed = animation->compressed;
+    if (compressed) {
+        const CompressedTrack *tracks = &compressed->tracks[channel * 3];
+        interpolate_vector_track(compressed, &tracks[0], time, (vec3){0.0F, 0.0F, 0.0F},
+                                 position_cursor, position);
+        interpolate_rotation_track(compressed, &tracks[1], time, rotation_cursor, rotation);
+        interpolate_vector_track(compressed, &tracks[2], time, (vec3){1.0F, 1.0F, 1.0F},
+                                 scale_cursor, scale);
+        return;
+    }
+
+    const BoneAnimation *bone_anim = &animation->bone_animations.data[channel];
+    interpolate_vec3_keys(&bone_anim->position_keys, time, (vec3){0.0F, 0.0F, 0.0F},
+                          position_cursor, position);
+    interpolate_quat_keys(&bone_anim->rotation_keys, time, rotation_cursor, rotation);
+    interpolate_vec3_keys(&bone_anim->scale_keys, time, (vec3){1.0F, 1.0F, 1.0F}, scale_cursor,
+                          scale);
+}
+
+static void compose_local_transform(const vec3 position, const versor rotation, const vec3 scale,
+                                    mat4 out) {
+    mat4 translation_matrix;
+    mat4 rotation_matrix;
+    mat4 scale_matrix;
+    glm_translate_make(translation_matrix, (float *)position);
+    glm_quat_mat4((float *)rotation, rotation_matrix);
+    glm_scale_make(scale_matrix, (float *)scale);
+
+    glm_mat4_mul(translation_matrix, rotation_matrix, out);
+    glm_mat4_mul(out, scale_matrix, out);
+}
+
+void bone_node_set_transform(BoneNode *node, mat4 transformation) {
+    glm_mat4_copy(transformation, node->transformation);
+    glm_vec3_copy(transformation[3], node->initial_position);
+    for (int i = 0; i < 3; i++) {
+        node->initial_scale[i] = glm_vec3_norm(transformation[i]);
+    }
+
+    // Rotation from the normalized matrix columns
+    if (node->initial_scale[0] > 0.0001F && node->initial_scale[1] > 0.0001F &&
+        node->initial_scale[2] > 0.0001F) {
+        mat3 rotation;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                rotation[i][j] = transformation[i][j] / node->initial_scale[i];
+            }
         }
+        glm_mat3_quat(rotation, node->initial_rotation);
+    } else {
+        glm_quat_identity(node->initial_rotation);
+    }
+}
+
+// The node's local transform at `time`: its channel's keys, or its bind pose without one
+// (`channel` -1). `cursors` holds the channel's position, rotation and scale cursors, or is
+// NULL.
+static void node_local_transform(const BoneNode *node, const Animation *animation,
+                                 const int channel, const float time, uint32_t *cursors,
+                                 mat4 out) {
+    if (channel < 0) {
+        glm_mat4_copy((vec4 *)node->transformation, out);
+        return;
+    }
+
+    vec3 position;
+    vec3 scale;
+    versor rotation;
+    sample_channel(animation, (size_t)channel, time, cursors, position, rotation, scale);
+
+    const uint8_t keys = channel_keys(animation, (size_t)channel);
+    if (!(keys & ANIMATION_KEYS_POSITION)) {
+        glm_vec3_copy((float *)node->initial_position, position);
+    }
+    if (!(keys & ANIMATION_KEYS_ROTATION)) {
+        glm_quat_copy((float *)node->initial_rotation, rotation);
+    }
+    if (!(keys & ANIMATION_KEYS_SCALE)) {
+        glm_vec3_copy((float *)node->initial_scale, scale);
+    }
 
-        mat4 translation_matrix;
-        mat4 rotation_matrix;
-        mat4 scale_matrix;
-        glm_translate_make(translation_matrix, position);
-        glm_quat_mat4(rotation, rotation_matrix);
-        glm_scale_make(scale_matrix, scale);
+    compose_local_transform(position, rotation, scale, out);
+}
+
+// The same from a resampled channel's entry in samples->pose
+static void node_sampled_transform(const BoneNode *node, const AnimationSamples *samples,
+                                   const int channel, mat4 out) {
+    const size_t count = samples->channel_count;
+    const uint8_t keys = samples->channel_keys[channel];
+    const float *position = (keys & ANIMATION_KEYS_POSITION) ? &samples->pose[(size_t)channel * 3]
+                                                             : node->initial_position;
+    const float *rotation = (keys & ANIMATION_KEYS_ROTATION)
+                                ? &samples->pose[(count * 3) + ((size_t)channel * 4)]
+                                : node->initial_rotation;
+    const float *scale = (keys & ANIMATION_KEYS_SCALE)
+                             ? &samples->pose[(count * 7) + ((size_t)channel * 3)]
+                             : node->initial_scale;
+    compose_local_transform(position, rotation, scale, out);
+}
 
-        glm_mat4_mul(translation_matrix, rotation_matrix, node_transform);
-        glm_mat4_mul(node_transform, scale_matrix, node_transform);
+// The frame of a fixed-rate track at or before `time`, and how far `time` is towards the
+// next one. The last frame sits at `duration`, which may be less than a step after the one
+// before it.
+static uint32_t locate_frame(const float step, const float duration, const uint32_t frame_count,
+                             const float time, float *factor) {
+    *factor = 0.0F;
+    if (!(time > 0.0F)) {
+        return 0;
+    }
+    const float position = time / step;
+    if (position >= (float)(frame_count - 1)) {
+        return frame_count - 1;
     }
+    const uint32_t frame = (uint32_t)position;
+    if (frame + 1 >= frame_count) {
+        return frame_count - 1;
+    }
+    const float start = (float)frame * step;
+    const float span = fminf((float)(frame + 1) * step, duration) - start;
+    *factor = span > 0.00001F ? clampf((time - start) / span, 0.0F, 1.0F) : 0.0F;
+    return frame;
+}
+
+// Fills samples->pose at `time` from the two frames around it: a lerp over each frame's
+// contiguous positions and scales, and a normalized lerp of the rotations
+static void sample_pose(const AnimationSamples *samples, const float time) {
+    const size_t count = samples->channel_count;
+    float factor = 0.0F;
+    const size_t frame =
+        locate_frame(samples->step, samples->duration, samples->frame_count, time, &factor);
+    const size_t next = frame + 1 < samples->frame_count ? frame + 1 : frame;
 
-    mat4 global_transform;
-    glm_mat4_mul(parent_transform, node_transform, global_transform);
+    float *restrict positions = samples->pose;
+    float *restrict rotations = samples->pose + (count * 3);
+    float *restrict scales = samples->pose + (count * 7);
 
-    const int bone_idx = bone_map_find(&skeleton->bone_map, node->name);
-    if (bone_idx >= 0 && bone_idx < MAX_BONES) {
-        mat4 temp;
-        glm_mat4_mul((vec4 *)skeleton->global_inverse_transform, global_transform, temp);
-        glm_mat4_mul(temp, skeleton->bones.data[bone_idx].offset_matrix, bone_matrices[bone_idx]);
+    const float *restrict p0 = samples->positions + (frame * count * 3);
+    const float *restrict p1 = samples->positions + (next * count * 3);
+    const float *restrict s0 = samples->scales + (frame * count * 3);
+    const float *restrict s1 = samples->scales + (next * count * 3);
+    for (size_t i = 0; i < count * 3; i++) {
+        positions[i] = p0[i] + ((p1[i] - p0[i]) * factor);
+        scales[i] = s0[i] + ((s1[i] - s0[i]) * factor);
     }
 
-    for (size_t i = 0; i < node->child_indices.count; i++) {
-        compute_bone_transform(skeleton, animation, node->child_indices.data[i], time,
-                               global_transform, bone_matrices);
+    // animation_resample keeps neighbouring frames in the same hemisphere, so no sign fix
+    const float *restrict r0 = samples->rotations + (frame * count * 4);
+    const float *restrict r1 = samples->rotations + (next * count * 4);
+    for (size_t i = 0; i < count * 4; i++) {
+        rotations[i] = r0[i] + ((r1[i] - r0[i]) * factor);
+    }
+    for (size_t c = 0; c < count; c++) {
+        float *q = &rotations[c * 4];
+        const float length = sqrtf((q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+        const float scale = length > 0.0F ? 1.0F / length : 0.0F;
+        q[0] *= scale;
+        q[1] *= scale;
+        q[2] *= scale;
+        q[3] *= scale;
     }
 }
 
-void compute_bone_matrices(const Skeleton *skeleton, const Animation *animation, float time,
-                           mat4 *bone_matrices) {
-    if (skeleton->bone_hierarchy.count == 0) {
+void animation_bind_skeleton(Animation *animation, const Skeleton *skeleton) {
+    free(animation->bone_node_to_anim);
+    animation->bone_node_to_anim = malloc(skeleton->bone_hierarchy.count * sizeof(int));
+    if (!animation->bone_node_to_anim) {
         return;
     }
+    for (size_t i = 0; i < skeleton->bone_hierarchy.count; i++) {
+        const char *node_name = skeleton->bone_hierarchy.data[i].name;
+        animation->bone_node_to_anim[i] = bone_anim_map_find(&animation->bone_anim_map, node_name);
+    }
+}
+
+static void skeleton_flat_free(Skeleton *skeleton) {
+    free(skeleton->node_order);
+    free(skeleton->node_bones);
+    free(skeleton->unposed_bones);
+    aligned_free(skeleton->node_globals);
+    skeleton->node_order = NULL;
+    skeleton->node_order_count = 0;
+    skeleton->node_bones = NULL;
+    skeleton->unposed_bones = NULL;
+    skeleton->unposed_bone_count = 0;
+    skeleton->node_globals = NULL;
+}
 
-    for (uint32_t i = 0; i < MAX_BONES; i++) {
-        glm_mat4_identity(bone_matrices[i]);
+bool skeleton_flatten(Skeleton *skeleton) {
+    skeleton_flat_free(skeleton);
+    const size_t node_count = skeleton->bone_hierarchy.count;
+    const size_t bone_count = skeleton->bones.count;
+    if (node_count == 0) {
+        return true;
     }
 
-    for (size_t i = 0; i < skeleton->bone_hierarchy.count; i++) {
+    skeleton->node_order = malloc(node_count * sizeof(int));
+    skeleton->node_bones = malloc(node_count * sizeof(int));
+    skeleton->node_globals = aligned_malloc(node_count * sizeof(mat4));
+    bool *queued = calloc(node_count, sizeof(bool));
+    bool *posed = calloc(bone_count > 0 ? bone_count : 1, sizeof(bool));
+    if (!skeleton->node_order || !skeleton->node_bones || !skeleton->node_globals || !queued ||
+        !posed) {
+        free(queued);
+        free(posed);
+        skeleton_flat_free(skeleton);
+        return false;
+    }
+
+    // Breadth first from every root, using the order itself as the queue; a node already
+    // queued is not queued again, so malformed child lists cannot loop
+    size_t count = 0;
+    for (size_t i = 0; i < node_count; i++) {
         if (skeleton->bone_hierarchy.data[i].parent_index == -1) {
-            mat4 identity;
-            glm_mat4_identity(identity);
-            compute_bone_transform(skeleton, animation, (int)i, time, identity, bone_matrices);
+            queued[i] = true;
+            skeleton->node_order[count++] = (int)i;
+        }
+    }
+    for (size_t head = 0; head < count; head++) {
+        const BoneNode *node = &skeleton->bone_hierarchy.data[skeleton->node_order[head]];
+        for (size_t c = 0; c < node->child_indices.count; c++) {
+            const int child = node->child_indices.data[c];
+            if (child >= 0 && (size_t)child < node_count && !queued[child]) {
+                queued[child] = true;
+                skeleton->node_order[count++] = child;
+            }
+        }
+    }
+    skeleton->node_order_count = count;
+    free(queued);
+
+    for (size_t i = 0; i < node_count; i++) {
+        const int bone = bone_map_find(&skeleton->bone_map, skeleton->bone_hierarchy.data[i].name);
+        skeleton->node_bones[i] = bone >= 0 && (size_t)bone < bone_count ? bone : -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const int bone = skeleton->node_bones[skeleton->node_order[i]];
+        if (bone >= 0) {
+            posed[bone] = true;
+        }
+    }
+
+    size_t unposed = 0;
+    for (size_t i = 0; i < bone_count; i++) {
+        unposed += posed[i] ? 0U : 1U;
+    }
+    if (unposed > 0) {
+        skeleton->unposed_bones = malloc(unposed * sizeof(int));
+        if (!skeleton->unposed_bones) {
+            free(posed);
+            skeleton_flat_free(skeleton);
+            return false;
+        }
+        for (size_t i = 0; i < bone_count; i++) {
+            if (!posed[i]) {
+                skeleton->unposed_bones[skeleton->unposed_bone_count++] = (int)i;
+            }
+        }
+    }
+    free(posed);
+    return true;
+}
+
+// compute_bone_matrices for the bones below `bone_limit`
+static void evaluate_pose(const Skeleton *skeleton, const Animation *animation, const float time,
+                          uint32_t *key_cursors, mat4 *bone_matrices, const int bone_limit) {
+    if (!skeleton->node_order) {
+        return;
+    }
+
+    const AnimationSamples *samples = animation->samples;
+    if (samples) {
+        sample_pose(samples, time);
+    }
+
+    for (size_t i = 0; i < skeleton->unposed_bone_count; i++) {
+        if (skeleton->unposed_bones[i] < bone_limit) {
+            glm_mat4_identity(bone_matrices[skeleton->unposed_bones[i]]);
+        }
+    }
+
+    // Parents come first, so every parent's global transform is ready when a child reads it
+    const int channel_count = (int)animation_channel_count(animation);
+    for (size_t i = 0; i < skeleton->node_order_count; i++) {
+        const int node_index = skeleton->node_order[i];
+        const BoneNode *node = &skeleton->bone_hierarchy.data[node_index];
+
+        int anim_idx = -1;
+        if (animation->bone_node_to_anim) {
+            anim_idx = animation->bone_node_to_anim[node_index];
+        } else if (animation->bone_anim_map.count > 0) {
+            anim_idx = bone_anim_map_find(&animation->bone_anim_map, node->name);
+        }
+        const int channel = anim_idx >= 0 && anim_idx < channel_count ? anim_idx : -1;
+
+        mat4 node_transform;
+        if (channel >= 0 && samples) {
+            node_sampled_transform(node, samples, channel, node_transform);
+        } else {
+            node_local_transform(node, animation, channel, time,
+                                 channel >= 0 && key_cursors ? &key_cursors[(size_t)channel * 3]
+                                                             : NULL,
+                                 node_transform);
+        }
+
+        vec4 *global_transform = skeleton->node_globals[node_index];
+        if (node->parent_index >= 0) {
+            glm_mat4_mul(skeleton->node_globals[node->parent_index], node_transform,
+                         global_transform);
+        } else {
+            glm_mat4_copy(node_transform, global_transform);
+        }
+
+        const int bone_idx = skeleton->node_bones[node_index];
+        if (bone_idx >= 0 && bone_idx < bone_limit) {
+            mat4 temp;
+            glm_mat4_mul((vec4 *)skeleton->global_inverse_transform, global_transform, temp);
+            glm_mat4_mul(temp, skeleton->bones.data[bone_idx].offset_matrix,
+                         bone_matrices[bone_idx]);
         }
     }
 }
 
+void compute_bone_matrices(const Skeleton *skeleton, const Animation *animation, float time,
+                           uint32_t *key_cursors, mat4 *bone_matrices) {
+    evaluate_pose(skeleton, animation, time, key_cursors, bone_matrices, MAX_BONES);
+}
+
 void update_animation(const Mesh *mesh, AnimationState *state, float delta_time,
                       mat4 *bone_matrices) {
     if (!mesh->has_animations || mesh->animations.count == 0) {
@@ -325,11 +763,516 @@ void update_animation(const Mesh *mesh, AnimationState *state, float delta_time,
         return;
     }
 
-    compute_bone_matrices(&mesh->skeleton, animation, state->current_time, bone_matrices);
+    // Cursors belong to one animation's channels; switching starts them over
+    const size_t cursor_count = animation_channel_count(animation) * 3;
+    if (state->cursor_animation != state->current_animation_index ||
+        state->key_cursor_count != cursor_count) {
+        free(state->key_cursors);
+        state->key_cursors = cursor_count > 0 ? calloc(cursor_count, sizeof(uint32_t)) : NULL;
+        state->key_cursor_count = state->key_cursors ? cursor_count : 0;
+        state->cursor_animation = state->current_animation_index;
+    }
+
+    compute_bone_matrices(&mesh->skeleton, animation, state->current_time, state->key_cursors,
+                          bone_matrices);
     state->last_animation_index = state->current_animation_index;
     state->last_computed_time = state->current_time;
 }
 
+void animation_set_resample_rate(const float samples_per_second) {
+    resample_rate = samples_per_second > 0.0F ? samples_per_second : 0.0F;
+}
+
+float animation_get_resample_rate(void) {
+    return resample_rate;
+}
+
+static void animation_samples_free(AnimationSamples *samples) {
+    if (!samples) {
+        return;
+    }
+    aligned_free(samples->positions);
+    aligned_free(samples->rotations);
+    aligned_free(samples->scales);
+    free(samples->channel_keys);
+    aligned_free(samples->pose);
+    free(samples);
+}
+
+bool animation_resample(Animation *animation, const float samples_per_second) {
+    const size_t channel_count = animation_channel_count(animation);
+    const float ticks_per_second =
+        animation->ticks_per_second != 0.0F ? animation->ticks_per_second : 25.0F;
+    if (samples_per_second <= 0.0F || !(animation->duration > 0.0F) || channel_count == 0) {
+        return false;
+    }
+
+    const float step = ticks_per_second / samples_per_second;
+    const float frames = ceilf(animation->duration / step) + 1.0F;
+    if (!(step > 0.0F) || !(frames * (float)channel_count <= (float)MAX_ANIMATION_SAMPLES)) {
+        return false;
+    }
+    const size_t frame_count = (size_t)frames;
+    const size_t vec3_floats = frame_count * channel_count * 3;
+
+    AnimationSamples *samples = calloc(1, sizeof(AnimationSamples));
+    if (!samples) {
+        return false;
+    }
+    samples->step = step;
+    samples->duration = animation->duration;
+    samples->frame_count = (uint32_t)frame_count;
+    samples->channel_count = (uint32_t)channel_count;
+    samples->positions = aligned_malloc(vec3_floats * sizeof(float));
+    samples->rotations = aligned_malloc(frame_count * channel_count * 4 * sizeof(float));
+    samples->scales = aligned_malloc(vec3_floats * sizeof(float));
+    samples->channel_keys = calloc(channel_count, sizeof(uint8_t));
+    samples->pose = aligned_malloc(channel_count * 10 * sizeof(float));
+    uint32_t *cursors = calloc(channel_count * 3, sizeof(uint32_t));
+    if (!samples->positions || !samples->rotations || !samples->scales || !samples->channel_keys ||
+        !samples->pose || !cursors) {
+        free(cursors);
+        animation_samples_free(samples);
+        return false;
+    }
+
+    for (size_t c = 0; c < channel_count; c++) {
+        samples->channel_keys[c] = channel_keys(animation, c);
+    }
+
+    // Frames in time order, so the cursors make each key lookup constant time
+    for (size_t f = 0; f < frame_count; f++) {
+        const float time = fminf((float)f * step, animation->duration);
+        for (size_t c = 0; c < channel_count; c++) {
+            const size_t at = (f * channel_count) + c;
+            sample_channel(animation, c, time, &cursors[c * 3], &samples->positions[at * 3],
+                           &samples->rotations[at * 4], &samples->scales[at * 3]);
+
+            // Keep q and -q from alternating, so sample_pose can lerp without a sign check
+            if (f > 0) {
+                float *q = &samples->rotations[at * 4];
+                const float *previous = &samples->rotations[(at - channel_count) * 4];
+                if (glm_vec4_dot(q, (float *)previous) < 0.0F) {
+                    glm_vec4_negate(q);
+                }
+            }
+        }
+    }
+    free(cursors);
+
+    animation_samples_free(animation->samples);
+    animation->samples = samples;
+    return true;
+}
+
+// A track being fitted by reduce_keys: `fits` tells whether the keys after `first` and
+// before `end` lie within the tolerance of the values interpolated from key `first` to key
+// `last` (which may be `first` itself)
+typedef struct KeyTrack {
+    const void *keys;
+    size_t count;
+    float tolerance;
+    bool (*fits)(const struct KeyTrack *track, size_t first, size_t last, size_t end);
+} KeyTrack;
+
+static bool vector_keys_fit(const KeyTrack *track, const size_t first, const size_t last,
+                            const size_t end) {
+    const VectorKey *keys = track->keys;
+    for (size_t k = first + 1; k < end; k++) {
+        vec3 value;
+        glm_vec3_lerp((float *)keys[first].value, (float *)keys[last].value,
+                      key_blend(keys[first].time, keys[last].time, keys[k].time), value);
+        for (int i = 0; i < 3; i++) {
+            if (!(fabsf(value[i] - keys[k].value[i]) <= track->tolerance)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// For unit quaternions q and p in the same hemisphere, |q - p| is about half the angle
+// between them
+static bool rotation_keys_fit(const KeyTrack *track, const size_t first, const size_t last,
+                              const size_t end) {
+    const QuaternionKey *keys = track->keys;
+    const float half_angle = track->tolerance * 0.5F;
+    versor start;
+    versor stop;
+    glm_quat_normalize_to((float *)keys[first].value, start);
+    glm_quat_normalize_to((float *)keys[last].value, stop);
+    if (glm_quat_dot(start, stop) < 0.0F) {
+        glm_vec4_negate(stop);
+    }
+    for (size_t k = first + 1; k < end; k++) {
+        versor value;
+        versor key;
+        glm_quat_slerp(start, stop, key_blend(keys[first].time, keys[last].time, keys[k].time),
+                       value);
+        glm_quat_normalize(value);
+        glm_quat_normalize_to((float *)keys[k].value, key);
+        if (glm_quat_dot(value, key) < 0.0F) {
+            glm_vec4_negate(key);
+        }
+        if (!(glm_vec4_distance2(value, key) <= half_angle * half_angle)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes to `kept` the indices of the keys linear interpolation cannot do without, first and
+// last included, and returns how many there are; just the first for a track that never
+// strays from it
+static uint32_t reduce_keys(const KeyTrack *track, uint32_t *kept) {
+    if (track->count == 0) {
+        return 0;
+    }
+    kept[0] = 0;
+    if (track->fits(track, 0, 0, track->count)) {
+        return 1;
+    }
+
+    // Greedy: stretch each span from the last kept key until a key in between no longer fits
+    uint32_t count = 1;
+    size_t anchor = 0;
+    for (size_t end = 2; end < track->count; end++) {
+        if (end - anchor > COMPRESS_MAX_SPAN || !track->fits(track, anchor, end, end)) {
+            anchor = end - 1;
+            kept[count++] = (uint32_t)anchor;
+        }
+    }
+    kept[count++] = (uint32_t)(track->count - 1);
+    return count;
+}
+
+static int compare_floats(const void *a, const void *b) {
+    const float x = *(const float *)a;
+    const float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// The median over channels of the largest coordinate a position key reaches: about a bone's
+// length, whatever the model's units, where a root that travels far would skew a maximum
+static float typical_bone_offset(const BoneAnimationArray *channels) {
+    float *offsets = malloc(channels->count * sizeof(float));
+    if (!offsets) {
+        return 0.0F;
+    }
+    size_t count = 0;
+    for (size_t c = 0; c < channels->count; c++) {
+        const VectorKeyArray *keys = &channels->data[c].position_keys;
+        float offset = 0.0F;
+        for (size_t k = 0; k < keys->count; k++) {
+            for (int i = 0; i < 3; i++) {
+                offset = fmaxf(offset, fabsf(keys->data[k].value[i]));
+            }
+        }
+        if (keys->count > 0 && offset > 0.0F) {
+            offsets[count++] = offset;
+        }
+    }
+    qsort(offsets, count, sizeof(float), compare_floats);
+    const float median = count > 0 ? offsets[count / 2] : 0.0F;
+    free(offsets);
+    return median;
+}
+
+// What of `tolerance` is left for dropping keys once write_track has rounded the values
+// to half a 16-bit step of the track's range. A track too wide for that keeps every key
+// that a line through its neighbours does not hit exactly.
+static float vector_fit_tolerance(const VectorKeyArray *keys, const float tolerance) {
+    if (keys->count == 0) {
+        return tolerance;
+    }
+    vec3 min;
+    vec3 max;
+    glm_vec3_copy(keys->data[0].value, min);
+    glm_vec3_copy(keys->data[0].value, max);
+    for (size_t k = 1; k < keys->count; k++) {
+        glm_vec3_minv(min, keys->data[k].value, min);
+        glm_vec3_maxv(max, keys->data[k].value, max);
+    }
+    float range = 0.0F;
+    float magnitude = 0.0F;
+    for (int i = 0; i < 3; i++) {
+        range = fmaxf(range, max[i] - min[i]);
+        magnitude = fmaxf(magnitude, fmaxf(fabsf(min[i]), fabsf(max[i])));
+    }
+    // Decoding adds a float rounding of the value on top of the quantization
+    const float error = (0.5F * range / 65535.0F) + (4.0F * FLT_EPSILON * magnitude);
+    return fmaxf(tolerance - error, 0.0F);
+}
+
+// The position, rotation and scale keys of a channel, as tracks to fit. Their tolerances
+// leave room for the quantization write_track adds to the kept keys, so the decoded track
+// stays within the COMPRESS_* tolerances.
+static void channel_key_tracks(const BoneAnimation *channel, const float position_tolerance,
+                               KeyTrack *tracks) {
+    tracks[0] = (KeyTrack){channel->position_keys.data, channel->position_keys.count,
+                           vector_fit_tolerance(&channel->position_keys, position_tolerance),
+                           vector_keys_fit};
+    tracks[1] = (KeyTrack){channel->rotation_keys.data, channel->rotation_keys.count,
+                           COMPRESS_ROTATION_TOLERANCE - ROTATION_QUANTIZATION_ERROR,
+                           rotation_keys_fit};
+    tracks[2] = (KeyTrack){channel->scale_keys.data, channel->scale_keys.count,
+                           vector_fit_tolerance(&channel->scale_keys, COMPRESS_SCALE_TOLERANCE),
+                           vector_keys_fit};
+}
+
+// Fills `track` and its times and values, at its offsets in `buffer`, from the kept keys
+static void write_track(uint8_t *buffer, CompressedTrack *track, const KeyTrack *keys,
+                        const bool rotation, const uint32_t *kept) {
+    float *times = (float *)(buffer + track->times);
+    uint16_t *values = (uint16_t *)(buffer + track->values);
+    if (rotation) {
+        const QuaternionKey *rotation_keys = keys->keys;
+        if (track->key_count == 1) {
+            glm_quat_normalize_to((float *)rotation_keys[kept[0]].value, track->value);
+            return;
+        }
+        for (uint32_t i = 0; i < track->key_count; i++) {
+            versor value;
+            glm_quat_normalize_to((float *)rotation_keys[kept[i]].value, value);
+            times[i] = rotation_keys[kept[i]].time;
+            encode_rotation(value, &values[(size_t)i * 3]);
+        }
+        return;
+    }
+
+    const VectorKey *vector_keys = keys->keys;
+    if (track->key_count == 1) {
+        glm_vec3_copy((float *)vector_keys[kept[0]].value, track->value);
+        return;
+    }
+    vec3 max;
+    glm_vec3_copy((float *)vector_keys[kept[0]].value, track->value);
+    glm_vec3_copy((float *)vector_keys[kept[0]].value, max);
+    for (uint32_t i = 1; i < track->key_count; i++) {
+        glm_vec3_minv(track->value, (float *)vector_keys[kept[i]].value, track->value);
+        glm_vec3_maxv(max, (float *)vector_keys[kept[i]].value, max);
+    }
+    for (int c = 0; c < 3; c++) {
+        track->step[c] = (max[c] - track->value[c]) / 65535.0F;
+    }
+    for (uint32_t i = 0; i < track->key_count; i++) {
+        const VectorKey *key = &vector_keys[kept[i]];
+        times[i] = key->time;
+        for (int c = 0; c < 3; c++) {
+            const float unit =
+                track->step[c] > 0.0F ? (key->value[c] - track->value[c]) / track->step[c] : 0.0F;
+            values[((size_t)i * 3) + c] = (uint16_t)lroundf(clampf(unit, 0.0F, 65535.0F));
+        }
+    }
+}
+
+static void bone_animations_free(BoneAnimationArray *bone_animations) {
+    for (size_t i = 0; i < bone_animations->count; i++) {
+        free(bone_animations->data[i].bone_name);
+        aligned_free(bone_animations->data[i].position_keys.data);
+        aligned_free(bone_animations->data[i].scale_keys.data);
+        aligned_free(bone_animations->data[i].rotation_keys.data);
+    }
+    aligned_free(bone_animations->data);
+    ARRAY_INIT(*bone_animations);
+}
+
+static void compressed_tracks_free(CompressedTracks *compressed) {
+    if (!compressed) {
+        return;
+    }
+    aligned_free(compressed->tracks);
+    free(compressed);
+}
+
+bool animation_compress(Animation *animation) {
+    const size_t channel_count = animation->bone_animations.count;
+    const size_t track_count = channel_count * 3;
+    if (channel_count == 0 || channel_count > UINT32_MAX / 3) {
+        return false;
+    }
+
+    size_t key_total = 0;
+    for (size_t c = 0; c < channel_count; c++) {
+        const BoneAnimation *channel = &animation->bone_animations.data[c];
+        key_total += channel->position_keys.count + channel->rotation_keys.count +
+                     channel->scale_keys.count;
+    }
+    const float position_tolerance =
+        fmaxf(typical_bone_offset(&animation->bone_animations) * COMPRESS_POSITION_TOLERANCE,
+              1e-6F);
+    // Every track's kept keys, at the track's first key in `kept`
+    uint32_t *kept = malloc((key_total > 0 ? key_total : 1) * sizeof(uint32_t));
+    uint32_t *kept_counts = malloc(track_count * sizeof(uint32_t));
+    CompressedTracks *compressed = calloc(1, sizeof(CompressedTracks));
+    if (!kept || !kept_counts || !compressed) {
+        free(kept);
+        free(kept_counts);
+        free(compressed);
+        return false;
+    }
+
+    // Times, then values, after the track headers. A single key lives in its header.
+    size_t time_bytes = 0;
+    size_t value_bytes = 0;
+    size_t first_key = 0;
+    for (size_t c = 0; c < channel_count; c++) {
+        KeyTrack keys[3];
+        channel_key_tracks(&animation->bone_animations.data[c], position_tolerance, keys);
+        for (size_t t = 0; t < 3; t++) {
+            const uint32_t count = reduce_keys(&keys[t], &kept[first_key]);
+            kept_counts[(c * 3) + t] = count;
+            first_key += keys[t].count;
+            if (count > 1) {
+                time_bytes += count * sizeof(float);
+                value_bytes += count * 3 * sizeof(uint16_t);
+            }
+        }
+    }
+    const size_t header_bytes = track_count * sizeof(CompressedTrack);
+    compressed->size = header_bytes + time_bytes + value_bytes;
+    compressed->channel_count = (uint32_t)channel_count;
+    compressed->tracks =
+        compressed->size <= UINT32_MAX ? aligned_malloc(compressed->size) : NULL;
+    if (!compressed->tracks) {
+        free(kept);
+        free(kept_counts);
+        free(compressed);
+        return false;
+    }
+
+    uint8_t *buffer = (uint8_t *)compressed->tracks;
+    size_t time_at = header_bytes;
+    size_t value_at = header_bytes + time_bytes;
+    first_key = 0;
+    for (size_t c = 0; c < channel_count; c++) {
+        KeyTrack keys[3];
+        channel_key_tracks(&animation->bone_animations.data[c], position_tolerance, keys);
+        for (size_t t = 0; t < 3; t++) {
+            CompressedTrack *track = &compressed->tracks[(c * 3) + t];
+            memset(track, 0, sizeof(*track));
+            track->key_count = kept_counts[(c * 3) + t];
+            if (track->key_count > 1) {
+                track->times = (uint32_t)time_at;
+                track->values = (uint32_t)value_at;
+                time_at += track->key_count * sizeof(float);
+                value_at += track->key_count * 3 * sizeof(uint16_t);
+            }
+            if (track->key_count > 0) {
+                write_track(buffer, track, &keys[t], t == 1, &kept[first_key]);
+            }
+            first_key += keys[t].count;
+        }
+    }
+    free(kept);
+    free(kept_counts);
+
+    bone_animations_free(&animation->bone_animations);
+    compressed_tracks_free(animation->compressed);
+    animation->compressed = compressed;
+    return true;
+}
+
+void animation_set_bake_rate(const float samples_per_second) {
+    bake_rate = samples_per_second > 0.0F ? samples_per_second : 0.0F;
+}
+
+float animation_get_bake_rate(void) {
+    return bake_rate;
+}
+
+void baked_poses_free(BakedPoses *poses) {
+    aligned_free(poses->rows);
+    free(poses->clips);
+    memset(poses, 0, sizeof(*poses));
+}
+
+bool animation_bake_poses(const Skeleton *skeleton, const AnimationArray *animations,
+                          const float samples_per_second, BakedPoses *out) {
+    memset(out, 0, sizeof(*out));
+    const size_t bone_count = skeleton->bones.count;
+    if (samples_per_second <= 0.0F || bone_count == 0 || animations->count == 0 ||
+        !skeleton->node_order) {
+        return false;
+    }
+
+    out->clips = calloc(animations->count, sizeof(BakedClip));
+    if (!out->clips) {
+        return false;
+    }
+    out->clip_count = (uint32_t)animations->count;
+
+    // Frames per animation first, to size the buffer and refuse ones past the limit
+    const size_t pose_bytes = bone_count * 12 * sizeof(float);
+    size_t frame_total = 0;
+    for (size_t a = 0; a < animations->count; a++) {
+        const Animation *animation = &animations->data[a];
+        const float ticks_per_second =
+            animation->ticks_per_second != 0.0F ? animation->ticks_per_second : 25.0F;
+        const float step = ticks_per_second / samples_per_second;
+        const float duration = animation->duration > 0.0F ? animation->duration : 0.0F;
+        const float frames = step > 0.0F ? ceilf(duration / step) + 1.0F : 1.0F;
+        if (!(frames * (float)pose_bytes <= (float)MAX_BAKED_POSE_BYTES)) {
+            baked_poses_free(out);
+            return false;
+        }
+        BakedClip *clip = &out->clips[a];
+        clip->first_frame = (uint32_t)frame_total;
+        clip->frame_count = (uint32_t)frames;
+        clip->step = step > 0.0F ? step : 1.0F;
+        clip->duration = duration;
+        frame_total += clip->frame_count;
+        if (frame_total * pose_bytes > MAX_BAKED_POSE_BYTES) {
+            baked_poses_free(out);
+            return false;
+        }
+    }
+
+    out->rows = aligned_malloc(frame_total * pose_bytes);
+    mat4 *matrices = aligned_malloc(bone_count * sizeof(mat4));
+    if (!out->rows || !matrices) {
+        aligned_free(matrices);
+        baked_poses_free(out);
+        return false;
+    }
+    out->bone_count = (uint32_t)bone_count;
+    out->frame_count = (uint32_t)frame_total;
+
+    for (size_t a = 0; a < animations->count; a++) {
+        const Animation *animation = &animations->data[a];
+        const BakedClip *clip = &out->clips[a];
+        uint32_t *cursors = calloc((animation_channel_count(animation) * 3) + 1, sizeof(uint32_t));
+        for (uint32_t f = 0; f < clip->frame_count; f++) {
+            const float time = fminf((float)f * clip->step, clip->duration);
+            evaluate_pose(skeleton, animation, time, cursors, matrices, (int)bone_count);
+
+            // cglm matrices are column-major; each bone becomes its first three rows
+            float *pose = out->rows + ((size_t)(clip->first_frame + f) * bone_count * 12);
+            for (size_t b = 0; b < bone_count; b++) {
+                float *rows = pose + (b * 12);
+                for (int row = 0; row < 3; row++) {
+                    for (int column = 0; column < 4; column++) {
+                        rows[(row * 4) + column] = matrices[b][column][row];
+                    }
+                }
+            }
+        }
+        free(cursors);
+    }
+    aligned_free(matrices);
+    return true;
+}
+
+void baked_poses_locate(const BakedPoses *poses, const uint32_t clip, const float time,
+                        uint32_t *pose_offset, uint32_t *next_pose_offset, float *blend) {
+    const BakedClip *baked = &poses->clips[clip < poses->clip_count ? clip : 0];
+    const uint32_t frame =
+        locate_frame(baked->step, baked->duration, baked->frame_count, time, blend);
+    const uint32_t next = frame + 1 < baked->frame_count ? frame + 1 : frame;
+    *pose_offset = (baked->first_frame + frame) * poses->bone_count * 3;
+    *next_pose_offset = (baked->first_frame + next) * poses->bone_count * 3;
+}
+
 void skeleton_free(Skeleton *skeleton) {
     for (size_t i = 0; i < skeleton->bones.count; i++) {
         free(skeleton->bones.data[i].name);
@@ -343,21 +1286,18 @@ void skeleton_free(Skeleton *skeleton) {
     aligned_free(skeleton->bone_hierarchy.data);
 
     bone_map_free(&skeleton->bone_map);
+    skeleton_flat_free(skeleton);
 
     memset(skeleton, 0, sizeof(Skeleton));
 }
 
 void animation_free(Animation *animation) {
     free(animation->name);
-    for (size_t i = 0; i < animation->bone_animations.count; i++) {
-        free(animation->bone_animations.data[i].bone_name);
-        aligned_free(animation->bone_animations.data[i].position_keys.data);
-        aligned_free(animation->bone_animations.data[i].scale_keys.data);
-        aligned_free(animation->bone_animations.data[i].rotation_keys.data);
-    }
-    aligned_free(animation->bone_animations.data);
+    bone_animations_free(&animation->bone_animations);
     bone_anim_map_free(&animation->bone_anim_map);
     free(animation->bone_node_to_anim);
+    animation_samples_free(animation->samples);
+    compressed_tracks_free(animation->compressed);
 }
 
 void animation_array_free(AnimationArray *arr) {
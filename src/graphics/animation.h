@@ -66,14 +66,58 @@ typedef struct BoneAnimationArray {
     size_t capacity;
 } BoneAnimationArray;
 
+// Which kinds of keys a channel has (AnimationSamples::channel_keys)
+#define ANIMATION_KEYS_POSITION (1U << 0)
+#define ANIMATION_KEYS_ROTATION (1U << 1)
+#define ANIMATION_KEYS_SCALE (1U << 2)
+
+// Every channel of an animation sampled at a fixed rate by animation_resample. Frame i is at
+// time i * step, except the last, which is at the end of the animation. Each frame holds all
+// channels' positions (xyz), rotations (xyzw) and scales (xyz) in three separate arrays, so a
+// pose is a lerp over contiguous floats.
+typedef struct AnimationSamples {
+    float step;     // in ticks
+    float duration; // in ticks
+    uint32_t frame_count;
+    uint32_t channel_count;
+    float *positions; // frame_count * channel_count * 3
+    float *rotations; // frame_count * channel_count * 4
+    float *scales;    // frame_count * channel_count * 3
+    // ANIMATION_KEYS_* per channel; kinds without keys keep the node's bind pose
+    uint8_t *channel_keys;
+    // Scratch pose at the time last sampled: channel_count positions, rotations, then scales
+    float *pose;
+} AnimationSamples;
+
+// One track of a compressed channel. Values are quantized to 16 bits per component:
+// positions and scales to `step` increments from `value`, rotations to the smallest three
+// components of the quaternion. A track of one key holds it in `value` instead.
+typedef struct CompressedTrack {
+    uint32_t key_count; // 0 when the channel has no keys of this kind
+    uint32_t times;     // byte offset of the key times (float) in the buffer
+    uint32_t values;    // byte offset of the quantized values, 3 uint16_t per key
+    float value[4];
+    float step[3];
+} CompressedTrack;
+
+// An animation's keys compressed by animation_compress into one buffer: the position,
+// rotation and scale tracks of every channel, then each track's key times and values
+typedef struct CompressedTracks {
+    CompressedTrack *tracks; // channel_count * 3; the start of the buffer
+    uint32_t channel_count;
+    size_t size; // of the buffer, in bytes
+} CompressedTracks;
+
 // Complete animation
 typedef struct Animation {
     char *name;
     float duration;
     float ticks_per_second;
-    BoneAnimationArray bone_animations;
-    BoneAnimationMap bone_anim_map; // name -> index in bone_animations
-    int *bone_node_to_anim;         // Mapping from BoneNode index to index in bone_animations
+    BoneAnimationArray bone_animations; // emptied by animation_compress
+    BoneAnimationMap bone_anim_map;     // name -> channel index
+    int *bone_node_to_anim;             // Mapping from BoneNode index to channel index
+    AnimationSamples *samples;          // Set by animation_resample; NULL samples the keys
+    CompressedTracks *compressed;       // Set by animation_compress; the keys when NULL
 } Animation;
 
 typedef struct AnimationArray {
@@ -118,6 +162,17 @@ typedef struct Skeleton {
     BoneNodeArray bone_hierarchy;
     BoneMap bone_map;
     mat4 global_inverse_transform;
+
+    // Built by skeleton_flatten: the nodes reachable from a root, each after its parent,
+    // and the bone each node drives (-1 for none)
+    int *node_order;
+    size_t node_order_count;
+    int *node_bones;
+    // Bones that no node drives; they keep the identity
+    int *unposed_bones;
+    size_t unposed_bone_count;
+    // Scratch global transform per node, written by compute_bone_matrices
+    mat4 *node_globals;
 } Skeleton;
 
 // Animation state
@@ -127,14 +182,42 @@ typedef struct AnimationState {
     bool playing;
     int last_animation_index;
     float last_computed_time;
+    // Per channel of cursor_animation, the position, rotation and scale key last sampled.
+    // Playback mostly moves forward, so the next search starts there.
+    uint32_t *key_cursors;
+    size_t key_cursor_count;
+    int cursor_animation;
 } AnimationState;
 
+// One animation of BakedPoses: frame_count poses, `step` ticks apart and the last at
+// `duration`, from pose first_frame
+typedef struct BakedClip {
+    uint32_t first_frame;
+    uint32_t frame_count;
+    float step;
+    float duration;
+} BakedClip;
+
+// Every animation's bone matrices evaluated at a fixed rate by animation_bake_poses, for the
+// GPU to sample. A pose is bone_count matrices, each as the three rows of its affine part
+// (the fourth is always 0 0 0 1), so bone b of pose p starts at float4 (p * bone_count + b) * 3.
+typedef struct BakedPoses {
+    float *rows; // frame_count * bone_count * 12
+    uint32_t bone_count;
+    uint32_t frame_count;
+    BakedClip *clips; // one per animation
+    uint32_t clip_count;
+} BakedPoses;
+
 // Forward declaration
 struct Mesh;
 
 // Initialize animation state
 void animation_state_init(AnimationState *state);
 
+// Frees the key cursors and starts over from animation_state_init
+void animation_state_free(AnimationState *state);
+
 // Core animation functions
 void update_animation(const struct Mesh *mesh, AnimationState *state, float delta_time,
                       mat4 *bone_matrices);
@@ -144,9 +227,66 @@ void interpolate_position(const VectorKeyArray *keys, float time, vec3 out);
 void interpolate_scale(const VectorKeyArray *keys, float time, vec3 out);
 void interpolate_rotation(const QuaternionKeyArray *keys, float time, versor out);
 
-// Bone matrix computation
+// Fills bone_node_to_anim: the channel of each skeleton node, or -1 when it has none
+void animation_bind_skeleton(Animation *animation, const Skeleton *skeleton);
+
+// Builds the evaluation order and node-to-bone table compute_bone_matrices walks. Call it
+// once the hierarchy, bones and bone map are complete; false when out of memory.
+bool skeleton_flatten(Skeleton *skeleton);
+
+// Bone matrix computation: one pass over the flattened skeleton (skeleton_flatten), using
+// the animation's bone_node_to_anim. Writes the first bones.count matrices (at most
+// MAX_BONES; animation_bake_poses has no such limit). Not reentrant for one skeleton, whose
+// node_globals it writes.
+// `key_cursors` (3 per channel, zeroed at first, or NULL) carry each channel's last key
+// between calls; resampled animations do not use them.
 void compute_bone_matrices(const Skeleton *skeleton, const Animation *animation, float time,
-                           mat4 *bone_matrices);
+                           uint32_t *key_cursors, mat4 *bone_matrices);
+
+// Rate, in samples per second of playback, animation_resample uses when loading models. 0,
+// the default, keeps sampling the keys. Set it before any loading thread starts.
+void animation_set_resample_rate(float samples_per_second);
+float animation_get_resample_rate(void);
+
+// Samples every channel at `samples_per_second` into animation->samples. Returns false,
+// leaving the keys in use, for an animation without duration, one too long to hold in
+// memory, or when out of memory.
+bool animation_resample(Animation *animation, float samples_per_second);
+
+// Replaces the keys of every channel with animation->compressed, freeing bone_animations;
+// channels keep their indices. Keys that linear interpolation between their neighbours
+// restores closely are dropped, a track that holds still keeps one key, and values are
+// quantized. Returns false, leaving the keys, for an animation without channels or when out
+// of memory.
+bool animation_compress(Animation *animation);
+
+// Channels of the animation, compressed or not
+size_t animation_channel_count(const Animation *animation);
+
+// Rate, in poses per second of playback, load_model bakes animations at for the GPU (see
+// animation_bake_poses). 0, the default, bakes nothing. Set it before any loading thread
+// starts.
+void animation_set_bake_rate(float samples_per_second);
+float animation_get_bake_rate(void);
+
+// Evaluates every animation of the skeleton at `samples_per_second`, all of its bones, into
+// `out`. Returns false, leaving `out` empty, without bones or animations, when the poses
+// would pass MAX_BAKED_POSE_BYTES, or when out of memory.
+#define MAX_BAKED_POSE_BYTES (64U << 20)
+bool animation_bake_poses(const Skeleton *skeleton, const AnimationArray *animations,
+                          float samples_per_second, BakedPoses *out);
+
+// Where the pose of `clip` at `time` ticks is: the float4 offsets of the baked poses before
+// and after it, and how far to blend from the first to the second. Time wraps like
+// update_animation's.
+void baked_poses_locate(const BakedPoses *poses, uint32_t clip, float time,
+                        uint32_t *pose_offset, uint32_t *next_pose_offset, float *blend);
+
+void baked_poses_free(BakedPoses *poses);
+
+// Sets a hierarchy node's bind-pose transform and the position, scale and rotation it
+// decomposes into, which stand in for whatever keys an animation channel lacks
+void bone_node_set_transform(BoneNode *node, mat4 transformation);
 
 // Bone map functions
 void bone_map_init(BoneMap *map);
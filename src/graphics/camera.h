@@ -2,6 +2,9 @@
 #include <cglm/types.h>
 #include <stdint.h>
 
+// Vertical field of view dcat frames its scenes with
+#define CAMERA_FOV_DEGREES 60.0F
+
 typedef struct Camera {
     vec3 position;
     vec3 target;
@@ -0,0 +1,1306 @@
+#include "gltf.h"
+#include "core/json.h"
+#include "platform/io.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Little-endian throughout: a 12-byte header (magic, version, total length), then chunks of
+// a length, a type and the data. The JSON chunk comes first; the BIN chunk is buffer 0.
+#define GLB_HEADER_SIZE 12U
+#define GLB_CHUNK_HEADER_SIZE 8U
+#define GLB_MAGIC 0x46546C67U      // "glTF"
+#define GLB_CHUNK_JSON 0x4E4F534AU // "JSON"
+#define GLB_CHUNK_BIN 0x004E4942U  // "BIN\0"
+
+// Accessor component types
+#define GLTF_BYTE 5120U
+#define GLTF_UNSIGNED_BYTE 5121U
+#define GLTF_SHORT 5122U
+#define GLTF_UNSIGNED_SHORT 5123U
+#define GLTF_UNSIGNED_INT 5125U
+#define GLTF_FLOAT 5126U
+
+// Primitive modes: below triangles are points and lines, above are strips and fans
+#define GLTF_MODE_TRIANGLES 4
+
+// Key times are in seconds. Assimp reports glTF animations in milliseconds, and a model
+// plays at one speed whichever loader read it.
+#define GLTF_TICKS_PER_SECOND 1000.0F
+
+// Extensions a file may require that this loader reads correctly
+static const char *const SUPPORTED_REQUIRED_EXTENSIONS[] = {"KHR_mesh_quantization"};
+
+typedef struct GltfList {
+    int *items; // token of each element
+    size_t count;
+} GltfList;
+
+typedef struct Gltf {
+    JsonDocument json;
+    const char *path;
+    const uint8_t *bin;
+    size_t bin_size;
+    GltfList accessors;
+    GltfList buffer_views;
+    GltfList nodes;
+    GltfList meshes;
+    GltfList materials;
+    GltfList textures;
+    GltfList images;
+    GltfList skins;
+    int animations;
+    // Node names made unique: glTF lets them repeat or be missing, and the skeleton and
+    // animation channels find nodes by name
+    char **node_names;
+    int *node_parents;
+    // The scene's nodes, each after its parent, and their scene-space transforms
+    int *node_order;
+    size_t node_order_count;
+    size_t root_count;
+    mat4 *node_globals;
+    // Skeleton bone of each joint of each skin, filled as skinned primitives are read
+    int **skin_bones;
+    size_t *skin_joint_counts;
+    unsigned int uv_channel;
+} Gltf;
+
+typedef struct Accessor {
+    const uint8_t *data;
+    size_t count;
+    size_t stride;
+    uint32_t component_type;
+    uint32_t components; // 0 for an attribute the primitive lacks
+    bool normalized;
+} Accessor;
+
+// One triangle primitive and where the counting pass placed it
+typedef struct Primitive {
+    int node;
+    int primitive;
+    uint32_t material;
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t index_offset;
+    uint32_t index_count;
+    // Without normals each triangle gets its own three vertices, for flat shading
+    bool flat;
+} Primitive;
+
+typedef struct PrimitiveArray {
+    Primitive *data;
+    size_t count;
+    size_t capacity;
+} PrimitiveArray;
+
+typedef struct PrimitiveData {
+    Accessor position;
+    Accessor normal;
+    Accessor texcoord;
+    Accessor tangent;
+    Accessor joints;
+    Accessor weights;
+    Accessor indices;
+    const int *joint_bones;
+    size_t joint_count;
+} PrimitiveData;
+
+static uint32_t read_u32(const uint8_t *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+bool gltf_is_glb(const uint8_t *data, const size_t size) {
+    return size >= GLB_HEADER_SIZE && read_u32(data) == GLB_MAGIC;
+}
+
+static int member(const Gltf *g, const int object, const char *key) {
+    return json_object_get(&g->json, object, key);
+}
+
+static double number(const Gltf *g, const int object, const char *key, const double fallback) {
+    return json_number(&g->json, json_object_get(&g->json, object, key), fallback);
+}
+
+// A glTF index: a non-negative integer, or -1 when absent or anything else
+static int index_of(const Gltf *g, const int token) {
+    const double value = json_number(&g->json, token, -1.0);
+    return value >= 0.0 && value < (double)INT_MAX && value == floor(value) ? (int)value : -1;
+}
+
+static int index_member(const Gltf *g, const int object, const char *key) {
+    return index_of(g, member(g, object, key));
+}
+
+static int list_get(const GltfList *list, const int index) {
+    return index >= 0 && (size_t)index < list->count ? list->items[index] : -1;
+}
+
+// The element after `element` in its array
+static int next_element(const Gltf *g, const int element) {
+    return (int)g->json.tokens[element].next;
+}
+
+static bool list_elements(const Gltf *g, const int array, GltfList *out) {
+    out->count = json_array_size(&g->json, array);
+    out->items = NULL;
+    if (out->count == 0) {
+        return true;
+    }
+    out->items = malloc(out->count * sizeof(int));
+    if (!out->items) {
+        return false;
+    }
+    int element = json_array_get(&g->json, array, 0);
+    for (size_t i = 0; i < out->count; i++, element = next_element(g, element)) {
+        out->items[i] = element;
+    }
+    return true;
+}
+
+// Fills `out` with up to `count` numbers of a JSON array, leaving the rest as they were
+static void read_numbers(const Gltf *g, const int array, float *out, const size_t count) {
+    const size_t size = json_array_size(&g->json, array);
+    int element = json_array_get(&g->json, array, 0);
+    for (size_t i = 0; i < size && i < count; i++, element = next_element(g, element)) {
+        out[i] = (float)json_number(&g->json, element, out[i]);
+    }
+}
+
+static bool find_chunks(const uint8_t *data, const size_t size, Gltf *g, const char **json,
+                        size_t *json_size) {
+    if (!gltf_is_glb(data, size) || read_u32(data + 4) != 2U || read_u32(data + 8) > size) {
+        return false;
+    }
+    const size_t length = read_u32(data + 8);
+    *json = NULL;
+    for (size_t offset = GLB_HEADER_SIZE; offset + GLB_CHUNK_HEADER_SIZE <= length;) {
+        const size_t chunk_size = read_u32(data + offset);
+        const uint32_t type = read_u32(data + offset + 4);
+        offset += GLB_CHUNK_HEADER_SIZE;
+        if (chunk_size > length - offset) {
+            return false;
+        }
+        if (type == GLB_CHUNK_JSON && !*json) {
+            *json = (const char *)data + offset;
+            *json_size = chunk_size;
+        } else if (type == GLB_CHUNK_BIN && !g->bin) {
+            g->bin = data + offset;
+            g->bin_size = chunk_size;
+        }
+        offset += chunk_size;
+    }
+    return *json != NULL;
+}
+
+static bool extensions_supported(const Gltf *g) {
+    const int required = member(g, 0, "extensionsRequired");
+    const size_t count = json_array_size(&g->json, required);
+    int element = json_array_get(&g->json, required, 0);
+    for (size_t i = 0; i < count; i++, element = next_element(g, element)) {
+        bool supported = false;
+        for (size_t j = 0; j < sizeof(SUPPORTED_REQUIRED_EXTENSIONS) /
+                                   sizeof(SUPPORTED_REQUIRED_EXTENSIONS[0]);
+             j++) {
+            supported = supported ||
+                        json_string_equals(&g->json, element, SUPPORTED_REQUIRED_EXTENSIONS[j]);
+        }
+        if (!supported) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool gltf_open(Gltf *g, const uint8_t *data, const size_t size) {
+    const char *json = NULL;
+    size_t json_size = 0;
+    if (!find_chunks(data, size, g, &json, &json_size) || !json_parse(json, json_size, &g->json) ||
+        g->json.tokens[0].type != JSON_OBJECT) {
+        return false;
+    }
+    const int asset = member(g, 0, "asset");
+    if (!json_string_equals(&g->json, member(g, asset, "version"), "2.0") ||
+        !extensions_supported(g)) {
+        return false;
+    }
+    // Buffer 0 is the BIN chunk only when it has no uri of its own
+    if (member(g, json_array_get(&g->json, member(g, 0, "buffers"), 0), "uri") >= 0) {
+        g->bin = NULL;
+    }
+    g->animations = member(g, 0, "animations");
+    return list_elements(g, member(g, 0, "accessors"), &g->accessors) &&
+           list_elements(g, member(g, 0, "bufferViews"), &g->buffer_views) &&
+           list_elements(g, member(g, 0, "nodes"), &g->nodes) &&
+           list_elements(g, member(g, 0, "meshes"), &g->meshes) &&
+           list_elements(g, member(g, 0, "materials"), &g->materials) &&
+           list_elements(g, member(g, 0, "textures"), &g->textures) &&
+           list_elements(g, member(g, 0, "images"), &g->images) &&
+           list_elements(g, member(g, 0, "skins"), &g->skins);
+}
+
+static void gltf_close(Gltf *g) {
+    for (size_t i = 0; g->node_names && i < g->nodes.count; i++) {
+        free(g->node_names[i]);
+    }
+    for (size_t i = 0; g->skin_bones && i < g->skins.count; i++) {
+        free(g->skin_bones[i]);
+    }
+    free(g->node_names);
+    free(g->node_parents);
+    free(g->node_order);
+    aligned_free(g->node_globals);
+    free(g->skin_bones);
+    free(g->skin_joint_counts);
+    free(g->accessors.items);
+    free(g->buffer_views.items);
+    free(g->nodes.items);
+    free(g->meshes.items);
+    free(g->materials.items);
+    free(g->textures.items);
+    free(g->images.items);
+    free(g->skins.items);
+    json_free(&g->json);
+}
+
+// The bytes of a buffer view, which must lie in the BIN chunk
+static bool buffer_view_bytes(const Gltf *g, const int view, const uint8_t **out,
+                              size_t *out_size) {
+    if (view < 0 || !g->bin || index_member(g, view, "buffer") != 0) {
+        return false;
+    }
+    const double offset = number(g, view, "byteOffset", 0.0);
+    const double length = number(g, view, "byteLength", -1.0);
+    if (offset < 0.0 || length < 0.0 || offset + length > (double)g->bin_size) {
+        return false;
+    }
+    *out = g->bin + (size_t)offset;
+    *out_size = (size_t)length;
+    return true;
+}
+
+static uint32_t component_size(const uint32_t type) {
+    switch (type) {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// MAT2 and MAT3 pad their columns and are not read anywhere here
+static uint32_t type_components(const Gltf *g, const int type) {
+    static const struct {
+        const char *name;
+        uint32_t components;
+    } types[] = {{"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4}, {"MAT4", 16}};
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (json_string_equals(&g->json, type, types[i].name)) {
+            return types[i].components;
+        }
+    }
+    return 0;
+}
+
+// Checks that every element of accessor `index` lies inside its buffer view
+static bool open_accessor(const Gltf *g, const int index, Accessor *out) {
+    *out = (Accessor){0};
+    const int accessor = list_get(&g->accessors, index);
+    if (accessor < 0 || member(g, accessor, "sparse") >= 0) {
+        return false;
+    }
+    const double count = number(g, accessor, "count", -1.0);
+    const double offset = number(g, accessor, "byteOffset", 0.0);
+    out->component_type = (uint32_t)index_member(g, accessor, "componentType");
+    out->components = type_components(g, member(g, accessor, "type"));
+    const int normalized = member(g, accessor, "normalized");
+    out->normalized = normalized >= 0 && g->json.tokens[normalized].type == JSON_TRUE;
+    const size_t element = (size_t)component_size(out->component_type) * out->components;
+    const int view = list_get(&g->buffer_views, index_member(g, accessor, "bufferView"));
+    const uint8_t *view_data;
+    size_t view_size;
+    if (element == 0 || count < 0.0 || count > (double)UINT32_MAX || offset < 0.0 ||
+        !buffer_view_bytes(g, view, &view_data, &view_size)) {
+        return false;
+    }
+    // Strides are at most 252 bytes
+    const double stride = number(g, view, "byteStride", 0.0);
+    if (stride < 0.0 || stride > 252.0 || offset > (double)view_size) {
+        return false;
+    }
+    out->count = (size_t)count;
+    out->stride = stride > 0.0 ? (size_t)stride : element;
+    if (out->stride < element ||
+        (out->count > 0 && offset + ((double)(out->count - 1) * (double)out->stride) +
+                                   (double)element >
+                               (double)view_size)) {
+        return false;
+    }
+    out->data = view_data + (size_t)offset;
+    return true;
+}
+
+// Component `c` of element `i`, normalized integers mapped to [0, 1] or [-1, 1]
+static float read_component(const Accessor *a, const size_t i, const uint32_t c) {
+    const uint8_t *p = a->data + (i * a->stride) + ((size_t)c * component_size(a->component_type));
+    switch (a->component_type) {
+    case GLTF_FLOAT: {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case GLTF_BYTE: {
+        const float value = (float)(int8_t)p[0];
+        return a->normalized ? fmaxf(value / 127.0F, -1.0F) : value;
+    }
+    case GLTF_UNSIGNED_BYTE:
+        return a->normalized ? (float)p[0] / 255.0F : (float)p[0];
+    case GLTF_SHORT: {
+        int16_t value;
+        memcpy(&value, p, sizeof(value));
+        return a->normalized ? fmaxf((float)value / 32767.0F, -1.0F) : (float)value;
+    }
+    case GLTF_UNSIGNED_SHORT: {
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return a->normalized ? (float)value / 65535.0F : (float)value;
+    }
+    default: {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return (float)value;
+    }
+    }
+}
+
+static uint32_t read_uint(const Accessor *a, const size_t i, const uint32_t c) {
+    const uint8_t *p = a->data + (i * a->stride) + ((size_t)c * component_size(a->component_type));
+    switch (a->component_type) {
+    case GLTF_UNSIGNED_BYTE:
+        return p[0];
+    case GLTF_UNSIGNED_SHORT: {
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case GLTF_UNSIGNED_INT: {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    default:
+        return UINT32_MAX;
+    }
+}
+
+// Whether `a` holds unsigned integers, `components` to an element, as indices and joints do
+static bool unsigned_integers(const Accessor *a, const uint32_t components) {
+    return a->components == components && a->component_type != GLTF_FLOAT &&
+           a->component_type != GLTF_BYTE && a->component_type != GLTF_SHORT;
+}
+
+static void read_floats(const Accessor *a, const size_t i, float *out, const uint32_t count) {
+    for (uint32_t c = 0; c < count; c++) {
+        out[c] = read_component(a, i, c);
+    }
+}
+
+static void node_local_transform(const Gltf *g, const int node, mat4 out) {
+    const int matrix = member(g, node, "matrix");
+    if (json_array_size(&g->json, matrix) == 16) {
+        glm_mat4_identity(out);
+        read_numbers(g, matrix, (float *)out, 16);
+        return;
+    }
+    vec3 translation = {0.0F, 0.0F, 0.0F};
+    versor rotation = {0.0F, 0.0F, 0.0F, 1.0F};
+    vec3 scale = {1.0F, 1.0F, 1.0F};
+    read_numbers(g, member(g, node, "translation"), translation, 3);
+    read_numbers(g, member(g, node, "rotation"), rotation, 4);
+    read_numbers(g, member(g, node, "scale"), scale, 3);
+    glm_quat_mat4(rotation, out);
+    for (int i = 0; i < 3; i++) {
+        glm_vec3_scale(out[i], scale[i], out[i]);
+    }
+    glm_vec3_copy(translation, out[3]);
+}
+
+// A name for node `i` no other node has
+static char *unique_node_name(const Gltf *g, const int i, const BoneMap *taken) {
+    char *name = json_string_dup(&g->json, member(g, g->nodes.items[i], "name"));
+    if (name && name[0] && bone_map_find(taken, name) < 0) {
+        return name;
+    }
+    const char *base = name && name[0] ? name : "node";
+    char buffer[256];
+    for (unsigned int attempt = 0;; attempt++) {
+        if (attempt == 0) {
+            snprintf(buffer, sizeof(buffer), "%.200s#%d", base, i);
+        } else {
+            snprintf(buffer, sizeof(buffer), "%.200s#%d#%u", base, i, attempt);
+        }
+        if (bone_map_find(taken, buffer) < 0) {
+            break;
+        }
+    }
+    free(name);
+    return str_dup(buffer);
+}
+
+// Names, parents, the scene's traversal order and the scene-space transforms of the nodes
+static bool prepare_nodes(Gltf *g) {
+    const size_t count = g->nodes.count;
+    const size_t allocated = count > 0 ? count : 1;
+    g->node_names = calloc(allocated, sizeof(char *));
+    g->node_parents = malloc(allocated * sizeof(int));
+    g->node_order = malloc(allocated * sizeof(int));
+    g->node_globals = aligned_malloc(allocated * sizeof(mat4));
+    bool *visited = calloc(allocated, sizeof(bool));
+    if (!g->node_names || !g->node_parents || !g->node_order || !g->node_globals || !visited) {
+        free(visited);
+        return false;
+    }
+
+    // A node has at most one parent and is not its own
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        g->node_parents[i] = -1;
+    }
+    for (size_t i = 0; i < count && ok; i++) {
+        const int children = member(g, g->nodes.items[i], "children");
+        const size_t child_count = json_array_size(&g->json, children);
+        int element = json_array_get(&g->json, children, 0);
+        for (size_t j = 0; j < child_count && ok; j++, element = next_element(g, element)) {
+            const int child = index_of(g, element);
+            ok = child >= 0 && (size_t)child < count && (size_t)child != i &&
+                 g->node_parents[child] < 0;
+            if (ok) {
+                g->node_parents[child] = (int)i;
+            }
+        }
+    }
+
+    BoneMap taken;
+    bone_map_init(&taken);
+    for (size_t i = 0; i < count && ok; i++) {
+        g->node_names[i] = unique_node_name(g, (int)i, &taken);
+        ok = g->node_names[i] != NULL;
+        bone_map_insert(&taken, g->node_names[i], (int)i);
+    }
+    bone_map_free(&taken);
+
+    // The default scene's roots, or every parentless node when the file has no scenes
+    const int scenes = member(g, 0, "scenes");
+    int scene_index = index_member(g, 0, "scene");
+    const int scene = json_array_get(&g->json, scenes, scene_index >= 0 ? (size_t)scene_index : 0);
+    const int roots = member(g, scene, "nodes");
+    const size_t root_count = scene >= 0 ? json_array_size(&g->json, roots) : count;
+    int root = json_array_get(&g->json, roots, 0);
+    int *stack = malloc(allocated * sizeof(int));
+    ok = ok && stack;
+    for (size_t r = 0; r < root_count && ok; r++) {
+        const int node = scene >= 0 ? index_of(g, root) : (int)r;
+        if (scene >= 0) {
+            root = next_element(g, root);
+        }
+        if (node < 0 || (size_t)node >= count || g->node_parents[node] >= 0 || visited[node]) {
+            continue;
+        }
+        visited[node] = true;
+        g->root_count++;
+        size_t stack_top = 0;
+        stack[stack_top++] = node;
+        while (stack_top > 0) {
+            const int current = stack[--stack_top];
+            mat4 local;
+            node_local_transform(g, g->nodes.items[current], local);
+            if (g->node_parents[current] >= 0) {
+                glm_mat4_mul(g->node_globals[g->node_parents[current]], local,
+                             g->node_globals[current]);
+            } else {
+                glm_mat4_copy(local, g->node_globals[current]);
+            }
+            g->node_order[g->node_order_count++] = current;
+
+            // Children go on in reverse so they come off in order
+            const int children = member(g, g->nodes.items[current], "children");
+            for (size_t j = json_array_size(&g->json, children); j > 0; j--) {
+                const int child = index_of(g, json_array_get(&g->json, children, j - 1));
+                if (!visited[child]) {
+                    visited[child] = true;
+                    stack[stack_top++] = child;
+                }
+            }
+        }
+    }
+    free(stack);
+    free(visited);
+    return ok;
+}
+
+static bool open_attribute(const Gltf *g, const int attributes, const char *name,
+                           const uint32_t components, const size_t vertex_count, Accessor *out) {
+    *out = (Accessor){0};
+    if (member(g, attributes, name) < 0) {
+        return true;
+    }
+    return open_accessor(g, index_member(g, attributes, name), out) &&
+           out->components == components && out->count == vertex_count;
+}
+
+// Adds the skeleton bone for `name` unless it exists; -1 if its name cannot be copied
+static int register_bone(Skeleton *skeleton, const char *name, mat4 offset) {
+    int bone_index = bone_map_find(&skeleton->bone_map, name);
+    if (bone_index >= 0) {
+        return bone_index;
+    }
+    BoneInfo bone_info;
+    bone_info.name = str_dup(name);
+    if (!bone_info.name) {
+        return -1;
+    }
+    bone_index = (int)skeleton->bones.count;
+    if (offset) {
+        glm_mat4_copy(offset, bone_info.offset_matrix);
+    } else {
+        glm_mat4_identity(bone_info.offset_matrix);
+    }
+    bone_info.index = bone_index;
+    ARRAY_PUSH(skeleton->bones, bone_info);
+    bone_map_insert(&skeleton->bone_map, name, bone_index);
+    return bone_index;
+}
+
+// The bone of each joint of skin `index`, registered with its inverse bind matrix
+static bool register_skin(Gltf *g, Skeleton *skeleton, const int index) {
+    if (g->skin_bones[index]) {
+        return true;
+    }
+    const int skin = g->skins.items[index];
+    const int joints = member(g, skin, "joints");
+    const size_t joint_count = json_array_size(&g->json, joints);
+    Accessor matrices = {0};
+    if (member(g, skin, "inverseBindMatrices") >= 0 &&
+        (!open_accessor(g, index_member(g, skin, "inverseBindMatrices"), &matrices) ||
+         matrices.components != 16 || matrices.component_type != GLTF_FLOAT ||
+         matrices.count < joint_count)) {
+        return false;
+    }
+    g->skin_bones[index] = malloc((joint_count > 0 ? joint_count : 1) * sizeof(int));
+    if (!g->skin_bones[index]) {
+        return false;
+    }
+    g->skin_joint_counts[index] = joint_count;
+    int element = json_array_get(&g->json, joints, 0);
+    for (size_t j = 0; j < joint_count; j++, element = next_element(g, element)) {
+        const int node = index_of(g, element);
+        if (node < 0 || (size_t)node >= g->nodes.count) {
+            g->skin_bones[index][j] = -1;
+            continue;
+        }
+        mat4 offset;
+        if (matrices.components) {
+            read_floats(&matrices, j, (float *)offset, 16);
+        } else {
+            glm_mat4_identity(offset);
+        }
+        g->skin_bones[index][j] = register_bone(skeleton, g->node_names[node], offset);
+    }
+    return true;
+}
+
+// Counting pass: lays out every triangle primitive of the scene's nodes, in node order, in
+// the vertex and index arrays and adds its submesh
+static bool collect_primitives(const Gltf *g, Mesh *out, PrimitiveArray *primitives,
+                               size_t *vertex_count, size_t *index_count, bool *out_has_uvs) {
+    char texcoord_name[32];
+    snprintf(texcoord_name, sizeof(texcoord_name), "TEXCOORD_%u", g->uv_channel);
+    for (size_t n = 0; n < g->node_order_count; n++) {
+        const int node = g->node_order[n];
+        const int mesh = list_get(&g->meshes, index_member(g, g->nodes.items[node], "mesh"));
+        const int list = member(g, mesh, "primitives");
+        const size_t count = json_array_size(&g->json, list);
+        int primitive = json_array_get(&g->json, list, 0);
+        for (size_t i = 0; i < count; i++, primitive = next_element(g, primitive)) {
+            const double mode = number(g, primitive, "mode", GLTF_MODE_TRIANGLES);
+            if (mode < GLTF_MODE_TRIANGLES) {
+                // Points and lines, which the renderer does not draw
+                continue;
+            }
+            const int attributes = member(g, primitive, "attributes");
+            Accessor position;
+            Accessor indices = {0};
+            if (mode != GLTF_MODE_TRIANGLES ||
+                !open_accessor(g, index_member(g, attributes, "POSITION"), &position) ||
+                position.components != 3 ||
+                (member(g, primitive, "indices") >= 0 &&
+                 !open_accessor(g, index_member(g, primitive, "indices"), &indices))) {
+                return false;
+            }
+            size_t primitive_indices = indices.components ? indices.count : position.count;
+            primitive_indices -= primitive_indices % 3;
+            const bool flat = member(g, attributes, "NORMAL") < 0;
+            const size_t primitive_vertices = flat ? primitive_indices : position.count;
+            if (*vertex_count + primitive_vertices > UINT32_MAX ||
+                *index_count + primitive_indices > UINT32_MAX) {
+                fprintf(stderr, "Error loading model: more than 2^32 vertices or indices\n");
+                return false;
+            }
+            if (member(g, attributes, texcoord_name) >= 0) {
+                *out_has_uvs = true;
+            }
+
+            // Primitives without a material share a default one after the file's own
+            const int material = index_member(g, primitive, "material");
+            Primitive job = {
+                .node = node,
+                .primitive = primitive,
+                .material = material >= 0 && (size_t)material < g->materials.count
+                                ? (uint32_t)material
+                                : (uint32_t)g->materials.count,
+                .vertex_offset = (uint32_t)*vertex_count,
+                .vertex_count = (uint32_t)primitive_vertices,
+                .index_offset = (uint32_t)*index_count,
+                .index_count = (uint32_t)primitive_indices,
+                .flat = flat,
+            };
+            ARRAY_PUSH(*primitives, job);
+
+            SubMesh submesh = {0};
+            submesh.index_offset = job.index_offset;
+            submesh.index_count = job.index_count;
+            submesh.material_index = job.material;
+            ARRAY_PUSH(out->submeshes, submesh);
+
+            *vertex_count += primitive_vertices;
+            *index_count += primitive_indices;
+        }
+    }
+    return true;
+}
+
+static void read_vertex(const PrimitiveData *d, const size_t i, Vertex *vertex) {
+    memset(vertex, 0, sizeof(*vertex));
+    for (int slot = 0; slot < MAX_BONE_INFLUENCE; slot++) {
+        vertex->bone_ids[slot] = -1;
+    }
+    read_floats(&d->position, i, vertex->position, 3);
+    // glTF's v already runs down the image, as the renderer samples it
+    if (d->texcoord.components) {
+        read_floats(&d->texcoord, i, vertex->texcoord, 2);
+    }
+    if (d->normal.components) {
+        read_floats(&d->normal, i, vertex->normal, 3);
+    } else {
+        glm_vec3_copy((vec3){0.0F, 1.0F, 0.0F}, vertex->normal);
+    }
+    if (d->tangent.components) {
+        // w is the handedness of the bitangent, cross(normal, tangent) * w
+        vec4 tangent;
+        read_floats(&d->tangent, i, tangent, 4);
+        glm_vec3_copy(tangent, vertex->tangent);
+        glm_vec3_cross(vertex->normal, vertex->tangent, vertex->bitangent);
+        glm_vec3_scale(vertex->bitangent, tangent[3] < 0.0F ? -1.0F : 1.0F, vertex->bitangent);
+    } else {
+        glm_vec3_copy((vec3){1.0F, 0.0F, 0.0F}, vertex->tangent);
+        glm_vec3_copy((vec3){0.0F, 0.0F, 1.0F}, vertex->bitangent);
+    }
+    if (!d->joint_bones || !d->joints.components || !d->weights.components) {
+        return;
+    }
+    int slot = 0;
+    for (uint32_t c = 0; c < 4 && slot < MAX_BONE_INFLUENCE; c++) {
+        const float weight = read_component(&d->weights, i, c);
+        const uint32_t joint = read_uint(&d->joints, i, c);
+        if (weight > 0.0F && joint < d->joint_count && d->joint_bones[joint] >= 0) {
+            vertex->bone_ids[slot] = d->joint_bones[joint];
+            vertex->bone_weights[slot] = weight;
+            slot++;
+        }
+    }
+}
+
+// One normal per triangle, for primitives whose vertices were unwelded for it
+static void flat_normals(Vertex *vertices, const size_t count) {
+    for (size_t i = 0; i + 2 < count; i += 3) {
+        vec3 edge1;
+        vec3 edge2;
+        vec3 normal;
+        glm_vec3_sub(vertices[i + 1].position, vertices[i].position, edge1);
+        glm_vec3_sub(vertices[i + 2].position, vertices[i].position, edge2);
+        glm_vec3_cross(edge1, edge2, normal);
+        if (glm_vec3_norm(normal) > 0.0F) {
+            glm_vec3_normalize(normal);
+        } else {
+            glm_vec3_copy((vec3){0.0F, 1.0F, 0.0F}, normal);
+        }
+        for (size_t k = 0; k < 3; k++) {
+            glm_vec3_copy(normal, vertices[i + k].normal);
+        }
+    }
+}
+
+// Tangents from the UV gradients of the triangles around each vertex, made orthogonal to
+// its normal. The bitangent points up the texture, the way the normal map's green channel
+// does and the way Assimp, which flips v, computes it.
+static void generate_tangents(Vertex *vertices, const size_t vertex_count,
+                              const uint32_t *indices, const size_t index_count,
+                              const uint32_t base) {
+    for (size_t i = 0; i < vertex_count; i++) {
+        glm_vec3_zero(vertices[i].tangent);
+        glm_vec3_zero(vertices[i].bitangent);
+    }
+    for (size_t i = 0; i + 2 < index_count; i += 3) {
+        Vertex *v0 = &vertices[indices[i] - base];
+        Vertex *v1 = &vertices[indices[i + 1] - base];
+        Vertex *v2 = &vertices[indices[i + 2] - base];
+        vec3 edge1;
+        vec3 edge2;
+        glm_vec3_sub(v1->position, v0->position, edge1);
+        glm_vec3_sub(v2->position, v0->position, edge2);
+        const float du1 = v1->texcoord[0] - v0->texcoord[0];
+        const float du2 = v2->texcoord[0] - v0->texcoord[0];
+        const float dv1 = v0->texcoord[1] - v1->texcoord[1];
+        const float dv2 = v0->texcoord[1] - v2->texcoord[1];
+        const float det = (du1 * dv2) - (du2 * dv1);
+        if (fabsf(det) < 1e-12F) {
+            continue;
+        }
+        vec3 tangent;
+        vec3 bitangent;
+        for (int k = 0; k < 3; k++) {
+            tangent[k] = ((edge1[k] * dv2) - (edge2[k] * dv1)) / det;
+            bitangent[k] = ((edge2[k] * du1) - (edge1[k] * du2)) / det;
+        }
+        Vertex *corners[3] = {v0, v1, v2};
+        for (int k = 0; k < 3; k++) {
+            glm_vec3_add(corners[k]->tangent, tangent, corners[k]->tangent);
+            glm_vec3_add(corners[k]->bitangent, bitangent, corners[k]->bitangent);
+        }
+    }
+    for (size_t i = 0; i < vertex_count; i++) {
+        Vertex *v = &vertices[i];
+        vec3 along_normal;
+        glm_vec3_scale(v->normal, glm_vec3_dot(v->normal, v->tangent), along_normal);
+        glm_vec3_sub(v->tangent, along_normal, v->tangent);
+        if (glm_vec3_norm(v->tangent) < 1e-12F) {
+            glm_vec3_copy((vec3){1.0F, 0.0F, 0.0F}, v->tangent);
+            glm_vec3_copy((vec3){0.0F, 0.0F, 1.0F}, v->bitangent);
+            continue;
+        }
+        glm_vec3_normalize(v->tangent);
+        vec3 bitangent;
+        glm_vec3_cross(v->normal, v->tangent, bitangent);
+        const float handedness = glm_vec3_dot(bitangent, v->bitangent) < 0.0F ? -1.0F : 1.0F;
+        glm_vec3_scale(bitangent, handedness, v->bitangent);
+    }
+}
+
+static bool convert_primitive(Gltf *g, const Primitive *p, Mesh *out,
+                              const MaterialInfo *materials) {
+    const int attributes = member(g, p->primitive, "attributes");
+    char texcoord_name[32];
+    snprintf(texcoord_name, sizeof(texcoord_name), "TEXCOORD_%u", g->uv_channel);
+    PrimitiveData d = {0};
+    if (!open_accessor(g, index_member(g, attributes, "POSITION"), &d.position) ||
+        !open_attribute(g, attributes, "NORMAL", 3, d.position.count, &d.normal) ||
+        !open_attribute(g, attributes, texcoord_name, 2, d.position.count, &d.texcoord) ||
+        !open_attribute(g, attributes, "TANGENT", 4, d.position.count, &d.tangent) ||
+        !open_attribute(g, attributes, "JOINTS_0", 4, d.position.count, &d.joints) ||
+        !open_attribute(g, attributes, "WEIGHTS_0", 4, d.position.count, &d.weights) ||
+        (member(g, p->primitive, "indices") >= 0 &&
+         !open_accessor(g, index_member(g, p->primitive, "indices"), &d.indices))) {
+        return false;
+    }
+    if ((d.indices.components && !unsigned_integers(&d.indices, 1)) ||
+        (d.joints.components && !unsigned_integers(&d.joints, 4))) {
+        return false;
+    }
+
+    const int skin = index_member(g, g->nodes.items[p->node], "skin");
+    if (out->has_animations && skin >= 0 && (size_t)skin < g->skins.count) {
+        if (!register_skin(g, &out->skeleton, skin)) {
+            return false;
+        }
+        d.joint_bones = g->skin_bones[skin];
+        d.joint_count = g->skin_joint_counts[skin];
+    }
+
+    Vertex *vertices = out->vertices.data + p->vertex_offset;
+    uint32_t *indices = out->indices.data + p->index_offset;
+    if (!p->flat) {
+        for (size_t i = 0; i < p->vertex_count; i++) {
+            read_vertex(&d, i, &vertices[i]);
+        }
+    }
+    for (uint32_t i = 0; i < p->index_count; i++) {
+        const uint32_t source = d.indices.components ? read_uint(&d.indices, i, 0) : i;
+        if (source >= d.position.count) {
+            return false;
+        }
+        if (p->flat) {
+            read_vertex(&d, source, &vertices[i]);
+        }
+        indices[i] = p->vertex_offset + (p->flat ? i : source);
+    }
+    if (p->flat) {
+        flat_normals(vertices, p->vertex_count);
+    }
+    // Only a normal map reads tangents, so they are worked out only for one
+    if (!d.tangent.components && d.texcoord.components && materials[p->material].normal_path) {
+        generate_tangents(vertices, p->vertex_count, indices, p->index_count, p->vertex_offset);
+    }
+
+    if (out->has_animations) {
+        // Bind pose as stored; vertices no joint moves follow the node holding the mesh
+        int fallback_bone = -1;
+        for (uint32_t i = 0; i < p->vertex_count; i++) {
+            if (vertices[i].bone_ids[0] >= 0) {
+                continue;
+            }
+            if (fallback_bone < 0) {
+                fallback_bone = register_bone(&out->skeleton, g->node_names[p->node], NULL);
+                if (fallback_bone < 0) {
+                    return false;
+                }
+            }
+            vertices[i].bone_ids[0] = fallback_bone;
+            vertices[i].bone_weights[0] = 1.0F;
+        }
+        return true;
+    }
+
+    mat4 *transform = &g->node_globals[p->node];
+    mat3 normal_matrix;
+    glm_mat4_pick3(*transform, normal_matrix);
+    glm_mat3_inv(normal_matrix, normal_matrix);
+    glm_mat3_transpose(normal_matrix);
+    for (uint32_t i = 0; i < p->vertex_count; i++) {
+        Vertex *v = &vertices[i];
+        vec4 position = {v->position[0], v->position[1], v->position[2], 1.0F};
+        vec4 transformed;
+        glm_mat4_mulv(*transform, position, transformed);
+        glm_vec3_copy(transformed, v->position);
+        float *directions[3] = {v->normal, v->tangent, v->bitangent};
+        for (int k = 0; k < 3; k++) {
+            vec3 direction;
+            glm_mat3_mulv(normal_matrix, directions[k], direction);
+            glm_vec3_normalize_to(direction, directions[k]);
+        }
+    }
+    return true;
+}
+
+static bool load_geometry(Gltf *g, Mesh *out, const MaterialInfo *materials,
+                          bool *out_has_uvs) {
+    PrimitiveArray primitives;
+    ARRAY_INIT(primitives);
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+    bool ok = collect_primitives(g, out, &primitives, &vertex_count, &index_count, out_has_uvs);
+    if (ok && vertex_count > 0) {
+        ARRAY_RESERVE(out->vertices, vertex_count);
+    }
+    if (ok && index_count > 0) {
+        ARRAY_RESERVE(out->indices, index_count);
+    }
+    out->vertices.count = ok ? vertex_count : 0;
+    out->indices.count = ok ? index_count : 0;
+    for (size_t i = 0; ok && i < primitives.count; i++) {
+        ok = convert_primitive(g, &primitives.data[i], out, materials);
+    }
+    ARRAY_FREE(primitives);
+    return ok;
+}
+
+// The scene's nodes under one root, in the order build_bone_hierarchy gives Assimp's
+static bool build_hierarchy(const Gltf *g, Skeleton *skeleton) {
+    // Several roots hang from a nameless one, as Assimp's importer adds
+    const bool shared_root = g->root_count != 1;
+    const size_t total = g->node_order_count + (shared_root ? 1 : 0);
+    int *slots = malloc((g->nodes.count > 0 ? g->nodes.count : 1) * sizeof(int));
+    skeleton->bone_hierarchy.data = aligned_malloc((total > 0 ? total : 1) * sizeof(BoneNode));
+    if (!slots || !skeleton->bone_hierarchy.data) {
+        free(slots);
+        return false;
+    }
+    skeleton->bone_hierarchy.capacity = total;
+    skeleton->bone_hierarchy.count = 0;
+
+    for (size_t i = 0; i < total; i++) {
+        const int node = shared_root ? (i == 0 ? -1 : g->node_order[i - 1]) : g->node_order[i];
+        BoneNode bone_node = {0};
+        bone_node.name = str_dup(node >= 0 ? g->node_names[node] : "");
+        if (!bone_node.name) {
+            free(slots);
+            return false;
+        }
+        mat4 transformation;
+        if (node >= 0) {
+            node_local_transform(g, g->nodes.items[node], transformation);
+        } else {
+            glm_mat4_identity(transformation);
+        }
+        bone_node_set_transform(&bone_node, transformation);
+        if (node < 0) {
+            bone_node.parent_index = -1;
+        } else if (g->node_parents[node] >= 0) {
+            bone_node.parent_index = slots[g->node_parents[node]];
+        } else {
+            bone_node.parent_index = shared_root ? 0 : -1;
+        }
+        ARRAY_INIT(bone_node.child_indices);
+
+        const int current_index = (int)skeleton->bone_hierarchy.count;
+        skeleton->bone_hierarchy.data[skeleton->bone_hierarchy.count++] = bone_node;
+        if (node >= 0) {
+            slots[node] = current_index;
+        }
+        if (bone_node.parent_index >= 0) {
+            ARRAY_PUSH(skeleton->bone_hierarchy.data[bone_node.parent_index].child_indices,
+                       current_index);
+        }
+    }
+    free(slots);
+    return true;
+}
+
+// The channel of `animation` for `node_name`, added when it has none yet
+static BoneAnimation *animation_channel(Animation *animation, const char *node_name) {
+    const int existing = bone_anim_map_find(&animation->bone_anim_map, node_name);
+    if (existing >= 0) {
+        return &animation->bone_animations.data[existing];
+    }
+    BoneAnimation bone_anim = {0};
+    bone_anim.bone_name = str_dup(node_name);
+    if (!bone_anim.bone_name) {
+        return NULL;
+    }
+    ARRAY_INIT(bone_anim.position_keys);
+    ARRAY_INIT(bone_anim.scale_keys);
+    ARRAY_INIT(bone_anim.rotation_keys);
+    ARRAY_PUSH(animation->bone_animations, bone_anim);
+    const int index = (int)animation->bone_animations.count - 1;
+    bone_anim_map_insert(&animation->bone_anim_map, node_name, index);
+    return &animation->bone_animations.data[index];
+}
+
+
+// Adds one sampler's keys to `keys`, whose values have `components` floats. Cubic spline
+// outputs hold an in-tangent, the value and an out-tangent per key; only the value is kept,
+// and steps become linear, as the animation system interpolates every key linearly.
+static bool read_channel_keys(const Gltf *g, const int sampler, const bool rotation,
+                              BoneAnimation *bone_anim, VectorKeyArray *vector_keys,
+                              float *duration) {
+    Accessor input;
+    Accessor output;
+    if (!open_accessor(g, index_member(g, sampler, "input"), &input) ||
+        !open_accessor(g, index_member(g, sampler, "output"), &output) ||
+        input.components != 1 || input.component_type != GLTF_FLOAT ||
+        output.components != (rotation ? 4U : 3U)) {
+        return false;
+    }
+    const bool cubic =
+        json_string_equals(&g->json, member(g, sampler, "interpolation"), "CUBICSPLINE");
+    const size_t values_per_key = cubic ? 3 : 1;
+    if (output.count < input.count * values_per_key) {
+        return false;
+    }
+    for (size_t k = 0; k < input.count; k++) {
+        const float time = read_component(&input, k, 0) * GLTF_TICKS_PER_SECOND;
+        const size_t value = (k * values_per_key) + (cubic ? 1 : 0);
+        *duration = fmaxf(*duration, time);
+        if (rotation) {
+            QuaternionKey key;
+            key.time = time;
+            read_floats(&output, value, key.value, 4);
+            ARRAY_PUSH(bone_anim->rotation_keys, key);
+        } else {
+            VectorKey key;
+            key.time = time;
+            read_floats(&output, value, key.value, 3);
+            ARRAY_PUSH(*vector_keys, key);
+        }
+    }
+    return true;
+}
+
+// Node animations only: morph target weights have nothing to drive here
+static bool load_animations(const Gltf *g, AnimationArray *animations) {
+    const size_t count = json_array_size(&g->json, g->animations);
+    int element = json_array_get(&g->json, g->animations, 0);
+    for (size_t i = 0; i < count; i++, element = next_element(g, element)) {
+        Animation animation = {0};
+        animation.name = json_string_dup(&g->json, member(g, element, "name"));
+        animation.name = animation.name ? animation.name : str_dup("");
+        if (!animation.name) {
+            return false;
+        }
+        animation.ticks_per_second = GLTF_TICKS_PER_SECOND;
+        ARRAY_INIT(animation.bone_animations);
+        bone_anim_map_init(&animation.bone_anim_map);
+
+        const int samplers = member(g, element, "samplers");
+        const int channels = member(g, element, "channels");
+        const size_t channel_count = json_array_size(&g->json, channels);
+        int channel = json_array_get(&g->json, channels, 0);
+        bool ok = true;
+        for (size_t j = 0; j < channel_count && ok; j++, channel = next_element(g, channel)) {
+            const int target = member(g, channel, "target");
+            const int node = index_member(g, target, "node");
+            const int path = member(g, target, "path");
+            const bool translation = json_string_equals(&g->json, path, "translation");
+            const bool rotation = json_string_equals(&g->json, path, "rotation");
+            const bool scale = json_string_equals(&g->json, path, "scale");
+            if (node < 0 || (size_t)node >= g->nodes.count || !(translation || rotation || scale)) {
+                continue;
+            }
+            BoneAnimation *bone_anim = animation_channel(&animation, g->node_names[node]);
+            const int sampler =
+                json_array_get(&g->json, samplers, (size_t)index_member(g, channel, "sampler"));
+            ok = bone_anim && sampler >= 0 &&
+                 read_channel_keys(g, sampler, rotation, bone_anim,
+                                   scale ? &bone_anim->scale_keys : &bone_anim->position_keys,
+                                   &animation.duration);
+        }
+        if (!ok) {
+            animation_free(&animation);
+            return false;
+        }
+        ARRAY_PUSH(*animations, animation);
+    }
+    return true;
+}
+
+// Percent escapes decoded, as file names in a uri carry them
+static char *decode_uri(const char *uri) {
+    char *out = malloc(strlen(uri) + 1);
+    if (!out) {
+        return NULL;
+    }
+    size_t length = 0;
+    for (const char *c = uri; *c; c++) {
+        unsigned int byte;
+        if (c[0] == '%' && c[1] && c[2] && sscanf(c + 1, "%2x", &byte) == 1) {
+            out[length++] = (char)byte;
+            c += 2;
+        } else {
+            out[length++] = *c;
+        }
+    }
+    out[length] = '\0';
+    return out;
+}
+
+// A file image, relative to the model's directory unless absolute
+static char *resolve_image_uri(const char *model_path, const char *uri) {
+    char *decoded = decode_uri(uri);
+    if (!decoded || decoded[0] == '/' ||
+        (decoded[0] && decoded[1] == ':' && (decoded[2] == '\\' || decoded[2] == '/'))) {
+        return decoded;
+    }
+    const char *last_slash = strrchr(model_path, '/');
+    const char *last_backslash = strrchr(model_path, '\\');
+    const char *last_sep = (last_slash > last_backslash) ? last_slash : last_backslash;
+    if (!last_sep) {
+        return decoded;
+    }
+    const size_t dir_len = (size_t)(last_sep - model_path) + 1;
+    const size_t path_len = strlen(decoded);
+    char *full_path = malloc(dir_len + path_len + 1);
+    if (full_path) {
+        memcpy(full_path, model_path, dir_len);
+        memcpy(full_path + dir_len, decoded, path_len + 1);
+    }
+    free(decoded);
+    return full_path;
+}
+
+// The image a material's texture info points at. An image in the BIN chunk is named "*N"
+// like Assimp's embedded textures, N counting only the embedded images, and its bytes are
+// copied out. False for images this loader cannot pass on, such as data URIs.
+static bool material_texture(const Gltf *g, const int texture_info, char **out_path,
+                             unsigned char **out_bytes, size_t *out_size) {
+    const int texture = list_get(&g->textures, index_member(g, texture_info, "index"));
+    const int source = index_member(g, texture, "source");
+    const int image = list_get(&g->images, source);
+    if (image < 0) {
+        // No texture, or only an extension's (KTX2, WebP) source: drawn untextured
+        return true;
+    }
+    const int uri = member(g, image, "uri");
+    if (uri >= 0) {
+        char *raw = json_string_dup(&g->json, uri);
+        if (!raw || strncmp(raw, "data:", 5) == 0) {
+            free(raw);
+            return false;
+        }
+        *out_path = resolve_image_uri(g->path, raw);
+        free(raw);
+        return *out_path != NULL;
+    }
+
+    const uint8_t *bytes;
+    size_t size;
+    if (!buffer_view_bytes(g, list_get(&g->buffer_views, index_member(g, image, "bufferView")),
+                           &bytes, &size) ||
+        size == 0) {
+        return false;
+    }
+    unsigned int embedded = 0;
+    for (int i = 0; i < source; i++) {
+        embedded += member(g, g->images.items[i], "bufferView") >= 0 ? 1U : 0U;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "*%u", embedded);
+    *out_path = str_dup(name);
+    *out_bytes = malloc(size);
+    if (!*out_path || !*out_bytes) {
+        return false;
+    }
+    memcpy(*out_bytes, bytes, size);
+    *out_size = size;
+    return true;
+}
+
+// Whether some primitive the scene draws has no material of the file's own
+static bool needs_default_material(const Gltf *g) {
+    for (size_t n = 0; n < g->node_order_count; n++) {
+        const int node = g->nodes.items[g->node_order[n]];
+        const int mesh = list_get(&g->meshes, index_member(g, node, "mesh"));
+        const int list = member(g, mesh, "primitives");
+        const size_t count = json_array_size(&g->json, list);
+        int primitive = json_array_get(&g->json, list, 0);
+        for (size_t i = 0; i < count; i++, primitive = next_element(g, primitive)) {
+            const int material = index_member(g, primitive, "material");
+            if (material < 0 || (size_t)material >= g->materials.count) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Base colour, normal map and alpha mode as the file gives them; metallic and roughness
+// mapped onto the renderer's specular terms the way load_model maps Assimp's
+static bool read_material(const Gltf *g, const int material, MaterialInfo *mat) {
+    const int pbr = member(g, material, "pbrMetallicRoughness");
+    read_numbers(g, member(g, pbr, "baseColorFactor"), mat->base_color, 4);
+    if (!material_texture(g, member(g, pbr, "baseColorTexture"), &mat->diffuse_path,
+                          &mat->embedded_diffuse, &mat->embedded_diffuse_size) ||
+        !material_texture(g, member(g, material, "normalTexture"), &mat->normal_path,
+                          &mat->embedded_normal, &mat->embedded_normal_size)) {
+        return false;
+    }
+
+    const int alpha_mode = member(g, material, "alphaMode");
+    if (json_string_equals(&g->json, alpha_mode, "MASK")) {
+        mat->alpha_mode = ALPHA_MODE_MASK;
+    } else if (json_string_equals(&g->json, alpha_mode, "BLEND")) {
+        mat->alpha_mode = ALPHA_MODE_BLEND;
+    }
+
+    const float metallic = (float)number(g, pbr, "metallicFactor", 1.0);
+    const float roughness = clampf((float)number(g, pbr, "roughnessFactor", 1.0), 0.0F, 1.0F);
+    mat->specular_strength = fmaxf(mat->specular_strength, clampf(metallic, 0.0F, 1.0F));
+    mat->shininess = clampf(((1.0F - roughness) * 120.0F) + 8.0F, 8.0F, 256.0F);
+    mat->specular_strength = fmaxf(mat->specular_strength, (1.0F - roughness) * 0.35F);
+    return true;
+}
+
+static bool load_materials(Gltf *g, MaterialInfo **out_materials, size_t *out_count) {
+    // The UV set of the first base colour texture that names one, for every material
+    for (size_t i = 0; i < g->materials.count; i++) {
+        const int pbr = member(g, g->materials.items[i], "pbrMetallicRoughness");
+        const int tex_coord = index_member(g, member(g, pbr, "baseColorTexture"), "texCoord");
+        if (tex_coord > 0) {
+            g->uv_channel = (unsigned int)tex_coord;
+            break;
+        }
+    }
+
+    size_t count = g->materials.count + (needs_default_material(g) ? 1 : 0);
+    count = count > 0 ? count : 1;
+    MaterialInfo *mats = calloc(count, sizeof(MaterialInfo));
+    if (!mats) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        material_info_init(&mats[i]);
+        mats[i].uv_channel = g->uv_channel;
+    }
+    *out_materials = mats;
+    *out_count = count;
+    for (size_t i = 0; i < g->materials.count; i++) {
+        if (!read_material(g, g->materials.items[i], &mats[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool load_skeleton(const Gltf *g, Mesh *mesh) {
+    if (!build_hierarchy(g, &mesh->skeleton) || !skeleton_flatten(&mesh->skeleton) ||
+        !load_animations(g, &mesh->animations)) {
+        return false;
+    }
+    for (size_t i = 0; i < mesh->animations.count; i++) {
+        animation_bind_skeleton(&mesh->animations.data[i], &mesh->skeleton);
+    }
+    // Joint transforms run from the scene root, as in load_model
+    glm_mat4_identity(mesh->skeleton.global_inverse_transform);
+    return true;
+}
+
+bool gltf_load_glb(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **out_materials,
+                   size_t *out_material_count) {
+    size_t size = 0;
+    const uint8_t *data = dcat_map_file(path, &size);
+    if (!data) {
+        return false;
+    }
+    Gltf g = {.path = path};
+    MaterialInfo *mats = NULL;
+    size_t mat_count = 0;
+    bool ok = gltf_is_glb(data, size) && gltf_open(&g, data, size) && prepare_nodes(&g);
+    if (ok) {
+        mesh_free(mesh);
+        mesh_init(mesh);
+        glm_mat4_identity(mesh->coordinate_system_transform);
+        *out_has_uvs = false;
+        mesh->has_animations = json_array_size(&g.json, g.animations) > 0;
+        if (mesh->has_animations) {
+            bone_map_init(&mesh->skeleton.bone_map);
+            ARRAY_INIT(mesh->skeleton.bones);
+            ARRAY_INIT(mesh->skeleton.bone_hierarchy);
+        }
+        g.skin_bones = calloc(g.skins.count > 0 ? g.skins.count : 1, sizeof(int *));
+        g.skin_joint_counts = calloc(g.skins.count > 0 ? g.skins.count : 1, sizeof(size_t));
+        ok = g.skin_bones && g.skin_joint_counts && load_materials(&g, &mats, &mat_count) &&
+             load_geometry(&g, mesh, mats, out_has_uvs) &&
+             (!mesh->has_animations || load_skeleton(&g, mesh));
+        if (!ok) {
+            materials_free(mats, mat_count);
+            mesh_free(mesh);
+            mesh_init(mesh);
+        }
+    }
+    gltf_close(&g);
+    dcat_unmap_file(data, size);
+    if (ok) {
+        *out_materials = mats;
+        *out_material_count = mat_count;
+    }
+    return ok;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "model.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Whether `data` starts with the binary glTF header
+bool gltf_is_glb(const uint8_t *data, size_t size);
+
+// Reads a binary glTF 2.0 file straight into `mesh` and its materials, the way load_model
+// lays out an Assimp import: node transforms baked into static models, the bind pose and a
+// skeleton for animated ones, tangents only where a material has a normal map. Leaves the
+// LODs, optimization and meshlets to the caller.
+//
+// Handles what the common exporters write: triangles in the BIN chunk, skins, node
+// animations and embedded or file textures. Anything else (external or data-URI buffers,
+// sparse accessors, strips, compression extensions) returns false with `mesh` empty, and
+// the caller falls back to Assimp.
+bool gltf_load_glb(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **out_materials,
+                   size_t *out_material_count);
@@ -0,0 +1,149 @@
+#include "ktx2.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Little-endian throughout: the identifier, a 68-byte header, then one level index entry
+// per mip level, largest first
+#define KTX2_IDENTIFIER_SIZE 12U
+#define KTX2_HEADER_SIZE 80U
+#define KTX2_LEVEL_ENTRY_SIZE 24U
+
+// VkFormat values the header may carry
+#define KTX2_VK_FORMAT_UNDEFINED 0U
+#define KTX2_VK_FORMAT_R8G8B8A8_UNORM 37U
+#define KTX2_VK_FORMAT_R8G8B8A8_SRGB 43U
+#define KTX2_VK_FORMAT_BC5_UNORM 141U
+#define KTX2_VK_FORMAT_BC7_UNORM 145U
+#define KTX2_VK_FORMAT_BC7_SRGB 146U
+#define KTX2_VK_FORMAT_ETC2_R8G8B8A8_UNORM 151U
+#define KTX2_VK_FORMAT_ETC2_R8G8B8A8_SRGB 152U
+#define KTX2_VK_FORMAT_ASTC_4X4_UNORM 157U
+#define KTX2_VK_FORMAT_ASTC_4X4_SRGB 158U
+
+static const uint8_t ktx2_identifier[KTX2_IDENTIFIER_SIZE] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+static uint32_t read_u32(const uint8_t *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint64_t read_u64(const uint8_t *data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+bool ktx2_is_file(const uint8_t *data, const size_t size) {
+    return size >= KTX2_IDENTIFIER_SIZE && memcmp(data, ktx2_identifier, KTX2_IDENTIFIER_SIZE) == 0;
+}
+
+// Whether the file's color space matches is left to the material: base colours are
+// sampled as sRGB and normal maps as UNORM whatever the header says
+static bool texture_format_from_vk(const uint32_t vk_format, TextureFormat *out) {
+    switch (vk_format) {
+    case KTX2_VK_FORMAT_R8G8B8A8_UNORM:
+    case KTX2_VK_FORMAT_R8G8B8A8_SRGB:
+        *out = TEXTURE_FORMAT_RGBA8;
+        return true;
+    case KTX2_VK_FORMAT_BC5_UNORM:
+        *out = TEXTURE_FORMAT_BC5;
+        return true;
+    case KTX2_VK_FORMAT_BC7_UNORM:
+    case KTX2_VK_FORMAT_BC7_SRGB:
+        *out = TEXTURE_FORMAT_BC7;
+        return true;
+    case KTX2_VK_FORMAT_ETC2_R8G8B8A8_UNORM:
+    case KTX2_VK_FORMAT_ETC2_R8G8B8A8_SRGB:
+        *out = TEXTURE_FORMAT_ETC2_RGBA8;
+        return true;
+    case KTX2_VK_FORMAT_ASTC_4X4_UNORM:
+    case KTX2_VK_FORMAT_ASTC_4X4_SRGB:
+        *out = TEXTURE_FORMAT_ASTC_4X4;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool texture_from_ktx2(Texture *tex, const uint8_t *data, const size_t size,
+                       const uint32_t max_size) {
+    if (!ktx2_is_file(data, size) || size < KTX2_HEADER_SIZE) {
+        return false;
+    }
+    const uint32_t vk_format = read_u32(data + 12);
+    const uint32_t width = read_u32(data + 20);
+    const uint32_t height = read_u32(data + 24);
+    const uint32_t depth = read_u32(data + 28);
+    const uint32_t layers = read_u32(data + 32);
+    const uint32_t faces = read_u32(data + 36);
+    const uint32_t stored_levels = read_u32(data + 40);
+    const uint32_t supercompression = read_u32(data + 44);
+    // 0 asks the loader to generate the chain, which the GPU upload does for RGBA8
+    const uint32_t level_count = stored_levels > 0 ? stored_levels : 1U;
+
+    if (vk_format == KTX2_VK_FORMAT_UNDEFINED || supercompression != 0) {
+        fprintf(stderr, "Warning: KTX2 texture needs a Basis Universal or zstd transcoder, "
+                        "which this build does not include\n");
+        return false;
+    }
+    TextureFormat format;
+    if (!texture_format_from_vk(vk_format, &format) || !texture_gpu_supports(format)) {
+        fprintf(stderr, "Warning: KTX2 texture format %u is not supported by this GPU\n",
+                vk_format);
+        return false;
+    }
+    if (width == 0 || height == 0 || depth > 1 || layers > 1 || faces != 1 || level_count > 32 ||
+        (size_t)KTX2_HEADER_SIZE + (size_t)level_count * KTX2_LEVEL_ENTRY_SIZE > size) {
+        fprintf(stderr, "Warning: Unsupported KTX2 texture layout\n");
+        return false;
+    }
+
+    uint32_t first = 0;
+    while (max_size > 0 && first + 1U < level_count &&
+           ((width >> first) > max_size || (height >> first) > max_size)) {
+        first++;
+    }
+    size_t total = 0;
+    for (uint32_t level = first; level < level_count; level++) {
+        const uint8_t *entry = data + KTX2_HEADER_SIZE + (size_t)level * KTX2_LEVEL_ENTRY_SIZE;
+        const uint64_t offset = read_u64(entry);
+        const uint64_t length = read_u64(entry + 8);
+        const uint32_t level_width = (width >> level) > 0 ? width >> level : 1U;
+        const uint32_t level_height = (height >> level) > 0 ? height >> level : 1U;
+        if (length != texture_level_size(format, level_width, level_height) || offset > size ||
+            length > size - offset) {
+            fprintf(stderr, "Warning: Truncated KTX2 texture\n");
+            return false;
+        }
+        total += (size_t)length;
+    }
+
+    uint8_t *pixels = malloc(total);
+    if (!pixels) {
+        return false;
+    }
+    size_t written = 0;
+    for (uint32_t level = first; level < level_count; level++) {
+        const uint8_t *entry = data + KTX2_HEADER_SIZE + (size_t)level * KTX2_LEVEL_ENTRY_SIZE;
+        const size_t length = (size_t)read_u64(entry + 8);
+        memcpy(pixels + written, data + read_u64(entry), length);
+        written += length;
+    }
+
+    tex->width = (width >> first) > 0 ? width >> first : 1U;
+    tex->height = (height >> first) > 0 ? height >> first : 1U;
+    tex->data = pixels;
+    tex->data_size = total;
+    tex->format = format;
+    tex->mip_levels = level_count - first;
+    tex->refs = NULL;
+    tex->has_transparency = false;
+    if (format == TEXTURE_FORMAT_RGBA8) {
+        texture_update_transparency(tex);
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "texture.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Whether `data` starts with the KTX2 file identifier
+bool ktx2_is_file(const uint8_t *data, size_t size);
+
+// Loads a 2D KTX2 texture whose format the renderer samples directly (BC5, BC7, ETC2 RGBA,
+// ASTC 4x4 or RGBA8), keeping its mip chain. Levels with an edge above `max_size` are
+// skipped when smaller ones follow; 0 keeps them all. Basis Universal payloads and
+// supercompressed files need a transcoder and are rejected, as is anything the GPU cannot
+// sample, leaving the texture untouched.
+bool texture_from_ktx2(Texture *tex, const uint8_t *data, size_t size, uint32_t max_size);
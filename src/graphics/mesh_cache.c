@@ -0,0 +1,880 @@
+#include "mesh_cache.h"
+#include "core/hash.h"
+#include "platform/io.h"
+#include "platform/path.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A flat little-endian file: the header, then one 64-byte aligned section per table. Vertex,
+// index, submesh and meshlet sections hold the in-memory structs as they are, so loading them
+// is a copy out of the mapping; the rest are fixed-size records that point into STRINGS/BLOBS.
+#define MESH_CACHE_MAGIC "DCATMESH"
+// Bumped whenever load_model's output changes, not only the layout: caches of the old
+// version would keep serving meshes without the change (3: post-transform cache order)
+#define MESH_CACHE_VERSION 3U
+#define MESH_CACHE_ALIGNMENT 64U
+// Catches struct changes that were not accompanied by a version bump
+#define MESH_CACHE_LAYOUT ((uint32_t)sizeof(Vertex) | ((uint32_t)sizeof(SubMesh) << 16))
+
+#define MESH_CACHE_HAS_UVS 0x1U
+#define MESH_CACHE_HAS_ANIMATIONS 0x2U
+
+// Material path flags: stored relative to the model's directory
+#define MESH_CACHE_DIFFUSE_RELATIVE 0x1U
+#define MESH_CACHE_NORMAL_RELATIVE 0x2U
+
+typedef enum MeshCacheSection {
+    MESH_CACHE_VERTICES,
+    MESH_CACHE_INDICES,
+    MESH_CACHE_SUBMESHES,
+    MESH_CACHE_MESHLETS,
+    MESH_CACHE_MATERIALS,
+    MESH_CACHE_BONES,
+    MESH_CACHE_NODES,
+    MESH_CACHE_CHILDREN,
+    MESH_CACHE_ANIMATIONS,
+    MESH_CACHE_CHANNELS,
+    MESH_CACHE_VECTOR_KEYS,
+    MESH_CACHE_ROTATION_KEYS,
+    MESH_CACHE_STRINGS,
+    MESH_CACHE_BLOBS,
+    MESH_CACHE_SECTION_COUNT
+} MeshCacheSection;
+
+typedef struct MeshCacheRange {
+    uint64_t offset;
+    uint64_t size;
+} MeshCacheRange;
+
+typedef struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint32_t flags;
+    uint32_t reserved;
+    float coordinate_system_transform[16];
+    float global_inverse_transform[16];
+    MeshCacheRange sections[MESH_CACHE_SECTION_COUNT];
+} MeshCacheHeader;
+
+// Offset into STRINGS; size counts the terminator, so 0 is NULL
+typedef struct CachedString {
+    uint32_t offset;
+    uint32_t size;
+} CachedString;
+
+typedef struct CachedMaterial {
+    CachedString diffuse_path;
+    CachedString normal_path;
+    uint32_t path_flags;
+    uint32_t alpha_mode;
+    uint32_t uv_channel;
+    float specular_strength;
+    float shininess;
+    float base_color[4];
+    uint32_t reserved;
+    // Ranges of BLOBS; size 0 is no embedded texture
+    uint64_t embedded_diffuse_offset;
+    uint64_t embedded_diffuse_size;
+    uint64_t embedded_normal_offset;
+    uint64_t embedded_normal_size;
+} CachedMaterial;
+
+typedef struct CachedBone {
+    CachedString name;
+    int32_t index;
+    float offset_matrix[16];
+} CachedBone;
+
+typedef struct CachedNode {
+    CachedString name;
+    int32_t parent_index;
+    uint32_t child_offset; // into CHILDREN
+    uint32_t child_count;
+    float transformation[16];
+    float initial_position[3];
+    float initial_rotation[4];
+    float initial_scale[3];
+} CachedNode;
+
+typedef struct CachedAnimation {
+    CachedString name;
+    float duration;
+    float ticks_per_second;
+    uint32_t channel_offset; // into CHANNELS
+    uint32_t channel_count;
+} CachedAnimation;
+
+// Position and scale keys share VECTOR_KEYS
+typedef struct CachedChannel {
+    CachedString bone_name;
+    uint32_t position_offset;
+    uint32_t position_count;
+    uint32_t rotation_offset;
+    uint32_t rotation_count;
+    uint32_t scale_offset;
+    uint32_t scale_count;
+} CachedChannel;
+
+typedef struct CachedVectorKey {
+    float time;
+    float value[3];
+} CachedVectorKey;
+
+typedef struct CachedRotationKey {
+    float time;
+    float value[4];
+} CachedRotationKey;
+
+static const size_t section_element_sizes[MESH_CACHE_SECTION_COUNT] = {
+    [MESH_CACHE_VERTICES] = sizeof(Vertex),
+    [MESH_CACHE_INDICES] = sizeof(uint32_t),
+    [MESH_CACHE_SUBMESHES] = sizeof(SubMesh),
+    [MESH_CACHE_MESHLETS] = sizeof(Meshlet),
+    [MESH_CACHE_MATERIALS] = sizeof(CachedMaterial),
+    [MESH_CACHE_BONES] = sizeof(CachedBone),
+    [MESH_CACHE_NODES] = sizeof(CachedNode),
+    [MESH_CACHE_CHILDREN] = sizeof(int32_t),
+    [MESH_CACHE_ANIMATIONS] = sizeof(CachedAnimation),
+    [MESH_CACHE_CHANNELS] = sizeof(CachedChannel),
+    [MESH_CACHE_VECTOR_KEYS] = sizeof(CachedVectorKey),
+    [MESH_CACHE_ROTATION_KEYS] = sizeof(CachedRotationKey),
+    [MESH_CACHE_STRINGS] = 1,
+    [MESH_CACHE_BLOBS] = 1,
+};
+
+bool mesh_cache_key(const char *source_path, const char *cache_directory, MeshCacheKey *out) {
+    memset(out, 0, sizeof(*out));
+    char default_directory[400];
+    if (!cache_directory) {
+        if (!dcat_get_cache_directory(default_directory, sizeof(default_directory))) {
+            return false;
+        }
+        cache_directory = default_directory;
+    }
+    char absolute_path[1024];
+    if (!dcat_get_absolute_path(source_path, absolute_path, sizeof(absolute_path)) ||
+        !dcat_stat_file(source_path, &out->source_size, &out->source_mtime)) {
+        return false;
+    }
+
+    size_t mapped_size = 0;
+    const void *source = dcat_map_file(source_path, &mapped_size);
+    if (!source) {
+        return false;
+    }
+    out->source_hash = dcat_hash_bytes(source, mapped_size);
+    dcat_unmap_file(source, mapped_size);
+    if (mapped_size != out->source_size) {
+        // Changed between the stat and the map
+        return false;
+    }
+
+    // One entry per source file; a changed file overwrites its own entry
+    const uint64_t path_hash =
+        dcat_hash_bytes((const uint8_t *)absolute_path, strlen(absolute_path));
+    const int len = snprintf(out->cache_path, sizeof(out->cache_path), "%smesh-%016llx.bin",
+                             cache_directory, (unsigned long long)path_hash);
+    return len > 0 && (size_t)len < sizeof(out->cache_path);
+}
+
+// Length of the directory part of `path`, separator included
+static size_t directory_length(const char *path) {
+    const char *last_slash = strrchr(path, '/');
+    const char *last_backslash = strrchr(path, '\\');
+    const char *last_sep = (last_slash > last_backslash) ? last_slash : last_backslash;
+    return last_sep ? (size_t)(last_sep - path) + 1 : 0;
+}
+
+typedef struct CacheWriter {
+    FILE *file;
+    uint64_t offset;
+    bool ok;
+    MeshCacheHeader header;
+    // STRINGS is built up while the records are written and goes out last
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+} CacheWriter;
+
+static void write_bytes(CacheWriter *w, const void *data, const size_t size) {
+    if (w->ok && size > 0) {
+        w->ok = fwrite(data, 1, size, w->file) == size;
+        w->offset += size;
+    }
+}
+
+static void begin_section(CacheWriter *w, const MeshCacheSection section) {
+    static const uint8_t zeros[MESH_CACHE_ALIGNMENT] = {0};
+    const uint64_t padding = (MESH_CACHE_ALIGNMENT - (w->offset % MESH_CACHE_ALIGNMENT)) %
+                             MESH_CACHE_ALIGNMENT;
+    write_bytes(w, zeros, (size_t)padding);
+    w->header.sections[section].offset = w->offset;
+}
+
+static void end_section(CacheWriter *w, const MeshCacheSection section) {
+    w->header.sections[section].size = w->offset - w->header.sections[section].offset;
+}
+
+static CachedString add_string(CacheWriter *w, const char *s) {
+    CachedString ref = {0};
+    if (!s || !w->ok) {
+        return ref;
+    }
+    const size_t size = strlen(s) + 1;
+    if (w->strings_size + size > UINT32_MAX) {
+        w->ok = false;
+        return ref;
+    }
+    if (w->strings_size + size > w->strings_capacity) {
+        size_t capacity = w->strings_capacity ? w->strings_capacity * 2 : 4096;
+        while (capacity < w->strings_size + size) {
+            capacity *= 2;
+        }
+        char *grown = realloc(w->strings, capacity);
+        if (!grown) {
+            w->ok = false;
+            return ref;
+        }
+        w->strings = grown;
+        w->strings_capacity = capacity;
+    }
+    memcpy(w->strings + w->strings_size, s, size);
+    ref.offset = (uint32_t)w->strings_size;
+    ref.size = (uint32_t)size;
+    w->strings_size += size;
+    return ref;
+}
+
+// Texture paths under the model's directory are stored without it, so the entry still
+// resolves when the model is opened through a different relative path
+static CachedString add_texture_path(CacheWriter *w, const char *path, const char *model_path,
+                                     const uint32_t relative_flag, uint32_t *flags) {
+    if (!path || path[0] == '*') {
+        return add_string(w, path);
+    }
+    const size_t dir_len = directory_length(model_path);
+    if (dir_len > 0 && strncmp(path, model_path, dir_len) == 0) {
+        *flags |= relative_flag;
+        return add_string(w, path + dir_len);
+    }
+    if (dir_len == 0 && path[0] != '/') {
+        *flags |= relative_flag;
+    }
+    return add_string(w, path);
+}
+
+static void write_materials(CacheWriter *w, const char *source_path,
+                            const MaterialInfo *materials, const size_t material_count) {
+    uint64_t blob_offset = 0;
+    begin_section(w, MESH_CACHE_MATERIALS);
+    for (size_t i = 0; i < material_count; i++) {
+        const MaterialInfo *m = &materials[i];
+        CachedMaterial record = {0};
+        record.diffuse_path = add_texture_path(w, m->diffuse_path, source_path,
+                                               MESH_CACHE_DIFFUSE_RELATIVE, &record.path_flags);
+        record.normal_path = add_texture_path(w, m->normal_path, source_path,
+                                              MESH_CACHE_NORMAL_RELATIVE, &record.path_flags);
+        record.alpha_mode = (uint32_t)m->alpha_mode;
+        record.uv_channel = m->uv_channel;
+        record.specular_strength = m->specular_strength;
+        record.shininess = m->shininess;
+        memcpy(record.base_color, m->base_color, sizeof(record.base_color));
+        if (m->embedded_diffuse) {
+            record.embedded_diffuse_offset = blob_offset;
+            record.embedded_diffuse_size = m->embedded_diffuse_size;
+            blob_offset += m->embedded_diffuse_size;
+        }
+        if (m->embedded_normal) {
+            record.embedded_normal_offset = blob_offset;
+            record.embedded_normal_size = m->embedded_normal_size;
+            blob_offset += m->embedded_normal_size;
+        }
+        write_bytes(w, &record, sizeof(record));
+    }
+    end_section(w, MESH_CACHE_MATERIALS);
+}
+
+static void write_skeleton(CacheWriter *w, const Skeleton *skeleton) {
+    begin_section(w, MESH_CACHE_BONES);
+    for (size_t i = 0; i < skeleton->bones.count; i++) {
+        const BoneInfo *bone = &skeleton->bones.data[i];
+        CachedBone record = {0};
+        record.name = add_string(w, bone->name);
+        record.index = bone->index;
+        memcpy(record.offset_matrix, bone->offset_matrix, sizeof(record.offset_matrix));
+        write_bytes(w, &record, sizeof(record));
+    }
+    end_section(w, MESH_CACHE_BONES);
+
+    uint32_t child_offset = 0;
+    begin_section(w, MESH_CACHE_NODES);
+    for (size_t i = 0; i < skeleton->bone_hierarchy.count; i++) {
+        const BoneNode *node = &skeleton->bone_hierarchy.data[i];
+        CachedNode record = {0};
+        record.name = add_string(w, node->name);
+        record.parent_index = node->parent_index;
+        record.child_offset = child_offset;
+        record.child_count = (uint32_t)node->child_indices.count;
+        child_offset += record.child_count;
+        memcpy(record.transformation, node->transformation, sizeof(record.transformation));
+        memcpy(record.initial_position, node->initial_position, sizeof(record.initial_position));
+        memcpy(record.initial_rotation, node->initial_rotation, sizeof(record.initial_rotation));
+        memcpy(record.initial_scale, node->initial_scale, sizeof(record.initial_scale));
+        write_bytes(w, &record, sizeof(record));
+    }
+    end_section(w, MESH_CACHE_NODES);
+
+    begin_section(w, MESH_CACHE_CHILDREN);
+    for (size_t i = 0; i < skeleton->bone_hierarchy.count; i++) {
+        const IntArray *children = &skeleton->bone_hierarchy.data[i].child_indices;
+        for (size_t j = 0; j < children->count; j++) {
+            const int32_t child = children->data[j];
+            write_bytes(w, &child, sizeof(child));
+        }
+    }
+    end_section(w, MESH_CACHE_CHILDREN);
+}
+
+static void write_vector_keys(CacheWriter *w, const VectorKeyArray *keys) {
+    for (size_t i = 0; i < keys->count; i++) {
+        CachedVectorKey key = {.time = keys->data[i].time};
+        memcpy(key.value, keys->data[i].value, sizeof(key.value));
+        write_bytes(w, &key, sizeof(key));
+    }
+}
+
+static void write_animations(CacheWriter *w, const AnimationArray *animations) {
+    uint32_t channel_offset = 0;
+    begin_section(w, MESH_CACHE_ANIMATIONS);
+    for (size_t i = 0; i < animations->count; i++) {
+        const Animation *animation = &animations->data[i];
+        CachedAnimation record = {0};
+        record.name = add_string(w, animation->name);
+        record.duration = animation->duration;
+        record.ticks_per_second = animation->ticks_per_second;
+        record.channel_offset = channel_offset;
+        record.channel_count = (uint32_t)animation->bone_animations.count;
+        channel_offset += record.channel_count;
+        write_bytes(w, &record, sizeof(record));
+    }
+    end_section(w, MESH_CACHE_ANIMATIONS);
+
+    uint32_t vector_offset = 0;
+    uint32_t rotation_offset = 0;
+    begin_section(w, MESH_CACHE_CHANNELS);
+    for (size_t i = 0; i < animations->count; i++) {
+        const BoneAnimationArray *channels = &animations->data[i].bone_animations;
+        for (size_t j = 0; j < channels->count; j++) {
+            const BoneAnimation *channel = &channels->data[j];
+            CachedChannel record = {0};
+            record.bone_name = add_string(w, channel->bone_name);
+            record.position_offset = vector_offset;
+            record.position_count = (uint32_t)channel->position_keys.count;
+            vector_offset += record.position_count;
+            record.scale_offset = vector_offset;
+            record.scale_count = (uint32_t)channel->scale_keys.count;
+            vector_offset += record.scale_count;
+            record.rotation_offset = rotation_offset;
+            record.rotation_count = (uint32_t)channel->rotation_keys.count;
+            rotation_offset += record.rotation_count;
+            write_bytes(w, &record, sizeof(record));
+        }
+    }
+    end_section(w, MESH_CACHE_CHANNELS);
+
+    begin_section(w, MESH_CACHE_VECTOR_KEYS);
+    for (size_t i = 0; i < animations->count; i++) {
+        const BoneAnimationArray *channels = &animations->data[i].bone_animations;
+        for (size_t j = 0; j < channels->count; j++) {
+            write_vector_keys(w, &channels->data[j].position_keys);
+            write_vector_keys(w, &channels->data[j].scale_keys);
+        }
+    }
+    end_section(w, MESH_CACHE_VECTOR_KEYS);
+
+    begin_section(w, MESH_CACHE_ROTATION_KEYS);
+    for (size_t i = 0; i < animations->count; i++) {
+        const BoneAnimationArray *channels = &animations->data[i].bone_animations;
+        for (size_t j = 0; j < channels->count; j++) {
+            const QuaternionKeyArray *keys = &channels->data[j].rotation_keys;
+            for (size_t k = 0; k < keys->count; k++) {
+                CachedRotationKey key = {.time = keys->data[k].time};
+                memcpy(key.value, keys->data[k].value, sizeof(key.value));
+                write_bytes(w, &key, sizeof(key));
+            }
+        }
+    }
+    end_section(w, MESH_CACHE_ROTATION_KEYS);
+}
+
+bool mesh_cache_store(const MeshCacheKey *key, const char *source_path, const Mesh *mesh,
+                      const bool has_uvs, const MaterialInfo *materials,
+                      const size_t material_count) {
+    if (!key->cache_path[0]) {
+        return false;
+    }
+    // Write then rename, so a concurrent dcat never maps a half-written entry
+    char temp_path[sizeof(key->cache_path) + 16];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", key->cache_path, dcat_getpid());
+    CacheWriter w = {.file = fopen(temp_path, "wb"), .ok = true};
+    if (!w.file) {
+        return false;
+    }
+
+    MeshCacheHeader *header = &w.header;
+    memcpy(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic));
+    header->version = MESH_CACHE_VERSION;
+    header->layout = MESH_CACHE_LAYOUT;
+    header->source_size = key->source_size;
+    header->source_mtime = key->source_mtime;
+    header->source_hash = key->source_hash;
+    header->flags = (has_uvs ? MESH_CACHE_HAS_UVS : 0U) |
+                    (mesh->has_animations ? MESH_CACHE_HAS_ANIMATIONS : 0U);
+    memcpy(header->coordinate_system_transform, mesh->coordinate_system_transform,
+           sizeof(header->coordinate_system_transform));
+    memcpy(header->global_inverse_transform, mesh->skeleton.global_inverse_transform,
+           sizeof(header->global_inverse_transform));
+    // Rewritten with the section table once everything else is out
+    write_bytes(&w, header, sizeof(*header));
+
+    begin_section(&w, MESH_CACHE_VERTICES);
+    write_bytes(&w, mesh->vertices.data, mesh->vertices.count * sizeof(Vertex));
+    end_section(&w, MESH_CACHE_VERTICES);
+    begin_section(&w, MESH_CACHE_INDICES);
+    write_bytes(&w, mesh->indices.data, mesh->indices.count * sizeof(uint32_t));
+    end_section(&w, MESH_CACHE_INDICES);
+    begin_section(&w, MESH_CACHE_SUBMESHES);
+    write_bytes(&w, mesh->submeshes.data, mesh->submeshes.count * sizeof(SubMesh));
+    end_section(&w, MESH_CACHE_SUBMESHES);
+    begin_section(&w, MESH_CACHE_MESHLETS);
+    write_bytes(&w, mesh->meshlets.data, mesh->meshlets.count * sizeof(Meshlet));
+    end_section(&w, MESH_CACHE_MESHLETS);
+
+    write_materials(&w, source_path, materials, material_count);
+    write_skeleton(&w, &mesh->skeleton);
+    write_animations(&w, &mesh->animations);
+
+    begin_section(&w, MESH_CACHE_STRINGS);
+    write_bytes(&w, w.strings, w.strings_size);
+    end_section(&w, MESH_CACHE_STRINGS);
+    begin_section(&w, MESH_CACHE_BLOBS);
+    for (size_t i = 0; i < material_count; i++) {
+        if (materials[i].embedded_diffuse) {
+            write_bytes(&w, materials[i].embedded_diffuse, materials[i].embedded_diffuse_size);
+        }
+        if (materials[i].embedded_normal) {
+            write_bytes(&w, materials[i].embedded_normal, materials[i].embedded_normal_size);
+        }
+    }
+    end_section(&w, MESH_CACHE_BLOBS);
+
+    if (w.ok) {
+        w.ok = fseek(w.file, 0, SEEK_SET) == 0 &&
+               fwrite(header, 1, sizeof(*header), w.file) == sizeof(*header);
+    }
+    w.ok = (fclose(w.file) == 0) && w.ok;
+    free(w.strings);
+#ifdef _WIN32
+    if (w.ok) {
+        remove(key->cache_path);
+    }
+#endif
+    if (!w.ok || rename(temp_path, key->cache_path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    return true;
+}
+
+typedef struct CacheView {
+    const uint8_t *data;
+    MeshCacheHeader header;
+    size_t counts[MESH_CACHE_SECTION_COUNT];
+} CacheView;
+
+static const void *section_data(const CacheView *view, const MeshCacheSection section) {
+    return view->data + view->header.sections[section].offset;
+}
+
+static bool header_matches(CacheView *view, const size_t size, const MeshCacheKey *key) {
+    if (size < sizeof(MeshCacheHeader)) {
+        return false;
+    }
+    MeshCacheHeader *header = &view->header;
+    memcpy(header, view->data, sizeof(*header));
+    if (memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MESH_CACHE_VERSION || header->layout != MESH_CACHE_LAYOUT ||
+        header->source_size != key->source_size || header->source_mtime != key->source_mtime ||
+        header->source_hash != key->source_hash) {
+        return false;
+    }
+    for (int i = 0; i < MESH_CACHE_SECTION_COUNT; i++) {
+        const MeshCacheRange *range = &header->sections[i];
+        if (range->offset % MESH_CACHE_ALIGNMENT != 0 || range->offset > size ||
+            range->size > size - range->offset || range->size % section_element_sizes[i] != 0) {
+            return false;
+        }
+        view->counts[i] = (size_t)(range->size / section_element_sizes[i]);
+    }
+    return true;
+}
+
+static bool range_fits(const uint64_t offset, const uint64_t count, const size_t total) {
+    return offset <= total && count <= total - offset;
+}
+
+static bool read_string(const CacheView *view, const CachedString ref, char **out) {
+    *out = NULL;
+    if (ref.size == 0) {
+        return true;
+    }
+    const char *strings = section_data(view, MESH_CACHE_STRINGS);
+    if (!range_fits(ref.offset, ref.size, view->counts[MESH_CACHE_STRINGS]) ||
+        strings[ref.offset + ref.size - 1] != '\0') {
+        return false;
+    }
+    *out = str_dup(strings + ref.offset);
+    return *out != NULL;
+}
+
+static bool read_texture_path(const CacheView *view, const CachedString ref, const bool relative,
+                              const char *model_path, char **out) {
+    if (!read_string(view, ref, out) || !*out || !relative) {
+        return *out != NULL || ref.size == 0;
+    }
+    const size_t dir_len = directory_length(model_path);
+    const size_t path_len = strlen(*out);
+    char *full_path = malloc(dir_len + path_len + 1);
+    if (!full_path) {
+        free(*out);
+        *out = NULL;
+        return false;
+    }
+    memcpy(full_path, model_path, dir_len);
+    memcpy(full_path + dir_len, *out, path_len + 1);
+    free(*out);
+    *out = full_path;
+    return true;
+}
+
+static bool read_blob(const CacheView *view, const uint64_t offset, const uint64_t size,
+                      unsigned char **out, size_t *out_size) {
+    *out = NULL;
+    *out_size = 0;
+    if (size == 0) {
+        return true;
+    }
+    if (!range_fits(offset, size, view->counts[MESH_CACHE_BLOBS])) {
+        return false;
+    }
+    *out = malloc((size_t)size);
+    if (!*out) {
+        return false;
+    }
+    memcpy(*out, (const uint8_t *)section_data(view, MESH_CACHE_BLOBS) + offset, (size_t)size);
+    *out_size = (size_t)size;
+    return true;
+}
+
+static bool read_materials(const CacheView *view, const char *model_path,
+                           MaterialInfo **out_materials, size_t *out_material_count) {
+    const size_t count = view->counts[MESH_CACHE_MATERIALS];
+    if (count == 0) {
+        return false;
+    }
+    MaterialInfo *materials = calloc(count, sizeof(MaterialInfo));
+    if (!materials) {
+        return false;
+    }
+    const CachedMaterial *records = section_data(view, MESH_CACHE_MATERIALS);
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        CachedMaterial record;
+        memcpy(&record, &records[i], sizeof(record));
+        MaterialInfo *m = &materials[i];
+        material_info_init(m);
+        if (!ok) {
+            continue;
+        }
+        m->alpha_mode = record.alpha_mode <= ALPHA_MODE_BLEND ? (AlphaMode)record.alpha_mode
+                                                               : ALPHA_MODE_OPAQUE;
+        m->uv_channel = record.uv_channel;
+        m->specular_strength = record.specular_strength;
+        m->shininess = record.shininess;
+        memcpy(m->base_color, record.base_color, sizeof(m->base_color));
+        ok = read_texture_path(view, record.diffuse_path,
+                               (record.path_flags & MESH_CACHE_DIFFUSE_RELATIVE) != 0, model_path,
+                               &m->diffuse_path) &&
+             read_texture_path(view, record.normal_path,
+                               (record.path_flags & MESH_CACHE_NORMAL_RELATIVE) != 0, model_path,
+                               &m->normal_path) &&
+             read_blob(view, record.embedded_diffuse_offset, record.embedded_diffuse_size,
+                       &m->embedded_diffuse, &m->embedded_diffuse_size) &&
+             read_blob(view, record.embedded_normal_offset, record.embedded_normal_size,
+                       &m->embedded_normal, &m->embedded_normal_size);
+    }
+    if (!ok) {
+        materials_free(materials, count);
+        return false;
+    }
+    *out_materials = materials;
+    *out_material_count = count;
+    return true;
+}
+
+// Geometry is copied straight out of the mapping; only the indices are checked
+static bool read_geometry(const CacheView *view, Mesh *mesh, const size_t material_count) {
+    const size_t vertex_count = view->counts[MESH_CACHE_VERTICES];
+    const size_t index_count = view->counts[MESH_CACHE_INDICES];
+    const size_t submesh_count = view->counts[MESH_CACHE_SUBMESHES];
+    const size_t meshlet_count = view->counts[MESH_CACHE_MESHLETS];
+    if (vertex_count == 0) {
+        return false;
+    }
+    ARRAY_RESERVE(mesh->vertices, vertex_count);
+    memcpy(mesh->vertices.data, section_data(view, MESH_CACHE_VERTICES),
+           vertex_count * sizeof(Vertex));
+    mesh->vertices.count = vertex_count;
+    if (index_count > 0) {
+        ARRAY_RESERVE(mesh->indices, index_count);
+        memcpy(mesh->indices.data, section_data(view, MESH_CACHE_INDICES),
+               index_count * sizeof(uint32_t));
+        mesh->indices.count = index_count;
+    }
+    for (size_t i = 0; i < index_count; i++) {
+        if (mesh->indices.data[i] >= vertex_count) {
+            return false;
+        }
+    }
+    if (submesh_count > 0) {
+        ARRAY_RESERVE(mesh->submeshes, submesh_count);
+        memcpy(mesh->submeshes.data, section_data(view, MESH_CACHE_SUBMESHES),
+               submesh_count * sizeof(SubMesh));
+        mesh->submeshes.count = submesh_count;
+    }
+    if (meshlet_count > 0) {
+        ARRAY_RESERVE(mesh->meshlets, meshlet_count);
+        memcpy(mesh->meshlets.data, section_data(view, MESH_CACHE_MESHLETS),
+               meshlet_count * sizeof(Meshlet));
+        mesh->meshlets.count = meshlet_count;
+    }
+    for (size_t i = 0; i < meshlet_count; i++) {
+        const Meshlet *meshlet = &mesh->meshlets.data[i];
+        if (!range_fits(meshlet->index_offset, meshlet->index_count, index_count)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < submesh_count; i++) {
+        const SubMesh *submesh = &mesh->submeshes.data[i];
+        if (!range_fits(submesh->index_offset, submesh->index_count, index_count) ||
+            !range_fits(submesh->meshlet_offset, submesh->meshlet_count, meshlet_count) ||
+            submesh->material_index >= material_count ||
+            submesh->lod_count > MAX_SUBMESH_LODS - 1) {
+            return false;
+        }
+        for (uint32_t lod = 0; lod < submesh->lod_count; lod++) {
+            const SubMeshLod *level = &submesh->lods[lod];
+            if (!range_fits(level->index_offset, level->index_count, index_count)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool read_skeleton(const CacheView *view, Skeleton *skeleton) {
+    bone_map_init(&skeleton->bone_map);
+    memcpy(skeleton->global_inverse_transform, view->header.global_inverse_transform,
+           sizeof(skeleton->global_inverse_transform));
+
+    const CachedBone *bones = section_data(view, MESH_CACHE_BONES);
+    const size_t bone_count = view->counts[MESH_CACHE_BONES];
+    if (bone_count > 0) {
+        ARRAY_RESERVE(skeleton->bones, bone_count);
+    }
+    for (size_t i = 0; i < bone_count; i++) {
+        CachedBone record;
+        memcpy(&record, &bones[i], sizeof(record));
+        BoneInfo bone = {.index = record.index};
+        if (!read_string(view, record.name, &bone.name) || !bone.name) {
+            free(bone.name);
+            return false;
+        }
+        memcpy(bone.offset_matrix, record.offset_matrix, sizeof(bone.offset_matrix));
+        skeleton->bones.data[skeleton->bones.count++] = bone;
+        bone_map_insert(&skeleton->bone_map, bone.name, bone.index);
+    }
+
+    const CachedNode *nodes = section_data(view, MESH_CACHE_NODES);
+    const int32_t *children = section_data(view, MESH_CACHE_CHILDREN);
+    const size_t node_count = view->counts[MESH_CACHE_NODES];
+    if (node_count > 0) {
+        ARRAY_RESERVE(skeleton->bone_hierarchy, node_count);
+    }
+    for (size_t i = 0; i < node_count; i++) {
+        CachedNode record;
+        memcpy(&record, &nodes[i], sizeof(record));
+        if (record.parent_index < -1 || record.parent_index >= (int32_t)node_count ||
+            !range_fits(record.child_offset, record.child_count,
+                        view->counts[MESH_CACHE_CHILDREN])) {
+            return false;
+        }
+        BoneNode node = {.parent_index = record.parent_index};
+        if (!read_string(view, record.name, &node.name) || !node.name) {
+            free(node.name);
+            return false;
+        }
+        memcpy(node.transformation, record.transformation, sizeof(node.transformation));
+        memcpy(node.initial_position, record.initial_position, sizeof(node.initial_position));
+        memcpy(node.initial_rotation, record.initial_rotation, sizeof(node.initial_rotation));
+        memcpy(node.initial_scale, record.initial_scale, sizeof(node.initial_scale));
+        // Pushed before the children so skeleton_free owns everything read so far
+        skeleton->bone_hierarchy.data[skeleton->bone_hierarchy.count++] = node;
+        IntArray *child_indices = &skeleton->bone_hierarchy.data[i].child_indices;
+        if (record.child_count > 0) {
+            ARRAY_RESERVE(*child_indices, record.child_count);
+        }
+        for (uint32_t j = 0; j < record.child_count; j++) {
+            int32_t child;
+            memcpy(&child, &children[record.child_offset + j], sizeof(child));
+            if (child < 0 || child >= (int32_t)node_count) {
+                return false;
+            }
+            child_indices->data[child_indices->count++] = child;
+        }
+    }
+    return true;
+}
+
+static bool read_vector_keys(const CacheView *view, const uint32_t offset, const uint32_t count,
+                             VectorKeyArray *out) {
+    if (!range_fits(offset, count, view->counts[MESH_CACHE_VECTOR_KEYS])) {
+        return false;
+    }
+    if (count > 0) {
+        ARRAY_RESERVE(*out, count);
+    }
+    const CachedVectorKey *keys = section_data(view, MESH_CACHE_VECTOR_KEYS);
+    for (uint32_t i = 0; i < count; i++) {
+        CachedVectorKey key;
+        memcpy(&key, &keys[offset + i], sizeof(key));
+        out->data[i].time = key.time;
+        memcpy(out->data[i].value, key.value, sizeof(key.value));
+    }
+    out->count = count;
+    return true;
+}
+
+static bool read_channel(const CacheView *view, const CachedChannel *record,
+                         BoneAnimation *channel) {
+    if (!read_string(view, record->bone_name, &channel->bone_name) || !channel->bone_name ||
+        !read_vector_keys(view, record->position_offset, record->position_count,
+                          &channel->position_keys) ||
+        !read_vector_keys(view, record->scale_offset, record->scale_count,
+                          &channel->scale_keys) ||
+        !range_fits(record->rotation_offset, record->rotation_count,
+                    view->counts[MESH_CACHE_ROTATION_KEYS])) {
+        return false;
+    }
+    if (record->rotation_count > 0) {
+        ARRAY_RESERVE(channel->rotation_keys, record->rotation_count);
+    }
+    const CachedRotationKey *keys = section_data(view, MESH_CACHE_ROTATION_KEYS);
+    for (uint32_t i = 0; i < record->rotation_count; i++) {
+        CachedRotationKey key;
+        memcpy(&key, &keys[record->rotation_offset + i], sizeof(key));
+        channel->rotation_keys.data[i].time = key.time;
+        memcpy(channel->rotation_keys.data[i].value, key.value, sizeof(key.value));
+    }
+    channel->rotation_keys.count = record->rotation_count;
+    return true;
+}
+
+static bool read_animations(const CacheView *view, const Skeleton *skeleton,
+                            AnimationArray *animations) {
+    const CachedAnimation *records = section_data(view, MESH_CACHE_ANIMATIONS);
+    const CachedChannel *channels = section_data(view, MESH_CACHE_CHANNELS);
+    const size_t animation_count = view->counts[MESH_CACHE_ANIMATIONS];
+    if (animation_count > 0) {
+        ARRAY_RESERVE(*animations, animation_count);
+    }
+    for (size_t i = 0; i < animation_count; i++) {
+        CachedAnimation record;
+        memcpy(&record, &records[i], sizeof(record));
+        Animation *animation = &animations->data[animations->count++];
+        memset(animation, 0, sizeof(*animation));
+        bone_anim_map_init(&animation->bone_anim_map);
+        animation->duration = record.duration;
+        animation->ticks_per_second = record.ticks_per_second;
+        if (!read_string(view, record.name, &animation->name) || !animation->name ||
+            !range_fits(record.channel_offset, record.channel_count,
+                        view->counts[MESH_CACHE_CHANNELS])) {
+            return false;
+        }
+        if (record.channel_count > 0) {
+            ARRAY_RESERVE(animation->bone_animations, record.channel_count);
+        }
+        for (uint32_t j = 0; j < record.channel_count; j++) {
+            CachedChannel channel_record;
+            memcpy(&channel_record, &channels[record.channel_offset + j], sizeof(channel_record));
+            BoneAnimation *channel =
+                &animation->bone_animations.data[animation->bone_animations.count++];
+            memset(channel, 0, sizeof(*channel));
+            if (!read_channel(view, &channel_record, channel)) {
+                return false;
+            }
+            bone_anim_map_insert(&animation->bone_anim_map, channel->bone_name, (int)j);
+        }
+        animation_bind_skeleton(animation, skeleton);
+    }
+    return true;
+}
+
+bool mesh_cache_load(const MeshCacheKey *key, const char *source_path, Mesh *mesh,
+                     bool *out_has_uvs, MaterialInfo **out_materials,
+                     size_t *out_material_count) {
+    if (!key->cache_path[0]) {
+        return false;
+    }
+    size_t size = 0;
+    CacheView view = {.data = dcat_map_file(key->cache_path, &size)};
+    if (!view.data) {
+        return false;
+    }
+    if (!header_matches(&view, size, key)) {
+        dcat_unmap_file(view.data, size);
+        return false;
+    }
+
+    MaterialInfo *materials = NULL;
+    size_t material_count = 0;
+    mesh_free(mesh);
+    mesh_init(mesh);
+    mesh->generation = 1;
+    mesh->has_animations = (view.header.flags & MESH_CACHE_HAS_ANIMATIONS) != 0;
+    memcpy(mesh->coordinate_system_transform, view.header.coordinate_system_transform,
+           sizeof(mesh->coordinate_system_transform));
+
+    bool ok = read_materials(&view, source_path, &materials, &material_count) &&
+              read_geometry(&view, mesh, material_count);
+    if (ok && mesh->has_animations) {
+        ok = read_skeleton(&view, &mesh->skeleton) && skeleton_flatten(&mesh->skeleton) &&
+             read_animations(&view, &mesh->skeleton, &mesh->animations);
+    }
+    dcat_unmap_file(view.data, size);
+    if (!ok) {
+        materials_free(materials, material_count);
+        mesh_free(mesh);
+        return false;
+    }
+    *out_has_uvs = (view.header.flags & MESH_CACHE_HAS_UVS) != 0;
+    *out_materials = materials;
+    *out_material_count = material_count;
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "model.h"
+
+// Identifies one source file: where its cache entry lives and what it must match
+typedef struct MeshCacheKey {
+    char cache_path[512];
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+} MeshCacheKey;
+
+// Hashes the contents of `source_path`. `cache_directory` (with a trailing separator)
+// overrides the per-user cache directory; pass NULL for the default.
+bool mesh_cache_key(const char *source_path, const char *cache_directory, MeshCacheKey *out);
+
+// Fills the mesh and materials from the cache entry when it was written for the same size,
+// mtime and contents. Model-relative texture paths are rebased onto `source_path`.
+bool mesh_cache_load(const MeshCacheKey *key, const char *source_path, Mesh *mesh,
+                     bool *out_has_uvs, MaterialInfo **out_materials, size_t *out_material_count);
+
+// Replaces the cache entry with the processed mesh; failures only cost the next launch
+bool mesh_cache_store(const MeshCacheKey *key, const char *source_path, const Mesh *mesh,
+                      bool has_uvs, const MaterialInfo *materials, size_t material_count);
@@ -0,0 +1,36 @@
+#include "mesh_edit.h"
+#include <string.h>
+
+// First and one past the last element that differs between `a` and `b`, both `count`
+// elements of `size` bytes; an empty range when they match
+static void differing_range(const void *a, const void *b, const size_t count, const size_t size,
+                            uint32_t *out_first, uint32_t *out_count) {
+    const unsigned char *left = a;
+    const unsigned char *right = b;
+    size_t first = 0;
+    while (first < count && memcmp(left + (first * size), right + (first * size), size) == 0) {
+        first++;
+    }
+    size_t end = count;
+    while (end > first &&
+           memcmp(left + ((end - 1) * size), right + ((end - 1) * size), size) == 0) {
+        end--;
+    }
+    *out_first = end > first ? (uint32_t)first : 0U;
+    *out_count = (uint32_t)(end - first);
+}
+
+void mesh_edit_diff(const Mesh *previous, Mesh *mesh) {
+    mesh->generation = previous->generation + 1;
+    mesh->edit = (MeshEdit){0};
+    if (previous->generation == 0 || previous->geometry_released || mesh->geometry_released ||
+        previous->vertices.count != mesh->vertices.count ||
+        previous->indices.count != mesh->indices.count) {
+        return;
+    }
+    mesh->edit.base_generation = previous->generation;
+    differing_range(previous->vertices.data, mesh->vertices.data, mesh->vertices.count,
+                    sizeof(Vertex), &mesh->edit.first_vertex, &mesh->edit.vertex_count);
+    differing_range(previous->indices.data, mesh->indices.data, mesh->indices.count,
+                    sizeof(uint32_t), &mesh->edit.first_index, &mesh->edit.index_count);
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "model.h"
+
+// Makes `mesh`, a reload of `previous`, the generation after it. When both have their
+// geometry and the same vertex and index counts, mesh->edit gets the smallest ranges that
+// hold every vertex and index that differs.
+void mesh_edit_diff(const Mesh *previous, Mesh *mesh);
@@ -0,0 +1,538 @@
+#include "mesh_lod.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Candidates are bucketed on the top bits of their float cost, which orders non-negative
+// floats; finer ordering inside a bucket makes no visible difference.
+#define COST_BUCKET_SHIFT 20U
+#define COST_BUCKET_COUNT (1U << (32U - COST_BUCKET_SHIFT))
+// A collapse may not turn any remaining triangle by more than about 75 degrees
+#define MIN_NORMAL_COSINE 0.25
+
+// Area-weighted sum of plane quadrics, upper triangle of the 4x4 matrix:
+// xx xy xz xw yy yz yw zz zw ww. `area` is the total weight.
+typedef struct Quadric {
+    double a[10];
+    double area;
+} Quadric;
+
+typedef struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    // Area-weighted, so collapses in finely tessellated regions go first
+    float cost;
+    // Mean squared distance of the moved surface
+    float error;
+} Collapse;
+
+typedef struct SimplifyState {
+    const Vertex *vertices;
+    // Local vertex ids index these; globals maps them back to the caller's vertex array
+    uint32_t *globals;
+    size_t local_count;
+    uint32_t *triangles;
+    size_t triangle_count;
+    // Lowest local id at the same position, so seam copies share one topological vertex
+    uint32_t *weld;
+    bool *locked;
+    Quadric *quadrics;
+    uint32_t *remap;
+    bool *touched;
+    // Triangles around each local vertex, rebuilt every pass
+    uint32_t *adjacency_offsets;
+    uint32_t *adjacency;
+    Collapse *candidates;
+    Collapse *sorted;
+} SimplifyState;
+
+typedef struct PositionKey {
+    float position[3];
+    uint32_t local;
+} PositionKey;
+
+static const float *local_position(const SimplifyState *st, const uint32_t local) {
+    return st->vertices[st->globals[local]].position;
+}
+
+static void quadric_add_plane(Quadric *q, const double n[3], const double d,
+                              const double area) {
+    q->a[0] += area * n[0] * n[0];
+    q->a[1] += area * n[0] * n[1];
+    q->a[2] += area * n[0] * n[2];
+    q->a[3] += area * n[0] * d;
+    q->a[4] += area * n[1] * n[1];
+    q->a[5] += area * n[1] * n[2];
+    q->a[6] += area * n[1] * d;
+    q->a[7] += area * n[2] * n[2];
+    q->a[8] += area * n[2] * d;
+    q->a[9] += area * d * d;
+    q->area += area;
+}
+
+static void quadric_add(Quadric *q, const Quadric *other) {
+    for (int i = 0; i < 10; i++) {
+        q->a[i] += other->a[i];
+    }
+    q->area += other->area;
+}
+
+// Area-weighted sum of squared distances from `p` to the planes accumulated in `q`
+static double quadric_error(const Quadric *q, const float p[3]) {
+    const double x = p[0];
+    const double y = p[1];
+    const double z = p[2];
+    const double error = (q->a[0] * x * x) + (2.0 * q->a[1] * x * y) + (2.0 * q->a[2] * x * z) +
+                         (2.0 * q->a[3] * x) + (q->a[4] * y * y) + (2.0 * q->a[5] * y * z) +
+                         (2.0 * q->a[6] * y) + (q->a[7] * z * z) + (2.0 * q->a[8] * z) + q->a[9];
+    return error > 0.0 ? error : 0.0;
+}
+
+static void triangle_normal(const float *p0, const float *p1, const float *p2, double out[3]) {
+    const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    out[0] = (e1[1] * e2[2]) - (e1[2] * e2[1]);
+    out[1] = (e1[2] * e2[0]) - (e1[0] * e2[2]);
+    out[2] = (e1[0] * e2[1]) - (e1[1] * e2[0]);
+}
+
+static int compare_u32(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_position_keys(const void *a, const void *b) {
+    const PositionKey *x = a;
+    const PositionKey *y = b;
+    for (int i = 0; i < 3; i++) {
+        if (x->position[i] != y->position[i]) {
+            return x->position[i] < y->position[i] ? -1 : 1;
+        }
+    }
+    return (x->local > y->local) - (x->local < y->local);
+}
+
+static void simplify_state_free(SimplifyState *st) {
+    free(st->globals);
+    free(st->triangles);
+    free(st->weld);
+    free(st->locked);
+    free(st->quadrics);
+    free(st->remap);
+    free(st->touched);
+    free(st->adjacency_offsets);
+    free(st->adjacency);
+    free(st->candidates);
+    free(st->sorted);
+}
+
+// Locks seam vertices (several vertices at one position) and the ends of every edge that
+// is not shared by exactly two triangles.
+static bool lock_seams_and_borders(SimplifyState *st) {
+    PositionKey *keys = malloc(st->local_count * sizeof(PositionKey));
+    if (!keys) {
+        return false;
+    }
+    for (uint32_t l = 0; l < st->local_count; l++) {
+        memcpy(keys[l].position, local_position(st, l), sizeof(keys[l].position));
+        keys[l].local = l;
+    }
+    qsort(keys, st->local_count, sizeof(PositionKey), compare_position_keys);
+    for (size_t run = 0; run < st->local_count;) {
+        size_t end = run + 1;
+        while (end < st->local_count &&
+               memcmp(keys[end].position, keys[run].position, sizeof(keys[run].position)) == 0) {
+            end++;
+        }
+        for (size_t i = run; i < end; i++) {
+            st->weld[keys[i].local] = keys[run].local;
+            st->locked[keys[i].local] = end - run > 1;
+        }
+        run = end;
+    }
+    free(keys);
+
+    const size_t edge_count = st->triangle_count * 3;
+    uint64_t *edges = malloc(edge_count * sizeof(uint64_t));
+    bool *locked_weld = calloc(st->local_count, sizeof(bool));
+    if (!edges || !locked_weld) {
+        free(edges);
+        free(locked_weld);
+        return false;
+    }
+    for (size_t t = 0; t < st->triangle_count; t++) {
+        for (int k = 0; k < 3; k++) {
+            const uint32_t a = st->weld[st->triangles[(t * 3) + k]];
+            const uint32_t b = st->weld[st->triangles[(t * 3) + ((k + 1) % 3)]];
+            edges[(t * 3) + k] = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+        }
+    }
+    qsort(edges, edge_count, sizeof(uint64_t), compare_u64);
+    for (size_t run = 0; run < edge_count;) {
+        size_t end = run + 1;
+        while (end < edge_count && edges[end] == edges[run]) {
+            end++;
+        }
+        if (end - run != 2) {
+            locked_weld[edges[run] >> 32] = true;
+            locked_weld[edges[run] & UINT32_MAX] = true;
+        }
+        run = end;
+    }
+    for (uint32_t l = 0; l < st->local_count; l++) {
+        st->locked[l] = st->locked[l] || locked_weld[st->weld[l]];
+    }
+    free(edges);
+    free(locked_weld);
+    return true;
+}
+
+static bool simplify_state_init(SimplifyState *st, const Vertex *vertices,
+                                const uint32_t *indices, const size_t index_count) {
+    st->vertices = vertices;
+    st->globals = malloc(index_count * sizeof(uint32_t));
+    st->triangles = malloc(index_count * sizeof(uint32_t));
+    if (!st->globals || !st->triangles) {
+        return false;
+    }
+
+    memcpy(st->globals, indices, index_count * sizeof(uint32_t));
+    qsort(st->globals, index_count, sizeof(uint32_t), compare_u32);
+    for (size_t i = 0; i < index_count; i++) {
+        if (st->local_count == 0 || st->globals[st->local_count - 1] != st->globals[i]) {
+            st->globals[st->local_count++] = st->globals[i];
+        }
+    }
+
+    for (size_t t = 0; t < index_count / 3; t++) {
+        uint32_t corner[3];
+        for (int k = 0; k < 3; k++) {
+            const uint32_t *found = bsearch(&indices[(t * 3) + k], st->globals, st->local_count,
+                                            sizeof(uint32_t), compare_u32);
+            corner[k] = (uint32_t)(found - st->globals);
+        }
+        if (corner[0] != corner[1] && corner[1] != corner[2] && corner[0] != corner[2]) {
+            memcpy(&st->triangles[st->triangle_count * 3], corner, sizeof(corner));
+            st->triangle_count++;
+        }
+    }
+
+    st->weld = malloc(st->local_count * sizeof(uint32_t));
+    st->locked = malloc(st->local_count * sizeof(bool));
+    st->quadrics = calloc(st->local_count, sizeof(Quadric));
+    st->remap = malloc(st->local_count * sizeof(uint32_t));
+    st->touched = malloc(st->local_count * sizeof(bool));
+    st->adjacency_offsets = malloc((st->local_count + 1) * sizeof(uint32_t));
+    st->adjacency = malloc(st->triangle_count * 3 * sizeof(uint32_t));
+    st->candidates = malloc(st->triangle_count * 3 * sizeof(Collapse));
+    st->sorted = malloc(st->triangle_count * 3 * sizeof(Collapse));
+    if (!st->weld || !st->locked || !st->quadrics || !st->remap || !st->touched ||
+        !st->adjacency_offsets || (st->triangle_count > 0 && (!st->adjacency ||
+                                                               !st->candidates || !st->sorted))) {
+        return false;
+    }
+    for (uint32_t l = 0; l < st->local_count; l++) {
+        st->remap[l] = l;
+    }
+    if (!lock_seams_and_borders(st)) {
+        return false;
+    }
+
+    for (size_t t = 0; t < st->triangle_count; t++) {
+        const uint32_t *tri = &st->triangles[t * 3];
+        const float *p0 = local_position(st, tri[0]);
+        double n[3];
+        triangle_normal(p0, local_position(st, tri[1]), local_position(st, tri[2]), n);
+        const double length = sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+        if (length <= 0.0) {
+            continue;
+        }
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        const double d = -((n[0] * p0[0]) + (n[1] * p0[1]) + (n[2] * p0[2]));
+        for (int k = 0; k < 3; k++) {
+            quadric_add_plane(&st->quadrics[tri[k]], n, d, length * 0.5);
+        }
+    }
+    return true;
+}
+
+static void build_adjacency(SimplifyState *st) {
+    memset(st->adjacency_offsets, 0, (st->local_count + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < st->triangle_count * 3; i++) {
+        st->adjacency_offsets[st->triangles[i] + 1]++;
+    }
+    for (size_t l = 0; l < st->local_count; l++) {
+        st->adjacency_offsets[l + 1] += st->adjacency_offsets[l];
+    }
+    // Fill using the offsets as cursors, then shift them back
+    for (size_t t = 0; t < st->triangle_count; t++) {
+        for (int k = 0; k < 3; k++) {
+            st->adjacency[st->adjacency_offsets[st->triangles[(t * 3) + k]]++] = (uint32_t)t;
+        }
+    }
+    for (size_t l = st->local_count; l > 0; l--) {
+        st->adjacency_offsets[l] = st->adjacency_offsets[l - 1];
+    }
+    st->adjacency_offsets[0] = 0;
+}
+
+static uint32_t cost_bucket(const float cost) {
+    uint32_t bits;
+    memcpy(&bits, &cost, sizeof(bits));
+    return bits >> COST_BUCKET_SHIFT;
+}
+
+// Collects one collapse per directed edge out of an unlocked vertex, cheapest first.
+static size_t collect_candidates(SimplifyState *st) {
+    uint32_t bucket_offsets[COST_BUCKET_COUNT + 1];
+    size_t count = 0;
+    for (size_t t = 0; t < st->triangle_count; t++) {
+        for (int k = 0; k < 3; k++) {
+            const uint32_t from = st->triangles[(t * 3) + k];
+            const uint32_t to = st->triangles[(t * 3) + ((k + 1) % 3)];
+            if (st->locked[from]) {
+                continue;
+            }
+            const Quadric *q = &st->quadrics[from];
+            const double cost = quadric_error(q, local_position(st, to));
+            const double error = q->area > 0.0 ? cost / q->area : 0.0;
+            st->candidates[count++] = (Collapse){from, to, (float)cost, (float)error};
+        }
+    }
+
+    memset(bucket_offsets, 0, sizeof(bucket_offsets));
+    for (size_t i = 0; i < count; i++) {
+        bucket_offsets[cost_bucket(st->candidates[i].cost) + 1]++;
+    }
+    for (uint32_t b = 0; b < COST_BUCKET_COUNT; b++) {
+        bucket_offsets[b + 1] += bucket_offsets[b];
+    }
+    for (size_t i = 0; i < count; i++) {
+        st->sorted[bucket_offsets[cost_bucket(st->candidates[i].cost)]++] = st->candidates[i];
+    }
+    return count;
+}
+
+// Rejects a collapse that would fold or badly turn a triangle around `from`.
+static bool collapse_keeps_orientation(const SimplifyState *st, const uint32_t from,
+                                       const uint32_t to) {
+    const float *target = local_position(st, to);
+    for (uint32_t i = st->adjacency_offsets[from]; i < st->adjacency_offsets[from + 1]; i++) {
+        const uint32_t *tri = &st->triangles[(size_t)st->adjacency[i] * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) {
+            continue; // becomes degenerate and is dropped
+        }
+        const float *before[3];
+        const float *after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = local_position(st, tri[k]);
+            after[k] = tri[k] == from ? target : before[k];
+        }
+        double n0[3];
+        double n1[3];
+        triangle_normal(before[0], before[1], before[2], n0);
+        triangle_normal(after[0], after[1], after[2], n1);
+        const double dot = (n0[0] * n1[0]) + (n0[1] * n1[1]) + (n0[2] * n1[2]);
+        const double length0 = sqrt((n0[0] * n0[0]) + (n0[1] * n0[1]) + (n0[2] * n0[2]));
+        const double length1 = sqrt((n1[0] * n1[0]) + (n1[1] * n1[1]) + (n1[2] * n1[2]));
+        if (length1 <= 0.0 || dot < MIN_NORMAL_COSINE * length0 * length1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One round of independent collapses: each changes only triangles no other collapse in the
+// round touches. Returns the number performed.
+static size_t collapse_pass(SimplifyState *st, const size_t target_triangles,
+                            double *max_error) {
+    build_adjacency(st);
+    const size_t candidate_count = collect_candidates(st);
+    memset(st->touched, 0, st->local_count * sizeof(bool));
+
+    const size_t wanted = st->triangle_count - target_triangles;
+    size_t removed = 0;
+    size_t collapses = 0;
+    for (size_t c = 0; c < candidate_count && removed < wanted; c++) {
+        const Collapse *candidate = &st->sorted[c];
+        if (st->touched[candidate->from] || st->touched[candidate->to] ||
+            !collapse_keeps_orientation(st, candidate->from, candidate->to)) {
+            continue;
+        }
+        st->remap[candidate->from] = candidate->to;
+        quadric_add(&st->quadrics[candidate->to], &st->quadrics[candidate->from]);
+        if (candidate->error > *max_error) {
+            *max_error = candidate->error;
+        }
+        for (uint32_t i = st->adjacency_offsets[candidate->from];
+             i < st->adjacency_offsets[candidate->from + 1]; i++) {
+            const uint32_t *tri = &st->triangles[(size_t)st->adjacency[i] * 3];
+            bool collapses_away = false;
+            for (int k = 0; k < 3; k++) {
+                st->touched[tri[k]] = true;
+                collapses_away = collapses_away || tri[k] == candidate->to;
+            }
+            removed += collapses_away ? 1U : 0U;
+        }
+        st->touched[candidate->to] = true;
+        collapses++;
+    }
+
+    // Apply the round and drop the triangles it made degenerate
+    size_t kept = 0;
+    for (size_t t = 0; t < st->triangle_count; t++) {
+        uint32_t corner[3];
+        for (int k = 0; k < 3; k++) {
+            corner[k] = st->remap[st->triangles[(t * 3) + k]];
+        }
+        if (st->weld[corner[0]] == st->weld[corner[1]] ||
+            st->weld[corner[1]] == st->weld[corner[2]] ||
+            st->weld[corner[0]] == st->weld[corner[2]]) {
+            continue;
+        }
+        memcpy(&st->triangles[kept * 3], corner, sizeof(corner));
+        kept++;
+    }
+    st->triangle_count = kept;
+    for (uint32_t l = 0; l < st->local_count; l++) {
+        st->remap[l] = l;
+    }
+    return collapses;
+}
+
+size_t simplify_triangles(const Vertex *vertices, const size_t vertex_count,
+                          const uint32_t *indices, size_t index_count,
+                          const size_t target_index_count, uint32_t *out_indices,
+                          float *out_error) {
+    *out_error = 0.0F;
+    index_count -= index_count % 3;
+    bool in_range = true;
+    for (size_t i = 0; i < index_count && in_range; i++) {
+        in_range = indices[i] < vertex_count;
+    }
+
+    SimplifyState st = {0};
+    if (target_index_count >= index_count || !in_range ||
+        !simplify_state_init(&st, vertices, indices, index_count)) {
+        simplify_state_free(&st);
+        memcpy(out_indices, indices, index_count * sizeof(uint32_t));
+        return index_count;
+    }
+
+    const size_t target_triangles = target_index_count / 3;
+    double max_error = 0.0;
+    while (st.triangle_count > target_triangles &&
+           collapse_pass(&st, target_triangles, &max_error) > 0) {
+    }
+
+    for (size_t i = 0; i < st.triangle_count * 3; i++) {
+        out_indices[i] = st.globals[st.triangles[i]];
+    }
+    const size_t written = st.triangle_count * 3;
+    *out_error = (float)sqrt(max_error);
+    simplify_state_free(&st);
+    return written;
+}
+
+static void compute_submesh_bounds(const Mesh *mesh, SubMesh *submesh) {
+    const uint32_t *indices = mesh->indices.data + submesh->index_offset;
+    float min[3] = {INFINITY, INFINITY, INFINITY};
+    float max[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = 0; i < submesh->index_count; i++) {
+        const float *p = mesh->vertices.data[indices[i]].position;
+        for (int k = 0; k < 3; k++) {
+            min[k] = fminf(min[k], p[k]);
+            max[k] = fmaxf(max[k], p[k]);
+        }
+    }
+    float radius_squared = 0.0F;
+    for (int k = 0; k < 3; k++) {
+        submesh->bounds_center[k] = submesh->index_count > 0 ? (min[k] + max[k]) * 0.5F : 0.0F;
+    }
+    for (uint32_t i = 0; i < submesh->index_count; i++) {
+        const float *p = mesh->vertices.data[indices[i]].position;
+        float distance_squared = 0.0F;
+        for (int k = 0; k < 3; k++) {
+            const float d = p[k] - submesh->bounds_center[k];
+            distance_squared += d * d;
+        }
+        radius_squared = fmaxf(radius_squared, distance_squared);
+    }
+    submesh->bounds_radius = sqrtf(radius_squared);
+}
+
+static bool append_indices(Uint32Array *indices, const uint32_t *data, const size_t count) {
+    const size_t needed = indices->count + count;
+    if (needed > UINT32_MAX) {
+        return false;
+    }
+    if (needed > indices->capacity) {
+        ARRAY_RESERVE(*indices, needed > indices->capacity * 2 ? needed : indices->capacity * 2);
+    }
+    memcpy(indices->data + indices->count, data, count * sizeof(uint32_t));
+    indices->count = needed;
+    return true;
+}
+
+void mesh_build_lods(Mesh *mesh) {
+    for (size_t s = 0; s < mesh->submeshes.count; s++) {
+        SubMesh *submesh = &mesh->submeshes.data[s];
+        submesh->lod_count = 0;
+        compute_submesh_bounds(mesh, submesh);
+        if (submesh->index_count / 3 < MESH_LOD_MIN_TRIANGLES) {
+            continue;
+        }
+
+        // Each level is simplified from the previous one, so errors add up
+        uint32_t *previous = NULL;
+        size_t previous_count = submesh->index_count;
+        float error = 0.0F;
+        while (submesh->lod_count < MAX_SUBMESH_LODS - 1) {
+            uint32_t *simplified = malloc(previous_count * sizeof(uint32_t));
+            if (!simplified) {
+                break;
+            }
+            const uint32_t *source =
+                previous ? previous : mesh->indices.data + submesh->index_offset;
+            size_t target = previous_count / MESH_LOD_REDUCTION;
+            target -= target % 3;
+            float level_error = 0.0F;
+            const size_t count = simplify_triangles(mesh->vertices.data, mesh->vertices.count,
+                                                    source, previous_count, target, simplified,
+                                                    &level_error);
+            // A level that locked seams kept mostly intact is not worth its memory
+            const size_t offset = mesh->indices.count;
+            if (count == 0 || count > previous_count * 3 / 4 ||
+                !append_indices(&mesh->indices, simplified, count)) {
+                free(simplified);
+                break;
+            }
+            error += level_error;
+            submesh->lods[submesh->lod_count++] =
+                (SubMeshLod){(uint32_t)offset, (uint32_t)count, error};
+            free(previous);
+            previous = simplified;
+            previous_count = count;
+        }
+        free(previous);
+    }
+}
+
+uint32_t submesh_select_lod(const SubMesh *submesh, const float pixels_per_unit) {
+    for (uint32_t level = submesh->lod_count; level > 0; level--) {
+        if (submesh->lods[level - 1].error * pixels_per_unit <= MESH_LOD_MAX_PIXEL_ERROR) {
+            return level;
+        }
+    }
+    return 0;
+}
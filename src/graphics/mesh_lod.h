@@ -0,0 +1,29 @@
+#pragma once
+#include "model.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Sub-meshes below this many triangles always draw in full
+#define MESH_LOD_MIN_TRIANGLES 8192U
+// Each level aims for this fraction of the previous level's triangles
+#define MESH_LOD_REDUCTION 4U
+// Largest surface error, in effective pixels, a level may show on screen
+#define MESH_LOD_MAX_PIXEL_ERROR 0.5F
+
+// Simplifies the triangle list `indices` towards `target_index_count` by quadric-error edge
+// collapse. Vertices never move: each collapse merges a vertex into a neighbour, so the
+// result indexes the same vertex array. Vertices sharing a position with another vertex (UV
+// or normal seams) and vertices on open borders are never removed. `out_indices` needs room
+// for `index_count` entries; returns how many were written. *out_error is the largest
+// model-space distance the simplified surface may have moved.
+size_t simplify_triangles(const Vertex *vertices, size_t vertex_count, const uint32_t *indices,
+                          size_t index_count, size_t target_index_count, uint32_t *out_indices,
+                          float *out_error);
+
+// Fills every sub-mesh's bounds, and for dense ones appends up to MAX_SUBMESH_LODS - 1
+// simplified levels to mesh->indices.
+void mesh_build_lods(Mesh *mesh);
+
+// The coarsest level of `submesh` whose error stays within MESH_LOD_MAX_PIXEL_ERROR when
+// one model unit covers `pixels_per_unit` effective pixels; 0 is full detail.
+uint32_t submesh_select_lod(const SubMesh *submesh, float pixels_per_unit);
@@ -0,0 +1,409 @@
+#include "mesh_optimize.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_VERTEX UINT32_MAX
+
+float simulate_vertex_cache(const uint32_t *indices, const size_t index_count,
+                            const size_t vertex_count, const uint32_t cache_size) {
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0 || cache_size == 0) {
+        return 0.0F;
+    }
+    // A vertex is cached while fewer than cache_size misses have happened since its own
+    size_t *loaded_at = malloc(vertex_count * sizeof(size_t));
+    if (!loaded_at) {
+        return 0.0F;
+    }
+    size_t misses = 0;
+    for (size_t i = 0; i < vertex_count; i++) {
+        loaded_at[i] = SIZE_MAX;
+    }
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+        const uint32_t v = indices[i];
+        if (v >= vertex_count) {
+            continue;
+        }
+        if (loaded_at[v] == SIZE_MAX || misses - loaded_at[v] >= cache_size) {
+            loaded_at[v] = misses++;
+        }
+    }
+    free(loaded_at);
+    return (float)misses / (float)triangle_count;
+}
+
+typedef struct TipsifyState {
+    // Local ids number the range's vertices in first-use order
+    uint32_t *local_indices;
+    size_t local_count;
+    uint32_t *live;
+    uint32_t *adjacency_offsets;
+    uint32_t *adjacency;
+    uint64_t *timestamps;
+    bool *emitted;
+    uint32_t *dead_ends;
+    size_t dead_end_count;
+    uint32_t *candidates;
+    uint32_t *output;
+    // Next local id the dead-end fallback scans from
+    size_t cursor;
+} TipsifyState;
+
+static void tipsify_free(TipsifyState *st) {
+    free(st->local_indices);
+    free(st->live);
+    free(st->adjacency_offsets);
+    free(st->adjacency);
+    free(st->timestamps);
+    free(st->emitted);
+    free(st->dead_ends);
+    free(st->candidates);
+    free(st->output);
+}
+
+// `local_of` maps global vertex ids to local ones and must be all NO_VERTEX; it is left
+// that way again.
+static bool tipsify_init(TipsifyState *st, const uint32_t *indices, const size_t index_count,
+                         const size_t vertex_count, uint32_t *local_of) {
+    memset(st, 0, sizeof(*st));
+    const size_t triangle_count = index_count / 3;
+    st->local_indices = malloc(index_count * sizeof(uint32_t));
+    st->emitted = calloc(triangle_count, sizeof(bool));
+    st->dead_ends = malloc(index_count * sizeof(uint32_t));
+    st->candidates = malloc(index_count * sizeof(uint32_t));
+    st->output = malloc(index_count * sizeof(uint32_t));
+    if (!st->local_indices || !st->emitted || !st->dead_ends || !st->candidates ||
+        !st->output) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < index_count; i++) {
+        const uint32_t v = indices[i];
+        if (v >= vertex_count) {
+            ok = false;
+            st->local_indices[i] = 0;
+            continue;
+        }
+        if (local_of[v] == NO_VERTEX) {
+            local_of[v] = (uint32_t)st->local_count++;
+        }
+        st->local_indices[i] = local_of[v];
+    }
+    for (size_t i = 0; i < index_count; i++) {
+        if (indices[i] < vertex_count) {
+            local_of[indices[i]] = NO_VERTEX;
+        }
+    }
+    if (!ok) {
+        return false;
+    }
+
+    st->live = calloc(st->local_count, sizeof(uint32_t));
+    st->adjacency_offsets = calloc(st->local_count + 1, sizeof(uint32_t));
+    st->adjacency = malloc(index_count * sizeof(uint32_t));
+    st->timestamps = calloc(st->local_count, sizeof(uint64_t));
+    if (!st->live || !st->adjacency_offsets || !st->adjacency || !st->timestamps) {
+        return false;
+    }
+    for (size_t i = 0; i < index_count; i++) {
+        st->live[st->local_indices[i]]++;
+    }
+    for (size_t v = 0; v < st->local_count; v++) {
+        st->adjacency_offsets[v + 1] = st->adjacency_offsets[v] + st->live[v];
+    }
+    // Filled back to front, so each list ends up in triangle order
+    uint32_t *fill = malloc(st->local_count * sizeof(uint32_t));
+    if (!fill) {
+        return false;
+    }
+    memcpy(fill, st->adjacency_offsets + 1, st->local_count * sizeof(uint32_t));
+    for (size_t i = index_count; i-- > 0;) {
+        st->adjacency[--fill[st->local_indices[i]]] = (uint32_t)(i / 3);
+    }
+    free(fill);
+    return true;
+}
+
+// Next fanning vertex after a dead end: the most recent vertex that still has triangles,
+// else the next one in first-use order
+static int64_t skip_dead_end(TipsifyState *st) {
+    while (st->dead_end_count > 0) {
+        const uint32_t v = st->dead_ends[--st->dead_end_count];
+        if (st->live[v] > 0) {
+            return v;
+        }
+    }
+    for (; st->cursor < st->local_count; st->cursor++) {
+        if (st->live[st->cursor] > 0) {
+            return (int64_t)st->cursor;
+        }
+    }
+    return -1;
+}
+
+static size_t optimize_range(uint32_t *indices, const size_t index_count,
+                             const size_t vertex_count, uint32_t *local_of,
+                             uint32_t *out_cluster_starts) {
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return 0;
+    }
+    TipsifyState st;
+    if (!tipsify_init(&st, indices, triangle_count * 3, vertex_count, local_of)) {
+        tipsify_free(&st);
+        // Left as it was: one run
+        out_cluster_starts[0] = 0;
+        return 1;
+    }
+
+    const uint64_t cache_size = MESH_OPTIMIZE_CACHE_SIZE;
+    uint64_t time = cache_size + 1;
+    size_t emitted_count = 0;
+    size_t cluster_count = 0;
+    out_cluster_starts[cluster_count++] = 0;
+    int64_t fan = 0;
+    while (fan >= 0) {
+        size_t candidate_count = 0;
+        const uint32_t f = (uint32_t)fan;
+        for (uint32_t a = st.adjacency_offsets[f]; a < st.adjacency_offsets[f + 1]; a++) {
+            const uint32_t t = st.adjacency[a];
+            if (st.emitted[t]) {
+                continue;
+            }
+            for (int c = 0; c < 3; c++) {
+                const uint32_t v = st.local_indices[(t * 3) + c];
+                st.output[(emitted_count * 3) + c] = indices[(t * 3) + c];
+                st.dead_ends[st.dead_end_count++] = v;
+                st.candidates[candidate_count++] = v;
+                st.live[v]--;
+                if (time - st.timestamps[v] > cache_size) {
+                    st.timestamps[v] = time++;
+                }
+            }
+            st.emitted[t] = true;
+            emitted_count++;
+        }
+
+        // Prefer a candidate that will still be cached once its remaining triangles are
+        // drawn, and among those the one that entered the cache first
+        int64_t next = -1;
+        int64_t best = -1;
+        for (size_t i = 0; i < candidate_count; i++) {
+            const uint32_t v = st.candidates[i];
+            if (st.live[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            const uint64_t age = time - st.timestamps[v];
+            if (age + (2U * (uint64_t)st.live[v]) <= cache_size) {
+                priority = (int64_t)age;
+            }
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+        if (next < 0) {
+            next = skip_dead_end(&st);
+            if (next >= 0 && emitted_count < triangle_count &&
+                out_cluster_starts[cluster_count - 1] != emitted_count) {
+                out_cluster_starts[cluster_count++] = (uint32_t)emitted_count;
+            }
+        }
+        fan = next;
+    }
+    memcpy(indices, st.output, triangle_count * 3 * sizeof(uint32_t));
+    tipsify_free(&st);
+    return cluster_count;
+}
+
+size_t optimize_vertex_cache(uint32_t *indices, const size_t index_count,
+                             const size_t vertex_count, uint32_t *out_cluster_starts) {
+    uint32_t *local_of = malloc(vertex_count * sizeof(uint32_t));
+    if (!local_of) {
+        out_cluster_starts[0] = 0;
+        return index_count >= 3 ? 1 : 0;
+    }
+    memset(local_of, 0xFF, vertex_count * sizeof(uint32_t));
+    const size_t count = optimize_range(indices, index_count, vertex_count, local_of,
+                                        out_cluster_starts);
+    free(local_of);
+    return count;
+}
+
+typedef struct ClusterOrder {
+    float key;
+    uint32_t start;
+    uint32_t count;
+} ClusterOrder;
+
+static int compare_cluster_order(const void *a, const void *b) {
+    const ClusterOrder *x = a;
+    const ClusterOrder *y = b;
+    if (x->key != y->key) {
+        return x->key > y->key ? -1 : 1;
+    }
+    return x->start < y->start ? -1 : (x->start > y->start ? 1 : 0);
+}
+
+// Twice the area-weighted normal, plus the area-weighted centroid sum
+static void cluster_moments(const Vertex *vertices, const uint32_t *indices,
+                            const uint32_t first, const uint32_t count, double normal[3],
+                            double centroid[3], double *area) {
+    for (uint32_t t = first; t < first + count; t++) {
+        const float *p0 = vertices[indices[t * 3]].position;
+        const float *p1 = vertices[indices[(t * 3) + 1]].position;
+        const float *p2 = vertices[indices[(t * 3) + 2]].position;
+        const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        const double n[3] = {(e1[1] * e2[2]) - (e1[2] * e2[1]), (e1[2] * e2[0]) - (e1[0] * e2[2]),
+                             (e1[0] * e2[1]) - (e1[1] * e2[0])};
+        const double a = sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+        for (int k = 0; k < 3; k++) {
+            normal[k] += n[k];
+            centroid[k] += a * (p0[k] + p1[k] + p2[k]) / 3.0;
+        }
+        *area += a;
+    }
+}
+
+void optimize_overdraw(const Vertex *vertices, uint32_t *indices, const size_t index_count,
+                       const uint32_t *cluster_starts, const size_t cluster_count) {
+    const size_t triangle_count = index_count / 3;
+    if (cluster_count < 2 || triangle_count == 0) {
+        return;
+    }
+    ClusterOrder *order = malloc(cluster_count * sizeof(ClusterOrder));
+    uint32_t *reordered = malloc(triangle_count * 3 * sizeof(uint32_t));
+    if (!order || !reordered) {
+        free(order);
+        free(reordered);
+        return;
+    }
+
+    double center[3] = {0.0, 0.0, 0.0};
+    double total_area = 0.0;
+    double ignored[3] = {0.0, 0.0, 0.0};
+    cluster_moments(vertices, indices, 0, (uint32_t)triangle_count, ignored, center,
+                    &total_area);
+    for (int k = 0; k < 3; k++) {
+        center[k] = total_area > 0.0 ? center[k] / total_area : 0.0;
+    }
+
+    for (size_t c = 0; c < cluster_count; c++) {
+        const uint32_t start = cluster_starts[c];
+        const uint32_t end =
+            c + 1 < cluster_count ? cluster_starts[c + 1] : (uint32_t)triangle_count;
+        double normal[3] = {0.0, 0.0, 0.0};
+        double centroid[3] = {0.0, 0.0, 0.0};
+        double area = 0.0;
+        cluster_moments(vertices, indices, start, end - start, normal, centroid, &area);
+        // How far out the cluster sits along the way it faces
+        const double length =
+            sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+        double key = 0.0;
+        if (length > 0.0 && area > 0.0) {
+            for (int k = 0; k < 3; k++) {
+                key += ((centroid[k] / area) - center[k]) * normal[k] / length;
+            }
+        }
+        order[c] = (ClusterOrder){(float)key, start, end - start};
+    }
+    qsort(order, cluster_count, sizeof(ClusterOrder), compare_cluster_order);
+
+    size_t written = 0;
+    for (size_t c = 0; c < cluster_count; c++) {
+        memcpy(reordered + written, indices + ((size_t)order[c].start * 3),
+               (size_t)order[c].count * 3 * sizeof(uint32_t));
+        written += (size_t)order[c].count * 3;
+    }
+    memcpy(indices, reordered, written * sizeof(uint32_t));
+    free(order);
+    free(reordered);
+}
+
+// Renumbers vertices in first-use order, so each range fetches a mostly contiguous span
+static void optimize_vertex_fetch(Mesh *mesh) {
+    const size_t vertex_count = mesh->vertices.count;
+    uint32_t *remap = malloc(vertex_count * sizeof(uint32_t));
+    Vertex *reordered = aligned_malloc(vertex_count * sizeof(Vertex));
+    if (!remap || !reordered) {
+        free(remap);
+        aligned_free(reordered);
+        return;
+    }
+    memset(remap, 0xFF, vertex_count * sizeof(uint32_t));
+    uint32_t next = 0;
+    for (size_t i = 0; i < mesh->indices.count; i++) {
+        const uint32_t v = mesh->indices.data[i];
+        if (v < vertex_count && remap[v] == NO_VERTEX) {
+            remap[v] = next++;
+        }
+    }
+    // Unreferenced vertices go last
+    for (size_t v = 0; v < vertex_count; v++) {
+        if (remap[v] == NO_VERTEX) {
+            remap[v] = next++;
+        }
+        reordered[remap[v]] = mesh->vertices.data[v];
+    }
+    for (size_t i = 0; i < mesh->indices.count; i++) {
+        if (mesh->indices.data[i] < vertex_count) {
+            mesh->indices.data[i] = remap[mesh->indices.data[i]];
+        }
+    }
+    aligned_free(mesh->vertices.data);
+    mesh->vertices.data = reordered;
+    mesh->vertices.capacity = vertex_count;
+    free(remap);
+}
+
+static void optimize_submesh_range(Mesh *mesh, const uint32_t offset, const uint32_t count,
+                                   uint32_t *local_of, uint32_t *cluster_starts) {
+    uint32_t *indices = mesh->indices.data + offset;
+    const size_t clusters =
+        optimize_range(indices, count, mesh->vertices.count, local_of, cluster_starts);
+    optimize_overdraw(mesh->vertices.data, indices, count, cluster_starts, clusters);
+}
+
+void mesh_optimize(Mesh *mesh, const MaterialInfo *materials, const size_t material_count) {
+    if (mesh->vertices.count == 0 || mesh->indices.count == 0) {
+        return;
+    }
+    size_t largest_range = 0;
+    for (size_t s = 0; s < mesh->submeshes.count; s++) {
+        const SubMesh *submesh = &mesh->submeshes.data[s];
+        if (submesh->index_count > largest_range) {
+            largest_range = submesh->index_count;
+        }
+        for (uint32_t l = 0; l < submesh->lod_count; l++) {
+            if (submesh->lods[l].index_count > largest_range) {
+                largest_range = submesh->lods[l].index_count;
+            }
+        }
+    }
+
+    uint32_t *local_of = malloc(mesh->vertices.count * sizeof(uint32_t));
+    uint32_t *cluster_starts = malloc((largest_range / 3 + 1) * sizeof(uint32_t));
+    if (local_of && cluster_starts) {
+        memset(local_of, 0xFF, mesh->vertices.count * sizeof(uint32_t));
+        for (size_t s = 0; s < mesh->submeshes.count; s++) {
+            const SubMesh *submesh = &mesh->submeshes.data[s];
+            if (submesh->material_index < material_count &&
+                materials[submesh->material_index].alpha_mode == ALPHA_MODE_BLEND) {
+                continue;
+            }
+            optimize_submesh_range(mesh, submesh->index_offset, submesh->index_count, local_of,
+                                   cluster_starts);
+            for (uint32_t l = 0; l < submesh->lod_count; l++) {
+                optimize_submesh_range(mesh, submesh->lods[l].index_offset,
+                                       submesh->lods[l].index_count, local_of, cluster_starts);
+            }
+        }
+    }
+    free(local_of);
+    free(cluster_starts);
+    optimize_vertex_fetch(mesh);
+}
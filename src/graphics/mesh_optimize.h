@@ -0,0 +1,30 @@
+#pragma once
+#include "model.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Post-transform cache size the triangle order is tuned for. Real caches are larger or
+// batch-based, and an order that suits a small FIFO holds up on all of them.
+#define MESH_OPTIMIZE_CACHE_SIZE 16U
+
+// Average post-transform cache misses per triangle of `indices` through a FIFO cache of
+// `cache_size` entries; 3 is one miss per corner, about 0.5 is ideal for a regular grid.
+float simulate_vertex_cache(const uint32_t *indices, size_t index_count, size_t vertex_count,
+                            uint32_t cache_size);
+
+// Reorders the triangles of `indices` in place for the post-transform cache (Tipsify:
+// Sander, Nehab and Barczak 2007). Corners keep their order, so winding is unchanged.
+// `out_cluster_starts`, with room for index_count / 3 entries, receives the first triangle
+// of each run where the order had to jump; returns how many runs there are.
+size_t optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count,
+                             uint32_t *out_cluster_starts);
+
+// Reorders the runs from optimize_vertex_cache so that clusters on the outside of the
+// range, facing outward, draw first and hide what lies behind them.
+void optimize_overdraw(const Vertex *vertices, uint32_t *indices, size_t index_count,
+                       const uint32_t *cluster_starts, size_t cluster_count);
+
+// Optimizes every sub-mesh range, LOD levels included, then renumbers the vertices in the
+// order the index buffer first uses them. Sub-meshes whose material blends keep their
+// triangle order, which is what they composite in.
+void mesh_optimize(Mesh *mesh, const MaterialInfo *materials, size_t material_count);
@@ -0,0 +1,212 @@
+#include "meshlet.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Cones wider than this (normals more than about 84 degrees from the axis) can never be
+// wholly back-facing from far enough away to be worth testing
+#define MESHLET_MIN_CONE_DOT 0.1F
+
+static void cross3(const float a[3], const float b[3], float out[3]) {
+    out[0] = (a[1] * b[2]) - (a[2] * b[1]);
+    out[1] = (a[2] * b[0]) - (a[0] * b[2]);
+    out[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
+
+static float dot3(const float a[3], const float b[3]) {
+    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+// Unit normal of the triangle at `indices`; false for degenerate triangles
+static bool triangle_normal(const Mesh *mesh, const uint32_t *indices, float normal[3]) {
+    const float *p0 = mesh->vertices.data[indices[0]].position;
+    const float *p1 = mesh->vertices.data[indices[1]].position;
+    const float *p2 = mesh->vertices.data[indices[2]].position;
+    const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    cross3(e1, e2, normal);
+    const float length = sqrtf(dot3(normal, normal));
+    if (length <= 0.0F || !isfinite(length)) {
+        return false;
+    }
+    for (int k = 0; k < 3; k++) {
+        normal[k] /= length;
+    }
+    return true;
+}
+
+static void compute_meshlet_bounds(const Mesh *mesh, Meshlet *meshlet) {
+    const uint32_t *indices = mesh->indices.data + meshlet->index_offset;
+    float min[3] = {INFINITY, INFINITY, INFINITY};
+    float max[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = 0; i < meshlet->index_count; i++) {
+        const float *p = mesh->vertices.data[indices[i]].position;
+        for (int k = 0; k < 3; k++) {
+            min[k] = fminf(min[k], p[k]);
+            max[k] = fmaxf(max[k], p[k]);
+        }
+    }
+    for (int k = 0; k < 3; k++) {
+        meshlet->center[k] = (min[k] + max[k]) * 0.5F;
+    }
+    float radius_squared = 0.0F;
+    for (uint32_t i = 0; i < meshlet->index_count; i++) {
+        const float *p = mesh->vertices.data[indices[i]].position;
+        float distance_squared = 0.0F;
+        for (int k = 0; k < 3; k++) {
+            const float d = p[k] - meshlet->center[k];
+            distance_squared += d * d;
+        }
+        radius_squared = fmaxf(radius_squared, distance_squared);
+    }
+    meshlet->radius = sqrtf(radius_squared);
+}
+
+static void compute_meshlet_cone(const Mesh *mesh, Meshlet *meshlet) {
+    const uint32_t *indices = mesh->indices.data + meshlet->index_offset;
+    float axis[3] = {0.0F, 0.0F, 0.0F};
+    float normal[3];
+    for (uint32_t i = 0; i + 2 < meshlet->index_count; i += 3) {
+        if (triangle_normal(mesh, indices + i, normal)) {
+            for (int k = 0; k < 3; k++) {
+                axis[k] += normal[k];
+            }
+        }
+    }
+    meshlet->cone_cutoff = 1.0F;
+    const float length = sqrtf(dot3(axis, axis));
+    if (length <= 1e-6F) {
+        return;
+    }
+    float min_dot = 1.0F;
+    for (int k = 0; k < 3; k++) {
+        meshlet->cone_axis[k] = axis[k] / length;
+    }
+    for (uint32_t i = 0; i + 2 < meshlet->index_count; i += 3) {
+        if (triangle_normal(mesh, indices + i, normal)) {
+            min_dot = fminf(min_dot, dot3(normal, meshlet->cone_axis));
+        }
+    }
+    if (min_dot > MESHLET_MIN_CONE_DOT) {
+        meshlet->cone_cutoff = sqrtf(fmaxf(0.0F, 1.0F - (min_dot * min_dot)));
+    }
+}
+
+static void push_meshlet(Mesh *mesh, Meshlet *meshlet) {
+    compute_meshlet_bounds(mesh, meshlet);
+    compute_meshlet_cone(mesh, meshlet);
+    ARRAY_PUSH(mesh->meshlets, *meshlet);
+}
+
+// Vertices of the triangle at `indices` not yet in the meshlet stamped `current`
+static uint32_t count_new_vertices(const uint32_t *stamps, const uint32_t *indices,
+                                   const uint32_t current) {
+    uint32_t count = 0;
+    for (int k = 0; k < 3; k++) {
+        count += stamps[indices[k]] != current ? 1U : 0U;
+    }
+    return count;
+}
+
+void mesh_build_meshlets(Mesh *mesh) {
+    ARRAY_FREE(mesh->meshlets);
+    for (size_t s = 0; s < mesh->submeshes.count; s++) {
+        mesh->submeshes.data[s].meshlet_offset = 0;
+        mesh->submeshes.data[s].meshlet_count = 0;
+    }
+    if (mesh->vertices.count == 0) {
+        return;
+    }
+    // Which meshlet last used each vertex, so counting a meshlet's vertices needs no clearing
+    uint32_t *stamps = calloc(mesh->vertices.count, sizeof(uint32_t));
+    if (!stamps) {
+        return;
+    }
+    uint32_t current = 0;
+    for (size_t s = 0; s < mesh->submeshes.count; s++) {
+        SubMesh *submesh = &mesh->submeshes.data[s];
+        submesh->meshlet_offset = (uint32_t)mesh->meshlets.count;
+        if (submesh->index_count / 3 < MESHLET_MIN_TRIANGLES) {
+            continue;
+        }
+        const uint32_t *indices = mesh->indices.data + submesh->index_offset;
+        Meshlet meshlet = {.index_offset = submesh->index_offset};
+        uint32_t vertex_count = 0;
+        current++;
+        for (uint32_t i = 0; i + 2 < submesh->index_count; i += 3) {
+            if (meshlet.index_count / 3 == MESHLET_MAX_TRIANGLES ||
+                vertex_count + count_new_vertices(stamps, indices + i, current) >
+                    MESHLET_MAX_VERTICES) {
+                push_meshlet(mesh, &meshlet);
+                meshlet = (Meshlet){.index_offset = submesh->index_offset + i};
+                vertex_count = 0;
+                current++;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (stamps[indices[i + k]] != current) {
+                    stamps[indices[i + k]] = current;
+                    vertex_count++;
+                }
+            }
+            meshlet.index_count += 3;
+        }
+        if (meshlet.index_count > 0) {
+            push_meshlet(mesh, &meshlet);
+        }
+        submesh->meshlet_count = (uint32_t)mesh->meshlets.count - submesh->meshlet_offset;
+    }
+    free(stamps);
+}
+
+void meshlet_cull_view_init(MeshletCullView *view, mat4 mvp, mat4 model, const vec3 camera_pos,
+                            const bool cull_backfaces) {
+    // Gribb-Hartmann: each plane is the fourth row of the matrix plus or minus another row
+    for (int p = 0; p < 4; p++) {
+        const int row = p / 2;
+        const float sign = (p % 2 == 0) ? 1.0F : -1.0F;
+        for (int k = 0; k < 4; k++) {
+            view->planes[p][k] = mvp[k][3] + (sign * mvp[k][row]);
+        }
+        const float length = sqrtf(dot3(view->planes[p], view->planes[p]));
+        if (length > 0.0F) {
+            for (int k = 0; k < 4; k++) {
+                view->planes[p][k] /= length;
+            }
+        }
+    }
+
+    // The camera in model space, by Cramer's rule on the model matrix's linear part
+    float bc[3];
+    cross3(model[1], model[2], bc);
+    const float det = dot3(model[0], bc);
+    const float d[3] = {camera_pos[0] - model[3][0], camera_pos[1] - model[3][1],
+                        camera_pos[2] - model[3][2]};
+    view->cull_backfaces = cull_backfaces && det > 0.0F;
+    if (det == 0.0F) {
+        view->camera[0] = view->camera[1] = view->camera[2] = 0.0F;
+        return;
+    }
+    float dc[3];
+    float bd[3];
+    cross3(d, model[2], dc);
+    cross3(model[1], d, bd);
+    view->camera[0] = dot3(d, bc) / det;
+    view->camera[1] = dot3(model[0], dc) / det;
+    view->camera[2] = dot3(model[0], bd) / det;
+}
+
+bool meshlet_visible(const Meshlet *meshlet, const MeshletCullView *view) {
+    for (int p = 0; p < 4; p++) {
+        if (dot3(view->planes[p], meshlet->center) + view->planes[p][3] < -meshlet->radius) {
+            return false;
+        }
+    }
+    if (!view->cull_backfaces || meshlet->cone_cutoff >= 1.0F) {
+        return true;
+    }
+    const float to_center[3] = {meshlet->center[0] - view->camera[0],
+                                meshlet->center[1] - view->camera[1],
+                                meshlet->center[2] - view->camera[2]};
+    const float distance = sqrtf(dot3(to_center, to_center));
+    return dot3(to_center, meshlet->cone_axis) <
+           (meshlet->cone_cutoff * distance) + meshlet->radius;
+}
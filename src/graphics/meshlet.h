@@ -0,0 +1,33 @@
+#pragma once
+#include "model.h"
+#include <cglm/types.h>
+#include <stdbool.h>
+
+// Sub-meshes below this many triangles draw whole; culling them piecewise would cost more
+// than it saves
+#define MESHLET_MIN_TRIANGLES 1024U
+#define MESHLET_MAX_VERTICES 64U
+#define MESHLET_MAX_TRIANGLES 124U
+
+// Splits the full-detail range of every large sub-mesh into runs of consecutive triangles,
+// replacing mesh->meshlets. Run after mesh_optimize, whose cache ordering keeps neighbouring
+// triangles together.
+void mesh_build_meshlets(Mesh *mesh);
+
+// What meshlet_visible tests against, in the model space the meshlets are in
+typedef struct MeshletCullView {
+    // Left, right, bottom and top frustum planes, normals pointing inwards. All four pass
+    // through the eye, so they also reject what is behind it.
+    vec4 planes[4];
+    vec3 camera;
+    // Off when the renderer draws both sides, or the model matrix mirrors the mesh
+    bool cull_backfaces;
+} MeshletCullView;
+
+// `mvp` maps model space to clip space; `camera_pos` is in world space.
+void meshlet_cull_view_init(MeshletCullView *view, mat4 mvp, mat4 model, const vec3 camera_pos,
+                            bool cull_backfaces);
+
+// False when the meshlet is wholly outside the frustum, or, with back-face culling, every
+// triangle in it faces away from the camera.
+bool meshlet_visible(const Meshlet *meshlet, const MeshletCullView *view);
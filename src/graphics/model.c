@@ -1,10 +1,17 @@
 #include "model.h"
+#include "core/worker_pool.h"
+#include "gltf.h"
+#include "mesh_cache.h"
+#include "mesh_lod.h"
+#include "mesh_optimize.h"
+#include "meshlet.h"
 
 #include <assimp/cimport.h>
 #include <assimp/material.h>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,8 +26,10 @@ void mesh_free(Mesh *mesh) {
     aligned_free(mesh->vertices.data);
     aligned_free(mesh->indices.data);
     aligned_free(mesh->submeshes.data);
+    aligned_free(mesh->meshlets.data);
     skeleton_free(&mesh->skeleton);
     animation_array_free(&mesh->animations);
+    baked_poses_free(&mesh->baked_poses);
     mesh_init(mesh);
 }
 
@@ -59,16 +68,37 @@ void material_info_free(MaterialInfo *info) {
     material_info_init(info);
 }
 
-void calculate_camera_setup(const VertexArray *vertices, CameraSetup *setup) {
-    if (vertices->count == 0) {
-        glm_vec3_copy((vec3){0.0F, 0.0F, 3.0F}, setup->position);
-        glm_vec3_zero(setup->target);
-        setup->model_scale = 1.0F;
-        return;
+// A malloc'd copy of `size` bytes, or NULL for no `source`
+static unsigned char *copy_bytes(const unsigned char *source, const size_t size) {
+    if (!source) {
+        return NULL;
+    }
+    unsigned char *copy = malloc(size > 0 ? size : 1);
+    if (copy) {
+        memcpy(copy, source, size);
+    }
+    return copy;
+}
+
+bool material_info_copy(const MaterialInfo *source, MaterialInfo *out) {
+    *out = *source;
+    out->diffuse_path = source->diffuse_path ? str_dup(source->diffuse_path) : NULL;
+    out->normal_path = source->normal_path ? str_dup(source->normal_path) : NULL;
+    out->embedded_diffuse = copy_bytes(source->embedded_diffuse, source->embedded_diffuse_size);
+    out->embedded_normal = copy_bytes(source->embedded_normal, source->embedded_normal_size);
+    if ((source->diffuse_path && !out->diffuse_path) ||
+        (source->normal_path && !out->normal_path) ||
+        (source->embedded_diffuse && !out->embedded_diffuse) ||
+        (source->embedded_normal && !out->embedded_normal)) {
+        material_info_free(out);
+        return false;
     }
+    return true;
+}
 
-    vec3 min_pos = {FLT_MAX, FLT_MAX, FLT_MAX};
-    vec3 max_pos = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+static void vertex_bounds(const VertexArray *vertices, vec3 min_pos, vec3 max_pos) {
+    glm_vec3_copy((vec3){FLT_MAX, FLT_MAX, FLT_MAX}, min_pos);
+    glm_vec3_copy((vec3){-FLT_MAX, -FLT_MAX, -FLT_MAX}, max_pos);
 
     for (size_t i = 0; i < vertices->count; i++) {
         const Vertex *v = &vertices->data[i];
@@ -81,12 +111,15 @@ void calculate_camera_setup(const VertexArray *vertices, CameraSetup *setup) {
             }
         }
     }
+}
 
+void calculate_camera_setup_from_bounds(const vec3 bounds_min, const vec3 bounds_max,
+                                        CameraSetup *setup) {
     vec3 center;
     vec3 size;
-    glm_vec3_add(min_pos, max_pos, center);
+    glm_vec3_add((float *)bounds_min, (float *)bounds_max, center);
     glm_vec3_scale(center, 0.5F, center);
-    glm_vec3_sub(max_pos, min_pos, size);
+    glm_vec3_sub((float *)bounds_max, (float *)bounds_min, size);
 
     float diagonal = sqrtf((size[0] * size[0]) + (size[1] * size[1]) + (size[2] * size[2]));
     float distance = diagonal * 1.2F;
@@ -98,6 +131,88 @@ void calculate_camera_setup(const VertexArray *vertices, CameraSetup *setup) {
     setup->model_scale = diagonal;
 }
 
+void calculate_camera_setup(const VertexArray *vertices, CameraSetup *setup) {
+    if (vertices->count == 0) {
+        glm_vec3_copy((vec3){0.0F, 0.0F, 3.0F}, setup->position);
+        glm_vec3_zero(setup->target);
+        setup->model_scale = 1.0F;
+        return;
+    }
+
+    vec3 min_pos;
+    vec3 max_pos;
+    vertex_bounds(vertices, min_pos, max_pos);
+    calculate_camera_setup_from_bounds(min_pos, max_pos, setup);
+}
+
+void mesh_camera_setup(const Mesh *mesh, CameraSetup *setup) {
+    if (mesh->geometry_released && mesh->vertices.count > 0) {
+        calculate_camera_setup_from_bounds(mesh->bounds_min, mesh->bounds_max, setup);
+        return;
+    }
+    calculate_camera_setup(&mesh->vertices, setup);
+}
+
+bool mesh_bounds(const Mesh *mesh, vec3 out_min, vec3 out_max) {
+    if (mesh->vertices.count == 0) {
+        return false;
+    }
+    if (mesh->geometry_released) {
+        glm_vec3_copy((float *)mesh->bounds_min, out_min);
+        glm_vec3_copy((float *)mesh->bounds_max, out_max);
+        return true;
+    }
+    vertex_bounds(&mesh->vertices, out_min, out_max);
+    return true;
+}
+
+void mesh_release_geometry(Mesh *mesh) {
+    if (mesh->geometry_released || mesh->vertices.count == 0) {
+        return;
+    }
+    vertex_bounds(&mesh->vertices, mesh->bounds_min, mesh->bounds_max);
+    aligned_free(mesh->vertices.data);
+    aligned_free(mesh->indices.data);
+    mesh->vertices.data = NULL;
+    mesh->vertices.capacity = 0;
+    mesh->indices.data = NULL;
+    mesh->indices.capacity = 0;
+    mesh->geometry_released = true;
+}
+
+bool mesh_restore_geometry(Mesh *mesh, const char *source_path) {
+    if (!mesh->geometry_released) {
+        return true;
+    }
+    MeshCacheKey cache_key;
+    if (!mesh_cache_key(source_path, NULL, &cache_key)) {
+        return false;
+    }
+    Mesh cached;
+    mesh_init(&cached);
+    bool has_uvs = false;
+    MaterialInfo *materials = NULL;
+    size_t material_count = 0;
+    if (!mesh_cache_load(&cache_key, source_path, &cached, &has_uvs, &materials,
+                         &material_count)) {
+        return false;
+    }
+    materials_free(materials, material_count);
+
+    // An entry rewritten since the load (the source changed) is a different mesh
+    const bool matches = cached.vertices.count == mesh->vertices.count &&
+                         cached.indices.count == mesh->indices.count;
+    if (matches) {
+        mesh->vertices = cached.vertices;
+        mesh->indices = cached.indices;
+        mesh->geometry_released = false;
+        ARRAY_INIT(cached.vertices);
+        ARRAY_INIT(cached.indices);
+    }
+    mesh_free(&cached);
+    return matches;
+}
+
 // Convert assimp matrix to cglm matrix
 static void ai_matrix_to_glm(const struct aiMatrix4x4 *from, mat4 to) {
     to[0][0] = from->a1;
@@ -131,244 +246,366 @@ static void ai_quat_to_glm(const struct aiQuaternion *q, versor out) {
     out[3] = q->w;
 }
 
-static void process_node(const struct aiNode *node, const struct aiScene *scene,
-                         mat4 parent_transform, VertexArray *vertices, Uint32Array *indices,
-                         SubMeshArray *submeshes, bool *out_has_uvs, bool flip_uv_y,
-                         unsigned int uv_channel) {
-    mat4 node_transform;
+// Vertices or faces converted per task; big meshes are split so one of them does not
+// leave the other cores idle
+#define CONVERSION_CHUNK_SIZE 65536U
+// Below this the threads cost more to start than the conversion takes
+#define CONVERSION_PARALLEL_MIN_VERTICES 262144U
+
+// One aiMesh and where the counting pass placed it in the output arrays
+typedef struct MeshJob {
+    const struct aiMesh *mesh;
+    const struct aiNode *node;
+    mat4 transform; // baked node chain; identity for animated models
+    mat3 normal_matrix;
+    uint32_t vertex_offset;
+    uint32_t index_offset;
+    uint32_t first_chunk;
+    bool triangles_only; // face j's indices then start at 3 * j
+    int *bone_indices;   // skeleton index of each aiBone (animated models)
+    int fallback_bone;   // for vertices without weights, -1 when none were left uncovered
+    bool needs_fallback;
+} MeshJob;
+
+typedef struct MeshJobArray {
+    MeshJob *data;
+    size_t count;
+    size_t capacity;
+} MeshJobArray;
+
+typedef struct MeshConversion {
+    const MeshJobArray *jobs;
+    Uint32Array chunk_jobs; // owning job of each chunk
+    Vertex *vertices;
+    uint32_t *indices;
+    bool animated;
+    bool flip_uv_y;
+    unsigned int uv_channel;
+} MeshConversion;
+
+// Adds the skeleton bone for `name` unless it exists; -1 if its name cannot be copied.
+static int register_bone(Skeleton *skeleton, const char *name, const struct aiMatrix4x4 *offset) {
+    int bone_index = bone_map_find(&skeleton->bone_map, name);
+    if (bone_index >= 0) {
+        return bone_index;
+    }
+    BoneInfo bone_info;
+    bone_info.name = str_dup(name);
+    if (!bone_info.name) {
+        return -1;
+    }
+    bone_index = (int)skeleton->bones.count;
+    if (offset) {
+        ai_matrix_to_glm(offset, bone_info.offset_matrix);
+    } else {
+        glm_mat4_identity(bone_info.offset_matrix);
+    }
+    bone_info.index = bone_index;
+    ARRAY_PUSH(skeleton->bones, bone_info);
+    bone_map_insert(&skeleton->bone_map, name, bone_index);
+    return bone_index;
+}
+
+// Counting pass: walks the node tree in order, lays out every triangle mesh in the vertex
+// and index arrays, adds its submesh and registers its bones, so the conversion itself can
+// run on any thread in any order.
+static bool collect_mesh_jobs(const struct aiNode *node, const struct aiScene *scene,
+                              mat4 parent_transform, MeshJobArray *jobs, size_t *vertex_count,
+                              size_t *index_count, Mesh *out, bool *out_has_uvs,
+                              unsigned int uv_channel) {
     mat4 combined;
-    ai_matrix_to_glm(&node->mTransformation, node_transform);
-    glm_mat4_mul(parent_transform, node_transform, combined);
+    if (out->has_animations) {
+        // Animated models keep the bind pose; the skeleton places them
+        glm_mat4_identity(combined);
+    } else {
+        mat4 node_transform;
+        ai_matrix_to_glm(&node->mTransformation, node_transform);
+        glm_mat4_mul(parent_transform, node_transform, combined);
+    }
 
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
         const struct aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
+        // Accept any mesh with the triangle bit set, since triangulated n-gons also carry
+        // aiPrimitiveType_NGONEncodingFlag.
         if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) {
             continue;
         }
-        const uint32_t base_index = (uint32_t)vertices->count;
-
+        size_t mesh_index_count = 0;
+        for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
+            mesh_index_count += mesh->mFaces[j].mNumIndices;
+        }
+        if (*vertex_count + mesh->mNumVertices > UINT32_MAX ||
+            *index_count + mesh_index_count > UINT32_MAX) {
+            fprintf(stderr, "Error loading model: more than 2^32 vertices or indices\n");
+            return false;
+        }
         if (mesh->mTextureCoords[uv_channel]) {
             *out_has_uvs = true;
         }
 
-        // Compute normal matrix
-        mat3 normal_matrix;
-        glm_mat4_pick3(combined, normal_matrix);
-        glm_mat3_inv(normal_matrix, normal_matrix);
-        glm_mat3_transpose(normal_matrix);
-
-        // Process vertices
-        for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-            Vertex vertex = {0};
-            for (int slot = 0; slot < MAX_BONE_INFLUENCE; slot++) {
-                vertex.bone_ids[slot] = -1;
-            }
-
-            // Apply transformation
-            vec4 pos = {mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z, 1.0F};
-            vec4 transformed;
-            glm_mat4_mulv(combined, pos, transformed);
-            glm_vec3_copy(transformed, vertex.position);
-
-            if (mesh->mTextureCoords[uv_channel]) {
-                vertex.texcoord[0] = mesh->mTextureCoords[uv_channel][j].x;
-                vertex.texcoord[1] = (int)flip_uv_y ? (1.0F - mesh->mTextureCoords[uv_channel][j].y)
-                                                    : mesh->mTextureCoords[uv_channel][j].y;
-            }
-
-            if (mesh->mNormals) {
-                vec3 normal = {mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z};
-                glm_mat3_mulv(normal_matrix, normal, vertex.normal);
-                glm_vec3_normalize(vertex.normal);
-            } else {
-                glm_vec3_copy((vec3){0.0F, 1.0F, 0.0F}, vertex.normal);
-            }
-
-            if (mesh->mTangents && mesh->mBitangents) {
-                vec3 tangent = {mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z};
-                vec3 bitangent = {mesh->mBitangents[j].x, mesh->mBitangents[j].y,
-                                  mesh->mBitangents[j].z};
-                glm_mat3_mulv(normal_matrix, tangent, vertex.tangent);
-                glm_mat3_mulv(normal_matrix, bitangent, vertex.bitangent);
-                glm_vec3_normalize(vertex.tangent);
-                glm_vec3_normalize(vertex.bitangent);
-            } else {
-                glm_vec3_copy((vec3){1.0F, 0.0F, 0.0F}, vertex.tangent);
-                glm_vec3_copy((vec3){0.0F, 0.0F, 1.0F}, vertex.bitangent);
+        MeshJob job = {0};
+        job.mesh = mesh;
+        job.node = node;
+        job.vertex_offset = (uint32_t)*vertex_count;
+        job.index_offset = (uint32_t)*index_count;
+        job.triangles_only = mesh_index_count == (size_t)mesh->mNumFaces * 3U;
+        job.fallback_bone = -1;
+        glm_mat4_copy(combined, job.transform);
+        glm_mat4_pick3(combined, job.normal_matrix);
+        glm_mat3_inv(job.normal_matrix, job.normal_matrix);
+        glm_mat3_transpose(job.normal_matrix);
+
+        if (out->has_animations && mesh->mNumBones > 0) {
+            job.bone_indices = malloc(mesh->mNumBones * sizeof(int));
+            if (!job.bone_indices) {
+                return false;
             }
-
-            ARRAY_PUSH(*vertices, vertex);
-        }
-
-        // Process indices
-        const uint32_t index_start = (uint32_t)indices->count;
-        for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-            const struct aiFace *face = &mesh->mFaces[j];
-            for (unsigned int k = 0; k < face->mNumIndices; k++) {
-                uint32_t idx = base_index + face->mIndices[k];
-                ARRAY_PUSH(*indices, idx);
+            for (unsigned int j = 0; j < mesh->mNumBones; j++) {
+                const struct aiBone *bone = mesh->mBones[j];
+                job.bone_indices[j] =
+                    register_bone(&out->skeleton, bone->mName.data, &bone->mOffsetMatrix);
             }
         }
+        ARRAY_PUSH(*jobs, job);
 
-        SubMesh submesh;
-        submesh.index_offset = index_start;
-        submesh.index_count = (uint32_t)indices->count - index_start;
+        SubMesh submesh = {0};
+        submesh.index_offset = (uint32_t)*index_count;
+        submesh.index_count = (uint32_t)mesh_index_count;
         submesh.material_index = mesh->mMaterialIndex;
-        ARRAY_PUSH(*submeshes, submesh);
+        ARRAY_PUSH(out->submeshes, submesh);
+
+        *vertex_count += mesh->mNumVertices;
+        *index_count += mesh_index_count;
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        process_node(node->mChildren[i], scene, combined, vertices, indices, submeshes, out_has_uvs,
-                     flip_uv_y, uv_channel);
+        if (!collect_mesh_jobs(node->mChildren[i], scene, combined, jobs, vertex_count,
+                               index_count, out, out_has_uvs, uv_channel)) {
+            return false;
+        }
     }
+    return true;
 }
 
-// Process node for animated models (no transform baking)
-static void process_node_animated(const struct aiNode *node, const struct aiScene *scene,
-                                  VertexArray *vertices, Uint32Array *indices,
-                                  SubMeshArray *submeshes, bool *out_has_uvs, Skeleton *skeleton,
-                                  bool flip_uv_y, unsigned int uv_channel) {
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        const struct aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        // See process_node(): accept any mesh with the triangle bit set, since
-        // triangulated n-gons also carry aiPrimitiveType_NGONEncodingFlag.
-        if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) {
-            continue;
-        }
-        const uint32_t base_index = (uint32_t)vertices->count;
+static void convert_vertex(const MeshConversion *conversion, MeshJob *job,
+                           const unsigned int j, Vertex *vertex) {
+    const struct aiMesh *mesh = job->mesh;
+    memset(vertex, 0, sizeof(*vertex));
+    for (int slot = 0; slot < MAX_BONE_INFLUENCE; slot++) {
+        vertex->bone_ids[slot] = -1;
+    }
 
-        if (mesh->mTextureCoords[uv_channel]) {
-            *out_has_uvs = true;
+    const struct aiVector3D *uvs = mesh->mTextureCoords[conversion->uv_channel];
+    if (uvs) {
+        vertex->texcoord[0] = uvs[j].x;
+        vertex->texcoord[1] = conversion->flip_uv_y ? (1.0F - uvs[j].y) : uvs[j].y;
+    }
+
+    if (conversion->animated) {
+        // Bind pose as stored
+        ai_vector_to_glm(&mesh->mVertices[j], vertex->position);
+        if (mesh->mNormals) {
+            ai_vector_to_glm(&mesh->mNormals[j], vertex->normal);
+        } else {
+            glm_vec3_copy((vec3){0.0F, 1.0F, 0.0F}, vertex->normal);
         }
+        if (mesh->mTangents && mesh->mBitangents) {
+            ai_vector_to_glm(&mesh->mTangents[j], vertex->tangent);
+            ai_vector_to_glm(&mesh->mBitangents[j], vertex->bitangent);
+        } else {
+            glm_vec3_copy((vec3){1.0F, 0.0F, 0.0F}, vertex->tangent);
+            glm_vec3_copy((vec3){0.0F, 0.0F, 1.0F}, vertex->bitangent);
+        }
+        return;
+    }
 
-        // Process vertices (no transformation - keep in bind pose)
-        for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-            Vertex vertex = {0};
-            for (int slot = 0; slot < MAX_BONE_INFLUENCE; slot++) {
-                vertex.bone_ids[slot] = -1;
-            }
+    vec4 pos = {mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z, 1.0F};
+    vec4 transformed;
+    glm_mat4_mulv(job->transform, pos, transformed);
+    glm_vec3_copy(transformed, vertex->position);
 
-            vertex.position[0] = mesh->mVertices[j].x;
-            vertex.position[1] = mesh->mVertices[j].y;
-            vertex.position[2] = mesh->mVertices[j].z;
+    if (mesh->mNormals) {
+        vec3 normal;
+        ai_vector_to_glm(&mesh->mNormals[j], normal);
+        glm_mat3_mulv(job->normal_matrix, normal, vertex->normal);
+        glm_vec3_normalize(vertex->normal);
+    } else {
+        glm_vec3_copy((vec3){0.0F, 1.0F, 0.0F}, vertex->normal);
+    }
 
-            if (mesh->mTextureCoords[uv_channel]) {
-                vertex.texcoord[0] = mesh->mTextureCoords[uv_channel][j].x;
-                vertex.texcoord[1] = (int)flip_uv_y ? (1.0F - mesh->mTextureCoords[uv_channel][j].y)
-                                                    : mesh->mTextureCoords[uv_channel][j].y;
-            }
+    if (mesh->mTangents && mesh->mBitangents) {
+        vec3 tangent;
+        vec3 bitangent;
+        ai_vector_to_glm(&mesh->mTangents[j], tangent);
+        ai_vector_to_glm(&mesh->mBitangents[j], bitangent);
+        glm_mat3_mulv(job->normal_matrix, tangent, vertex->tangent);
+        glm_mat3_mulv(job->normal_matrix, bitangent, vertex->bitangent);
+        glm_vec3_normalize(vertex->tangent);
+        glm_vec3_normalize(vertex->bitangent);
+    } else {
+        glm_vec3_copy((vec3){1.0F, 0.0F, 0.0F}, vertex->tangent);
+        glm_vec3_copy((vec3){0.0F, 0.0F, 1.0F}, vertex->bitangent);
+    }
+}
 
-            if (mesh->mNormals) {
-                vertex.normal[0] = mesh->mNormals[j].x;
-                vertex.normal[1] = mesh->mNormals[j].y;
-                vertex.normal[2] = mesh->mNormals[j].z;
-            } else {
-                glm_vec3_copy((vec3){0.0F, 1.0F, 0.0F}, vertex.normal);
-            }
+// Each chunk writes only its own slice of the pre-sized arrays
+static void convert_chunk(void *context, const uint32_t chunk) {
+    const MeshConversion *conversion = context;
+    MeshJob *job = &conversion->jobs->data[conversion->chunk_jobs.data[chunk]];
+    const struct aiMesh *mesh = job->mesh;
+    const unsigned int begin = (chunk - job->first_chunk) * CONVERSION_CHUNK_SIZE;
 
-            if (mesh->mTangents && mesh->mBitangents) {
-                vertex.tangent[0] = mesh->mTangents[j].x;
-                vertex.tangent[1] = mesh->mTangents[j].y;
-                vertex.tangent[2] = mesh->mTangents[j].z;
-                vertex.bitangent[0] = mesh->mBitangents[j].x;
-                vertex.bitangent[1] = mesh->mBitangents[j].y;
-                vertex.bitangent[2] = mesh->mBitangents[j].z;
-            } else {
-                glm_vec3_copy((vec3){1.0F, 0.0F, 0.0F}, vertex.tangent);
-                glm_vec3_copy((vec3){0.0F, 0.0F, 1.0F}, vertex.bitangent);
-            }
+    for (unsigned int j = begin; j < mesh->mNumVertices && j - begin < CONVERSION_CHUNK_SIZE;
+         j++) {
+        convert_vertex(conversion, job, j, &conversion->vertices[job->vertex_offset + j]);
+    }
 
-            ARRAY_PUSH(*vertices, vertex);
+    // Mixed face sizes have no direct index offset, so the first chunk takes them all
+    if (!job->triangles_only && begin > 0) {
+        return;
+    }
+    const unsigned int face_end = job->triangles_only ? begin + CONVERSION_CHUNK_SIZE : UINT_MAX;
+    uint32_t *out = conversion->indices + job->index_offset;
+    if (job->triangles_only) {
+        out += begin * 3U;
+    }
+    for (unsigned int j = begin; j < mesh->mNumFaces && j < face_end; j++) {
+        const struct aiFace *face = &mesh->mFaces[j];
+        for (unsigned int k = 0; k < face->mNumIndices; k++) {
+            *out++ = job->vertex_offset + face->mIndices[k];
         }
+    }
+}
 
-        // Extract bone weights
-        if (mesh->mNumBones > 0) {
-            for (unsigned int j = 0; j < mesh->mNumBones; j++) {
-                const struct aiBone *bone = mesh->mBones[j];
-                const char *bone_name = bone->mName.data;
-
-                int bone_index = bone_map_find(&skeleton->bone_map, bone_name);
-                if (bone_index < 0) {
-                    bone_index = (int)skeleton->bones.count;
-                    BoneInfo bone_info;
-                    bone_info.name = str_dup(bone_name);
-                    if (!bone_info.name) {
-                        continue;
-                    }
-                    ai_matrix_to_glm(&bone->mOffsetMatrix, bone_info.offset_matrix);
-                    bone_info.index = bone_index;
-                    ARRAY_PUSH(skeleton->bones, bone_info);
-                    bone_map_insert(&skeleton->bone_map, bone_name, bone_index);
-                }
+static void assign_bone_weights(void *context, const uint32_t job_index) {
+    const MeshConversion *conversion = context;
+    MeshJob *job = &conversion->jobs->data[job_index];
+    const struct aiMesh *mesh = job->mesh;
+    Vertex *vertices = conversion->vertices + job->vertex_offset;
 
-                // Assign bone weights to vertices
-                for (unsigned int k = 0; k < bone->mNumWeights; k++) {
-                    unsigned int vertex_id = bone->mWeights[k].mVertexId + base_index;
-                    float weight = bone->mWeights[k].mWeight;
-
-                    if (vertex_id < vertices->count) {
-                        Vertex *v = &vertices->data[vertex_id];
-                        for (int slot = 0; slot < MAX_BONE_INFLUENCE; slot++) {
-                            if (v->bone_ids[slot] < 0) {
-                                v->bone_ids[slot] = bone_index;
-                                v->bone_weights[slot] = weight;
-                                break;
-                            }
-                        }
-                    }
+    for (unsigned int j = 0; j < mesh->mNumBones; j++) {
+        const struct aiBone *bone = mesh->mBones[j];
+        const int bone_index = job->bone_indices[j];
+        if (bone_index < 0) {
+            continue;
+        }
+        for (unsigned int k = 0; k < bone->mNumWeights; k++) {
+            const unsigned int vertex_id = bone->mWeights[k].mVertexId;
+            if (vertex_id >= mesh->mNumVertices) {
+                continue;
+            }
+            Vertex *v = &vertices[vertex_id];
+            for (int slot = 0; slot < MAX_BONE_INFLUENCE; slot++) {
+                if (v->bone_ids[slot] < 0) {
+                    v->bone_ids[slot] = bone_index;
+                    v->bone_weights[slot] = bone->mWeights[k].mWeight;
+                    break;
                 }
             }
         }
+    }
 
-        // Fix for vertices not influenced by any bone
-        const char *node_name = node->mName.data;
-        int node_bone_index = -1;
-
-        for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-            uint32_t global_vertex_idx = base_index + j;
-            if (vertices->data[global_vertex_idx].bone_ids[0] < 0) {
-                if (node_bone_index == -1) {
-                    node_bone_index = bone_map_find(&skeleton->bone_map, node_name);
-                    if (node_bone_index < 0) {
-                        node_bone_index = (int)skeleton->bones.count;
-                        BoneInfo bone_info;
-                        bone_info.name = str_dup(node_name);
-                        if (!bone_info.name) {
-                            break;
-                        }
-                        glm_mat4_identity(bone_info.offset_matrix);
-                        bone_info.index = node_bone_index;
-                        ARRAY_PUSH(skeleton->bones, bone_info);
-                        bone_map_insert(&skeleton->bone_map, node_name, node_bone_index);
-                    }
-                }
+    for (unsigned int j = 0; j < mesh->mNumVertices && !job->needs_fallback; j++) {
+        job->needs_fallback = vertices[j].bone_ids[0] < 0;
+    }
+}
 
-                vertices->data[global_vertex_idx].bone_ids[0] = node_bone_index;
-                vertices->data[global_vertex_idx].bone_weights[0] = 1.0F;
-            }
+// Vertices that no bone influences follow the node holding the mesh
+static void assign_fallback_bone(void *context, const uint32_t job_index) {
+    const MeshConversion *conversion = context;
+    const MeshJob *job = &conversion->jobs->data[job_index];
+    if (job->fallback_bone < 0) {
+        return;
+    }
+    Vertex *vertices = conversion->vertices + job->vertex_offset;
+    for (unsigned int j = 0; j < job->mesh->mNumVertices; j++) {
+        if (vertices[j].bone_ids[0] < 0) {
+            vertices[j].bone_ids[0] = job->fallback_bone;
+            vertices[j].bone_weights[0] = 1.0F;
         }
+    }
+}
 
-        // Process indices
-        uint32_t index_start = (uint32_t)indices->count;
-        for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-            const struct aiFace *face = &mesh->mFaces[j];
-            for (unsigned int k = 0; k < face->mNumIndices; k++) {
-                uint32_t idx = base_index + face->mIndices[k];
-                ARRAY_PUSH(*indices, idx);
+static void free_mesh_jobs(MeshJobArray *jobs) {
+    for (size_t i = 0; i < jobs->count; i++) {
+        free(jobs->data[i].bone_indices);
+    }
+    ARRAY_FREE(*jobs);
+}
+
+// Fills the mesh's vertices, indices and submeshes (and, for animated models, the skeleton
+// bones they reference) from every triangle mesh in the scene.
+static bool convert_scene_meshes(const struct aiScene *scene, Mesh *out, bool *out_has_uvs,
+                                 const bool flip_uv_y, const unsigned int uv_channel) {
+    MeshJobArray jobs;
+    ARRAY_INIT(jobs);
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+    mat4 identity;
+    glm_mat4_identity(identity);
+    if (!collect_mesh_jobs(scene->mRootNode, scene, identity, &jobs, &vertex_count,
+                           &index_count, out, out_has_uvs, uv_channel)) {
+        free_mesh_jobs(&jobs);
+        return false;
+    }
+
+    MeshConversion conversion = {.jobs = &jobs,
+                                 .animated = out->has_animations,
+                                 .flip_uv_y = flip_uv_y,
+                                 .uv_channel = uv_channel};
+    ARRAY_INIT(conversion.chunk_jobs);
+    for (size_t i = 0; i < jobs.count; i++) {
+        MeshJob *job = &jobs.data[i];
+        unsigned int items = job->mesh->mNumVertices;
+        if (job->triangles_only && job->mesh->mNumFaces > items) {
+            items = job->mesh->mNumFaces;
+        }
+        const uint32_t chunks = items > CONVERSION_CHUNK_SIZE
+                                    ? (items + CONVERSION_CHUNK_SIZE - 1) / CONVERSION_CHUNK_SIZE
+                                    : 1;
+        job->first_chunk = (uint32_t)conversion.chunk_jobs.count;
+        for (uint32_t c = 0; c < chunks; c++) {
+            ARRAY_PUSH(conversion.chunk_jobs, (uint32_t)i);
+        }
+    }
+    if (vertex_count > 0) {
+        ARRAY_RESERVE(out->vertices, vertex_count);
+    }
+    if (index_count > 0) {
+        ARRAY_RESERVE(out->indices, index_count);
+    }
+    out->vertices.count = vertex_count;
+    out->indices.count = index_count;
+    conversion.vertices = out->vertices.data;
+    conversion.indices = out->indices.data;
+
+    // The calling thread takes part, so one fewer worker than cores
+    const unsigned int cpu_count = dcat_cpu_count();
+    const uint32_t threads =
+        vertex_count >= CONVERSION_PARALLEL_MIN_VERTICES && cpu_count > 1 ? cpu_count - 1 : 0;
+    // A pool that failed to start has no threads, and worker_pool_run then runs serially
+    WorkerPool pool;
+    const bool pool_started = worker_pool_init(&pool, threads);
+    worker_pool_run(&pool, (uint32_t)conversion.chunk_jobs.count, convert_chunk, &conversion);
+
+    if (out->has_animations) {
+        worker_pool_run(&pool, (uint32_t)jobs.count, assign_bone_weights, &conversion);
+        // New bones go into the shared skeleton, so this part stays in node order
+        for (size_t i = 0; i < jobs.count; i++) {
+            if (jobs.data[i].needs_fallback) {
+                jobs.data[i].fallback_bone =
+                    register_bone(&out->skeleton, jobs.data[i].node->mName.data, NULL);
             }
         }
-
-        SubMesh submesh;
-        submesh.index_offset = index_start;
-        submesh.index_count = (uint32_t)indices->count - index_start;
-        submesh.material_index = mesh->mMaterialIndex;
-        ARRAY_PUSH(*submeshes, submesh);
+        worker_pool_run(&pool, (uint32_t)jobs.count, assign_fallback_bone, &conversion);
     }
 
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        process_node_animated(node->mChildren[i], scene, vertices, indices, submeshes, out_has_uvs,
-                              skeleton, flip_uv_y, uv_channel);
+    if (pool_started) {
+        worker_pool_destroy(&pool);
     }
+    ARRAY_FREE(conversion.chunk_jobs);
+    free_mesh_jobs(&jobs);
+    return true;
 }
 
 // Build bone hierarchy
@@ -416,41 +653,9 @@ static void build_bone_hierarchy(const struct aiNode *root, Skeleton *skeleton)
         if (!bone_node.name) {
             break;
         }
-        ai_matrix_to_glm(&node->mTransformation, bone_node.transformation);
-
-        // Decompose transform for fallback
-        glm_vec3_copy((vec3){bone_node.transformation[3][0], bone_node.transformation[3][1],
-                             bone_node.transformation[3][2]},
-                      bone_node.initial_position);
-
-        // Scale
-        bone_node.initial_scale[0] =
-            glm_vec3_norm((vec3){bone_node.transformation[0][0], bone_node.transformation[0][1],
-                                 bone_node.transformation[0][2]});
-        bone_node.initial_scale[1] =
-            glm_vec3_norm((vec3){bone_node.transformation[1][0], bone_node.transformation[1][1],
-                                 bone_node.transformation[1][2]});
-        bone_node.initial_scale[2] =
-            glm_vec3_norm((vec3){bone_node.transformation[2][0], bone_node.transformation[2][1],
-                                 bone_node.transformation[2][2]});
-
-        // Rotation (from normalized matrix columns)
-        if (bone_node.initial_scale[0] > 0.0001F && bone_node.initial_scale[1] > 0.0001F &&
-            bone_node.initial_scale[2] > 0.0001F) {
-            mat3 rot_m;
-            rot_m[0][0] = bone_node.transformation[0][0] / bone_node.initial_scale[0];
-            rot_m[0][1] = bone_node.transformation[0][1] / bone_node.initial_scale[0];
-            rot_m[0][2] = bone_node.transformation[0][2] / bone_node.initial_scale[0];
-            rot_m[1][0] = bone_node.transformation[1][0] / bone_node.initial_scale[1];
-            rot_m[1][1] = bone_node.transformation[1][1] / bone_node.initial_scale[1];
-            rot_m[1][2] = bone_node.transformation[1][2] / bone_node.initial_scale[1];
-            rot_m[2][0] = bone_node.transformation[2][0] / bone_node.initial_scale[2];
-            rot_m[2][1] = bone_node.transformation[2][1] / bone_node.initial_scale[2];
-            rot_m[2][2] = bone_node.transformation[2][2] / bone_node.initial_scale[2];
-            glm_mat3_quat(rot_m, bone_node.initial_rotation);
-        } else {
-            glm_quat_identity(bone_node.initial_rotation);
-        }
+        mat4 transformation;
+        ai_matrix_to_glm(&node->mTransformation, transformation);
+        bone_node_set_transform(&bone_node, transformation);
 
         bone_node.parent_index = parent_idx;
         ARRAY_INIT(bone_node.child_indices);
@@ -700,8 +905,31 @@ static void extract_embedded_texture(const struct aiScene *scene, MaterialInfo *
     }
 }
 
-bool load_model(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **out_materials,
-                size_t *out_material_count) {
+// Compressed tracks in place of the keys, which the cache has stored by now; fixed-rate tracks
+// when --animation-rate asks for them, and baked poses when the GPU is to sample them
+static void prepare_animations(Mesh *mesh) {
+    if (!mesh->has_animations) {
+        return;
+    }
+    for (size_t i = 0; i < mesh->animations.count; i++) {
+        animation_compress(&mesh->animations.data[i]);
+    }
+    const float rate = animation_get_resample_rate();
+    if (rate > 0.0F) {
+        for (size_t i = 0; i < mesh->animations.count; i++) {
+            animation_resample(&mesh->animations.data[i], rate);
+        }
+    }
+    const float bake_rate = animation_get_bake_rate();
+    if (bake_rate > 0.0F &&
+        !animation_bake_poses(&mesh->skeleton, &mesh->animations, bake_rate, &mesh->baked_poses)) {
+        fprintf(stderr, "Animations not baked for the GPU; posing them on the CPU\n");
+    }
+}
+
+// Reads any format Assimp knows into `mesh` and its materials
+static bool import_model(const char *path, Mesh *mesh, bool *out_has_uvs,
+                         MaterialInfo **out_materials, size_t *out_material_count) {
     const struct aiScene *scene = aiImportFile(
         path, aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_CalcTangentSpace |
                   aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
@@ -741,7 +969,6 @@ bool load_model(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **
     *out_has_uvs = false;
     mesh_free(mesh);
     mesh_init(mesh);
-    mesh->generation = 1;
     glm_mat4_copy(coordinate_conversion, mesh->coordinate_system_transform);
 
     // Determine which UV channel the diffuse texture uses (pre-pass over materials).
@@ -768,24 +995,26 @@ bool load_model(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **
         bone_map_init(&mesh->skeleton.bone_map);
         ARRAY_INIT(mesh->skeleton.bones);
         ARRAY_INIT(mesh->skeleton.bone_hierarchy);
+    }
+    if (!convert_scene_meshes(scene, mesh, out_has_uvs, flip_uv_y, uv_channel)) {
+        aiReleaseImport(scene);
+        mesh_free(mesh);
+        return false;
+    }
 
-        process_node_animated(scene->mRootNode, scene, &mesh->vertices, &mesh->indices,
-                              &mesh->submeshes, out_has_uvs, &mesh->skeleton, flip_uv_y,
-                              uv_channel);
+    if (mesh->has_animations) {
         build_bone_hierarchy(scene->mRootNode, &mesh->skeleton);
+        if (!skeleton_flatten(&mesh->skeleton)) {
+            fprintf(stderr, "Failed to allocate skeleton evaluation order\n");
+            aiReleaseImport(scene);
+            mesh_free(mesh);
+            return false;
+        }
         load_animations(scene, &mesh->animations);
 
         // Pre-compute bone mappings for each animation
         for (size_t i = 0; i < mesh->animations.count; i++) {
-            Animation *anim = &mesh->animations.data[i];
-            anim->bone_node_to_anim = malloc(mesh->skeleton.bone_hierarchy.count * sizeof(int));
-            if (anim->bone_node_to_anim) {
-                for (size_t j = 0; j < mesh->skeleton.bone_hierarchy.count; j++) {
-                    const char *node_name = mesh->skeleton.bone_hierarchy.data[j].name;
-                    anim->bone_node_to_anim[j] =
-                        bone_anim_map_find(&anim->bone_anim_map, node_name);
-                }
-            }
+            animation_bind_skeleton(&mesh->animations.data[i], &mesh->skeleton);
         }
 
         // Skinned-mesh skinning is evaluated in scene space: per the glTF spec the
@@ -798,11 +1027,6 @@ bool load_model(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **
         // Sketchfab/FBX-derived assets store there), tipping the whole model over. This
         // also matches the non-animated path, which bakes the entire node chain.
         glm_mat4_identity(mesh->skeleton.global_inverse_transform);
-    } else {
-        mat4 identity;
-        glm_mat4_identity(identity);
-        process_node(scene->mRootNode, scene, identity, &mesh->vertices, &mesh->indices,
-                     &mesh->submeshes, out_has_uvs, flip_uv_y, uv_channel);
     }
 
     // Extract all materials
@@ -935,19 +1159,54 @@ bool load_model(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **
         extract_embedded_texture(scene, &mats[i], false);
     }
 
+    *out_materials = mats;
+    *out_material_count = mat_count;
+    aiReleaseImport(scene);
+    return true;
+}
+
+bool load_model(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **out_materials,
+                size_t *out_material_count) {
+    // A hit skips the import, normal/tangent generation and LOD building entirely
+    MeshCacheKey cache_key;
+    const bool cacheable = mesh_cache_key(path, NULL, &cache_key);
+    if (cacheable &&
+        mesh_cache_load(&cache_key, path, mesh, out_has_uvs, out_materials, out_material_count)) {
+        prepare_animations(mesh);
+        return true;
+    }
+
+    // Binary glTF, most of what gets viewed, is read directly; anything it does not cover
+    // goes through Assimp
+    MaterialInfo *mats = NULL;
+    size_t mat_count = 0;
+    if (!gltf_load_glb(path, mesh, out_has_uvs, &mats, &mat_count) &&
+        !import_model(path, mesh, out_has_uvs, &mats, &mat_count)) {
+        return false;
+    }
+    mesh->generation = 1;
+
     if (mesh->vertices.count == 0) {
         materials_free(mats, mat_count);
         *out_materials = NULL;
         *out_material_count = 0;
         mesh_free(mesh);
-        aiReleaseImport(scene);
         return false;
     }
 
+    mesh_build_lods(mesh);
+
+    // Before the store, so cached entries come back already optimized. Meshlets follow the
+    // optimized triangle order, which keeps neighbouring triangles together.
+    mesh_optimize(mesh, mats, mat_count);
+    mesh_build_meshlets(mesh);
+
     *out_materials = mats;
     *out_material_count = mat_count;
 
-    aiReleaseImport(scene);
-
+    if (cacheable) {
+        mesh_cache_store(&cache_key, path, mesh, *out_has_uvs, mats, mat_count);
+    }
+    prepare_animations(mesh);
     return true;
 }
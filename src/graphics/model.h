@@ -2,18 +2,40 @@
 #include "../core/types.h"
 #include "animation.h"
 
+// The vertices and indices a reload changed, when it kept their counts (mesh_edit_diff). A
+// renderer still holding generation `base_generation` re-uploads only these ranges; 0 there
+// means the whole mesh is new.
+typedef struct MeshEdit {
+    uint64_t base_generation;
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+} MeshEdit;
+
 // Mesh structure with geometry, animation, and coordinate system data
 typedef struct Mesh {
     VertexArray vertices;
     Uint32Array indices;
     SubMeshArray submeshes;
+    // Clusters of each sub-mesh's full-detail triangles, in sub-mesh order
+    MeshletArray meshlets;
     uint64_t generation;
+    MeshEdit edit;
 
     bool has_animations;
     Skeleton skeleton;
     AnimationArray animations;
+    // Filled at load when animation_set_bake_rate is on; empty otherwise
+    BakedPoses baked_poses;
 
     mat4 coordinate_system_transform;
+
+    // Set by mesh_release_geometry: vertices and indices keep their counts but not their
+    // data, and these bounds stand in for the positions
+    bool geometry_released;
+    vec3 bounds_min;
+    vec3 bounds_max;
 } Mesh;
 
 // Initialize mesh to empty state
@@ -25,11 +47,32 @@ void mesh_free(Mesh *mesh);
 // Calculate optimal camera setup for viewing the model
 void calculate_camera_setup(const VertexArray *vertices, CameraSetup *setup);
 
-// Load 3D model from file using Assimp
+// calculate_camera_setup for a box of positions
+void calculate_camera_setup_from_bounds(const vec3 bounds_min, const vec3 bounds_max,
+                                        CameraSetup *setup);
+
+// calculate_camera_setup for a mesh whose geometry may have been released
+void mesh_camera_setup(const Mesh *mesh, CameraSetup *setup);
+
+// Box around the mesh's positions, before any skinning; false when it has no vertices
+bool mesh_bounds(const Mesh *mesh, vec3 out_min, vec3 out_max);
+
+// Frees the vertex and index data once the GPU has its own copy, keeping their counts and
+// the position bounds. Submeshes, skeleton and animations stay.
+void mesh_release_geometry(Mesh *mesh);
+
+// Brings released geometry back from the mesh cache entry of `source_path`. Fails when
+// there is no entry or it no longer matches the mesh.
+bool mesh_restore_geometry(Mesh *mesh, const char *source_path);
+
+// Load 3D model from file: binary glTF directly (gltf_load_glb), everything else, and
+// whatever glTF that loader turns down, through Assimp
 bool load_model(const char *path, Mesh *mesh, bool *out_has_uvs, MaterialInfo **out_materials,
                 size_t *out_material_count);
 
 // Material info management
 void material_info_init(MaterialInfo *info);
 void material_info_free(MaterialInfo *info);
+// Deep copy, with its own paths and embedded bytes; false (and *out empty) when out of memory
+bool material_info_copy(const MaterialInfo *source, MaterialInfo *out);
 void materials_free(MaterialInfo *materials, size_t count);
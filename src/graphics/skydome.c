@@ -1,71 +1,38 @@
 #include "skydome.h"
-#include <math.h>
-
-void generate_skydome(Mesh *mesh, float radius, int segments, int rings) {
-    mesh_init(mesh);
-
-    // Generate vertices
-    for (int ring = 0; ring <= rings; ring++) {
-        const float phi = GLM_PI * (float)ring / (float)rings;
-        const float y = radius * cosf(phi);
-        const float ring_radius = radius * sinf(phi);
-
-        for (int seg = 0; seg <= segments; seg++) {
-            const float theta = 2.0F * (float)GLM_PI * (float)seg / (float)segments;
-            const float x = ring_radius * cosf(theta);
-            const float z = ring_radius * sinf(theta);
-
-            Vertex vertex = {0};
-
-            vertex.position[0] = x;
-            vertex.position[1] = y;
-            vertex.position[2] = z;
-
-            // Inverted normals (pointing inward)
-            const float len = sqrtf((x * x) + (y * y) + (z * z));
-            if (len > 0.0001F) {
-                vertex.normal[0] = -x / len;
-                vertex.normal[1] = -y / len;
-                vertex.normal[2] = -z / len;
-            }
 
-            // UV coordinates
-            vertex.texcoord[0] = (float)seg / (float)segments;
-            vertex.texcoord[1] = (float)ring / (float)rings;
-
-            // Default tangent space
-            vertex.tangent[0] = 1.0F;
-            vertex.bitangent[1] = 1.0F;
+#include <cglm/cglm.h>
+#include <math.h>
 
-            // No bones
-            vertex.bone_ids[0] = -1;
-            vertex.bone_ids[1] = -1;
-            vertex.bone_ids[2] = -1;
-            vertex.bone_ids[3] = -1;
+// Smallest panorama size worth the resample
+#define SKYDOME_MIN_SIZE 64U
 
-            ARRAY_PUSH(mesh->vertices, vertex);
-        }
+uint32_t skydome_size_for_output(const uint32_t height, const float fov_y) {
+    // Pixels per radian at the centre of the view, around the full circle
+    const float pixels_per_radian = (0.5F * (float)height) / tanf(0.5F * fov_y);
+    const float size = ceilf(2.0F * (float)GLM_PI * pixels_per_radian);
+    if (!(size > (float)SKYDOME_MIN_SIZE)) {
+        return SKYDOME_MIN_SIZE;
     }
+    return size < (float)UINT32_MAX ? (uint32_t)size : UINT32_MAX;
+}
 
-    // Generate indices (inverted winding for inside rendering)
-    for (int ring = 0; ring < rings; ring++) {
-        for (int seg = 0; seg < segments; seg++) {
-            const uint32_t current = (ring * (segments + 1)) + seg;
-            const uint32_t next = current + segments + 1;
-
-            // Triangle 1 (inverted winding)
-            ARRAY_PUSH(mesh->indices, current);
-            ARRAY_PUSH(mesh->indices, current + 1);
-            ARRAY_PUSH(mesh->indices, next);
+void skydome_ray_matrix(mat4 view, mat4 projection, mat4 out) {
+    mat4 rotation;
+    glm_mat4_copy(view, rotation);
+    rotation[3][0] = rotation[3][1] = rotation[3][2] = 0.0F;
+    mat4 view_projection;
+    glm_mat4_mul(projection, rotation, view_projection);
+    glm_mat4_inv(view_projection, out);
+}
 
-            // Triangle 2 (inverted winding)
-            ARRAY_PUSH(mesh->indices, next);
-            ARRAY_PUSH(mesh->indices, current + 1);
-            ARRAY_PUSH(mesh->indices, next + 1);
-        }
+void skydome_direction_uv(const vec3 direction, float uv[2]) {
+    const float length = glm_vec3_norm((float *)direction);
+    if (!(length > 0.0F)) {
+        uv[0] = 0.0F;
+        uv[1] = 0.5F;
+        return;
     }
-
-    mesh->has_animations = false;
-    glm_mat4_identity(mesh->coordinate_system_transform);
-    mesh->generation = 1;
+    const float u = atan2f(direction[2], direction[0]) / (2.0F * (float)GLM_PI);
+    uv[0] = u - floorf(u);
+    uv[1] = acosf(glm_clamp(direction[1] / length, -1.0F, 1.0F)) / (float)GLM_PI;
 }
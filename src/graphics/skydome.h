@@ -1,5 +1,19 @@
 #pragma once
-#include "model.h"
+#include <cglm/types.h>
+#include <stdint.h>
 
-// Generate a skydome mesh (inverted sphere)
-void generate_skydome(Mesh *mesh, float radius, int segments, int rings);
+// The skydome is an equirectangular panorama drawn behind the scene by unprojecting every
+// output pixel to a view ray and looking the ray up in the panorama (skydome.frag).
+
+// Width of a panorama with about one texel per output pixel at the centre of a view
+// `height` pixels tall with vertical field of view `fov_y` radians. Larger panoramas only
+// cost memory and alias, as they are sampled without mips.
+uint32_t skydome_size_for_output(uint32_t height, float fov_y);
+
+// Unprojects normalized device coordinates on the far plane to view rays: the inverse of
+// the view-projection without the camera's position, so the sky turns with the camera but
+// never comes closer
+void skydome_ray_matrix(mat4 view, mat4 projection, mat4 out);
+
+// Panorama coordinates of `direction`: u turns around +y starting at +x, v runs from +y down
+void skydome_direction_uv(const vec3 direction, float uv[2]);
@@ -1,4 +1,6 @@
 #include "texture.h"
+#include "ktx2.h"
+#include "platform/io.h"
 
 #include <vips/vips.h>
 
@@ -6,12 +8,76 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Keeps tiny outputs from shrinking textures below what a zoomed-in view still resolves
+#define TEXTURE_MIN_BUDGET 256U
+#define TEXTURE_MAX_BUDGET 16384U
+
+static uint32_t g_max_size = 0;
+static uint32_t g_gpu_formats = 0;
+
+void texture_set_max_size(const uint32_t max_size) {
+    g_max_size = max_size;
+}
+
+uint32_t texture_get_max_size(void) {
+    return g_max_size;
+}
+
+void texture_set_gpu_formats(const uint32_t formats) {
+    g_gpu_formats = formats;
+}
+
+bool texture_gpu_supports(const TextureFormat format) {
+    return format == TEXTURE_FORMAT_RGBA8 || (g_gpu_formats & TEXTURE_FORMAT_BIT(format)) != 0;
+}
+
+size_t texture_level_size(const TextureFormat format, const uint32_t width,
+                          const uint32_t height) {
+    if (format == TEXTURE_FORMAT_RGBA8) {
+        return (size_t)width * height * 4U;
+    }
+    return (size_t)((width + 3U) / 4U) * ((height + 3U) / 4U) * 16U;
+}
+
+uint32_t texture_max_size_for_output(const uint32_t width, const uint32_t height) {
+    const uint32_t wanted = 2U * (width > height ? width : height);
+    uint32_t budget = TEXTURE_MIN_BUDGET;
+    while (budget < wanted && budget < TEXTURE_MAX_BUDGET) {
+        budget *= 2U;
+    }
+    return budget;
+}
+
+static bool exceeds_size(VipsImage *image, const uint32_t max_size) {
+    return max_size > 0 && ((uint32_t)vips_image_get_width(image) > max_size ||
+                            (uint32_t)vips_image_get_height(image) > max_size);
+}
+
+// Eight bytes at a time: the AND of every word keeps its alpha bytes at 0xFF only while
+// every texel is opaque. Checked every 4 KiB, so a transparent texel ends the scan early.
 static bool texture_data_has_transparency(const uint8_t *data, size_t data_size) {
     if (!data || data_size < 4) {
         return false;
     }
+    static const uint8_t alpha_pattern[8] = {0, 0, 0, 0xFF, 0, 0, 0, 0xFF};
+    uint64_t alpha_mask;
+    memcpy(&alpha_mask, alpha_pattern, sizeof(alpha_mask));
 
-    for (size_t i = 3; i < data_size; i += 4) {
+    size_t i = 0;
+    const size_t words_end = data_size & ~(size_t)7U;
+    while (i < words_end) {
+        const size_t chunk_end = words_end - i > 4096U ? i + 4096U : words_end;
+        uint64_t all = UINT64_MAX;
+        for (; i < chunk_end; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            all &= word;
+        }
+        if ((all & alpha_mask) != alpha_mask) {
+            return true;
+        }
+    }
+    for (i += 3; i < data_size; i += 4) {
         if (data[i] < 255) {
             return true;
         }
@@ -24,6 +90,9 @@ void texture_init_default(Texture *tex) {
     tex->height = 1;
     tex->data_size = 4;
     tex->has_transparency = false;
+    tex->format = TEXTURE_FORMAT_RGBA8;
+    tex->mip_levels = 1;
+    tex->refs = NULL;
     tex->data = malloc(4);
     if (tex->data) {
         tex->data[0] = 127; // R
@@ -38,6 +107,9 @@ void texture_create_flat_normal_map(Texture *tex) {
     tex->height = 1;
     tex->data_size = 4;
     tex->has_transparency = false;
+    tex->format = TEXTURE_FORMAT_RGBA8;
+    tex->mip_levels = 1;
+    tex->refs = NULL;
     tex->data = malloc(4);
     if (tex->data) {
         tex->data[0] = 127; // R (neutral X)
@@ -47,6 +119,30 @@ void texture_create_flat_normal_map(Texture *tex) {
     }
 }
 
+// Where vips_sink_disc delivers the decoded rows, in order and one strip at a time
+typedef struct DecodeTarget {
+    uint8_t *pixels;
+    size_t row_bytes;
+    bool has_transparency;
+} DecodeTarget;
+
+// Copies a finished strip into the texture while it is still in cache, scanning the same
+// rows for alpha
+static int write_decoded_rows(VipsRegion *region, VipsRect *area, void *a) {
+    DecodeTarget *target = a;
+    const size_t bytes = (size_t)area->width * 4U;
+    for (int y = 0; y < area->height; y++) {
+        const uint8_t *row = (const uint8_t *)VIPS_REGION_ADDR(region, area->left, area->top + y);
+        memcpy(target->pixels + (size_t)(area->top + y) * target->row_bytes +
+                   (size_t)area->left * 4U,
+               row, bytes);
+        if (!target->has_transparency) {
+            target->has_transparency = texture_data_has_transparency(row, bytes);
+        }
+    }
+    return 0;
+}
+
 static bool texture_from_vips(Texture *tex, VipsImage *image) {
     VipsImage *srgb = NULL;
     VipsImage *rgba = NULL;
@@ -64,22 +160,38 @@ static bool texture_from_vips(Texture *tex, VipsImage *image) {
     } else {
         rgba = srgb;
     }
+    if (vips_image_get_format(rgba) != VIPS_FORMAT_UCHAR) {
+        VipsImage *cast = NULL;
+        const int failed = vips_cast_uchar(rgba, &cast, NULL);
+        g_object_unref(rgba);
+        if (failed) {
+            return false;
+        }
+        rgba = cast;
+    }
 
-    size_t buf_size;
-    void *buf = vips_image_write_to_memory(rgba, &buf_size);
+    // The pipeline runs straight into the texture's buffer, instead of into a vips-owned
+    // one that would then be copied
     bool ok = false;
-
-    if (buf) {
-        tex->width = (uint32_t)vips_image_get_width(rgba);
-        tex->height = (uint32_t)vips_image_get_height(rgba);
-        tex->data_size = buf_size;
-        tex->data = malloc(buf_size);
-        if (tex->data) {
-            memcpy(tex->data, buf, buf_size);
-            tex->has_transparency = texture_data_has_transparency(tex->data, buf_size);
-            ok = true;
-        }
-        g_free(buf);
+    const uint32_t width = (uint32_t)vips_image_get_width(rgba);
+    const uint32_t height = (uint32_t)vips_image_get_height(rgba);
+    const size_t size = (size_t)width * height * 4U;
+    DecodeTarget target = {.row_bytes = (size_t)width * 4U};
+    if (vips_image_get_bands(rgba) == 4 && size > 0) {
+        target.pixels = malloc(size);
+    }
+    if (target.pixels && vips_sink_disc(rgba, write_decoded_rows, &target) == 0) {
+        tex->width = width;
+        tex->height = height;
+        tex->data_size = size;
+        tex->format = TEXTURE_FORMAT_RGBA8;
+        tex->mip_levels = 1;
+        tex->refs = NULL;
+        tex->data = target.pixels;
+        tex->has_transparency = target.has_transparency;
+        ok = true;
+    } else {
+        free(target.pixels);
     }
 
     g_object_unref(rgba);
@@ -87,7 +199,42 @@ static bool texture_from_vips(Texture *tex, VipsImage *image) {
 }
 
 bool texture_from_file(Texture *tex, const char *path) {
+    return texture_from_file_sized(tex, path, g_max_size);
+}
+
+static bool has_ktx2_extension(const char *path) {
+    const size_t length = strlen(path);
+    return length >= 5 && (strcmp(path + length - 5, ".ktx2") == 0 ||
+                           strcmp(path + length - 5, ".KTX2") == 0);
+}
+
+bool texture_from_file_sized(Texture *tex, const char *path, const uint32_t max_size) {
+    // vips has no KTX2 loader; those files already hold GPU blocks and their mips
+    if (has_ktx2_extension(path)) {
+        size_t size = 0;
+        const void *data = dcat_map_file(path, &size);
+        const bool ok = data && texture_from_ktx2(tex, data, size, max_size);
+        if (data) {
+            dcat_unmap_file(data, size);
+        }
+        if (!ok) {
+            fprintf(stderr, "Warning: Failed to load texture (%s), using gray\n", path);
+            texture_init_default(tex);
+        }
+        return ok;
+    }
+
+    // Opening only reads the header, so the size check is cheap. Oversized images are
+    // reopened through thumbnail, which shrinks on load (JPEG DCT scaling, WebP and
+    // pyramid levels) instead of decoding every pixel first.
     VipsImage *image = vips_image_new_from_file(path, NULL);
+    if (image && exceeds_size(image, max_size)) {
+        g_object_unref(image);
+        image = NULL;
+        if (vips_thumbnail(path, &image, (int)max_size, "size", VIPS_SIZE_DOWN, NULL)) {
+            image = NULL;
+        }
+    }
 
     if (!image) {
         fprintf(stderr, "Warning: Failed to load texture (%s), using gray\n", path);
@@ -107,7 +254,24 @@ bool texture_from_file(Texture *tex, const char *path) {
 }
 
 bool texture_from_memory(Texture *tex, const unsigned char *buffer, size_t size) {
+    if (ktx2_is_file(buffer, size)) {
+        if (texture_from_ktx2(tex, buffer, size, g_max_size)) {
+            return true;
+        }
+        fprintf(stderr, "Warning: Failed to load texture from memory, using gray\n");
+        texture_init_default(tex);
+        return false;
+    }
+
     VipsImage *image = vips_image_new_from_buffer(buffer, size, "", NULL);
+    if (image && exceeds_size(image, g_max_size)) {
+        g_object_unref(image);
+        image = NULL;
+        if (vips_thumbnail_buffer((void *)buffer, size, &image, (int)g_max_size, "size",
+                                  VIPS_SIZE_DOWN, NULL)) {
+            image = NULL;
+        }
+    }
 
     if (!image) {
         fprintf(stderr, "Warning: Failed to load texture from memory, using gray\n");
@@ -126,17 +290,67 @@ bool texture_from_memory(Texture *tex, const unsigned char *buffer, size_t size)
     return true;
 }
 
+void texture_share(Texture *source, Texture *out) {
+    *out = *source;
+    if (!source->data) {
+        return;
+    }
+    if (!source->refs) {
+        source->refs = malloc(sizeof(atomic_uint));
+        if (!source->refs) {
+            // Without a count the only safe fallback is a private copy
+            out->data = malloc(source->data_size);
+            if (!out->data) {
+                texture_init_default(out);
+                return;
+            }
+            memcpy(out->data, source->data, source->data_size);
+            out->refs = NULL;
+            return;
+        }
+        atomic_init(source->refs, 1U);
+    }
+    atomic_fetch_add_explicit(source->refs, 1U, memory_order_relaxed);
+    out->refs = source->refs;
+}
+
 void texture_free(Texture *tex) {
-    free(tex->data);
+    // The last owner to let go frees; acq_rel orders every other owner's reads before it
+    if (!tex->refs || atomic_fetch_sub_explicit(tex->refs, 1U, memory_order_acq_rel) == 1U) {
+        free(tex->data);
+        free(tex->refs);
+    }
+    tex->refs = NULL;
     tex->data = NULL;
     tex->width = 0;
     tex->height = 0;
     tex->data_size = 0;
+    tex->format = TEXTURE_FORMAT_RGBA8;
+    tex->mip_levels = 0;
     tex->has_transparency = false;
+    tex->released = false;
+}
+
+void texture_release_pixels(Texture *tex) {
+    if (!tex->data) {
+        return;
+    }
+    const Texture image = *tex;
+    texture_free(tex);
+    tex->width = image.width;
+    tex->height = image.height;
+    tex->format = image.format;
+    tex->mip_levels = image.mip_levels;
+    tex->has_transparency = image.has_transparency;
+    tex->released = true;
+}
+
+bool texture_has_image(const Texture *tex) {
+    return (tex && (tex->data || tex->released) && tex->width > 0 && tex->height > 0) != 0;
 }
 
 void texture_update_transparency(Texture *tex) {
-    if (!tex) {
+    if (!tex || tex->format != TEXTURE_FORMAT_RGBA8) {
         return;
     }
     tex->has_transparency = texture_data_has_transparency(tex->data, tex->data_size);
@@ -1,14 +1,36 @@
 #pragma once
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+// Layout of Texture::data. The block formats store 4x4 texel blocks of 16 bytes each.
+typedef enum TextureFormat {
+    TEXTURE_FORMAT_RGBA8,
+    TEXTURE_FORMAT_BC7,
+    // Normal map X and Y only; sampling rebuilds Z
+    TEXTURE_FORMAT_BC5,
+    TEXTURE_FORMAT_ETC2_RGBA8,
+    TEXTURE_FORMAT_ASTC_4X4,
+    TEXTURE_FORMAT_COUNT
+} TextureFormat;
+
+#define TEXTURE_FORMAT_BIT(format) (1U << (format))
+
 typedef struct Texture {
     uint32_t width;
     uint32_t height;
-    uint8_t *data; // RGBA, 4 bytes per pixel
+    uint8_t *data; // Every mip level in `format`, largest first; RGBA8 is 4 bytes per pixel
     size_t data_size;
+    TextureFormat format;
+    // Levels in `data`; 0 and 1 both mean only the full-size one
+    uint32_t mip_levels;
     bool has_transparency;
+    // Owners of `data` once texture_share has handed it out; NULL while there is only one
+    atomic_uint *refs;
+    // Set by texture_release_pixels: `data` is gone, and only the GPU image made from it
+    // remains. Size, format and transparency still describe that image.
+    bool released;
 } Texture;
 
 // Initialize to a default 1x1 gray texture
@@ -17,14 +39,49 @@ void texture_init_default(Texture *tex);
 // Create a flat normal map (blue pointing up)
 void texture_create_flat_normal_map(Texture *tex);
 
-// Load texture from file
+// Longest edge texture_from_file and texture_from_memory decode to; larger images are
+// shrunk while loading. 0, the default, keeps every image at full size. Set it before any
+// loading thread starts.
+void texture_set_max_size(uint32_t max_size);
+uint32_t texture_get_max_size(void);
+
+// TEXTURE_FORMAT_BIT set of the block formats the renderer can sample, which decoders may
+// then produce or pass through; RGBA8 is always allowed. Set it before any loading thread
+// starts.
+void texture_set_gpu_formats(uint32_t formats);
+bool texture_gpu_supports(TextureFormat format);
+
+// Bytes of one mip level
+size_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height);
+
+// Budget for textures drawn into a width x height output: twice the longer edge, so a
+// texture filling the view still has a texel per pixel when zoomed in, rounded up to a
+// power of two
+uint32_t texture_max_size_for_output(uint32_t width, uint32_t height);
+
+// Load texture from file. Images go through vips; .ktx2 files keep their GPU format and
+// mip chain (ktx2.h).
 bool texture_from_file(Texture *tex, const char *path);
 
-// Load texture from memory buffer
+// texture_from_file with its own size limit in place of the global one; 0 for full size
+bool texture_from_file_sized(Texture *tex, const char *path, uint32_t max_size);
+
+// Load texture from memory buffer; KTX2 data is recognised by its identifier
 bool texture_from_memory(Texture *tex, const unsigned char *buffer, size_t size);
 
+// Makes `out` another owner of `source`'s pixels instead of copying them. Either may be
+// freed first; the pixels go with the last texture_free. Pixels must not be written once
+// they are shared.
+void texture_share(Texture *source, Texture *out);
+
 // Free texture data
 void texture_free(Texture *tex);
 
-// Recompute has_transparency from RGBA pixel data.
+// Drops this texture's hold on its pixels once the renderer has uploaded them
+void texture_release_pixels(Texture *tex);
+
+// True while the texture has an image, in `data` or, once released, only on the GPU
+bool texture_has_image(const Texture *tex);
+
+// Recompute has_transparency from RGBA pixel data; block formats keep theirs.
 void texture_update_transparency(Texture *tex);
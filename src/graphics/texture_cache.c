@@ -0,0 +1,151 @@
+#include "texture_cache.h"
+#include "core/hash.h"
+#include "platform/io.h"
+#include "platform/path.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The header, then every mip level as Texture::data holds them
+#define TEXTURE_CACHE_MAGIC "DCATTEX1"
+#define TEXTURE_CACHE_VERSION 1U
+
+#define TEXTURE_CACHE_NORMAL_MAP 0x1U
+#define TEXTURE_CACHE_TRANSPARENT 0x2U
+
+typedef struct TextureCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint32_t max_size;
+    uint32_t flags;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_levels;
+    uint32_t reserved;
+    uint64_t data_size;
+} TextureCacheHeader;
+
+// Keeps the temp files of threads storing the same entry apart
+static atomic_uint g_store_sequence;
+
+bool texture_cache_key(const uint8_t *source, const size_t source_size,
+                       const TextureFormat format, const uint32_t max_size, const bool normal_map,
+                       const char *cache_directory, TextureCacheKey *out) {
+    memset(out, 0, sizeof(*out));
+    char default_directory[400];
+    if (!cache_directory) {
+        if (!dcat_get_cache_directory(default_directory, sizeof(default_directory))) {
+            return false;
+        }
+        cache_directory = default_directory;
+    }
+    out->source_hash = dcat_hash_bytes(source, source_size);
+    out->source_size = source_size;
+    out->format = format;
+    out->max_size = max_size;
+    out->normal_map = normal_map;
+    const int len = snprintf(out->cache_path, sizeof(out->cache_path),
+                             "%stex-%016llx-%u%s-%u.bin", cache_directory,
+                             (unsigned long long)out->source_hash, (unsigned)format,
+                             normal_map ? "n" : "", (unsigned)max_size);
+    return len > 0 && (size_t)len < sizeof(out->cache_path);
+}
+
+bool texture_cache_key_file(const char *source_path, const TextureFormat format,
+                            const uint32_t max_size, const bool normal_map,
+                            const char *cache_directory, TextureCacheKey *out) {
+    size_t size = 0;
+    const void *source = dcat_map_file(source_path, &size);
+    if (!source) {
+        memset(out, 0, sizeof(*out));
+        return false;
+    }
+    const bool ok =
+        texture_cache_key(source, size, format, max_size, normal_map, cache_directory, out);
+    dcat_unmap_file(source, size);
+    return ok;
+}
+
+bool texture_cache_load(const TextureCacheKey *key, Texture *tex) {
+    if (!key->cache_path[0]) {
+        return false;
+    }
+    size_t size = 0;
+    const uint8_t *data = dcat_map_file(key->cache_path, &size);
+    if (!data) {
+        return false;
+    }
+    TextureCacheHeader header;
+    bool ok = size >= sizeof(header);
+    if (ok) {
+        memcpy(&header, data, sizeof(header));
+        const uint32_t flags = key->normal_map ? TEXTURE_CACHE_NORMAL_MAP : 0U;
+        ok = memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+             header.version == TEXTURE_CACHE_VERSION && header.format == (uint32_t)key->format &&
+             header.source_hash == key->source_hash && header.source_size == key->source_size &&
+             header.max_size == key->max_size &&
+             (header.flags & TEXTURE_CACHE_NORMAL_MAP) == flags && header.width > 0 &&
+             header.height > 0 && header.data_size > 0 &&
+             header.data_size == size - sizeof(header);
+    }
+    uint8_t *pixels = ok ? malloc((size_t)header.data_size) : NULL;
+    if (pixels) {
+        memcpy(pixels, data + sizeof(header), (size_t)header.data_size);
+        tex->width = header.width;
+        tex->height = header.height;
+        tex->data = pixels;
+        tex->data_size = (size_t)header.data_size;
+        tex->format = key->format;
+        tex->mip_levels = header.mip_levels;
+        tex->has_transparency = (header.flags & TEXTURE_CACHE_TRANSPARENT) != 0;
+        tex->refs = NULL;
+    }
+    dcat_unmap_file(data, size);
+    return pixels != NULL;
+}
+
+bool texture_cache_store(const TextureCacheKey *key, const Texture *tex) {
+    if (!key->cache_path[0] || !tex->data || tex->format != key->format) {
+        return false;
+    }
+    // Write then rename, so a concurrent dcat never maps a half-written entry
+    char temp_path[sizeof(key->cache_path) + 32];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.%u.tmp", key->cache_path, dcat_getpid(),
+             atomic_fetch_add(&g_store_sequence, 1U));
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    TextureCacheHeader header = {0};
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_CACHE_VERSION;
+    header.format = (uint32_t)key->format;
+    header.source_hash = key->source_hash;
+    header.source_size = key->source_size;
+    header.max_size = key->max_size;
+    header.flags = (key->normal_map ? TEXTURE_CACHE_NORMAL_MAP : 0U) |
+                   (tex->has_transparency ? TEXTURE_CACHE_TRANSPARENT : 0U);
+    header.width = tex->width;
+    header.height = tex->height;
+    header.mip_levels = tex->mip_levels;
+    header.data_size = tex->data_size;
+    bool ok = fwrite(&header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(tex->data, 1, tex->data_size, file) == tex->data_size;
+    ok = (fclose(file) == 0) && ok;
+#ifdef _WIN32
+    if (ok) {
+        remove(key->cache_path);
+    }
+#endif
+    if (!ok || rename(temp_path, key->cache_path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "texture.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One transcoded form of one source image. Entries are named by the hash of the source
+// bytes, so the same image referenced from several models or paths shares its entry.
+typedef struct TextureCacheKey {
+    char cache_path[512];
+    uint64_t source_hash;
+    uint64_t source_size;
+    TextureFormat format;
+    uint32_t max_size;
+    bool normal_map;
+} TextureCacheKey;
+
+// Keys the `format` encoding of the source bytes, decoded at `max_size` as a normal map or
+// not. `cache_directory` (with a trailing separator) overrides the per-user cache
+// directory; pass NULL for the default.
+bool texture_cache_key(const uint8_t *source, size_t source_size, TextureFormat format,
+                       uint32_t max_size, bool normal_map, const char *cache_directory,
+                       TextureCacheKey *out);
+
+// texture_cache_key over the contents of `source_path`
+bool texture_cache_key_file(const char *source_path, TextureFormat format, uint32_t max_size,
+                            bool normal_map, const char *cache_directory, TextureCacheKey *out);
+
+// Fills `tex` from the entry when one was written for the same key
+bool texture_cache_load(const TextureCacheKey *key, Texture *tex);
+
+// Writes the entry for `tex`; failures only cost the next launch a transcode
+bool texture_cache_store(const TextureCacheKey *key, const Texture *tex);
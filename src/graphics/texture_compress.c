@@ -0,0 +1,392 @@
+#include "texture_compress.h"
+#include "core/types.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_BYTES 16U
+#define BLOCK_TEXELS 16U
+#define POWER_ITERATIONS 8
+
+// BC7 4-bit index weights, out of 64
+static const int bc7_weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+TextureFormat texture_compress_target(const bool normal_map) {
+    if (normal_map && texture_gpu_supports(TEXTURE_FORMAT_BC5)) {
+        return TEXTURE_FORMAT_BC5;
+    }
+    if (texture_gpu_supports(TEXTURE_FORMAT_BC7)) {
+        return TEXTURE_FORMAT_BC7;
+    }
+    return TEXTURE_FORMAT_RGBA8;
+}
+
+static uint32_t level_extent(const uint32_t extent, const uint32_t level) {
+    const uint32_t shifted = extent >> level;
+    return shifted > 0 ? shifted : 1U;
+}
+
+static uint8_t to_byte(const float value) {
+    return (uint8_t)lroundf(clampf(value, 0.0F, 255.0F));
+}
+
+static uint8_t linear_to_srgb(const float linear) {
+    const float c = clampf(linear, 0.0F, 1.0F);
+    const float srgb = c <= 0.0031308F ? c * 12.92F : 1.055F * powf(c, 1.0F / 2.4F) - 0.055F;
+    return to_byte(srgb * 255.0F);
+}
+
+// Averages each 2x2 footprint into the next level; odd edges repeat their last texel
+static void downsample_level(const uint8_t *src, const uint32_t width, const uint32_t height,
+                             uint8_t *dst, const uint32_t dst_width, const uint32_t dst_height,
+                             const float *to_linear, const bool normal_map) {
+    for (uint32_t y = 0; y < dst_height; y++) {
+        const uint32_t rows[2] = {2U * y < height ? 2U * y : height - 1U,
+                                  2U * y + 1U < height ? 2U * y + 1U : height - 1U};
+        for (uint32_t x = 0; x < dst_width; x++) {
+            const uint32_t columns[2] = {2U * x < width ? 2U * x : width - 1U,
+                                         2U * x + 1U < width ? 2U * x + 1U : width - 1U};
+            float sum[4] = {0};
+            for (int i = 0; i < 4; i++) {
+                const uint8_t *texel = src + ((size_t)rows[i / 2] * width + columns[i % 2]) * 4U;
+                for (int c = 0; c < 3; c++) {
+                    sum[c] += normal_map ? (float)texel[c] / 127.5F - 1.0F : to_linear[texel[c]];
+                }
+                sum[3] += (float)texel[3];
+            }
+            uint8_t *out = dst + ((size_t)y * dst_width + x) * 4U;
+            if (normal_map) {
+                const float length = sqrtf(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                for (int c = 0; c < 3; c++) {
+                    const float n = length > 1e-6F ? sum[c] / length : (c == 2 ? 1.0F : 0.0F);
+                    out[c] = to_byte((n + 1.0F) * 127.5F);
+                }
+            } else {
+                for (int c = 0; c < 3; c++) {
+                    out[c] = linear_to_srgb(sum[c] * 0.25F);
+                }
+            }
+            out[3] = to_byte(sum[3] * 0.25F);
+        }
+    }
+}
+
+// The 4x4 block at (bx, by), clamping at the right and bottom edges
+static void load_block(const uint8_t *pixels, const uint32_t width, const uint32_t height,
+                       const uint32_t bx, const uint32_t by, uint8_t block[BLOCK_TEXELS][4]) {
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        uint32_t x = bx * 4U + i % 4U;
+        uint32_t y = by * 4U + i / 4U;
+        x = x < width ? x : width - 1U;
+        y = y < height ? y : height - 1U;
+        memcpy(block[i], pixels + ((size_t)y * width + x) * 4U, 4);
+    }
+}
+
+static void put_bits(uint8_t *out, uint32_t *pos, const uint32_t value, const uint32_t count) {
+    for (uint32_t i = 0; i < count; i++, (*pos)++) {
+        if ((value >> i) & 1U) {
+            out[*pos / 8U] |= (uint8_t)(1U << (*pos % 8U));
+        }
+    }
+}
+
+// Rounds an endpoint to 7 bits per channel and the shared low bit that lands closer
+static void bc7_quantize(const float endpoint[4], int out[4], int *out_pbit) {
+    float best_error = INFINITY;
+    for (int pbit = 0; pbit < 2; pbit++) {
+        int candidate[4];
+        float error = 0.0F;
+        for (int c = 0; c < 4; c++) {
+            long q = lroundf((endpoint[c] - (float)pbit) * 0.5F);
+            q = q < 0 ? 0 : (q > 127 ? 127 : q);
+            candidate[c] = (int)q * 2 + pbit;
+            const float d = (float)candidate[c] - endpoint[c];
+            error += d * d;
+        }
+        if (error < best_error) {
+            best_error = error;
+            memcpy(out, candidate, sizeof(candidate));
+            *out_pbit = pbit;
+        }
+    }
+}
+
+// Picks each texel's closest palette entry and returns the summed squared error
+static uint32_t bc7_assign(const uint8_t block[BLOCK_TEXELS][4], const int endpoints[2][4],
+                           uint8_t indices[BLOCK_TEXELS]) {
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        const int w = bc7_weights[i];
+        for (int c = 0; c < 4; c++) {
+            palette[i][c] = ((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6;
+        }
+    }
+    uint32_t total = 0;
+    for (uint32_t t = 0; t < BLOCK_TEXELS; t++) {
+        uint32_t best = UINT32_MAX;
+        for (int i = 0; i < 16; i++) {
+            uint32_t error = 0;
+            for (int c = 0; c < 4; c++) {
+                const int d = palette[i][c] - block[t][c];
+                error += (uint32_t)(d * d);
+            }
+            if (error < best) {
+                best = error;
+                indices[t] = (uint8_t)i;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+typedef struct Bc7Candidate {
+    int endpoints[2][4];
+    int pbits[2];
+    uint8_t indices[BLOCK_TEXELS];
+    uint32_t error;
+} Bc7Candidate;
+
+static void bc7_try(const uint8_t block[BLOCK_TEXELS][4], float e0[4], float e1[4],
+                    Bc7Candidate *best) {
+    Bc7Candidate candidate;
+    for (int c = 0; c < 4; c++) {
+        e0[c] = clampf(e0[c], 0.0F, 255.0F);
+        e1[c] = clampf(e1[c], 0.0F, 255.0F);
+    }
+    bc7_quantize(e0, candidate.endpoints[0], &candidate.pbits[0]);
+    bc7_quantize(e1, candidate.endpoints[1], &candidate.pbits[1]);
+    candidate.error = bc7_assign(block, candidate.endpoints, candidate.indices);
+    if (candidate.error < best->error) {
+        *best = candidate;
+    }
+}
+
+// Mode 6: one subset, RGBA endpoints of 7 bits plus a shared bit each, 4-bit indices. The
+// endpoints start on the principal axis of the block's colours and get one least-squares
+// refit against the indices that choice gave.
+static void encode_bc7_block(const uint8_t block[BLOCK_TEXELS][4], uint8_t out[BLOCK_BYTES]) {
+    float mean[4] = {0};
+    for (uint32_t t = 0; t < BLOCK_TEXELS; t++) {
+        for (int c = 0; c < 4; c++) {
+            mean[c] += (float)block[t][c] / (float)BLOCK_TEXELS;
+        }
+    }
+    float covariance[4][4] = {{0}};
+    for (uint32_t t = 0; t < BLOCK_TEXELS; t++) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                covariance[i][j] += ((float)block[t][i] - mean[i]) * ((float)block[t][j] - mean[j]);
+            }
+        }
+    }
+    float axis[4] = {1.0F, 1.0F, 1.0F, 1.0F};
+    for (int iteration = 0; iteration < POWER_ITERATIONS; iteration++) {
+        float next[4] = {0};
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+        }
+        const float length =
+            sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6F) {
+            // A flat block: both endpoints sit on the mean
+            memset(axis, 0, sizeof(axis));
+            break;
+        }
+        for (int i = 0; i < 4; i++) {
+            axis[i] = next[i] / length;
+        }
+    }
+    float low = 0.0F;
+    float high = 0.0F;
+    for (uint32_t t = 0; t < BLOCK_TEXELS; t++) {
+        float projection = 0.0F;
+        for (int c = 0; c < 4; c++) {
+            projection += ((float)block[t][c] - mean[c]) * axis[c];
+        }
+        low = projection < low ? projection : low;
+        high = projection > high ? projection : high;
+    }
+
+    Bc7Candidate best = {.error = UINT32_MAX};
+    float e0[4];
+    float e1[4];
+    for (int c = 0; c < 4; c++) {
+        e0[c] = mean[c] + low * axis[c];
+        e1[c] = mean[c] + high * axis[c];
+    }
+    bc7_try(block, e0, e1, &best);
+
+    float aa = 0.0F;
+    float ab = 0.0F;
+    float bb = 0.0F;
+    float ax[4] = {0};
+    float bx[4] = {0};
+    for (uint32_t t = 0; t < BLOCK_TEXELS; t++) {
+        const float b = (float)bc7_weights[best.indices[t]] / 64.0F;
+        const float a = 1.0F - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < 4; c++) {
+            ax[c] += a * (float)block[t][c];
+            bx[c] += b * (float)block[t][c];
+        }
+    }
+    const float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) > 1e-6F) {
+        for (int c = 0; c < 4; c++) {
+            e0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+            e1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+        }
+        bc7_try(block, e0, e1, &best);
+    }
+
+    // The first texel's index drops its top bit, so it must come from the lower half
+    if (best.indices[0] & 8U) {
+        for (int c = 0; c < 4; c++) {
+            const int swap = best.endpoints[0][c];
+            best.endpoints[0][c] = best.endpoints[1][c];
+            best.endpoints[1][c] = swap;
+        }
+        const int swap = best.pbits[0];
+        best.pbits[0] = best.pbits[1];
+        best.pbits[1] = swap;
+        for (uint32_t t = 0; t < BLOCK_TEXELS; t++) {
+            best.indices[t] = (uint8_t)(15U - best.indices[t]);
+        }
+    }
+
+    memset(out, 0, BLOCK_BYTES);
+    uint32_t pos = 0;
+    put_bits(out, &pos, 1U << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        put_bits(out, &pos, (uint32_t)best.endpoints[0][c] >> 1, 7);
+        put_bits(out, &pos, (uint32_t)best.endpoints[1][c] >> 1, 7);
+    }
+    put_bits(out, &pos, (uint32_t)best.pbits[0], 1);
+    put_bits(out, &pos, (uint32_t)best.pbits[1], 1);
+    put_bits(out, &pos, best.indices[0], 3);
+    for (uint32_t t = 1; t < BLOCK_TEXELS; t++) {
+        put_bits(out, &pos, best.indices[t], 4);
+    }
+}
+
+// One channel as BC4: the block's extremes as endpoints with six steps between them
+static void encode_bc4_block(const uint8_t block[BLOCK_TEXELS][4], const int channel,
+                             uint8_t out[8]) {
+    int high = 0;
+    int low = 255;
+    for (uint32_t t = 0; t < BLOCK_TEXELS; t++) {
+        high = block[t][channel] > high ? block[t][channel] : high;
+        low = block[t][channel] < low ? block[t][channel] : low;
+    }
+    int palette[8] = {high, low};
+    for (int i = 2; i < 8; i++) {
+        palette[i] = ((8 - i) * high + (i - 1) * low) / 7;
+    }
+    uint64_t bits = 0;
+    for (uint32_t t = 0; t < BLOCK_TEXELS && high != low; t++) {
+        int best = 0;
+        int best_error = 256;
+        for (int i = 0; i < 8; i++) {
+            const int error = abs(palette[i] - block[t][channel]);
+            if (error < best_error) {
+                best_error = error;
+                best = i;
+            }
+        }
+        bits |= (uint64_t)best << (3U * t);
+    }
+    out[0] = (uint8_t)high;
+    out[1] = (uint8_t)low;
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (uint8_t)(bits >> (8 * i));
+    }
+}
+
+static void encode_level(const uint8_t *pixels, const uint32_t width, const uint32_t height,
+                         const TextureFormat format, uint8_t *out) {
+    const uint32_t blocks_x = (width + 3U) / 4U;
+    const uint32_t blocks_y = (height + 3U) / 4U;
+    for (uint32_t by = 0; by < blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            uint8_t block[BLOCK_TEXELS][4];
+            load_block(pixels, width, height, bx, by, block);
+            uint8_t *dst = out + ((size_t)by * blocks_x + bx) * BLOCK_BYTES;
+            if (format == TEXTURE_FORMAT_BC7) {
+                encode_bc7_block(block, dst);
+            } else {
+                encode_bc4_block(block, 0, dst);
+                encode_bc4_block(block, 1, dst + 8);
+            }
+        }
+    }
+}
+
+bool texture_compress(Texture *tex, const TextureFormat format, const bool normal_map) {
+    if (tex->format != TEXTURE_FORMAT_RGBA8 || !tex->data || tex->width == 0 ||
+        tex->height == 0 || tex->refs ||
+        (format != TEXTURE_FORMAT_BC7 && format != TEXTURE_FORMAT_BC5)) {
+        return false;
+    }
+    uint32_t levels = 1;
+    for (uint32_t size = tex->width > tex->height ? tex->width : tex->height; size > 1;
+         size /= 2U) {
+        levels++;
+    }
+    size_t total = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        total += texture_level_size(format, level_extent(tex->width, level),
+                                    level_extent(tex->height, level));
+    }
+    uint8_t *out = malloc(total);
+    if (!out) {
+        return false;
+    }
+    float to_linear[256];
+    for (int i = 0; i < 256; i++) {
+        const float c = (float)i / 255.0F;
+        to_linear[i] = c <= 0.04045F ? c / 12.92F : powf((c + 0.055F) / 1.055F, 2.4F);
+    }
+
+    // Each level is encoded, then filtered into the next
+    const uint8_t *pixels = tex->data;
+    uint8_t *scratch = NULL;
+    size_t offset = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        const uint32_t width = level_extent(tex->width, level);
+        const uint32_t height = level_extent(tex->height, level);
+        encode_level(pixels, width, height, format, out + offset);
+        offset += texture_level_size(format, width, height);
+        if (level + 1U == levels) {
+            break;
+        }
+        const uint32_t next_width = level_extent(tex->width, level + 1U);
+        const uint32_t next_height = level_extent(tex->height, level + 1U);
+        uint8_t *next = malloc((size_t)next_width * next_height * 4U);
+        if (!next) {
+            free(scratch);
+            free(out);
+            return false;
+        }
+        downsample_level(pixels, width, height, next, next_width, next_height, to_linear,
+                         normal_map);
+        free(scratch);
+        scratch = next;
+        pixels = next;
+    }
+    free(scratch);
+
+    free(tex->data);
+    tex->data = out;
+    tex->data_size = total;
+    tex->format = format;
+    tex->mip_levels = levels;
+    return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "texture.h"
+
+#include <stdbool.h>
+
+// Block format decoded textures are compressed to, given what the GPU can sample
+// (texture_set_gpu_formats): BC5 for normal maps, BC7 for the rest, or RGBA8 when the
+// renderer takes neither. ETC2 and ASTC are only ever passed through from KTX2 files.
+TextureFormat texture_compress_target(bool normal_map);
+
+// Replaces an RGBA8 texture with its full mip chain encoded as `format`, BC7 or BC5. Colour
+// levels are filtered in linear light; normal map levels are renormalised. Returns false,
+// leaving the texture unchanged, for other formats or when memory runs out. The texture must
+// not be shared yet.
+bool texture_compress(Texture *tex, TextureFormat format, bool normal_map);
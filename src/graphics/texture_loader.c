@@ -1,10 +1,16 @@
 #include "texture_loader.h"
-#include "skydome.h"
+#include "core/worker_pool.h"
+#include "texture_cache.h"
+#include "texture_compress.h"
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define NO_TEXTURE_SLOT SIZE_MAX
 
 bool load_diffuse_texture(const char *model_path, const char *texture_arg,
                           const MaterialInfo *material_info, Texture *out_texture) {
@@ -48,6 +54,9 @@ bool load_diffuse_texture(const char *model_path, const char *texture_arg,
             out_texture->width = embedded_tex->mWidth;
             out_texture->height = embedded_tex->mHeight;
             out_texture->data_size = (size_t)(embedded_tex->mWidth * embedded_tex->mHeight * 4);
+            out_texture->format = TEXTURE_FORMAT_RGBA8;
+            out_texture->mip_levels = 1;
+            out_texture->refs = NULL;
             out_texture->data = malloc(out_texture->data_size);
 
             if (!out_texture->data) {
@@ -98,16 +107,278 @@ bool load_normal_texture(const char *normal_arg, const MaterialInfo *material_in
     return true;
 }
 
-bool load_skydome(const char *skydome_path, Mesh *skydome_mesh, Texture *skydome_texture) {
-    if (!skydome_path) {
+// One decode, and the chain of slots (2 * material, plus 1 for the normal map) that wait
+// for it
+typedef struct TextureJob {
+    bool normal_map;
+    const char *path;
+    // Set instead of decoding `path` when the material carries the image bytes itself
+    const unsigned char *embedded;
+    size_t embedded_size;
+    // Of the path, or of the bytes for embedded images, so equal sources meet in one bucket
+    uint64_t hash;
+    // Material whose MaterialInfo the decode reads
+    size_t material;
+    size_t first_slot;
+} TextureJob;
+
+typedef struct TextureJobs {
+    const char *model_path;
+    const char *texture_arg;
+    const char *normal_arg;
+    const MaterialInfo *materials;
+    Texture *out_diffuse;
+    Texture *out_normal;
+    TextureJob *jobs;
+    size_t job_count;
+    size_t *next_slot;
+    // Textures each material still waits for
+    uint8_t *pending;
+    MaterialTexturesReady on_ready;
+    void *context;
+    const atomic_bool *cancelled;
+    DcatMutex mutex;
+} TextureJobs;
+
+// FNV-1a, seeded so a diffuse and a normal map read from the same source stay apart
+static uint64_t hash_texture_source(const unsigned char *bytes, const size_t size,
+                                    const bool normal_map) {
+    uint64_t hash = normal_map ? 0x84222325cbf29ce4ULL : 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static Texture *slot_texture(const TextureJobs *t, const size_t slot) {
+    return (slot & 1U) != 0 ? &t->out_normal[slot / 2] : &t->out_diffuse[slot / 2];
+}
+
+// Describes what a slot decodes, mirroring load_diffuse_texture and load_normal_texture;
+// false when it only needs the built-in default
+static bool resolve_texture_job(const TextureJobs *t, const size_t slot, TextureJob *out) {
+    const size_t material = slot / 2;
+    const bool normal_map = (slot & 1U) != 0;
+    const MaterialInfo *info = &t->materials[material];
+    const char *arg = normal_map ? t->normal_arg : t->texture_arg;
+    const char *path = arg ? arg : (normal_map ? info->normal_path : info->diffuse_path);
+    if (!path || path[0] == '\0') {
+        return false;
+    }
+    *out = (TextureJob){.normal_map = normal_map,
+                        .path = path,
+                        .material = material,
+                        .first_slot = slot};
+    if (path[0] == '*' && !arg) {
+        out->embedded = normal_map ? info->embedded_normal : info->embedded_diffuse;
+        out->embedded_size = normal_map ? info->embedded_normal_size : info->embedded_diffuse_size;
+        if (!out->embedded || out->embedded_size == 0) {
+            out->embedded = NULL;
+            // Diffuse maps re-import the model for the bytes; normal maps go flat
+            if (normal_map) {
+                return false;
+            }
+        }
+    }
+    out->hash = out->embedded
+                    ? hash_texture_source(out->embedded, out->embedded_size, normal_map)
+                    : hash_texture_source((const unsigned char *)path, strlen(path), normal_map);
+    return true;
+}
+
+static bool same_texture_source(const TextureJob *a, const TextureJob *b) {
+    if (a->hash != b->hash || a->normal_map != b->normal_map ||
+        (a->embedded != NULL) != (b->embedded != NULL)) {
         return false;
     }
+    if (a->embedded) {
+        return a->embedded_size == b->embedded_size &&
+               (a->embedded == b->embedded ||
+                memcmp(a->embedded, b->embedded, a->embedded_size) == 0);
+    }
+    return strcmp(a->path, b->path) == 0;
+}
+
+// Decodes the job's source and block-compresses it when the GPU samples a block format. The
+// compressed result is cached by the source bytes, so only the first launch pays for the
+// decode and encode; images re-imported from the model have no bytes at hand and skip it.
+static void decode_texture(const TextureJobs *t, const TextureJob *job, Texture *out) {
+    const MaterialInfo *info = &t->materials[job->material];
+    const TextureFormat target = texture_compress_target(job->normal_map);
+    TextureCacheKey key = {0};
+    if (target != TEXTURE_FORMAT_RGBA8) {
+        const uint32_t max_size = texture_get_max_size();
+        if (job->embedded) {
+            texture_cache_key(job->embedded, job->embedded_size, target, max_size,
+                              job->normal_map, NULL, &key);
+        } else if (job->path[0] != '*') {
+            texture_cache_key_file(job->path, target, max_size, job->normal_map, NULL, &key);
+        }
+        if (texture_cache_load(&key, out)) {
+            return;
+        }
+    }
+
+    if (job->normal_map) {
+        load_normal_texture(t->normal_arg, info, out);
+    } else {
+        load_diffuse_texture(t->model_path, t->texture_arg, info, out);
+    }
+    // Leaves the 1x1 fallbacks as they are, and anything KTX2 delivered already compressed
+    if (out->width >= 4 && out->height >= 4 && texture_compress(out, target, job->normal_map)) {
+        texture_cache_store(&key, out);
+    }
+}
+
+static void decode_texture_job(void *context, const uint32_t index) {
+    TextureJobs *t = context;
+    const TextureJob *job = &t->jobs[index];
+    Texture texture = {0};
+    if (t->cancelled && atomic_load(t->cancelled)) {
+        if (job->normal_map) {
+            texture_create_flat_normal_map(&texture);
+        } else {
+            texture_init_default(&texture);
+        }
+    } else {
+        decode_texture(t, job, &texture);
+    }
+    // The first slot takes the decode and the rest share its pixels
+    for (size_t slot = t->next_slot[job->first_slot]; slot != NO_TEXTURE_SLOT;
+         slot = t->next_slot[slot]) {
+        texture_share(&texture, slot_texture(t, slot));
+    }
+    *slot_texture(t, job->first_slot) = texture;
 
-    generate_skydome(skydome_mesh, 100.0F, 32, 16);
+    dcat_mutex_lock(&t->mutex);
+    for (size_t slot = job->first_slot; slot != NO_TEXTURE_SLOT; slot = t->next_slot[slot]) {
+        if (--t->pending[slot / 2] == 0 && t->on_ready) {
+            t->on_ready(t->context, slot / 2);
+        }
+    }
+    dcat_mutex_unlock(&t->mutex);
+}
+
+static void load_material_textures_serially(const TextureJobs *t, const size_t material_count) {
+    for (size_t i = 0; i < material_count; i++) {
+        load_diffuse_texture(t->model_path, t->texture_arg, &t->materials[i], &t->out_diffuse[i]);
+        load_normal_texture(t->normal_arg, &t->materials[i], &t->out_normal[i]);
+        if (t->on_ready) {
+            t->on_ready(t->context, i);
+        }
+    }
+}
+
+void load_material_textures(const char *model_path, const char *texture_arg,
+                            const char *normal_arg, const MaterialInfo *materials,
+                            const size_t material_count, Texture *out_diffuse,
+                            Texture *out_normal, const MaterialTexturesReady on_ready,
+                            void *context, const atomic_bool *cancelled) {
+    TextureJobs t = {.model_path = model_path,
+                     .texture_arg = texture_arg,
+                     .normal_arg = normal_arg,
+                     .materials = materials,
+                     .out_diffuse = out_diffuse,
+                     .out_normal = out_normal,
+                     .on_ready = on_ready,
+                     .context = context,
+                     .cancelled = cancelled};
+    const size_t slot_count = material_count * 2;
+    if (slot_count == 0) {
+        return;
+    }
+    t.jobs = malloc(slot_count * sizeof(TextureJob));
+    t.next_slot = malloc(slot_count * sizeof(size_t));
+    t.pending = calloc(material_count, sizeof(uint8_t));
+    // Tail of each job's slot chain while the chains are built
+    size_t *last_slot = malloc(slot_count * sizeof(size_t));
+    // Open-addressed job indices by source hash, at most half full
+    size_t bucket_count = 16;
+    while (bucket_count < slot_count * 2) {
+        bucket_count *= 2;
+    }
+    size_t *buckets = malloc(bucket_count * sizeof(size_t));
+    if (!t.jobs || !t.next_slot || !t.pending || !last_slot || !buckets ||
+        !dcat_mutex_init(&t.mutex)) {
+        load_material_textures_serially(&t, material_count);
+        free(t.jobs);
+        free(t.next_slot);
+        free(t.pending);
+        free(last_slot);
+        free(buckets);
+        return;
+    }
+    for (size_t i = 0; i < bucket_count; i++) {
+        buckets[i] = NO_TEXTURE_SLOT;
+    }
+
+    // A slot naming a source that is already queued joins that job instead of adding one
+    for (size_t slot = 0; slot < slot_count; slot++) {
+        t.next_slot[slot] = NO_TEXTURE_SLOT;
+        TextureJob job;
+        if (!resolve_texture_job(&t, slot, &job)) {
+            if ((slot & 1U) != 0) {
+                texture_create_flat_normal_map(slot_texture(&t, slot));
+            } else {
+                texture_init_default(slot_texture(&t, slot));
+            }
+            continue;
+        }
+        t.pending[slot / 2]++;
+        size_t bucket = (size_t)job.hash & (bucket_count - 1);
+        while (buckets[bucket] != NO_TEXTURE_SLOT &&
+               !same_texture_source(&t.jobs[buckets[bucket]], &job)) {
+            bucket = (bucket + 1) & (bucket_count - 1);
+        }
+        size_t j = buckets[bucket];
+        if (j != NO_TEXTURE_SLOT) {
+            t.next_slot[last_slot[j]] = slot;
+        } else {
+            j = t.job_count++;
+            t.jobs[j] = job;
+            buckets[bucket] = j;
+        }
+        last_slot[j] = slot;
+    }
+    free(last_slot);
+    free(buckets);
+
+    // Materials left with nothing to decode are complete already
+    for (size_t i = 0; i < material_count; i++) {
+        if (t.pending[i] == 0 && on_ready) {
+            on_ready(context, i);
+        }
+    }
+
+    // The calling thread takes part, so one fewer worker than cores
+    const unsigned int cpu_count = dcat_cpu_count();
+    uint32_t threads = cpu_count > 1 ? cpu_count - 1 : 0;
+    if (t.job_count <= threads) {
+        threads = t.job_count > 0 ? (uint32_t)(t.job_count - 1) : 0;
+    }
+    WorkerPool pool;
+    const bool pool_started = worker_pool_init(&pool, threads);
+    worker_pool_run(&pool, (uint32_t)t.job_count, decode_texture_job, &t);
+    if (pool_started) {
+        worker_pool_destroy(&pool);
+    }
+
+    dcat_mutex_destroy(&t.mutex);
+    free(t.jobs);
+    free(t.next_slot);
+    free(t.pending);
+}
+
+bool load_skydome(const char *skydome_path, const uint32_t max_size, Texture *skydome_texture) {
+    if (!skydome_path) {
+        return false;
+    }
 
-    if (!texture_from_file(skydome_texture, skydome_path)) {
+    // The panorama wraps the whole view, so the per-screen budget would blur it; the caller
+    // sizes it for the output instead. Its upload takes single-level RGBA8 only.
+    if (!texture_from_file_sized(skydome_texture, skydome_path, max_size) ||
+        skydome_texture->format != TEXTURE_FORMAT_RGBA8 || skydome_texture->mip_levels > 1) {
         fprintf(stderr, "Warning: Failed to load skydome texture\n");
-        mesh_free(skydome_mesh);
         texture_free(skydome_texture);
         return false;
     }
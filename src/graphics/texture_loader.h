@@ -2,6 +2,8 @@
 #include "model.h"
 #include "texture.h"
 
+#include <stdatomic.h>
+
 // Load diffuse texture from file, embedded data, or use default
 bool load_diffuse_texture(const char *model_path, const char *texture_arg,
                           const MaterialInfo *material_info, Texture *out_texture);
@@ -10,5 +12,23 @@ bool load_diffuse_texture(const char *model_path, const char *texture_arg,
 bool load_normal_texture(const char *normal_arg, const MaterialInfo *material_info,
                          Texture *out_texture);
 
-// Load skydome texture and mesh
-bool load_skydome(const char *skydome_path, Mesh *skydome_mesh, Texture *skydome_texture);
+// Called once per material as soon as both of its textures are in place
+typedef void (*MaterialTexturesReady)(void *context, size_t material);
+
+// Loads every material's diffuse and normal texture the way load_diffuse_texture and
+// load_normal_texture do, decoding on a worker pool. Materials naming the same image, by
+// path or by embedded bytes, share one decode and its pixels (texture_share). When the GPU
+// samples block formats (texture_set_gpu_formats) the decodes are compressed to them, through
+// the on-disk transcode cache (texture_cache.h). `on_ready`, which may be NULL, runs on
+// whichever thread finished the material's last texture, never concurrently with itself.
+// Once `cancelled` (may be NULL) is set, decodes that have not started yet are skipped and
+// their materials get the defaults.
+void load_material_textures(const char *model_path, const char *texture_arg,
+                            const char *normal_arg, const MaterialInfo *materials,
+                            size_t material_count, Texture *out_diffuse, Texture *out_normal,
+                            MaterialTexturesReady on_ready, void *context,
+                            const atomic_bool *cancelled);
+
+// Loads the skydome panorama, scaled down to at most `max_size` texels wide
+// (skydome_size_for_output); 0 keeps the full size
+bool load_skydome(const char *skydome_path, uint32_t max_size, Texture *skydome_texture);
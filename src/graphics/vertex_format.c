@@ -0,0 +1,205 @@
+#include "vertex_format.h"
+#include <math.h>
+#include <string.h>
+
+uint16_t float_to_half(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000U);
+    const int32_t exponent = (int32_t)((bits >> 23) & 0xFFU);
+    uint32_t mantissa = bits & 0x7FFFFFU;
+
+    if (exponent == 0xFF) {
+        return (uint16_t)(sign | 0x7C00U | (mantissa != 0 ? 0x200U : 0U));
+    }
+    const int32_t half_exponent = exponent - 127 + 15;
+    if (half_exponent >= 31) {
+        return (uint16_t)(sign | 0x7C00U);
+    }
+    if (half_exponent <= 0) {
+        // Subnormal half, or too small and flushed to signed zero
+        if (half_exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000U;
+        const uint32_t shift = (uint32_t)(14 - half_exponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1U << shift) - 1U);
+        const uint32_t halfway = 1U << (shift - 1U);
+        if (remainder > halfway || (remainder == halfway && (half & 1U) != 0)) {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    // Round to nearest even; a carry into the exponent is still the right answer
+    uint32_t half = ((uint32_t)half_exponent << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1FFFU;
+    if (remainder > 0x1000U || (remainder == 0x1000U && (half & 1U) != 0)) {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+float half_to_float(const uint16_t value) {
+    const uint32_t sign = (uint32_t)(value & 0x8000U) << 16;
+    uint32_t exponent = (value >> 10) & 0x1FU;
+    uint32_t mantissa = value & 0x3FFU;
+    uint32_t bits;
+
+    if (exponent == 0x1FU) {
+        bits = sign | 0x7F800000U | (mantissa << 13);
+    } else if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Renormalise the subnormal
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400U) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FFU) << 13);
+        }
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static float sign_not_zero(const float value) {
+    return value >= 0.0F ? 1.0F : -1.0F;
+}
+
+static int16_t to_snorm16(const float value) {
+    const float clamped = value < -1.0F ? -1.0F : (value > 1.0F ? 1.0F : value);
+    return (int16_t)lroundf(clamped * 32767.0F);
+}
+
+static int8_t to_snorm8(const float value) {
+    const float clamped = value < -1.0F ? -1.0F : (value > 1.0F ? 1.0F : value);
+    return (int8_t)lroundf(clamped * 127.0F);
+}
+
+void encode_octahedral(const float normal[3], int16_t out[2]) {
+    const float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    if (length <= 0.0F) {
+        // Degenerate normal; +Z keeps shading defined
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+    if (normal[2] < 0.0F) {
+        // Fold the lower hemisphere over the diagonals
+        const float folded_x = (1.0F - fabsf(y)) * sign_not_zero(x);
+        const float folded_y = (1.0F - fabsf(x)) * sign_not_zero(y);
+        x = folded_x;
+        y = folded_y;
+    }
+    out[0] = to_snorm16(x);
+    out[1] = to_snorm16(y);
+}
+
+void decode_octahedral(const int16_t encoded[2], float out[3]) {
+    float x = fmaxf((float)encoded[0] / 32767.0F, -1.0F);
+    float y = fmaxf((float)encoded[1] / 32767.0F, -1.0F);
+    const float z = 1.0F - fabsf(x) - fabsf(y);
+    const float t = fmaxf(-z, 0.0F);
+    x += x >= 0.0F ? -t : t;
+    y += y >= 0.0F ? -t : t;
+
+    const float length = sqrtf((x * x) + (y * y) + (z * z));
+    out[0] = x / length;
+    out[1] = y / length;
+    out[2] = z / length;
+}
+
+void pack_vertex(const Vertex *vertex, PackedVertex *out) {
+    memcpy(out->position, vertex->position, sizeof(out->position));
+    out->texcoord[0] = float_to_half(vertex->texcoord[0]);
+    out->texcoord[1] = float_to_half(vertex->texcoord[1]);
+    encode_octahedral(vertex->normal, out->normal);
+
+    // The bitangent is rebuilt in the shader as cross(N, T) * w
+    const float *n = vertex->normal;
+    const float *t = vertex->tangent;
+    const float *b = vertex->bitangent;
+    const float cross[3] = {(n[1] * t[2]) - (n[2] * t[1]), (n[2] * t[0]) - (n[0] * t[2]),
+                            (n[0] * t[1]) - (n[1] * t[0])};
+    const float handedness = (cross[0] * b[0]) + (cross[1] * b[1]) + (cross[2] * b[2]);
+    out->tangent[0] = to_snorm8(t[0]);
+    out->tangent[1] = to_snorm8(t[1]);
+    out->tangent[2] = to_snorm8(t[2]);
+    out->tangent[3] = handedness < 0.0F ? -127 : 127;
+}
+
+void pack_skin(const Vertex *vertex, PackedSkin *out) {
+    memset(out, 0, sizeof(*out));
+
+    float total = 0.0F;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+        const int joint = vertex->bone_ids[i];
+        if (joint >= 0 && joint <= UINT16_MAX && vertex->bone_weights[i] > 0.0F) {
+            total += vertex->bone_weights[i];
+        }
+    }
+    if (total <= 0.0F) {
+        return;
+    }
+
+    // Normalise so the quantised weights sum to exactly 255; the rounding error goes to the
+    // strongest influence.
+    int sum = 0;
+    int strongest = -1;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+        const int joint = vertex->bone_ids[i];
+        if (joint < 0 || joint > UINT16_MAX || vertex->bone_weights[i] <= 0.0F) {
+            continue;
+        }
+        const long weight = lroundf(vertex->bone_weights[i] / total * 255.0F);
+        out->joints[i] = (uint16_t)joint;
+        out->weights[i] = (uint8_t)weight;
+        sum += (int)weight;
+        if (strongest < 0 || out->weights[i] > out->weights[strongest]) {
+            strongest = i;
+        }
+    }
+    out->weights[strongest] = (uint8_t)(out->weights[strongest] + (255 - sum));
+
+    // Strongest first, so the used influences are a prefix the skinning loop can stop after
+    for (int i = 1; i < MAX_BONE_INFLUENCE; i++) {
+        const uint16_t joint = out->joints[i];
+        const uint8_t weight = out->weights[i];
+        int j = i;
+        for (; j > 0 && out->weights[j - 1] < weight; j--) {
+            out->joints[j] = out->joints[j - 1];
+            out->weights[j] = out->weights[j - 1];
+        }
+        out->joints[j] = joint;
+        out->weights[j] = weight;
+    }
+}
+
+uint32_t packed_skin_influences(const PackedSkin *skin) {
+    uint32_t count = 0;
+    while (count < MAX_BONE_INFLUENCE && skin->weights[count] > 0) {
+        count++;
+    }
+    return count;
+}
+
+bool vertices_have_skin(const VertexArray *vertices) {
+    for (size_t v = 0; v < vertices->count; v++) {
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+            if (vertices->data[v].bone_ids[i] >= 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "../core/types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// GPU vertex layout. `Vertex` stays the loader/CPU format; meshes are packed into these at
+// upload time: 24 bytes per vertex instead of 84, plus 12 bytes of skinning data in a second
+// stream that only animated meshes get.
+typedef struct PackedVertex {
+    float position[3];
+    uint16_t texcoord[2]; // half floats
+    int16_t normal[2];    // octahedral, snorm16
+    int8_t tangent[4];    // snorm8 xyz, w = bitangent sign
+} PackedVertex;
+
+typedef struct PackedSkin {
+    uint16_t joints[4]; // wide enough for skeletons past MAX_BONES, posed from baked poses
+    uint8_t weights[4]; // unorm8, strongest first; unused influences have weight 0
+} PackedSkin;
+
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t value);
+
+// Octahedral encoding of a unit vector into two snorm16 values, and its inverse.
+void encode_octahedral(const float normal[3], int16_t out[2]);
+void decode_octahedral(const int16_t encoded[2], float out[3]);
+
+void pack_vertex(const Vertex *vertex, PackedVertex *out);
+void pack_skin(const Vertex *vertex, PackedSkin *out);
+// Influences with a nonzero weight, which pack_skin puts in front.
+uint32_t packed_skin_influences(const PackedSkin *skin);
+// Whether any vertex is bound to a joint, i.e. the mesh needs the skinning stream.
+bool vertices_have_skin(const VertexArray *vertices);
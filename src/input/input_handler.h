@@ -1,11 +1,10 @@
 #pragma once
-#include "../core/threading.h"
-#include "../graphics/animation.h"
+#include "../core/change_tracker.h"
 #include "../graphics/camera.h"
-#include "../graphics/model.h"
-#include "../renderer/vulkan_renderer.h"
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum MouseButton {
     MOUSE_BUTTON_LEFT = 0,
@@ -32,17 +31,47 @@ typedef struct KeyState {
     int mouse_dy;
 } KeyState;
 
+// Everything the input thread has asked of the camera since it started. The sums only grow,
+// so the render thread applies the difference from the totals it last applied.
+typedef struct InputCommands {
+    KeyState keys;      // held now
+    double orbit_yaw;   // radians
+    double orbit_pitch; // radians
+    double pan_x;
+    double pan_y;
+    int64_t zoom_steps; // ZOOM_AMOUNT steps in, less those out
+} InputCommands;
+
+// Hands the input thread's InputCommands to the render thread without either waiting on the
+// other: a triple buffer, where the input thread fills its back slot and swaps it with the
+// middle one, and the render thread swaps its front slot for the middle one when that is
+// newer. Discrete commands are counters instead, so none is lost between two frames.
+typedef struct InputSnapshot {
+    InputCommands slots[3];
+    atomic_uint middle; // the slot between them, flagged while the render thread has not read it
+    unsigned int back;  // the input thread's
+    unsigned int front; // the render thread's
+    atomic_uint wireframe_toggles;
+    atomic_uint next_animations;
+    atomic_uint previous_animations;
+    atomic_uint play_toggles;
+} InputSnapshot;
+
+void input_snapshot_init(InputSnapshot *snapshot);
+
+// Input thread: makes `commands` the latest totals
+void input_snapshot_publish(InputSnapshot *snapshot, const InputCommands *commands);
+
+// Render thread: the latest totals published, valid until the next call
+const InputCommands *input_snapshot_read(InputSnapshot *snapshot);
+
 typedef struct InputThreadData {
-    Camera *camera;
-    VulkanRenderer *renderer;
-    AnimationState *anim_state;
-    Mesh *mesh;
-    DcatMutex *state_mutex;
+    InputCommands *commands; // the input thread's running totals
+    InputSnapshot *snapshot; // where it publishes them after each burst of input
     bool fps_controls;
     bool mouse_orbit;
     float mouse_sensitivity;
-    bool has_animations;
-    KeyState *key_state;
+    ChangeTracker *changes; // notified whenever input may have changed the scene
 } InputThreadData;
 
 // Input thread function
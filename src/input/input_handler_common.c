@@ -1,8 +1,40 @@
 #include "../core/signals.h"
 #include "input_handler.h"
+#include <string.h>
+
+// InputSnapshot::middle: the slot index, and whether the render thread has yet to take it
+#define INPUT_SNAPSHOT_SLOT 3U
+#define INPUT_SNAPSHOT_FRESH 4U
+
+void input_snapshot_init(InputSnapshot *snapshot) {
+    memset(snapshot->slots, 0, sizeof(snapshot->slots));
+    snapshot->back = 0;
+    atomic_init(&snapshot->middle, 1U);
+    snapshot->front = 2;
+    atomic_init(&snapshot->wireframe_toggles, 0U);
+    atomic_init(&snapshot->next_animations, 0U);
+    atomic_init(&snapshot->previous_animations, 0U);
+    atomic_init(&snapshot->play_toggles, 0U);
+}
+
+void input_snapshot_publish(InputSnapshot *snapshot, const InputCommands *commands) {
+    snapshot->slots[snapshot->back] = *commands;
+    snapshot->back =
+        atomic_exchange(&snapshot->middle, snapshot->back | INPUT_SNAPSHOT_FRESH) &
+        INPUT_SNAPSHOT_SLOT;
+}
+
+const InputCommands *input_snapshot_read(InputSnapshot *snapshot) {
+    if (atomic_load(&snapshot->middle) & INPUT_SNAPSHOT_FRESH) {
+        snapshot->front =
+            atomic_exchange(&snapshot->middle, snapshot->front) & INPUT_SNAPSHOT_SLOT;
+    }
+    return &snapshot->slots[snapshot->front];
+}
 
 void mouse_apply_action(const InputThreadData *data, const int btn, const int mx, const int my,
                         MouseTracker *track) {
+    change_tracker_notify(data->changes);
     switch (btn) {
     case MOUSE_BUTTON_LEFT:
     case MOUSE_BUTTON_MIDDLE:
@@ -16,8 +48,8 @@ void mouse_apply_action(const InputThreadData *data, const int btn, const int mx
         track->last_x = mx;
         track->last_y = my;
         if (dx != 0 || dy != 0) {
-            camera_orbit(data->camera, (float)dx * data->mouse_sensitivity,
-                         -(float)dy * data->mouse_sensitivity);
+            data->commands->orbit_yaw += (double)((float)dx * data->mouse_sensitivity);
+            data->commands->orbit_pitch -= (double)((float)dy * data->mouse_sensitivity);
         }
         break;
     }
@@ -29,15 +61,16 @@ void mouse_apply_action(const InputThreadData *data, const int btn, const int mx
         track->last_y = my;
         if (dx != 0 || dy != 0) {
             const float pan_speed = data->mouse_sensitivity * 0.2F;
-            camera_pan(data->camera, (float)dx * pan_speed, (float)dy * pan_speed);
+            data->commands->pan_x += (double)((float)dx * pan_speed);
+            data->commands->pan_y += (double)((float)dy * pan_speed);
         }
         break;
     }
     case MOUSE_BUTTON_SCROLL_UP:
-        camera_zoom(data->camera, ZOOM_AMOUNT);
+        data->commands->zoom_steps++;
         break;
     case MOUSE_BUTTON_SCROLL_DOWN:
-        camera_zoom(data->camera, -ZOOM_AMOUNT);
+        data->commands->zoom_steps--;
         break;
     default:
         break;
@@ -117,53 +150,55 @@ void handle_key(const InputThreadData *data, const int key_code, const int modif
                 const int event_type) {
     (void)modifiers;
     const bool pressed = (event_type != 3);
+    change_tracker_notify(data->changes);
 
     // Update FPS held-key state
-    if (data->fps_controls && data->key_state) {
+    if (data->fps_controls) {
+        KeyState *key_state = &data->commands->keys;
         switch (key_code) {
         case 'w':
-            data->key_state->w = pressed;
+            key_state->w = pressed;
             break;
         case 'a':
-            data->key_state->a = pressed;
+            key_state->a = pressed;
             break;
         case 's':
-            data->key_state->s = pressed;
+            key_state->s = pressed;
             break;
         case 'd':
-            data->key_state->d = pressed;
+            key_state->d = pressed;
             break;
         case 'i':
-            data->key_state->i = pressed;
+            key_state->i = pressed;
             break;
         case 'j':
-            data->key_state->j = pressed;
+            key_state->j = pressed;
             break;
         case 'k':
-            data->key_state->k = pressed;
+            key_state->k = pressed;
             break;
         case 'l':
-            data->key_state->l = pressed;
+            key_state->l = pressed;
             break;
         case ' ':
-            data->key_state->space = pressed;
+            key_state->space = pressed;
             break;
         case 'q':
-            data->key_state->q = pressed;
+            key_state->q = pressed;
             break;
         case 'v':
-            data->key_state->v = pressed;
+            key_state->v = pressed;
             break;
         case 'b':
-            data->key_state->b = pressed;
+            key_state->b = pressed;
             break;
         case KITTY_LEFT_SHIFT:
         case KITTY_RIGHT_SHIFT:
-            data->key_state->shift = pressed;
+            key_state->shift = pressed;
             break;
         case KITTY_LEFT_CTRL:
         case KITTY_RIGHT_CTRL:
-            data->key_state->ctrl = pressed;
+            key_state->ctrl = pressed;
             break;
         default:
             break;
@@ -181,58 +216,47 @@ void handle_key(const InputThreadData *data, const int key_code, const int modif
     }
 
     if (key_code == 'm') {
-        const bool current = vulkan_renderer_get_wireframe_mode(data->renderer);
-        vulkan_renderer_set_wireframe_mode(data->renderer, (!current) != 0);
+        atomic_fetch_add(&data->snapshot->wireframe_toggles, 1U);
     }
 
     // Orbit camera controls
     if (!data->fps_controls) {
         switch (key_code) {
         case 'a':
-            camera_orbit(data->camera, ROTATION_AMOUNT, 0.0F);
+            data->commands->orbit_yaw += ROTATION_AMOUNT;
             break;
         case 'd':
-            camera_orbit(data->camera, -ROTATION_AMOUNT, 0.0F);
+            data->commands->orbit_yaw -= ROTATION_AMOUNT;
             break;
         case 'w':
-            camera_orbit(data->camera, 0.0F, -ROTATION_AMOUNT);
+            data->commands->orbit_pitch -= ROTATION_AMOUNT;
             break;
         case 's':
-            camera_orbit(data->camera, 0.0F, ROTATION_AMOUNT);
+            data->commands->orbit_pitch += ROTATION_AMOUNT;
             break;
         case 'e':
-            camera_zoom(data->camera, ZOOM_AMOUNT);
+            data->commands->zoom_steps++;
             break;
         case 'r':
-            camera_zoom(data->camera, -ZOOM_AMOUNT);
+            data->commands->zoom_steps--;
             break;
         default:
             break;
         }
     }
 
-    // Animation controls
-    if (data->has_animations) {
-        switch (key_code) {
-        case '1':
-            data->anim_state->current_animation_index--;
-            if (data->anim_state->current_animation_index < 0) {
-                data->anim_state->current_animation_index = (int)data->mesh->animations.count - 1;
-            }
-            data->anim_state->current_time = 0.0F;
-            break;
-        case '2':
-            data->anim_state->current_animation_index++;
-            if (data->anim_state->current_animation_index >= (int)data->mesh->animations.count) {
-                data->anim_state->current_animation_index = 0;
-            }
-            data->anim_state->current_time = 0.0F;
-            break;
-        case 'p':
-            data->anim_state->playing = ((!data->anim_state->playing) != 0);
-            break;
-        default:
-            break;
-        }
+    // Animation controls; the render thread ignores them for a model without animations
+    switch (key_code) {
+    case '1':
+        atomic_fetch_add(&data->snapshot->previous_animations, 1U);
+        break;
+    case '2':
+        atomic_fetch_add(&data->snapshot->next_animations, 1U);
+        break;
+    case 'p':
+        atomic_fetch_add(&data->snapshot->play_toggles, 1U);
+        break;
+    default:
+        break;
     }
 }
@@ -1,29 +1,48 @@
 #include "../core/signals.h"
 #include "input_handler.h"
 #include "platform/io.h"
+#include "terminal/capability_cache.h"
 #include <poll.h>
 #include <string.h>
 
+// How often to check for quit when the wakeup descriptor could not be created
+#define INPUT_FALLBACK_TIMEOUT_MS 100
+
 void *input_thread_func(void *arg) {
     InputThreadData *data = (InputThreadData *)arg;
     char buffer[512];
     ssize_t carry = 0;
     MouseTracker mouse_track = {0};
 
+    // Sleeps until input arrives or a quit or resize is requested. Without the wakeup
+    // descriptor, a timeout is all that notices a quit.
+    struct pollfd pfds[2] = {{STDIN_FILENO, POLLIN, 0}, {signals_wakeup_fd(), POLLIN, 0}};
+    const int timeout_ms = pfds[1].fd >= 0 ? -1 : INPUT_FALLBACK_TIMEOUT_MS;
+
     while (!signals_should_quit()) {
-        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
-        if (poll(&pfd, 1, 1) <= 0 || !(pfd.revents & POLLIN))
+        if (poll(pfds, 2, timeout_ms) <= 0)
+            continue;
+
+        if (pfds[1].revents & POLLIN) {
+            signals_drain_wakeup();
+            // The render loop may be idle; wake it for the resize or quit too
+            change_tracker_notify(data->changes);
+        }
+        if (!(pfds[0].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)))
             continue;
 
         const size_t available = sizeof(buffer) - (size_t)carry;
         ssize_t n = dcat_read(STDIN_FILENO, buffer + carry, available);
-        if (n <= 0)
+        if (n == 0 || (n < 0 && !(pfds[0].revents & POLLIN))) {
+            // End of input: nothing more will come, so stop waking for it
+            pfds[0].fd = -1;
+            continue;
+        }
+        if (n < 0)
             continue;
         n += carry;
         carry = 0;
 
-        dcat_mutex_lock(data->state_mutex);
-
         ssize_t i = 0;
         while (i < n) {
             if (buffer[i] != '\x1b') {
@@ -35,6 +54,18 @@ void *input_thread_func(void *arg) {
                 continue;
             }
 
+            // Replies to the capability query chafa_driver_revalidate sent
+            const ptrdiff_t reply = capability_reply_parse(buffer + i, (size_t)(n - i));
+            if (reply < 0) {
+                carry = n - i;
+                memmove(buffer, buffer + i, carry);
+                break;
+            }
+            if (reply > 0) {
+                i += reply;
+                continue;
+            }
+
             // Need at least \x1b[X
             if (i + 2 >= n) {
                 carry = n - i;
@@ -153,7 +184,7 @@ void *input_thread_func(void *arg) {
             }
         }
 
-        dcat_mutex_unlock(data->state_mutex);
+        input_snapshot_publish(data->snapshot, data->commands);
     }
 
     return NULL;
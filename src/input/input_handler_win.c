@@ -1,4 +1,6 @@
 #include "../core/signals.h"
+#include "../core/threading.h"
+#include "../terminal/capability_cache.h"
 #include "input_handler.h"
 #include <string.h>
 
@@ -7,6 +9,9 @@
 #endif
 #include <windows.h>
 
+// How often to check for quit when the wakeup event could not be created
+#define INPUT_FALLBACK_TIMEOUT_MS 100
+
 typedef struct WindowsInputState {
     HANDLE input_handle;
     int last_mouse_x;
@@ -42,10 +47,7 @@ static bool rising_edge(const bool down, bool *prev_state) {
 }
 
 static void update_windows_keyboard_state(const InputThreadData *data, WindowsInputState *state) {
-    KeyState *key_state = data->key_state;
-    if (!key_state) {
-        return;
-    }
+    KeyState *key_state = &data->commands->keys;
 
     if (!state->has_focus) {
         memset(key_state, 0, sizeof(*key_state));
@@ -104,20 +106,14 @@ static void update_windows_keyboard_state(const InputThreadData *data, WindowsIn
     if (rising_edge(m_down, &state->prev_m)) {
         handle_key(data, 'm', 1, 1);
     }
-    if (data->has_animations) {
-        if (rising_edge(one_down, &state->prev_1)) {
-            handle_key(data, '1', 1, 1);
-        }
-        if (rising_edge(two_down, &state->prev_2)) {
-            handle_key(data, '2', 1, 1);
-        }
-        if (rising_edge(p_down, &state->prev_p)) {
-            handle_key(data, 'p', 1, 1);
-        }
-    } else {
-        state->prev_1 = one_down;
-        state->prev_2 = two_down;
-        state->prev_p = p_down;
+    if (rising_edge(one_down, &state->prev_1)) {
+        handle_key(data, '1', 1, 1);
+    }
+    if (rising_edge(two_down, &state->prev_2)) {
+        handle_key(data, '2', 1, 1);
+    }
+    if (rising_edge(p_down, &state->prev_p)) {
+        handle_key(data, 'p', 1, 1);
     }
 
     if (!data->fps_controls) {
@@ -158,9 +154,9 @@ static void handle_windows_mouse_event(const InputThreadData *data, WindowsInput
     if (event->dwEventFlags == MOUSE_WHEELED) {
         const short wheel_delta = (short)HIWORD(event->dwButtonState);
         if (wheel_delta > 0) {
-            camera_zoom(data->camera, ZOOM_AMOUNT);
+            data->commands->zoom_steps++;
         } else if (wheel_delta < 0) {
-            camera_zoom(data->camera, -ZOOM_AMOUNT);
+            data->commands->zoom_steps--;
         }
         return;
     }
@@ -195,11 +191,12 @@ static void handle_windows_mouse_event(const InputThreadData *data, WindowsInput
 
     if (dx != 0 || dy != 0) {
         if (left_down || state->left_down) {
-            camera_orbit(data->camera, (float)dx * data->mouse_sensitivity,
-                         -(float)dy * data->mouse_sensitivity);
+            data->commands->orbit_yaw += (double)((float)dx * data->mouse_sensitivity);
+            data->commands->orbit_pitch -= (double)((float)dy * data->mouse_sensitivity);
         } else if (right_down || middle_down || state->right_down || state->middle_down) {
             const float pan_speed = data->mouse_sensitivity * 0.2F;
-            camera_pan(data->camera, (float)dx * pan_speed, (float)dy * pan_speed);
+            data->commands->pan_x += (double)((float)dx * pan_speed);
+            data->commands->pan_y += (double)((float)dy * pan_speed);
         }
     }
 
@@ -216,6 +213,14 @@ static void process_windows_vt_bytes(InputThreadData *data, WindowsInputState *s
             i++;
             continue;
         }
+        const ptrdiff_t reply = capability_reply_parse(state->vt_buf + i, n - i);
+        if (reply < 0) {
+            break; // incomplete; carry from this ESC
+        }
+        if (reply > 0) {
+            i += (size_t)reply;
+            continue;
+        }
         if (i + 1 >= n) {
             break; // lone ESC; wait for more bytes
         }
@@ -305,6 +310,7 @@ static void poll_windows_console_events(InputThreadData *data, WindowsInputState
             }
             if (records[i].EventType == WINDOW_BUFFER_SIZE_EVENT) {
                 signals_request_resize();
+                change_tracker_notify(data->changes);
                 continue;
             }
             if (records[i].EventType == MOUSE_EVENT && data->mouse_orbit && state->has_focus) {
@@ -323,13 +329,39 @@ unsigned __stdcall input_thread_func(void *arg) {
     windows_state.has_focus = true;
     windows_state.input_handle = GetStdHandle(STD_INPUT_HANDLE);
 
+    // Sleeps until console input arrives or a quit is requested. Only a console handle is
+    // signaled just while it has input. Without the wakeup event, a timeout is all that
+    // notices a quit.
+    HANDLE handles[2];
+    DWORD handle_count = 0;
+    DWORD console_mode = 0;
+    if (windows_state.input_handle != INVALID_HANDLE_VALUE && windows_state.input_handle != NULL &&
+        GetConsoleMode(windows_state.input_handle, &console_mode)) {
+        handles[handle_count++] = windows_state.input_handle;
+    }
+    HANDLE wakeup_event = signals_wakeup_event();
+    if (wakeup_event) {
+        handles[handle_count++] = wakeup_event;
+    }
+    const DWORD timeout_ms = wakeup_event ? INFINITE : INPUT_FALLBACK_TIMEOUT_MS;
+
     while (!signals_should_quit()) {
-        dcat_mutex_lock(data->state_mutex);
+        // Held keys and direct mouse handling bypass handle_key, so diff the totals they touch.
+        const InputCommands commands_before = *data->commands;
         update_windows_keyboard_state(data, &windows_state);
         poll_windows_console_events(data, &windows_state);
-        dcat_mutex_unlock(data->state_mutex);
-        dcat_sleep_ms(1);
+        if (memcmp(&commands_before, data->commands, sizeof(commands_before)) != 0) {
+            change_tracker_notify(data->changes);
+            input_snapshot_publish(data->snapshot, data->commands);
+        }
+        if (handle_count > 0) {
+            WaitForMultipleObjects(handle_count, handles, FALSE, timeout_ms);
+        } else {
+            dcat_sleep_ms(INPUT_FALLBACK_TIMEOUT_MS);
+        }
     }
+    // The render loop may be idle; wake it for the quit too
+    change_tracker_notify(data->changes);
 
     // Drop any buffered input (e.g. a trailing mouse report) so it is not echoed to the
     // shell after we restore cooked mode on exit.
@@ -1,5 +1,8 @@
 #include "core/app.h"
 #include "core/args.h"
+#include "core/stream_client.h"
+
+#include <stdlib.h>
 
 int main(const int argc, char *argv[]) {
     Args args = {0};
@@ -23,17 +26,33 @@ int main(const int argc, char *argv[]) {
         return 1;
     }
 
+    if (args.connect_address) {
+        return stream_client_run(&args);
+    }
+
+    char **model_paths = NULL;
+    size_t model_count = 0;
+    if (args.batch) {
+        model_paths = malloc(sizeof(char *) * (size_t)argc);
+        if (!model_paths) {
+            return 1;
+        }
+        model_count = args_model_paths(argc, argv, model_paths);
+    }
+
     AppContext *app = app_create();
     if (!app) {
+        free(model_paths);
         return 1;
     }
 
     int exit_code = 1;
     if (app_init(app, &args, argv[0])) {
-        exit_code = app_run_loop(app);
+        exit_code = args.batch ? app_run_batch(app, model_paths, model_count) : app_run_loop(app);
     }
 
     app_cleanup(app);
     app_destroy(app);
+    free(model_paths);
     return exit_code;
 }
@@ -0,0 +1,398 @@
+#include "platform/file_watch.h"
+#include "platform/io.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <unistd.h>
+#endif
+
+// How long a burst of changes has to go quiet before file_watch_wait reports it
+#define FILE_WATCH_SETTLE_MS 25U
+#define FILE_WATCH_BUFFER_SIZE 16384U
+
+static char *duplicate_range(const char *text, const size_t length) {
+    char *copy = malloc(length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+static const char *last_separator(const char *path) {
+    const char *separator = strrchr(path, '/');
+#ifdef _WIN32
+    const char *backslash = strrchr(path, '\\');
+    if (!separator || (backslash && backslash > separator)) {
+        separator = backslash;
+    }
+#endif
+    return separator;
+}
+
+static void stat_file(WatchedFile *file, uint64_t *size, int64_t *mtime) {
+    if (!dcat_stat_file(file->path, size, mtime)) {
+        *size = 0;
+        *mtime = 0;
+    }
+}
+
+#if defined(_WIN32) || defined(__linux__)
+static void mark_name_changed(FileWatch *watch, const size_t directory, const char *name) {
+    for (size_t i = 0; i < watch->file_count; i++) {
+        WatchedFile *file = &watch->files[i];
+#ifdef _WIN32
+        const bool same = _stricmp(file->name, name) == 0;
+#else
+        const bool same = strcmp(file->name, name) == 0;
+#endif
+        if (file->directory == directory && same) {
+            file->changed = true;
+        }
+    }
+}
+#endif
+
+#ifdef _WIN32
+
+static void mark_directory_changed(FileWatch *watch, const size_t directory) {
+    for (size_t i = 0; i < watch->file_count; i++) {
+        if (watch->files[i].directory == directory) {
+            watch->files[i].changed = true;
+        }
+    }
+}
+
+static bool directory_watched(const WatchedDirectory *directory) {
+    return directory->pending;
+}
+
+static bool issue_directory_read(WatchedDirectory *directory) {
+    OVERLAPPED *overlapped = directory->overlapped;
+    memset(overlapped, 0, sizeof(*overlapped));
+    overlapped->hEvent = directory->event;
+    directory->pending = ReadDirectoryChangesW(
+                             directory->handle, directory->buffer, FILE_WATCH_BUFFER_SIZE, FALSE,
+                             FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE |
+                                 FILE_NOTIFY_CHANGE_LAST_WRITE,
+                             NULL, overlapped, NULL) != 0;
+    return directory->pending;
+}
+
+static void watch_directory(FileWatch *watch, WatchedDirectory *directory) {
+    directory->handle = INVALID_HANDLE_VALUE;
+    directory->pending = false;
+    // One wait covers every directory, so only that many get notifications
+    if (watch->directory_count >= MAXIMUM_WAIT_OBJECTS) {
+        return;
+    }
+    directory->overlapped = calloc(1, sizeof(OVERLAPPED));
+    directory->buffer = malloc(FILE_WATCH_BUFFER_SIZE);
+    directory->event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    directory->handle = CreateFileA(directory->path, FILE_LIST_DIRECTORY,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                    OPEN_EXISTING,
+                                    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (!directory->overlapped || !directory->buffer || !directory->event ||
+        directory->handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    issue_directory_read(directory);
+}
+
+static void unwatch_directory(WatchedDirectory *directory) {
+    if (directory->handle != INVALID_HANDLE_VALUE) {
+        if (directory->pending) {
+            CancelIoEx(directory->handle, directory->overlapped);
+            DWORD bytes = 0;
+            GetOverlappedResult(directory->handle, directory->overlapped, &bytes, TRUE);
+        }
+        CloseHandle(directory->handle);
+    }
+    if (directory->event) {
+        CloseHandle(directory->event);
+    }
+    free(directory->overlapped);
+    free(directory->buffer);
+}
+
+static void read_directory_changes(FileWatch *watch, const size_t index) {
+    WatchedDirectory *directory = &watch->directories[index];
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(directory->handle, directory->overlapped, &bytes, FALSE)) {
+        if (GetLastError() != ERROR_IO_INCOMPLETE) {
+            // The directory went away; its files fall back to polling
+            directory->pending = false;
+            mark_directory_changed(watch, index);
+        }
+        return;
+    }
+    ResetEvent(directory->event);
+    if (bytes == 0) {
+        // The buffer overflowed, so any file may have changed
+        mark_directory_changed(watch, index);
+    }
+    const char *cursor = directory->buffer;
+    for (DWORD offset = 0; bytes > 0;) {
+        const FILE_NOTIFY_INFORMATION *info = (const FILE_NOTIFY_INFORMATION *)(cursor + offset);
+        char name[MAX_PATH * 3];
+        const int length =
+            WideCharToMultiByte(CP_UTF8, 0, info->FileName,
+                                (int)(info->FileNameLength / sizeof(WCHAR)), name,
+                                (int)sizeof(name) - 1, NULL, NULL);
+        if (length > 0) {
+            name[length] = '\0';
+            mark_name_changed(watch, index, name);
+        }
+        if (info->NextEntryOffset == 0) {
+            break;
+        }
+        offset += info->NextEntryOffset;
+    }
+    if (!issue_directory_read(directory)) {
+        mark_directory_changed(watch, index);
+    }
+}
+
+static void wait_for_events(FileWatch *watch, const unsigned int timeout_ms) {
+    HANDLE events[MAXIMUM_WAIT_OBJECTS];
+    DWORD count = 0;
+    for (size_t i = 0; i < watch->directory_count && count < MAXIMUM_WAIT_OBJECTS; i++) {
+        if (watch->directories[i].pending) {
+            events[count++] = watch->directories[i].event;
+        }
+    }
+    if (count == 0) {
+        Sleep(timeout_ms);
+        return;
+    }
+    if (WaitForMultipleObjects(count, events, FALSE, timeout_ms) == WAIT_TIMEOUT) {
+        return;
+    }
+    for (size_t i = 0; i < watch->directory_count; i++) {
+        if (watch->directories[i].pending) {
+            read_directory_changes(watch, i);
+        }
+    }
+}
+
+#elif defined(__linux__)
+
+static bool directory_watched(const WatchedDirectory *directory) {
+    return directory->descriptor >= 0;
+}
+
+static void watch_directory(FileWatch *watch, WatchedDirectory *directory) {
+    directory->descriptor = -1;
+    if (watch->inotify_fd >= 0) {
+        // Closing after a write, or renaming into place, is when a file is complete
+        directory->descriptor =
+            inotify_add_watch(watch->inotify_fd, directory->path, IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+}
+
+static void unwatch_directory(WatchedDirectory *directory) {
+    (void)directory;
+}
+
+static void read_inotify_events(FileWatch *watch) {
+    char buffer[FILE_WATCH_BUFFER_SIZE]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        const ssize_t length = read(watch->inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        for (const char *cursor = buffer; cursor < buffer + length;) {
+            const struct inotify_event *event = (const struct inotify_event *)cursor;
+            if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                for (size_t i = 0; i < watch->file_count; i++) {
+                    watch->files[i].changed = true;
+                }
+            }
+            for (size_t i = 0; event->len > 0 && i < watch->directory_count; i++) {
+                if (watch->directories[i].descriptor == event->wd) {
+                    mark_name_changed(watch, i, event->name);
+                }
+            }
+            cursor += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+static void wait_for_events(FileWatch *watch, const unsigned int timeout_ms) {
+    if (watch->inotify_fd < 0) {
+        usleep(timeout_ms * 1000U);
+        return;
+    }
+    struct pollfd descriptor = {watch->inotify_fd, POLLIN, 0};
+    if (poll(&descriptor, 1, (int)timeout_ms) > 0) {
+        read_inotify_events(watch);
+    }
+}
+
+#else
+
+static bool directory_watched(const WatchedDirectory *directory) {
+    (void)directory;
+    return false;
+}
+
+static void watch_directory(FileWatch *watch, WatchedDirectory *directory) {
+    (void)watch;
+    directory->descriptor = -1;
+}
+
+static void unwatch_directory(WatchedDirectory *directory) {
+    (void)directory;
+}
+
+static void wait_for_events(FileWatch *watch, const unsigned int timeout_ms) {
+    (void)watch;
+    usleep(timeout_ms * 1000U);
+}
+
+#endif
+
+bool file_watch_init(FileWatch *watch) {
+    memset(watch, 0, sizeof(*watch));
+    watch->inotify_fd = -1;
+#if defined(__linux__)
+    // Without inotify every file is polled instead
+    watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    return true;
+}
+
+static bool find_directory(FileWatch *watch, const char *path, const size_t length,
+                           size_t *out_index) {
+    for (size_t i = 0; i < watch->directory_count; i++) {
+        if (strlen(watch->directories[i].path) == length &&
+            strncmp(watch->directories[i].path, path, length) == 0) {
+            *out_index = i;
+            return true;
+        }
+    }
+    WatchedDirectory *grown = realloc(watch->directories,
+                                      (watch->directory_count + 1) * sizeof(WatchedDirectory));
+    if (!grown) {
+        return false;
+    }
+    watch->directories = grown;
+    WatchedDirectory *directory = &watch->directories[watch->directory_count];
+    memset(directory, 0, sizeof(*directory));
+    directory->path = duplicate_range(path, length);
+    if (!directory->path) {
+        return false;
+    }
+    watch_directory(watch, directory);
+    *out_index = watch->directory_count++;
+    return true;
+}
+
+bool file_watch_add(FileWatch *watch, const char *path) {
+    for (size_t i = 0; i < watch->file_count; i++) {
+        if (strcmp(watch->files[i].path, path) == 0) {
+            return true;
+        }
+    }
+    const char *separator = last_separator(path);
+    const char *directory_path = separator ? path : ".";
+    size_t directory_length = separator ? (size_t)(separator - path) : 1U;
+    if (separator == path) {
+        directory_path = "/";
+        directory_length = 1;
+    }
+    size_t directory = 0;
+    if (!find_directory(watch, directory_path, directory_length, &directory)) {
+        return false;
+    }
+
+    WatchedFile *grown = realloc(watch->files, (watch->file_count + 1) * sizeof(WatchedFile));
+    if (!grown) {
+        return false;
+    }
+    watch->files = grown;
+    WatchedFile *file = &watch->files[watch->file_count];
+    memset(file, 0, sizeof(*file));
+    file->path = duplicate_range(path, strlen(path));
+    if (!file->path) {
+        return false;
+    }
+    file->name = separator ? file->path + (separator - path) + 1 : file->path;
+    file->directory = directory;
+    stat_file(file, &file->size, &file->mtime);
+    watch->file_count++;
+    return true;
+}
+
+// Waits up to `timeout_ms` for notifications, then polls the files no directory reports
+// on. True when any file was newly marked.
+static bool collect_changes(FileWatch *watch, const unsigned int timeout_ms) {
+    size_t before = 0;
+    for (size_t i = 0; i < watch->file_count; i++) {
+        before += watch->files[i].changed ? 1U : 0U;
+    }
+    wait_for_events(watch, timeout_ms);
+    size_t after = 0;
+    for (size_t i = 0; i < watch->file_count; i++) {
+        WatchedFile *file = &watch->files[i];
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        stat_file(file, &size, &mtime);
+        if (!directory_watched(&watch->directories[file->directory]) &&
+            (size != file->size || mtime != file->mtime)) {
+            file->changed = true;
+        }
+        file->size = size;
+        file->mtime = mtime;
+        after += file->changed ? 1U : 0U;
+    }
+    return after > before;
+}
+
+size_t file_watch_wait(FileWatch *watch, const unsigned int timeout_ms) {
+    for (size_t i = 0; i < watch->file_count; i++) {
+        watch->files[i].changed = false;
+    }
+    if (collect_changes(watch, timeout_ms)) {
+        while (collect_changes(watch, FILE_WATCH_SETTLE_MS)) {
+        }
+    }
+    size_t changed = 0;
+    for (size_t i = 0; i < watch->file_count; i++) {
+        changed += watch->files[i].changed ? 1U : 0U;
+    }
+    return changed;
+}
+
+void file_watch_free(FileWatch *watch) {
+    for (size_t i = 0; i < watch->directory_count; i++) {
+        unwatch_directory(&watch->directories[i]);
+        free(watch->directories[i].path);
+    }
+    for (size_t i = 0; i < watch->file_count; i++) {
+        free(watch->files[i].path);
+    }
+    free(watch->directories);
+    free(watch->files);
+#if defined(__linux__)
+    if (watch->inotify_fd >= 0) {
+        close(watch->inotify_fd);
+    }
+#endif
+    memset(watch, 0, sizeof(*watch));
+    watch->inotify_fd = -1;
+}
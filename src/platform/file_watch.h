@@ -0,0 +1,49 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Watches files for --watch through their directories: inotify on Linux,
+// ReadDirectoryChangesW on Windows, and polling their size and modification time elsewhere.
+// A file replaced by renaming over it, as many editors save, still counts as changed.
+
+typedef struct WatchedFile {
+    char *path;
+    // Within `path`, the part its directory reports changes under
+    const char *name;
+    size_t directory;
+    // Set by file_watch_wait when the file changed since the call before
+    bool changed;
+    uint64_t size;
+    int64_t mtime;
+} WatchedFile;
+
+typedef struct WatchedDirectory {
+    char *path;
+#ifdef _WIN32
+    void *handle;
+    void *event;
+    void *overlapped;
+    void *buffer;
+    bool pending;
+#else
+    int descriptor;
+#endif
+} WatchedDirectory;
+
+typedef struct FileWatch {
+    WatchedFile *files;
+    size_t file_count;
+    WatchedDirectory *directories;
+    size_t directory_count;
+    int inotify_fd;
+} FileWatch;
+
+bool file_watch_init(FileWatch *watch);
+// Adds `path`, which need not exist yet; adding a file twice watches it once
+bool file_watch_add(FileWatch *watch, const char *path);
+// Blocks until a watched file may have changed or `timeout_ms` passes, then marks the files
+// that changed since the last call and returns how many did. Changes arriving in a burst,
+// such as the writes of one save, are collected into the same call.
+size_t file_watch_wait(FileWatch *watch, unsigned int timeout_ms);
+void file_watch_free(FileWatch *watch);
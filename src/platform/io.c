@@ -1,7 +1,11 @@
 #include "platform/io.h"
 
+#include <fcntl.h>
+
 #ifdef _WIN32
 #include <limits.h>
+#include <sys/stat.h>
+#include <windows.h>
 
 int dcat_isatty(const int fd) {
     return _isatty(fd);
@@ -31,6 +35,10 @@ ssize_t dcat_write(const int fd, const void *buffer, const size_t size) {
     return (ssize_t)total_written;
 }
 
+int dcat_open_write(const char *path) {
+    return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
 int dcat_close(const int fd) {
     return _close(fd);
 }
@@ -39,7 +47,48 @@ int dcat_getpid(void) {
     return _getpid();
 }
 
+bool dcat_stat_file(const char *path, uint64_t *out_size, int64_t *out_mtime) {
+    struct _stat64 st;
+    if (_stat64(path, &st) != 0 || !(st.st_mode & _S_IFREG)) {
+        return false;
+    }
+    *out_size = (uint64_t)st.st_size;
+    *out_mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+const void *dcat_map_file(const char *path, size_t *out_size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    LARGE_INTEGER size;
+    const void *data = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 &&
+        (uint64_t)size.QuadPart <= (uint64_t)SIZE_MAX) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            // The view keeps the mapping alive
+            CloseHandle(mapping);
+            *out_size = (size_t)size.QuadPart;
+        }
+    }
+    CloseHandle(file);
+    return data;
+}
+
+void dcat_unmap_file(const void *data, const size_t size) {
+    (void)size;
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+}
+
 #else
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 int dcat_isatty(const int fd) {
     return isatty(fd);
@@ -53,6 +102,14 @@ ssize_t dcat_write(const int fd, const void *buffer, const size_t size) {
     return write(fd, buffer, size);
 }
 
+int dcat_open_write(const char *path) {
+#ifdef O_CLOEXEC
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#else
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+}
+
 int dcat_close(const int fd) {
     return close(fd);
 }
@@ -61,4 +118,44 @@ int dcat_getpid(void) {
     return getpid();
 }
 
+bool dcat_stat_file(const char *path, uint64_t *out_size, int64_t *out_mtime) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    *out_size = (uint64_t)st.st_size;
+    *out_mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+const void *dcat_map_file(const char *path, size_t *out_size) {
+#ifdef O_CLOEXEC
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+#else
+    const int fd = open(path, O_RDONLY);
+#endif
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    void *data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (uint64_t)st.st_size <= (uint64_t)SIZE_MAX) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        } else {
+            *out_size = (size_t)st.st_size;
+        }
+    }
+    // The mapping outlives the descriptor
+    close(fd);
+    return data;
+}
+
+void dcat_unmap_file(const void *data, const size_t size) {
+    if (data) {
+        munmap((void *)data, size);
+    }
+}
+
 #endif
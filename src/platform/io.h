@@ -1,5 +1,7 @@
 #pragma once
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef _WIN32
 #ifndef WIN32_LEAN_AND_MEAN
@@ -31,5 +33,12 @@ typedef SSIZE_T ssize_t;
 int dcat_isatty(int fd);
 ssize_t dcat_read(int fd, void *buffer, size_t size);
 ssize_t dcat_write(int fd, const void *buffer, size_t size);
+// Creates or truncates `path` for binary writing; returns -1 on failure.
+int dcat_open_write(const char *path);
 int dcat_close(int fd);
 int dcat_getpid(void);
+// Size in bytes and modification time in seconds since the epoch of a regular file.
+bool dcat_stat_file(const char *path, uint64_t *out_size, int64_t *out_mtime);
+// Maps `path` read-only into memory; NULL when it is missing, empty or cannot be mapped.
+const void *dcat_map_file(const char *path, size_t *out_size);
+void dcat_unmap_file(const void *data, size_t size);
@@ -0,0 +1,320 @@
+#include "platform/net.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include <limits.h>
+
+typedef int SocketLength;
+#define SHUTDOWN_BOTH SD_BOTH
+#define SEND_FLAGS 0
+#define close_socket closesocket
+#define poll_sockets WSAPoll
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef socklen_t SocketLength;
+#define SHUTDOWN_BOTH SHUT_RDWR
+// Writing to a client that went away must fail, not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+#define close_socket close
+#define poll_sockets poll
+#endif
+
+#define UNIX_PREFIX "unix:"
+#define UNIX_PREFIX_LENGTH 5U
+#define HOST_MAX 256U
+#define PORT_MAX 16U
+
+bool dcat_net_init(void) {
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+        fprintf(stderr, "Failed to initialize Winsock\n");
+        return false;
+    }
+#endif
+    return true;
+}
+
+void dcat_net_cleanup(void) {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+static bool is_unix_address(const char *address) {
+    return strncmp(address, UNIX_PREFIX, UNIX_PREFIX_LENGTH) == 0;
+}
+
+// Splits "HOST:PORT", "[HOST]:PORT" or ":PORT" at its last colon
+static bool split_host_port(const char *address, char *host, char *port) {
+    const char *colon = strrchr(address, ':');
+    if (!colon || colon[1] == '\0' || strlen(colon + 1) >= PORT_MAX) {
+        return false;
+    }
+    const char *host_start = address;
+    size_t host_length = (size_t)(colon - address);
+    if (host_length >= 2U && address[0] == '[' && colon[-1] == ']') {
+        host_start++;
+        host_length -= 2U;
+    }
+    if (host_length >= HOST_MAX) {
+        return false;
+    }
+    memcpy(host, host_start, host_length);
+    host[host_length] = '\0';
+    strcpy(port, colon + 1);
+    return true;
+}
+
+// A signal such as SIGWINCH interrupted the call, which is then simply retried
+static bool interrupted(void) {
+#ifdef _WIN32
+    return false;
+#else
+    return errno == EINTR;
+#endif
+}
+
+static void configure_stream(const DcatSocket socket) {
+    // Frames go out whole; waiting to coalesce their last segment only adds latency. Fails
+    // harmlessly on a Unix socket.
+    int enabled = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&enabled, sizeof(enabled));
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+}
+
+#ifndef _WIN32
+static bool fill_unix_address(const char *address, struct sockaddr_un *out) {
+    const char *path = address + UNIX_PREFIX_LENGTH;
+    memset(out, 0, sizeof(*out));
+    out->sun_family = AF_UNIX;
+    if (path[0] == '\0' || strlen(path) >= sizeof(out->sun_path)) {
+        fprintf(stderr, "Invalid Unix socket path: %s\n", path);
+        return false;
+    }
+    strcpy(out->sun_path, path);
+    return true;
+}
+
+static DcatSocket open_unix(const char *address, const bool listening) {
+    struct sockaddr_un unix_address;
+    if (!fill_unix_address(address, &unix_address)) {
+        return DCAT_INVALID_SOCKET;
+    }
+    const DcatSocket fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == DCAT_INVALID_SOCKET) {
+        perror("socket");
+        return DCAT_INVALID_SOCKET;
+    }
+    const struct sockaddr *generic = (const struct sockaddr *)&unix_address;
+    if (listening) {
+        unlink(unix_address.sun_path);
+        if (bind(fd, generic, sizeof(unix_address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+            fprintf(stderr, "Failed to listen on %s: ", address);
+            perror(NULL);
+            close(fd);
+            return DCAT_INVALID_SOCKET;
+        }
+    } else if (connect(fd, generic, sizeof(unix_address)) != 0) {
+        fprintf(stderr, "Failed to connect to %s: ", address);
+        perror(NULL);
+        close(fd);
+        return DCAT_INVALID_SOCKET;
+    }
+    if (!listening) {
+        configure_stream(fd);
+    }
+    return fd;
+}
+#endif
+
+static DcatSocket open_tcp(const char *address, const bool listening) {
+    char host[HOST_MAX];
+    char port[PORT_MAX];
+    if (!split_host_port(address, host, port)) {
+        fprintf(stderr, "Invalid address: %s (must be HOST:PORT or unix:PATH)\n", address);
+        return DCAT_INVALID_SOCKET;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    const char *node = host[0] != '\0' ? host : (listening ? NULL : "localhost");
+    struct addrinfo *results = NULL;
+    const int status = getaddrinfo(node, port, &hints, &results);
+    if (status != 0) {
+        fprintf(stderr, "Failed to resolve %s: %s\n", address, gai_strerror(status));
+        return DCAT_INVALID_SOCKET;
+    }
+
+    DcatSocket fd = DCAT_INVALID_SOCKET;
+    for (const struct addrinfo *info = results; info; info = info->ai_next) {
+        fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        if (fd == DCAT_INVALID_SOCKET) {
+            continue;
+        }
+        bool ok = false;
+        if (listening) {
+            int enabled = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char *)&enabled, sizeof(enabled));
+            ok = bind(fd, info->ai_addr, (SocketLength)info->ai_addrlen) == 0 &&
+                 listen(fd, SOMAXCONN) == 0;
+        } else {
+            ok = connect(fd, info->ai_addr, (SocketLength)info->ai_addrlen) == 0;
+        }
+        if (ok) {
+            break;
+        }
+        close_socket(fd);
+        fd = DCAT_INVALID_SOCKET;
+    }
+    freeaddrinfo(results);
+
+    if (fd == DCAT_INVALID_SOCKET) {
+        fprintf(stderr, "Failed to %s %s\n", listening ? "listen on" : "connect to", address);
+        return DCAT_INVALID_SOCKET;
+    }
+    if (!listening) {
+        configure_stream(fd);
+    }
+    return fd;
+}
+
+static DcatSocket open_address(const char *address, const bool listening) {
+    if (is_unix_address(address)) {
+#ifdef _WIN32
+        fprintf(stderr, "Unix sockets are not supported on Windows: %s\n", address);
+        return DCAT_INVALID_SOCKET;
+#else
+        return open_unix(address, listening);
+#endif
+    }
+    return open_tcp(address, listening);
+}
+
+DcatSocket dcat_net_listen(const char *address) {
+    return open_address(address, true);
+}
+
+DcatSocket dcat_net_connect(const char *address) {
+    return open_address(address, false);
+}
+
+DcatSocket dcat_net_accept(const DcatSocket listener) {
+    const DcatSocket fd = accept(listener, NULL, NULL);
+    if (fd != DCAT_INVALID_SOCKET) {
+        configure_stream(fd);
+    }
+    return fd;
+}
+
+uint16_t dcat_net_local_port(const DcatSocket socket) {
+    struct sockaddr_storage address;
+    SocketLength length = sizeof(address);
+    if (getsockname(socket, (struct sockaddr *)&address, &length) != 0) {
+        return 0;
+    }
+    if (address.ss_family == AF_INET) {
+        return ntohs(((const struct sockaddr_in *)&address)->sin_port);
+    }
+    if (address.ss_family == AF_INET6) {
+        return ntohs(((const struct sockaddr_in6 *)&address)->sin6_port);
+    }
+    return 0;
+}
+
+bool dcat_net_send_all(const DcatSocket socket, const void *data, const size_t size) {
+    const char *cursor = (const char *)data;
+    size_t remaining = size;
+    while (remaining > 0) {
+#ifdef _WIN32
+        const int chunk = remaining > INT_MAX ? INT_MAX : (int)remaining;
+#else
+        const size_t chunk = remaining;
+#endif
+        const ptrdiff_t sent = (ptrdiff_t)send(socket, cursor, chunk, SEND_FLAGS);
+        if (sent < 0 && interrupted()) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        cursor += sent;
+        remaining -= (size_t)sent;
+    }
+    return true;
+}
+
+bool dcat_net_recv_all(const DcatSocket socket, void *data, const size_t size) {
+    char *cursor = (char *)data;
+    size_t remaining = size;
+    while (remaining > 0) {
+#ifdef _WIN32
+        const int chunk = remaining > INT_MAX ? INT_MAX : (int)remaining;
+#else
+        const size_t chunk = remaining;
+#endif
+        const ptrdiff_t received = (ptrdiff_t)recv(socket, cursor, chunk, 0);
+        if (received < 0 && interrupted()) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        cursor += received;
+        remaining -= (size_t)received;
+    }
+    return true;
+}
+
+int dcat_net_wait_readable(const DcatSocket socket, const unsigned int timeout_ms) {
+    struct pollfd entry = {.fd = socket, .events = POLLIN};
+    const int ready = poll_sockets(&entry, 1, (int)timeout_ms);
+    if (ready < 0) {
+        return interrupted() ? 0 : -1;
+    }
+    return ready > 0 ? 1 : 0;
+}
+
+void dcat_net_shutdown(const DcatSocket socket) {
+    shutdown(socket, SHUTDOWN_BOTH);
+}
+
+void dcat_net_close(const DcatSocket socket) {
+    close_socket(socket);
+}
+
+void dcat_net_release_address(const char *address) {
+#ifndef _WIN32
+    if (is_unix_address(address)) {
+        unlink(address + UNIX_PREFIX_LENGTH);
+    }
+#else
+    (void)address;
+#endif
+}
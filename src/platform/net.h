@@ -0,0 +1,41 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream sockets for --serve and --connect. An address is "unix:PATH" for a Unix domain
+// socket (not on Windows) or "HOST:PORT" for TCP; to listen, an empty HOST means every
+// interface, and to connect, localhost.
+
+#ifdef _WIN32
+typedef uintptr_t DcatSocket;
+#define DCAT_INVALID_SOCKET (~(DcatSocket)0)
+#else
+typedef int DcatSocket;
+#define DCAT_INVALID_SOCKET (-1)
+#endif
+
+// Once per process before any other call (WSAStartup on Windows)
+bool dcat_net_init(void);
+void dcat_net_cleanup(void);
+
+// Both print why to stderr and return DCAT_INVALID_SOCKET on failure. Listening on a Unix
+// socket replaces a file left at PATH by an earlier run.
+DcatSocket dcat_net_listen(const char *address);
+DcatSocket dcat_net_connect(const char *address);
+// Blocks until a client connects; DCAT_INVALID_SOCKET once the listener is shut down
+DcatSocket dcat_net_accept(DcatSocket listener);
+// The TCP port the socket is bound to, e.g. after listening on port 0; 0 for a Unix socket
+uint16_t dcat_net_local_port(DcatSocket socket);
+
+// Both false once the peer is gone or the socket is shut down
+bool dcat_net_send_all(DcatSocket socket, const void *data, size_t size);
+bool dcat_net_recv_all(DcatSocket socket, void *data, size_t size);
+// 1 once the socket is readable (or the peer closed), 0 after timeout_ms, -1 on error
+int dcat_net_wait_readable(DcatSocket socket, unsigned int timeout_ms);
+
+// Makes accept, send and recv on `socket` return, in any thread
+void dcat_net_shutdown(DcatSocket socket);
+void dcat_net_close(DcatSocket socket);
+// Removes the file a Unix socket listening on `address` left behind; a no-op for TCP
+void dcat_net_release_address(const char *address);
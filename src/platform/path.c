@@ -1,5 +1,8 @@
 #include "platform/path.h"
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -8,6 +11,7 @@
 #endif
 #include <windows.h>
 #else
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
@@ -56,3 +60,70 @@ bool dcat_get_executable_directory(char *out, const size_t out_size) {
     last_separator[1] = '\0';
     return true;
 }
+
+static bool make_directory(const char *path) {
+#ifdef _WIN32
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0700) == 0 || errno == EEXIST;
+#endif
+}
+
+bool dcat_get_cache_directory(char *out, const size_t out_size) {
+    if (!out || out_size == 0) {
+        return false;
+    }
+    out[0] = '\0';
+
+    // Windows accepts '/' as well, so one separator serves both platforms
+#ifdef _WIN32
+    const char *base = getenv("LOCALAPPDATA");
+    const char *suffix = "";
+#else
+    const char *base = getenv("XDG_CACHE_HOME");
+    const char *suffix = "";
+    if (!base || base[0] != '/') {
+        base = getenv("HOME");
+        suffix = "/.cache";
+    }
+#endif
+    if (!base || !base[0]) {
+        return false;
+    }
+
+    const int base_len = snprintf(out, out_size, "%s%s", base, suffix);
+    if (base_len < 0 || (size_t)base_len >= out_size || !make_directory(out)) {
+        out[0] = '\0';
+        return false;
+    }
+    const int len = snprintf(out, out_size, "%s%s/dcat", base, suffix);
+    if (len < 0 || (size_t)len + 1 >= out_size || !make_directory(out)) {
+        out[0] = '\0';
+        return false;
+    }
+    out[len] = '/';
+    out[len + 1] = '\0';
+    return true;
+}
+
+bool dcat_get_absolute_path(const char *path, char *out, const size_t out_size) {
+    if (!path || !out || out_size == 0) {
+        return false;
+    }
+    out[0] = '\0';
+#ifdef _WIN32
+    return _fullpath(out, path, out_size) != NULL;
+#else
+    char *resolved = realpath(path, NULL);
+    if (!resolved) {
+        return false;
+    }
+    const int len = snprintf(out, out_size, "%s", resolved);
+    free(resolved);
+    if (len < 0 || (size_t)len >= out_size) {
+        out[0] = '\0';
+        return false;
+    }
+    return true;
+#endif
+}
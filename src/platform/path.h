@@ -4,3 +4,8 @@
 
 bool dcat_get_executable_path(char *out, size_t out_size);
 bool dcat_get_executable_directory(char *out, size_t out_size);
+// Per-user cache directory for dcat ("<cache>/dcat/" with a trailing separator), created
+// if missing: $XDG_CACHE_HOME or ~/.cache on POSIX, %LOCALAPPDATA% on Windows.
+bool dcat_get_cache_directory(char *out, size_t out_size);
+// Absolute, symlink-free form of an existing `path`.
+bool dcat_get_absolute_path(const char *path, char *out, size_t out_size);
@@ -0,0 +1,944 @@
+#include "cpu_rasterizer.h"
+#include "../graphics/skydome.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Vertices transformed per vertex-stage task
+#define VERTEX_BLOCK_SIZE 4096U
+// Screen positions carry 8 fractional bits
+#define SUBPIXEL_BITS 8
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE / 2)
+// Clipping keeps x and y within this many half-viewports of the centre, which bounds the
+// fixed-point coordinates and the edge function products
+#define GUARD_BAND 8.0F
+#define CLIP_PLANE_COUNT 5
+// A triangle gains at most one vertex per clip plane
+#define MAX_CLIP_VERTICES (3 + CLIP_PLANE_COUNT)
+// Marks a triangle vertex as one of its chunk's clipped vertices
+#define CLIPPED_VERTEX_BIT 0x80000000U
+
+// Which pipeline a triangle is drawn with
+enum { TRIANGLE_OPAQUE, TRIANGLE_BLEND };
+
+// Interpolated fragment shader inputs
+typedef struct Fragment {
+    float uv[2];
+    vec3 world;
+    vec3 normal;
+    vec3 tangent;
+    vec3 bitangent;
+} Fragment;
+
+static float srgb_decode(const float c) {
+    return c <= 0.04045F ? c / 12.92F : powf((c + 0.055F) / 1.055F, 2.4F);
+}
+
+static bool texture_is_valid(const Texture *texture) {
+    return (texture && texture->data && texture->width > 0 && texture->height > 0 &&
+            texture->data_size >= (size_t)texture->width * texture->height * 4) != 0;
+}
+
+static void free_chunks(CpuRasterizer *r) {
+    const uint32_t tile_count = r->tiles_x * r->tiles_y;
+    for (uint32_t c = 0; c < r->chunk_count; c++) {
+        CpuChunk *chunk = &r->chunks[c];
+        ARRAY_FREE(chunk->triangles);
+        ARRAY_FREE(chunk->clipped);
+        if (chunk->bins) {
+            for (uint32_t t = 0; t < tile_count; t++) {
+                ARRAY_FREE(chunk->bins[t]);
+            }
+            free(chunk->bins);
+            chunk->bins = NULL;
+        }
+    }
+}
+
+bool cpu_rasterizer_init(CpuRasterizer *r, const uint32_t thread_count) {
+    memset(r, 0, sizeof(*r));
+    if (!worker_pool_init(&r->pool, thread_count)) {
+        return false;
+    }
+    r->pool_started = true;
+
+    // One setup chunk per thread, including the calling one
+    r->chunk_count = r->pool.thread_count + 1;
+    r->chunks = calloc(r->chunk_count, sizeof(CpuChunk));
+    texture_init_default(&r->fallback_diffuse);
+    texture_create_flat_normal_map(&r->fallback_normal);
+    if (!r->chunks || !r->fallback_diffuse.data || !r->fallback_normal.data) {
+        cpu_rasterizer_destroy(r);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+        r->unorm_to_float[i] = (float)i / 255.0F;
+        r->srgb_to_linear[i] = srgb_decode(r->unorm_to_float[i]);
+    }
+    return true;
+}
+
+bool cpu_rasterizer_resize(CpuRasterizer *r, const uint32_t width, const uint32_t height) {
+    free_chunks(r);
+    free(r->depth);
+    r->depth = NULL;
+    free(r->sky);
+    r->sky = NULL;
+    r->sky_valid = false;
+    r->width = width;
+    r->height = height;
+    r->tiles_x = (width + CPU_TILE_SIZE - 1U) / CPU_TILE_SIZE;
+    r->tiles_y = (height + CPU_TILE_SIZE - 1U) / CPU_TILE_SIZE;
+    if (width == 0 || height == 0) {
+        return true;
+    }
+
+    const uint32_t tile_count = r->tiles_x * r->tiles_y;
+    r->depth = malloc((size_t)width * height * sizeof(float));
+    r->sky = malloc((size_t)width * height * 4);
+    if (!r->depth || !r->sky) {
+        return false;
+    }
+    for (uint32_t c = 0; c < r->chunk_count; c++) {
+        r->chunks[c].bins = calloc(tile_count, sizeof(Uint32Array));
+        if (!r->chunks[c].bins) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void cpu_rasterizer_destroy(CpuRasterizer *r) {
+    if (r->pool_started) {
+        worker_pool_destroy(&r->pool);
+        r->pool_started = false;
+    }
+    if (r->chunks) {
+        free_chunks(r);
+        free(r->chunks);
+        r->chunks = NULL;
+    }
+    free(r->depth);
+    r->depth = NULL;
+    free(r->sky);
+    r->sky = NULL;
+    ARRAY_FREE(r->vertices);
+    ARRAY_FREE(r->ranges);
+    texture_free(&r->fallback_diffuse);
+    texture_free(&r->fallback_normal);
+}
+
+// --- Vertex stage ---
+
+// out = m * (p, w); out must not alias p
+static void transform_point(mat4 m, const float p[3], const float w, float out[4]) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (m[0][i] * p[0]) + (m[1][i] * p[1]) + (m[2][i] * p[2]) + (m[3][i] * w);
+    }
+}
+
+// Weighted sum of the vertex's bone matrices, like the skinned vertex shader. Returns false
+// when no weight lands on a bone of this skeleton, leaving the vertex in its bind pose.
+static bool bone_transform(const CpuFrame *frame, const Vertex *v, mat4 out) {
+    glm_mat4_zero(out);
+    float total = 0.0F;
+    for (int i = 0; i < 4; i++) {
+        const int id = v->bone_ids[i];
+        if (id < 0 || (uint32_t)id >= frame->bone_count || v->bone_weights[i] == 0.0F) {
+            continue;
+        }
+        mat4 weighted;
+        glm_mat4_scale_p((vec4 *)frame->bone_matrices[id], v->bone_weights[i], weighted);
+        glm_mat4_add(out, weighted, out);
+        total += v->bone_weights[i];
+    }
+    return total > 0.0F;
+}
+
+static void transform_mesh_vertex(const CpuFrame *frame, const Vertex *v, CpuVertex *out) {
+    float position[4] = {v->position[0], v->position[1], v->position[2], 1.0F};
+    float normal[4] = {v->normal[0], v->normal[1], v->normal[2], 0.0F};
+    float tangent[4] = {v->tangent[0], v->tangent[1], v->tangent[2], 0.0F};
+    float bitangent[4] = {v->bitangent[0], v->bitangent[1], v->bitangent[2], 0.0F};
+
+    mat4 bones;
+    if (frame->bone_matrices != NULL && bone_transform(frame, v, bones)) {
+        transform_point(bones, v->position, 1.0F, position);
+        transform_point(bones, v->normal, 0.0F, normal);
+        transform_point(bones, v->tangent, 0.0F, tangent);
+        transform_point(bones, v->bitangent, 0.0F, bitangent);
+    }
+
+    vec4 *model = (vec4 *)frame->model;
+    float world[4];
+    transform_point((vec4 *)frame->mvp, position, position[3], out->clip);
+    transform_point(model, position, position[3], world);
+    memcpy(out->world, world, sizeof(out->world));
+    transform_point(model, normal, 0.0F, world);
+    memcpy(out->normal, world, sizeof(out->normal));
+    transform_point(model, tangent, 0.0F, world);
+    memcpy(out->tangent, world, sizeof(out->tangent));
+    transform_point(model, bitangent, 0.0F, world);
+    memcpy(out->bitangent, world, sizeof(out->bitangent));
+    memcpy(out->uv, v->texcoord, sizeof(out->uv));
+}
+
+static void transform_vertex_block(void *context, const uint32_t index) {
+    CpuRasterizer *r = context;
+    const CpuFrame *frame = r->frame;
+    const size_t first = (size_t)index * VERTEX_BLOCK_SIZE;
+    size_t last = first + VERTEX_BLOCK_SIZE;
+    if (last > r->vertices.count) {
+        last = r->vertices.count;
+    }
+
+    for (size_t i = first; i < last; i++) {
+        transform_mesh_vertex(frame, &frame->mesh->vertices.data[i], &r->vertices.data[i]);
+    }
+}
+
+// --- Triangle setup ---
+
+static void push_range(CpuRasterizer *r, const uint32_t *indices, const uint32_t index_count,
+                       const uint32_t vertex_base, const uint32_t vertex_count,
+                       const uint32_t material, const uint32_t kind) {
+    const CpuRange range = {indices,    vertex_base, vertex_count, r->triangle_count,
+                            index_count / 3, material, kind};
+    if (range.triangle_count == 0) {
+        return;
+    }
+    ARRAY_PUSH(r->ranges, range);
+    r->triangle_count += range.triangle_count;
+}
+
+// The draw list in its recorded order
+static void build_ranges(CpuRasterizer *r) {
+    const CpuFrame *frame = r->frame;
+    r->ranges.count = 0;
+    r->triangle_count = 0;
+    if (!frame->mesh || !frame->draws) {
+        return;
+    }
+
+    const Uint32Array *indices = &frame->mesh->indices;
+    for (size_t b = 0; b < frame->draws->batches.count; b++) {
+        const DrawBatch *batch = &frame->draws->batches.data[b];
+        const uint32_t kind = batch->pass == DRAW_PASS_BLEND ? TRIANGLE_BLEND : TRIANGLE_OPAQUE;
+        for (uint32_t c = 0; c < batch->command_count; c++) {
+            const DrawCommand *cmd = &frame->draws->commands.data[batch->first_command + c];
+            if (cmd->first_index > indices->count ||
+                cmd->index_count > indices->count - cmd->first_index ||
+                cmd->first_instance >= frame->material_count) {
+                continue;
+            }
+            push_range(r, indices->data + cmd->first_index, cmd->index_count, 0,
+                       r->mesh_vertex_count, cmd->first_instance, kind);
+        }
+    }
+}
+
+static const CpuVertex *chunk_vertex(const CpuRasterizer *r, const CpuChunk *chunk,
+                                     const uint32_t ref) {
+    return (ref & CLIPPED_VERTEX_BIT) != 0 ? &chunk->clipped.data[ref & ~CLIPPED_VERTEX_BIT]
+                                           : &r->vertices.data[ref];
+}
+
+static float clip_distance(const float clip[4], const uint32_t plane) {
+    switch (plane) {
+    case 0:
+        return clip[2];
+    case 1:
+        return (GUARD_BAND * clip[3]) - clip[0];
+    case 2:
+        return (GUARD_BAND * clip[3]) + clip[0];
+    case 3:
+        return (GUARD_BAND * clip[3]) - clip[1];
+    default:
+        return (GUARD_BAND * clip[3]) + clip[1];
+    }
+}
+
+static uint32_t clip_outcode(const float clip[4]) {
+    uint32_t code = 0;
+    for (uint32_t p = 0; p < CLIP_PLANE_COUNT; p++) {
+        if (clip_distance(clip, p) < 0.0F) {
+            code |= 1U << p;
+        }
+    }
+    return code;
+}
+
+// Outside the viewport, beside, behind or past the far plane rather than the guard band
+static uint32_t view_outcode(const float clip[4]) {
+    return (clip[0] > clip[3] ? 1U : 0U) | (clip[0] < -clip[3] ? 2U : 0U) |
+           (clip[1] > clip[3] ? 4U : 0U) | (clip[1] < -clip[3] ? 8U : 0U) |
+           (clip[2] < 0.0F ? 16U : 0U) | (clip[2] > clip[3] ? 32U : 0U);
+}
+
+static void lerp_floats(float *out, const float *a, const float *b, const size_t n,
+                        const float t) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = a[i] + ((b[i] - a[i]) * t);
+    }
+}
+
+static void lerp_vertex(const CpuVertex *a, const CpuVertex *b, const float t, CpuVertex *out) {
+    lerp_floats(out->clip, a->clip, b->clip, 4, t);
+    lerp_floats(out->world, a->world, b->world, 3, t);
+    lerp_floats(out->normal, a->normal, b->normal, 3, t);
+    lerp_floats(out->tangent, a->tangent, b->tangent, 3, t);
+    lerp_floats(out->bitangent, a->bitangent, b->bitangent, 3, t);
+    lerp_floats(out->uv, a->uv, b->uv, 2, t);
+}
+
+static int32_t floor_div(const int32_t a, const int32_t b) {
+    return (a / b) - ((a % b) < 0 ? 1 : 0);
+}
+
+static int32_t min_i32(const int32_t a, const int32_t b) {
+    return a < b ? a : b;
+}
+
+static int32_t max_i32(const int32_t a, const int32_t b) {
+    return a > b ? a : b;
+}
+
+static int32_t clamp_i32(const int32_t v, const int32_t lo, const int32_t hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Projects a clipped triangle to the screen, orients it and bins it into the tiles it covers.
+static void emit_triangle(const CpuRasterizer *r, CpuChunk *chunk, const uint32_t refs[3],
+                          const uint32_t material, const uint32_t kind) {
+    CpuTriangle tri = {.material = material, .kind = kind};
+    const float scale_x = 0.5F * (float)r->width * (float)SUBPIXEL_ONE;
+    const float scale_y = 0.5F * (float)r->height * (float)SUBPIXEL_ONE;
+    for (int k = 0; k < 3; k++) {
+        const CpuVertex *v = chunk_vertex(r, chunk, refs[k]);
+        const float inv_w = 1.0F / v->clip[3];
+        tri.vertices[k] = refs[k];
+        tri.x[k] = (int32_t)lrintf(((v->clip[0] * inv_w) + 1.0F) * scale_x);
+        tri.y[k] = (int32_t)lrintf(((v->clip[1] * inv_w) + 1.0F) * scale_y);
+        tri.z[k] = v->clip[2] * inv_w;
+        tri.inv_w[k] = inv_w;
+    }
+
+    tri.area = ((int64_t)(tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0])) -
+               ((int64_t)(tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]));
+    // A negative area is counter-clockwise in framebuffer space, the front face
+    if (tri.area == 0 || (tri.area > 0 && r->frame->cull_backfaces)) {
+        return;
+    }
+    if (tri.area < 0) {
+        // Keep every triangle's edge functions positive inside
+        const uint32_t ref = tri.vertices[1];
+        const int32_t x = tri.x[1];
+        const int32_t y = tri.y[1];
+        const float z = tri.z[1];
+        const float inv_w = tri.inv_w[1];
+        tri.vertices[1] = tri.vertices[2];
+        tri.x[1] = tri.x[2];
+        tri.y[1] = tri.y[2];
+        tri.z[1] = tri.z[2];
+        tri.inv_w[1] = tri.inv_w[2];
+        tri.vertices[2] = ref;
+        tri.x[2] = x;
+        tri.y[2] = y;
+        tri.z[2] = z;
+        tri.inv_w[2] = inv_w;
+        tri.area = -tri.area;
+    }
+
+    const int32_t min_x = min_i32(tri.x[0], min_i32(tri.x[1], tri.x[2]));
+    const int32_t max_x = max_i32(tri.x[0], max_i32(tri.x[1], tri.x[2]));
+    const int32_t min_y = min_i32(tri.y[0], min_i32(tri.y[1], tri.y[2]));
+    const int32_t max_y = max_i32(tri.y[0], max_i32(tri.y[1], tri.y[2]));
+    if (r->frame->wireframe && kind == TRIANGLE_OPAQUE) {
+        // Lines light the pixel their centre line passes through
+        tri.min_x = floor_div(min_x, SUBPIXEL_ONE);
+        tri.max_x = floor_div(max_x, SUBPIXEL_ONE);
+        tri.min_y = floor_div(min_y, SUBPIXEL_ONE);
+        tri.max_y = floor_div(max_y, SUBPIXEL_ONE);
+    } else {
+        // Pixels whose centres fall inside the bounds
+        tri.min_x = floor_div(min_x - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE);
+        tri.max_x = floor_div(max_x - SUBPIXEL_HALF, SUBPIXEL_ONE);
+        tri.min_y = floor_div(min_y - SUBPIXEL_HALF + SUBPIXEL_ONE - 1, SUBPIXEL_ONE);
+        tri.max_y = floor_div(max_y - SUBPIXEL_HALF, SUBPIXEL_ONE);
+    }
+    tri.min_x = clamp_i32(tri.min_x, 0, (int32_t)r->width);
+    tri.max_x = clamp_i32(tri.max_x, -1, (int32_t)r->width - 1);
+    tri.min_y = clamp_i32(tri.min_y, 0, (int32_t)r->height);
+    tri.max_y = clamp_i32(tri.max_y, -1, (int32_t)r->height - 1);
+    if (tri.min_x > tri.max_x || tri.min_y > tri.max_y) {
+        return;
+    }
+
+    const uint32_t index = (uint32_t)chunk->triangles.count;
+    ARRAY_PUSH(chunk->triangles, tri);
+    const uint32_t tile_x0 = (uint32_t)tri.min_x / CPU_TILE_SIZE;
+    const uint32_t tile_x1 = (uint32_t)tri.max_x / CPU_TILE_SIZE;
+    const uint32_t tile_y0 = (uint32_t)tri.min_y / CPU_TILE_SIZE;
+    const uint32_t tile_y1 = (uint32_t)tri.max_y / CPU_TILE_SIZE;
+    for (uint32_t ty = tile_y0; ty <= tile_y1; ty++) {
+        for (uint32_t tx = tile_x0; tx <= tile_x1; tx++) {
+            ARRAY_PUSH(chunk->bins[(ty * r->tiles_x) + tx], index);
+        }
+    }
+}
+
+// Sutherland-Hodgman against the near plane and the guard band, then a fan of the result
+static void clip_triangle(const CpuRasterizer *r, CpuChunk *chunk, const uint32_t refs[3],
+                          const uint32_t outcode, const uint32_t material, const uint32_t kind) {
+    CpuVertex polygons[2][MAX_CLIP_VERTICES];
+    uint32_t count = 3;
+    for (int k = 0; k < 3; k++) {
+        polygons[0][k] = r->vertices.data[refs[k]];
+    }
+
+    uint32_t current = 0;
+    for (uint32_t plane = 0; plane < CLIP_PLANE_COUNT; plane++) {
+        if ((outcode & (1U << plane)) == 0) {
+            continue;
+        }
+        const CpuVertex *in = polygons[current];
+        CpuVertex *out = polygons[current ^ 1U];
+        uint32_t out_count = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const CpuVertex *a = &in[i];
+            const CpuVertex *b = &in[(i + 1) % count];
+            const float da = clip_distance(a->clip, plane);
+            const float db = clip_distance(b->clip, plane);
+            if (da >= 0.0F) {
+                out[out_count++] = *a;
+            }
+            if ((da >= 0.0F) != (db >= 0.0F)) {
+                lerp_vertex(a, b, da / (da - db), &out[out_count++]);
+            }
+        }
+        count = out_count;
+        current ^= 1U;
+        if (count < 3) {
+            return;
+        }
+    }
+
+    const uint32_t base = (uint32_t)chunk->clipped.count;
+    for (uint32_t i = 0; i < count; i++) {
+        ARRAY_PUSH(chunk->clipped, polygons[current][i]);
+    }
+    for (uint32_t i = 1; i + 1 < count; i++) {
+        const uint32_t fan[3] = {base | CLIPPED_VERTEX_BIT, (base + i) | CLIPPED_VERTEX_BIT,
+                                 (base + i + 1) | CLIPPED_VERTEX_BIT};
+        emit_triangle(r, chunk, fan, material, kind);
+    }
+}
+
+// Sets up one contiguous slice of the frame's triangles
+static void setup_chunk(void *context, const uint32_t index) {
+    CpuRasterizer *r = context;
+    CpuChunk *chunk = &r->chunks[index];
+    chunk->triangles.count = 0;
+    chunk->clipped.count = 0;
+    const uint32_t tile_count = r->tiles_x * r->tiles_y;
+    for (uint32_t t = 0; t < tile_count; t++) {
+        chunk->bins[t].count = 0;
+    }
+
+    const uint32_t first = (uint32_t)(((uint64_t)r->triangle_count * index) / r->chunk_count);
+    const uint32_t last =
+        (uint32_t)(((uint64_t)r->triangle_count * (index + 1)) / r->chunk_count);
+    if (first >= last) {
+        return;
+    }
+
+    // Last range starting at or before `first`
+    size_t lo = 0;
+    size_t hi = r->ranges.count;
+    while (hi - lo > 1) {
+        const size_t mid = (lo + hi) / 2;
+        if (r->ranges.data[mid].first_triangle <= first) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const CpuRange *range = &r->ranges.data[lo];
+    for (uint32_t t = first; t < last; t++) {
+        while (t >= range->first_triangle + range->triangle_count) {
+            range++;
+        }
+        const uint32_t *indices = range->indices + ((size_t)(t - range->first_triangle) * 3);
+        if (indices[0] >= range->vertex_count || indices[1] >= range->vertex_count ||
+            indices[2] >= range->vertex_count) {
+            continue;
+        }
+        const uint32_t refs[3] = {range->vertex_base + indices[0],
+                                  range->vertex_base + indices[1],
+                                  range->vertex_base + indices[2]};
+        const float *c0 = r->vertices.data[refs[0]].clip;
+        const float *c1 = r->vertices.data[refs[1]].clip;
+        const float *c2 = r->vertices.data[refs[2]].clip;
+        if ((view_outcode(c0) & view_outcode(c1) & view_outcode(c2)) != 0) {
+            continue;
+        }
+        const uint32_t outcode = clip_outcode(c0) | clip_outcode(c1) | clip_outcode(c2);
+        if (outcode != 0) {
+            clip_triangle(r, chunk, refs, outcode, range->material, range->kind);
+        } else {
+            emit_triangle(r, chunk, refs, range->material, range->kind);
+        }
+    }
+}
+
+// --- Fragment stage ---
+
+// Bilinear sample with repeat addressing from the only mip level, as the renderer's sampler
+// does. `decode` and `decode_alpha` map the 8-bit channels to the values the shader sees.
+static void sample_texture(const Texture *t, float u, float v, const float *decode,
+                           const float *decode_alpha, float out[4]) {
+    if (!isfinite(u) || !isfinite(v)) {
+        u = 0.0F;
+        v = 0.0F;
+    }
+    const float x = (u * (float)t->width) - 0.5F;
+    const float y = (v * (float)t->height) - 0.5F;
+    const float fx = floorf(x);
+    const float fy = floorf(y);
+    const float ax = x - fx;
+    const float ay = y - fy;
+
+    int64_t x0 = (int64_t)fx % (int64_t)t->width;
+    int64_t y0 = (int64_t)fy % (int64_t)t->height;
+    x0 += x0 < 0 ? t->width : 0;
+    y0 += y0 < 0 ? t->height : 0;
+    const int64_t x1 = (x0 + 1) % t->width;
+    const int64_t y1 = (y0 + 1) % t->height;
+
+    const uint8_t *p00 = t->data + (((size_t)y0 * t->width) + (size_t)x0) * 4;
+    const uint8_t *p10 = t->data + (((size_t)y0 * t->width) + (size_t)x1) * 4;
+    const uint8_t *p01 = t->data + (((size_t)y1 * t->width) + (size_t)x0) * 4;
+    const uint8_t *p11 = t->data + (((size_t)y1 * t->width) + (size_t)x1) * 4;
+    for (int c = 0; c < 4; c++) {
+        const float *lut = c == 3 ? decode_alpha : decode;
+        const float top = lut[p00[c]] + ((lut[p10[c]] - lut[p00[c]]) * ax);
+        const float bottom = lut[p01[c]] + ((lut[p11[c]] - lut[p01[c]]) * ax);
+        out[c] = top + ((bottom - top) * ay);
+    }
+}
+
+static void sample_diffuse(const CpuRasterizer *r, const Texture *t, const float u, const float v,
+                           float out[4]) {
+    // Alpha is stored linearly even in SRGB images
+    sample_texture(t, u, v, r->srgb_to_linear, r->unorm_to_float, out);
+}
+
+static void sample_unorm(const CpuRasterizer *r, const Texture *t, const float u, const float v,
+                         float out[4]) {
+    sample_texture(t, u, v, r->unorm_to_float, r->unorm_to_float, out);
+}
+
+// getTriplanarColor in shader.frag.slang
+static void sample_triplanar(const CpuRasterizer *r, const Texture *t, const vec3 world,
+                             const vec3 normal, float out[4]) {
+    vec3 weights;
+    for (int i = 0; i < 3; i++) {
+        const float a = fabsf(normal[i]);
+        weights[i] = a * a * a * a;
+    }
+    const float sum = weights[0] + weights[1] + weights[2];
+    float x[4];
+    float y[4];
+    float z[4];
+    sample_diffuse(r, t, world[2], world[1], x);
+    sample_diffuse(r, t, world[0], world[2], y);
+    sample_diffuse(r, t, world[0], world[1], z);
+    for (int c = 0; c < 4; c++) {
+        out[c] = ((x[c] * weights[0]) + (y[c] * weights[1]) + (z[c] * weights[2])) / sum;
+    }
+}
+
+// applyToneMappingAndGamma in common.slang
+static float tone_map(const float hdr) {
+    return powf(1.0F - expf(-glm_max(hdr, 0.0F)), 1.0F / 2.2F);
+}
+
+// The mesh fragment shader. Returns false where it discards.
+static bool shade_mesh(const CpuRasterizer *r, const uint32_t material_index, Fragment *f,
+                       float out[4]) {
+    const CpuFrame *frame = r->frame;
+    const FrameUniforms *lighting = frame->lighting;
+    const RenderMaterial *material = &frame->materials[material_index];
+    const Texture *diffuse =
+        texture_is_valid(material->diffuse) ? material->diffuse : &r->fallback_diffuse;
+    const Texture *normal_map =
+        texture_is_valid(material->normal) ? material->normal : &r->fallback_normal;
+
+    vec3 n;
+    glm_vec3_normalize_to(f->normal, n);
+    float color[4];
+    if (lighting->use_triplanar_mapping != 0) {
+        sample_triplanar(r, diffuse, f->world, n, color);
+    } else {
+        sample_diffuse(r, diffuse, f->uv[0], f->uv[1], color);
+    }
+    for (int c = 0; c < 4; c++) {
+        color[c] *= material->base_color[c];
+    }
+
+    const float sampled_alpha = color[3];
+    if (material->alpha_mode == ALPHA_MODE_OPAQUE) {
+        color[3] = 1.0F;
+    } else if (material->alpha_mode == ALPHA_MODE_MASK) {
+        if (color[3] < 0.5F) {
+            return false;
+        }
+        color[3] = 1.0F;
+    }
+
+    if (lighting->enable_lighting == 0) {
+        for (int c = 0; c < 3; c++) {
+            out[c] = tone_map(color[c]);
+        }
+        out[3] = color[3];
+        return true;
+    }
+
+    float normal_sample[4];
+    sample_unorm(r, normal_map, f->uv[0], f->uv[1], normal_sample);
+    vec3 tangent_normal = {(normal_sample[0] * 2.0F) - 1.0F, (normal_sample[1] * 2.0F) - 1.0F,
+                           (normal_sample[2] * 2.0F) - 1.0F};
+    glm_vec3_normalize(tangent_normal);
+
+    vec3 t;
+    vec3 b;
+    glm_vec3_normalize_to(f->tangent, t);
+    glm_vec3_normalize_to(f->bitangent, b);
+    vec3 perturbed;
+    for (int i = 0; i < 3; i++) {
+        perturbed[i] =
+            (tangent_normal[0] * t[i]) + (tangent_normal[1] * b[i]) + (tangent_normal[2] * n[i]);
+    }
+    glm_vec3_normalize(perturbed);
+
+    // Key light (directional)
+    vec3 light_dir;
+    vec3 view_dir;
+    glm_vec3_normalize_to((float *)lighting->light_dir, light_dir);
+    glm_vec3_sub((float *)lighting->camera_pos, f->world, view_dir);
+    glm_vec3_normalize(view_dir);
+    const float key_diffuse = glm_max(glm_vec3_dot(perturbed, light_dir), 0.0F);
+
+    // Hemisphere ambient: interpolate between ground and sky based on up-facing
+    const float hemisphere_blend = (perturbed[1] * 0.5F) + 0.5F;
+    vec3 ambient;
+    glm_vec3_lerp((float *)lighting->hemisphere_ground_color,
+                  (float *)lighting->hemisphere_sky_color, hemisphere_blend, ambient);
+
+    // Fill light (diffuse only, no specular)
+    vec3 fill_dir;
+    glm_vec3_normalize_to((float *)lighting->fill_light_dir, fill_dir);
+    const float fill_diffuse =
+        glm_max(glm_vec3_dot(perturbed, fill_dir), 0.0F) * lighting->fill_light_dir[3];
+
+    // Rim light (edge-based, view-dependent)
+    vec3 rim_dir;
+    glm_vec3_normalize_to((float *)lighting->rim_light_dir, rim_dir);
+    const float facing = glm_max(glm_vec3_dot(perturbed, view_dir), 0.0F);
+    const float rim_dot = 1.0F - facing;
+    const float rim_facing = glm_max(glm_vec3_dot(perturbed, rim_dir), 0.0F);
+    const float rim = rim_dot * rim_dot * rim_dot * rim_facing * lighting->rim_light_dir[3];
+
+    // Specular (key light only)
+    float specular_strength = glm_clamp(material->specular_strength, 0.0F, 1.0F);
+    float shininess = glm_clamp(material->shininess, 8.0F, 256.0F);
+    if (material->use_diffuse_alpha_as_luster) {
+        specular_strength = glm_max(specular_strength, sampled_alpha);
+        shininess = glm_max(shininess, glm_lerp(12.0F, 160.0F, sampled_alpha));
+    }
+
+    float specular = 0.0F;
+    if (key_diffuse > 0.0F && specular_strength > 0.0F) {
+        vec3 half_vector;
+        glm_vec3_add(light_dir, view_dir, half_vector);
+        glm_vec3_normalize(half_vector);
+        const float spec_angle = glm_max(glm_vec3_dot(perturbed, half_vector), 0.0F);
+        const float fresnel = powf(rim_dot, 5.0F);
+        specular = powf(spec_angle, shininess) * specular_strength * (0.08F + (0.92F * fresnel));
+    }
+
+    for (int c = 0; c < 3; c++) {
+        const float lit = (color[c] * (key_diffuse + fill_diffuse)) + (color[c] * ambient[c]) +
+                          specular + rim;
+        out[c] = tone_map(lit);
+    }
+    out[3] = color[3];
+    return true;
+}
+
+static uint8_t to_unorm8(const float v) {
+    return (uint8_t)((glm_clamp(v, 0.0F, 1.0F) * 255.0F) + 0.5F);
+}
+
+// SRC_ALPHA / ONE_MINUS_SRC_ALPHA for colour, ONE / ONE_MINUS_SRC_ALPHA for alpha
+static void blend_pixel(const CpuRasterizer *r, uint8_t *dst, const float src[4]) {
+    const float a = glm_clamp(src[3], 0.0F, 1.0F);
+    if (a >= 1.0F) {
+        for (int c = 0; c < 4; c++) {
+            dst[c] = to_unorm8(src[c]);
+        }
+        return;
+    }
+    for (int c = 0; c < 3; c++) {
+        dst[c] = to_unorm8((src[c] * a) + (r->unorm_to_float[dst[c]] * (1.0F - a)));
+    }
+    dst[3] = to_unorm8(a + (r->unorm_to_float[dst[3]] * (1.0F - a)));
+}
+
+// Runs depth test, fragment shader and blending for one covered pixel. `l` holds the
+// screen-space barycentrics and `z` the interpolated depth.
+static void shade_pixel(const CpuRasterizer *r, const CpuChunk *chunk, const CpuTriangle *tri,
+                        const int32_t x, const int32_t y, const float l[3], const float z) {
+    const size_t pixel = ((size_t)y * r->width) + (size_t)x;
+    // The renderer's depth range is reversed, so a smaller NDC depth is nearer
+    if (!(z >= 0.0F && z <= 1.0F && z < r->depth[pixel])) {
+        return;
+    }
+
+    // Perspective-correct weights
+    float w[3] = {l[0] * tri->inv_w[0], l[1] * tri->inv_w[1], l[2] * tri->inv_w[2]};
+    const float inv_sum = 1.0F / (w[0] + w[1] + w[2]);
+    w[0] *= inv_sum;
+    w[1] *= inv_sum;
+    w[2] *= inv_sum;
+    const CpuVertex *v0 = chunk_vertex(r, chunk, tri->vertices[0]);
+    const CpuVertex *v1 = chunk_vertex(r, chunk, tri->vertices[1]);
+    const CpuVertex *v2 = chunk_vertex(r, chunk, tri->vertices[2]);
+
+    Fragment f;
+    for (int i = 0; i < 2; i++) {
+        f.uv[i] = (v0->uv[i] * w[0]) + (v1->uv[i] * w[1]) + (v2->uv[i] * w[2]);
+    }
+    for (int i = 0; i < 3; i++) {
+        f.world[i] = (v0->world[i] * w[0]) + (v1->world[i] * w[1]) + (v2->world[i] * w[2]);
+        f.normal[i] = (v0->normal[i] * w[0]) + (v1->normal[i] * w[1]) + (v2->normal[i] * w[2]);
+        f.tangent[i] =
+            (v0->tangent[i] * w[0]) + (v1->tangent[i] * w[1]) + (v2->tangent[i] * w[2]);
+        f.bitangent[i] =
+            (v0->bitangent[i] * w[0]) + (v1->bitangent[i] * w[1]) + (v2->bitangent[i] * w[2]);
+    }
+    float color[4];
+    if (!shade_mesh(r, tri->material, &f, color)) {
+        return;
+    }
+    if (tri->kind == TRIANGLE_OPAQUE) {
+        r->depth[pixel] = z;
+    }
+    blend_pixel(r, r->target + (pixel * 4), color);
+}
+
+// Edge-function scan of the triangle's pixels within [x0, x1] x [y0, y1], top-left fill rule
+static void fill_triangle(const CpuRasterizer *r, const CpuChunk *chunk, const CpuTriangle *tri,
+                          const int32_t x0, const int32_t y0, const int32_t x1,
+                          const int32_t y1) {
+    const int64_t px = ((int64_t)x0 * SUBPIXEL_ONE) + SUBPIXEL_HALF;
+    const int64_t py = ((int64_t)y0 * SUBPIXEL_ONE) + SUBPIXEL_HALF;
+    int64_t row[3];
+    int64_t step_x[3];
+    int64_t step_y[3];
+    int64_t bias[3];
+    // Edge k faces vertex k, so its function over the area is vertex k's barycentric
+    for (int k = 0; k < 3; k++) {
+        const int a = (k + 1) % 3;
+        const int b = (k + 2) % 3;
+        const int64_t dx = (int64_t)tri->x[b] - tri->x[a];
+        const int64_t dy = (int64_t)tri->y[b] - tri->y[a];
+        row[k] = (dx * (py - tri->y[a])) - (dy * (px - tri->x[a]));
+        step_x[k] = -dy * SUBPIXEL_ONE;
+        step_y[k] = dx * SUBPIXEL_ONE;
+        // Pixel centres exactly on an edge belong to top and left edges only
+        bias[k] = (dy < 0 || (dy == 0 && dx > 0)) ? 0 : -1;
+    }
+
+    const float inv_area = 1.0F / (float)tri->area;
+    for (int32_t y = y0; y <= y1; y++) {
+        int64_t e0 = row[0];
+        int64_t e1 = row[1];
+        int64_t e2 = row[2];
+        for (int32_t x = x0; x <= x1; x++) {
+            if ((e0 + bias[0]) >= 0 && (e1 + bias[1]) >= 0 && (e2 + bias[2]) >= 0) {
+                const float l[3] = {(float)e0 * inv_area, (float)e1 * inv_area,
+                                    (float)e2 * inv_area};
+                const float z = (l[0] * tri->z[0]) + (l[1] * tri->z[1]) + (l[2] * tri->z[2]);
+                shade_pixel(r, chunk, tri, x, y, l, z);
+            }
+            e0 += step_x[0];
+            e1 += step_x[1];
+            e2 += step_x[2];
+        }
+        row[0] += step_y[0];
+        row[1] += step_y[1];
+        row[2] += step_y[2];
+    }
+}
+
+// One-pixel lines along the triangle's edges, as VK_POLYGON_MODE_LINE draws them: one pixel
+// per column (or row, for steep edges) whose centre the edge spans
+static void draw_triangle_edges(const CpuRasterizer *r, const CpuChunk *chunk,
+                                const CpuTriangle *tri, const int32_t x0, const int32_t y0,
+                                const int32_t x1, const int32_t y1) {
+    for (int k = 0; k < 3; k++) {
+        int a = k;
+        int b = (k + 1) % 3;
+        const float dx = (float)(tri->x[b] - tri->x[a]) / (float)SUBPIXEL_ONE;
+        const float dy = (float)(tri->y[b] - tri->y[a]) / (float)SUBPIXEL_ONE;
+        const bool x_major = fabsf(dx) >= fabsf(dy);
+        // Walk the major axis in increasing order
+        if ((x_major && dx < 0.0F) || (!x_major && dy < 0.0F)) {
+            a = b;
+            b = k;
+        }
+        const float ax = (float)tri->x[a] / (float)SUBPIXEL_ONE;
+        const float ay = (float)tri->y[a] / (float)SUBPIXEL_ONE;
+        const float major_start = x_major ? ax : ay;
+        const float major_length = x_major ? fabsf(dx) : fabsf(dy);
+        const float minor_start = x_major ? ay : ax;
+        const float minor_slope = x_major ? ((float)(tri->y[b] - tri->y[a]) / (float)SUBPIXEL_ONE)
+                                          : ((float)(tri->x[b] - tri->x[a]) / (float)SUBPIXEL_ONE);
+
+        // Centres in [start, start + length)
+        int32_t first = (int32_t)ceilf(major_start - 0.5F);
+        int32_t last = (int32_t)ceilf(major_start + major_length - 0.5F) - 1;
+        first = max_i32(first, x_major ? x0 : y0);
+        last = min_i32(last, x_major ? x1 : y1);
+        for (int32_t m = first; m <= last; m++) {
+            const float t = (((float)m + 0.5F) - major_start) / major_length;
+            const int32_t n = (int32_t)floorf(minor_start + (t * minor_slope));
+            const int32_t x = x_major ? m : n;
+            const int32_t y = x_major ? n : m;
+            if (x < x0 || x > x1 || y < y0 || y > y1) {
+                continue;
+            }
+            float l[3] = {0.0F, 0.0F, 0.0F};
+            l[a] = 1.0F - t;
+            l[b] = t;
+            shade_pixel(r, chunk, tri, x, y, l, (l[a] * tri->z[a]) + (l[b] * tri->z[b]));
+        }
+    }
+}
+
+// Looks up the panorama along the view ray through each pixel centre of the tile, into the
+// sky cache, as skydome.frag does
+static void draw_sky_tile(const CpuRasterizer *r, const int32_t x0, const int32_t y0,
+                          const int32_t x1, const int32_t y1) {
+    const CpuFrame *frame = r->frame;
+    for (int32_t y = y0; y <= y1; y++) {
+        uint8_t *pixels = r->sky + ((((size_t)y * r->width) + (size_t)x0) * 4);
+        const float ndc_y = ((((float)y + 0.5F) / (float)r->height) * 2.0F) - 1.0F;
+        for (int32_t x = x0; x <= x1; x++, pixels += 4) {
+            const float ndc[3] = {((((float)x + 0.5F) / (float)r->width) * 2.0F) - 1.0F, ndc_y,
+                                  1.0F};
+            float ray[4];
+            transform_point((vec4 *)frame->skydome_rays, ndc, 1.0F, ray);
+            const vec3 direction = {ray[0] / ray[3], ray[1] / ray[3], ray[2] / ray[3]};
+            float uv[2];
+            skydome_direction_uv(direction, uv);
+            float color[4];
+            sample_unorm(r, frame->skydome_texture, uv[0], uv[1], color);
+            for (int c = 0; c < 3; c++) {
+                pixels[c] = to_unorm8(color[c]);
+            }
+            pixels[3] = 255;
+        }
+    }
+}
+
+// Clears one tile to the sky (or black) and draws every triangle binned to it, chunk by
+// chunk in submission order
+static void rasterize_tile(void *context, const uint32_t index) {
+    CpuRasterizer *r = context;
+    const int32_t tile_x0 = (int32_t)((index % r->tiles_x) * CPU_TILE_SIZE);
+    const int32_t tile_y0 = (int32_t)((index / r->tiles_x) * CPU_TILE_SIZE);
+    const int32_t tile_x1 = min_i32(tile_x0 + (int32_t)CPU_TILE_SIZE, (int32_t)r->width) - 1;
+    const int32_t tile_y1 = min_i32(tile_y0 + (int32_t)CPU_TILE_SIZE, (int32_t)r->height) - 1;
+
+    if (r->draw_sky && !r->sky_valid) {
+        draw_sky_tile(r, tile_x0, tile_y0, tile_x1, tile_y1);
+    }
+    for (int32_t y = tile_y0; y <= tile_y1; y++) {
+        const size_t row = ((size_t)y * r->width) + (size_t)tile_x0;
+        uint8_t *pixels = r->target + (row * 4);
+        if (r->draw_sky) {
+            memcpy(pixels, r->sky + (row * 4), (size_t)(tile_x1 - tile_x0 + 1) * 4);
+        }
+        for (int32_t x = 0; x <= tile_x1 - tile_x0; x++) {
+            if (!r->draw_sky) {
+                pixels[(x * 4) + 0] = 0;
+                pixels[(x * 4) + 1] = 0;
+                pixels[(x * 4) + 2] = 0;
+                pixels[(x * 4) + 3] = 255;
+            }
+            r->depth[row + (size_t)x] = 1.0F;
+        }
+    }
+
+    const bool wireframe = r->frame->wireframe;
+    for (uint32_t c = 0; c < r->chunk_count; c++) {
+        const CpuChunk *chunk = &r->chunks[c];
+        const Uint32Array *bin = &chunk->bins[index];
+        for (size_t i = 0; i < bin->count; i++) {
+            const CpuTriangle *tri = &chunk->triangles.data[bin->data[i]];
+            const int32_t x0 = max_i32(tri->min_x, tile_x0);
+            const int32_t y0 = max_i32(tri->min_y, tile_y0);
+            const int32_t x1 = min_i32(tri->max_x, tile_x1);
+            const int32_t y1 = min_i32(tri->max_y, tile_y1);
+            if (x0 > x1 || y0 > y1) {
+                continue;
+            }
+            // The blend pipeline has no wireframe variant
+            if (wireframe && tri->kind == TRIANGLE_OPAQUE) {
+                draw_triangle_edges(r, chunk, tri, x0, y0, x1, y1);
+            } else {
+                fill_triangle(r, chunk, tri, x0, y0, x1, y1);
+            }
+        }
+    }
+}
+
+void cpu_rasterizer_draw(CpuRasterizer *r, const CpuFrame *frame, uint8_t *target) {
+    if (r->width == 0 || r->height == 0 || !r->depth || !r->sky) {
+        return;
+    }
+    r->frame = frame;
+    r->target = target;
+
+    // The sky only changes with the camera's rotation and projection, so a frame that kept
+    // both copies the previous one
+    r->draw_sky = texture_is_valid(frame->skydome_texture);
+    if (r->draw_sky &&
+        (!r->sky_valid || r->sky_pixels != frame->skydome_texture->data ||
+         memcmp(r->sky_rays, frame->skydome_rays, sizeof(mat4)) != 0)) {
+        r->sky_valid = false;
+        r->sky_pixels = frame->skydome_texture->data;
+        glm_mat4_copy((vec4 *)frame->skydome_rays, r->sky_rays);
+    }
+    r->mesh_vertex_count = frame->mesh ? (uint32_t)frame->mesh->vertices.count : 0;
+    const size_t vertex_count = r->mesh_vertex_count;
+    ARRAY_RESERVE(r->vertices, vertex_count);
+    r->vertices.count = vertex_count;
+    worker_pool_run(&r->pool,
+                    (uint32_t)((vertex_count + VERTEX_BLOCK_SIZE - 1) / VERTEX_BLOCK_SIZE),
+                    transform_vertex_block, r);
+
+    build_ranges(r);
+    worker_pool_run(&r->pool, r->chunk_count, setup_chunk, r);
+    worker_pool_run(&r->pool, r->tiles_x * r->tiles_y, rasterize_tile, r);
+    r->sky_valid = r->draw_sky;
+
+    r->frame = NULL;
+    r->target = NULL;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "../core/worker_pool.h"
+#include "../graphics/model.h"
+#include "draw_list.h"
+#include "render_types.h"
+
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Screen tiles are rasterized independently, one worker each
+#define CPU_TILE_SIZE 32U
+
+// Vertex stage output: clip position plus the world-space attributes the fragment stage reads
+typedef struct CpuVertex {
+    float clip[4];
+    float world[3];
+    float normal[3];
+    float tangent[3];
+    float bitangent[3];
+    float uv[2];
+} CpuVertex;
+
+typedef struct CpuVertexArray {
+    CpuVertex *data;
+    size_t count;
+    size_t capacity;
+} CpuVertexArray;
+
+// A triangle after clipping, in 24.8 fixed-point screen coordinates
+typedef struct CpuTriangle {
+    uint32_t vertices[3];
+    uint32_t material;
+    uint32_t kind;
+    int32_t x[3];
+    int32_t y[3];
+    float z[3];
+    float inv_w[3];
+    int64_t area;
+    int32_t min_x, min_y, max_x, max_y; // pixel bounds, inclusive
+} CpuTriangle;
+
+typedef struct CpuTriangleArray {
+    CpuTriangle *data;
+    size_t count;
+    size_t capacity;
+} CpuTriangleArray;
+
+// Triangles set up by one worker, with the vertices clipping created and each tile's list
+// of the triangles that touch it. Chunks cover consecutive triangles, so walking them in
+// order keeps the submission order within every tile.
+typedef struct CpuChunk {
+    CpuTriangleArray triangles;
+    CpuVertexArray clipped;
+    Uint32Array *bins;
+} CpuChunk;
+
+// A run of triangles drawn with one material, indexing vertices[vertex_base...]
+typedef struct CpuRange {
+    const uint32_t *indices;
+    uint32_t vertex_base;
+    uint32_t vertex_count;
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    uint32_t material;
+    uint32_t kind;
+} CpuRange;
+
+typedef struct CpuRangeArray {
+    CpuRange *data;
+    size_t count;
+    size_t capacity;
+} CpuRangeArray;
+
+// One frame's inputs, mirroring what vulkan_renderer_render records
+typedef struct CpuFrame {
+    const Mesh *mesh;
+    const DrawList *draws;
+    const RenderMaterial *materials;
+    uint32_t material_count;
+    const FrameUniforms *lighting;
+    mat4 mvp;
+    mat4 model;
+    // Skinning applies when non-NULL, as with the skinned pipelines
+    const mat4 *bone_matrices;
+    uint32_t bone_count;
+    bool wireframe;
+    // Skip mesh triangles facing away from the camera, as MESH_PIPELINE_CULL_BACK does
+    bool cull_backfaces;
+    // Drawn first, behind everything, when set: skydome_rays (skydome_ray_matrix) turns
+    // each pixel into the view ray looked up in the panorama, as skydome.vert does
+    const Texture *skydome_texture;
+    mat4 skydome_rays;
+} CpuFrame;
+
+// Tiled, multithreaded software implementation of the mesh and skydome pipelines: the same
+// vertex and fragment stages as the shaders, writing RGBA straight into the caller's frame.
+typedef struct CpuRasterizer {
+    WorkerPool pool;
+    bool pool_started;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    float *depth;
+
+    CpuVertexArray vertices;
+    uint32_t mesh_vertex_count;
+    CpuRangeArray ranges;
+    uint32_t triangle_count;
+    CpuChunk *chunks;
+    uint32_t chunk_count;
+
+    Texture fallback_diffuse;
+    Texture fallback_normal;
+    // 8-bit channel to float, as sampling an SRGB or UNORM image does
+    float srgb_to_linear[256];
+    float unorm_to_float[256];
+
+    // The last sky drawn, width * height RGBA. Frames whose camera has not turned copy it
+    // instead of looking up every pixel again.
+    uint8_t *sky;
+    bool sky_valid;
+    mat4 sky_rays;
+    const uint8_t *sky_pixels;
+
+    // Per-frame state read by the workers
+    const CpuFrame *frame;
+    uint8_t *target;
+    bool draw_sky;
+} CpuRasterizer;
+
+// `thread_count` extra threads help the calling thread; 0 renders serially.
+bool cpu_rasterizer_init(CpuRasterizer *rasterizer, uint32_t thread_count);
+bool cpu_rasterizer_resize(CpuRasterizer *rasterizer, uint32_t width, uint32_t height);
+// Renders `frame` into `target`, width * height RGBA pixels, rows top to bottom.
+void cpu_rasterizer_draw(CpuRasterizer *rasterizer, const CpuFrame *frame, uint8_t *target);
+void cpu_rasterizer_destroy(CpuRasterizer *rasterizer);
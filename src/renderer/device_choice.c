@@ -0,0 +1,119 @@
+#include "device_choice.h"
+#include "platform/io.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEVICE_CHOICE_LINE_LENGTH 256
+#define DEVICE_CHOICE_KEY_LENGTH 128
+
+static bool contains_ignoring_case(const char *text, const char *part) {
+    const size_t length = strlen(part);
+    for (; *text; text++) {
+        size_t i = 0;
+        while (i < length && text[i] &&
+               tolower((unsigned char)text[i]) == tolower((unsigned char)part[i])) {
+            i++;
+        }
+        if (i == length) {
+            return true;
+        }
+    }
+    return length == 0;
+}
+
+int device_choice_match(const char *spec, const char *const *names, const uint32_t count) {
+    if (!spec || spec[0] == '\0') {
+        return -1;
+    }
+    char *end = NULL;
+    const unsigned long index = strtoul(spec, &end, 10);
+    if (isdigit((unsigned char)spec[0]) && *end == '\0') {
+        return index < count ? (int)index : -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (contains_ignoring_case(names[i], spec)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int device_choice_fastest(const double *seconds, const uint32_t count) {
+    int fastest = -1;
+    for (uint32_t i = 0; i < count; i++) {
+        if (isfinite(seconds[i]) && (fastest < 0 || seconds[i] < seconds[fastest])) {
+            fastest = (int)i;
+        }
+    }
+    return fastest;
+}
+
+// Splits a cache line into its key and time; false for a malformed line
+static bool parse_line(const char *line, char key[DEVICE_CHOICE_KEY_LENGTH], double *seconds) {
+    return sscanf(line, "%127s %lf", key, seconds) == 2;
+}
+
+bool device_choice_cache_lookup(const char *path, const char *key, double *out_seconds) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char line[DEVICE_CHOICE_LINE_LENGTH];
+    char line_key[DEVICE_CHOICE_KEY_LENGTH];
+    double seconds = 0.0;
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f)) {
+        found = parse_line(line, line_key, &seconds) && strcmp(line_key, key) == 0 &&
+                isfinite(seconds) && seconds > 0.0;
+    }
+    fclose(f);
+    if (found) {
+        *out_seconds = seconds;
+    }
+    return found;
+}
+
+bool device_choice_cache_store(const char *path, const char *key, const double seconds) {
+    char temp_path[512];
+    const int len = snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", path, dcat_getpid());
+    if (len <= 0 || (size_t)len >= sizeof(temp_path)) {
+        return false;
+    }
+    FILE *out = fopen(temp_path, "w");
+    if (!out) {
+        return false;
+    }
+
+    // Other devices' entries carry over; a malformed line is dropped
+    bool written = true;
+    FILE *in = fopen(path, "r");
+    if (in) {
+        char line[DEVICE_CHOICE_LINE_LENGTH];
+        char line_key[DEVICE_CHOICE_KEY_LENGTH];
+        double line_seconds = 0.0;
+        while (fgets(line, sizeof(line), in)) {
+            if (parse_line(line, line_key, &line_seconds) && strcmp(line_key, key) != 0) {
+                written = fprintf(out, "%s %.9g\n", line_key, line_seconds) > 0 && written;
+            }
+        }
+        fclose(in);
+    }
+    written = fprintf(out, "%s %.9g\n", key, seconds) > 0 && written;
+    written = (fclose(out) == 0) && written;
+
+    // Write then rename, so a concurrent dcat never reads a half-written cache
+#ifdef _WIN32
+    if (written) {
+        remove(path);
+    }
+#endif
+    if (!written || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Index into `names` of the device a --gpu value picks: a decimal value is an index, anything
+// else the first name containing it, ignoring case; -1 when nothing matches
+int device_choice_match(const char *spec, const char *const *names, uint32_t count);
+
+// Index of the smallest finite entry of `seconds`, -1 when none is finite
+int device_choice_fastest(const double *seconds, uint32_t count);
+
+// The render-and-readback time an earlier run measured for the device `key` names. The cache
+// is a text file of "key seconds" lines; keys contain no whitespace.
+bool device_choice_cache_lookup(const char *path, const char *key, double *out_seconds);
+
+// Records `seconds` for `key` at `path`, replacing its old entry and keeping the others
+bool device_choice_cache_store(const char *path, const char *key, double seconds);
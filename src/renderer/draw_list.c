@@ -0,0 +1,166 @@
+#include "draw_list.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+void draw_list_reset(DrawList *list) {
+    list->items.count = 0;
+    list->commands.count = 0;
+    list->batches.count = 0;
+    list->culls.count = 0;
+}
+
+void draw_list_add(DrawList *list, const DrawPass pass, const uint32_t descriptor,
+                   const uint32_t material, const uint32_t first_index,
+                   const uint32_t index_count) {
+    if (index_count == 0) {
+        return;
+    }
+    const DrawItem item = {.pass = pass,
+                           .descriptor = descriptor,
+                           .material = material,
+                           .first_index = first_index,
+                           .index_count = index_count,
+                           .sequence = (uint32_t)list->items.count};
+    ARRAY_PUSH(list->items, item);
+}
+
+void draw_list_add_meshlets(DrawList *list, const DrawPass pass, const uint32_t descriptor,
+                            const uint32_t material, const uint32_t first_meshlet,
+                            const uint32_t meshlet_count) {
+    if (meshlet_count == 0) {
+        return;
+    }
+    const DrawItem item = {.pass = pass,
+                           .descriptor = descriptor,
+                           .material = material,
+                           .first_meshlet = first_meshlet,
+                           .meshlet_count = meshlet_count,
+                           .sequence = (uint32_t)list->items.count};
+    ARRAY_PUSH(list->items, item);
+}
+
+static int compare_u32(const uint32_t a, const uint32_t b) {
+    return (a > b) - (a < b);
+}
+
+// Opaque draws first, grouped by descriptor set, then material, then index order; blended
+// draws stay in submission order since they composite over each other.
+static int compare_items(const void *lhs, const void *rhs) {
+    const DrawItem *a = lhs;
+    const DrawItem *b = rhs;
+    int order = compare_u32((uint32_t)a->pass, (uint32_t)b->pass);
+    if (order == 0 && a->pass == DRAW_PASS_OPAQUE) {
+        order = compare_u32(a->descriptor, b->descriptor);
+        if (order == 0) {
+            order = compare_u32(a->material, b->material);
+        }
+        // Meshlet runs after plain ranges, so they never split a merge
+        if (order == 0) {
+            order = compare_u32(a->meshlet_count > 0, b->meshlet_count > 0);
+        }
+        if (order == 0) {
+            order = compare_u32(a->first_index, b->first_index);
+        }
+    }
+    return order != 0 ? order : compare_u32(a->sequence, b->sequence);
+}
+
+void draw_list_build(DrawList *list) {
+    list->commands.count = 0;
+    list->batches.count = 0;
+    list->culls.count = 0;
+    if (list->items.count == 0) {
+        return;
+    }
+    qsort(list->items.data, list->items.count, sizeof(DrawItem), compare_items);
+
+    // Every item yields at most one batch, and one command or one per meshlet
+    size_t command_capacity = 0;
+    size_t cull_count = 0;
+    for (size_t i = 0; i < list->items.count; i++) {
+        const uint32_t meshlets = list->items.data[i].meshlet_count;
+        command_capacity += meshlets > 0 ? meshlets : 1U;
+        cull_count += meshlets > 0 ? 1U : 0U;
+    }
+    ARRAY_RESERVE(list->commands, command_capacity);
+    ARRAY_RESERVE(list->batches, list->items.count);
+    ARRAY_RESERVE(list->culls, cull_count);
+
+    const DrawItem *prev = NULL;
+    for (size_t i = 0; i < list->items.count; i++) {
+        const DrawItem *item = &list->items.data[i];
+        const bool same_batch =
+            prev != NULL && prev->pass == item->pass && prev->descriptor == item->descriptor;
+        DrawCommand *last = list->commands.count > 0
+                                ? &list->commands.data[list->commands.count - 1]
+                                : NULL;
+        if (same_batch && prev->meshlet_count == 0 && item->meshlet_count == 0 &&
+            prev->material == item->material &&
+            last->first_index + last->index_count == item->first_index &&
+            last->index_count <= UINT32_MAX - item->index_count) {
+            last->index_count += item->index_count;
+            prev = item;
+            continue;
+        }
+
+        if (!same_batch) {
+            list->batches.data[list->batches.count++] = (DrawBatch){
+                item->pass, item->descriptor, (uint32_t)list->commands.count, 0};
+        }
+        if (item->meshlet_count > 0) {
+            list->culls.data[list->culls.count++] =
+                (DrawCull){(uint32_t)list->commands.count, item->first_meshlet,
+                           item->meshlet_count, item->material};
+            for (uint32_t m = 0; m < item->meshlet_count; m++) {
+                list->commands.data[list->commands.count++] =
+                    (DrawCommand){0, 0, 0, 0, item->material};
+            }
+            list->batches.data[list->batches.count - 1].command_count += item->meshlet_count;
+            prev = item;
+            continue;
+        }
+        list->batches.data[list->batches.count - 1].command_count++;
+        list->commands.data[list->commands.count++] =
+            (DrawCommand){item->index_count, 1, item->first_index, 0, item->material};
+        prev = item;
+    }
+}
+
+static uint64_t hash_u32(uint64_t hash, const uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        hash = (hash ^ ((value >> shift) & 0xFFU)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t draw_list_hash(const DrawList *list, const bool include_commands) {
+    // FNV-1a over the fields, so struct padding never takes part
+    uint64_t hash = hash_u32(0xcbf29ce484222325ULL, (uint32_t)list->batches.count);
+    for (size_t b = 0; b < list->batches.count; b++) {
+        const DrawBatch *batch = &list->batches.data[b];
+        hash = hash_u32(hash, (uint32_t)batch->pass);
+        hash = hash_u32(hash, batch->descriptor);
+        hash = hash_u32(hash, batch->first_command);
+        hash = hash_u32(hash, batch->command_count);
+    }
+    if (!include_commands) {
+        return hash;
+    }
+    for (size_t c = 0; c < list->commands.count; c++) {
+        const DrawCommand *command = &list->commands.data[c];
+        hash = hash_u32(hash, command->index_count);
+        hash = hash_u32(hash, command->instance_count);
+        hash = hash_u32(hash, command->first_index);
+        hash = hash_u32(hash, (uint32_t)command->vertex_offset);
+        hash = hash_u32(hash, command->first_instance);
+    }
+    return hash;
+}
+
+void draw_list_free(DrawList *list) {
+    ARRAY_FREE(list->items);
+    ARRAY_FREE(list->commands);
+    ARRAY_FREE(list->batches);
+    ARRAY_FREE(list->culls);
+}
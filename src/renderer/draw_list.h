@@ -0,0 +1,99 @@
+#pragma once
+#include "../core/types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Which mesh pipeline a draw uses; opaque draws are recorded before blended ones
+typedef enum DrawPass { DRAW_PASS_OPAQUE, DRAW_PASS_BLEND } DrawPass;
+
+// One indexed draw, laid out like VkDrawIndexedIndirectCommand so the list can be copied
+// straight into an indirect buffer. first_instance carries the material index, which the
+// vertex shader reads through the per-instance material stream.
+typedef struct DrawCommand {
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t first_instance;
+} DrawCommand;
+
+// A run of commands sharing a pass and a descriptor set, recorded as one indirect draw
+typedef struct DrawBatch {
+    DrawPass pass;
+    uint32_t descriptor;
+    uint32_t first_command;
+    uint32_t command_count;
+} DrawBatch;
+
+// A run of placeholder commands, one per meshlet, that the culling pass fills in on the GPU
+typedef struct DrawCull {
+    uint32_t first_command;
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
+    uint32_t material;
+} DrawCull;
+
+typedef struct DrawItem {
+    DrawPass pass;
+    uint32_t descriptor;
+    uint32_t material;
+    uint32_t first_index;
+    uint32_t index_count;
+    // Set by draw_list_add_meshlets, whose items have no index range of their own
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
+    uint32_t sequence;
+} DrawItem;
+
+typedef struct DrawItemArray {
+    DrawItem *data;
+    size_t count;
+    size_t capacity;
+} DrawItemArray;
+
+typedef struct DrawCommandArray {
+    DrawCommand *data;
+    size_t count;
+    size_t capacity;
+} DrawCommandArray;
+
+typedef struct DrawBatchArray {
+    DrawBatch *data;
+    size_t count;
+    size_t capacity;
+} DrawBatchArray;
+
+typedef struct DrawCullArray {
+    DrawCull *data;
+    size_t count;
+    size_t capacity;
+} DrawCullArray;
+
+// Per-frame draw list: sub-mesh draws go in with draw_list_add, draw_list_build turns them
+// into merged commands and batches. The arrays keep their capacity across frames.
+typedef struct DrawList {
+    DrawItemArray items;
+    DrawCommandArray commands;
+    DrawBatchArray batches;
+    DrawCullArray culls;
+} DrawList;
+
+void draw_list_reset(DrawList *list);
+// `descriptor` names the descriptor set the draw binds; draws with equal values can share
+// one bind. Empty ranges are ignored.
+void draw_list_add(DrawList *list, DrawPass pass, uint32_t descriptor, uint32_t material,
+                   uint32_t first_index, uint32_t index_count);
+// Draws meshlets [first_meshlet, first_meshlet + meshlet_count) of Mesh::meshlets, each
+// through its own command that draw_list_build leaves empty and records in `culls`.
+void draw_list_add_meshlets(DrawList *list, DrawPass pass, uint32_t descriptor,
+                            uint32_t material, uint32_t first_meshlet, uint32_t meshlet_count);
+// Sorts opaque draws by descriptor set and material (blended ones keep their submission
+// order), merges draws of one material over contiguous index ranges, and groups the
+// commands into batches.
+void draw_list_build(DrawList *list);
+// Identifies what recording the built list takes: its batches, and with `include_commands`
+// the commands too, for when they are recorded as direct draws rather than read from an
+// indirect buffer. Equal lists hash equal.
+uint64_t draw_list_hash(const DrawList *list, bool include_commands);
+void draw_list_free(DrawList *list);
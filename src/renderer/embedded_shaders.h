@@ -0,0 +1,14 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// SPIR-V compiled into the binary by shaders/embed_spirv.py, so startup needs no shader
+// file lookups.
+typedef struct EmbeddedShader {
+    const char *name; // e.g. "shader.vert.spv"
+    const uint32_t *code;
+    size_t size; // bytes
+} EmbeddedShader;
+
+extern const EmbeddedShader dcat_embedded_shaders[];
+extern const size_t dcat_embedded_shader_count;
@@ -0,0 +1,33 @@
+#pragma once
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../core/types.h"
+#include "../graphics/texture.h"
+
+// Renderer inputs shared by the Vulkan and CPU backends; nothing here depends on Vulkan.
+
+// Per-frame lighting (light and camera): the fragment shader's frame block, and the same
+// inputs for the CPU rasterizer
+typedef struct FrameUniforms {
+    vec3 light_dir;
+    uint32_t enable_lighting;
+    vec3 camera_pos;
+    uint32_t use_triplanar_mapping;
+    vec4 hemisphere_sky_color;
+    vec4 hemisphere_ground_color;
+    vec4 fill_light_dir;
+    vec4 rim_light_dir;
+} FrameUniforms;
+
+// Per-material render data passed from main to renderer
+typedef struct RenderMaterial {
+    const Texture *diffuse;
+    const Texture *normal;
+    AlphaMode alpha_mode;
+    float specular_strength;
+    float shininess;
+    float base_color[4];
+    bool use_diffuse_alpha_as_luster;
+} RenderMaterial;
@@ -0,0 +1,63 @@
+#include "screen_rect.h"
+
+#include <cglm/cglm.h>
+#include <math.h>
+
+// Pixel edge for normalized device coordinate `ndc`, a pixel further out than its rounding,
+// clamped to [0, size]
+static uint32_t ndc_to_pixel(const float ndc, const uint32_t size, const bool upper) {
+    const float pixel = (ndc * 0.5F + 0.5F) * (float)size;
+    const float edge = upper ? ceilf(pixel) + 1.0F : floorf(pixel) - 1.0F;
+    if (edge <= 0.0F) {
+        return 0;
+    }
+    return edge >= (float)size ? size : (uint32_t)edge;
+}
+
+ScreenRect screen_rect_from_bounds(mat4 mvp, const vec3 bounds_min, const vec3 bounds_max,
+                                   const uint32_t width, const uint32_t height) {
+    const ScreenRect whole = {0, 0, width, height};
+    float min_x = INFINITY;
+    float min_y = INFINITY;
+    float max_x = -INFINITY;
+    float max_y = -INFINITY;
+    for (int corner = 0; corner < 8; corner++) {
+        vec4 position = {(corner & 1) ? bounds_max[0] : bounds_min[0],
+                         (corner & 2) ? bounds_max[1] : bounds_min[1],
+                         (corner & 4) ? bounds_max[2] : bounds_min[2], 1.0F};
+        vec4 clip;
+        glm_mat4_mulv(mvp, position, clip);
+        if (!(clip[3] > 1e-6F)) {
+            return whole;
+        }
+        const float x = clip[0] / clip[3];
+        const float y = clip[1] / clip[3];
+        min_x = x < min_x ? x : min_x;
+        max_x = x > max_x ? x : max_x;
+        min_y = y < min_y ? y : min_y;
+        max_y = y > max_y ? y : max_y;
+    }
+
+    const uint32_t left = ndc_to_pixel(min_x, width, false);
+    const uint32_t right = ndc_to_pixel(max_x, width, true);
+    const uint32_t top = ndc_to_pixel(min_y, height, false);
+    const uint32_t bottom = ndc_to_pixel(max_y, height, true);
+    if (right <= left || bottom <= top) {
+        return (ScreenRect){0, 0, 0, 0};
+    }
+    return (ScreenRect){left, top, right - left, bottom - top};
+}
+
+ScreenRect screen_rect_union(const ScreenRect a, const ScreenRect b) {
+    if (screen_rect_empty(a)) {
+        return b;
+    }
+    if (screen_rect_empty(b)) {
+        return a;
+    }
+    const uint32_t left = a.x < b.x ? a.x : b.x;
+    const uint32_t top = a.y < b.y ? a.y : b.y;
+    const uint32_t right = a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width;
+    const uint32_t bottom = a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height;
+    return (ScreenRect){left, top, right - left, bottom - top};
+}
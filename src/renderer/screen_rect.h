@@ -0,0 +1,25 @@
+#pragma once
+#include <cglm/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// A rectangle of pixels in a frame; empty when width or height is 0
+typedef struct ScreenRect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} ScreenRect;
+
+// The pixels of a width x height frame that the box [bounds_min, bounds_max] can cover
+// when drawn with `mvp`, with a pixel of margin for rasterization. The whole frame when a
+// corner is at or behind the eye, where projecting it says nothing.
+ScreenRect screen_rect_from_bounds(mat4 mvp, const vec3 bounds_min, const vec3 bounds_max,
+                                   uint32_t width, uint32_t height);
+
+// The smallest rectangle holding both; an empty one adds nothing
+ScreenRect screen_rect_union(ScreenRect a, ScreenRect b);
+
+static inline bool screen_rect_empty(const ScreenRect rect) {
+    return rect.width == 0 || rect.height == 0;
+}
@@ -1,6 +1,10 @@
 #include "vk_device.h"
+#include "device_choice.h"
+#include "platform/path.h"
 #include "version.h"
+#include "vk_readback_probe.h"
 #include "vulkan/vulkan_core.h"
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -88,6 +92,16 @@ static uint32_t dcat_vk_application_version(void) {
     return VK_MAKE_VERSION(major, minor, patch);
 }
 
+static bool has_extension(const VkExtensionProperties *extensions, const uint32_t count,
+                          const char *name) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(extensions[i].extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool create_instance(VulkanRenderer *r) {
     VkApplicationInfo app_info = {.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO};
     app_info.pApplicationName = "dcat";
@@ -128,29 +142,42 @@ bool create_instance(VulkanRenderer *r) {
         create_info.ppEnabledLayerNames = validation_layers;
     }
 
+#endif
+
     uint32_t ext_count = 0;
     vkEnumerateInstanceExtensionProperties(NULL, &ext_count, NULL);
     VkExtensionProperties *available_exts = malloc(ext_count * sizeof(VkExtensionProperties));
-    vkEnumerateInstanceExtensionProperties(NULL, &ext_count, available_exts);
+    if (available_exts) {
+        vkEnumerateInstanceExtensionProperties(NULL, &ext_count, available_exts);
+    } else {
+        ext_count = 0;
+    }
 
-    bool debug_utils_available = false;
-    for (uint32_t i = 0; i < ext_count; i++) {
-        if (strcmp(available_exts[i].extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0) {
-            debug_utils_available = true;
-            break;
-        }
+    // Importing host memory (VK_EXT_external_memory_host) depends on these on a 1.0 instance.
+    const char *extensions[3];
+    uint32_t extension_count = 0;
+    if (has_extension(available_exts, ext_count,
+                      VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) &&
+        has_extension(available_exts, ext_count,
+                      VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME)) {
+        extensions[extension_count++] = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+        extensions[extension_count++] = VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME;
+        r->external_memory_capabilities_available = true;
     }
-    free(available_exts);
 
-    const char *extensions[] = {VK_EXT_DEBUG_UTILS_EXTENSION_NAME};
+#ifndef NDEBUG
+    const bool debug_utils_available =
+        has_extension(available_exts, ext_count, VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     VkDebugUtilsMessengerCreateInfoEXT debug_info = {0};
     if (debug_utils_available) {
-        create_info.enabledExtensionCount = sizeof(extensions) / sizeof(extensions[0]);
-        create_info.ppEnabledExtensionNames = extensions;
+        extensions[extension_count++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
         populate_debug_messenger_info(&debug_info);
         create_info.pNext = &debug_info;
     }
 #endif
+    free(available_exts);
+    create_info.enabledExtensionCount = extension_count;
+    create_info.ppEnabledExtensionNames = extension_count > 0 ? extensions : NULL;
 
     if (vkCreateInstance(&create_info, NULL, &r->instance) != VK_SUCCESS) {
         fprintf(stderr, "Failed to create Vulkan instance\n");
@@ -170,6 +197,147 @@ bool create_instance(VulkanRenderer *r) {
     return true;
 }
 
+// A device the renderer can run on: a graphics queue family and wireframe support
+typedef struct DeviceCandidate {
+    VkPhysicalDevice device;
+    uint32_t queue_family;
+    VkPhysicalDeviceProperties props;
+} DeviceCandidate;
+
+static bool find_graphics_queue_family(VkPhysicalDevice device, uint32_t *out_family) {
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, NULL);
+    VkQueueFamilyProperties *families = malloc(count * sizeof(VkQueueFamilyProperties));
+    if (!families) {
+        return false;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, families);
+    bool found = false;
+    for (uint32_t i = 0; i < count && !found; i++) {
+        if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            *out_family = i;
+            found = true;
+        }
+    }
+    free(families);
+    return found;
+}
+
+// Names one measurement: the device and driver it ran on and the output size. The device
+// UUID, where the instance can query it, tells apart two cards of the same model.
+static void build_readback_cache_key(const VulkanRenderer *r, const DeviceCandidate *candidate,
+                                     char *out, const size_t out_size) {
+    uint8_t uuid[VK_UUID_SIZE];
+    memcpy(uuid, candidate->props.pipelineCacheUUID, VK_UUID_SIZE);
+    PFN_vkGetPhysicalDeviceProperties2KHR get_properties2 =
+        r->external_memory_capabilities_available
+            ? (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(
+                  r->instance, "vkGetPhysicalDeviceProperties2KHR")
+            : NULL;
+    if (get_properties2) {
+        VkPhysicalDeviceIDPropertiesKHR id_props = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES_KHR};
+        VkPhysicalDeviceProperties2KHR props = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR};
+        props.pNext = &id_props;
+        get_properties2(candidate->device, &props);
+        memcpy(uuid, id_props.deviceUUID, VK_UUID_SIZE);
+    }
+    char hex[VK_UUID_SIZE * 2 + 1];
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+        snprintf(&hex[i * 2U], 3, "%02x", uuid[i]);
+    }
+    snprintf(out, out_size, "%08x-%08x-%08x-%s-%ux%u", candidate->props.vendorID,
+             candidate->props.deviceID, candidate->props.driverVersion, hex, r->width,
+             r->height);
+}
+
+// Seconds the candidate takes to get a frame at the output size into host memory, from an
+// earlier run's measurement when there is one; INFINITY when it cannot be measured
+static double readback_seconds(const VulkanRenderer *r, const DeviceCandidate *candidate,
+                               const char *cache_path) {
+    char key[128];
+    build_readback_cache_key(r, candidate, key, sizeof(key));
+    double seconds = INFINITY;
+    if (cache_path && device_choice_cache_lookup(cache_path, key, &seconds)) {
+        return seconds;
+    }
+    if (!vk_measure_readback(candidate->device, candidate->queue_family, r->width, r->height,
+                             &seconds)) {
+        return INFINITY;
+    }
+    if (cache_path) {
+        device_choice_cache_store(cache_path, key, seconds);
+    }
+    return seconds;
+}
+
+static int match_device_preference(VulkanRenderer *r, const DeviceCandidate *candidates,
+                                   const uint32_t count) {
+    const char **names = malloc(count * sizeof(const char *));
+    if (!names) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        names[i] = candidates[i].props.deviceName;
+    }
+    const int index = device_choice_match(r->device_preference, names, count);
+    free(names);
+    if (index < 0) {
+        fprintf(stderr, "Vulkan devices:\n");
+        for (uint32_t i = 0; i < count; i++) {
+            fprintf(stderr, "  %u: %s\n", i, candidates[i].props.deviceName);
+        }
+        vulkan_renderer_set_error(r, VK_ERROR_INITIALIZATION_FAILED, "select_physical_device",
+                                  "No device matches --gpu %s", r->device_preference);
+    }
+    return index;
+}
+
+// Every frame is read back for the terminal, so the device that gets frames into host memory
+// soonest wins, which is not always the discrete GPU (e.g. one behind a narrow PCIe link).
+// Measurements are cached per device and output size, so only new setups pay for them.
+static int choose_device(VulkanRenderer *r, const DeviceCandidate *candidates,
+                         const uint32_t count) {
+    if (count == 0) {
+        return -1;
+    }
+    if (r->device_preference) {
+        return match_device_preference(r, candidates, count);
+    }
+    if (count == 1) {
+        return 0;
+    }
+
+    // Without a cache directory every start measures again
+    char directory[400];
+    char cache_path[512];
+    const bool cached = dcat_get_cache_directory(directory, sizeof(directory));
+    if (cached) {
+        snprintf(cache_path, sizeof(cache_path), "%sreadback-latency.txt", directory);
+    }
+    double *seconds = malloc(count * sizeof(double));
+    int fastest = -1;
+    if (seconds) {
+        for (uint32_t i = 0; i < count; i++) {
+            seconds[i] = readback_seconds(r, &candidates[i], cached ? cache_path : NULL);
+        }
+        fastest = device_choice_fastest(seconds, count);
+        free(seconds);
+    }
+    if (fastest >= 0) {
+        return fastest;
+    }
+
+    // Nothing measured: the first discrete GPU, else the last usable device
+    for (uint32_t i = 0; i < count; i++) {
+        if (candidates[i].props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+            return (int)i;
+        }
+    }
+    return (int)count - 1;
+}
+
 bool select_physical_device(VulkanRenderer *r) {
     uint32_t device_count = 0;
     vkEnumeratePhysicalDevices(r->instance, &device_count, NULL);
@@ -179,76 +347,151 @@ bool select_physical_device(VulkanRenderer *r) {
         return false;
     }
 
-    VkPhysicalDevice *devices = (VkPhysicalDevice *)malloc(device_count * sizeof(VkPhysicalDevice));
+    VkPhysicalDevice *devices = malloc(device_count * sizeof(VkPhysicalDevice));
+    DeviceCandidate *candidates = malloc(device_count * sizeof(DeviceCandidate));
+    if (!devices || !candidates) {
+        free(devices);
+        free(candidates);
+        return false;
+    }
     vkEnumeratePhysicalDevices(r->instance, &device_count, devices);
 
+    uint32_t count = 0;
     for (uint32_t d = 0; d < device_count; d++) {
-        VkPhysicalDeviceProperties props;
-        vkGetPhysicalDeviceProperties(devices[d], &props);
-
-        uint32_t queue_family_count = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(devices[d], &queue_family_count, NULL);
-        VkQueueFamilyProperties *queue_families =
-            malloc(queue_family_count * sizeof(VkQueueFamilyProperties));
-        vkGetPhysicalDeviceQueueFamilyProperties(devices[d], &queue_family_count, queue_families);
-
-        for (uint32_t i = 0; i < queue_family_count; i++) {
-            if (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                VkPhysicalDeviceFeatures features;
-                vkGetPhysicalDeviceFeatures(devices[d], &features);
-
-                if (!features.fillModeNonSolid) {
-                    fprintf(stderr,
-                            "Device %d skipped: missing required features (wireframe: %d)\n", d,
-                            features.fillModeNonSolid);
-                    continue;
-                }
-
-                r->physical_device = devices[d];
-                r->graphics_queue_family = i;
-                if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-                    free(queue_families);
-                    free(devices);
-                    vkGetPhysicalDeviceMemoryProperties(r->physical_device, &r->mem_properties);
-                    r->non_coherent_atom_size = props.limits.nonCoherentAtomSize;
-                    return true;
-                }
-                break;
-            }
+        DeviceCandidate *candidate = &candidates[count];
+        candidate->device = devices[d];
+        vkGetPhysicalDeviceProperties(devices[d], &candidate->props);
+        if (!find_graphics_queue_family(devices[d], &candidate->queue_family)) {
+            continue;
+        }
+        VkPhysicalDeviceFeatures features;
+        vkGetPhysicalDeviceFeatures(devices[d], &features);
+        if (!features.fillModeNonSolid) {
+            fprintf(stderr, "Device %d skipped: missing required features (wireframe: %d)\n", d,
+                    features.fillModeNonSolid);
+            continue;
         }
-        free(queue_families);
+        count++;
     }
     free(devices);
 
-    if (r->physical_device != VK_NULL_HANDLE) {
+    const int chosen = choose_device(r, candidates, count);
+    if (chosen >= 0) {
+        r->physical_device = candidates[chosen].device;
+        r->graphics_queue_family = candidates[chosen].queue_family;
+        r->non_coherent_atom_size = candidates[chosen].props.limits.nonCoherentAtomSize;
         vkGetPhysicalDeviceMemoryProperties(r->physical_device, &r->mem_properties);
-        VkPhysicalDeviceProperties props;
-        vkGetPhysicalDeviceProperties(r->physical_device, &props);
-        r->non_coherent_atom_size = props.limits.nonCoherentAtomSize;
-        return true;
     }
-    return false;
+    free(candidates);
+    return chosen >= 0;
+}
+
+// Reports whether staging buffers can import host memory and, if so, the alignment the
+// imported pointer and size must have.
+static bool query_external_memory_host(VulkanRenderer *r, VkDeviceSize *out_alignment) {
+    if (!r->external_memory_capabilities_available) {
+        return false;
+    }
+
+    uint32_t ext_count = 0;
+    vkEnumerateDeviceExtensionProperties(r->physical_device, NULL, &ext_count, NULL);
+    VkExtensionProperties *available_exts = malloc(ext_count * sizeof(VkExtensionProperties));
+    if (!available_exts) {
+        return false;
+    }
+    vkEnumerateDeviceExtensionProperties(r->physical_device, NULL, &ext_count, available_exts);
+    const bool available =
+        has_extension(available_exts, ext_count, VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME) &&
+        has_extension(available_exts, ext_count, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    free(available_exts);
+    if (!available) {
+        return false;
+    }
+
+    PFN_vkGetPhysicalDeviceProperties2KHR get_properties2 =
+        (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(
+            r->instance, "vkGetPhysicalDeviceProperties2KHR");
+    if (!get_properties2) {
+        return false;
+    }
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT host_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT};
+    VkPhysicalDeviceProperties2KHR props = {.sType =
+                                                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR};
+    props.pNext = &host_props;
+    get_properties2(r->physical_device, &props);
+    *out_alignment = host_props.minImportedHostPointerAlignment;
+    return *out_alignment > 0;
+}
+
+// Prefers a transfer-only family (a DMA engine) for uploads, so copies do not queue behind
+// rendering. Falls back to the graphics family.
+static uint32_t select_transfer_queue_family(const VulkanRenderer *r) {
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &count, NULL);
+    VkQueueFamilyProperties *families = malloc(count * sizeof(VkQueueFamilyProperties));
+    if (!families) {
+        return r->graphics_queue_family;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &count, families);
+
+    uint32_t family = r->graphics_queue_family;
+    for (uint32_t i = 0; i < count; i++) {
+        const VkQueueFlags flags = families[i].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) &&
+            !(flags & VK_QUEUE_COMPUTE_BIT) && families[i].queueCount > 0) {
+            family = i;
+            break;
+        }
+    }
+    free(families);
+    return family;
 }
 
 bool create_logical_device(VulkanRenderer *r) {
     float queue_priority = 1.0F;
-    VkDeviceQueueCreateInfo queue_create_info = {.sType =
-                                                     VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
-    queue_create_info.queueFamilyIndex = r->graphics_queue_family;
-    queue_create_info.queueCount = 1;
-    queue_create_info.pQueuePriorities = &queue_priority;
+    r->transfer_queue_family = select_transfer_queue_family(r);
+    VkDeviceQueueCreateInfo queue_create_infos[2] = {
+        {.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO},
+        {.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO}};
+    queue_create_infos[0].queueFamilyIndex = r->graphics_queue_family;
+    queue_create_infos[0].queueCount = 1;
+    queue_create_infos[0].pQueuePriorities = &queue_priority;
+    queue_create_infos[1].queueFamilyIndex = r->transfer_queue_family;
+    queue_create_infos[1].queueCount = 1;
+    queue_create_infos[1].pQueuePriorities = &queue_priority;
+    const bool separate_transfer = r->transfer_queue_family != r->graphics_queue_family;
 
     // Only Vulkan 1.0 core features are required.
     VkPhysicalDeviceFeatures device_features = {0};
     device_features.fillModeNonSolid = VK_TRUE;
     // Make out-of-range buffer accesses well-defined (return 0) instead of UB.
     device_features.robustBufferAccess = VK_TRUE;
+    // Optional: batches of sub-mesh draws go out as one indirect draw each
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(r->physical_device, &supported_features);
+    r->multi_draw_indirect =
+        supported_features.multiDrawIndirect && supported_features.drawIndirectFirstInstance;
+    if (r->multi_draw_indirect) {
+        device_features.multiDrawIndirect = VK_TRUE;
+        device_features.drawIndirectFirstInstance = VK_TRUE;
+    }
 
     VkDeviceCreateInfo create_info = {.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
-    create_info.pQueueCreateInfos = &queue_create_info;
-    create_info.queueCreateInfoCount = 1;
+    create_info.pQueueCreateInfos = queue_create_infos;
+    create_info.queueCreateInfoCount = separate_transfer ? 2U : 1U;
     create_info.pEnabledFeatures = &device_features;
 
+    const char *device_extensions[] = {VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
+                                       VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME};
+    VkDeviceSize host_pointer_alignment = 0;
+    const bool external_memory_host = query_external_memory_host(r, &host_pointer_alignment);
+    if (external_memory_host) {
+        create_info.enabledExtensionCount =
+            sizeof(device_extensions) / sizeof(device_extensions[0]);
+        create_info.ppEnabledExtensionNames = device_extensions;
+    }
+
     if (vkCreateDevice(r->physical_device, &create_info, NULL, &r->device) != VK_SUCCESS) {
         fprintf(stderr, "Failed to create logical device\n");
         return false;
@@ -259,9 +502,20 @@ bool create_logical_device(VulkanRenderer *r) {
         r->device, "vkSetDebugUtilsObjectNameEXT");
 #endif
 
+    if (external_memory_host) {
+        r->pfn_get_memory_host_pointer_properties =
+            (PFN_vkGetMemoryHostPointerPropertiesEXT)vkGetDeviceProcAddr(
+                r->device, "vkGetMemoryHostPointerPropertiesEXT");
+        r->min_imported_host_pointer_alignment = host_pointer_alignment;
+    }
+
     vkGetDeviceQueue(r->device, r->graphics_queue_family, 0, &r->graphics_queue);
+    vkGetDeviceQueue(r->device, r->transfer_queue_family, 0, &r->transfer_queue);
 
     VK_NAME(r, VK_OBJECT_TYPE_DEVICE, r->device, "device");
     VK_NAME(r, VK_OBJECT_TYPE_QUEUE, r->graphics_queue, "graphics_queue");
+    if (separate_transfer) {
+        VK_NAME(r, VK_OBJECT_TYPE_QUEUE, r->transfer_queue, "transfer_queue");
+    }
     return true;
 }
@@ -1,4 +1,5 @@
 #include "vk_memory.h"
+#include <stdlib.h>
 #include <string.h>
 
 bool find_memory_type(VulkanRenderer *r, const uint32_t type_filter,
@@ -15,16 +16,292 @@ bool find_memory_type(VulkanRenderer *r, const uint32_t type_filter,
     return false;
 }
 
-bool create_buffer(VulkanRenderer *r, const VkDeviceSize size, const VkBufferUsageFlags usage,
-                   const VkMemoryPropertyFlags properties, VkBuffer *buffer,
-                   VulkanAllocation *alloc) {
+// Regular block size; allocations above half of it get a block of their own.
+#define MEMORY_BLOCK_SIZE (64ULL * 1024ULL * 1024ULL)
+// Small heaps (e.g. a 256 MiB BAR window) get proportionally smaller blocks.
+#define MEMORY_BLOCK_HEAP_DIVISOR 8ULL
+
+typedef struct MemoryRange {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+} MemoryRange;
+
+struct VulkanMemoryBlock {
+    VulkanMemoryBlock *next;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint8_t *mapped;
+    uint32_t memory_type;
+    VulkanMemoryPool pool;
+    bool linear;
+    bool dedicated;
+    uint32_t allocation_count;
+    // Free ranges sorted by offset, never adjacent. There are at most allocation_count + 1
+    // of them, and the capacity is kept above that so releasing a range cannot fail.
+    MemoryRange *free_ranges;
+    uint32_t free_count;
+    uint32_t free_capacity;
+};
+
+static bool reserve_free_ranges(VulkanMemoryBlock *block, const uint32_t needed) {
+    if (needed <= block->free_capacity) {
+        return true;
+    }
+    uint32_t capacity = block->free_capacity ? block->free_capacity * 2U : 8U;
+    while (capacity < needed) {
+        capacity *= 2U;
+    }
+    MemoryRange *ranges = realloc(block->free_ranges, capacity * sizeof(MemoryRange));
+    if (!ranges) {
+        return false;
+    }
+    block->free_ranges = ranges;
+    block->free_capacity = capacity;
+    return true;
+}
+
+// First fit. Alignment padding in front of the range stays free.
+static bool block_take(VulkanMemoryBlock *block, const VkDeviceSize size,
+                       const VkDeviceSize alignment, VkDeviceSize *out_offset) {
+    if (!reserve_free_ranges(block, block->allocation_count + 3U)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < block->free_count; i++) {
+        MemoryRange *range = &block->free_ranges[i];
+        const VkDeviceSize offset = align_up(range->offset, alignment);
+        const VkDeviceSize end = range->offset + range->size;
+        if (offset > end || end - offset < size) {
+            continue;
+        }
+
+        const VkDeviceSize head = offset - range->offset;
+        const VkDeviceSize tail = end - (offset + size);
+        if (head > 0 && tail > 0) {
+            memmove(&block->free_ranges[i + 2U], &block->free_ranges[i + 1U],
+                    (block->free_count - i - 1U) * sizeof(MemoryRange));
+            block->free_ranges[i + 1U] = (MemoryRange){offset + size, tail};
+            range->size = head;
+            block->free_count++;
+        } else if (head > 0) {
+            range->size = head;
+        } else if (tail > 0) {
+            *range = (MemoryRange){offset + size, tail};
+        } else {
+            memmove(range, range + 1, (block->free_count - i - 1U) * sizeof(MemoryRange));
+            block->free_count--;
+        }
+        block->allocation_count++;
+        *out_offset = offset;
+        return true;
+    }
+    return false;
+}
+
+static void block_release(VulkanMemoryBlock *block, const VkDeviceSize offset,
+                          const VkDeviceSize size) {
+    uint32_t index = 0;
+    while (index < block->free_count && block->free_ranges[index].offset < offset) {
+        index++;
+    }
+    MemoryRange *prev = index > 0 ? &block->free_ranges[index - 1U] : NULL;
+    MemoryRange *next = index < block->free_count ? &block->free_ranges[index] : NULL;
+    const bool join_prev = prev && prev->offset + prev->size == offset;
+    const bool join_next = next && offset + size == next->offset;
+
+    if (join_prev && join_next) {
+        prev->size += size + next->size;
+        memmove(next, next + 1, (block->free_count - index - 1U) * sizeof(MemoryRange));
+        block->free_count--;
+    } else if (join_prev) {
+        prev->size += size;
+    } else if (join_next) {
+        next->offset = offset;
+        next->size += size;
+    } else {
+        memmove(&block->free_ranges[index + 1U], &block->free_ranges[index],
+                (block->free_count - index) * sizeof(MemoryRange));
+        block->free_ranges[index] = (MemoryRange){offset, size};
+        block->free_count++;
+    }
+    block->allocation_count--;
+}
+
+static void destroy_block(VulkanRenderer *r, VulkanMemoryBlock *block) {
+    if (block->mapped) {
+        vkUnmapMemory(r->device, block->memory);
+    }
+    vkFreeMemory(r->device, block->memory, NULL);
+    free(block->free_ranges);
+    free(block);
+}
+
+static VulkanMemoryBlock *create_block(VulkanRenderer *r, const VulkanMemoryPool pool,
+                                       const uint32_t memory_type, const VkDeviceSize size,
+                                       const bool linear, const bool dedicated) {
+    VulkanMemoryBlock *block = calloc(1, sizeof(VulkanMemoryBlock));
+    if (!block || !reserve_free_ranges(block, 8U)) {
+        free(block);
+        vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "calloc",
+                                  "Failed to allocate memory block bookkeeping");
+        return NULL;
+    }
+
+    VkMemoryAllocateInfo alloc_info = {.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    alloc_info.allocationSize = size;
+    alloc_info.memoryTypeIndex = memory_type;
+    const VkResult result = vkAllocateMemory(r->device, &alloc_info, NULL, &block->memory);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkAllocateMemory",
+                                  "Failed to allocate %llu byte memory block",
+                                  (unsigned long long)size);
+        free(block->free_ranges);
+        free(block);
+        return NULL;
+    }
+
+    block->size = size;
+    block->memory_type = memory_type;
+    block->pool = pool;
+    block->linear = linear;
+    block->dedicated = dedicated;
+    block->free_ranges[0] = (MemoryRange){0, size};
+    block->free_count = 1;
+    block->next = r->memory_pools[pool];
+    r->memory_pools[pool] = block;
+    return block;
+}
+
+static VkDeviceSize block_size_for_type(const VulkanRenderer *r, const uint32_t memory_type) {
+    const uint32_t heap = r->mem_properties.memoryTypes[memory_type].heapIndex;
+    const VkDeviceSize heap_size = r->mem_properties.memoryHeaps[heap].size;
+    const VkDeviceSize limit = heap_size / MEMORY_BLOCK_HEAP_DIVISOR;
+    return (limit > 0 && limit < MEMORY_BLOCK_SIZE) ? limit : MEMORY_BLOCK_SIZE;
+}
+
+bool allocate_memory(VulkanRenderer *r, const VulkanMemoryPool pool,
+                     const VkMemoryRequirements *requirements,
+                     const VkMemoryPropertyFlags properties, const bool linear,
+                     VulkanAllocation *out_alloc) {
+    memset(out_alloc, 0, sizeof(*out_alloc));
+
+    uint32_t memory_type = 0;
+    if (!find_memory_type(r, requirements->memoryTypeBits, properties, &memory_type)) {
+        return false;
+    }
+
+    const bool host_visible = (r->mem_properties.memoryTypes[memory_type].propertyFlags &
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    VkDeviceSize alignment = requirements->alignment ? requirements->alignment : 1;
+    VkDeviceSize size = requirements->size;
+    if (host_visible && r->non_coherent_atom_size > alignment) {
+        alignment = r->non_coherent_atom_size;
+    }
+    if (host_visible && r->non_coherent_atom_size > 0) {
+        size = align_up(size, r->non_coherent_atom_size);
+    }
+
+    VulkanMemoryBlock *block = NULL;
+    VkDeviceSize offset = 0;
+    const VkDeviceSize block_size = block_size_for_type(r, memory_type);
+    const bool dedicated = size > block_size / 2U;
+    if (!dedicated) {
+        for (VulkanMemoryBlock *candidate = r->memory_pools[pool]; candidate;
+             candidate = candidate->next) {
+            if (!candidate->dedicated && candidate->memory_type == memory_type &&
+                candidate->linear == linear && block_take(candidate, size, alignment, &offset)) {
+                block = candidate;
+                break;
+            }
+        }
+    }
+    if (!block) {
+        block = create_block(r, pool, memory_type, dedicated ? size : block_size, linear,
+                             dedicated);
+        if (!block || !block_take(block, size, alignment, &offset)) {
+            return false;
+        }
+    }
+
+    if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !block->mapped) {
+        void *mapped = NULL;
+        const VkResult result = vkMapMemory(r->device, block->memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (result != VK_SUCCESS) {
+            vulkan_renderer_set_error(r, result, "vkMapMemory", "Failed to map memory block");
+            block_release(block, offset, size);
+            return false;
+        }
+        block->mapped = mapped;
+    }
+
+    out_alloc->memory = block->memory;
+    out_alloc->offset = offset;
+    out_alloc->size = size;
+    out_alloc->mapped = block->mapped ? block->mapped + offset : NULL;
+    out_alloc->block = block;
+    return true;
+}
+
+static void unlink_block(VulkanRenderer *r, VulkanMemoryBlock *block) {
+    VulkanMemoryBlock **link = &r->memory_pools[block->pool];
+    while (*link && *link != block) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = block->next;
+    }
+}
+
+void free_allocation(VulkanRenderer *r, VulkanAllocation *alloc) {
+    if (alloc->block) {
+        VulkanMemoryBlock *block = alloc->block;
+        block_release(block, alloc->offset, alloc->size);
+        if (block->dedicated && block->allocation_count == 0) {
+            unlink_block(r, block);
+            destroy_block(r, block);
+        }
+    } else if (alloc->memory != VK_NULL_HANDLE) {
+        vkFreeMemory(r->device, alloc->memory, NULL);
+    }
+    memset(alloc, 0, sizeof(*alloc));
+}
+
+void destroy_memory_pool(VulkanRenderer *r, const VulkanMemoryPool pool) {
+    VulkanMemoryBlock *block = r->memory_pools[pool];
+    while (block) {
+        VulkanMemoryBlock *next = block->next;
+        destroy_block(r, block);
+        block = next;
+    }
+    r->memory_pools[pool] = NULL;
+}
+
+// Device-local upload destinations are written on the transfer queue and read on the
+// graphics queue. Sharing them concurrently between the two families avoids ownership transfers.
+static void set_upload_sharing(const VulkanRenderer *r, const bool upload_destination,
+                               const uint32_t families[2], VkSharingMode *out_mode,
+                               uint32_t *out_family_count, const uint32_t **out_families) {
+    *out_mode = VK_SHARING_MODE_EXCLUSIVE;
+    if (upload_destination && r->transfer_queue_family != r->graphics_queue_family) {
+        *out_mode = VK_SHARING_MODE_CONCURRENT;
+        *out_family_count = 2;
+        *out_families = families;
+    }
+}
+
+bool create_buffer(VulkanRenderer *r, const VulkanMemoryPool pool, const VkDeviceSize size,
+                   const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties,
+                   VkBuffer *buffer, VulkanAllocation *alloc) {
     *buffer = VK_NULL_HANDLE;
     memset(alloc, 0, sizeof(*alloc));
 
+    const uint32_t families[2] = {r->graphics_queue_family, r->transfer_queue_family};
     VkBufferCreateInfo buffer_info = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
     buffer_info.size = size;
     buffer_info.usage = usage;
-    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    const bool upload_destination = (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) &&
+                                    (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    set_upload_sharing(r, upload_destination, families, &buffer_info.sharingMode,
+                       &buffer_info.queueFamilyIndexCount, &buffer_info.pQueueFamilyIndices);
 
     VkResult result = vkCreateBuffer(r->device, &buffer_info, NULL, buffer);
     if (result != VK_SUCCESS) {
@@ -32,12 +309,76 @@ bool create_buffer(VulkanRenderer *r, const VkDeviceSize size, const VkBufferUsa
         return false;
     }
 
+    VkMemoryRequirements mem_req;
+    vkGetBufferMemoryRequirements(r->device, *buffer, &mem_req);
+    if (!allocate_memory(r, pool, &mem_req, properties, true, alloc)) {
+        vkDestroyBuffer(r->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    result = vkBindBufferMemory(r->device, *buffer, alloc->memory, alloc->offset);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkBindBufferMemory", "Failed to bind buffer memory");
+        free_allocation(r, alloc);
+        vkDestroyBuffer(r->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    return true;
+}
+
+bool create_host_import_buffer(VulkanRenderer *r, void *host_pointer, const VkDeviceSize size,
+                               const VkBufferUsageFlags usage, VkBuffer *buffer,
+                               VulkanAllocation *alloc) {
+    *buffer = VK_NULL_HANDLE;
+    memset(alloc, 0, sizeof(*alloc));
+    if (!r->pfn_get_memory_host_pointer_properties) {
+        return false;
+    }
+
+    VkMemoryHostPointerPropertiesEXT pointer_props = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT};
+    VkResult result = r->pfn_get_memory_host_pointer_properties(
+        r->device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, host_pointer,
+        &pointer_props);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkGetMemoryHostPointerPropertiesEXT",
+                                  "Host memory cannot be imported");
+        return false;
+    }
+
+    VkExternalMemoryBufferCreateInfoKHR external_info = {
+        .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR};
+    external_info.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    VkBufferCreateInfo buffer_info = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    buffer_info.pNext = &external_info;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    result = vkCreateBuffer(r->device, &buffer_info, NULL, buffer);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkCreateBuffer", "Failed to create import buffer");
+        return false;
+    }
+
     VkMemoryRequirements mem_req;
     vkGetBufferMemoryRequirements(r->device, *buffer, &mem_req);
 
+    VkImportMemoryHostPointerInfoEXT import_info = {
+        .sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT};
+    import_info.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    import_info.pHostPointer = host_pointer;
     VkMemoryAllocateInfo alloc_info = {.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-    alloc_info.allocationSize = mem_req.size;
-    if (!find_memory_type(r, mem_req.memoryTypeBits, properties, &alloc_info.memoryTypeIndex)) {
+    alloc_info.pNext = &import_info;
+    alloc_info.allocationSize = size;
+    if (mem_req.size > size ||
+        !find_memory_type(r, mem_req.memoryTypeBits & pointer_props.memoryTypeBits,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          &alloc_info.memoryTypeIndex)) {
         vkDestroyBuffer(r->device, *buffer, NULL);
         *buffer = VK_NULL_HANDLE;
         return false;
@@ -45,62 +386,53 @@ bool create_buffer(VulkanRenderer *r, const VkDeviceSize size, const VkBufferUsa
 
     result = vkAllocateMemory(r->device, &alloc_info, NULL, &alloc->memory);
     if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, "vkAllocateMemory",
-                                  "Failed to allocate buffer memory");
+        vulkan_renderer_set_error(r, result, "vkAllocateMemory", "Failed to import host memory");
         vkDestroyBuffer(r->device, *buffer, NULL);
         *buffer = VK_NULL_HANDLE;
         return false;
     }
 
-    alloc->offset = 0;
-    alloc->size = mem_req.size;
-    alloc->mapped = NULL;
-
     result = vkBindBufferMemory(r->device, *buffer, alloc->memory, 0);
     if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, "vkBindBufferMemory", "Failed to bind buffer memory");
-        vkFreeMemory(r->device, alloc->memory, NULL);
+        vulkan_renderer_set_error(r, result, "vkBindBufferMemory", "Failed to bind import buffer");
+        free_allocation(r, alloc);
         vkDestroyBuffer(r->device, *buffer, NULL);
-        memset(alloc, 0, sizeof(*alloc));
         *buffer = VK_NULL_HANDLE;
         return false;
     }
 
-    // Map if host visible
-    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-        result = vkMapMemory(r->device, alloc->memory, 0, size, 0, &alloc->mapped);
-        if (result != VK_SUCCESS) {
-            vulkan_renderer_set_error(r, result, "vkMapMemory", "Failed to map buffer memory");
-            vkFreeMemory(r->device, alloc->memory, NULL);
-            vkDestroyBuffer(r->device, *buffer, NULL);
-            memset(alloc, 0, sizeof(*alloc));
-            *buffer = VK_NULL_HANDLE;
-            return false;
-        }
-    }
-
+    alloc->offset = 0;
+    alloc->size = size;
+    alloc->mapped = host_pointer;
     return true;
 }
 
-bool create_image(VulkanRenderer *r, const uint32_t width, const uint32_t height,
-                  const VkFormat format, const VkImageUsageFlags usage,
-                  VkMemoryPropertyFlags properties, VkImage *image, VulkanAllocation *alloc) {
+static bool create_tiled_image(VulkanRenderer *r, const VulkanMemoryPool pool,
+                               const uint32_t width, const uint32_t height,
+                               const uint32_t mip_levels, const VkFormat format,
+                               const VkImageTiling tiling, const VkImageUsageFlags usage,
+                               VkMemoryPropertyFlags properties, VkImage *image,
+                               VulkanAllocation *alloc) {
     *image = VK_NULL_HANDLE;
     memset(alloc, 0, sizeof(*alloc));
 
+    const uint32_t families[2] = {r->graphics_queue_family, r->transfer_queue_family};
     VkImageCreateInfo image_info = {.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
     image_info.imageType = VK_IMAGE_TYPE_2D;
     image_info.extent.width = width;
     image_info.extent.height = height;
     image_info.extent.depth = 1;
-    image_info.mipLevels = 1;
+    image_info.mipLevels = mip_levels;
     image_info.arrayLayers = 1;
     image_info.format = format;
-    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.tiling = tiling;
     image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     image_info.usage = usage;
     image_info.samples = VK_SAMPLE_COUNT_1_BIT;
-    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    const bool upload_destination = (usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+                                    (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    set_upload_sharing(r, upload_destination, families, &image_info.sharingMode,
+                       &image_info.queueFamilyIndexCount, &image_info.pQueueFamilyIndices);
 
     VkResult result = vkCreateImage(r->device, &image_info, NULL, image);
     if (result != VK_SUCCESS) {
@@ -111,32 +443,18 @@ bool create_image(VulkanRenderer *r, const uint32_t width, const uint32_t height
     VkMemoryRequirements mem_req;
     vkGetImageMemoryRequirements(r->device, *image, &mem_req);
 
-    VkMemoryAllocateInfo alloc_info = {.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-    alloc_info.allocationSize = mem_req.size;
-    if (!find_memory_type(r, mem_req.memoryTypeBits, properties, &alloc_info.memoryTypeIndex)) {
-        vkDestroyImage(r->device, *image, NULL);
-        *image = VK_NULL_HANDLE;
-        return false;
-    }
-
-    result = vkAllocateMemory(r->device, &alloc_info, NULL, &alloc->memory);
-    if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, "vkAllocateMemory", "Failed to allocate image memory");
+    if (!allocate_memory(r, pool, &mem_req, properties, tiling == VK_IMAGE_TILING_LINEAR,
+                         alloc)) {
         vkDestroyImage(r->device, *image, NULL);
         *image = VK_NULL_HANDLE;
         return false;
     }
 
-    alloc->offset = 0;
-    alloc->size = mem_req.size;
-    alloc->mapped = NULL;
-
-    result = vkBindImageMemory(r->device, *image, alloc->memory, 0);
+    result = vkBindImageMemory(r->device, *image, alloc->memory, alloc->offset);
     if (result != VK_SUCCESS) {
         vulkan_renderer_set_error(r, result, "vkBindImageMemory", "Failed to bind image memory");
-        vkFreeMemory(r->device, alloc->memory, NULL);
+        free_allocation(r, alloc);
         vkDestroyImage(r->device, *image, NULL);
-        memset(alloc, 0, sizeof(*alloc));
         *image = VK_NULL_HANDLE;
         return false;
     }
@@ -144,6 +462,30 @@ bool create_image(VulkanRenderer *r, const uint32_t width, const uint32_t height
     return true;
 }
 
+bool create_image(VulkanRenderer *r, const VulkanMemoryPool pool, const uint32_t width,
+                  const uint32_t height, const VkFormat format, const VkImageUsageFlags usage,
+                  const VkMemoryPropertyFlags properties, VkImage *image, VulkanAllocation *alloc) {
+    return create_tiled_image(r, pool, width, height, 1, format, VK_IMAGE_TILING_OPTIMAL, usage,
+                              properties, image, alloc);
+}
+
+bool create_mipmapped_image(VulkanRenderer *r, const VulkanMemoryPool pool, const uint32_t width,
+                            const uint32_t height, const uint32_t mip_levels,
+                            const VkFormat format, const VkImageUsageFlags usage,
+                            const VkMemoryPropertyFlags properties, VkImage *image,
+                            VulkanAllocation *alloc) {
+    return create_tiled_image(r, pool, width, height, mip_levels, format,
+                              VK_IMAGE_TILING_OPTIMAL, usage, properties, image, alloc);
+}
+
+bool create_linear_image(VulkanRenderer *r, const VulkanMemoryPool pool, const uint32_t width,
+                         const uint32_t height, const VkFormat format,
+                         const VkImageUsageFlags usage, const VkMemoryPropertyFlags properties,
+                         VkImage *image, VulkanAllocation *alloc) {
+    return create_tiled_image(r, pool, width, height, 1, format, VK_IMAGE_TILING_LINEAR, usage,
+                              properties, image, alloc);
+}
+
 VkImageView create_image_view(VulkanRenderer *r, VkImage image, VkFormat format,
                               VkImageAspectFlags aspect_flags) {
     VkImageViewCreateInfo view_info = {.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
@@ -152,7 +494,7 @@ VkImageView create_image_view(VulkanRenderer *r, VkImage image, VkFormat format,
     view_info.format = format;
     view_info.subresourceRange.aspectMask = aspect_flags;
     view_info.subresourceRange.baseMipLevel = 0;
-    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
     view_info.subresourceRange.baseArrayLayer = 0;
     view_info.subresourceRange.layerCount = 1;
 
@@ -164,189 +506,3 @@ VkImageView create_image_view(VulkanRenderer *r, VkImage image, VkFormat format,
     }
     return image_view;
 }
-
-bool begin_single_time_commands(VulkanRenderer *r, VkCommandBuffer *out_cmd) {
-    *out_cmd = VK_NULL_HANDLE;
-
-    VkCommandBufferAllocateInfo alloc_info = {.sType =
-                                                  VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
-    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    alloc_info.commandPool = r->command_pool;
-    alloc_info.commandBufferCount = 1;
-
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    VkResult result = vkAllocateCommandBuffers(r->device, &alloc_info, &cmd);
-    if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, "vkAllocateCommandBuffers",
-                                  "Failed to allocate single-use command buffer");
-        return false;
-    }
-
-    VkCommandBufferBeginInfo begin_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    result = vkBeginCommandBuffer(cmd, &begin_info);
-    if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, "vkBeginCommandBuffer",
-                                  "Failed to begin single-use command buffer");
-        vkFreeCommandBuffers(r->device, r->command_pool, 1, &cmd);
-        return false;
-    }
-
-    *out_cmd = cmd;
-    return true;
-}
-
-bool end_single_time_commands(VulkanRenderer *r, VkCommandBuffer cmd) {
-    VkResult result = vkEndCommandBuffer(cmd);
-    if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, "vkEndCommandBuffer",
-                                  "Failed to end single-use command buffer");
-        vkFreeCommandBuffers(r->device, r->command_pool, 1, &cmd);
-        return false;
-    }
-
-    VkFence transfer_fence = VK_NULL_HANDLE;
-    VkFenceCreateInfo fence_info = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-    result = vkCreateFence(r->device, &fence_info, NULL, &transfer_fence);
-    if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, "vkCreateFence",
-                                  "Failed to create fence for single-use command buffer");
-        vkFreeCommandBuffers(r->device, r->command_pool, 1, &cmd);
-        return false;
-    }
-
-    VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &cmd;
-
-    result = vkQueueSubmit(r->graphics_queue, 1, &submit_info, transfer_fence);
-    const char *operation = "vkQueueSubmit";
-    const char *detail = "Failed to submit single-use command buffer";
-    if (result == VK_SUCCESS) {
-        result = vkWaitForFences(r->device, 1, &transfer_fence, VK_TRUE, UINT64_MAX);
-        operation = "vkWaitForFences";
-        detail = "Failed waiting for single-use command buffer fence";
-    }
-
-    vkDestroyFence(r->device, transfer_fence, NULL);
-    vkFreeCommandBuffers(r->device, r->command_pool, 1, &cmd);
-    if (result != VK_SUCCESS) {
-        vulkan_renderer_set_error(r, result, operation, detail);
-        return false;
-    }
-    return true;
-}
-
-bool transition_image_layout(VulkanRenderer *r, VkImage image, VkImageLayout old_layout,
-                             VkImageLayout new_layout) {
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    if (!begin_single_time_commands(r, &cmd)) {
-        return false;
-    }
-
-    VkImageMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-    barrier.oldLayout = old_layout;
-    barrier.newLayout = new_layout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags src_stage;
-    VkPipelineStageFlags dst_stage;
-
-    if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED &&
-        new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-               new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = 0;
-        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    }
-
-    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
-
-    return end_single_time_commands(r, cmd);
-}
-
-bool copy_buffer_to_image(VulkanRenderer *r, VkBuffer buffer, VkImage image, uint32_t width,
-                          uint32_t height) {
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    if (!begin_single_time_commands(r, &cmd)) {
-        return false;
-    }
-
-    VkBufferImageCopy region = {0};
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageExtent.width = width;
-    region.imageExtent.height = height;
-    region.imageExtent.depth = 1;
-
-    vkCmdCopyBufferToImage(cmd, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    return end_single_time_commands(r, cmd);
-}
-
-bool upload_buffer_via_staging(VulkanRenderer *r, const void *data, VkDeviceSize size,
-                               VkBufferUsageFlagBits usage_bit, VkBuffer *buffer,
-                               VulkanAllocation *alloc) {
-    VkBuffer staging_buffer = VK_NULL_HANDLE;
-    VulkanAllocation staging_alloc = {0};
-    if (!create_buffer(r, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &staging_buffer, &staging_alloc)) {
-        return false;
-    }
-
-    if (!create_buffer(r, size, usage_bit | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, alloc)) {
-        vkDestroyBuffer(r->device, staging_buffer, NULL);
-        vkFreeMemory(r->device, staging_alloc.memory, NULL);
-        return false;
-    }
-
-    memcpy(staging_alloc.mapped, data, size);
-
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    if (!begin_single_time_commands(r, &cmd)) {
-        vkDestroyBuffer(r->device, staging_buffer, NULL);
-        vkFreeMemory(r->device, staging_alloc.memory, NULL);
-        vkDestroyBuffer(r->device, *buffer, NULL);
-        vkFreeMemory(r->device, alloc->memory, NULL);
-        *buffer = VK_NULL_HANDLE;
-        memset(alloc, 0, sizeof(*alloc));
-        return false;
-    }
-    VkBufferCopy copy_region = {0, 0, size};
-    vkCmdCopyBuffer(cmd, staging_buffer, *buffer, 1, &copy_region);
-    if (!end_single_time_commands(r, cmd)) {
-        vkDestroyBuffer(r->device, staging_buffer, NULL);
-        vkFreeMemory(r->device, staging_alloc.memory, NULL);
-        vkDestroyBuffer(r->device, *buffer, NULL);
-        vkFreeMemory(r->device, alloc->memory, NULL);
-        *buffer = VK_NULL_HANDLE;
-        memset(alloc, 0, sizeof(*alloc));
-        return false;
-    }
-
-    vkDestroyBuffer(r->device, staging_buffer, NULL);
-    vkFreeMemory(r->device, staging_alloc.memory, NULL);
-    return true;
-}
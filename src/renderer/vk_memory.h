@@ -8,24 +8,47 @@ static VkDeviceSize align_up(VkDeviceSize size, VkDeviceSize alignment) {
     return (size + alignment - 1) & ~(alignment - 1);
 }
 
-bool create_buffer(VulkanRenderer *r, VkDeviceSize size, VkBufferUsageFlags usage,
-                   VkMemoryPropertyFlags properties, VkBuffer *buffer, VulkanAllocation *alloc);
-
-bool create_image(VulkanRenderer *r, uint32_t width, uint32_t height, VkFormat format,
-                  VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage *image,
-                  VulkanAllocation *alloc);
+// Sub-allocates from `pool`, adding a block when none has room. Host-visible ranges are
+// mapped and aligned to nonCoherentAtomSize, so offset/size can be flushed or invalidated
+// as they are. `linear` keeps buffers and optimal-tiling images in separate blocks, which
+// sidesteps bufferImageGranularity.
+bool allocate_memory(VulkanRenderer *r, VulkanMemoryPool pool,
+                     const VkMemoryRequirements *requirements, VkMemoryPropertyFlags properties,
+                     bool linear, VulkanAllocation *out_alloc);
+// Returns the range to its block. Only blocks that held a single oversized allocation are
+// released here; the rest stay with the pool until destroy_memory_pool.
+void free_allocation(VulkanRenderer *r, VulkanAllocation *alloc);
+// Frees every block of the pool. Resources in it must already be destroyed.
+void destroy_memory_pool(VulkanRenderer *r, VulkanMemoryPool pool);
+
+bool create_buffer(VulkanRenderer *r, VulkanMemoryPool pool, VkDeviceSize size,
+                   VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer *buffer,
+                   VulkanAllocation *alloc);
+
+// Creates a buffer over existing host memory (VK_EXT_external_memory_host). host_pointer
+// and size must be multiples of min_imported_host_pointer_alignment; only host-coherent
+// memory types are accepted so the memory never needs mapping or invalidation.
+bool create_host_import_buffer(VulkanRenderer *r, void *host_pointer, VkDeviceSize size,
+                               VkBufferUsageFlags usage, VkBuffer *buffer,
+                               VulkanAllocation *alloc);
 
-VkImageView create_image_view(VulkanRenderer *r, VkImage image, VkFormat format,
-                              VkImageAspectFlags aspect_flags);
+bool create_image(VulkanRenderer *r, VulkanMemoryPool pool, uint32_t width, uint32_t height,
+                  VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
+                  VkImage *image, VulkanAllocation *alloc);
 
-bool begin_single_time_commands(VulkanRenderer *r, VkCommandBuffer *out_cmd);
-bool end_single_time_commands(VulkanRenderer *r, VkCommandBuffer cmd);
+// create_image with a full or partial mip chain; levels past the first are left undefined
+bool create_mipmapped_image(VulkanRenderer *r, VulkanMemoryPool pool, uint32_t width,
+                            uint32_t height, uint32_t mip_levels, VkFormat format,
+                            VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
+                            VkImage *image, VulkanAllocation *alloc);
 
-bool transition_image_layout(VulkanRenderer *r, VkImage image, VkImageLayout old_layout,
-                             VkImageLayout new_layout);
-bool copy_buffer_to_image(VulkanRenderer *r, VkBuffer buffer, VkImage image, uint32_t width,
-                          uint32_t height);
+// Linear tiling, so host-visible memory can be read in place; the row layout comes from
+// vkGetImageSubresourceLayout.
+bool create_linear_image(VulkanRenderer *r, VulkanMemoryPool pool, uint32_t width,
+                         uint32_t height, VkFormat format, VkImageUsageFlags usage,
+                         VkMemoryPropertyFlags properties, VkImage *image,
+                         VulkanAllocation *alloc);
 
-bool upload_buffer_via_staging(VulkanRenderer *r, const void *data, VkDeviceSize size,
-                               VkBufferUsageFlagBits usage_bit, VkBuffer *buffer,
-                               VulkanAllocation *alloc);
+// Covers every mip level of the image
+VkImageView create_image_view(VulkanRenderer *r, VkImage image, VkFormat format,
+                              VkImageAspectFlags aspect_flags);
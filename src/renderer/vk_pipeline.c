@@ -1,13 +1,149 @@
 #include "vk_pipeline.h"
+#include "graphics/vertex_format.h"
+#include "platform/io.h"
+#include "platform/path.h"
 #include "vk_shader.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes of VkPipelineCacheHeaderVersionOne: length, version, vendorID, deviceID, UUID.
+#define PIPELINE_CACHE_HEADER_SIZE (16U + VK_UUID_SIZE)
+
+// The file name carries vendor, device, driver version and pipelineCacheUUID, so a
+// driver update or a different GPU starts from an empty cache instead of feeding the
+// driver foreign data.
+static bool build_pipeline_cache_path(const VkPhysicalDeviceProperties *props, char *out,
+                                      const size_t out_size) {
+    char directory[400];
+    if (!dcat_get_cache_directory(directory, sizeof(directory))) {
+        return false;
+    }
+    char uuid[VK_UUID_SIZE * 2 + 1];
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+        snprintf(&uuid[i * 2U], 3, "%02x", props->pipelineCacheUUID[i]);
+    }
+    const int len = snprintf(out, out_size, "%spipeline-%08x-%08x-%08x-%s.bin", directory,
+                             props->vendorID, props->deviceID, props->driverVersion, uuid);
+    return len > 0 && (size_t)len < out_size;
+}
+
+static void *read_pipeline_cache_file(const char *path, size_t *out_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    void *data = NULL;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        const long file_size = ftell(f);
+        if (file_size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+            data = malloc((size_t)file_size);
+            if (data && fread(data, 1, (size_t)file_size, f) != (size_t)file_size) {
+                free(data);
+                data = NULL;
+            }
+            *out_size = (size_t)file_size;
+        }
+    }
+    fclose(f);
+    return data;
+}
+
+// Drivers are meant to reject mismatched data themselves; not all of them do.
+static bool pipeline_cache_header_matches(const uint8_t *data, const size_t size,
+                                          const VkPhysicalDeviceProperties *props) {
+    if (size < PIPELINE_CACHE_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t fields[4];
+    memcpy(fields, data, sizeof(fields));
+    return fields[0] >= PIPELINE_CACHE_HEADER_SIZE &&
+           fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && fields[2] == props->vendorID &&
+           fields[3] == props->deviceID &&
+           memcmp(data + sizeof(fields), props->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void create_pipeline_cache(VulkanRenderer *r) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(r->physical_device, &props);
+    if (!build_pipeline_cache_path(&props, r->pipeline_cache_path,
+                                   sizeof(r->pipeline_cache_path))) {
+        r->pipeline_cache_path[0] = '\0';
+    }
+
+    size_t data_size = 0;
+    void *data =
+        r->pipeline_cache_path[0] ? read_pipeline_cache_file(r->pipeline_cache_path, &data_size)
+                                  : NULL;
+    if (data && !pipeline_cache_header_matches(data, data_size, &props)) {
+        free(data);
+        data = NULL;
+    }
+
+    VkPipelineCacheCreateInfo cache_info = {.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    cache_info.initialDataSize = data ? data_size : 0;
+    cache_info.pInitialData = data;
+    VkResult result = vkCreatePipelineCache(r->device, &cache_info, NULL, &r->pipeline_cache);
+    if (result != VK_SUCCESS && data) {
+        // Corrupt file: start over rather than fail startup
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = NULL;
+        result = vkCreatePipelineCache(r->device, &cache_info, NULL, &r->pipeline_cache);
+        free(data);
+        data = NULL;
+    }
+    r->pipeline_cache_loaded_size = data ? data_size : 0;
+    free(data);
+    if (result != VK_SUCCESS) {
+        // Pipelines still build without a cache, just slower
+        r->pipeline_cache = VK_NULL_HANDLE;
+        return;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE_CACHE, r->pipeline_cache, "pipeline_cache");
+}
+
+void save_pipeline_cache(VulkanRenderer *r) {
+    if (r->pipeline_cache == VK_NULL_HANDLE || !r->pipeline_cache_path[0]) {
+        return;
+    }
+    size_t size = 0;
+    if (vkGetPipelineCacheData(r->device, r->pipeline_cache, &size, NULL) != VK_SUCCESS ||
+        size == 0 || size == r->pipeline_cache_loaded_size) {
+        // Same size as loaded: every pipeline came from the cache
+        return;
+    }
+    void *data = malloc(size);
+    if (!data || vkGetPipelineCacheData(r->device, r->pipeline_cache, &size, data) != VK_SUCCESS) {
+        free(data);
+        return;
+    }
+
+    // Write then rename, so a concurrent dcat never reads a half-written cache
+    char temp_path[sizeof(r->pipeline_cache_path) + 16];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", r->pipeline_cache_path, dcat_getpid());
+    FILE *f = fopen(temp_path, "wb");
+    bool written = false;
+    if (f) {
+        written = fwrite(data, 1, size, f) == size;
+        written = (fclose(f) == 0) && written;
+    }
+    free(data);
+#ifdef _WIN32
+    if (written) {
+        remove(r->pipeline_cache_path);
+    }
+#endif
+    if (!written || rename(temp_path, r->pipeline_cache_path) != 0) {
+        remove(temp_path);
+    }
+}
 
 bool create_descriptor_set_layout(VulkanRenderer *r) {
-    VkDescriptorSetLayoutBinding bindings[4] = {0};
+    VkDescriptorSetLayoutBinding bindings[6] = {0};
 
-    // Uniform buffer
+    // Bone matrices (dynamic offset into the uniform ring)
     bindings[0].binding = 0;
-    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     bindings[0].descriptorCount = 1;
     bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -23,15 +159,27 @@ bool create_descriptor_set_layout(VulkanRenderer *r) {
     bindings[2].descriptorCount = 1;
     bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    // Fragment uniforms
+    // Constants of every material, indexed by the draw's material
     bindings[3].binding = 3;
-    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     bindings[3].descriptorCount = 1;
     bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+    // Transforms, light and camera: the FrameBlock (dynamic offset into the uniform ring)
+    bindings[4].binding = 4;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[4].descriptorCount = 1;
+    bindings[4].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Baked poses of the mesh's animations (BakedPoses::rows)
+    bindings[5].binding = 5;
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[5].descriptorCount = 1;
+    bindings[5].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
     VkDescriptorSetLayoutCreateInfo layout_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
-    layout_info.bindingCount = 4;
+    layout_info.bindingCount = 6;
     layout_info.pBindings = bindings;
 
     if (vkCreateDescriptorSetLayout(r->device, &layout_info, NULL, &r->descriptor_set_layout) !=
@@ -45,17 +193,12 @@ bool create_descriptor_set_layout(VulkanRenderer *r) {
 }
 
 bool create_pipeline_layout(VulkanRenderer *r) {
-    VkPushConstantRange push_constant_range = {0};
-    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    push_constant_range.offset = 0;
-    push_constant_range.size = sizeof(PushConstants);
-
+    // No push constants: the transforms are in the frame block, which secondary command
+    // buffers reused across frames read without being recorded again
     VkPipelineLayoutCreateInfo pipeline_layout_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
     pipeline_layout_info.setLayoutCount = 1;
     pipeline_layout_info.pSetLayouts = &r->descriptor_set_layout;
-    pipeline_layout_info.pushConstantRangeCount = 1;
-    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
 
     if (vkCreatePipelineLayout(r->device, &pipeline_layout_info, NULL, &r->pipeline_layout) !=
         VK_SUCCESS) {
@@ -143,78 +286,98 @@ bool create_render_pass(VulkanRenderer *r) {
     return true;
 }
 
-bool create_graphics_pipeline(VulkanRenderer *r) {
-    size_t vert_size;
-    size_t frag_size;
-    char *vert_code = read_shader_file(r, "shader.vert.spv", &vert_size);
-    char *frag_code = read_shader_file(r, "shader.frag.spv", &frag_size);
-
-    if (!vert_code || !frag_code) {
-        free(vert_code);
-        free(frag_code);
-        return false;
+static VkShaderModule load_shader_module(VulkanRenderer *r, const char *filename,
+                                         const char *name) {
+    size_t size;
+    char *code = read_shader_file(r, filename, &size);
+    if (!code) {
+        return VK_NULL_HANDLE;
     }
+    VkShaderModule module = create_shader_module(r, code, size, name);
+    free(code);
+    return module;
+}
 
-    VkShaderModule vert_module = create_shader_module(r, vert_code, vert_size, "shader.vert");
-    VkShaderModule frag_module = create_shader_module(r, frag_code, frag_size, "shader.frag");
-    free(vert_code);
-    free(frag_code);
-
-    if (vert_module == VK_NULL_HANDLE || frag_module == VK_NULL_HANDLE) {
-        return false;
+// Specialization constants of a mesh pipeline, by the shaders' constant_id order
+typedef struct MeshSpecialization {
+    int32_t bone_influences;       // shader.vert, constant_id 0
+    VkBool32 enable_lighting;      // shader.frag, constant_id 1
+    VkBool32 triplanar_mapping;    // 2
+    uint32_t alpha_handling;       // 3
+    VkBool32 diffuse_alpha_luster; // 4
+} MeshSpecialization;
+
+// Drops the bits a variant ignores, so equivalent requests share one pipeline
+static uint32_t normalize_mesh_pipeline_key(uint32_t key) {
+    if ((key & MESH_PIPELINE_SKINNED) == 0) {
+        key &= ~(3U << MESH_PIPELINE_INFLUENCE_SHIFT);
+    }
+    if ((key & MESH_PIPELINE_BLEND) != 0) {
+        key &= ~MESH_PIPELINE_MATERIAL_ALPHA;
+    }
+    if ((key & MESH_PIPELINE_LIGHTING) == 0) {
+        key &= ~MESH_PIPELINE_LUSTER;
     }
+    return key & (MESH_PIPELINE_VARIANT_COUNT - 1U);
+}
+
+static VkResult create_mesh_pipeline(const VulkanRenderer *r, const uint32_t key,
+                                     VkPipeline *out) {
+    const bool skinned = (key & MESH_PIPELINE_SKINNED) != 0;
+    const bool blend = (key & MESH_PIPELINE_BLEND) != 0;
+
+    const MeshSpecialization specialization = {
+        .bone_influences = (int32_t)((key >> MESH_PIPELINE_INFLUENCE_SHIFT) & 3U) + 1,
+        .enable_lighting = (key & MESH_PIPELINE_LIGHTING) != 0 ? VK_TRUE : VK_FALSE,
+        .triplanar_mapping = (key & MESH_PIPELINE_TRIPLANAR) != 0 ? VK_TRUE : VK_FALSE,
+        .alpha_handling = blend ? 2U : ((key & MESH_PIPELINE_MATERIAL_ALPHA) != 0 ? 1U : 0U),
+        .diffuse_alpha_luster = (key & MESH_PIPELINE_LUSTER) != 0 ? VK_TRUE : VK_FALSE,
+    };
+    const VkSpecializationMapEntry vert_entries[] = {
+        {0, offsetof(MeshSpecialization, bone_influences), sizeof(int32_t)}};
+    const VkSpecializationMapEntry frag_entries[] = {
+        {1, offsetof(MeshSpecialization, enable_lighting), sizeof(VkBool32)},
+        {2, offsetof(MeshSpecialization, triplanar_mapping), sizeof(VkBool32)},
+        {3, offsetof(MeshSpecialization, alpha_handling), sizeof(uint32_t)},
+        {4, offsetof(MeshSpecialization, diffuse_alpha_luster), sizeof(VkBool32)}};
+    const VkSpecializationInfo vert_specialization = {1, vert_entries, sizeof(specialization),
+                                                      &specialization};
+    const VkSpecializationInfo frag_specialization = {4, frag_entries, sizeof(specialization),
+                                                      &specialization};
 
     VkPipelineShaderStageCreateInfo shader_stages[2] = {
         {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO},
         {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO}};
     shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shader_stages[0].module = vert_module;
+    shader_stages[0].module = skinned ? r->mesh_skinned_vert_module : r->mesh_vert_module;
     shader_stages[0].pName = "main";
+    shader_stages[0].pSpecializationInfo = skinned ? &vert_specialization : NULL;
     shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shader_stages[1].module = frag_module;
+    shader_stages[1].module = r->mesh_frag_module;
     shader_stages[1].pName = "main";
-
-    // Vertex input
-    VkVertexInputBindingDescription binding_desc = {0};
-    binding_desc.binding = 0;
-    binding_desc.stride = sizeof(Vertex);
-    binding_desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription attr_descs[7] = {0};
-    // Position
-    attr_descs[0].location = 0;
-    attr_descs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attr_descs[0].offset = offsetof(Vertex, position);
-    // Texcoord
-    attr_descs[1].location = 1;
-    attr_descs[1].format = VK_FORMAT_R32G32_SFLOAT;
-    attr_descs[1].offset = offsetof(Vertex, texcoord);
-    // Normal
-    attr_descs[2].location = 2;
-    attr_descs[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attr_descs[2].offset = offsetof(Vertex, normal);
-    // Tangent
-    attr_descs[3].location = 3;
-    attr_descs[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attr_descs[3].offset = offsetof(Vertex, tangent);
-    // Bitangent
-    attr_descs[4].location = 4;
-    attr_descs[4].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attr_descs[4].offset = offsetof(Vertex, bitangent);
-    // Bone IDs
-    attr_descs[5].location = 5;
-    attr_descs[5].format = VK_FORMAT_R32G32B32A32_SINT;
-    attr_descs[5].offset = offsetof(Vertex, bone_ids);
-    // Bone Weights
-    attr_descs[6].location = 6;
-    attr_descs[6].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attr_descs[6].offset = offsetof(Vertex, bone_weights);
+    shader_stages[1].pSpecializationInfo = &frag_specialization;
+
+    // Vertex input: the packed vertex stream, the per-instance material index (picked by
+    // each draw's firstInstance), plus the skinning stream for animated meshes
+    VkVertexInputBindingDescription binding_descs[3] = {
+        {0, sizeof(PackedVertex), VK_VERTEX_INPUT_RATE_VERTEX},
+        {2, sizeof(uint32_t), VK_VERTEX_INPUT_RATE_INSTANCE},
+        {1, sizeof(PackedSkin), VK_VERTEX_INPUT_RATE_VERTEX}};
+
+    VkVertexInputAttributeDescription attr_descs[7] = {
+        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(PackedVertex, position)},
+        {1, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, texcoord)},
+        {2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal)},
+        {3, 0, VK_FORMAT_R8G8B8A8_SNORM, offsetof(PackedVertex, tangent)},
+        {4, 2, VK_FORMAT_R32_UINT, 0},
+        {5, 1, VK_FORMAT_R16G16B16A16_UINT, offsetof(PackedSkin, joints)},
+        {6, 1, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedSkin, weights)}};
 
     VkPipelineVertexInputStateCreateInfo vertex_input_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-    vertex_input_info.vertexBindingDescriptionCount = 1;
-    vertex_input_info.pVertexBindingDescriptions = &binding_desc;
-    vertex_input_info.vertexAttributeDescriptionCount = 7;
+    vertex_input_info.vertexBindingDescriptionCount = skinned ? 3 : 2;
+    vertex_input_info.pVertexBindingDescriptions = binding_descs;
+    vertex_input_info.vertexAttributeDescriptionCount = skinned ? 7 : 5;
     vertex_input_info.pVertexAttributeDescriptions = attr_descs;
 
     VkPipelineInputAssemblyStateCreateInfo input_assembly = {
@@ -233,19 +396,22 @@ bool create_graphics_pipeline(VulkanRenderer *r) {
 
     VkPipelineRasterizationStateCreateInfo rasterizer = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.polygonMode =
+        (key & MESH_PIPELINE_WIREFRAME) != 0 ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0F;
-    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.cullMode =
+        (key & MESH_PIPELINE_CULL_BACK) != 0 ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 
     VkPipelineMultisampleStateCreateInfo multisampling = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
     multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
+    // Blended draws leave depth writes off for correct transparency
     VkPipelineDepthStencilStateCreateInfo depth_stencil = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
     depth_stencil.depthTestEnable = VK_TRUE;
-    depth_stencil.depthWriteEnable = VK_TRUE;
+    depth_stencil.depthWriteEnable = blend ? VK_FALSE : VK_TRUE;
     depth_stencil.depthCompareOp = VK_COMPARE_OP_GREATER;
 
     VkPipelineColorBlendAttachmentState color_blend_attachment = {0};
@@ -286,45 +452,61 @@ bool create_graphics_pipeline(VulkanRenderer *r) {
     pipeline_info.renderPass = r->render_pass;
     pipeline_info.subpass = 0;
 
-    // Create solid pipeline
-    if (vkCreateGraphicsPipelines(r->device, VK_NULL_HANDLE, 1, &pipeline_info, NULL,
-                                  &r->graphics_pipeline) != VK_SUCCESS) {
-        fprintf(stderr, "Failed to create graphics pipeline\n");
-        vkDestroyShaderModule(r->device, vert_module, NULL);
-        vkDestroyShaderModule(r->device, frag_module, NULL);
-        return false;
+    return vkCreateGraphicsPipelines(r->device, r->pipeline_cache, 1, &pipeline_info, NULL, out);
+}
+
+VkPipeline get_mesh_pipeline(VulkanRenderer *r, uint32_t key) {
+    key = normalize_mesh_pipeline_key(key);
+    if (r->mesh_pipelines[key] != VK_NULL_HANDLE) {
+        return r->mesh_pipelines[key];
+    }
+    const VkResult result = create_mesh_pipeline(r, key, &r->mesh_pipelines[key]);
+    if (result != VK_SUCCESS) {
+        r->mesh_pipelines[key] = VK_NULL_HANDLE;
+        vulkan_renderer_set_error(r, result, "vkCreateGraphicsPipelines",
+                                  "Failed to create mesh pipeline variant");
+        return VK_NULL_HANDLE;
     }
+    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE, r->mesh_pipelines[key], "mesh_pipeline_%03x", key);
+    return r->mesh_pipelines[key];
+}
 
-    // Create blend pipeline (depth writes disabled for correct transparency)
-    depth_stencil.depthWriteEnable = VK_FALSE;
-    if (vkCreateGraphicsPipelines(r->device, VK_NULL_HANDLE, 1, &pipeline_info, NULL,
-                                  &r->blend_pipeline) != VK_SUCCESS) {
-        fprintf(stderr, "Failed to create blend pipeline\n");
-        vkDestroyPipeline(r->device, r->graphics_pipeline, NULL);
-        vkDestroyShaderModule(r->device, vert_module, NULL);
-        vkDestroyShaderModule(r->device, frag_module, NULL);
-        return false;
+void destroy_mesh_pipelines(VulkanRenderer *r) {
+    for (uint32_t i = 0; i < MESH_PIPELINE_VARIANT_COUNT; i++) {
+        if (r->mesh_pipelines[i] != VK_NULL_HANDLE) {
+            vkDestroyPipeline(r->device, r->mesh_pipelines[i], NULL);
+            r->mesh_pipelines[i] = VK_NULL_HANDLE;
+        }
+    }
+    VkShaderModule *modules[] = {&r->mesh_vert_module, &r->mesh_skinned_vert_module,
+                                 &r->mesh_frag_module};
+    for (size_t i = 0; i < sizeof(modules) / sizeof(modules[0]); i++) {
+        if (*modules[i] != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(r->device, *modules[i], NULL);
+            *modules[i] = VK_NULL_HANDLE;
+        }
     }
+}
 
-    // Create wireframe pipeline
-    depth_stencil.depthWriteEnable = VK_TRUE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_LINE;
-    if (vkCreateGraphicsPipelines(r->device, VK_NULL_HANDLE, 1, &pipeline_info, NULL,
-                                  &r->wireframe_pipeline) != VK_SUCCESS) {
-        fprintf(stderr, "Failed to create wireframe pipeline\n");
-        vkDestroyPipeline(r->device, r->blend_pipeline, NULL);
-        vkDestroyPipeline(r->device, r->graphics_pipeline, NULL);
-        vkDestroyShaderModule(r->device, vert_module, NULL);
-        vkDestroyShaderModule(r->device, frag_module, NULL);
+bool create_graphics_pipeline(VulkanRenderer *r) {
+    r->mesh_vert_module = load_shader_module(r, "shader.vert.spv", "shader.vert");
+    r->mesh_skinned_vert_module =
+        load_shader_module(r, "shader_skinned.vert.spv", "shader_skinned.vert");
+    r->mesh_frag_module = load_shader_module(r, "shader.frag.spv", "shader.frag");
+    if (r->mesh_vert_module == VK_NULL_HANDLE || r->mesh_skinned_vert_module == VK_NULL_HANDLE ||
+        r->mesh_frag_module == VK_NULL_HANDLE) {
+        destroy_mesh_pipelines(r);
         return false;
     }
 
-    vkDestroyShaderModule(r->device, vert_module, NULL);
-    vkDestroyShaderModule(r->device, frag_module, NULL);
-
-    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE, r->graphics_pipeline, "graphics_pipeline");
-    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE, r->blend_pipeline, "blend_pipeline");
-    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE, r->wireframe_pipeline, "wireframe_pipeline");
+    // The lit static variants are built up front, so broken shaders fail initialization
+    // rather than the first frame; the rest follow the models actually drawn
+    if (get_mesh_pipeline(r, MESH_PIPELINE_LIGHTING) == VK_NULL_HANDLE ||
+        get_mesh_pipeline(r, MESH_PIPELINE_LIGHTING | MESH_PIPELINE_BLEND) == VK_NULL_HANDLE) {
+        fprintf(stderr, "Failed to create graphics pipeline\n");
+        destroy_mesh_pipelines(r);
+        return false;
+    }
     return true;
 }
 
@@ -404,18 +586,9 @@ bool create_skydome_pipeline(VulkanRenderer *r) {
     shader_stages[1].module = frag_module;
     shader_stages[1].pName = "main";
 
-    // Vertex input - only position and texcoord
-    VkVertexInputBindingDescription binding_desc = {0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX};
-    VkVertexInputAttributeDescription attr_descs[2] = {
-        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)},
-        {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, texcoord)}};
-
+    // No vertex input: skydome.vert makes its fullscreen triangle from the vertex index
     VkPipelineVertexInputStateCreateInfo vertex_input = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-    vertex_input.vertexBindingDescriptionCount = 1;
-    vertex_input.pVertexBindingDescriptions = &binding_desc;
-    vertex_input.vertexAttributeDescriptionCount = 2;
-    vertex_input.pVertexAttributeDescriptions = attr_descs;
 
     VkPipelineInputAssemblyStateCreateInfo input_assembly = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
@@ -434,7 +607,7 @@ bool create_skydome_pipeline(VulkanRenderer *r) {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
     rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0F;
-    rasterizer.cullMode = VK_CULL_MODE_FRONT_BIT;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 
     VkPipelineMultisampleStateCreateInfo multisampling = {
@@ -478,7 +651,7 @@ bool create_skydome_pipeline(VulkanRenderer *r) {
     pipeline_info.renderPass = r->render_pass;
     pipeline_info.subpass = 0;
 
-    if (vkCreateGraphicsPipelines(r->device, VK_NULL_HANDLE, 1, &pipeline_info, NULL,
+    if (vkCreateGraphicsPipelines(r->device, r->pipeline_cache, 1, &pipeline_info, NULL,
                                   &r->skydome_pipeline) != VK_SUCCESS) {
         vkDestroyShaderModule(r->device, vert_module, NULL);
         vkDestroyShaderModule(r->device, frag_module, NULL);
@@ -510,3 +683,219 @@ bool create_skydome_pipeline(VulkanRenderer *r) {
 
     return true;
 }
+
+bool create_cells_pipeline(VulkanRenderer *r) {
+    size_t comp_size;
+    char *comp_code = read_shader_file(r, "cells.comp.spv", &comp_size);
+    if (!comp_code) {
+        fprintf(stderr, "Warning: Cell shader not found\n");
+        return false;
+    }
+
+    VkShaderModule comp_module = create_shader_module(r, comp_code, comp_size, "cells.comp");
+    free(comp_code);
+    if (comp_module == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    // Rendered colour image in, cell grid out
+    VkDescriptorSetLayoutBinding bindings[2] = {0};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layout_info.bindingCount = 2;
+    layout_info.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(r->device, &layout_info, NULL,
+                                    &r->cells_descriptor_set_layout) != VK_SUCCESS) {
+        vkDestroyShaderModule(r->device, comp_module, NULL);
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, r->cells_descriptor_set_layout,
+            "cells_descriptor_set_layout");
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(CellPushConstants);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &r->cells_descriptor_set_layout;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(r->device, &pipeline_layout_info, NULL,
+                               &r->cells_pipeline_layout) != VK_SUCCESS) {
+        vkDestroyShaderModule(r->device, comp_module, NULL);
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE_LAYOUT, r->cells_pipeline_layout, "cells_pipeline_layout");
+
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = comp_module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = r->cells_pipeline_layout;
+
+    const VkResult result = vkCreateComputePipelines(r->device, r->pipeline_cache, 1,
+                                                     &pipeline_info, NULL, &r->cells_pipeline);
+    vkDestroyShaderModule(r->device, comp_module, NULL);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "Failed to create cell pipeline\n");
+        r->cells_pipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE, r->cells_pipeline, "cells_pipeline");
+
+    // The sets are rewritten every frame, so they get a pool of their own.
+    const VkDescriptorPoolSize pool_sizes[2] = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_FRAMES_IN_FLIGHT},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_FRAMES_IN_FLIGHT},
+    };
+    VkDescriptorPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes = pool_sizes;
+    pool_info.maxSets = MAX_FRAMES_IN_FLIGHT;
+    if (vkCreateDescriptorPool(r->device, &pool_info, NULL, &r->cells_descriptor_pool) !=
+        VK_SUCCESS) {
+        fprintf(stderr, "Failed to create cell descriptor pool\n");
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_DESCRIPTOR_POOL, r->cells_descriptor_pool, "cells_descriptor_pool");
+
+    VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT];
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        layouts[i] = r->cells_descriptor_set_layout;
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {.sType =
+                                                  VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc_info.descriptorPool = r->cells_descriptor_pool;
+    alloc_info.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    alloc_info.pSetLayouts = layouts;
+
+    if (vkAllocateDescriptorSets(r->device, &alloc_info, r->cells_descriptor_sets) != VK_SUCCESS) {
+        fprintf(stderr, "Failed to allocate cell descriptor sets\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool create_cull_pipeline(VulkanRenderer *r) {
+    size_t comp_size;
+    char *comp_code = read_shader_file(r, "cull.comp.spv", &comp_size);
+    if (!comp_code) {
+        fprintf(stderr, "Warning: Meshlet culling shader not found\n");
+        return false;
+    }
+
+    VkShaderModule comp_module = create_shader_module(r, comp_code, comp_size, "cull.comp");
+    free(comp_code);
+    if (comp_module == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    // Meshlets in, this frame's draw commands out
+    VkDescriptorSetLayoutBinding bindings[2] = {0};
+    for (uint32_t i = 0; i < 2; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layout_info.bindingCount = 2;
+    layout_info.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(r->device, &layout_info, NULL,
+                                    &r->cull_descriptor_set_layout) != VK_SUCCESS) {
+        vkDestroyShaderModule(r->device, comp_module, NULL);
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, r->cull_descriptor_set_layout,
+            "cull_descriptor_set_layout");
+
+    VkPushConstantRange push_constant_range = {0};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(CullPushConstants);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &r->cull_descriptor_set_layout;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(r->device, &pipeline_layout_info, NULL,
+                               &r->cull_pipeline_layout) != VK_SUCCESS) {
+        vkDestroyShaderModule(r->device, comp_module, NULL);
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE_LAYOUT, r->cull_pipeline_layout, "cull_pipeline_layout");
+
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = comp_module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = r->cull_pipeline_layout;
+
+    const VkResult result = vkCreateComputePipelines(r->device, r->pipeline_cache, 1,
+                                                     &pipeline_info, NULL, &r->cull_pipeline);
+    vkDestroyShaderModule(r->device, comp_module, NULL);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "Failed to create meshlet culling pipeline\n");
+        r->cull_pipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_PIPELINE, r->cull_pipeline, "cull_pipeline");
+
+    // Rewritten every frame, as the command buffers grow, so they get a pool of their own
+    const VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                            2 * MAX_FRAMES_IN_FLIGHT};
+    VkDescriptorPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    pool_info.maxSets = MAX_FRAMES_IN_FLIGHT;
+    if (vkCreateDescriptorPool(r->device, &pool_info, NULL, &r->cull_descriptor_pool) !=
+        VK_SUCCESS) {
+        fprintf(stderr, "Failed to create meshlet culling descriptor pool\n");
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_DESCRIPTOR_POOL, r->cull_descriptor_pool, "cull_descriptor_pool");
+
+    VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT];
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        layouts[i] = r->cull_descriptor_set_layout;
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {.sType =
+                                                  VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc_info.descriptorPool = r->cull_descriptor_pool;
+    alloc_info.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    alloc_info.pSetLayouts = layouts;
+
+    if (vkAllocateDescriptorSets(r->device, &alloc_info, r->cull_descriptor_sets) != VK_SUCCESS) {
+        fprintf(stderr, "Failed to allocate meshlet culling descriptor sets\n");
+        return false;
+    }
+
+    return true;
+}
@@ -1,8 +1,22 @@
 #pragma once
 #include "vulkan_renderer.h"
 
+// Loads the on-disk pipeline cache for this device and driver. A missing or stale file
+// just means an empty cache, and without any cache pipelines are still created.
+void create_pipeline_cache(VulkanRenderer *r);
+// Writes the cache back if this run compiled anything new.
+void save_pipeline_cache(VulkanRenderer *r);
 bool create_descriptor_set_layout(VulkanRenderer *r);
 bool create_pipeline_layout(VulkanRenderer *r);
 bool create_render_pass(VulkanRenderer *r);
+// Loads the mesh shaders and builds the common variants
 bool create_graphics_pipeline(VulkanRenderer *r);
+// The mesh pipeline for MESH_PIPELINE_* `key`, created through the pipeline cache the first
+// time it is asked for. VK_NULL_HANDLE, with the renderer error set, when that fails.
+VkPipeline get_mesh_pipeline(VulkanRenderer *r, uint32_t key);
+void destroy_mesh_pipelines(VulkanRenderer *r);
 bool create_skydome_pipeline(VulkanRenderer *r);
+bool create_cells_pipeline(VulkanRenderer *r);
+// False when the shader is missing or the device refuses it; meshlets are then culled on the
+// CPU
+bool create_cull_pipeline(VulkanRenderer *r);
@@ -0,0 +1,252 @@
+#include "vk_readback_probe.h"
+#include "core/time_utils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Timed rounds per device; one more runs first so lazy driver setup is not measured
+#define PROBE_ROUNDS 3U
+// Bound on one round, so a wedged device loses instead of stalling startup
+#define PROBE_TIMEOUT_NS 2000000000ULL
+
+typedef struct ReadbackProbe {
+    VkDevice device;
+    VkQueue queue;
+    VkImage image;
+    VkDeviceMemory image_memory;
+    VkBuffer buffer;
+    VkDeviceMemory buffer_memory;
+    void *mapped;
+    bool coherent;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+} ReadbackProbe;
+
+static bool find_probe_memory_type(const VkPhysicalDeviceMemoryProperties *properties,
+                                   const uint32_t type_filter, const VkMemoryPropertyFlags wanted,
+                                   uint32_t *out_type) {
+    for (uint32_t i = 0; i < properties->memoryTypeCount; i++) {
+        if ((type_filter & (1U << i)) &&
+            (properties->memoryTypes[i].propertyFlags & wanted) == wanted) {
+            *out_type = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool allocate_probe_memory(ReadbackProbe *probe,
+                                  const VkPhysicalDeviceMemoryProperties *properties,
+                                  const VkMemoryRequirements *requirements,
+                                  const VkMemoryPropertyFlags wanted,
+                                  const VkMemoryPropertyFlags fallback, VkDeviceMemory *out) {
+    VkMemoryAllocateInfo alloc_info = {.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    alloc_info.allocationSize = requirements->size;
+    if (!find_probe_memory_type(properties, requirements->memoryTypeBits, wanted,
+                                &alloc_info.memoryTypeIndex) &&
+        !find_probe_memory_type(properties, requirements->memoryTypeBits, fallback,
+                                &alloc_info.memoryTypeIndex)) {
+        return false;
+    }
+    probe->coherent = (properties->memoryTypes[alloc_info.memoryTypeIndex].propertyFlags &
+                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    return vkAllocateMemory(probe->device, &alloc_info, NULL, out) == VK_SUCCESS;
+}
+
+static bool create_probe_targets(ReadbackProbe *probe, VkPhysicalDevice physical_device,
+                                 const uint32_t width, const uint32_t height) {
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+
+    VkImageCreateInfo image_info = {.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_info.extent = (VkExtent3D){width, height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(probe->device, &image_info, NULL, &probe->image) != VK_SUCCESS) {
+        return false;
+    }
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(probe->device, probe->image, &requirements);
+    if (!allocate_probe_memory(probe, &properties, &requirements,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &probe->image_memory) ||
+        vkBindImageMemory(probe->device, probe->image, probe->image_memory, 0) != VK_SUCCESS) {
+        return false;
+    }
+
+    VkBufferCreateInfo buffer_info = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    buffer_info.size = (VkDeviceSize)width * height * 4U;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(probe->device, &buffer_info, NULL, &probe->buffer) != VK_SUCCESS) {
+        return false;
+    }
+    vkGetBufferMemoryRequirements(probe->device, probe->buffer, &requirements);
+    // The same preference as the renderer's readback buffers
+    if (!allocate_probe_memory(
+            probe, &properties, &requirements,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &probe->buffer_memory) ||
+        vkBindBufferMemory(probe->device, probe->buffer, probe->buffer_memory, 0) != VK_SUCCESS) {
+        return false;
+    }
+    return vkMapMemory(probe->device, probe->buffer_memory, 0, VK_WHOLE_SIZE, 0,
+                       &probe->mapped) == VK_SUCCESS;
+}
+
+static void record_probe_frame(const ReadbackProbe *probe, const uint32_t width,
+                               const uint32_t height) {
+    VkCommandBuffer cmd = probe->command_buffer;
+    const VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VkImageMemoryBarrier to_clear = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    to_clear.srcAccessMask = 0;
+    to_clear.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    to_clear.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    to_clear.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    to_clear.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_clear.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_clear.image = probe->image;
+    to_clear.subresourceRange = range;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, NULL, 0, NULL, 1, &to_clear);
+
+    const VkClearColorValue color = {.float32 = {0.25F, 0.5F, 0.75F, 1.0F}};
+    vkCmdClearColorImage(cmd, probe->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1,
+                         &range);
+
+    VkImageMemoryBarrier to_copy = to_clear;
+    to_copy.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    to_copy.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    to_copy.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    to_copy.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, NULL, 0, NULL, 1, &to_copy);
+
+    VkBufferImageCopy region = {0};
+    region.imageSubresource = (VkImageSubresourceLayers){VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = (VkExtent3D){width, height, 1};
+    vkCmdCopyImageToBuffer(cmd, probe->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, probe->buffer,
+                           1, &region);
+
+    VkBufferMemoryBarrier to_host = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+    to_host.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    to_host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    to_host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_host.buffer = probe->buffer;
+    to_host.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0,
+                         NULL, 1, &to_host, 0, NULL);
+}
+
+static bool create_probe(ReadbackProbe *probe, VkPhysicalDevice physical_device,
+                         const uint32_t queue_family, const uint32_t width,
+                         const uint32_t height) {
+    const float queue_priority = 1.0F;
+    VkDeviceQueueCreateInfo queue_info = {.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queue_info.queueFamilyIndex = queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+    VkDeviceCreateInfo device_info = {.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    if (vkCreateDevice(physical_device, &device_info, NULL, &probe->device) != VK_SUCCESS) {
+        return false;
+    }
+    vkGetDeviceQueue(probe->device, queue_family, 0, &probe->queue);
+    if (!create_probe_targets(probe, physical_device, width, height)) {
+        return false;
+    }
+
+    VkCommandPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.queueFamilyIndex = queue_family;
+    if (vkCreateCommandPool(probe->device, &pool_info, NULL, &probe->command_pool) !=
+        VK_SUCCESS) {
+        return false;
+    }
+    VkCommandBufferAllocateInfo cmd_info = {.sType =
+                                                VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    cmd_info.commandPool = probe->command_pool;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+    VkFenceCreateInfo fence_info = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VkCommandBufferBeginInfo begin_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    if (vkAllocateCommandBuffers(probe->device, &cmd_info, &probe->command_buffer) !=
+            VK_SUCCESS ||
+        vkCreateFence(probe->device, &fence_info, NULL, &probe->fence) != VK_SUCCESS ||
+        vkBeginCommandBuffer(probe->command_buffer, &begin_info) != VK_SUCCESS) {
+        return false;
+    }
+    record_probe_frame(probe, width, height);
+    return vkEndCommandBuffer(probe->command_buffer) == VK_SUCCESS;
+}
+
+static void destroy_probe(ReadbackProbe *probe) {
+    if (probe->device == VK_NULL_HANDLE) {
+        return;
+    }
+    vkDeviceWaitIdle(probe->device);
+    vkDestroyFence(probe->device, probe->fence, NULL);
+    vkDestroyCommandPool(probe->device, probe->command_pool, NULL);
+    vkDestroyBuffer(probe->device, probe->buffer, NULL);
+    vkFreeMemory(probe->device, probe->buffer_memory, NULL);
+    vkDestroyImage(probe->device, probe->image, NULL);
+    vkFreeMemory(probe->device, probe->image_memory, NULL);
+    vkDestroyDevice(probe->device, NULL);
+}
+
+// One submit-to-host-copy round trip, as a rendered frame takes to reach the encoder
+static bool run_probe_round(ReadbackProbe *probe, uint8_t *host, const size_t size,
+                            double *out_seconds) {
+    const double start = get_time_seconds();
+    VkSubmitInfo submit = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &probe->command_buffer;
+    if (vkResetFences(probe->device, 1, &probe->fence) != VK_SUCCESS ||
+        vkQueueSubmit(probe->queue, 1, &submit, probe->fence) != VK_SUCCESS ||
+        vkWaitForFences(probe->device, 1, &probe->fence, VK_TRUE, PROBE_TIMEOUT_NS) !=
+            VK_SUCCESS) {
+        return false;
+    }
+    if (!probe->coherent) {
+        const VkMappedMemoryRange range = {.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+                                           .memory = probe->buffer_memory,
+                                           .offset = 0,
+                                           .size = VK_WHOLE_SIZE};
+        vkInvalidateMappedMemoryRanges(probe->device, 1, &range);
+    }
+    memcpy(host, probe->mapped, size);
+    *out_seconds = get_time_seconds() - start;
+    return true;
+}
+
+bool vk_measure_readback(VkPhysicalDevice device, const uint32_t queue_family,
+                         const uint32_t width, const uint32_t height, double *out_seconds) {
+    const size_t size = (size_t)width * height * 4U;
+    uint8_t *host = malloc(size);
+    ReadbackProbe probe = {0};
+    bool measured = host && create_probe(&probe, device, queue_family, width, height);
+    double best = INFINITY;
+    for (uint32_t round = 0; measured && round <= PROBE_ROUNDS; round++) {
+        double seconds = 0.0;
+        measured = run_probe_round(&probe, host, size, &seconds);
+        if (round > 0 && seconds < best) {
+            best = seconds;
+        }
+    }
+    destroy_probe(&probe);
+    free(host);
+    if (measured) {
+        *out_seconds = best;
+    }
+    return measured;
+}
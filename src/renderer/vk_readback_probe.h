@@ -0,0 +1,11 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+// Times one frame's worth of GPU writes and its readback into host memory on `device`, the
+// way the renderer hands every frame to the terminal: a width x height RGBA image is
+// filled, copied into a host-visible buffer and read out of it. Creates and destroys its own
+// logical device on `queue_family`. Reports the fastest of a few rounds after a warm-up.
+bool vk_measure_readback(VkPhysicalDevice device, uint32_t queue_family, uint32_t width,
+                         uint32_t height, double *out_seconds);
@@ -1,7 +1,12 @@
 #include "vk_resources.h"
 #include "vk_memory.h"
+#include "vk_pipeline.h"
+#include "vk_transfer.h"
+#include "vk_upload.h"
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 bool create_command_pool(VulkanRenderer *r) {
     VkCommandPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
@@ -19,15 +24,17 @@ bool create_command_pool(VulkanRenderer *r) {
 bool create_descriptor_pool_with_capacity(VulkanRenderer *r, const uint32_t material_capacity,
                                           VkDescriptorPool *out_pool) {
     // Pool sized for per-material descriptor sets plus skydome.
-    const VkDescriptorPoolSize pool_sizes[2] = {
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (2 * material_capacity) * MAX_FRAMES_IN_FLIGHT},
+    const VkDescriptorPoolSize pool_sizes[3] = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (2 * material_capacity) * MAX_FRAMES_IN_FLIGHT},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+         (2 * material_capacity) * MAX_FRAMES_IN_FLIGHT},
         {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
          ((2 * material_capacity) + 1) * MAX_FRAMES_IN_FLIGHT},
     };
 
     VkDescriptorPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
     pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    pool_info.poolSizeCount = 2;
+    pool_info.poolSizeCount = 3;
     pool_info.pPoolSizes = pool_sizes;
     pool_info.maxSets = (material_capacity + 2) * MAX_FRAMES_IN_FLIGHT;
 
@@ -59,7 +66,8 @@ bool create_descriptor_pool(VulkanRenderer *r) {
 bool create_render_targets(VulkanRenderer *r) {
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         // Color image
-        if (!create_image(r, r->width, r->height, VK_FORMAT_R8G8B8A8_UNORM,
+        if (!create_image(r, VULKAN_MEMORY_POOL_FRAME, r->width, r->height,
+                          VK_FORMAT_R8G8B8A8_UNORM,
                           VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                               VK_IMAGE_USAGE_STORAGE_BIT,
                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &r->color_image[i],
@@ -77,7 +85,7 @@ bool create_render_targets(VulkanRenderer *r) {
         VK_NAME(r, VK_OBJECT_TYPE_IMAGE_VIEW, r->color_image_view[i], "color_image_view[%d]", i);
 
         // Depth image
-        if (!create_image(r, r->width, r->height, VK_FORMAT_D32_SFLOAT,
+        if (!create_image(r, VULKAN_MEMORY_POOL_FRAME, r->width, r->height, VK_FORMAT_D32_SFLOAT,
                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &r->depth_image[i],
                           &r->depth_image_alloc[i])) {
@@ -120,16 +128,188 @@ bool create_framebuffer(VulkanRenderer *r) {
     return true;
 }
 
+void destroy_staging_buffers(VulkanRenderer *r) {
+    for (int i = 0; i < NUM_STAGING_BUFFERS; i++) {
+        for (int f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+            if (r->staging_framebuffers[f][i] != VK_NULL_HANDLE) {
+                vkDestroyFramebuffer(r->device, r->staging_framebuffers[f][i], NULL);
+                r->staging_framebuffers[f][i] = VK_NULL_HANDLE;
+            }
+        }
+        if (r->staging_image_views[i] != VK_NULL_HANDLE) {
+            vkDestroyImageView(r->device, r->staging_image_views[i], NULL);
+            r->staging_image_views[i] = VK_NULL_HANDLE;
+        }
+        if (r->staging_images[i] != VK_NULL_HANDLE) {
+            vkDestroyImage(r->device, r->staging_images[i], NULL);
+            free_allocation(r, &r->staging_buffer_allocs[i]);
+            r->staging_images[i] = VK_NULL_HANDLE;
+        }
+        if (r->staging_buffers[i] != VK_NULL_HANDLE) {
+            vkDestroyBuffer(r->device, r->staging_buffers[i], NULL);
+            free_allocation(r, &r->staging_buffer_allocs[i]);
+        }
+        r->staging_buffers[i] = VK_NULL_HANDLE;
+        memset(&r->staging_buffer_allocs[i], 0, sizeof(r->staging_buffer_allocs[i]));
+    }
+    r->staging_imported = false;
+    r->staging_linear = false;
+}
+
+// Memory a unified-memory device can draw into and the host can read with caching
+#define LINEAR_STAGING_MEMORY                                                                   \
+    (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |                 \
+     VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+
+// A discrete GPU can expose such memory too, but drawing into it would cross the bus
+static bool has_linear_staging_memory(const VulkanRenderer *r) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(r->physical_device, &props);
+    if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+        return false;
+    }
+    for (uint32_t i = 0; i < r->mem_properties.memoryTypeCount; i++) {
+        if ((r->mem_properties.memoryTypes[i].propertyFlags & LINEAR_STAGING_MEMORY) ==
+            LINEAR_STAGING_MEMORY) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Renders each frame into a linear colour image in device-local, host-cached memory, so
+// the frame is read where it was drawn. Only used when the rows come out tightly packed,
+// which is what the output expects.
+static bool create_linear_staging_images(VulkanRenderer *r) {
+    const VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    VkImageFormatProperties limits;
+    if (!has_linear_staging_memory(r) ||
+        vkGetPhysicalDeviceImageFormatProperties(r->physical_device, VK_FORMAT_R8G8B8A8_UNORM,
+                                                 VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_LINEAR, usage,
+                                                 0, &limits) != VK_SUCCESS ||
+        limits.maxExtent.width < r->width || limits.maxExtent.height < r->height) {
+        return false;
+    }
+
+    r->staging_buffer_count = NUM_COPIED_STAGING_BUFFERS;
+    for (int i = 0; i < NUM_COPIED_STAGING_BUFFERS; i++) {
+        if (!create_linear_image(r, VULKAN_MEMORY_POOL_FRAME, r->width, r->height,
+                                 VK_FORMAT_R8G8B8A8_UNORM, usage, LINEAR_STAGING_MEMORY,
+                                 &r->staging_images[i], &r->staging_buffer_allocs[i])) {
+            destroy_staging_buffers(r);
+            return false;
+        }
+        const VkImageSubresource subresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0};
+        VkSubresourceLayout layout;
+        vkGetImageSubresourceLayout(r->device, r->staging_images[i], &subresource, &layout);
+        if (layout.offset != 0 || layout.rowPitch != (VkDeviceSize)r->width * 4U) {
+            destroy_staging_buffers(r);
+            return false;
+        }
+        r->staging_image_views[i] = create_image_view(r, r->staging_images[i],
+                                                      VK_FORMAT_R8G8B8A8_UNORM,
+                                                      VK_IMAGE_ASPECT_COLOR_BIT);
+        if (r->staging_image_views[i] == VK_NULL_HANDLE) {
+            destroy_staging_buffers(r);
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_IMAGE, r->staging_images[i], "staging_image[%d]", i);
+
+        for (int f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+            VkImageView attachments[2] = {r->staging_image_views[i], r->depth_image_view[f]};
+            VkFramebufferCreateInfo fb_info = {.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+            fb_info.renderPass = r->render_pass;
+            fb_info.attachmentCount = 2;
+            fb_info.pAttachments = attachments;
+            fb_info.width = r->width;
+            fb_info.height = r->height;
+            fb_info.layers = 1;
+            if (vkCreateFramebuffer(r->device, &fb_info, NULL, &r->staging_framebuffers[f][i]) !=
+                VK_SUCCESS) {
+                destroy_staging_buffers(r);
+                return false;
+            }
+        }
+    }
+    r->staging_linear = true;
+    return true;
+}
+
+void release_host_readback(VulkanRenderer *r) {
+    if (r->host_readback_map) {
+        size_t slot_size = 0;
+        r->host_readback_map(0, 0, 0, &slot_size);
+    }
+    r->host_readback_map = NULL;
+}
+
+// Places the staging buffers in host memory from r->host_readback_map, so the frame copy
+// lands directly where the consumer reads it.
+static bool create_imported_staging_buffers(VulkanRenderer *r, const VkDeviceSize frame_size) {
+    const VkDeviceSize alignment = r->min_imported_host_pointer_alignment;
+    size_t slot_size = 0;
+    uint8_t *base = r->host_readback_map((size_t)frame_size, NUM_STAGING_BUFFERS,
+                                         (size_t)alignment, &slot_size);
+    if (!base || slot_size < frame_size || ((uintptr_t)base % alignment) != 0 ||
+        (slot_size % alignment) != 0) {
+        return false;
+    }
+
+    r->staging_buffer_count = NUM_STAGING_BUFFERS;
+    for (int i = 0; i < NUM_STAGING_BUFFERS; i++) {
+        if (!create_host_import_buffer(r, base + ((size_t)i * slot_size), slot_size,
+                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT, &r->staging_buffers[i],
+                                       &r->staging_buffer_allocs[i])) {
+            destroy_staging_buffers(r);
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->staging_buffers[i], "imported_staging_buffer[%d]", i);
+    }
+    r->staging_imported = true;
+    return true;
+}
+
 bool create_staging_buffers(VulkanRenderer *r) {
     VkDeviceSize buffer_size = (VkDeviceSize)(r->width * r->height * 4);
+    // New buffers hold nothing yet, so their first frames are read back whole
+    for (int i = 0; i < NUM_STAGING_BUFFERS; i++) {
+        r->staging_regions[i] = (ScreenRect){0, 0, r->width, r->height};
+    }
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        r->frame_regions[i] = (ScreenRect){0, 0, r->width, r->height};
+    }
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (r->cell_output != VULKAN_CELL_OUTPUT_NONE) {
+        const VkDeviceSize cols = (r->width + VULKAN_CELL_WIDTH - 1U) / VULKAN_CELL_WIDTH;
+        const VkDeviceSize rows = (r->height + VULKAN_CELL_HEIGHT - 1U) / VULKAN_CELL_HEIGHT;
+        buffer_size = cols * rows * VULKAN_CELL_BYTES;
+        usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    }
     buffer_size = align_up(buffer_size, r->non_coherent_atom_size);
 
-    for (int i = 0; i < NUM_STAGING_BUFFERS; i++) {
+    if (r->host_readback_map && r->min_imported_host_pointer_alignment > 0 &&
+        r->cell_output == VULKAN_CELL_OUTPUT_NONE) {
+        if (create_imported_staging_buffers(r, buffer_size)) {
+            return true;
+        }
+        // Keep rendering through renderer-owned memory; errors from the attempt are dropped.
+        release_host_readback(r);
+        vulkan_renderer_clear_error(r);
+    }
+    if (r->cell_output == VULKAN_CELL_OUTPUT_NONE) {
+        if (create_linear_staging_images(r)) {
+            return true;
+        }
+        vulkan_renderer_clear_error(r);
+    }
+
+    r->staging_buffer_count = NUM_COPIED_STAGING_BUFFERS;
+    for (int i = 0; i < NUM_COPIED_STAGING_BUFFERS; i++) {
         // Prefer HOST_CACHED for fast CPU reads; fall back to HOST_COHERENT
-        if (!create_buffer(r, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        if (!create_buffer(r, VULKAN_MEMORY_POOL_FRAME, buffer_size, usage,
                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
                            &r->staging_buffers[i], &r->staging_buffer_allocs[i])) {
-            if (!create_buffer(r, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            if (!create_buffer(r, VULKAN_MEMORY_POOL_FRAME, buffer_size, usage,
                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                                &r->staging_buffers[i], &r->staging_buffer_allocs[i])) {
@@ -142,15 +322,25 @@ bool create_staging_buffers(VulkanRenderer *r) {
 }
 
 bool create_uniform_buffers(VulkanRenderer *r) {
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (!create_buffer(r, sizeof(Uniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                           &r->uniform_buffers[i], &r->uniform_buffer_allocs[i])) {
-            return false;
-        }
-        VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->uniform_buffers[i], "uniform_buffer[%d]", i);
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(r->physical_device, &props);
+    const VkDeviceSize alignment = props.limits.minUniformBufferOffsetAlignment > 0
+                                       ? props.limits.minUniformBufferOffsetAlignment
+                                       : 1;
+    r->frame_uniform_stride = align_up(sizeof(FrameBlock), alignment);
+    r->bone_uniform_stride = align_up(sizeof(BoneUniforms), alignment);
+
+    const VkDeviceSize size =
+        (r->frame_uniform_stride + r->bone_uniform_stride) * MAX_FRAMES_IN_FLIGHT;
+    if (!create_buffer(r, VULKAN_MEMORY_POOL_RESOURCES, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       &r->uniform_ring, &r->uniform_ring_alloc)) {
+        return false;
     }
+    // Bones past a skeleton's count are never written; keep them zero rather than garbage
+    memset(r->uniform_ring_alloc.mapped, 0, size);
+    VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->uniform_ring, "uniform_ring");
+    r->bone_slot_valid = false;
     return true;
 }
 
@@ -162,7 +352,9 @@ bool create_sampler(VulkanRenderer *r) {
     sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    // Trilinear over the mip chains built at upload; single-level images clamp to level 0
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
 
     if (vkCreateSampler(r->device, &sampler_info, NULL, &r->sampler) != VK_SUCCESS) {
         fprintf(stderr, "Failed to create sampler\n");
@@ -183,8 +375,20 @@ bool create_command_buffers(VulkanRenderer *r) {
         fprintf(stderr, "Failed to allocate command buffers\n");
         return false;
     }
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    if (vkAllocateCommandBuffers(r->device, &alloc_info, r->sky_command_buffers) != VK_SUCCESS ||
+        vkAllocateCommandBuffers(r->device, &alloc_info, r->scene_command_buffers) !=
+            VK_SUCCESS) {
+        fprintf(stderr, "Failed to allocate secondary command buffers\n");
+        return false;
+    }
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         VK_NAME(r, VK_OBJECT_TYPE_COMMAND_BUFFER, r->command_buffers[i], "command_buffer[%d]", i);
+        VK_NAME(r, VK_OBJECT_TYPE_COMMAND_BUFFER, r->sky_command_buffers[i],
+                "sky_command_buffer[%d]", i);
+        VK_NAME(r, VK_OBJECT_TYPE_COMMAND_BUFFER, r->scene_command_buffers[i],
+                "scene_command_buffer[%d]", i);
+        r->scene_recorded[i] = false;
     }
     return true;
 }
@@ -203,6 +407,50 @@ bool create_sync_objects(VulkanRenderer *r) {
     return true;
 }
 
+bool create_timestamp_pools(VulkanRenderer *r) {
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &family_count, NULL);
+    VkQueueFamilyProperties *families = malloc(family_count * sizeof(VkQueueFamilyProperties));
+    if (!families) {
+        return false;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &family_count, families);
+    const uint32_t valid_bits = families[r->graphics_queue_family].timestampValidBits;
+    free(families);
+    if (valid_bits == 0) {
+        return false;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(r->physical_device, &props);
+    r->timestamp_period = props.limits.timestampPeriod;
+    r->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (UINT64_C(1) << valid_bits) - 1U;
+
+    VkQueryPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = VULKAN_GPU_TIMESTAMP_COUNT;
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vkCreateQueryPool(r->device, &pool_info, NULL, &r->timestamp_pools[i]) !=
+            VK_SUCCESS) {
+            fprintf(stderr, "Failed to create timestamp query pool\n");
+            destroy_timestamp_pools(r);
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_QUERY_POOL, r->timestamp_pools[i], "timestamp_pool[%d]", i);
+    }
+    return true;
+}
+
+void destroy_timestamp_pools(VulkanRenderer *r) {
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (r->timestamp_pools[i] != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(r->device, r->timestamp_pools[i], NULL);
+            r->timestamp_pools[i] = VK_NULL_HANDLE;
+        }
+        r->timestamps_written[i] = false;
+    }
+}
+
 void cleanup_render_targets(VulkanRenderer *r) {
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         if (r->framebuffer[i] != VK_NULL_HANDLE) {
@@ -215,7 +463,7 @@ void cleanup_render_targets(VulkanRenderer *r) {
         }
         if (r->color_image[i] != VK_NULL_HANDLE) {
             vkDestroyImage(r->device, r->color_image[i], NULL);
-            vkFreeMemory(r->device, r->color_image_alloc[i].memory, NULL);
+            free_allocation(r, &r->color_image_alloc[i]);
             r->color_image[i] = VK_NULL_HANDLE;
         }
         if (r->depth_image_view[i] != VK_NULL_HANDLE) {
@@ -224,42 +472,80 @@ void cleanup_render_targets(VulkanRenderer *r) {
         }
         if (r->depth_image[i] != VK_NULL_HANDLE) {
             vkDestroyImage(r->device, r->depth_image[i], NULL);
-            vkFreeMemory(r->device, r->depth_image_alloc[i].memory, NULL);
+            free_allocation(r, &r->depth_image_alloc[i]);
             r->depth_image[i] = VK_NULL_HANDLE;
         }
     }
 }
 
-static void cleanup_material_gpu(const VulkanRenderer *r, const MaterialGPUData *m) {
+static void cleanup_material_gpu(VulkanRenderer *r, MaterialGPUData *m) {
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (m->fragment_uniform_buffers[i] != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, m->fragment_uniform_buffers[i], NULL);
-            if (m->fragment_uniform_buffer_allocs[i].memory != VK_NULL_HANDLE) {
-                vkFreeMemory(r->device, m->fragment_uniform_buffer_allocs[i].memory, NULL);
-            }
-        }
         if (m->descriptor_sets[i] != VK_NULL_HANDLE) {
             vkFreeDescriptorSets(r->device, r->descriptor_pool, 1, &m->descriptor_sets[i]);
         }
     }
-    if (m->diffuse_image_view != VK_NULL_HANDLE) {
-        vkDestroyImageView(r->device, m->diffuse_image_view, NULL);
+    release_gpu_texture(r, m->diffuse_texture);
+    release_gpu_texture(r, m->normal_texture);
+}
+
+void cleanup_model_resources(VulkanRenderer *r) {
+    for (uint32_t i = 0; i < r->material_gpu_count; i++) {
+        cleanup_material_gpu(r, &r->material_gpu[i]);
     }
-    if (m->diffuse_image != VK_NULL_HANDLE) {
-        vkDestroyImage(r->device, m->diffuse_image, NULL);
-        if (m->diffuse_image_alloc.memory != VK_NULL_HANDLE) {
-            vkFreeMemory(r->device, m->diffuse_image_alloc.memory, NULL);
-        }
+    destroy_gpu_textures(r);
+    free(r->material_gpu);
+    r->material_gpu = NULL;
+    r->material_gpu_count = 0;
+    r->uploaded_materials = NULL;
+    r->uploaded_material_count = 0;
+    if (r->material_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->material_buffer, NULL);
+        free_allocation(r, &r->material_buffer_alloc);
+        r->material_buffer = VK_NULL_HANDLE;
     }
-    if (m->normal_image_view != VK_NULL_HANDLE) {
-        vkDestroyImageView(r->device, m->normal_image_view, NULL);
+    if (r->material_index_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->material_index_buffer, NULL);
+        free_allocation(r, &r->material_index_buffer_alloc);
+        r->material_index_buffer = VK_NULL_HANDLE;
     }
-    if (m->normal_image != VK_NULL_HANDLE) {
-        vkDestroyImage(r->device, m->normal_image, NULL);
-        if (m->normal_image_alloc.memory != VK_NULL_HANDLE) {
-            vkFreeMemory(r->device, m->normal_image_alloc.memory, NULL);
-        }
+
+    if (r->vertex_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->vertex_buffer, NULL);
+        free_allocation(r, &r->vertex_buffer_alloc);
+        r->vertex_buffer = VK_NULL_HANDLE;
+    }
+    if (r->skin_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->skin_buffer, NULL);
+        free_allocation(r, &r->skin_buffer_alloc);
+        r->skin_buffer = VK_NULL_HANDLE;
+    }
+    if (r->index_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->index_buffer, NULL);
+        free_allocation(r, &r->index_buffer_alloc);
+        r->index_buffer = VK_NULL_HANDLE;
+    }
+    if (r->meshlet_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->meshlet_buffer, NULL);
+        free_allocation(r, &r->meshlet_buffer_alloc);
+        r->meshlet_buffer = VK_NULL_HANDLE;
     }
+    r->cached_vertex_count = 0;
+    r->cached_index_count = 0;
+    // Every loaded mesh starts at generation 1, so the next one must not match
+    r->cached_mesh_generation = 0;
+
+    if (r->baked_pose_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->baked_pose_buffer, NULL);
+        free_allocation(r, &r->baked_pose_alloc);
+        r->baked_pose_buffer = VK_NULL_HANDLE;
+    }
+    r->uploaded_baked_poses = NULL;
+    r->baked_clip = -1;
+
+    r->bone_slot_valid = false;
+    r->uploaded_bone_matrices = NULL;
+    r->uploaded_bone_count = 0;
+    r->uploaded_pose_mode = BONE_POSE_NONE;
 }
 
 void cleanup(VulkanRenderer *r) {
@@ -272,82 +558,41 @@ void cleanup(VulkanRenderer *r) {
             vkDestroySampler(r->device, r->sampler, NULL);
         }
 
-        for (int i = 0; i < NUM_STAGING_BUFFERS; i++) {
-            if (r->staging_buffers[i] != VK_NULL_HANDLE) {
-                vkDestroyBuffer(r->device, r->staging_buffers[i], NULL);
-                if (r->staging_buffer_allocs[i].memory != VK_NULL_HANDLE) {
-                    vkFreeMemory(r->device, r->staging_buffer_allocs[i].memory, NULL);
-                }
-            }
+        destroy_staging_buffers(r);
+        destroy_timestamp_pools(r);
+        if (r->uniform_ring != VK_NULL_HANDLE) {
+            vkDestroyBuffer(r->device, r->uniform_ring, NULL);
+            free_allocation(r, &r->uniform_ring_alloc);
         }
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (r->uniform_buffers[i] != VK_NULL_HANDLE) {
-                vkDestroyBuffer(r->device, r->uniform_buffers[i], NULL);
-                if (r->uniform_buffer_allocs[i].memory != VK_NULL_HANDLE) {
-                    vkFreeMemory(r->device, r->uniform_buffer_allocs[i].memory, NULL);
-                }
-            }
             if (r->in_flight_fences[i] != VK_NULL_HANDLE) {
                 vkDestroyFence(r->device, r->in_flight_fences[i], NULL);
             }
-        }
-
-        // Clean up per-material GPU resources
-        for (uint32_t i = 0; i < r->material_gpu_count; i++) {
-            cleanup_material_gpu(r, &r->material_gpu[i]);
-        }
-        free(r->material_gpu);
-        r->material_gpu = NULL;
-        r->material_gpu_count = 0;
-
-        if (r->vertex_buffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, r->vertex_buffer, NULL);
-            if (r->vertex_buffer_alloc.memory != VK_NULL_HANDLE) {
-                vkFreeMemory(r->device, r->vertex_buffer_alloc.memory, NULL);
-            }
-        }
-        if (r->index_buffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, r->index_buffer, NULL);
-            if (r->index_buffer_alloc.memory != VK_NULL_HANDLE) {
-                vkFreeMemory(r->device, r->index_buffer_alloc.memory, NULL);
-            }
-        }
-        if (r->skydome_vertex_buffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, r->skydome_vertex_buffer, NULL);
-            if (r->skydome_vertex_buffer_alloc.memory != VK_NULL_HANDLE) {
-                vkFreeMemory(r->device, r->skydome_vertex_buffer_alloc.memory, NULL);
-            }
-        }
-        if (r->skydome_index_buffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, r->skydome_index_buffer, NULL);
-            if (r->skydome_index_buffer_alloc.memory != VK_NULL_HANDLE) {
-                vkFreeMemory(r->device, r->skydome_index_buffer_alloc.memory, NULL);
+            if (r->draw_command_buffers[i] != VK_NULL_HANDLE) {
+                vkDestroyBuffer(r->device, r->draw_command_buffers[i], NULL);
+                free_allocation(r, &r->draw_command_allocs[i]);
             }
         }
 
+        cleanup_model_resources(r);
         if (r->skydome_image != VK_NULL_HANDLE) {
             if (r->skydome_image_view != VK_NULL_HANDLE) {
                 vkDestroyImageView(r->device, r->skydome_image_view, NULL);
             }
             vkDestroyImage(r->device, r->skydome_image, NULL);
-            if (r->skydome_image_alloc.memory != VK_NULL_HANDLE) {
-                vkFreeMemory(r->device, r->skydome_image_alloc.memory, NULL);
-            }
+            free_allocation(r, &r->skydome_image_alloc);
         }
     }
 
     cleanup_render_targets(r);
 
     if (r->device != VK_NULL_HANDLE) {
-        if (r->graphics_pipeline != VK_NULL_HANDLE) {
-            vkDestroyPipeline(r->device, r->graphics_pipeline, NULL);
-        }
-        if (r->blend_pipeline != VK_NULL_HANDLE) {
-            vkDestroyPipeline(r->device, r->blend_pipeline, NULL);
-        }
-        if (r->wireframe_pipeline != VK_NULL_HANDLE) {
-            vkDestroyPipeline(r->device, r->wireframe_pipeline, NULL);
+        destroy_upload_batch(r);
+        for (int pool = 0; pool < VULKAN_MEMORY_POOL_COUNT; pool++) {
+            destroy_memory_pool(r, (VulkanMemoryPool)pool);
         }
+
+        destroy_mesh_pipelines(r);
         if (r->pipeline_layout != VK_NULL_HANDLE) {
             vkDestroyPipelineLayout(r->device, r->pipeline_layout, NULL);
         }
@@ -362,6 +607,37 @@ void cleanup(VulkanRenderer *r) {
             vkDestroyDescriptorSetLayout(r->device, r->skydome_descriptor_set_layout, NULL);
         }
 
+        if (r->cells_pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(r->device, r->cells_pipeline, NULL);
+        }
+        if (r->cells_pipeline_layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(r->device, r->cells_pipeline_layout, NULL);
+        }
+        if (r->cells_descriptor_pool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(r->device, r->cells_descriptor_pool, NULL);
+        }
+        if (r->cells_descriptor_set_layout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(r->device, r->cells_descriptor_set_layout, NULL);
+        }
+
+        if (r->cull_pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(r->device, r->cull_pipeline, NULL);
+        }
+        if (r->cull_pipeline_layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(r->device, r->cull_pipeline_layout, NULL);
+        }
+        if (r->cull_descriptor_pool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(r->device, r->cull_descriptor_pool, NULL);
+        }
+        if (r->cull_descriptor_set_layout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(r->device, r->cull_descriptor_set_layout, NULL);
+        }
+
+        if (r->pipeline_cache != VK_NULL_HANDLE) {
+            save_pipeline_cache(r);
+            vkDestroyPipelineCache(r->device, r->pipeline_cache, NULL);
+        }
+
         if (r->render_pass != VK_NULL_HANDLE) {
             vkDestroyRenderPass(r->device, r->render_pass, NULL);
         }
@@ -391,4 +667,5 @@ void cleanup(VulkanRenderer *r) {
 #endif
         vkDestroyInstance(r->instance, NULL);
     }
+    draw_list_free(&r->draw_list);
 }
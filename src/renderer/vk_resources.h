@@ -8,9 +8,18 @@ bool create_descriptor_pool(VulkanRenderer *r);
 bool create_render_targets(VulkanRenderer *r);
 bool create_framebuffer(VulkanRenderer *r);
 bool create_staging_buffers(VulkanRenderer *r);
+void destroy_staging_buffers(VulkanRenderer *r);
+// Hands the host readback memory back to its owner and clears the map, so later staging
+// buffers are renderer-owned
+void release_host_readback(VulkanRenderer *r);
 bool create_uniform_buffers(VulkanRenderer *r);
 bool create_sampler(VulkanRenderer *r);
 bool create_command_buffers(VulkanRenderer *r);
 bool create_sync_objects(VulkanRenderer *r);
+// Optional: returns false, leaving the pools unset, when the graphics queue has no timestamps
+bool create_timestamp_pools(VulkanRenderer *r);
+void destroy_timestamp_pools(VulkanRenderer *r);
 void cleanup_render_targets(VulkanRenderer *r);
+// Frees the mesh, material and texture resources; the caller ensures the GPU is idle.
+void cleanup_model_resources(VulkanRenderer *r);
 void cleanup(VulkanRenderer *r);
@@ -1,4 +1,5 @@
 #include "vk_shader.h"
+#include "embedded_shaders.h"
 #include "platform/path.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,9 +17,32 @@ static void normalize_path_separators(char *path) {
 #endif
 }
 
+static char *copy_embedded_shader(const char *filename, size_t *out_size) {
+    for (size_t i = 0; i < dcat_embedded_shader_count; i++) {
+        const EmbeddedShader *shader = &dcat_embedded_shaders[i];
+        if (strcmp(shader->name, filename) != 0) {
+            continue;
+        }
+        char *buffer = malloc(shader->size);
+        if (!buffer) {
+            return NULL;
+        }
+        memcpy(buffer, shader->code, shader->size);
+        *out_size = shader->size;
+        return buffer;
+    }
+    return NULL;
+}
+
 char *read_shader_file(VulkanRenderer *r, const char *filename, size_t *out_size) {
     enum { MAX_SHADER_FILENAME_LEN = 255, MAX_SHADER_DIR_LEN = 240 };
 
+    // Shaders built with this binary; the file search below only covers unknown names
+    char *embedded = copy_embedded_shader(filename, out_size);
+    if (embedded) {
+        return embedded;
+    }
+
 #ifndef SHADER_INSTALL_DIR
 #define SHADER_INSTALL_DIR "/usr/local/share/dcat/shaders"
 #endif
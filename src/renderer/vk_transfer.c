@@ -0,0 +1,491 @@
+#include "vk_transfer.h"
+#include "vk_memory.h"
+#include <stdio.h>
+#include <string.h>
+
+// The ring starts here and doubles to fit the largest single upload seen.
+#define UPLOAD_RING_MIN_SIZE (16ULL * 1024ULL * 1024ULL)
+// Keeps every copy source texel- and optimalBufferCopyOffsetAlignment-friendly.
+#define UPLOAD_RING_ALIGNMENT 16ULL
+
+static bool separate_transfer_queue(const VulkanRenderer *r) {
+    return r->transfer_queue_family != r->graphics_queue_family;
+}
+
+bool create_upload_batch(VulkanRenderer *r) {
+    VkCommandPoolCreateInfo pool_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.queueFamilyIndex = r->transfer_queue_family;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    if (vkCreateCommandPool(r->device, &pool_info, NULL, &r->upload_command_pool) != VK_SUCCESS) {
+        fprintf(stderr, "Failed to create upload command pool\n");
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_COMMAND_POOL, r->upload_command_pool, "upload_command_pool");
+
+    VkCommandBufferAllocateInfo alloc_info = {.sType =
+                                                  VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    alloc_info.commandPool = r->upload_command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(r->device, &alloc_info, &r->upload_command_buffer) !=
+        VK_SUCCESS) {
+        fprintf(stderr, "Failed to allocate upload command buffer\n");
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_COMMAND_BUFFER, r->upload_command_buffer, "upload_command_buffer");
+
+    VkFenceCreateInfo fence_info = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    if (vkCreateFence(r->device, &fence_info, NULL, &r->upload_fence) != VK_SUCCESS) {
+        fprintf(stderr, "Failed to create upload fence\n");
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_FENCE, r->upload_fence, "upload_fence");
+
+    if (separate_transfer_queue(r)) {
+        VkSemaphoreCreateInfo semaphore_info = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        if (vkCreateSemaphore(r->device, &semaphore_info, NULL, &r->upload_semaphore) !=
+            VK_SUCCESS) {
+            fprintf(stderr, "Failed to create upload semaphore\n");
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_SEMAPHORE, r->upload_semaphore, "upload_semaphore");
+
+        pool_info.queueFamilyIndex = r->graphics_queue_family;
+        if (vkCreateCommandPool(r->device, &pool_info, NULL, &r->mip_command_pool) !=
+            VK_SUCCESS) {
+            fprintf(stderr, "Failed to create mip command pool\n");
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_COMMAND_POOL, r->mip_command_pool, "mip_command_pool");
+        alloc_info.commandPool = r->mip_command_pool;
+        if (vkAllocateCommandBuffers(r->device, &alloc_info, &r->mip_command_buffer) !=
+            VK_SUCCESS) {
+            fprintf(stderr, "Failed to allocate mip command buffer\n");
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_COMMAND_BUFFER, r->mip_command_buffer, "mip_command_buffer");
+    }
+    return true;
+}
+
+static void destroy_upload_ring(VulkanRenderer *r) {
+    if (r->upload_ring != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->upload_ring, NULL);
+        free_allocation(r, &r->upload_ring_alloc);
+        r->upload_ring = VK_NULL_HANDLE;
+    }
+    r->upload_ring_size = 0;
+    r->upload_ring_head = 0;
+}
+
+void destroy_upload_batch(VulkanRenderer *r) {
+    destroy_upload_ring(r);
+    if (r->mip_command_pool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(r->device, r->mip_command_pool, NULL);
+        r->mip_command_pool = VK_NULL_HANDLE;
+        r->mip_command_buffer = VK_NULL_HANDLE;
+    }
+    r->mip_recording = false;
+    if (r->upload_semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(r->device, r->upload_semaphore, NULL);
+        r->upload_semaphore = VK_NULL_HANDLE;
+    }
+    if (r->upload_fence != VK_NULL_HANDLE) {
+        vkDestroyFence(r->device, r->upload_fence, NULL);
+        r->upload_fence = VK_NULL_HANDLE;
+    }
+    if (r->upload_command_pool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(r->device, r->upload_command_pool, NULL);
+        r->upload_command_pool = VK_NULL_HANDLE;
+        r->upload_command_buffer = VK_NULL_HANDLE;
+    }
+    r->upload_recording = false;
+    r->upload_semaphore_pending = false;
+}
+
+// Drops recorded work that can no longer be submitted.
+static void discard_upload_batch(VulkanRenderer *r) {
+    if (r->upload_recording) {
+        vkResetCommandPool(r->device, r->upload_command_pool, 0);
+        r->upload_recording = false;
+    }
+    if (r->mip_recording) {
+        vkResetCommandPool(r->device, r->mip_command_pool, 0);
+        r->mip_recording = false;
+    }
+    r->upload_ring_head = 0;
+}
+
+// Runs the mip chains of the batch just submitted on the graphics queue. Its wait takes
+// over the batch's semaphore, so every stage the next frame would have waited at is in it.
+static bool submit_mip_batch(VulkanRenderer *r) {
+    if (!r->mip_recording) {
+        return true;
+    }
+    r->mip_recording = false;
+
+    VkResult result = vkEndCommandBuffer(r->mip_command_buffer);
+    const char *operation = "vkEndCommandBuffer";
+    const char *detail = "Failed to end mip command buffer";
+    if (result == VK_SUCCESS) {
+        const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT |
+                                                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &r->upload_semaphore;
+        submit_info.pWaitDstStageMask = &wait_stage;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &r->mip_command_buffer;
+        result = vkQueueSubmit(r->graphics_queue, 1, &submit_info, r->upload_fence);
+        operation = "vkQueueSubmit";
+        detail = "Failed to submit mip batch";
+    }
+    if (result == VK_SUCCESS) {
+        r->upload_semaphore_pending = false;
+        result = vkWaitForFences(r->device, 1, &r->upload_fence, VK_TRUE, UINT64_MAX);
+        operation = "vkWaitForFences";
+        detail = "Failed waiting for mip batch fence";
+    }
+    if (result == VK_SUCCESS) {
+        result = vkResetFences(r->device, 1, &r->upload_fence);
+        operation = "vkResetFences";
+        detail = "Failed to reset mip batch fence";
+    }
+
+    vkResetCommandPool(r->device, r->mip_command_pool, 0);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, operation, "%s", detail);
+        return false;
+    }
+    return true;
+}
+
+bool upload_batch_submit(VulkanRenderer *r) {
+    if (!r->upload_recording) {
+        return true;
+    }
+
+    VkCommandBuffer cmd = r->upload_command_buffer;
+    if (!separate_transfer_queue(r)) {
+        // Same queue as rendering: make buffer copies visible to vertex input. Images were
+        // already made visible by their SHADER_READ_ONLY transitions.
+        VkMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, NULL, 0,
+                             NULL);
+    }
+
+    VkResult result = vkEndCommandBuffer(cmd);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkEndCommandBuffer",
+                                  "Failed to end upload command buffer");
+        discard_upload_batch(r);
+        return false;
+    }
+
+    // On a transfer-only queue the semaphore carries both ordering and visibility to the
+    // next frame. Batches submitted before that frame chain through it.
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &cmd;
+    if (separate_transfer_queue(r)) {
+        if (r->upload_semaphore_pending) {
+            submit_info.waitSemaphoreCount = 1;
+            submit_info.pWaitSemaphores = &r->upload_semaphore;
+            submit_info.pWaitDstStageMask = &wait_stage;
+        }
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &r->upload_semaphore;
+    }
+
+    result = vkQueueSubmit(r->transfer_queue, 1, &submit_info, r->upload_fence);
+    const char *operation = "vkQueueSubmit";
+    const char *detail = "Failed to submit upload batch";
+    if (result == VK_SUCCESS) {
+        r->upload_semaphore_pending = separate_transfer_queue(r);
+        result = vkWaitForFences(r->device, 1, &r->upload_fence, VK_TRUE, UINT64_MAX);
+        operation = "vkWaitForFences";
+        detail = "Failed waiting for upload batch fence";
+    }
+    if (result == VK_SUCCESS) {
+        result = vkResetFences(r->device, 1, &r->upload_fence);
+        operation = "vkResetFences";
+        detail = "Failed to reset upload batch fence";
+    }
+
+    vkResetCommandPool(r->device, r->upload_command_pool, 0);
+    r->upload_recording = false;
+    r->upload_ring_head = 0;
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, operation, "%s", detail);
+        discard_upload_batch(r);
+        return false;
+    }
+    return submit_mip_batch(r);
+}
+
+static bool ensure_upload_ring(VulkanRenderer *r, const VkDeviceSize size) {
+    if (size <= r->upload_ring_size) {
+        return true;
+    }
+    // The old ring may still be the source of recorded copies
+    if (!upload_batch_submit(r)) {
+        return false;
+    }
+    destroy_upload_ring(r);
+
+    VkDeviceSize ring_size = UPLOAD_RING_MIN_SIZE;
+    while (ring_size < size) {
+        ring_size *= 2U;
+    }
+    if (!create_buffer(r, VULKAN_MEMORY_POOL_RESOURCES, ring_size,
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       &r->upload_ring, &r->upload_ring_alloc)) {
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->upload_ring, "upload_ring");
+    r->upload_ring_size = ring_size;
+    return true;
+}
+
+// Copies `data` into the ring and returns its offset, leaving the batch open for recording.
+static bool stage_upload(VulkanRenderer *r, const void *data, const VkDeviceSize size,
+                         VkDeviceSize *out_offset) {
+    if (!ensure_upload_ring(r, size)) {
+        return false;
+    }
+    VkDeviceSize offset = align_up(r->upload_ring_head, UPLOAD_RING_ALIGNMENT);
+    if (offset > r->upload_ring_size || r->upload_ring_size - offset < size) {
+        if (!upload_batch_submit(r)) {
+            return false;
+        }
+        offset = 0;
+    }
+
+    if (!r->upload_recording) {
+        VkCommandBufferBeginInfo begin_info = {.sType =
+                                                   VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        const VkResult result = vkBeginCommandBuffer(r->upload_command_buffer, &begin_info);
+        if (result != VK_SUCCESS) {
+            vulkan_renderer_set_error(r, result, "vkBeginCommandBuffer",
+                                      "Failed to begin upload command buffer");
+            return false;
+        }
+        r->upload_recording = true;
+    }
+
+    memcpy((uint8_t *)r->upload_ring_alloc.mapped + offset, data, size);
+    r->upload_ring_head = offset + size;
+    *out_offset = offset;
+    return true;
+}
+
+bool upload_batch_buffer(VulkanRenderer *r, VkBuffer buffer, const void *data,
+                         const VkDeviceSize size) {
+    return upload_batch_buffer_at(r, buffer, 0, data, size);
+}
+
+bool upload_batch_buffer_at(VulkanRenderer *r, VkBuffer buffer, const VkDeviceSize dst_offset,
+                            const void *data, const VkDeviceSize size) {
+    VkDeviceSize offset = 0;
+    if (!stage_upload(r, data, size, &offset)) {
+        return false;
+    }
+    const VkBufferCopy region = {offset, dst_offset, size};
+    vkCmdCopyBuffer(r->upload_command_buffer, r->upload_ring, buffer, 1, &region);
+    return true;
+}
+
+static void record_image_barrier(VkCommandBuffer cmd, VkImage image, uint32_t base_level,
+                                 uint32_t level_count, VkImageLayout old_layout,
+                                 VkImageLayout new_layout, VkAccessFlags src_access,
+                                 VkAccessFlags dst_access, VkPipelineStageFlags src_stage,
+                                 VkPipelineStageFlags dst_stage) {
+    VkImageMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = base_level;
+    barrier.subresourceRange.levelCount = level_count;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+uint32_t upload_mip_levels(const VulkanRenderer *r, const VkFormat format, const uint32_t width,
+                           const uint32_t height) {
+    const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                        VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(r->physical_device, format, &properties);
+    if ((properties.optimalTilingFeatures & needed) != needed) {
+        return 1;
+    }
+
+    uint32_t levels = 1;
+    for (uint32_t size = width > height ? width : height; size > 1; size /= 2U) {
+        levels++;
+    }
+    return levels;
+}
+
+// Halves each level into the next, starting from a level 0 in TRANSFER_DST with every other
+// level still undefined, and leaves the whole chain ready for fragment shading
+static void record_mip_chain(VkCommandBuffer cmd, VkImage image, uint32_t width,
+                             uint32_t height, const uint32_t mip_levels) {
+    record_image_barrier(cmd, image, 1, mip_levels - 1, VK_IMAGE_LAYOUT_UNDEFINED,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    for (uint32_t level = 1; level < mip_levels; level++) {
+        record_image_barrier(cmd, image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                             VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        const uint32_t next_width = width > 1 ? width / 2U : 1U;
+        const uint32_t next_height = height > 1 ? height / 2U : 1U;
+        VkImageBlit blit = {0};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.layerCount = 1;
+        blit.srcOffsets[1] = (VkOffset3D){(int32_t)width, (int32_t)height, 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.layerCount = 1;
+        blit.dstOffsets[1] = (VkOffset3D){(int32_t)next_width, (int32_t)next_height, 1};
+        vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        record_image_barrier(cmd, image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+                             VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        width = next_width;
+        height = next_height;
+    }
+    record_image_barrier(cmd, image, mip_levels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+// Moves freshly copied levels from TRANSFER_DST to SHADER_READ_ONLY in the upload batch
+static void record_upload_ready(VulkanRenderer *r, VkImage image, const uint32_t level_count) {
+    // A transfer-only queue has no fragment stage; the semaphore makes the write visible
+    if (separate_transfer_queue(r)) {
+        record_image_barrier(r->upload_command_buffer, image, 0, level_count,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                             0, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    } else {
+        record_image_barrier(r->upload_command_buffer, image, 0, level_count,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                             VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+}
+
+static bool begin_mip_batch(VulkanRenderer *r) {
+    if (r->mip_recording) {
+        return true;
+    }
+    VkCommandBufferBeginInfo begin_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    const VkResult result = vkBeginCommandBuffer(r->mip_command_buffer, &begin_info);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkBeginCommandBuffer",
+                                  "Failed to begin mip command buffer");
+        return false;
+    }
+    r->mip_recording = true;
+    return true;
+}
+
+bool upload_batch_image(VulkanRenderer *r, VkImage image, const void *data,
+                        const VkDeviceSize size, const uint32_t width, const uint32_t height,
+                        const uint32_t mip_levels) {
+    VkDeviceSize offset = 0;
+    if (!stage_upload(r, data, size, &offset)) {
+        return false;
+    }
+    VkCommandBuffer cmd = r->upload_command_buffer;
+
+    record_image_barrier(cmd, image, 0, 1, VK_IMAGE_LAYOUT_UNDEFINED,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferImageCopy region = {0};
+    region.bufferOffset = offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = width;
+    region.imageExtent.height = height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyBufferToImage(cmd, r->upload_ring, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                           &region);
+
+    if (mip_levels > 1) {
+        // Level 0 stays in TRANSFER_DST for the graphics queue, which the semaphore orders
+        // after this batch; the images are shared concurrently, so no ownership transfer
+        if (separate_transfer_queue(r)) {
+            if (!begin_mip_batch(r)) {
+                return false;
+            }
+            cmd = r->mip_command_buffer;
+        }
+        record_mip_chain(cmd, image, width, height, mip_levels);
+        return true;
+    }
+
+    record_upload_ready(r, image, 1);
+    return true;
+}
+
+bool upload_batch_image_levels(VulkanRenderer *r, VkImage image, const Texture *texture) {
+    const uint32_t mip_levels = texture->mip_levels > 1 ? texture->mip_levels : 1U;
+    if (mip_levels > 32) {
+        return false;
+    }
+    VkDeviceSize offset = 0;
+    if (!stage_upload(r, texture->data, texture->data_size, &offset)) {
+        return false;
+    }
+    VkCommandBuffer cmd = r->upload_command_buffer;
+    record_image_barrier(cmd, image, 0, mip_levels, VK_IMAGE_LAYOUT_UNDEFINED,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    // Level sizes are whole 16-byte blocks (or texels), so every offset stays aligned
+    VkBufferImageCopy regions[32];
+    for (uint32_t level = 0; level < mip_levels; level++) {
+        const uint32_t width = (texture->width >> level) > 0 ? texture->width >> level : 1U;
+        const uint32_t height = (texture->height >> level) > 0 ? texture->height >> level : 1U;
+        VkBufferImageCopy *region = &regions[level];
+        memset(region, 0, sizeof(*region));
+        region->bufferOffset = offset;
+        region->imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region->imageSubresource.mipLevel = level;
+        region->imageSubresource.layerCount = 1;
+        region->imageExtent.width = width;
+        region->imageExtent.height = height;
+        region->imageExtent.depth = 1;
+        offset += texture_level_size(texture->format, width, height);
+    }
+    vkCmdCopyBufferToImage(cmd, r->upload_ring, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           mip_levels, regions);
+    record_upload_ready(r, image, mip_levels);
+    return true;
+}
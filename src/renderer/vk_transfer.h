@@ -0,0 +1,29 @@
+#pragma once
+#include "vulkan_renderer.h"
+
+bool create_upload_batch(VulkanRenderer *r);
+void destroy_upload_batch(VulkanRenderer *r);
+
+// Copy `data` into the staging ring and record the transfer, starting a batch if none is
+// open. Nothing reaches the GPU until upload_batch_submit; a full ring submits early.
+bool upload_batch_buffer(VulkanRenderer *r, VkBuffer buffer, const void *data, VkDeviceSize size);
+// upload_batch_buffer into the bytes of `buffer` from `dst_offset` on, leaving the rest as is
+bool upload_batch_buffer_at(VulkanRenderer *r, VkBuffer buffer, VkDeviceSize dst_offset,
+                            const void *data, VkDeviceSize size);
+// Records UNDEFINED -> TRANSFER_DST -> SHADER_READ_ONLY around the copy into level 0. With
+// mip_levels above 1 the rest of the chain is blitted down from it (the image needs
+// TRANSFER_SRC usage), on the graphics queue when uploads run on a transfer-only one.
+bool upload_batch_image(VulkanRenderer *r, VkImage image, const void *data, VkDeviceSize size,
+                        uint32_t width, uint32_t height, uint32_t mip_levels);
+// Records the copy of a texture whose mip chain is already built, such as block-compressed
+// ones: every level of Texture::data, with no blits, so the image needs no TRANSFER_SRC usage
+bool upload_batch_image_levels(VulkanRenderer *r, VkImage image, const Texture *texture);
+// Full chain down to 1x1, or 1 when the format cannot be blitted with linear filtering
+uint32_t upload_mip_levels(const VulkanRenderer *r, VkFormat format, uint32_t width,
+                           uint32_t height);
+
+// Submits the open batch with one fence and waits for it, so the ring can be reused and
+// the uploaded resources are ready for the next frame. A no-op without an open batch.
+// Callers submit on their failure paths too: resources recorded earlier in the batch
+// already count as uploaded.
+bool upload_batch_submit(VulkanRenderer *r);
@@ -1,5 +1,8 @@
 #include "vk_upload.h"
+#include "graphics/vertex_format.h"
 #include "vk_memory.h"
+#include "vk_transfer.h"
+#include <stdlib.h>
 #include <string.h>
 
 static bool texture_is_valid(const Texture *texture) {
@@ -7,139 +10,263 @@ static bool texture_is_valid(const Texture *texture) {
             texture->data_size > 0) != 0;
 }
 
-static bool ensure_texture_fallback(Texture *texture, const bool normal_map) {
-    if (texture_is_valid(texture)) {
-        return true;
+static void destroy_gpu_texture(VulkanRenderer *r, GpuTexture *texture) {
+    if (texture->view != VK_NULL_HANDLE) {
+        vkDestroyImageView(r->device, texture->view, NULL);
+    }
+    if (texture->image != VK_NULL_HANDLE) {
+        vkDestroyImage(r->device, texture->image, NULL);
+        free_allocation(r, &texture->alloc);
     }
+    memset(texture, 0, sizeof(*texture));
+}
 
-    texture_free(texture);
-    if (normal_map) {
-        texture_create_flat_normal_map(texture);
-    } else {
-        texture_init_default(texture);
+void release_gpu_texture(VulkanRenderer *r, const uint32_t index) {
+    if (index == GPU_TEXTURE_NONE) {
+        return;
     }
+    GpuTexture *texture = &r->gpu_textures[index];
+    if (texture->refs > 0 && --texture->refs == 0) {
+        destroy_gpu_texture(r, texture);
+    }
+}
 
-    return (texture->data != NULL && texture->data_size > 0) != 0;
+void destroy_gpu_textures(VulkanRenderer *r) {
+    for (uint32_t i = 0; i < r->gpu_texture_count; i++) {
+        destroy_gpu_texture(r, &r->gpu_textures[i]);
+    }
+    free(r->gpu_textures);
+    r->gpu_textures = NULL;
+    r->gpu_texture_count = 0;
 }
 
-static bool upload_texture_image(VulkanRenderer *r, const Texture *texture, const VkFormat format,
-                                 VkImage *image, VulkanAllocation *alloc, VkImageView *view,
-                                 uint32_t *cached_w, uint32_t *cached_h) {
-    if (*cached_w != texture->width || *cached_h != texture->height || *image == VK_NULL_HANDLE) {
-        if (*view != VK_NULL_HANDLE) {
-            vkDestroyImageView(r->device, *view, NULL);
-            *view = VK_NULL_HANDLE;
-        }
-        if (*image != VK_NULL_HANDLE) {
-            vkDestroyImage(r->device, *image, NULL);
-            vkFreeMemory(r->device, alloc->memory, NULL);
-            *image = VK_NULL_HANDLE;
+static uint32_t find_gpu_texture(const VulkanRenderer *r, const void *data_ptr,
+                                 const uint32_t width, const uint32_t height,
+                                 const VkFormat format) {
+    for (uint32_t i = 0; i < r->gpu_texture_count; i++) {
+        const GpuTexture *texture = &r->gpu_textures[i];
+        if (texture->refs > 0 && texture->data_ptr == data_ptr && texture->width == width &&
+            texture->height == height && texture->format == format) {
+            return i;
         }
+    }
+    return GPU_TEXTURE_NONE;
+}
 
-        if (!create_image(r, texture->width, texture->height, format,
-                          VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, alloc)) {
-            return false;
-        }
-        *view = create_image_view(r, *image, format, VK_IMAGE_ASPECT_COLOR_BIT);
-        if (*view == VK_NULL_HANDLE) {
-            vkDestroyImage(r->device, *image, NULL);
-            vkFreeMemory(r->device, alloc->memory, NULL);
-            *image = VK_NULL_HANDLE;
-            memset(alloc, 0, sizeof(*alloc));
-            return false;
-        }
+// Block formats and KTX2 files bring their own chain; plain RGBA8 gets one blitted
+static bool texture_brings_levels(const Texture *texture) {
+    return texture->format != TEXTURE_FORMAT_RGBA8 || texture->mip_levels > 1;
+}
 
-        *cached_w = texture->width;
-        *cached_h = texture->height;
+static uint32_t gpu_texture_levels(const VulkanRenderer *r, const Texture *texture,
+                                   const VkFormat format) {
+    if (texture_brings_levels(texture)) {
+        return texture->mip_levels > 1 ? texture->mip_levels : 1U;
     }
+    return upload_mip_levels(r, format, texture->width, texture->height);
+}
 
-    const VkDeviceSize image_size = texture->data_size;
-    VkBuffer staging_buf = VK_NULL_HANDLE;
-    VulkanAllocation staging_alloc = {0};
-    if (!create_buffer(r, image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &staging_buf, &staging_alloc)) {
-        return false;
+static bool upload_texture_levels(VulkanRenderer *r, VkImage image, const Texture *texture,
+                                  const uint32_t mip_levels) {
+    if (texture_brings_levels(texture)) {
+        return upload_batch_image_levels(r, image, texture);
     }
+    return upload_batch_image(r, image, texture->data, texture->data_size, texture->width,
+                              texture->height, mip_levels);
+}
 
-    memcpy(staging_alloc.mapped, texture->data, image_size);
+// Uploads `texture` into a free slot, growing the table when none is left. The slot starts
+// without references.
+static uint32_t upload_gpu_texture(VulkanRenderer *r, const Texture *texture,
+                                   const void *data_ptr, const VkFormat format) {
+    uint32_t index = 0;
+    while (index < r->gpu_texture_count && r->gpu_textures[index].refs > 0) {
+        index++;
+    }
+    if (index == r->gpu_texture_count) {
+        const uint32_t capacity = r->gpu_texture_count > 0 ? r->gpu_texture_count * 2U : 8U;
+        GpuTexture *grown = realloc(r->gpu_textures, capacity * sizeof(GpuTexture));
+        if (!grown) {
+            vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "realloc",
+                                      "Failed to grow the GPU texture table");
+            return GPU_TEXTURE_NONE;
+        }
+        memset(grown + r->gpu_texture_count, 0,
+               (capacity - r->gpu_texture_count) * sizeof(GpuTexture));
+        r->gpu_textures = grown;
+        r->gpu_texture_count = capacity;
+    }
 
-    bool ok = (transition_image_layout(r, *image, VK_IMAGE_LAYOUT_UNDEFINED,
-                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) &&
-               copy_buffer_to_image(r, staging_buf, *image, texture->width, texture->height) &&
-               transition_image_layout(r, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)) != 0;
+    GpuTexture *slot = &r->gpu_textures[index];
+    const bool own_levels = texture_brings_levels(texture);
+    const uint32_t mip_levels = gpu_texture_levels(r, texture, format);
+    const VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                    (own_levels ? 0U : VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    if (!create_mipmapped_image(r, VULKAN_MEMORY_POOL_RESOURCES, texture->width, texture->height,
+                                mip_levels, format, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                &slot->image, &slot->alloc)) {
+        return GPU_TEXTURE_NONE;
+    }
+    slot->view = create_image_view(r, slot->image, format, VK_IMAGE_ASPECT_COLOR_BIT);
+    if (slot->view == VK_NULL_HANDLE ||
+        !upload_texture_levels(r, slot->image, texture, mip_levels)) {
+        destroy_gpu_texture(r, slot);
+        return GPU_TEXTURE_NONE;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_IMAGE, slot->image, "material_texture[%u]", index);
+    VK_NAME(r, VK_OBJECT_TYPE_IMAGE_VIEW, slot->view, "material_texture_view[%u]", index);
+
+    slot->format = format;
+    slot->width = texture->width;
+    slot->height = texture->height;
+    slot->mip_levels = mip_levels;
+    slot->data_ptr = data_ptr;
+    return index;
+}
 
-    vkDestroyBuffer(r->device, staging_buf, NULL);
-    vkFreeMemory(r->device, staging_alloc.memory, NULL);
-    return ok;
+// Writes the pixels of a reloaded image over `index`, the only binding of an image of the same
+// size, format and levels, which keeps its allocation and every descriptor set pointing at it.
+// False without changes when the image does not match.
+static bool rewrite_gpu_texture(VulkanRenderer *r, const uint32_t index, const Texture *texture,
+                                const void *data_ptr, const VkFormat format, bool *out_failed) {
+    GpuTexture *slot = &r->gpu_textures[index];
+    if (slot->refs != 1 || !slot->data_ptr || !data_ptr || slot->format != format ||
+        slot->width != texture->width || slot->height != texture->height ||
+        slot->mip_levels != gpu_texture_levels(r, texture, format)) {
+        return false;
+    }
+    if (!upload_texture_levels(r, slot->image, texture, slot->mip_levels)) {
+        *out_failed = true;
+        return false;
+    }
+    slot->data_ptr = data_ptr;
+    return true;
 }
 
-bool update_material_texture(VulkanRenderer *r, MaterialGPUData *mat, const Texture *diffuse,
-                             const Texture *normal) {
-    Texture fallback_diffuse = {0};
-    Texture fallback_normal = {0};
+// The pixels bound for `texture`: its own, or the built-in fallback when it has none
+static void texture_binding(const Texture *texture, const void **data_ptr, uint32_t *width,
+                            uint32_t *height) {
+    const bool valid = texture_is_valid(texture);
+    *data_ptr = valid ? texture->data : NULL;
+    *width = valid ? texture->width : 1U;
+    *height = valid ? texture->height : 1U;
+}
 
-    if (!texture_is_valid(diffuse)) {
-        diffuse = &fallback_diffuse;
-        if (!ensure_texture_fallback(&fallback_diffuse, false)) {
-            return false;
+bool material_texture_changes(const VulkanRenderer *r, const MaterialGPUData *mat,
+                              const Texture *diffuse, const Texture *normal) {
+    const uint32_t slots[2] = {mat->diffuse_texture, mat->normal_texture};
+    const Texture *textures[2] = {diffuse, normal};
+    for (int i = 0; i < 2; i++) {
+        if (slots[i] == GPU_TEXTURE_NONE) {
+            continue;
         }
-    }
-    if (!texture_is_valid(normal)) {
-        normal = &fallback_normal;
-        if (!ensure_texture_fallback(&fallback_normal, true)) {
-            texture_free(&fallback_diffuse);
-            return false;
+        // Released pixels keep whatever image was made from them
+        if (textures[i] && textures[i]->released) {
+            continue;
+        }
+        const GpuTexture *bound = &r->gpu_textures[slots[i]];
+        const void *data_ptr = NULL;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        texture_binding(textures[i], &data_ptr, &width, &height);
+        if (bound->data_ptr != data_ptr || bound->width != width || bound->height != height) {
+            return true;
         }
     }
+    return false;
+}
 
-    // Check if diffuse needs update
-    if (mat->cached_diffuse_data_ptr != diffuse->data ||
-        mat->cached_diffuse_width != diffuse->width ||
-        mat->cached_diffuse_height != diffuse->height || mat->diffuse_image == VK_NULL_HANDLE) {
-        bool size_changed = (mat->cached_diffuse_width != diffuse->width ||
-                             mat->cached_diffuse_height != diffuse->height ||
-                             mat->diffuse_image == VK_NULL_HANDLE) != 0;
-        if (!upload_texture_image(r, diffuse, VK_FORMAT_R8G8B8A8_SRGB, &mat->diffuse_image,
-                                  &mat->diffuse_image_alloc, &mat->diffuse_image_view,
-                                  &mat->cached_diffuse_width, &mat->cached_diffuse_height)) {
+// Image format for a texture's data: colour is sampled as sRGB, normal maps as UNORM. Only
+// formats vulkan_renderer_texture_formats reported are ever produced.
+static VkFormat material_texture_format(const Texture *texture, const bool normal_map) {
+    switch (texture_is_valid(texture) ? texture->format : TEXTURE_FORMAT_RGBA8) {
+    case TEXTURE_FORMAT_BC7:
+        return normal_map ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+    case TEXTURE_FORMAT_BC5:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case TEXTURE_FORMAT_ETC2_RGBA8:
+        return normal_map ? VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+                          : VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK;
+    case TEXTURE_FORMAT_ASTC_4X4:
+        return normal_map ? VK_FORMAT_ASTC_4x4_UNORM_BLOCK : VK_FORMAT_ASTC_4x4_SRGB_BLOCK;
+    default:
+        return normal_map ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+    }
+}
+
+// Points *slot at the image for `texture`, uploading it only when no other material has it
+// yet, and sets *changed when the binding moves
+static bool bind_material_texture(VulkanRenderer *r, const Texture *texture,
+                                  const bool normal_map, uint32_t *slot, bool *changed) {
+    if (texture && texture->released) {
+        if (*slot == GPU_TEXTURE_NONE) {
+            vulkan_renderer_set_error(r, VK_ERROR_INITIALIZATION_FAILED, "bind_material_texture",
+                                      "Texture pixels were released before their upload");
             return false;
         }
-        VK_NAME(r, VK_OBJECT_TYPE_IMAGE, mat->diffuse_image, "diffuse_image");
-        VK_NAME(r, VK_OBJECT_TYPE_IMAGE_VIEW, mat->diffuse_image_view, "diffuse_image_view");
-        mat->cached_diffuse_data_ptr = diffuse->data;
-        if (size_changed) {
-            for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-                mat->descriptor_sets_dirty[i] = true;
-            }
+        return true;
+    }
+    const VkFormat format = material_texture_format(texture, normal_map);
+    const void *data_ptr = NULL;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    texture_binding(texture, &data_ptr, &width, &height);
+    if (*slot != GPU_TEXTURE_NONE) {
+        const GpuTexture *bound = &r->gpu_textures[*slot];
+        if (bound->data_ptr == data_ptr && bound->width == width && bound->height == height) {
+            return true;
         }
     }
 
-    // Check if normal needs update
-    if (mat->cached_normal_data_ptr != normal->data || mat->cached_normal_width != normal->width ||
-        mat->cached_normal_height != normal->height || mat->normal_image == VK_NULL_HANDLE) {
-        bool size_changed = (mat->cached_normal_width != normal->width ||
-                             mat->cached_normal_height != normal->height ||
-                             mat->normal_image == VK_NULL_HANDLE) != 0;
-        if (!upload_texture_image(r, normal, VK_FORMAT_R8G8B8A8_UNORM, &mat->normal_image,
-                                  &mat->normal_image_alloc, &mat->normal_image_view,
-                                  &mat->cached_normal_width, &mat->cached_normal_height)) {
+    uint32_t index = find_gpu_texture(r, data_ptr, width, height, format);
+    if (index == GPU_TEXTURE_NONE && *slot != GPU_TEXTURE_NONE) {
+        bool failed = false;
+        if (rewrite_gpu_texture(r, *slot, texture, data_ptr, format, &failed)) {
+            return true;
+        }
+        if (failed) {
             return false;
         }
-        VK_NAME(r, VK_OBJECT_TYPE_IMAGE, mat->normal_image, "normal_image");
-        VK_NAME(r, VK_OBJECT_TYPE_IMAGE_VIEW, mat->normal_image_view, "normal_image_view");
-        mat->cached_normal_data_ptr = normal->data;
-        if (size_changed) {
-            for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-                mat->descriptor_sets_dirty[i] = true;
+    }
+    if (index == GPU_TEXTURE_NONE) {
+        Texture fallback = {0};
+        if (!data_ptr) {
+            if (normal_map) {
+                texture_create_flat_normal_map(&fallback);
+            } else {
+                texture_init_default(&fallback);
+            }
+            if (!fallback.data) {
+                return false;
             }
+            texture = &fallback;
+        }
+        index = upload_gpu_texture(r, texture, data_ptr, format);
+        texture_free(&fallback);
+        if (index == GPU_TEXTURE_NONE) {
+            return false;
         }
     }
+    // Taken before the old binding goes, which may be the last reference to it
+    r->gpu_textures[index].refs++;
+    release_gpu_texture(r, *slot);
+    *slot = index;
+    *changed = true;
+    return true;
+}
 
-    texture_free(&fallback_diffuse);
-    texture_free(&fallback_normal);
+bool update_material_texture(VulkanRenderer *r, MaterialGPUData *mat, const Texture *diffuse,
+                             const Texture *normal) {
+    bool changed = false;
+    if (!bind_material_texture(r, diffuse, false, &mat->diffuse_texture, &changed) ||
+        !bind_material_texture(r, normal, true, &mat->normal_texture, &changed)) {
+        return false;
+    }
+    if (changed) {
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            mat->descriptor_sets_dirty[i] = true;
+        }
+    }
     return true;
 }
 
@@ -177,10 +304,11 @@ bool update_skydome_texture(VulkanRenderer *r, const Texture *texture) {
     if (r->skydome_image != VK_NULL_HANDLE) {
         vkDestroyImageView(r->device, r->skydome_image_view, NULL);
         vkDestroyImage(r->device, r->skydome_image, NULL);
-        vkFreeMemory(r->device, r->skydome_image_alloc.memory, NULL);
+        free_allocation(r, &r->skydome_image_alloc);
     }
 
-    if (!create_image(r, texture->width, texture->height, VK_FORMAT_R8G8B8A8_UNORM,
+    if (!create_image(r, VULKAN_MEMORY_POOL_RESOURCES, texture->width, texture->height,
+                      VK_FORMAT_R8G8B8A8_UNORM,
                       VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &r->skydome_image,
                       &r->skydome_image_alloc)) {
@@ -190,40 +318,87 @@ bool update_skydome_texture(VulkanRenderer *r, const Texture *texture) {
         create_image_view(r, r->skydome_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
     if (r->skydome_image_view == VK_NULL_HANDLE) {
         vkDestroyImage(r->device, r->skydome_image, NULL);
-        vkFreeMemory(r->device, r->skydome_image_alloc.memory, NULL);
+        free_allocation(r, &r->skydome_image_alloc);
         r->skydome_image = VK_NULL_HANDLE;
-        memset(&r->skydome_image_alloc, 0, sizeof(r->skydome_image_alloc));
         return false;
     }
     VK_NAME(r, VK_OBJECT_TYPE_IMAGE, r->skydome_image, "skydome_image");
     VK_NAME(r, VK_OBJECT_TYPE_IMAGE_VIEW, r->skydome_image_view, "skydome_image_view");
 
-    VkDeviceSize image_size = texture->data_size;
-    VkBuffer staging_buf = VK_NULL_HANDLE;
-    VulkanAllocation staging_alloc = {0};
-    if (!create_buffer(r, image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       &staging_buf, &staging_alloc)) {
+    // No mips: the panorama's UV seam would pick the smallest level along it
+    if (!upload_batch_image(r, r->skydome_image, texture->data, texture->data_size,
+                            texture->width, texture->height, 1)) {
         return false;
     }
 
-    memcpy(staging_alloc.mapped, texture->data, image_size);
+    r->cached_skydome_data_ptr = texture->data;
+    update_skydome_descriptor_sets(r, r->skydome_descriptor_sets);
+    return true;
+}
 
-    bool ok =
-        (transition_image_layout(r, r->skydome_image, VK_IMAGE_LAYOUT_UNDEFINED,
-                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) &&
-         copy_buffer_to_image(r, staging_buf, r->skydome_image, texture->width, texture->height) &&
-         transition_image_layout(r, r->skydome_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)) != 0;
+bool create_uploaded_buffer(VulkanRenderer *r, const void *data, const VkDeviceSize size,
+                            const VkBufferUsageFlags usage, VkBuffer *buffer,
+                            VulkanAllocation *alloc) {
+    if (!create_buffer(r, VULKAN_MEMORY_POOL_RESOURCES, size,
+                       usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, alloc)) {
+        return false;
+    }
+    if (!upload_batch_buffer(r, *buffer, data, size)) {
+        vkDestroyBuffer(r->device, *buffer, NULL);
+        free_allocation(r, alloc);
+        *buffer = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
 
-    vkDestroyBuffer(r->device, staging_buf, NULL);
-    vkFreeMemory(r->device, staging_alloc.memory, NULL);
+// Packs the loader's vertices into the GPU layout and uploads them, plus the skinning
+// stream when any vertex is bound to a joint.
+static bool upload_packed_vertices(VulkanRenderer *r, const VertexArray *vertices) {
+    PackedVertex *packed = malloc(sizeof(PackedVertex) * vertices->count);
+    if (!packed) {
+        vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "malloc",
+                                  "Failed to allocate packed vertices");
+        return false;
+    }
+    for (size_t i = 0; i < vertices->count; i++) {
+        pack_vertex(&vertices->data[i], &packed[i]);
+    }
+    const bool ok = create_uploaded_buffer(r, packed, sizeof(PackedVertex) * vertices->count,
+                                           VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &r->vertex_buffer,
+                                           &r->vertex_buffer_alloc);
+    free(packed);
     if (!ok) {
         return false;
     }
+    VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->vertex_buffer, "vertex_buffer");
 
-    r->cached_skydome_data_ptr = texture->data;
-    update_skydome_descriptor_sets(r, r->skydome_descriptor_sets);
+    if (!vertices_have_skin(vertices)) {
+        return true;
+    }
+    PackedSkin *skin = malloc(sizeof(PackedSkin) * vertices->count);
+    if (!skin) {
+        vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "malloc",
+                                  "Failed to allocate packed skin data");
+        return false;
+    }
+    r->skin_influences = 1;
+    for (size_t i = 0; i < vertices->count; i++) {
+        pack_skin(&vertices->data[i], &skin[i]);
+        const uint32_t influences = packed_skin_influences(&skin[i]);
+        if (influences > r->skin_influences) {
+            r->skin_influences = influences;
+        }
+    }
+    const bool skin_ok = create_uploaded_buffer(
+        r, skin, sizeof(PackedSkin) * vertices->count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        &r->skin_buffer, &r->skin_buffer_alloc);
+    free(skin);
+    if (!skin_ok) {
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->skin_buffer, "skin_buffer");
     return true;
 }
 
@@ -231,20 +406,22 @@ bool update_vertex_buffer(VulkanRenderer *r, const VertexArray *vertices) {
     if (vertices->count == 0) {
         return true;
     }
-    VkDeviceSize buffer_size = sizeof(Vertex) * vertices->count;
 
     if (r->cached_vertex_count != vertices->count || r->vertex_buffer == VK_NULL_HANDLE) {
         if (r->vertex_buffer != VK_NULL_HANDLE) {
             vkDestroyBuffer(r->device, r->vertex_buffer, NULL);
-            vkFreeMemory(r->device, r->vertex_buffer_alloc.memory, NULL);
+            free_allocation(r, &r->vertex_buffer_alloc);
+            r->vertex_buffer = VK_NULL_HANDLE;
+        }
+        if (r->skin_buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(r->device, r->skin_buffer, NULL);
+            free_allocation(r, &r->skin_buffer_alloc);
+            r->skin_buffer = VK_NULL_HANDLE;
         }
 
-        if (!upload_buffer_via_staging(r, vertices->data, buffer_size,
-                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &r->vertex_buffer,
-                                       &r->vertex_buffer_alloc)) {
+        if (!upload_packed_vertices(r, vertices)) {
             return false;
         }
-        VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->vertex_buffer, "vertex_buffer");
         r->cached_vertex_count = vertices->count;
     }
 
@@ -260,12 +437,12 @@ bool update_index_buffer(VulkanRenderer *r, const Uint32Array *indices) {
     if (r->cached_index_count != indices->count || r->index_buffer == VK_NULL_HANDLE) {
         if (r->index_buffer != VK_NULL_HANDLE) {
             vkDestroyBuffer(r->device, r->index_buffer, NULL);
-            vkFreeMemory(r->device, r->index_buffer_alloc.memory, NULL);
+            free_allocation(r, &r->index_buffer_alloc);
         }
 
-        if (!upload_buffer_via_staging(r, indices->data, buffer_size,
-                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &r->index_buffer,
-                                       &r->index_buffer_alloc)) {
+        if (!create_uploaded_buffer(r, indices->data, buffer_size,
+                                    VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &r->index_buffer,
+                                    &r->index_buffer_alloc)) {
             return false;
         }
         VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->index_buffer, "index_buffer");
@@ -274,3 +451,108 @@ bool update_index_buffer(VulkanRenderer *r, const Uint32Array *indices) {
 
     return true;
 }
+
+bool mesh_edit_applies(const VulkanRenderer *r, const Mesh *mesh) {
+    const MeshEdit *edit = &mesh->edit;
+    if (edit->base_generation == 0 || edit->base_generation != r->cached_mesh_generation ||
+        r->vertex_buffer == VK_NULL_HANDLE || r->cached_vertex_count != mesh->vertices.count ||
+        r->index_buffer == VK_NULL_HANDLE || r->cached_index_count != mesh->indices.count) {
+        return false;
+    }
+    // Vertices that gain joints need the skin stream a mesh without any was uploaded without
+    const VertexArray range = {mesh->vertices.data + edit->first_vertex, edit->vertex_count,
+                               edit->vertex_count};
+    return r->skin_buffer != VK_NULL_HANDLE || !vertices_have_skin(&range);
+}
+
+bool update_mesh_ranges(VulkanRenderer *r, const Mesh *mesh) {
+    const MeshEdit *edit = &mesh->edit;
+    if (edit->vertex_count > 0) {
+        const size_t count = edit->vertex_count;
+        PackedVertex *packed = malloc(sizeof(PackedVertex) * count);
+        PackedSkin *skin =
+            r->skin_buffer != VK_NULL_HANDLE ? malloc(sizeof(PackedSkin) * count) : NULL;
+        if (!packed || (r->skin_buffer != VK_NULL_HANDLE && !skin)) {
+            free(packed);
+            free(skin);
+            vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "malloc",
+                                      "Failed to allocate packed vertices");
+            return false;
+        }
+        const Vertex *vertices = mesh->vertices.data + edit->first_vertex;
+        for (size_t i = 0; i < count; i++) {
+            pack_vertex(&vertices[i], &packed[i]);
+            if (skin) {
+                pack_skin(&vertices[i], &skin[i]);
+                const uint32_t influences = packed_skin_influences(&skin[i]);
+                if (influences > r->skin_influences) {
+                    r->skin_influences = influences;
+                }
+            }
+        }
+        bool ok = upload_batch_buffer_at(r, r->vertex_buffer,
+                                         sizeof(PackedVertex) * edit->first_vertex, packed,
+                                         sizeof(PackedVertex) * count);
+        if (ok && skin) {
+            ok = upload_batch_buffer_at(r, r->skin_buffer, sizeof(PackedSkin) * edit->first_vertex,
+                                        skin, sizeof(PackedSkin) * count);
+        }
+        free(packed);
+        free(skin);
+        if (!ok) {
+            return false;
+        }
+    }
+    if (edit->index_count > 0 &&
+        !upload_batch_buffer_at(r, r->index_buffer, sizeof(uint32_t) * edit->first_index,
+                                mesh->indices.data + edit->first_index,
+                                sizeof(uint32_t) * edit->index_count)) {
+        return false;
+    }
+    return true;
+}
+
+bool update_meshlet_buffer(VulkanRenderer *r, const MeshletArray *meshlets) {
+    if (r->meshlet_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->meshlet_buffer, NULL);
+        free_allocation(r, &r->meshlet_buffer_alloc);
+        r->meshlet_buffer = VK_NULL_HANDLE;
+    }
+    if (meshlets->count == 0) {
+        return true;
+    }
+    if (!create_uploaded_buffer(r, meshlets->data, sizeof(Meshlet) * meshlets->count,
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &r->meshlet_buffer,
+                                &r->meshlet_buffer_alloc)) {
+        return false;
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->meshlet_buffer, "meshlet_buffer");
+    return true;
+}
+
+bool update_baked_pose_buffer(VulkanRenderer *r, const BakedPoses *poses) {
+    if (r->baked_pose_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->baked_pose_buffer, NULL);
+        free_allocation(r, &r->baked_pose_alloc);
+        r->baked_pose_buffer = VK_NULL_HANDLE;
+    }
+    r->uploaded_baked_poses = NULL;
+
+    if (poses->rows != NULL) {
+        const VkDeviceSize size =
+            (VkDeviceSize)poses->frame_count * poses->bone_count * 12 * sizeof(float);
+        if (!create_uploaded_buffer(r, poses->rows, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    &r->baked_pose_buffer, &r->baked_pose_alloc)) {
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->baked_pose_buffer, "baked_pose_buffer");
+    }
+    r->uploaded_baked_poses = poses->rows;
+
+    for (uint32_t m = 0; m < r->material_gpu_count; m++) {
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            r->material_gpu[m].descriptor_sets_dirty[i] = true;
+        }
+    }
+    return true;
+}
@@ -1,9 +1,32 @@
 #pragma once
 #include "vulkan_renderer.h"
 
+// Binds the material to the images for these textures. Materials whose textures share pixels
+// (texture_share) share one image, uploaded by whichever binds it first.
 bool update_material_texture(VulkanRenderer *r, MaterialGPUData *mat, const Texture *diffuse,
                              const Texture *normal);
+// Whether update_material_texture would move the material off an image it has bound, which
+// may then be destroyed
+bool material_texture_changes(const VulkanRenderer *r, const MaterialGPUData *mat,
+                              const Texture *diffuse, const Texture *normal);
+// Drops one reference to a gpu_textures slot, destroying the image with the last one
+void release_gpu_texture(VulkanRenderer *r, uint32_t index);
+void destroy_gpu_textures(VulkanRenderer *r);
 void update_skydome_descriptor_sets(VulkanRenderer *r, const VkDescriptorSet *descriptor_sets);
 bool update_skydome_texture(VulkanRenderer *r, const Texture *texture);
+// Creates a device-local buffer and records its upload into the open upload batch.
+bool create_uploaded_buffer(VulkanRenderer *r, const void *data, VkDeviceSize size,
+                            VkBufferUsageFlags usage, VkBuffer *buffer, VulkanAllocation *alloc);
 bool update_vertex_buffer(VulkanRenderer *r, const VertexArray *vertices);
 bool update_index_buffer(VulkanRenderer *r, const Uint32Array *indices);
+// Whether the buffers hold the generation mesh->edit is based on, at the same sizes, so
+// update_mesh_ranges can bring them to the mesh's generation
+bool mesh_edit_applies(const VulkanRenderer *r, const Mesh *mesh);
+// Records the upload of only the vertices and indices mesh->edit names, into the existing
+// buffers; frames in flight must no longer read them
+bool update_mesh_ranges(VulkanRenderer *r, const Mesh *mesh);
+// Replaces the meshlet buffer the culling pass reads; none for meshes without meshlets
+bool update_meshlet_buffer(VulkanRenderer *r, const MeshletArray *meshlets);
+// Replaces the baked pose buffer with `poses`, or drops it when they are empty, and marks
+// every material's descriptor sets for rewriting. Frames in flight must not use the old one.
+bool update_baked_pose_buffer(VulkanRenderer *r, const BakedPoses *poses);
@@ -1,15 +1,42 @@
 #include "vulkan_renderer.h"
+#include "cpu_rasterizer.h"
 #include "vk_device.h"
 #include "vk_memory.h"
 #include "vk_pipeline.h"
 #include "vk_resources.h"
+#include "vk_transfer.h"
 #include "vk_upload.h"
+#include "core/time_utils.h"
+#include "graphics/mesh_lod.h"
+#include "graphics/skydome.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <vulkan/vk_enum_string_helper.h>
 
+// First size of each frame's indirect buffer, in draw commands
+#define INITIAL_DRAW_COMMAND_CAPACITY 64U
+// The smallest maxDrawIndirectCount a device with multiDrawIndirect may report
+#define MAX_INDIRECT_DRAW_COUNT 65535U
+
+// CPU frames start on cache-line boundaries
+#define CPU_FRAME_ALIGNMENT 64U
+
+_Static_assert(sizeof(DrawCommand) == sizeof(VkDrawIndexedIndirectCommand),
+               "DrawCommand must match VkDrawIndexedIndirectCommand");
+
+// Used when the caller passes no materials
+static const RenderMaterial default_material = {
+    .diffuse = NULL,
+    .normal = NULL,
+    .alpha_mode = ALPHA_MODE_OPAQUE,
+    .specular_strength = 0.35F,
+    .shininess = 32.0F,
+    .base_color = {1.0F, 1.0F, 1.0F, 1.0F},
+    .use_diffuse_alpha_as_luster = false,
+};
+
 static void set_wireframe_mode(atomic_bool *wireframe_mode, bool enabled) {
     *wireframe_mode = enabled;
 }
@@ -19,6 +46,8 @@ static bool get_wireframe_mode(const atomic_bool *wireframe_mode) {
 }
 
 static bool wait_for_in_flight_frames(VulkanRenderer *r, const char *detail) {
+    // Every replacement of what recorded draws reference comes through here first
+    r->resource_generation++;
     VkFence pending_fences[MAX_FRAMES_IN_FLIGHT] = {VK_NULL_HANDLE};
     uint32_t pending_count = 0;
 
@@ -77,6 +106,58 @@ VkResult vulkan_renderer_get_last_error_code(const VulkanRenderer *r) {
     return r ? r->last_error_code : VK_SUCCESS;
 }
 
+// Allocates the frames the CPU backend draws into, in the host readback memory when a map is
+// set and renderer-owned memory otherwise.
+static bool create_cpu_frames(VulkanRenderer *r) {
+    free(r->cpu_frame_memory);
+    r->cpu_frame_memory = NULL;
+    r->staging_imported = false;
+    const size_t frame_size = (size_t)r->width * r->height * 4;
+
+    if (r->host_readback_map) {
+        size_t slot_size = 0;
+        uint8_t *base = r->host_readback_map(frame_size, NUM_STAGING_BUFFERS,
+                                             CPU_FRAME_ALIGNMENT, &slot_size);
+        if (base && slot_size >= frame_size) {
+            for (int i = 0; i < NUM_STAGING_BUFFERS; i++) {
+                r->cpu_frames[i] = base + ((size_t)i * slot_size);
+            }
+            r->staging_buffer_count = NUM_STAGING_BUFFERS;
+            r->staging_imported = true;
+            return true;
+        }
+        // Keep rendering into renderer-owned memory, as the Vulkan path does
+        release_host_readback(r);
+    }
+
+    const size_t slot_size =
+        (frame_size + CPU_FRAME_ALIGNMENT - 1U) & ~(size_t)(CPU_FRAME_ALIGNMENT - 1U);
+    r->staging_buffer_count = NUM_COPIED_STAGING_BUFFERS;
+    r->cpu_frame_memory = malloc(slot_size * NUM_COPIED_STAGING_BUFFERS + CPU_FRAME_ALIGNMENT);
+    if (!r->cpu_frame_memory) {
+        vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "malloc",
+                                  "Failed to allocate CPU frame buffers");
+        return false;
+    }
+    const uintptr_t aligned = ((uintptr_t)r->cpu_frame_memory + CPU_FRAME_ALIGNMENT - 1U) &
+                              ~(uintptr_t)(CPU_FRAME_ALIGNMENT - 1U);
+    memset(r->cpu_frames, 0, sizeof(r->cpu_frames));
+    for (int i = 0; i < NUM_COPIED_STAGING_BUFFERS; i++) {
+        r->cpu_frames[i] = (uint8_t *)aligned + ((size_t)i * slot_size);
+    }
+    return true;
+}
+
+static void destroy_cpu_backend(VulkanRenderer *r) {
+    cpu_rasterizer_destroy(r->cpu);
+    free(r->cpu);
+    r->cpu = NULL;
+    free(r->cpu_frame_memory);
+    r->cpu_frame_memory = NULL;
+    memset(r->cpu_frames, 0, sizeof(r->cpu_frames));
+    draw_list_free(&r->draw_list);
+}
+
 VulkanRenderer *vulkan_renderer_create(uint32_t width, uint32_t height) {
     VulkanRenderer *r = calloc(1, sizeof(VulkanRenderer));
     if (!r) {
@@ -86,6 +167,8 @@ VulkanRenderer *vulkan_renderer_create(uint32_t width, uint32_t height) {
     r->width = width;
     r->height = height;
     r->descriptor_pool_material_capacity = INITIAL_MATERIAL_DESCRIPTOR_CAPACITY;
+    r->lod_detail_pixels = 1.0F;
+    r->baked_clip = -1;
     glm_vec3_normalize_to((vec3){0.0F, -1.0F, -0.5F}, r->normalized_light_dir);
 
     return r;
@@ -95,10 +178,32 @@ void vulkan_renderer_destroy(VulkanRenderer *r) {
     if (!r) {
         return;
     }
-    cleanup(r);
+    if (r->cpu) {
+        destroy_cpu_backend(r);
+    } else {
+        cleanup(r);
+    }
     free(r);
 }
 
+static bool graphics_queue_supports_compute(const VulkanRenderer *r) {
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &count, NULL);
+    VkQueueFamilyProperties *families = malloc(count * sizeof(VkQueueFamilyProperties));
+    if (!families) {
+        return false;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(r->physical_device, &count, families);
+    const bool supported = r->graphics_queue_family < count &&
+                           (families[r->graphics_queue_family].queueFlags & VK_QUEUE_COMPUTE_BIT);
+    free(families);
+    return supported;
+}
+
+void vulkan_renderer_set_device_preference(VulkanRenderer *r, const char *preference) {
+    r->device_preference = preference;
+}
+
 bool vulkan_renderer_initialize(VulkanRenderer *r) {
     vulkan_renderer_clear_error(r);
     if (!create_instance(r)) {
@@ -113,6 +218,10 @@ bool vulkan_renderer_initialize(VulkanRenderer *r) {
     if (!create_command_pool(r)) {
         return false;
     }
+    if (!create_upload_batch(r)) {
+        return false;
+    }
+    create_pipeline_cache(r);
     if (!create_descriptor_pool(r)) {
         return false;
     }
@@ -149,8 +258,13 @@ bool vulkan_renderer_initialize(VulkanRenderer *r) {
     if (!create_sync_objects(r)) {
         return false;
     }
+    create_timestamp_pools(r);
 
     create_skydome_pipeline(r);
+    // Optional: without it meshlets are culled on the CPU
+    if (r->multi_draw_indirect && graphics_queue_supports_compute(r)) {
+        create_cull_pipeline(r);
+    }
 
     // Initialize frame tracking
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -160,10 +274,56 @@ bool vulkan_renderer_initialize(VulkanRenderer *r) {
     return true;
 }
 
+bool vulkan_renderer_initialize_cpu(VulkanRenderer *r) {
+    vulkan_renderer_clear_error(r);
+    r->cpu = calloc(1, sizeof(CpuRasterizer));
+    if (!r->cpu) {
+        vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "calloc",
+                                  "Failed to allocate the CPU rasterizer");
+        return false;
+    }
+    // The calling thread rasterizes too
+    const unsigned int cpu_count = dcat_cpu_count();
+    if (!cpu_rasterizer_init(r->cpu, cpu_count > 1 ? cpu_count - 1 : 0)) {
+        free(r->cpu);
+        r->cpu = NULL;
+        vulkan_renderer_set_error(r, VK_ERROR_INITIALIZATION_FAILED, "cpu_rasterizer_init",
+                                  "Failed to start the CPU rasterizer");
+        return false;
+    }
+    if (!cpu_rasterizer_resize(r->cpu, r->width, r->height)) {
+        vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "cpu_rasterizer_resize",
+                                  "Failed to allocate the CPU depth buffer");
+        return false;
+    }
+    return create_cpu_frames(r);
+}
+
 void vulkan_renderer_set_light_direction(VulkanRenderer *r, const float *direction) {
     glm_vec3_normalize_to((float *)direction, r->normalized_light_dir);
 }
 
+void vulkan_renderer_mark_pose_changed(VulkanRenderer *r) {
+    r->pose_dirty = true;
+}
+
+void vulkan_renderer_set_baked_pose(VulkanRenderer *r, const int32_t clip, const float time) {
+    r->baked_clip = clip;
+    r->baked_time = time;
+}
+
+void vulkan_renderer_mark_materials_changed(VulkanRenderer *r) {
+    r->materials_dirty = true;
+}
+
+void vulkan_renderer_set_lod_detail(VulkanRenderer *r, const float pixels) {
+    r->lod_detail_pixels = pixels > 1.0F ? pixels : 1.0F;
+}
+
+void vulkan_renderer_set_backface_culling(VulkanRenderer *r, const bool enabled) {
+    r->cull_backfaces = enabled;
+}
+
 void vulkan_renderer_set_wireframe_mode(VulkanRenderer *r, bool enabled) {
     set_wireframe_mode(&r->wireframe_mode, enabled);
 }
@@ -174,6 +334,16 @@ bool vulkan_renderer_get_wireframe_mode(const VulkanRenderer *r) {
 
 bool vulkan_renderer_resize(VulkanRenderer *r, uint32_t width, uint32_t height) {
     vulkan_renderer_clear_error(r);
+    if (r->cpu) {
+        r->width = width;
+        r->height = height;
+        if (!cpu_rasterizer_resize(r->cpu, width, height)) {
+            vulkan_renderer_set_error(r, VK_ERROR_OUT_OF_HOST_MEMORY, "cpu_rasterizer_resize",
+                                      "Failed to allocate the CPU depth buffer");
+            return false;
+        }
+        return create_cpu_frames(r);
+    }
 
     if (!wait_for_in_flight_frames(r, "Failed to wait for in-flight frames during resize")) {
         return false;
@@ -182,27 +352,138 @@ bool vulkan_renderer_resize(VulkanRenderer *r, uint32_t width, uint32_t height)
     r->width = width;
     r->height = height;
 
+    // Everything sized by the frame goes at once, so the old blocks are released
+    // before the new size is allocated.
     cleanup_render_targets(r);
-    if (!create_render_targets(r) || !create_framebuffer(r)) {
+    destroy_staging_buffers(r);
+    destroy_memory_pool(r, VULKAN_MEMORY_POOL_FRAME);
+    if (!create_render_targets(r) || !create_framebuffer(r) || !create_staging_buffers(r)) {
         return false;
     }
 
-    // Recreate staging buffers
-    for (int i = 0; i < NUM_STAGING_BUFFERS; i++) {
-        if (r->staging_buffers[i] != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, r->staging_buffers[i], NULL);
-            vkFreeMemory(r->device, r->staging_buffer_allocs[i].memory, NULL);
+    // Reset frame tracking
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        r->frame_ready[i] = false;
+    }
+
+    return true;
+}
+
+bool vulkan_renderer_set_host_readback(VulkanRenderer *r, const VulkanHostReadbackMap map) {
+    vulkan_renderer_clear_error(r);
+    if (r->cpu) {
+        if (map != r->host_readback_map) {
+            release_host_readback(r);
         }
+        r->host_readback_map = map;
+        return create_cpu_frames(r);
     }
-    if (!create_staging_buffers(r)) {
+    if (map && r->min_imported_host_pointer_alignment == 0) {
+        return true;
+    }
+    if (!wait_for_in_flight_frames(r, "Failed to wait for in-flight frames before readback "
+                                      "change")) {
         return false;
     }
 
-    // Reset frame tracking
+    destroy_staging_buffers(r);
+    if (map != r->host_readback_map) {
+        release_host_readback(r);
+    }
+    r->host_readback_map = map;
+    if (!create_staging_buffers(r)) {
+        return false;
+    }
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         r->frame_ready[i] = false;
     }
+    return true;
+}
+
+bool vulkan_renderer_host_readback_active(const VulkanRenderer *r) {
+    return r->staging_imported;
+}
+
+void vulkan_renderer_set_frame_held(VulkanRenderer *r, const VulkanFrameHeld held,
+                                    void *context) {
+    r->frame_held = held;
+    r->frame_held_context = context;
+}
+
+bool vulkan_renderer_needs_host_data(const VulkanRenderer *r) {
+    return r->cpu != NULL;
+}
+
+bool vulkan_renderer_has_mesh(const VulkanRenderer *r, const Mesh *mesh) {
+    return (!r->cpu && r->vertex_buffer != VK_NULL_HANDLE &&
+            r->cached_mesh_generation == mesh->generation) != 0;
+}
+
+uint32_t vulkan_renderer_texture_formats(const VulkanRenderer *r) {
+    if (r->cpu) {
+        return 0;
+    }
+    // Material textures bind as sRGB for colour and UNORM for normal maps (vk_upload.c)
+    static const struct {
+        TextureFormat format;
+        VkFormat vk_formats[2];
+    } candidates[] = {
+        {TEXTURE_FORMAT_BC7, {VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK}},
+        {TEXTURE_FORMAT_BC5, {VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC5_UNORM_BLOCK}},
+        {TEXTURE_FORMAT_ETC2_RGBA8,
+         {VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK}},
+        {TEXTURE_FORMAT_ASTC_4X4, {VK_FORMAT_ASTC_4x4_SRGB_BLOCK, VK_FORMAT_ASTC_4x4_UNORM_BLOCK}},
+    };
+    const VkFormatFeatureFlags needed =
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    uint32_t formats = 0;
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        bool supported = true;
+        for (int j = 0; j < 2; j++) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(r->physical_device, candidates[i].vk_formats[j],
+                                                &properties);
+            supported = supported && (properties.optimalTilingFeatures & needed) == needed;
+        }
+        if (supported) {
+            formats |= TEXTURE_FORMAT_BIT(candidates[i].format);
+        }
+    }
+    return formats;
+}
 
+bool vulkan_renderer_set_cell_output(VulkanRenderer *r, const VulkanCellOutput mode) {
+    vulkan_renderer_clear_error(r);
+    if (mode == r->cell_output) {
+        return true;
+    }
+    if (r->cpu) {
+        vulkan_renderer_set_error(r, VK_ERROR_FEATURE_NOT_PRESENT, "set_cell_output",
+                                  "The CPU renderer only produces pixels");
+        return false;
+    }
+    if (mode != VULKAN_CELL_OUTPUT_NONE && !graphics_queue_supports_compute(r)) {
+        vulkan_renderer_set_error(r, VK_ERROR_FEATURE_NOT_PRESENT, "set_cell_output",
+                                  "Graphics queue cannot run compute work");
+        return false;
+    }
+    if (mode != VULKAN_CELL_OUTPUT_NONE && r->cells_pipeline == VK_NULL_HANDLE &&
+        !create_cells_pipeline(r)) {
+        return false;
+    }
+    if (!wait_for_in_flight_frames(r, "Failed to wait for in-flight frames before readback "
+                                      "change")) {
+        return false;
+    }
+
+    r->cell_output = mode;
+    destroy_staging_buffers(r);
+    if (!create_staging_buffers(r)) {
+        return false;
+    }
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        r->frame_ready[i] = false;
+    }
     return true;
 }
 
@@ -212,58 +493,34 @@ void vulkan_renderer_wait_idle(const VulkanRenderer *r) {
     }
 }
 
-bool vulkan_renderer_set_skydome(VulkanRenderer *r, const Mesh *mesh, const Texture *texture) {
+void vulkan_renderer_release_model(VulkanRenderer *r) {
+    if (!r || r->device == VK_NULL_HANDLE) {
+        return;
+    }
+    vkDeviceWaitIdle(r->device);
+    cleanup_model_resources(r);
+    // Unread frames belong to the previous model
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        r->frame_ready[i] = false;
+    }
+}
+
+bool vulkan_renderer_set_skydome(VulkanRenderer *r, const Texture *texture) {
     vulkan_renderer_clear_error(r);
-    r->skydome_mesh = mesh;
     r->skydome_texture = texture;
-
-    if (mesh && mesh->vertices.count > 0 && mesh->indices.count > 0) {
-        if (r->skydome_vertex_buffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, r->skydome_vertex_buffer, NULL);
-            vkFreeMemory(r->device, r->skydome_vertex_buffer_alloc.memory, NULL);
-        }
-        if (r->skydome_index_buffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, r->skydome_index_buffer, NULL);
-            vkFreeMemory(r->device, r->skydome_index_buffer_alloc.memory, NULL);
-        }
-
-        const VkDeviceSize vertex_size = sizeof(Vertex) * mesh->vertices.count;
-        const VkDeviceSize index_size = sizeof(uint32_t) * mesh->indices.count;
-
-        if (!upload_buffer_via_staging(r, mesh->vertices.data, vertex_size,
-                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &r->skydome_vertex_buffer,
-                                       &r->skydome_vertex_buffer_alloc) ||
-            !upload_buffer_via_staging(r, mesh->indices.data, index_size,
-                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &r->skydome_index_buffer,
-                                       &r->skydome_index_buffer_alloc)) {
-            return false;
-        }
-        VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->skydome_vertex_buffer, "skydome_vertex_buffer");
-        VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->skydome_index_buffer, "skydome_index_buffer");
+    // The CPU backend reads it straight from here every frame
+    if (r->cpu) {
+        return true;
     }
 
     if (texture && texture->data_size > 0) {
         if (!update_skydome_texture(r, texture)) {
+            upload_batch_submit(r);
             return false;
         }
     }
 
-    return true;
-}
-
-static void cleanup_material_fragment_uniform_buffers(const VulkanRenderer *r,
-                                                      MaterialGPUData *mat) {
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (mat->fragment_uniform_buffers[i] != VK_NULL_HANDLE) {
-            vkDestroyBuffer(r->device, mat->fragment_uniform_buffers[i], NULL);
-            mat->fragment_uniform_buffers[i] = VK_NULL_HANDLE;
-        }
-        if (mat->fragment_uniform_buffer_allocs[i].memory != VK_NULL_HANDLE) {
-            vkFreeMemory(r->device, mat->fragment_uniform_buffer_allocs[i].memory, NULL);
-            memset(&mat->fragment_uniform_buffer_allocs[i], 0,
-                   sizeof(mat->fragment_uniform_buffer_allocs[i]));
-        }
-    }
+    return upload_batch_submit(r);
 }
 
 static bool allocate_descriptor_sets_from_pool(VulkanRenderer *r, VkDescriptorPool descriptor_pool,
@@ -376,6 +633,52 @@ static bool rebuild_material_descriptor_pool(VulkanRenderer *r, uint32_t materia
     return true;
 }
 
+// (Re)creates the material constants buffer and the material index stream for
+// `material_count` materials; the caller ensures no frame in flight still reads them.
+static bool create_material_buffers(VulkanRenderer *r, const uint32_t material_count) {
+    VkBuffer buffers[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VulkanAllocation allocs[2] = {{0}};
+    const VkDeviceSize sizes[2] = {material_count * sizeof(MaterialUniforms),
+                                   material_count * sizeof(uint32_t)};
+    const VkBufferUsageFlags usages[2] = {VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT};
+    for (int i = 0; i < 2; i++) {
+        if (!create_buffer(r, VULKAN_MEMORY_POOL_RESOURCES, sizes[i], usages[i],
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           &buffers[i], &allocs[i])) {
+            if (i > 0) {
+                vkDestroyBuffer(r->device, buffers[0], NULL);
+                free_allocation(r, &allocs[0]);
+            }
+            return false;
+        }
+    }
+    VK_NAME(r, VK_OBJECT_TYPE_BUFFER, buffers[0], "material_buffer");
+    VK_NAME(r, VK_OBJECT_TYPE_BUFFER, buffers[1], "material_index_buffer");
+
+    uint32_t *indices = allocs[1].mapped;
+    for (uint32_t m = 0; m < material_count; m++) {
+        indices[m] = m;
+    }
+
+    if (r->material_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->material_buffer, NULL);
+        free_allocation(r, &r->material_buffer_alloc);
+    }
+    if (r->material_index_buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(r->device, r->material_index_buffer, NULL);
+        free_allocation(r, &r->material_index_buffer_alloc);
+    }
+    r->material_buffer = buffers[0];
+    r->material_buffer_alloc = allocs[0];
+    r->material_index_buffer = buffers[1];
+    r->material_index_buffer_alloc = allocs[1];
+    // The new buffer starts empty; force the constants to be rewritten
+    r->uploaded_materials = NULL;
+    return true;
+}
+
 // Ensure per-material GPU resources are allocated for the given material count
 static bool ensure_material_gpu(VulkanRenderer *r, const uint32_t material_count) {
     if (r->material_gpu_count >= material_count) {
@@ -396,33 +699,20 @@ static bool ensure_material_gpu(VulkanRenderer *r, const uint32_t material_count
         free(r->material_gpu);
     }
     r->material_gpu = new_mats;
-
-    // Allocate fragment UBOs for new materials before rebuilding descriptor sets.
     for (uint32_t m = old_material_count; m < material_count; m++) {
-        MaterialGPUData *mat = &r->material_gpu[m];
-
+        r->material_gpu[m].diffuse_texture = GPU_TEXTURE_NONE;
+        r->material_gpu[m].normal_texture = GPU_TEXTURE_NONE;
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            mat->descriptor_sets_dirty[i] = true;
-            if (!create_buffer(
-                    r, sizeof(FragmentUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                    &mat->fragment_uniform_buffers[i], &mat->fragment_uniform_buffer_allocs[i])) {
-                for (uint32_t cleanup_idx = old_material_count; cleanup_idx <= m; cleanup_idx++) {
-                    cleanup_material_fragment_uniform_buffers(r, &r->material_gpu[cleanup_idx]);
-                }
-                return false;
-            }
-            VK_NAME(r, VK_OBJECT_TYPE_BUFFER, mat->fragment_uniform_buffers[i],
-                    "fragment_uniform_buffer[m%u][%d]", m, i);
+            r->material_gpu[m].descriptor_sets_dirty[i] = true;
         }
     }
 
+    // Rebuilding the pool waits for the frames in flight, which also frees the old
+    // material buffers for replacement
     const uint32_t new_capacity =
         next_material_descriptor_capacity(r->descriptor_pool_material_capacity, material_count);
-    if (!rebuild_material_descriptor_pool(r, material_count, new_capacity)) {
-        for (uint32_t m = old_material_count; m < material_count; m++) {
-            cleanup_material_fragment_uniform_buffers(r, &r->material_gpu[m]);
-        }
+    if (!rebuild_material_descriptor_pool(r, material_count, new_capacity) ||
+        !create_material_buffers(r, material_count)) {
         return false;
     }
 
@@ -430,6 +720,739 @@ static bool ensure_material_gpu(VulkanRenderer *r, const uint32_t material_count
     return true;
 }
 
+// The lowest material bound to the same images as `index`. Textures are the only
+// per-material state left in the descriptor sets, so draws of either material can bind that
+// material's set and share a batch.
+static uint32_t find_descriptor_material(const VulkanRenderer *r, const uint32_t index) {
+    const MaterialGPUData *mat = &r->material_gpu[index];
+    for (uint32_t m = 0; m < index; m++) {
+        if (r->material_gpu[m].diffuse_texture == mat->diffuse_texture &&
+            r->material_gpu[m].normal_texture == mat->normal_texture) {
+            return m;
+        }
+    }
+    return index;
+}
+
+// Whether any material is about to move off an image that frames in flight may sample
+static bool material_textures_replaced(const VulkanRenderer *r, const RenderMaterial *materials,
+                                       const uint32_t material_count) {
+    const uint32_t count = material_count < r->material_gpu_count ? material_count
+                                                                  : r->material_gpu_count;
+    for (uint32_t m = 0; m < count; m++) {
+        if (material_texture_changes(r, &r->material_gpu[m], materials[m].diffuse,
+                                     materials[m].normal)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The index range to draw for `sm`: its coarsest LOD whose error stays within
+// MESH_LOD_MAX_PIXEL_ERROR output samples at the sub-mesh's distance from the camera.
+// `pixel_scale` is the output samples covered by one world unit at unit distance.
+static void submesh_draw_range(const SubMesh *sm, mat4 model, const float model_scale,
+                               const vec3 camera_pos, const float pixel_scale,
+                               uint32_t *out_offset, uint32_t *out_count) {
+    *out_offset = sm->index_offset;
+    *out_count = sm->index_count;
+    if (sm->lod_count == 0) {
+        return;
+    }
+
+    vec3 center;
+    glm_mat4_mulv3(model, (float *)sm->bounds_center, 1.0F, center);
+    const float distance =
+        glm_vec3_distance(center, (float *)camera_pos) - (sm->bounds_radius * model_scale);
+    if (distance <= 0.0F) {
+        return; // the camera is inside the bounds
+    }
+    const uint32_t level = submesh_select_lod(sm, model_scale * pixel_scale / distance);
+    if (level > 0) {
+        *out_offset = sm->lods[level - 1].index_offset;
+        *out_count = sm->lods[level - 1].index_count;
+    }
+}
+
+// Whether meshlet draws are left to the culling pass rather than culled here
+static bool gpu_meshlet_culling(const VulkanRenderer *r) {
+    return r->cull_descriptor_sets[0] != VK_NULL_HANDLE && r->meshlet_buffer != VK_NULL_HANDLE;
+}
+
+// Adds the sub-mesh's meshlets that pass the view, merging neighbours into one range
+static void add_visible_meshlets(DrawList *list, const Mesh *mesh, const SubMesh *sm,
+                                 const MeshletCullView *view, const DrawPass pass,
+                                 const uint32_t descriptor, const uint32_t material) {
+    uint32_t run_offset = 0;
+    uint32_t run_count = 0;
+    for (uint32_t m = 0; m < sm->meshlet_count; m++) {
+        const Meshlet *meshlet = &mesh->meshlets.data[sm->meshlet_offset + m];
+        if (!meshlet_visible(meshlet, view)) {
+            continue;
+        }
+        if (run_offset + run_count == meshlet->index_offset) {
+            run_count += meshlet->index_count;
+            continue;
+        }
+        draw_list_add(list, pass, descriptor, material, run_offset, run_count);
+        run_offset = meshlet->index_offset;
+        run_count = meshlet->index_count;
+    }
+    draw_list_add(list, pass, descriptor, material, run_offset, run_count);
+}
+
+// Fills the draw list with this frame's sub-mesh draws at their selected LODs. Sub-meshes
+// drawn at full detail go by meshlet, skipping those outside the view, unless the mesh is
+// animated and its vertices move away from the meshlet bounds.
+static void build_draw_list(VulkanRenderer *r, const Mesh *mesh, const RenderMaterial *materials,
+                            const uint32_t material_count, mat4 mvp, mat4 model,
+                            mat4 projection, const vec3 camera_pos) {
+    DrawList *list = &r->draw_list;
+    draw_list_reset(list);
+    if (mesh->submeshes.count == 0) {
+        // Fallback: single draw for the whole mesh
+        draw_list_add(list, DRAW_PASS_OPAQUE, 0, 0, 0, (uint32_t)mesh->indices.count);
+        draw_list_build(list);
+        return;
+    }
+
+    // Largest axis scale of the model matrix, and the projected size of one world unit
+    const float model_scale = glm_max(
+        glm_vec3_norm(model[0]), glm_max(glm_vec3_norm(model[1]), glm_vec3_norm(model[2])));
+    const float lod_pixel_scale =
+        projection[1][1] * 0.5F * (float)r->height / r->lod_detail_pixels;
+    const bool cull_meshlets = mesh->meshlets.count > 0 && !mesh->has_animations;
+    const bool gpu_cull = gpu_meshlet_culling(r);
+    if (cull_meshlets) {
+        meshlet_cull_view_init(&r->cull_view, mvp, model, camera_pos, r->cull_backfaces);
+    }
+
+    for (size_t i = 0; i < mesh->submeshes.count; i++) {
+        const SubMesh *sm = &mesh->submeshes.data[i];
+        const uint32_t mat_idx = sm->material_index < material_count ? sm->material_index : 0;
+        const DrawPass pass =
+            materials[mat_idx].alpha_mode == ALPHA_MODE_BLEND ? DRAW_PASS_BLEND : DRAW_PASS_OPAQUE;
+
+        uint32_t index_offset = 0;
+        uint32_t index_count = 0;
+        submesh_draw_range(sm, model, model_scale, camera_pos, lod_pixel_scale, &index_offset,
+                           &index_count);
+        // The CPU backend has no descriptor sets to group by
+        const uint32_t descriptor = r->cpu ? 0 : r->material_gpu[mat_idx].descriptor_material;
+        if (cull_meshlets && sm->meshlet_count > 0 && index_offset == sm->index_offset) {
+            if (gpu_cull) {
+                draw_list_add_meshlets(list, pass, descriptor, mat_idx, sm->meshlet_offset,
+                                       sm->meshlet_count);
+            } else {
+                add_visible_meshlets(list, mesh, sm, &r->cull_view, pass, descriptor, mat_idx);
+            }
+            continue;
+        }
+        draw_list_add(list, pass, descriptor, mat_idx, index_offset, index_count);
+    }
+    draw_list_build(list);
+}
+
+// Copies the draw commands into this frame's indirect buffer, growing it as needed.
+static bool upload_draw_commands(VulkanRenderer *r) {
+    const DrawCommandArray *commands = &r->draw_list.commands;
+    const uint32_t frame = r->current_frame;
+    if (!r->multi_draw_indirect || commands->count == 0) {
+        return true;
+    }
+
+    if (commands->count > r->draw_command_capacity[frame]) {
+        uint32_t capacity = r->draw_command_capacity[frame] > 0
+                                ? r->draw_command_capacity[frame]
+                                : INITIAL_DRAW_COMMAND_CAPACITY;
+        while (capacity < commands->count) {
+            capacity *= 2;
+        }
+        // This frame's fence has signalled, so nothing reads its old buffer any more
+        if (r->draw_command_buffers[frame] != VK_NULL_HANDLE) {
+            vkDestroyBuffer(r->device, r->draw_command_buffers[frame], NULL);
+            free_allocation(r, &r->draw_command_allocs[frame]);
+            r->draw_command_buffers[frame] = VK_NULL_HANDLE;
+            r->draw_command_capacity[frame] = 0;
+            r->scene_recorded[frame] = false;
+        }
+        // Storage too, for the culling pass to fill in meshlet commands
+        if (!create_buffer(r, VULKAN_MEMORY_POOL_RESOURCES, capacity * sizeof(DrawCommand),
+                           VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           &r->draw_command_buffers[frame], &r->draw_command_allocs[frame])) {
+            return false;
+        }
+        VK_NAME(r, VK_OBJECT_TYPE_BUFFER, r->draw_command_buffers[frame],
+                "draw_command_buffer[f%u]", frame);
+        r->draw_command_capacity[frame] = capacity;
+    }
+
+    memcpy(r->draw_command_allocs[frame].mapped, commands->data,
+           commands->count * sizeof(DrawCommand));
+    return true;
+}
+
+// Writes timestamp `query`: the frame's start for 0, else the end of stage query - 1. A
+// no-op without timestamp support.
+static void write_timestamp(const VulkanRenderer *r, VkCommandBuffer cmd, const uint32_t query) {
+    const VkQueryPool pool = r->timestamp_pools[r->current_frame];
+    if (pool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(cmd,
+                            query == 0 ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
+                                       : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                            pool, query);
+    }
+}
+
+// Fills the commands of every DrawCull from its meshlets' visibility, before the render pass
+// reads them.
+static void record_meshlet_culling(const VulkanRenderer *r, VkCommandBuffer cmd) {
+    const DrawList *list = &r->draw_list;
+    if (list->culls.count == 0) {
+        return;
+    }
+    const VkDescriptorSet set = r->cull_descriptor_sets[r->current_frame];
+    const VkDescriptorBufferInfo buffer_infos[2] = {
+        {r->meshlet_buffer, 0, VK_WHOLE_SIZE},
+        {r->draw_command_buffers[r->current_frame], 0, VK_WHOLE_SIZE}};
+    VkWriteDescriptorSet writes[2] = {
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, set, 0, 0, 1,
+         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &buffer_infos[0], NULL},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, set, 1, 0, 1,
+         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &buffer_infos[1], NULL}};
+    vkUpdateDescriptorSets(r->device, 2, writes, 0, NULL);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, r->cull_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, r->cull_pipeline_layout, 0, 1,
+                            &set, 0, NULL);
+    CullPushConstants params;
+    memcpy(params.planes, r->cull_view.planes, sizeof(params.planes));
+    glm_vec4(r->cull_view.camera, r->cull_view.cull_backfaces ? 1.0F : 0.0F, params.camera);
+    params.padding = 0;
+    for (size_t i = 0; i < list->culls.count; i++) {
+        const DrawCull *cull = &list->culls.data[i];
+        params.first_meshlet = cull->first_meshlet;
+        params.meshlet_count = cull->meshlet_count;
+        params.first_command = cull->first_command;
+        vkCmdPushConstants(cmd, r->cull_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(params), &params);
+        // 64 meshlets per workgroup, matching numthreads in cull.comp.slang
+        vkCmdDispatch(cmd, (cull->meshlet_count + 63U) / 64U, 1, 1);
+    }
+
+    VkMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+// Records the draw list, binding the pipeline and descriptor set only where they change.
+// With multi-draw indirect each batch is one draw call; otherwise its commands are
+// recorded as direct draws, which still skips the redundant binds.
+static void record_draw_batches(const VulkanRenderer *r, VkCommandBuffer cmd,
+                                VkPipeline opaque_pipeline, VkPipeline blend_pipeline,
+                                const uint32_t *dynamic_offsets) {
+    const DrawList *list = &r->draw_list;
+    VkPipeline bound_pipeline = VK_NULL_HANDLE;
+    uint32_t bound_descriptor = UINT32_MAX;
+    bool opaque_timed = false;
+    for (size_t b = 0; b < list->batches.count; b++) {
+        const DrawBatch *batch = &list->batches.data[b];
+        // Blended batches follow every opaque one
+        if (batch->pass == DRAW_PASS_BLEND && !opaque_timed) {
+            write_timestamp(r, cmd, VULKAN_GPU_STAGE_OPAQUE + 1);
+            opaque_timed = true;
+        }
+        const VkPipeline pipeline =
+            batch->pass == DRAW_PASS_BLEND ? blend_pipeline : opaque_pipeline;
+        if (pipeline != bound_pipeline) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            bound_pipeline = pipeline;
+        }
+        if (batch->descriptor != bound_descriptor) {
+            vkCmdBindDescriptorSets(
+                cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->pipeline_layout, 0, 1,
+                &r->material_gpu[batch->descriptor].descriptor_sets[r->current_frame], 2,
+                dynamic_offsets);
+            bound_descriptor = batch->descriptor;
+        }
+
+        if (!r->multi_draw_indirect) {
+            for (uint32_t c = 0; c < batch->command_count; c++) {
+                const DrawCommand *command = &list->commands.data[batch->first_command + c];
+                vkCmdDrawIndexed(cmd, command->index_count, command->instance_count,
+                                 command->first_index, command->vertex_offset,
+                                 command->first_instance);
+            }
+            continue;
+        }
+        for (uint32_t first = 0; first < batch->command_count;
+             first += MAX_INDIRECT_DRAW_COUNT) {
+            const uint32_t remaining = batch->command_count - first;
+            vkCmdDrawIndexedIndirect(
+                cmd, r->draw_command_buffers[r->current_frame],
+                (VkDeviceSize)(batch->first_command + first) * sizeof(DrawCommand),
+                remaining < MAX_INDIRECT_DRAW_COUNT ? remaining : MAX_INDIRECT_DRAW_COUNT,
+                sizeof(DrawCommand));
+        }
+    }
+    if (!opaque_timed) {
+        write_timestamp(r, cmd, VULKAN_GPU_STAGE_OPAQUE + 1);
+    }
+    write_timestamp(r, cmd, VULKAN_GPU_STAGE_BLEND + 1);
+}
+
+// Begins `cmd` as a secondary command buffer run inside the mesh render pass. Any
+// framebuffer of the pass will do, so a recording outlives the staging image rotation.
+// Dynamic state is not inherited, so the viewport is set again.
+static bool begin_render_pass_commands(VulkanRenderer *r, VkCommandBuffer cmd) {
+    VkCommandBufferInheritanceInfo inheritance = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance.renderPass = r->render_pass;
+    inheritance.subpass = 0;
+    VkCommandBufferBeginInfo begin_info = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance;
+    // Beginning resets it: the pool allows resetting single command buffers
+    const VkResult result = vkBeginCommandBuffer(cmd, &begin_info);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkBeginCommandBuffer",
+                                  "Failed to begin secondary command buffer");
+        return false;
+    }
+    VkViewport viewport = {0, 0, (float)r->width, (float)r->height, 1.0F, 0.0F};
+    VkRect2D scissor = {{0, 0}, {r->width, r->height}};
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    return true;
+}
+
+static bool end_render_pass_commands(VulkanRenderer *r, VkCommandBuffer cmd) {
+    const VkResult result = vkEndCommandBuffer(cmd);
+    if (result != VK_SUCCESS) {
+        vulkan_renderer_set_error(r, result, "vkEndCommandBuffer",
+                                  "Failed to end secondary command buffer");
+        return false;
+    }
+    return true;
+}
+
+// Records this frame's skydome: one fullscreen triangle looking up each pixel's view ray.
+// The rays follow the camera, so this is recorded every frame; it is a handful of commands.
+static bool record_skydome(VulkanRenderer *r, mat4 *view, mat4 *projection) {
+    VkCommandBuffer cmd = r->sky_command_buffers[r->current_frame];
+    if (!begin_render_pass_commands(r, cmd)) {
+        return false;
+    }
+    if (skydome_drawn(r, view, projection)) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->skydome_pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->skydome_pipeline_layout, 0,
+                                1, &r->skydome_descriptor_sets[r->current_frame], 0, NULL);
+
+        mat4 sky_rays;
+        skydome_ray_matrix(*view, *projection, sky_rays);
+        vkCmdPushConstants(cmd, r->skydome_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                           sizeof(mat4), sky_rays);
+        vkCmdDraw(cmd, 3, 1, 0, 0);
+    }
+    write_timestamp(r, cmd, VULKAN_GPU_STAGE_SKYDOME + 1);
+    return end_render_pass_commands(r, cmd);
+}
+
+// Records the main model's draw list into this frame slot's scene command buffer, unless
+// the recording already there binds and draws the same. Per-frame data reaches the shaders
+// through the uniform ring and, with multi-draw indirect, the indirect buffer, so only the
+// mesh, materials, pipeline variant (wireframe among them), pose slot and size re-record.
+static bool record_scene(VulkanRenderer *r, const uint64_t mesh_generation,
+                         VkPipeline opaque_pipeline, VkPipeline blend_pipeline,
+                         const bool skinned, const uint32_t *dynamic_offsets) {
+    const uint32_t frame = r->current_frame;
+    SceneRecordingKey key;
+    memset(&key, 0, sizeof(key));
+    key.resource_generation = r->resource_generation;
+    key.mesh_generation = mesh_generation;
+    key.draw_list_hash = draw_list_hash(&r->draw_list, !r->multi_draw_indirect);
+    key.opaque_pipeline = opaque_pipeline;
+    key.blend_pipeline = blend_pipeline;
+    key.vertex_buffer = r->vertex_buffer;
+    key.skin_buffer = skinned ? r->skin_buffer : VK_NULL_HANDLE;
+    key.index_buffer = r->index_buffer;
+    key.material_index_buffer = r->material_index_buffer;
+    key.draw_command_buffer = r->draw_command_buffers[frame];
+    key.dynamic_offsets[0] = dynamic_offsets[0];
+    key.dynamic_offsets[1] = dynamic_offsets[1];
+    key.width = r->width;
+    key.height = r->height;
+    if (r->scene_recorded[frame] && memcmp(&key, &r->scene_keys[frame], sizeof(key)) == 0) {
+        return true;
+    }
+
+    VkCommandBuffer cmd = r->scene_command_buffers[frame];
+    r->scene_recorded[frame] = false;
+    if (!begin_render_pass_commands(r, cmd)) {
+        return false;
+    }
+    // Nothing to bind while a progressive load has not delivered geometry yet
+    if (r->vertex_buffer != VK_NULL_HANDLE && r->index_buffer != VK_NULL_HANDLE) {
+        VkBuffer vbs[] = {r->vertex_buffer, r->skin_buffer};
+        VkDeviceSize vb_offsets[] = {0, 0};
+        const uint32_t vb_count = skinned ? 2 : 1;
+        vkCmdBindVertexBuffers(cmd, 0, vb_count, vbs, vb_offsets);
+        vkCmdBindVertexBuffers(cmd, 2, 1, &r->material_index_buffer, vb_offsets);
+        vkCmdBindIndexBuffer(cmd, r->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+
+        record_draw_batches(r, cmd, opaque_pipeline, blend_pipeline, dynamic_offsets);
+    }
+    if (!end_render_pass_commands(r, cmd)) {
+        return false;
+    }
+    r->scene_keys[frame] = key;
+    r->scene_recorded[frame] = true;
+    return true;
+}
+
+// Whether this frame draws the skydome, which leaves no pixel at the clear colour
+static bool skydome_drawn(const VulkanRenderer *r, mat4 *view, mat4 *projection) {
+    return r->skydome_texture && r->skydome_pipeline != VK_NULL_HANDLE &&
+           r->skydome_image_view != VK_NULL_HANDLE && view != NULL && projection != NULL;
+}
+
+// The rectangle pixel readback copies into staging buffer `staging_idx`: what the model can
+// cover this frame, and what the buffer still holds of the frame last copied into it.
+// Everything else is the clear colour in both. `whole` when more than the model's bind-pose
+// box can differ from it: a skydome behind, or skinning moving vertices out of the box.
+static ScreenRect readback_region(VulkanRenderer *r, mat4 mvp, const bool whole,
+                                  const uint32_t staging_idx) {
+    ScreenRect drawn = {0, 0, r->width, r->height};
+    if (!whole && r->vertex_buffer == VK_NULL_HANDLE) {
+        drawn = (ScreenRect){0, 0, 0, 0};
+    } else if (!whole && r->mesh_bounds_valid) {
+        drawn = screen_rect_from_bounds(mvp, r->mesh_bounds_min, r->mesh_bounds_max, r->width,
+                                        r->height);
+    }
+    const ScreenRect copy = screen_rect_union(drawn, r->staging_regions[staging_idx]);
+    r->staging_regions[staging_idx] = drawn;
+    return copy;
+}
+
+// Copies the colour image to the staging buffer for CPU readback.
+static void record_pixel_readback(const VulkanRenderer *r, VkCommandBuffer cmd,
+                                  const uint32_t staging_idx, const ScreenRect rect) {
+    // The rectangle lands where it sits in the full frame, leaving the rest of the buffer
+    if (!screen_rect_empty(rect)) {
+        VkBufferImageCopy region = {0};
+        region.bufferOffset = (((VkDeviceSize)rect.y * r->width) + rect.x) * 4U;
+        region.bufferRowLength = r->width;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset.x = (int32_t)rect.x;
+        region.imageOffset.y = (int32_t)rect.y;
+        region.imageExtent.width = rect.width;
+        region.imageExtent.height = rect.height;
+        region.imageExtent.depth = 1;
+
+        vkCmdCopyImageToBuffer(cmd, r->color_image[r->current_frame],
+                               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               r->staging_buffers[staging_idx], 1, &region);
+    }
+
+    VkBufferMemoryBarrier buffer_barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer = r->staging_buffers[staging_idx];
+    buffer_barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0,
+                         NULL, 1, &buffer_barrier, 0, NULL);
+}
+
+// With linear staging the frame already sits in host-visible memory: only hand it to the
+// host, which may read linear images in the GENERAL layout.
+static void record_linear_readback(const VulkanRenderer *r, VkCommandBuffer cmd,
+                                   const uint32_t staging_idx) {
+    VkImageMemoryBarrier image_barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    image_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    image_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = r->staging_images[staging_idx];
+    image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_barrier.subresourceRange.levelCount = 1;
+    image_barrier.subresourceRange.layerCount = 1;
+
+    // The render pass's external dependency ends at the transfer stage
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 0, NULL, 1, &image_barrier);
+}
+
+// Reduces the colour image to the cell grid on the GPU and writes it straight into the
+// staging buffer, so readback moves VULKAN_CELL_BYTES per 2x4 pixels instead of 32 bytes.
+static void record_cell_reduction(const VulkanRenderer *r, VkCommandBuffer cmd,
+                                  const uint32_t staging_idx) {
+    const VkDescriptorSet set = r->cells_descriptor_sets[r->current_frame];
+    VkDescriptorImageInfo image_info = {VK_NULL_HANDLE, r->color_image_view[r->current_frame],
+                                        VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorBufferInfo buffer_info = {r->staging_buffers[staging_idx], 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet writes[2] = {
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, set, 0, 0, 1,
+         VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &image_info, NULL, NULL},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL, set, 1, 0, 1,
+         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &buffer_info, NULL}};
+    vkUpdateDescriptorSets(r->device, 2, writes, 0, NULL);
+
+    // The render pass leaves the image ready for a transfer; storage reads need GENERAL.
+    VkImageMemoryBarrier image_barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    image_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = r->color_image[r->current_frame];
+    image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_barrier.subresourceRange.levelCount = 1;
+    image_barrier.subresourceRange.layerCount = 1;
+    // TRANSFER chains onto the render pass's outgoing dependency.
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1,
+                         &image_barrier);
+
+    CellPushConstants params = {
+        .width = r->width,
+        .height = r->height,
+        .cols = (r->width + VULKAN_CELL_WIDTH - 1U) / VULKAN_CELL_WIDTH,
+        .rows = (r->height + VULKAN_CELL_HEIGHT - 1U) / VULKAN_CELL_HEIGHT,
+        .mono = (r->cell_output == VULKAN_CELL_OUTPUT_QUADRANT_MONO) ? 1U : 0U,
+    };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, r->cells_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, r->cells_pipeline_layout, 0, 1,
+                            &set, 0, NULL);
+    vkCmdPushConstants(cmd, r->cells_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(params), &params);
+    // 8x8 cells per workgroup, matching numthreads in cells.comp.slang
+    vkCmdDispatch(cmd, (params.cols + 7U) / 8U, (params.rows + 7U) / 8U, 1);
+
+    VkBufferMemoryBarrier buffer_barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+    buffer_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer = r->staging_buffers[staging_idx];
+    buffer_barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, NULL, 1, &buffer_barrier, 0, NULL);
+}
+
+// Converts the stage timestamps of the frame in `slot`. Only called once the slot's fence
+// has signalled, so the results are already available and reading them never waits; a
+// frame whose results cannot be read just keeps the previous timings.
+static void resolve_gpu_timings(VulkanRenderer *r, const uint32_t slot) {
+    if (!r->timestamps_written[slot]) {
+        return;
+    }
+    r->timestamps_written[slot] = false;
+    uint64_t ticks[VULKAN_GPU_TIMESTAMP_COUNT];
+    const VkResult result = vkGetQueryPoolResults(
+        r->device, r->timestamp_pools[slot], 0, VULKAN_GPU_TIMESTAMP_COUNT,
+        sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+    const double ms_per_tick = (double)r->timestamp_period / 1e6;
+    for (uint32_t i = 0; i < VULKAN_GPU_STAGE_COUNT; i++) {
+        const uint64_t elapsed = (ticks[i + 1] - ticks[i]) & r->timestamp_mask;
+        r->gpu_timings.stage_ms[i] = (float)((double)elapsed * ms_per_tick);
+    }
+    const uint64_t total = (ticks[VULKAN_GPU_STAGE_COUNT] - ticks[0]) & r->timestamp_mask;
+    r->gpu_timings.total_ms = (float)((double)total * ms_per_tick);
+    r->gpu_timings.frame++;
+    r->gpu_timings_valid = true;
+}
+
+bool vulkan_renderer_get_gpu_timings(const VulkanRenderer *r, VulkanGpuTimings *out) {
+    if (!r->gpu_timings_valid) {
+        return false;
+    }
+    *out = r->gpu_timings;
+    return true;
+}
+
+void vulkan_renderer_get_host_timings(const VulkanRenderer *r, VulkanHostTimings *out) {
+    *out = r->host_timings;
+}
+
+// Returns the readback of the frame last submitted in `slot`, or NULL if that slot holds
+// none. The caller has already waited for the slot's fence.
+static bool map_completed_frame(VulkanRenderer *r, const uint32_t slot,
+                                const uint8_t **out_framebuffer) {
+    *out_framebuffer = NULL;
+    if (!r->frame_ready[slot]) {
+        return true;
+    }
+    resolve_gpu_timings(r, slot);
+    const uint32_t ready_staging_idx = r->frame_staging_buffers[slot];
+    const ScreenRect region = r->frame_regions[slot];
+    if (!r->staging_imported && !screen_rect_empty(region)) {
+        // Only the rows the frame copied; the allocation is aligned to the atom size
+        const VulkanAllocation *alloc = &r->staging_buffer_allocs[ready_staging_idx];
+        const VkDeviceSize atom = r->non_coherent_atom_size > 0 ? r->non_coherent_atom_size : 1;
+        const VkDeviceSize row = (VkDeviceSize)r->width * 4U;
+        VkDeviceSize start = ((VkDeviceSize)region.y * row) & ~(atom - 1U);
+        VkDeviceSize end = align_up((VkDeviceSize)(region.y + region.height) * row, atom);
+        if (region.height >= r->height || end > alloc->size) {
+            start = 0;
+            end = alloc->size;
+        }
+        VkMappedMemoryRange range = {.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
+        range.memory = alloc->memory;
+        range.offset = alloc->offset + start;
+        range.size = end - start;
+        const VkResult result = vkInvalidateMappedMemoryRanges(r->device, 1, &range);
+        if (result != VK_SUCCESS) {
+            vulkan_renderer_set_error(r, result, "vkInvalidateMappedMemoryRanges",
+                                      "Failed to invalidate staging buffer memory");
+            return false;
+        }
+    }
+    // Imported memory is host-coherent and was never mapped, so there is nothing to
+    // invalidate.
+    *out_framebuffer = (const uint8_t *)r->staging_buffer_allocs[ready_staging_idx].mapped;
+    return true;
+}
+
+bool vulkan_renderer_read_pending_frame(VulkanRenderer *r, const uint8_t **out_framebuffer) {
+    vulkan_renderer_clear_error(r);
+    *out_framebuffer = NULL;
+    // Slots are submitted in order, so the oldest pending frame is the first ready slot
+    // from current_frame on.
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (!r->frame_ready[r->current_frame]) {
+            r->current_frame = (r->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+            continue;
+        }
+        const VkResult result = vkWaitForFences(
+            r->device, 1, &r->in_flight_fences[r->current_frame], VK_TRUE, UINT64_MAX);
+        if (result != VK_SUCCESS) {
+            vulkan_renderer_set_error(r, result, "vkWaitForFences",
+                                      "Failed to wait for in-flight fence");
+            return false;
+        }
+        if (!map_completed_frame(r, r->current_frame, out_framebuffer)) {
+            return false;
+        }
+        r->frame_ready[r->current_frame] = false;
+        r->current_frame = (r->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return true;
+    }
+    return true;
+}
+
+// Light and camera for this frame, shared by both backends
+static void fill_frame_uniforms(const VulkanRenderer *r, const bool enable_lighting,
+                                const vec3 camera_pos, const bool use_triplanar_mapping,
+                                FrameUniforms *out) {
+    memset(out, 0, sizeof(*out));
+    glm_vec3_copy((float *)r->normalized_light_dir, out->light_dir);
+    out->enable_lighting = (int)enable_lighting ? 1 : 0;
+    glm_vec3_copy((float *)camera_pos, out->camera_pos);
+    out->use_triplanar_mapping = (int)use_triplanar_mapping ? 1 : 0;
+
+    // Hemisphere ambient lighting
+    glm_vec4_copy((vec4){0.50F, 0.50F, 0.52F, 0.0F}, out->hemisphere_sky_color);
+    glm_vec4_copy((vec4){0.18F, 0.16F, 0.14F, 0.0F}, out->hemisphere_ground_color);
+
+    // Fill/rim are derived from key light direction so camera-linked key
+    // lighting remains visually obvious while orbiting.
+    vec3 fill_dir = {-out->light_dir[0], -out->light_dir[1] - 0.2F, -out->light_dir[2]};
+    glm_vec3_normalize(fill_dir);
+    glm_vec4_copy((vec4){fill_dir[0], fill_dir[1], fill_dir[2], 0.18F}, out->fill_light_dir);
+
+    vec3 rim_dir = {-out->light_dir[0], -out->light_dir[1], -out->light_dir[2]};
+    glm_vec3_normalize(rim_dir);
+    glm_vec4_copy((vec4){rim_dir[0], rim_dir[1], rim_dir[2], 0.22F}, out->rim_light_dir);
+}
+
+static const uint8_t *staging_buffer_memory(const VulkanRenderer *r, const uint32_t idx) {
+    return r->cpu ? r->cpu_frames[idx] : (const uint8_t *)r->staging_buffer_allocs[idx].mapped;
+}
+
+// Whether staging buffer `idx` must not be written yet: a frame in flight copies into it, or
+// it holds `returned`, the frame this render hands out, or one the consumer still reads.
+static bool staging_buffer_busy(const VulkanRenderer *r, const uint32_t idx,
+                                const uint8_t *returned) {
+    for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; slot++) {
+        if (!r->cpu && r->frame_ready[slot] && r->frame_staging_buffers[slot] == idx) {
+            return true;
+        }
+    }
+    const uint8_t *memory = staging_buffer_memory(r, idx);
+    if (returned && memory == returned) {
+        return true;
+    }
+    return r->staging_imported && r->frame_held && r->frame_held(r->frame_held_context, memory);
+}
+
+// Moves on to the staging buffer the next frame is written into: the next one in turn that
+// is not busy. The ring has a buffer more than can be busy at once.
+static uint32_t advance_staging_buffer(VulkanRenderer *r, const uint8_t *returned) {
+    uint32_t idx = r->current_staging_buffer;
+    for (uint32_t i = 0; i < r->staging_buffer_count; i++) {
+        idx = (idx + 1) % r->staging_buffer_count;
+        if (!staging_buffer_busy(r, idx, returned)) {
+            break;
+        }
+    }
+    r->current_staging_buffer = idx;
+    return idx;
+}
+
+// Draws the frame with the CPU rasterizer into the next frame slot and returns it at once
+static bool render_cpu(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4 *model,
+                       const RenderMaterial *materials, const uint32_t material_count,
+                       const FrameUniforms *lighting, const mat4 *bone_matrices,
+                       const uint32_t bone_count, mat4 *view, mat4 *projection,
+                       const uint8_t **out_framebuffer) {
+    CpuFrame frame = {
+        .mesh = mesh,
+        .draws = &r->draw_list,
+        .materials = materials,
+        .material_count = material_count,
+        .lighting = lighting,
+        .bone_matrices = bone_matrices,
+        .bone_count = bone_matrices != NULL ? (bone_count < MAX_BONES ? bone_count : MAX_BONES) : 0,
+        .wireframe = get_wireframe_mode(&r->wireframe_mode),
+        .cull_backfaces = r->cull_backfaces,
+    };
+    glm_mat4_copy(*mvp, frame.mvp);
+    glm_mat4_copy(*model, frame.model);
+    if (r->skydome_texture && view != NULL && projection != NULL) {
+        frame.skydome_texture = r->skydome_texture;
+        skydome_ray_matrix(*view, *projection, frame.skydome_rays);
+    }
+
+    // The frame drawn last is what the caller may still hold
+    const uint8_t *previous = r->cpu_frames[r->current_staging_buffer % r->staging_buffer_count];
+    uint8_t *target = r->cpu_frames[advance_staging_buffer(r, previous)];
+    const double draw_start = get_time_seconds();
+    cpu_rasterizer_draw(r->cpu, &frame, target);
+    r->host_timings = (VulkanHostTimings){.fence_wait = 0.0,
+                                          .record = get_time_seconds() - draw_start};
+    *out_framebuffer = target;
+    return true;
+}
+
 bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4 *model,
                             const RenderMaterial *materials, uint32_t material_count,
                             bool enable_lighting, const vec3 camera_pos, bool use_triplanar_mapping,
@@ -438,16 +1461,19 @@ bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4
     vulkan_renderer_clear_error(r);
     *out_framebuffer = NULL;
 
-    static const RenderMaterial default_material = {
-        .diffuse = NULL,
-        .normal = NULL,
-        .alpha_mode = ALPHA_MODE_OPAQUE,
-        .specular_strength = 0.35F,
-        .shininess = 32.0F,
-        .base_color = {1.0F, 1.0F, 1.0F, 1.0F},
-        .use_diffuse_alpha_as_luster = false,
-    };
+    if (materials == NULL || material_count == 0) {
+        materials = &default_material;
+        material_count = 1;
+    }
+    FrameUniforms frame_uniforms;
+    fill_frame_uniforms(r, enable_lighting, camera_pos, use_triplanar_mapping, &frame_uniforms);
+    if (r->cpu) {
+        build_draw_list(r, mesh, materials, material_count, *mvp, *model, *projection, camera_pos);
+        return render_cpu(r, mesh, mvp, model, materials, material_count, &frame_uniforms,
+                          bone_matrices, bone_count, view, projection, out_framebuffer);
+    }
 
+    const double wait_start = get_time_seconds();
     VkResult vk_result =
         vkWaitForFences(r->device, 1, &r->in_flight_fences[r->current_frame], VK_TRUE, UINT64_MAX);
     if (vk_result != VK_SUCCESS) {
@@ -455,23 +1481,13 @@ bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4
                                   "Failed to wait for in-flight fence");
         return false;
     }
+    const double record_start = get_time_seconds();
+    r->host_timings.fence_wait = record_start - wait_start;
 
     // Read framebuffer from the frame that just completed
     const uint8_t *result = NULL;
-    uint32_t ready_staging_idx = r->frame_staging_buffers[r->current_frame];
-
-    if (r->frame_ready[r->current_frame]) {
-        VkMappedMemoryRange range = {.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
-        range.memory = r->staging_buffer_allocs[ready_staging_idx].memory;
-        range.offset = 0;
-        range.size = VK_WHOLE_SIZE;
-        vk_result = vkInvalidateMappedMemoryRanges(r->device, 1, &range);
-        if (vk_result != VK_SUCCESS) {
-            vulkan_renderer_set_error(r, vk_result, "vkInvalidateMappedMemoryRanges",
-                                      "Failed to invalidate staging buffer memory");
-            return false;
-        }
-        result = (const uint8_t *)r->staging_buffer_allocs[ready_staging_idx].mapped;
+    if (!map_completed_frame(r, r->current_frame, &result)) {
+        return false;
     }
 
     vk_result = vkResetFences(r->device, 1, &r->in_flight_fences[r->current_frame]);
@@ -481,52 +1497,110 @@ bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4
     }
     r->frame_ready[r->current_frame] = false;
 
-    r->current_staging_buffer = (r->current_staging_buffer + 1) % NUM_STAGING_BUFFERS;
-    uint32_t write_staging_idx = r->current_staging_buffer;
+    const uint32_t write_staging_idx = advance_staging_buffer(r, result);
     r->frame_staging_buffers[r->current_frame] = write_staging_idx;
 
     // Ensure material GPU resources
-    if (materials == NULL || material_count == 0) {
-        materials = &default_material;
-        material_count = 1;
-    }
     if (!ensure_material_gpu(r, material_count)) {
         return false;
     }
 
+    // Replacing a texture rewrites or destroys an image that frames in flight may sample
+    if (material_textures_replaced(r, materials, material_count) &&
+        !wait_for_in_flight_frames(r, "Failed to wait for in-flight frames before "
+                                      "replacing material textures")) {
+        return false;
+    }
+
     // Upload textures for each material
     for (uint32_t m = 0; m < material_count; m++) {
         if (!update_material_texture(r, &r->material_gpu[m], materials[m].diffuse,
                                      materials[m].normal)) {
+            upload_batch_submit(r);
             return false;
         }
     }
 
     // Update vertex/index buffers
     if (r->cached_mesh_generation != mesh->generation || r->vertex_buffer == VK_NULL_HANDLE) {
-        if (!update_vertex_buffer(r, &mesh->vertices) || !update_index_buffer(r, &mesh->indices)) {
+        if (mesh->geometry_released) {
+            vulkan_renderer_set_error(r, VK_ERROR_INITIALIZATION_FAILED, "update_vertex_buffer",
+                                      "Mesh geometry was released before its upload");
+            upload_batch_submit(r);
+            return false;
+        }
+        // A new generation of the same mesh, such as full geometry replacing a preview, is
+        // uploaded even when its sizes match, once no frame in flight still draws the old one.
+        // A reload that kept the sizes (mesh_edit_diff) rewrites only what it changed.
+        const bool edit = mesh_edit_applies(r, mesh);
+        if (r->vertex_buffer != VK_NULL_HANDLE) {
+            if (!wait_for_in_flight_frames(r, "Failed to wait for in-flight frames before "
+                                              "replacing mesh buffers")) {
+                return false;
+            }
+            if (!edit) {
+                r->cached_vertex_count = 0;
+                r->cached_index_count = 0;
+            }
+        }
+        const bool geometry_ok =
+            edit ? update_mesh_ranges(r, mesh)
+                 : update_vertex_buffer(r, &mesh->vertices) &&
+                       update_index_buffer(r, &mesh->indices);
+        const bool meshlets_changed =
+            !edit || mesh->edit.vertex_count > 0 || mesh->edit.index_count > 0;
+        if (!geometry_ok || (r->cull_pipeline != VK_NULL_HANDLE && meshlets_changed &&
+                             !update_meshlet_buffer(r, &mesh->meshlets))) {
+            upload_batch_submit(r);
             return false;
         }
         r->cached_mesh_generation = mesh->generation;
+        r->mesh_bounds_valid = mesh_bounds(mesh, r->mesh_bounds_min, r->mesh_bounds_max);
+    }
+
+    // Baked poses go up once per mesh, like its geometry
+    if (r->uploaded_baked_poses != mesh->baked_poses.rows) {
+        if (r->baked_pose_buffer != VK_NULL_HANDLE &&
+            !wait_for_in_flight_frames(r, "Failed to wait for in-flight frames before "
+                                          "replacing baked poses")) {
+            upload_batch_submit(r);
+            return false;
+        }
+        if (!update_baked_pose_buffer(r, &mesh->baked_poses)) {
+            upload_batch_submit(r);
+            return false;
+        }
+    }
+
+    // Everything uploaded for this frame goes out as one batch
+    if (!upload_batch_submit(r)) {
+        return false;
     }
 
     // Update descriptor sets for each material
     for (uint32_t m = 0; m < material_count; m++) {
         MaterialGPUData *mat = &r->material_gpu[m];
         if (mat->descriptor_sets_dirty[r->current_frame]) {
-            VkDescriptorBufferInfo uniform_info = {r->uniform_buffers[r->current_frame], 0,
-                                                   sizeof(Uniforms)};
-            VkDescriptorImageInfo diffuse_info = {r->sampler, mat->diffuse_image_view,
+            // Ring bindings are dynamic; the slot is chosen per draw by the bound offsets
+            VkDescriptorBufferInfo bone_info = {r->uniform_ring, 0, sizeof(BoneUniforms)};
+            VkDescriptorImageInfo diffuse_info = {r->sampler,
+                                                  r->gpu_textures[mat->diffuse_texture].view,
                                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-            VkDescriptorImageInfo normal_info = {r->sampler, mat->normal_image_view,
+            VkDescriptorImageInfo normal_info = {r->sampler,
+                                                 r->gpu_textures[mat->normal_texture].view,
                                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-            VkDescriptorBufferInfo frag_uniform_info = {
-                mat->fragment_uniform_buffers[r->current_frame], 0, sizeof(FragmentUniforms)};
-
-            VkWriteDescriptorSet writes[4] = {
+            VkDescriptorBufferInfo material_info = {r->material_buffer, 0, VK_WHOLE_SIZE};
+            VkDescriptorBufferInfo frame_info = {r->uniform_ring, 0, sizeof(FrameBlock)};
+            // The binding needs a buffer even when there are no baked poses to read
+            VkDescriptorBufferInfo baked_info = {r->baked_pose_buffer != VK_NULL_HANDLE
+                                                     ? r->baked_pose_buffer
+                                                     : r->material_buffer,
+                                                 0, VK_WHOLE_SIZE};
+
+            VkWriteDescriptorSet writes[6] = {
                 {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL,
-                 mat->descriptor_sets[r->current_frame], 0, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                 NULL, &uniform_info, NULL},
+                 mat->descriptor_sets[r->current_frame], 0, 0, 1,
+                 VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, NULL, &bone_info, NULL},
                 {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL,
                  mat->descriptor_sets[r->current_frame], 1, 0, 1,
                  VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &diffuse_info, NULL, NULL},
@@ -534,85 +1608,162 @@ bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4
                  mat->descriptor_sets[r->current_frame], 2, 0, 1,
                  VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &normal_info, NULL, NULL},
                 {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL,
-                 mat->descriptor_sets[r->current_frame], 3, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                 NULL, &frag_uniform_info, NULL}};
+                 mat->descriptor_sets[r->current_frame], 3, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                 NULL, &material_info, NULL},
+                {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL,
+                 mat->descriptor_sets[r->current_frame], 4, 0, 1,
+                 VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, NULL, &frame_info, NULL},
+                {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL,
+                 mat->descriptor_sets[r->current_frame], 5, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                 NULL, &baked_info, NULL}};
 
-            vkUpdateDescriptorSets(r->device, 4, writes, 0, NULL);
+            vkUpdateDescriptorSets(r->device, 6, writes, 0, NULL);
             mat->descriptor_sets_dirty[r->current_frame] = false;
+            // Updating a set invalidates the recordings that bind it
+            r->scene_recorded[r->current_frame] = false;
         }
     }
 
-    // Prepare push constants
-    PushConstants push_constants;
-    glm_mat4_copy(*mvp, push_constants.mvp);
-    glm_mat4_copy(*model, push_constants.model);
-
-    // Prepare vertex uniform buffer (bone matrices — shared across all materials)
-    Uniforms uniforms = {0};
-    uniforms.has_animation = (bone_matrices != NULL) ? 1 : 0;
-
-    if (bone_matrices && bone_count > 0) {
-        uint32_t num_bones = bone_count < MAX_BONES ? bone_count : MAX_BONES;
-        memcpy(uniforms.bone_matrices, bone_matrices, num_bones * sizeof(mat4));
-        for (uint32_t i = num_bones; i < MAX_BONES; i++) {
-            glm_mat4_identity(uniforms.bone_matrices[i]);
+    // Frame block: transforms, light and camera change every frame, so each frame in flight
+    // owns a slot
+    uint8_t *ring = r->uniform_ring_alloc.mapped;
+    const VkDeviceSize frame_offset = (VkDeviceSize)r->current_frame * r->frame_uniform_stride;
+    FrameBlock *frame_block = (FrameBlock *)(ring + frame_offset);
+    glm_mat4_copy(*mvp, frame_block->mvp);
+    glm_mat4_copy(*model, frame_block->model);
+    frame_block->frame = frame_uniforms;
+
+    // Bone block: only rewritten when the pose changes. A new pose goes to the next slot, so
+    // the slots still referenced by frames in flight are left untouched. A baked pose is
+    // only the header: which two poses of the baked buffer to blend.
+    const uint32_t num_bones =
+        bone_matrices != NULL ? (bone_count < MAX_BONES ? bone_count : MAX_BONES) : 0;
+    const bool baked = bone_matrices == NULL && r->baked_clip >= 0 &&
+                       r->baked_pose_buffer != VK_NULL_HANDLE;
+    uint32_t pose_mode = bone_matrices != NULL ? BONE_POSE_MATRICES : BONE_POSE_NONE;
+    uint32_t pose_offsets[2] = {0, 0};
+    float pose_blend = 0.0F;
+    if (baked) {
+        pose_mode = BONE_POSE_BAKED;
+        baked_poses_locate(&mesh->baked_poses, (uint32_t)r->baked_clip, r->baked_time,
+                           &pose_offsets[0], &pose_offsets[1], &pose_blend);
+    }
+    if (!r->bone_slot_valid || r->pose_dirty || r->uploaded_bone_matrices != bone_matrices ||
+        r->uploaded_bone_count != num_bones || r->uploaded_pose_mode != pose_mode ||
+        r->uploaded_pose_offsets[0] != pose_offsets[0] ||
+        r->uploaded_pose_offsets[1] != pose_offsets[1] || r->uploaded_pose_blend != pose_blend) {
+        if (r->bone_slot_valid) {
+            r->bone_slot = (r->bone_slot + 1) % MAX_FRAMES_IN_FLIGHT;
         }
-    } else {
-        for (uint32_t i = 0; i < MAX_BONES; i++) {
-            glm_mat4_identity(uniforms.bone_matrices[i]);
+        BoneUniforms *bones =
+            (BoneUniforms *)(ring + (MAX_FRAMES_IN_FLIGHT * r->frame_uniform_stride) +
+                             (r->bone_slot * r->bone_uniform_stride));
+        bones->has_animation = pose_mode;
+        bones->pose_offset = pose_offsets[0];
+        bones->next_pose_offset = pose_offsets[1];
+        bones->pose_blend = pose_blend;
+        // Static models only need the header; skinned ones only their own bone count
+        if (num_bones > 0) {
+            memcpy(bones->bone_matrices, bone_matrices, num_bones * sizeof(mat4));
+        }
+        r->uploaded_bone_matrices = bone_matrices;
+        r->uploaded_bone_count = num_bones;
+        r->uploaded_pose_mode = pose_mode;
+        r->uploaded_pose_offsets[0] = pose_offsets[0];
+        r->uploaded_pose_offsets[1] = pose_offsets[1];
+        r->uploaded_pose_blend = pose_blend;
+        r->bone_slot_valid = true;
+        r->pose_dirty = false;
+    }
+    const VkDeviceSize bone_offset =
+        (MAX_FRAMES_IN_FLIGHT * r->frame_uniform_stride) + (r->bone_slot * r->bone_uniform_stride);
+    const uint32_t dynamic_offsets[2] = {(uint32_t)bone_offset, (uint32_t)frame_offset};
+
+    // Material constants are fixed per material set; write them once, not every frame
+    if (r->materials_dirty || r->uploaded_materials != materials ||
+        r->uploaded_material_count != material_count) {
+        if (r->uploaded_materials != NULL &&
+            !wait_for_in_flight_frames(r, "Failed to wait for in-flight frames before "
+                                          "updating material uniforms")) {
+            return false;
         }
+        uint32_t material_bits = 0;
+        for (uint32_t m = 0; m < material_count; m++) {
+            MaterialUniforms material_uniforms = {0};
+            memcpy(material_uniforms.base_color, materials[m].base_color, sizeof(float) * 4);
+            material_uniforms.alpha_cutoff = 0.5F;
+            material_uniforms.specular_strength = materials[m].specular_strength;
+            material_uniforms.shininess = materials[m].shininess;
+            material_uniforms.use_diffuse_alpha_as_luster =
+                (int)materials[m].use_diffuse_alpha_as_luster ? 1 : 0;
+            // BC5 keeps only X and Y, and the shader rebuilds Z
+            const Texture *normal = materials[m].normal;
+            material_uniforms.normal_map_xy =
+                (texture_has_image(normal) && normal->format == TEXTURE_FORMAT_BC5) ? 1U : 0U;
+
+            switch (materials[m].alpha_mode) {
+            case ALPHA_MODE_MASK:
+                material_uniforms.alpha_mode = 1;
+                break;
+            case ALPHA_MODE_BLEND:
+                material_uniforms.alpha_mode = 2;
+                break;
+            default:
+                material_uniforms.alpha_mode = 0;
+                break;
+            }
+
+            memcpy((MaterialUniforms *)r->material_buffer_alloc.mapped + m, &material_uniforms,
+                   sizeof(MaterialUniforms));
+            r->material_gpu[m].descriptor_material = find_descriptor_material(r, m);
+            if (materials[m].alpha_mode != ALPHA_MODE_OPAQUE) {
+                material_bits |= MESH_PIPELINE_MATERIAL_ALPHA;
+            }
+            if (materials[m].use_diffuse_alpha_as_luster) {
+                material_bits |= MESH_PIPELINE_LUSTER;
+            }
+        }
+        r->material_pipeline_bits = material_bits;
+        r->uploaded_materials = materials;
+        r->uploaded_material_count = material_count;
+        r->materials_dirty = false;
     }
 
-    memcpy(r->uniform_buffer_allocs[r->current_frame].mapped, &uniforms, sizeof(Uniforms));
+    build_draw_list(r, mesh, materials, material_count, *mvp, *model, *projection, camera_pos);
+    if (!upload_draw_commands(r)) {
+        return false;
+    }
 
-    // Prepare per-material fragment uniforms
-    for (uint32_t m = 0; m < material_count; m++) {
-        FragmentUniforms frag_uniforms = {0};
-        glm_vec3_copy(r->normalized_light_dir, frag_uniforms.light_dir);
-        frag_uniforms.enable_lighting = (int)enable_lighting ? 1 : 0;
-        glm_vec3_copy((float *)camera_pos, frag_uniforms.camera_pos);
-        frag_uniforms.use_triplanar_mapping = (int)use_triplanar_mapping ? 1 : 0;
-        frag_uniforms.alpha_cutoff = 0.5F;
-        frag_uniforms.specular_strength = materials[m].specular_strength;
-        frag_uniforms.shininess = materials[m].shininess;
-        frag_uniforms.use_diffuse_alpha_as_luster =
-            (int)materials[m].use_diffuse_alpha_as_luster ? 1 : 0;
-
-        // Base/diffuse color factor
-        memcpy(frag_uniforms.base_color, materials[m].base_color, sizeof(float) * 4);
-
-        // Hemisphere ambient lighting
-        glm_vec4_copy((vec4){0.50F, 0.50F, 0.52F, 0.0F}, frag_uniforms.hemisphere_sky_color);
-        glm_vec4_copy((vec4){0.18F, 0.16F, 0.14F, 0.0F}, frag_uniforms.hemisphere_ground_color);
-
-        // Fill/rim are derived from key light direction so camera-linked key
-        // lighting remains visually obvious while orbiting.
-        vec3 fill_dir = {-frag_uniforms.light_dir[0], -frag_uniforms.light_dir[1] - 0.2F,
-                         -frag_uniforms.light_dir[2]};
-        glm_vec3_normalize(fill_dir);
-        glm_vec4_copy((vec4){fill_dir[0], fill_dir[1], fill_dir[2], 0.18F},
-                      frag_uniforms.fill_light_dir);
-
-        vec3 rim_dir = {-frag_uniforms.light_dir[0], -frag_uniforms.light_dir[1],
-                        -frag_uniforms.light_dir[2]};
-        glm_vec3_normalize(rim_dir);
-        glm_vec4_copy((vec4){rim_dir[0], rim_dir[1], rim_dir[2], 0.22F},
-                      frag_uniforms.rim_light_dir);
-
-        switch (materials[m].alpha_mode) {
-        case ALPHA_MODE_MASK:
-            frag_uniforms.alpha_mode = 1;
-            break;
-        case ALPHA_MODE_BLEND:
-            frag_uniforms.alpha_mode = 2;
-            break;
-        default:
-            frag_uniforms.alpha_mode = 0;
-            break;
-        }
+    // The variant for this frame's switches; the skinning stream is only bound when there is
+    // a pose to apply it with
+    const bool skinned = r->skin_buffer != VK_NULL_HANDLE && (bone_matrices != NULL || baked);
+    uint32_t pipeline_key = r->material_pipeline_bits;
+    if (skinned) {
+        pipeline_key |= MESH_PIPELINE_SKINNED |
+                        ((r->skin_influences - 1U) << MESH_PIPELINE_INFLUENCE_SHIFT);
+    }
+    if (enable_lighting) {
+        pipeline_key |= MESH_PIPELINE_LIGHTING;
+    }
+    if (use_triplanar_mapping) {
+        pipeline_key |= MESH_PIPELINE_TRIPLANAR;
+    }
+    if (r->cull_backfaces) {
+        pipeline_key |= MESH_PIPELINE_CULL_BACK;
+    }
+    const bool wireframe = get_wireframe_mode(&r->wireframe_mode);
+    const VkPipeline opaque_pipeline =
+        get_mesh_pipeline(r, pipeline_key | (wireframe ? MESH_PIPELINE_WIREFRAME : 0U));
+    const VkPipeline blend_pipeline = get_mesh_pipeline(r, pipeline_key | MESH_PIPELINE_BLEND);
+    if (opaque_pipeline == VK_NULL_HANDLE || blend_pipeline == VK_NULL_HANDLE) {
+        return false;
+    }
 
-        memcpy(r->material_gpu[m].fragment_uniform_buffer_allocs[r->current_frame].mapped,
-               &frag_uniforms, sizeof(FragmentUniforms));
+    // What runs inside the render pass, ready before the frame's commands execute it
+    if (!record_skydome(r, view, projection) ||
+        !record_scene(r, mesh->generation, opaque_pipeline, blend_pipeline, skinned,
+                      dynamic_offsets)) {
+        return false;
     }
 
     VkCommandBuffer cmd = r->command_buffers[r->current_frame];
@@ -630,127 +1781,43 @@ bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4
                                   "Failed to begin render command buffer");
         return false;
     }
+    if (r->timestamp_pools[r->current_frame] != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(cmd, r->timestamp_pools[r->current_frame], 0,
+                            VULKAN_GPU_TIMESTAMP_COUNT);
+    }
+    write_timestamp(r, cmd, VULKAN_GPU_STAGE_SKYDOME);
+    record_meshlet_culling(r, cmd);
 
     VkClearValue clear_values[2] = {{{{0, 0, 0, 1}}}, {{{0.0F, 0}}}};
 
     VkRenderPassBeginInfo rp_info = {.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
     rp_info.renderPass = r->render_pass;
-    rp_info.framebuffer = r->framebuffer[r->current_frame];
+    rp_info.framebuffer = r->staging_linear
+                              ? r->staging_framebuffers[r->current_frame][write_staging_idx]
+                              : r->framebuffer[r->current_frame];
     rp_info.renderArea.extent.width = r->width;
     rp_info.renderArea.extent.height = r->height;
     rp_info.clearValueCount = 2;
     rp_info.pClearValues = clear_values;
 
-    vkCmdBeginRenderPass(cmd, &rp_info, VK_SUBPASS_CONTENTS_INLINE);
-
-    VkViewport viewport = {0, 0, (float)r->width, (float)r->height, 1.0F, 0.0F};
-    VkRect2D scissor = {{0, 0}, {r->width, r->height}};
-    vkCmdSetViewport(cmd, 0, 1, &viewport);
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-    // Render skydome first
-    if (r->skydome_mesh && r->skydome_texture && r->skydome_pipeline != VK_NULL_HANDLE &&
-        r->skydome_vertex_buffer != VK_NULL_HANDLE && r->skydome_index_buffer != VK_NULL_HANDLE &&
-        view != NULL && projection != NULL) {
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->skydome_pipeline);
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->skydome_pipeline_layout, 0,
-                                1, &r->skydome_descriptor_sets[r->current_frame], 0, NULL);
-
-        mat4 sky_view;
-        glm_mat4_copy(*view, sky_view);
-        sky_view[3][0] = sky_view[3][1] = sky_view[3][2] = 0.0F;
-
-        mat4 sky_mvp;
-        glm_mat4_mul(*projection, sky_view, sky_mvp);
-        vkCmdPushConstants(cmd, r->skydome_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-                           sizeof(mat4), sky_mvp);
-
-        VkBuffer vb[] = {r->skydome_vertex_buffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(cmd, 0, 1, vb, offsets);
-        vkCmdBindIndexBuffer(cmd, r->skydome_index_buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(cmd, (uint32_t)r->skydome_mesh->indices.count, 1, 0, 0, 0);
-    }
-
-    // Render main model
-    VkPipeline active_pipeline =
-        (int)get_wireframe_mode(&r->wireframe_mode) ? r->wireframe_pipeline : r->graphics_pipeline;
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, active_pipeline);
-    vkCmdPushConstants(cmd, r->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-                       sizeof(PushConstants), &push_constants);
-
-    VkBuffer vbs[] = {r->vertex_buffer};
-    VkDeviceSize vb_offsets[] = {0};
-    vkCmdBindVertexBuffers(cmd, 0, 1, vbs, vb_offsets);
-    vkCmdBindIndexBuffer(cmd, r->index_buffer, 0, VK_INDEX_TYPE_UINT32);
-
-    if (mesh->submeshes.count > 0) {
-        for (size_t i = 0; i < mesh->submeshes.count; i++) {
-            const SubMesh *sm = &mesh->submeshes.data[i];
-            uint32_t mat_idx = sm->material_index < material_count ? sm->material_index : 0;
-            if (materials[mat_idx].alpha_mode == ALPHA_MODE_BLEND) {
-                continue;
-            }
-
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->pipeline_layout, 0, 1,
-                                    &r->material_gpu[mat_idx].descriptor_sets[r->current_frame], 0,
-                                    NULL);
-            vkCmdDrawIndexed(cmd, sm->index_count, 1, sm->index_offset, 0, 0);
-        }
-
-        bool has_blend = false;
-        for (size_t i = 0; i < mesh->submeshes.count; i++) {
-            const SubMesh *sm = &mesh->submeshes.data[i];
-            uint32_t mat_idx = sm->material_index < material_count ? sm->material_index : 0;
-            if (materials[mat_idx].alpha_mode != ALPHA_MODE_BLEND) {
-                continue;
-            }
-
-            if (!has_blend) {
-                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->blend_pipeline);
-                vkCmdPushConstants(cmd, r->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-                                   sizeof(PushConstants), &push_constants);
-                vkCmdBindVertexBuffers(cmd, 0, 1, vbs, vb_offsets);
-                vkCmdBindIndexBuffer(cmd, r->index_buffer, 0, VK_INDEX_TYPE_UINT32);
-                has_blend = true;
-            }
+    vkCmdBeginRenderPass(cmd, &rp_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    const VkCommandBuffer secondaries[] = {r->sky_command_buffers[r->current_frame],
+                                           r->scene_command_buffers[r->current_frame]};
+    vkCmdExecuteCommands(cmd, 2, secondaries);
+    vkCmdEndRenderPass(cmd);
 
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->pipeline_layout, 0, 1,
-                                    &r->material_gpu[mat_idx].descriptor_sets[r->current_frame], 0,
-                                    NULL);
-            vkCmdDrawIndexed(cmd, sm->index_count, 1, sm->index_offset, 0, 0);
-        }
+    r->frame_regions[r->current_frame] = (ScreenRect){0, 0, r->width, r->height};
+    if (r->cell_output != VULKAN_CELL_OUTPUT_NONE) {
+        record_cell_reduction(r, cmd, write_staging_idx);
+    } else if (r->staging_linear) {
+        record_linear_readback(r, cmd, write_staging_idx);
     } else {
-        // Fallback: single draw for the whole mesh
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r->pipeline_layout, 0, 1,
-                                &r->material_gpu[0].descriptor_sets[r->current_frame], 0, NULL);
-        vkCmdDrawIndexed(cmd, (uint32_t)mesh->indices.count, 1, 0, 0, 0);
+        const ScreenRect region = readback_region(
+            r, *mvp, skinned || skydome_drawn(r, view, projection), write_staging_idx);
+        r->frame_regions[r->current_frame] = region;
+        record_pixel_readback(r, cmd, write_staging_idx, region);
     }
-
-    vkCmdEndRenderPass(cmd);
-
-    // Copy color image to staging buffer for CPU readback
-    VkBufferImageCopy region = {0};
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.layerCount = 1;
-    region.imageExtent.width = r->width;
-    region.imageExtent.height = r->height;
-    region.imageExtent.depth = 1;
-
-    vkCmdCopyImageToBuffer(cmd, r->color_image[r->current_frame],
-                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                           r->staging_buffers[write_staging_idx], 1, &region);
-
-    VkBufferMemoryBarrier buffer_barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
-    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    buffer_barrier.buffer = r->staging_buffers[write_staging_idx];
-    buffer_barrier.size = VK_WHOLE_SIZE;
-
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0,
-                         NULL, 1, &buffer_barrier, 0, NULL);
+    write_timestamp(r, cmd, VULKAN_GPU_STAGE_READBACK + 1);
 
     vk_result = vkEndCommandBuffer(cmd);
     if (vk_result != VK_SUCCESS) {
@@ -762,6 +1829,14 @@ bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4
     VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &cmd;
+    // Uploads done on the transfer queue since the last frame
+    const VkPipelineStageFlags upload_wait_stage =
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    if (r->upload_semaphore_pending) {
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &r->upload_semaphore;
+        submit_info.pWaitDstStageMask = &upload_wait_stage;
+    }
 
     vk_result =
         vkQueueSubmit(r->graphics_queue, 1, &submit_info, r->in_flight_fences[r->current_frame]);
@@ -770,10 +1845,40 @@ bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4
                                   "Failed to submit render command buffer");
         return false;
     }
+    r->upload_semaphore_pending = false;
+    r->host_timings.record = get_time_seconds() - record_start;
 
-    r->frame_ready[r->current_frame] = true;
+    const uint32_t submitted = r->current_frame;
+    r->frame_ready[submitted] = true;
+    r->timestamps_written[submitted] = r->timestamp_pools[submitted] != VK_NULL_HANDLE;
     r->current_frame = (r->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
 
+    // Low latency: this frame is what goes out, once the GPU is done with it. Any older
+    // frame still returned above was pipelined before the switch, and this one supersedes it.
+    if (r->latency_mode == VULKAN_LATENCY_LOW) {
+        const double frame_wait_start = get_time_seconds();
+        vk_result = vkWaitForFences(r->device, 1, &r->in_flight_fences[submitted], VK_TRUE,
+                                    UINT64_MAX);
+        if (vk_result != VK_SUCCESS) {
+            vulkan_renderer_set_error(r, vk_result, "vkWaitForFences",
+                                      "Failed to wait for the frame just submitted");
+            return false;
+        }
+        r->host_timings.fence_wait += get_time_seconds() - frame_wait_start;
+        if (!map_completed_frame(r, submitted, &result)) {
+            return false;
+        }
+        r->frame_ready[submitted] = false;
+    }
+
     *out_framebuffer = result;
     return true;
 }
+
+void vulkan_renderer_set_latency_mode(VulkanRenderer *r, const VulkanLatencyMode mode) {
+    r->latency_mode = mode;
+}
+
+VulkanLatencyMode vulkan_renderer_get_latency_mode(const VulkanRenderer *r) {
+    return r->latency_mode;
+}
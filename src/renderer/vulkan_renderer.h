@@ -2,59 +2,185 @@
 #include <cglm/cglm.h>
 #include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <vulkan/vulkan.h>
 
 #include "../core/types.h"
+#include "../graphics/meshlet.h"
 #include "../graphics/model.h"
 #include "../graphics/texture.h"
+#include "draw_list.h"
+#include "render_types.h"
+#include "screen_rect.h"
 
 #define MAX_FRAMES_IN_FLIGHT 3
-#define NUM_STAGING_BUFFERS (MAX_FRAMES_IN_FLIGHT + 1)
+// Staging buffers for frames the caller copies before the next render: one per frame in
+// flight, and the one last returned
+#define NUM_COPIED_STAGING_BUFFERS (MAX_FRAMES_IN_FLIGHT + 1)
+// Staging buffers in host readback memory, whose frames are read in place: also the output
+// pipeline's queued and last written frames, and a spare so a buffer the consumer lets go
+// of waits a full turn of the ring before it is written again
+#define NUM_STAGING_BUFFERS (MAX_FRAMES_IN_FLIGHT + 4)
 #define INITIAL_MATERIAL_DESCRIPTOR_CAPACITY 32
-
-// Push constants for vertex shader
-typedef struct PushConstants {
+// Cell output reduces each 2x4 pixel block to one cell of two packed 32-bit words
+#define VULKAN_CELL_WIDTH 2U
+#define VULKAN_CELL_HEIGHT 4U
+#define VULKAN_CELL_BYTES 8U
+
+// What vulkan_renderer_render reads back
+typedef enum VulkanCellOutput {
+    // RGBA pixels
+    VULKAN_CELL_OUTPUT_NONE,
+    // Best-fit quadrant glyph per cell: foreground | mask << 24, then background (0xRRGGBB)
+    VULKAN_CELL_OUTPUT_QUADRANT_COLOR,
+    // Quadrant mask of pixels above mid luma, then zero
+    VULKAN_CELL_OUTPUT_QUADRANT_MONO,
+} VulkanCellOutput;
+
+// Which frame vulkan_renderer_render returns
+typedef enum VulkanLatencyMode {
+    // The one submitted MAX_FRAMES_IN_FLIGHT calls earlier, so the CPU never waits on the GPU
+    VULKAN_LATENCY_PIPELINED,
+    // The one just submitted, once the GPU finishes it
+    VULKAN_LATENCY_LOW,
+} VulkanLatencyMode;
+
+// Stages a frame's GPU work is timed in, in submission order
+typedef enum VulkanGpuStage {
+    VULKAN_GPU_STAGE_SKYDOME, // includes meshlet culling and the render pass clear
+    VULKAN_GPU_STAGE_OPAQUE,
+    VULKAN_GPU_STAGE_BLEND,
+    VULKAN_GPU_STAGE_READBACK, // image copy or cell reduction
+    VULKAN_GPU_STAGE_COUNT,
+} VulkanGpuStage;
+// One timestamp before the first stage and one after each
+#define VULKAN_GPU_TIMESTAMP_COUNT (VULKAN_GPU_STAGE_COUNT + 1)
+
+typedef struct VulkanGpuTimings {
+    float stage_ms[VULKAN_GPU_STAGE_COUNT];
+    float total_ms;
+    // Counts the frames timed so far, to tell new timings from ones already seen
+    uint64_t frame;
+} VulkanGpuTimings;
+
+// Host time the last vulkan_renderer_render spent, in seconds
+typedef struct VulkanHostTimings {
+    double fence_wait; // waiting for the frame slot, or in low latency the frame, from the GPU
+    double record;     // uploads, recording and submit, or drawing on the CPU backend
+} VulkanHostTimings;
+
+// Supplies host memory for frame readback: slot_count slots of *out_slot_size bytes each,
+// slot i at base + i * *out_slot_size, with base and slot size multiples of `alignment`.
+// Called whenever the staging buffers are (re)created; returns NULL on failure. A slot_count
+// of 0 hands the memory back: the renderer no longer reads frames into it.
+typedef uint8_t *(*VulkanHostReadbackMap)(size_t frame_size, uint32_t slot_count,
+                                          size_t alignment, size_t *out_slot_size);
+// Whether the consumer still reads `frame`, one returned earlier. Called on the render thread.
+typedef bool (*VulkanFrameHeld)(void *context, const uint8_t *frame);
+
+// Variant bits of a mesh pipeline: its fixed-function state, then the specialization
+// constants shader.vert and shader.frag are built with. A skinned variant's bone influence
+// count, minus one, sits above the flags.
+#define MESH_PIPELINE_SKINNED (1U << 0)
+#define MESH_PIPELINE_BLEND (1U << 1)
+#define MESH_PIPELINE_WIREFRAME (1U << 2)
+#define MESH_PIPELINE_LIGHTING (1U << 3)
+#define MESH_PIPELINE_TRIPLANAR (1U << 4)
+// Opaque-pass materials that are not all OPAQUE, so alphaMode is read per material
+#define MESH_PIPELINE_MATERIAL_ALPHA (1U << 5)
+#define MESH_PIPELINE_LUSTER (1U << 6)
+// Back faces are culled instead of drawn like front faces
+#define MESH_PIPELINE_CULL_BACK (1U << 7)
+#define MESH_PIPELINE_INFLUENCE_SHIFT 8U
+#define MESH_PIPELINE_VARIANT_COUNT (1U << 10)
+
+// A frame slot of the uniform ring: the vertex shader's transforms, then the fragment
+// shader's light and camera, both read through binding 4. Keeping the transforms out of
+// push constants leaves the recorded draws the same from frame to frame.
+typedef struct FrameBlock {
     mat4 mvp;
     mat4 model;
-} PushConstants;
+    FrameUniforms frame;
+} FrameBlock;
+
+// What a frame slot's draw-list recording bound and drew; the recording is reused while
+// the next frame's key is equal. Zeroed before filling, so it compares with memcmp.
+typedef struct SceneRecordingKey {
+    uint64_t resource_generation;
+    uint64_t mesh_generation;
+    uint64_t draw_list_hash;
+    VkPipeline opaque_pipeline;
+    VkPipeline blend_pipeline;
+    VkBuffer vertex_buffer;
+    VkBuffer skin_buffer; // VK_NULL_HANDLE when drawn unskinned
+    VkBuffer index_buffer;
+    VkBuffer material_index_buffer;
+    VkBuffer draw_command_buffer;
+    uint32_t dynamic_offsets[2];
+    uint32_t width;
+    uint32_t height;
+} SceneRecordingKey;
 
-// Uniform buffer for vertex shader
-typedef struct Uniforms {
-    mat4 bone_matrices[MAX_BONES];
+// Push constants for the cell reduction compute shader
+typedef struct CellPushConstants {
+    uint32_t width;
+    uint32_t height;
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t mono;
+} CellPushConstants;
+
+// Push constants for the meshlet culling compute shader: one dispatch per DrawCull
+typedef struct CullPushConstants {
+    vec4 planes[4];        // MeshletCullView::planes
+    vec4 camera;           // model-space camera; w is 1 to test the normal cones
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
+    uint32_t first_command;
+    uint32_t padding;
+} CullPushConstants;
+
+// BoneUniforms::has_animation: where the skinned vertex shader reads the pose from
+#define BONE_POSE_NONE 0U
+#define BONE_POSE_MATRICES 1U // bone_matrices
+#define BONE_POSE_BAKED 2U    // the mesh's baked poses, at the offsets in the header
+
+// Vertex shader bone block, a dynamic slot in the uniform ring. Only the header and the
+// first bone_count matrices are written; a baked pose needs the header alone.
+typedef struct BoneUniforms {
     uint32_t has_animation;
-    uint32_t padding[3];
-} Uniforms;
-
-// Uniform buffer for fragment shader
-typedef struct FragmentUniforms {
-    vec3 light_dir;
-    uint32_t enable_lighting;
-    vec3 camera_pos;
-    uint32_t use_triplanar_mapping;
+    // BONE_POSE_BAKED: float4 offsets of the two baked poses to blend, and the blend
+    uint32_t pose_offset;
+    uint32_t next_pose_offset;
+    float pose_blend;
+    mat4 bone_matrices[MAX_BONES];
+} BoneUniforms;
+
+// Per-material fragment constants, written when the material set changes. All materials
+// share one storage buffer that the fragment shader indexes by material.
+typedef struct MaterialUniforms {
+    vec4 base_color;
     uint32_t alpha_mode;
     float alpha_cutoff;
     float specular_strength;
     float shininess;
     uint32_t use_diffuse_alpha_as_luster;
-    uint32_t padding0[3];
-    vec4 base_color;
-    vec4 hemisphere_sky_color;
-    vec4 hemisphere_ground_color;
-    vec4 fill_light_dir;
-    vec4 rim_light_dir;
-} FragmentUniforms;
-
-// Per-material render data passed from main to renderer
-typedef struct RenderMaterial {
-    const Texture *diffuse;
-    const Texture *normal;
-    AlphaMode alpha_mode;
-    float specular_strength;
-    float shininess;
-    float base_color[4];
-    bool use_diffuse_alpha_as_luster;
-} RenderMaterial;
+    uint32_t normal_map_xy;
+    uint32_t padding[2];
+} MaterialUniforms;
+
+// Device memory is taken from per-memory-type blocks owned by a pool; each pool is
+// released as a whole.
+typedef enum VulkanMemoryPool {
+    // Textures, mesh and uniform buffers, upload staging
+    VULKAN_MEMORY_POOL_RESOURCES,
+    // Render targets and readback staging, rebuilt on resize
+    VULKAN_MEMORY_POOL_FRAME,
+    VULKAN_MEMORY_POOL_COUNT,
+} VulkanMemoryPool;
+
+typedef struct VulkanMemoryBlock VulkanMemoryBlock;
 
 // Memory allocation helper
 typedef struct VulkanAllocation {
@@ -62,29 +188,37 @@ typedef struct VulkanAllocation {
     VkDeviceSize offset;
     VkDeviceSize size;
     void *mapped;
+    // Block the range was carved from; NULL when the allocation owns `memory` outright
+    VulkanMemoryBlock *block;
 } VulkanAllocation;
 
+// One uploaded material image (vk_upload.c), shared by every material that samples the same
+// pixels. Slots whose `refs` drop to zero are destroyed and reused.
+typedef struct GpuTexture {
+    VkImage image;
+    VulkanAllocation alloc;
+    VkImageView view;
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_levels;
+    // Pixels the image was uploaded from; NULL for the built-in fallback of its format
+    const void *data_ptr;
+    uint32_t refs;
+} GpuTexture;
+
+#define GPU_TEXTURE_NONE UINT32_MAX
+
 // Per-material GPU resources
 typedef struct MaterialGPUData {
-    VkImage diffuse_image;
-    VulkanAllocation diffuse_image_alloc;
-    VkImageView diffuse_image_view;
-    uint32_t cached_diffuse_width;
-    uint32_t cached_diffuse_height;
-    const void *cached_diffuse_data_ptr;
-
-    VkImage normal_image;
-    VulkanAllocation normal_image_alloc;
-    VkImageView normal_image_view;
-    uint32_t cached_normal_width;
-    uint32_t cached_normal_height;
-    const void *cached_normal_data_ptr;
+    // Indices into gpu_textures, or GPU_TEXTURE_NONE before the first upload
+    uint32_t diffuse_texture;
+    uint32_t normal_texture;
 
     VkDescriptorSet descriptor_sets[MAX_FRAMES_IN_FLIGHT];
     bool descriptor_sets_dirty[MAX_FRAMES_IN_FLIGHT];
-
-    VkBuffer fragment_uniform_buffers[MAX_FRAMES_IN_FLIGHT];
-    VulkanAllocation fragment_uniform_buffer_allocs[MAX_FRAMES_IN_FLIGHT];
+    // Lowest material with the same textures; draws bind that material's descriptor set
+    uint32_t descriptor_material;
 } MaterialGPUData;
 
 // Vulkan Renderer struct
@@ -92,19 +226,43 @@ typedef struct VulkanRenderer {
     uint32_t width;
     uint32_t height;
     vec3 normalized_light_dir;
+    // Rendered pixels per distinguishable output sample, used to pick mesh LODs
+    float lod_detail_pixels;
+    // Skip triangles facing away from the camera, and meshlets made only of them
+    bool cull_backfaces;
+
+    // Software backend (vulkan_renderer_initialize_cpu). When set, no Vulkan objects exist and
+    // frames are drawn into cpu_frames, rotated like the staging buffers.
+    struct CpuRasterizer *cpu;
+    uint8_t *cpu_frame_memory;
+    uint8_t *cpu_frames[NUM_STAGING_BUFFERS];
 
     VkInstance instance;
 #ifndef NDEBUG
     VkDebugUtilsMessengerEXT debug_messenger;
     PFN_vkSetDebugUtilsObjectNameEXT pfn_set_object_name;
 #endif
+    // --gpu: the device to use by index or name; NULL picks the fastest at readback
+    const char *device_preference;
     VkPhysicalDevice physical_device;
     VkDevice device;
     VkQueue graphics_queue;
     uint32_t graphics_queue_family;
+    // Equal to graphics_queue/graphics_queue_family without a transfer-only family
+    VkQueue transfer_queue;
+    uint32_t transfer_queue_family;
 
     VkPhysicalDeviceMemoryProperties mem_properties;
     VkDeviceSize non_coherent_atom_size;
+    VulkanMemoryBlock *memory_pools[VULKAN_MEMORY_POOL_COUNT];
+
+    // VK_EXT_external_memory_host, used to read frames straight into caller memory
+    bool external_memory_capabilities_available;
+    PFN_vkGetMemoryHostPointerPropertiesEXT pfn_get_memory_host_pointer_properties;
+    VkDeviceSize min_imported_host_pointer_alignment;
+    VulkanHostReadbackMap host_readback_map;
+    VulkanFrameHeld frame_held;
+    void *frame_held_context;
 
     VkCommandPool command_pool;
     VkDescriptorPool descriptor_pool;
@@ -112,17 +270,24 @@ typedef struct VulkanRenderer {
     VkDescriptorSetLayout descriptor_set_layout;
     VkPipelineLayout pipeline_layout;
     VkRenderPass render_pass;
-    VkPipeline graphics_pipeline;
-    VkPipeline blend_pipeline;
-    VkPipeline wireframe_pipeline;
+    // Mesh pipelines by MESH_PIPELINE_* bits, created on first use from these shader
+    // modules; see get_mesh_pipeline
+    VkShaderModule mesh_vert_module;
+    VkShaderModule mesh_skinned_vert_module;
+    VkShaderModule mesh_frag_module;
+    VkPipeline mesh_pipelines[MESH_PIPELINE_VARIANT_COUNT];
     atomic_bool wireframe_mode;
 
+    // Persisted in the user cache directory between runs; see create_pipeline_cache
+    VkPipelineCache pipeline_cache;
+    size_t pipeline_cache_loaded_size;
+    char pipeline_cache_path[512];
+
     // Skydome
     VkDescriptorSetLayout skydome_descriptor_set_layout;
     VkPipelineLayout skydome_pipeline_layout;
     VkPipeline skydome_pipeline;
     VkDescriptorSet skydome_descriptor_sets[MAX_FRAMES_IN_FLIGHT];
-    const Mesh *skydome_mesh;
     const Texture *skydome_texture;
 
     VkImage skydome_image;
@@ -130,9 +295,66 @@ typedef struct VulkanRenderer {
     VkImageView skydome_image_view;
     const void *cached_skydome_data_ptr;
 
+    // Cell reduction compute pass
+    VkDescriptorSetLayout cells_descriptor_set_layout;
+    VkPipelineLayout cells_pipeline_layout;
+    VkPipeline cells_pipeline;
+    VkDescriptorPool cells_descriptor_pool;
+    VkDescriptorSet cells_descriptor_sets[MAX_FRAMES_IN_FLIGHT];
+    VulkanCellOutput cell_output;
+
+    // Meshlet culling compute pass, which fills the draw commands of draw_list.culls; only
+    // with multi_draw_indirect. Without it meshlets are culled on the CPU.
+    VkDescriptorSetLayout cull_descriptor_set_layout;
+    VkPipelineLayout cull_pipeline_layout;
+    VkPipeline cull_pipeline;
+    VkDescriptorPool cull_descriptor_pool;
+    VkDescriptorSet cull_descriptor_sets[MAX_FRAMES_IN_FLIGHT];
+    // Mesh::meshlets of the uploaded mesh
+    VkBuffer meshlet_buffer;
+    VulkanAllocation meshlet_buffer_alloc;
+
+    // Upload batch (vk_transfer.c): transitions and copies recorded into one command buffer
+    // and sourced from a persistent host-visible staging ring
+    VkCommandPool upload_command_pool;
+    VkCommandBuffer upload_command_buffer;
+    VkFence upload_fence;
+    // Signalled by transfer-queue batches and waited on by the next frame submit
+    VkSemaphore upload_semaphore;
+    bool upload_semaphore_pending;
+    bool upload_recording;
+    VkBuffer upload_ring;
+    VulkanAllocation upload_ring_alloc;
+    VkDeviceSize upload_ring_size;
+    VkDeviceSize upload_ring_head;
+    // Blits need a graphics queue: with a transfer-only upload queue, mip chains are recorded
+    // here and submitted to the graphics queue right after their batch
+    VkCommandPool mip_command_pool;
+    VkCommandBuffer mip_command_buffer;
+    bool mip_recording;
+
     // Command buffers and sync
     VkCommandBuffer command_buffers[MAX_FRAMES_IN_FLIGHT];
+    // Secondary command buffers run inside the render pass. The skydome's follows the camera
+    // and is recorded every frame; the draw list's is kept while its key holds, so a static
+    // scene costs no recording however many sub-meshes it has.
+    VkCommandBuffer sky_command_buffers[MAX_FRAMES_IN_FLIGHT];
+    VkCommandBuffer scene_command_buffers[MAX_FRAMES_IN_FLIGHT];
+    SceneRecordingKey scene_keys[MAX_FRAMES_IN_FLIGHT];
+    bool scene_recorded[MAX_FRAMES_IN_FLIGHT];
+    // Bumped whenever resources frames in flight use may be replaced, which drops every
+    // recording: a replacement can reuse the old handle
+    uint64_t resource_generation;
     VkFence in_flight_fences[MAX_FRAMES_IN_FLIGHT];
+    // Stage timestamps, one pool per frame in flight, read back once the frame's fence has
+    // signalled. The pools stay VK_NULL_HANDLE when the graphics queue cannot write them.
+    VkQueryPool timestamp_pools[MAX_FRAMES_IN_FLIGHT];
+    bool timestamps_written[MAX_FRAMES_IN_FLIGHT];
+    float timestamp_period; // nanoseconds per tick
+    uint64_t timestamp_mask;
+    VulkanGpuTimings gpu_timings;
+    bool gpu_timings_valid;
+    VulkanHostTimings host_timings;
 
     // Render targets (one set per in-flight frame so concurrent submissions
     // never share a color/depth attachment)
@@ -150,36 +372,101 @@ typedef struct VulkanRenderer {
     VkBuffer staging_buffers[NUM_STAGING_BUFFERS];
     VulkanAllocation staging_buffer_allocs[NUM_STAGING_BUFFERS];
     bool frame_ready[MAX_FRAMES_IN_FLIGHT];
+    VulkanLatencyMode latency_mode;
     uint32_t current_staging_buffer;
+    // NUM_STAGING_BUFFERS in host readback memory, NUM_COPIED_STAGING_BUFFERS otherwise
+    uint32_t staging_buffer_count;
     uint32_t frame_staging_buffers[MAX_FRAMES_IN_FLIGHT];
-
-    // Uniform buffers (shared vertex uniforms — bone matrices)
-    VkBuffer uniform_buffers[MAX_FRAMES_IN_FLIGHT];
-    VulkanAllocation uniform_buffer_allocs[MAX_FRAMES_IN_FLIGHT];
+    // Staging memory is imported host memory (always coherent, never vkMapMemory'd)
+    bool staging_imported;
+    // Unified memory: frames are drawn straight into linear, host-visible staging images
+    // and read where they were drawn, with no image-to-buffer copy. Their memory is in
+    // staging_buffer_allocs, and each frame slot has a framebuffer for every image.
+    bool staging_linear;
+    VkImage staging_images[NUM_STAGING_BUFFERS];
+    VkImageView staging_image_views[NUM_STAGING_BUFFERS];
+    VkFramebuffer staging_framebuffers[MAX_FRAMES_IN_FLIGHT][NUM_STAGING_BUFFERS];
+    // Pixel readback copies only what can have changed: the part of each staging buffer
+    // that may hold something other than the clear colour, and what each frame in flight
+    // copied, which is all that needs invalidating. Whole frames outside pixel readback.
+    ScreenRect staging_regions[NUM_STAGING_BUFFERS];
+    ScreenRect frame_regions[MAX_FRAMES_IN_FLIGHT];
+
+    // Uniform ring: MAX_FRAMES_IN_FLIGHT FrameBlock slots followed by as many
+    // BoneUniforms slots, all bound through dynamic offsets
+    VkBuffer uniform_ring;
+    VulkanAllocation uniform_ring_alloc;
+    VkDeviceSize frame_uniform_stride;
+    VkDeviceSize bone_uniform_stride;
+    // Bone slot holding the current pose, and what was written there
+    uint32_t bone_slot;
+    bool bone_slot_valid;
+    bool pose_dirty;
+    const mat4 *uploaded_bone_matrices;
+    uint32_t uploaded_bone_count;
+    // Header of the pose in bone_slot
+    uint32_t uploaded_pose_mode;
+    uint32_t uploaded_pose_offsets[2];
+    float uploaded_pose_blend;
+    // The mesh's BakedPoses on the GPU, bound for the vertex shader, and the clip and time
+    // vulkan_renderer_set_baked_pose chose (clip -1 for none)
+    VkBuffer baked_pose_buffer;
+    VulkanAllocation baked_pose_alloc;
+    const float *uploaded_baked_poses;
+    int32_t baked_clip;
+    float baked_time;
+    // Material set whose MaterialUniforms are in material_buffer
+    const RenderMaterial *uploaded_materials;
+    uint32_t uploaded_material_count;
+    bool materials_dirty;
+    // MESH_PIPELINE_MATERIAL_ALPHA and MESH_PIPELINE_LUSTER if that set needs them
+    uint32_t material_pipeline_bits;
 
     // Per-material GPU data
     MaterialGPUData *material_gpu;
     uint32_t material_gpu_count;
+    GpuTexture *gpu_textures;
+    uint32_t gpu_texture_count;
+    // MaterialUniforms for every material, and the per-instance stream holding 0, 1, 2, ...
+    // that turns each draw's firstInstance into the material index the shaders read
+    VkBuffer material_buffer;
+    VulkanAllocation material_buffer_alloc;
+    VkBuffer material_index_buffer;
+    VulkanAllocation material_index_buffer_alloc;
+
+    // Sub-mesh draws merged into batches, and each frame's copy of the commands
+    DrawList draw_list;
+    // The view draw_list.culls are culled against
+    MeshletCullView cull_view;
+    VkBuffer draw_command_buffers[MAX_FRAMES_IN_FLIGHT];
+    VulkanAllocation draw_command_allocs[MAX_FRAMES_IN_FLIGHT];
+    uint32_t draw_command_capacity[MAX_FRAMES_IN_FLIGHT];
+    // multiDrawIndirect and drawIndirectFirstInstance; without them batches are recorded as
+    // direct draws
+    bool multi_draw_indirect;
 
     VkSampler sampler;
 
     // Vertex/index buffers
+    // Packed vertices (PackedVertex); skin_buffer (PackedSkin) exists only for skinned meshes
     VkBuffer vertex_buffer;
     VulkanAllocation vertex_buffer_alloc;
+    VkBuffer skin_buffer;
+    VulkanAllocation skin_buffer_alloc;
+    // Most influences a vertex of skin_buffer uses (1-4)
+    uint32_t skin_influences;
     size_t cached_vertex_count;
 
     VkBuffer index_buffer;
     VulkanAllocation index_buffer_alloc;
     size_t cached_index_count;
 
-    // Skydome buffers
-    VkBuffer skydome_vertex_buffer;
-    VulkanAllocation skydome_vertex_buffer_alloc;
-    VkBuffer skydome_index_buffer;
-    VulkanAllocation skydome_index_buffer_alloc;
-
     // Cache
     uint64_t cached_mesh_generation;
+    // Box around the uploaded mesh's positions, which bounds what it can cover on screen
+    bool mesh_bounds_valid;
+    vec3 mesh_bounds_min;
+    vec3 mesh_bounds_max;
 
     char shader_directory[256];
     VkResult last_error_code;
@@ -200,8 +487,16 @@ void vk_set_object_name(VulkanRenderer *r, VkObjectType type, uint64_t handle, c
 VulkanRenderer *vulkan_renderer_create(uint32_t width, uint32_t height);
 void vulkan_renderer_destroy(VulkanRenderer *r);
 
+// Before vulkan_renderer_initialize: the device to use, by index or by part of its name.
+// Without one the renderer measures how fast each device gets a frame into host memory and
+// uses the fastest.
+void vulkan_renderer_set_device_preference(VulkanRenderer *r, const char *preference);
+
 // Initialize
 bool vulkan_renderer_initialize(VulkanRenderer *r);
+// Initializes the CPU rasterizer backend instead of a Vulkan device. Every entry point then
+// renders in software; GPU cell output is unavailable.
+bool vulkan_renderer_initialize_cpu(VulkanRenderer *r);
 void vulkan_renderer_clear_error(VulkanRenderer *r);
 void vulkan_renderer_set_error(VulkanRenderer *r, VkResult result, const char *operation,
                                const char *format, ...);
@@ -214,19 +509,80 @@ bool vulkan_renderer_resize(VulkanRenderer *r, uint32_t width, uint32_t height);
 // Set light direction
 void vulkan_renderer_set_light_direction(VulkanRenderer *r, const float *direction);
 
+// Tells the renderer the bone matrices changed in place. A different pointer or bone
+// count is picked up without this; unchanged poses are not re-uploaded.
+void vulkan_renderer_mark_pose_changed(VulkanRenderer *r);
+// Poses skinned meshes from their BakedPoses, clip `clip` at `time` ticks, sampled in the
+// vertex shader by renders given no bone matrices. -1 goes back to bone matrices. Ignored
+// by the CPU backend and for meshes without baked poses.
+void vulkan_renderer_set_baked_pose(VulkanRenderer *r, int32_t clip, float time);
+// Tells the renderer the material set changed in place, e.g. a texture was swapped in
+void vulkan_renderer_mark_materials_changed(VulkanRenderer *r);
+// How many rendered pixels make up one sample the output can actually show (e.g. 2 for
+// character cells built from 2x4 pixel blocks). Coarser output draws coarser mesh LODs.
+void vulkan_renderer_set_lod_detail(VulkanRenderer *r, float pixels);
+// Culls back faces instead of drawing both sides of every triangle. Only for closed meshes:
+// the insides of open ones disappear.
+void vulkan_renderer_set_backface_culling(VulkanRenderer *r, bool enabled);
+// True when frames are drawn from the CPU-side mesh and textures every time (the CPU
+// backend), so they must stay in memory after the first frame
+bool vulkan_renderer_needs_host_data(const VulkanRenderer *r);
+// True when the renderer holds an upload of this generation of `mesh`, so its CPU-side
+// geometry is not read again
+bool vulkan_renderer_has_mesh(const VulkanRenderer *r, const Mesh *mesh);
+// TEXTURE_FORMAT_BIT set of the block formats material textures can be uploaded in: those
+// the device samples with linear filtering. 0 on the CPU backend, which reads RGBA8 only.
+uint32_t vulkan_renderer_texture_formats(const VulkanRenderer *r);
+
+// Makes the GPU copy frames directly into memory supplied by `map` instead of renderer-owned
+// staging buffers. Devices that cannot import host memory keep the regular staging
+// buffers; vulkan_renderer_host_readback_active tells which one is in use. Pass NULL to go
+// back to regular staging buffers. Returns false only if no staging buffers could be made.
+bool vulkan_renderer_set_host_readback(VulkanRenderer *r, VulkanHostReadbackMap map);
+bool vulkan_renderer_host_readback_active(const VulkanRenderer *r);
+// Frames in host readback memory are read in place, so a staging buffer is not written again
+// while `held` reports the frame in it still in use. Without it only the frames in flight
+// and the one last returned are kept.
+void vulkan_renderer_set_frame_held(VulkanRenderer *r, VulkanFrameHeld held, void *context);
+
+// Switches readback between pixels and a compute-built cell grid of
+// ceil(width / VULKAN_CELL_WIDTH) x ceil(height / VULKAN_CELL_HEIGHT) cells, VULKAN_CELL_BYTES
+// each. Returns false if the cell shader is unavailable or the buffers could not be made.
+bool vulkan_renderer_set_cell_output(VulkanRenderer *r, VulkanCellOutput mode);
+
 // Wireframe mode
 void vulkan_renderer_set_wireframe_mode(VulkanRenderer *r, bool enabled);
 bool vulkan_renderer_get_wireframe_mode(const VulkanRenderer *r);
 
-// Render and return framebuffer
+// Pipelined by default. Switching to low latency takes effect with the next render;
+// switching back, the next MAX_FRAMES_IN_FLIGHT renders return no frame while the pipeline
+// refills. The CPU backend always returns the frame it just drew.
+void vulkan_renderer_set_latency_mode(VulkanRenderer *r, VulkanLatencyMode mode);
+VulkanLatencyMode vulkan_renderer_get_latency_mode(const VulkanRenderer *r);
+
+// Render and return framebuffer. Pipelined, the returned framebuffer is the one submitted
+// MAX_FRAMES_IN_FLIGHT calls earlier (NULL until then). In low latency it is the one just
+// submitted, and on the CPU backend the frame it just drew. It is valid until the next render,
+// or in host readback memory for as long as the frame-held hook reports it held.
 bool vulkan_renderer_render(VulkanRenderer *r, const Mesh *mesh, mat4 *mvp, mat4 *model,
                             const RenderMaterial *materials, uint32_t material_count,
                             bool enable_lighting, const vec3 camera_pos, bool use_triplanar_mapping,
                             const mat4 *bone_matrices, uint32_t bone_count, mat4 *view,
                             mat4 *projection, const uint8_t **out_framebuffer);
-
-// Set skydome
-bool vulkan_renderer_set_skydome(VulkanRenderer *r, const Mesh *mesh, const Texture *texture);
+// Stage times of the most recently completed frame. Returns false when there are none: on
+// the CPU backend, without timestamp support, or before the first frame completes.
+bool vulkan_renderer_get_gpu_timings(const VulkanRenderer *r, VulkanGpuTimings *out);
+void vulkan_renderer_get_host_timings(const VulkanRenderer *r, VulkanHostTimings *out);
+// Waits for the oldest frame still in flight and returns its framebuffer, or NULL once none
+// are left. Used to collect the last frames when no further render call follows.
+bool vulkan_renderer_read_pending_frame(VulkanRenderer *r, const uint8_t **out_framebuffer);
+
+// Frees the per-model GPU resources (mesh buffers, material textures and uniforms) so the
+// next render uploads a different model. The device, pipelines and skydome stay alive.
+void vulkan_renderer_release_model(VulkanRenderer *r);
+
+// Sets the equirectangular panorama drawn behind the model (graphics/skydome.h)
+bool vulkan_renderer_set_skydome(VulkanRenderer *r, const Texture *texture);
 
 // Wait for idle
 void vulkan_renderer_wait_idle(const VulkanRenderer *r);
@@ -0,0 +1,443 @@
+#include "terminal/block_encoder.h"
+#include "terminal/terminal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Unchanged cells between two changed ones are rewritten rather than skipped with a
+// cursor move when the gap is at most this wide, matching the chafa diff path.
+#define BLOCK_DIFF_MAX_GAP 4
+#define BLOCK_COLOR_UNSET 0xFFFFFFFFU
+#define BLOCK_QUADRANT_THRESHOLD (128U * 4U)
+
+typedef struct {
+    uint32_t top;
+    uint32_t bottom;
+} BlockCell;
+
+// Source pixel span sampled for one cell column or cell half-row
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+} BlockSpan;
+
+typedef struct {
+    BlockEncoderMode mode;
+    uint32_t source_width;
+    uint32_t source_height;
+    uint32_t cols;
+    uint32_t rows;
+    BlockCell *cells;
+    BlockCell *previous;
+    // Two spans per cell in each direction: left/right columns and the four quarter rows
+    BlockSpan *column_spans;
+    BlockSpan *row_spans;
+    bool previous_valid;
+
+    char *output;
+    size_t output_size;
+    size_t output_capacity;
+} BlockEncoderState;
+
+static BlockEncoderState g_block;
+
+// Decimal forms of every channel value, so SGR sequences are built with copies only.
+static char g_decimal[256][4];
+static uint8_t g_decimal_length[256];
+static bool g_tables_ready = false;
+
+static const char *const QUADRANT_GLYPHS[16] = {
+    " ", "▘", "▝", "▀", "▖", "▌", "▞", "▛",
+    "▗", "▚", "▐", "▜", "▄", "▙", "▟", "█",
+};
+
+static void init_tables(void) {
+    if (g_tables_ready) {
+        return;
+    }
+    for (int i = 0; i < 256; i++) {
+        g_decimal_length[i] = (uint8_t)snprintf(g_decimal[i], sizeof(g_decimal[i]), "%d", i);
+    }
+    g_tables_ready = true;
+}
+
+static bool output_reserve(const size_t extra) {
+    const size_t needed = g_block.output_size + extra;
+    if (needed <= g_block.output_capacity) {
+        return true;
+    }
+    size_t capacity = g_block.output_capacity ? g_block.output_capacity : 65536U;
+    while (capacity < needed) {
+        capacity *= 2U;
+    }
+    char *output = realloc(g_block.output, capacity);
+    if (!output) {
+        return false;
+    }
+    g_block.output = output;
+    g_block.output_capacity = capacity;
+    return true;
+}
+
+static inline void put_bytes(const char *data, const size_t length) {
+    memcpy(g_block.output + g_block.output_size, data, length);
+    g_block.output_size += length;
+}
+
+static inline void put_uint(uint32_t value) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + (value % 10U));
+        value /= 10U;
+    } while (value > 0);
+    while (count > 0) {
+        g_block.output[g_block.output_size++] = digits[--count];
+    }
+}
+
+static inline void put_rgb(const uint32_t color) {
+    const uint32_t channels[3] = {(color >> 16) & 0xFFU, (color >> 8) & 0xFFU, color & 0xFFU};
+    for (int i = 0; i < 3; i++) {
+        g_block.output[g_block.output_size++] = ';';
+        put_bytes(g_decimal[channels[i]], g_decimal_length[channels[i]]);
+    }
+}
+
+static void build_spans(BlockSpan *spans, const uint32_t parts, const uint32_t source) {
+    for (uint32_t i = 0; i < parts; i++) {
+        uint32_t start = (uint32_t)(((uint64_t)i * source) / parts);
+        uint32_t end = (uint32_t)(((uint64_t)(i + 1U) * source) / parts);
+        if (start >= source) {
+            start = source - 1U;
+        }
+        if (end <= start) {
+            end = start + 1U;
+        }
+        spans[i] = (BlockSpan){start, end - start};
+    }
+}
+
+static bool resize_cells(const uint32_t cols, const uint32_t rows) {
+    const size_t count = (size_t)cols * rows;
+    BlockCell *cells = realloc(g_block.cells, count * sizeof(BlockCell));
+    if (!cells) {
+        return false;
+    }
+    g_block.cells = cells;
+    BlockCell *previous = realloc(g_block.previous, count * sizeof(BlockCell));
+    if (!previous) {
+        return false;
+    }
+    g_block.previous = previous;
+    return true;
+}
+
+static bool ensure_geometry(const BlockEncoderMode mode, const uint32_t width,
+                            const uint32_t height) {
+    uint32_t display_width;
+    uint32_t display_height;
+    terminal_get_display_size(width, height, &display_width, &display_height);
+    const uint32_t cols =
+        (display_width + SYMBOL_CELL_SOURCE_WIDTH - 1U) / SYMBOL_CELL_SOURCE_WIDTH;
+    const uint32_t rows =
+        (display_height + SYMBOL_CELL_SOURCE_HEIGHT - 1U) / SYMBOL_CELL_SOURCE_HEIGHT;
+    if (g_block.cells && g_block.mode == mode && g_block.source_width == width &&
+        g_block.source_height == height && g_block.cols == cols && g_block.rows == rows) {
+        return true;
+    }
+
+    if (!resize_cells(cols, rows)) {
+        return false;
+    }
+    BlockSpan *column_spans = realloc(g_block.column_spans, (size_t)cols * 2U * sizeof(BlockSpan));
+    if (!column_spans) {
+        return false;
+    }
+    g_block.column_spans = column_spans;
+    BlockSpan *row_spans = realloc(g_block.row_spans, (size_t)rows * 4U * sizeof(BlockSpan));
+    if (!row_spans) {
+        return false;
+    }
+    g_block.row_spans = row_spans;
+
+    build_spans(column_spans, cols * 2U, width);
+    build_spans(row_spans, rows * 4U, height);
+    g_block.mode = mode;
+    g_block.source_width = width;
+    g_block.source_height = height;
+    g_block.cols = cols;
+    g_block.rows = rows;
+    g_block.previous_valid = false;
+    return true;
+}
+
+// Sums one channel-interleaved RGBA row segment into r/g/b accumulators.
+static inline void sum_span(const uint8_t *row, const BlockSpan span, uint32_t *r, uint32_t *g,
+                            uint32_t *b) {
+    const uint8_t *pixel = row + ((size_t)span.start * 4U);
+    for (uint32_t i = 0; i < span.count; i++) {
+        *r += pixel[0];
+        *g += pixel[1];
+        *b += pixel[2];
+        pixel += 4;
+    }
+}
+
+// Averages the pixels of two vertically adjacent quarter rows across two column spans.
+static uint32_t average_block(const uint8_t *framebuffer, const size_t stride,
+                              const BlockSpan *rows, const BlockSpan *cols) {
+    uint32_t r = 0;
+    uint32_t g = 0;
+    uint32_t b = 0;
+    uint32_t count = 0;
+    for (int ry = 0; ry < 2; ry++) {
+        for (uint32_t y = 0; y < rows[ry].count; y++) {
+            const uint8_t *row = framebuffer + ((size_t)(rows[ry].start + y) * stride);
+            for (int cx = 0; cx < 2; cx++) {
+                sum_span(row, cols[cx], &r, &g, &b);
+                count += cols[cx].count;
+            }
+        }
+    }
+    const uint32_t half = count / 2U;
+    return (((r + half) / count) << 16) | (((g + half) / count) << 8) | ((b + half) / count);
+}
+
+static uint32_t average_luma(const uint8_t *framebuffer, const size_t stride,
+                             const BlockSpan *rows, const BlockSpan col) {
+    uint32_t r = 0;
+    uint32_t g = 0;
+    uint32_t b = 0;
+    uint32_t count = 0;
+    for (int ry = 0; ry < 2; ry++) {
+        for (uint32_t y = 0; y < rows[ry].count; y++) {
+            sum_span(framebuffer + ((size_t)(rows[ry].start + y) * stride), col, &r, &g, &b);
+            count += col.count;
+        }
+    }
+    // Rec. 601 weights in 1/256 units, scaled so the result spans 0..1020.
+    return ((r * 77U) + (g * 150U) + (b * 29U)) * 4U / (count * 256U);
+}
+
+static void sample_cells(const uint8_t *framebuffer) {
+    const size_t stride = (size_t)g_block.source_width * 4U;
+    for (uint32_t cy = 0; cy < g_block.rows; cy++) {
+        const BlockSpan *rows = &g_block.row_spans[(size_t)cy * 4U];
+        BlockCell *cells = &g_block.cells[(size_t)cy * g_block.cols];
+        for (uint32_t cx = 0; cx < g_block.cols; cx++) {
+            const BlockSpan *cols = &g_block.column_spans[(size_t)cx * 2U];
+            if (g_block.mode == BLOCK_ENCODER_HALF_TRUECOLOR) {
+                cells[cx].top = average_block(framebuffer, stride, rows, cols);
+                cells[cx].bottom = average_block(framebuffer, stride, rows + 2, cols);
+                continue;
+            }
+
+            uint32_t bits = 0;
+            for (int quadrant = 0; quadrant < 4; quadrant++) {
+                const BlockSpan *quadrant_rows = rows + ((quadrant >> 1) * 2);
+                const uint32_t luma =
+                    average_luma(framebuffer, stride, quadrant_rows, cols[quadrant & 1]);
+                if (luma >= BLOCK_QUADRANT_THRESHOLD) {
+                    bits |= 1U << quadrant;
+                }
+            }
+            cells[cx].top = bits;
+            cells[cx].bottom = 0;
+        }
+    }
+}
+
+static void emit_cell(const BlockCell *cell, uint32_t *current_fg, uint32_t *current_bg) {
+    if (g_block.mode == BLOCK_ENCODER_QUADRANT_MONO) {
+        const char *glyph = QUADRANT_GLYPHS[cell->top & 15U];
+        put_bytes(glyph, strlen(glyph));
+        return;
+    }
+
+    // A cell with matching halves is a space on the background, which leaves the
+    // foreground alone and saves a colour change. Quadrant cells use an empty mask.
+    const bool quadrants = g_block.mode == BLOCK_ENCODER_QUADRANT_TRUECOLOR;
+    const uint32_t mask = cell->top >> 24;
+    const bool solid = quadrants ? mask == 0 : cell->top == cell->bottom;
+    const uint32_t fg = cell->top & 0xFFFFFFU;
+    const bool fg_changed = !solid && fg != *current_fg;
+    const bool bg_changed = cell->bottom != *current_bg;
+    if (fg_changed || bg_changed) {
+        put_bytes("\x1b[", 2);
+        if (fg_changed) {
+            put_bytes("38;2", 4);
+            put_rgb(fg);
+            *current_fg = fg;
+        }
+        if (bg_changed) {
+            if (fg_changed) {
+                put_bytes(";", 1);
+            }
+            put_bytes("48;2", 4);
+            put_rgb(cell->bottom);
+            *current_bg = cell->bottom;
+        }
+        put_bytes("m", 1);
+    }
+    if (solid) {
+        put_bytes(" ", 1);
+    } else if (quadrants) {
+        const char *glyph = QUADRANT_GLYPHS[mask & 15U];
+        put_bytes(glyph, strlen(glyph));
+    } else {
+        put_bytes("▀", 3);
+    }
+}
+
+// Worst case per cell: two full truecolor SGRs plus a glyph.
+#define BLOCK_CELL_MAX_BYTES 48U
+
+static bool emit_frame(void) {
+    if (!output_reserve(((size_t)g_block.cols * g_block.rows * BLOCK_CELL_MAX_BYTES) +
+                        ((size_t)g_block.rows * 16U) + 16U)) {
+        return false;
+    }
+
+    uint32_t current_fg = BLOCK_COLOR_UNSET;
+    uint32_t current_bg = BLOCK_COLOR_UNSET;
+    for (uint32_t y = 0; y < g_block.rows; y++) {
+        const BlockCell *row = &g_block.cells[(size_t)y * g_block.cols];
+        BlockCell *previous = &g_block.previous[(size_t)y * g_block.cols];
+        int64_t cursor_x = -1;
+        for (uint32_t x = 0; x < g_block.cols; x++) {
+            if (g_block.previous_valid && row[x].top == previous[x].top &&
+                row[x].bottom == previous[x].bottom) {
+                continue;
+            }
+
+            if (cursor_x >= 0 && (int64_t)x - cursor_x <= BLOCK_DIFF_MAX_GAP) {
+                for (; cursor_x < (int64_t)x; cursor_x++) {
+                    emit_cell(&row[cursor_x], &current_fg, &current_bg);
+                }
+            } else {
+                put_bytes("\x1b[", 2);
+                put_uint(y + 1U);
+                put_bytes(";", 1);
+                put_uint(x + 1U);
+                put_bytes("H", 1);
+            }
+            emit_cell(&row[x], &current_fg, &current_bg);
+            previous[x] = row[x];
+            cursor_x = (int64_t)x + 1;
+        }
+    }
+    if (current_fg != BLOCK_COLOR_UNSET || current_bg != BLOCK_COLOR_UNSET) {
+        put_bytes("\x1b[0m", 4);
+    }
+    g_block.previous_valid = true;
+    return true;
+}
+
+const char *block_encode(const BlockEncoderMode mode, const uint8_t *framebuffer,
+                         const uint32_t width, const uint32_t height, size_t *out_length) {
+    *out_length = 0;
+    if (width == 0 || height == 0 || mode == BLOCK_ENCODER_QUADRANT_TRUECOLOR) {
+        return NULL;
+    }
+    init_tables();
+    if (!ensure_geometry(mode, width, height)) {
+        return NULL;
+    }
+
+    sample_cells(framebuffer);
+    g_block.output_size = 0;
+    if (!emit_frame()) {
+        return NULL;
+    }
+    *out_length = g_block.output_size;
+    return g_block.output;
+}
+
+const char *block_encode_cells(const BlockEncoderMode mode, const uint8_t *cells,
+                               const uint32_t cols, const uint32_t rows, size_t *out_length) {
+    *out_length = 0;
+    if (cols == 0 || rows == 0) {
+        return NULL;
+    }
+    init_tables();
+    if (!g_block.cells || g_block.mode != mode || g_block.source_width != 0 ||
+        g_block.cols != cols || g_block.rows != rows) {
+        if (!resize_cells(cols, rows)) {
+            return NULL;
+        }
+        // A zero source size marks the geometry as cell input for the pixel path.
+        g_block.mode = mode;
+        g_block.source_width = 0;
+        g_block.source_height = 0;
+        g_block.cols = cols;
+        g_block.rows = rows;
+        g_block.previous_valid = false;
+    }
+
+    memcpy(g_block.cells, cells, (size_t)cols * rows * sizeof(BlockCell));
+    g_block.output_size = 0;
+    if (!emit_frame()) {
+        return NULL;
+    }
+    *out_length = g_block.output_size;
+    return g_block.output;
+}
+
+static void render_blocks(const BlockEncoderMode mode, const uint8_t *framebuffer,
+                          const uint32_t width, const uint32_t height) {
+    size_t length = 0;
+    const char *output = block_encode(mode, framebuffer, width, height, &length);
+    if (output && length > 0) {
+        terminal_write_borrowed(output, length);
+    }
+}
+
+void render_half_blocks(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
+                        const bool use_hash_characters) {
+    (void)use_hash_characters;
+    render_blocks(BLOCK_ENCODER_HALF_TRUECOLOR, framebuffer, width, height);
+}
+
+void render_quadrant_blocks(const uint8_t *framebuffer, const uint32_t width,
+                            const uint32_t height, const bool use_hash_characters) {
+    (void)use_hash_characters;
+    render_blocks(BLOCK_ENCODER_QUADRANT_MONO, framebuffer, width, height);
+}
+
+static void render_cells(const BlockEncoderMode mode, const uint8_t *cells, const uint32_t width,
+                         const uint32_t height) {
+    const uint32_t cols = (width + SYMBOL_CELL_SOURCE_WIDTH - 1U) / SYMBOL_CELL_SOURCE_WIDTH;
+    const uint32_t rows = (height + SYMBOL_CELL_SOURCE_HEIGHT - 1U) / SYMBOL_CELL_SOURCE_HEIGHT;
+    size_t length = 0;
+    const char *output = block_encode_cells(mode, cells, cols, rows, &length);
+    if (output && length > 0) {
+        terminal_write_borrowed(output, length);
+    }
+}
+
+void render_quadrant_color_cells(const uint8_t *cells, const uint32_t width,
+                                 const uint32_t height, const bool use_hash_characters) {
+    (void)use_hash_characters;
+    render_cells(BLOCK_ENCODER_QUADRANT_TRUECOLOR, cells, width, height);
+}
+
+void render_quadrant_mono_cells(const uint8_t *cells, const uint32_t width, const uint32_t height,
+                                const bool use_hash_characters) {
+    (void)use_hash_characters;
+    render_cells(BLOCK_ENCODER_QUADRANT_MONO, cells, width, height);
+}
+
+void block_encoder_invalidate(void) {
+    g_block.previous_valid = false;
+}
+
+void block_encoder_cleanup(void) {
+    free(g_block.cells);
+    free(g_block.previous);
+    free(g_block.column_spans);
+    free(g_block.row_spans);
+    free(g_block.output);
+    memset(&g_block, 0, sizeof(g_block));
+}
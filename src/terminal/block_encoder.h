@@ -0,0 +1,36 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum BlockEncoderMode {
+    // ▀ with the top half as foreground and the bottom half as background
+    BLOCK_ENCODER_HALF_TRUECOLOR,
+    // Quadrant glyphs in the terminal's default colours, thresholded on luma
+    BLOCK_ENCODER_QUADRANT_MONO,
+    // Quadrant glyphs with truecolor foreground and background; cell input only
+    BLOCK_ENCODER_QUADRANT_TRUECOLOR,
+} BlockEncoderMode;
+
+// Encodes a frame of ceil(width / 2) x ceil(height / 4) cells, or the display size in
+// cells when it differs. Only cells that changed since the previous call are emitted.
+// The returned buffer is owned by the encoder and stays valid until the next call.
+const char *block_encode(BlockEncoderMode mode, const uint8_t *framebuffer, uint32_t width,
+                         uint32_t height, size_t *out_length);
+// Encodes a grid of precomputed cells, two 32-bit words each: for QUADRANT_TRUECOLOR the
+// foreground 0xRRGGBB with the quadrant mask in bits 24-27, then the background; for
+// QUADRANT_MONO the quadrant mask, then zero. Same diffing and ownership as block_encode.
+const char *block_encode_cells(BlockEncoderMode mode, const uint8_t *cells, uint32_t cols,
+                               uint32_t rows, size_t *out_length);
+void render_half_blocks(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                        bool use_hash_characters);
+void render_quadrant_blocks(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                            bool use_hash_characters);
+// Take cell grids from the GPU for a frame of width x height pixels.
+void render_quadrant_color_cells(const uint8_t *cells, uint32_t width, uint32_t height,
+                                 bool use_hash_characters);
+void render_quadrant_mono_cells(const uint8_t *cells, uint32_t width, uint32_t height,
+                                bool use_hash_characters);
+// Forces the next frame to be written in full.
+void block_encoder_invalidate(void);
+void block_encoder_cleanup(void);
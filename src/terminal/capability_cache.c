@@ -0,0 +1,248 @@
+#include "terminal/capability_cache.h"
+#include "platform/io.h"
+#include "platform/path.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPABILITY_LINE_LENGTH 128
+#define CAPABILITY_KEY_LENGTH 32
+// Replies are short; a longer unfinished sequence is left to the key parser
+#define CAPABILITY_REPLY_MAX_LENGTH 64
+
+// Variables that tell terminals, and versions of one terminal, apart
+static const char *const CAPABILITY_KEY_VARIABLES[] = {
+    "TERM",        "TERM_PROGRAM",    "TERM_PROGRAM_VERSION", "LC_TERMINAL", "LC_TERMINAL_VERSION",
+    "VTE_VERSION", "KONSOLE_VERSION", "XTERM_VERSION"};
+
+// Variables whose presence, not value, matters: their values name sessions and panes
+static const char *const CAPABILITY_PRESENCE_VARIABLES[] = {"TMUX", "STY", "WT_SESSION"};
+
+static uint64_t hash_bytes(uint64_t hash, const char *text, const size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// The first field of SSH_CONNECTION or SSH_CLIENT: the address of the machine the
+// terminal runs on. The port after it changes with every connection.
+static size_t ssh_client_length(const char *value) {
+    const char *space = strchr(value, ' ');
+    return space ? (size_t)(space - value) : strlen(value);
+}
+
+void capability_cache_key(const CapabilityEnvLookup lookup, char *out, const size_t out_size) {
+    // FNV-1a over name=value pairs, each closed with a separator so fields cannot run together
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < sizeof(CAPABILITY_KEY_VARIABLES) / sizeof(CAPABILITY_KEY_VARIABLES[0]);
+         i++) {
+        const char *value = lookup(CAPABILITY_KEY_VARIABLES[i]);
+        hash = hash_bytes(hash, CAPABILITY_KEY_VARIABLES[i], strlen(CAPABILITY_KEY_VARIABLES[i]));
+        hash = hash_bytes(hash, "=", 1);
+        hash = value ? hash_bytes(hash, value, strlen(value)) : hash;
+        hash = hash_bytes(hash, "\n", 1);
+    }
+    for (size_t i = 0;
+         i < sizeof(CAPABILITY_PRESENCE_VARIABLES) / sizeof(CAPABILITY_PRESENCE_VARIABLES[0]);
+         i++) {
+        const char *value = lookup(CAPABILITY_PRESENCE_VARIABLES[i]);
+        hash = hash_bytes(hash, value && value[0] ? "1" : "0", 1);
+    }
+    const char *ssh = lookup("SSH_CONNECTION");
+    if (!ssh || !ssh[0]) {
+        ssh = lookup("SSH_CLIENT");
+    }
+    hash = hash_bytes(hash, "\n", 1);
+    hash = ssh ? hash_bytes(hash, ssh, ssh_client_length(ssh)) : hash;
+    snprintf(out, out_size, "%016llx", (unsigned long long)hash);
+}
+
+static bool parse_line(const char *line, char key[CAPABILITY_KEY_LENGTH],
+                       TerminalCapabilities *caps) {
+    return sscanf(line, "%31s %d %u %u", key, &caps->pixel_mode, &caps->cell_width,
+                  &caps->cell_height) == 4;
+}
+
+static bool write_line(FILE *f, const char *key, const TerminalCapabilities *caps) {
+    return fprintf(f, "%s %d %u %u\n", key, caps->pixel_mode, caps->cell_width,
+                   caps->cell_height) > 0;
+}
+
+bool capability_cache_lookup(const char *path, const char *key, TerminalCapabilities *out) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char line[CAPABILITY_LINE_LENGTH];
+    char line_key[CAPABILITY_KEY_LENGTH];
+    TerminalCapabilities caps;
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f)) {
+        found = parse_line(line, line_key, &caps) && strcmp(line_key, key) == 0;
+    }
+    fclose(f);
+    if (found) {
+        *out = caps;
+    }
+    return found;
+}
+
+bool capability_cache_store(const char *path, const char *key, const TerminalCapabilities *caps) {
+    char temp_path[512];
+    const int len = snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", path, dcat_getpid());
+    if (len <= 0 || (size_t)len >= sizeof(temp_path)) {
+        return false;
+    }
+    FILE *out = fopen(temp_path, "w");
+    if (!out) {
+        return false;
+    }
+
+    // Other terminals' entries carry over; a malformed line is dropped
+    bool written = true;
+    FILE *in = fopen(path, "r");
+    if (in) {
+        char line[CAPABILITY_LINE_LENGTH];
+        char line_key[CAPABILITY_KEY_LENGTH];
+        TerminalCapabilities line_caps;
+        while (fgets(line, sizeof(line), in)) {
+            if (parse_line(line, line_key, &line_caps) && strcmp(line_key, key) != 0) {
+                written = write_line(out, line_key, &line_caps) && written;
+            }
+        }
+        fclose(in);
+    }
+    written = write_line(out, key, caps) && written;
+    written = (fclose(out) == 0) && written;
+
+    // Write then rename, so a concurrent dcat never reads a half-written cache
+#ifdef _WIN32
+    if (written) {
+        remove(path);
+    }
+#endif
+    if (!written || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    return true;
+}
+
+static struct {
+    bool loaded;
+    bool found;
+    bool has_path;
+    char path[512];
+    char key[CAPABILITY_KEY_LENGTH];
+    TerminalCapabilities caps;
+} g_terminal;
+
+static const char *environment_lookup(const char *name) {
+    return getenv(name);
+}
+
+static void load_once(void) {
+    if (g_terminal.loaded) {
+        return;
+    }
+    g_terminal.loaded = true;
+    g_terminal.caps = (TerminalCapabilities){.pixel_mode = -1};
+    capability_cache_key(environment_lookup, g_terminal.key, sizeof(g_terminal.key));
+    char directory[400];
+    if (!dcat_get_cache_directory(directory, sizeof(directory))) {
+        return;
+    }
+    const int len =
+        snprintf(g_terminal.path, sizeof(g_terminal.path), "%sterminals.txt", directory);
+    g_terminal.has_path = len > 0 && (size_t)len < sizeof(g_terminal.path);
+    g_terminal.found = g_terminal.has_path &&
+                       capability_cache_lookup(g_terminal.path, g_terminal.key, &g_terminal.caps);
+}
+
+bool terminal_capabilities_load(TerminalCapabilities *out) {
+    load_once();
+    *out = g_terminal.caps;
+    return g_terminal.found;
+}
+
+void terminal_capabilities_save(const TerminalCapabilities *caps) {
+    load_once();
+    g_terminal.caps = *caps;
+    g_terminal.found = true;
+    if (g_terminal.has_path) {
+        capability_cache_store(g_terminal.path, g_terminal.key, caps);
+    }
+}
+
+static atomic_bool g_reply_kitty;
+static atomic_bool g_reply_sixel;
+static atomic_bool g_reply_attributes;
+
+// APC G reply to the kitty query, which carries image id 31: "\x1b_Gi=31;OK\x1b\\"
+static ptrdiff_t parse_kitty_reply(const char *buffer, const size_t length) {
+    for (size_t i = 2; i + 1 < length && i < CAPABILITY_REPLY_MAX_LENGTH; i++) {
+        if (buffer[i] == '\x1b' && buffer[i + 1] == '\\') {
+            static const char ok[] = "Gi=31;OK";
+            if (i - 2 == sizeof(ok) - 1U && memcmp(buffer + 2, ok, sizeof(ok) - 1U) == 0) {
+                atomic_store(&g_reply_kitty, true);
+            }
+            return (ptrdiff_t)(i + 2);
+        }
+    }
+    return length < CAPABILITY_REPLY_MAX_LENGTH ? -1 : 0;
+}
+
+// Primary device attributes, "\x1b[?62;4;22c"; a 4 among them is sixel support
+static ptrdiff_t parse_device_attributes(const char *buffer, const size_t length) {
+    bool sixel = false;
+    unsigned value = 0;
+    for (size_t i = 3; i < length && i < CAPABILITY_REPLY_MAX_LENGTH; i++) {
+        const char c = buffer[i];
+        if (c >= '0' && c <= '9') {
+            value = value * 10U + (unsigned)(c - '0');
+            continue;
+        }
+        if (c != ';' && c != 'c') {
+            return 0;
+        }
+        sixel = sixel || value == 4U;
+        value = 0;
+        if (c == 'c') {
+            atomic_store(&g_reply_sixel, sixel);
+            atomic_store(&g_reply_attributes, true);
+            return (ptrdiff_t)(i + 1);
+        }
+    }
+    return length < CAPABILITY_REPLY_MAX_LENGTH ? -1 : 0;
+}
+
+ptrdiff_t capability_reply_parse(const char *buffer, const size_t length) {
+    if (length < 3 || buffer[0] != '\x1b') {
+        return 0;
+    }
+    if (buffer[1] == '_' && buffer[2] == 'G') {
+        return parse_kitty_reply(buffer, length);
+    }
+    if (buffer[1] == '[' && buffer[2] == '?') {
+        return parse_device_attributes(buffer, length);
+    }
+    return 0;
+}
+
+void capability_replies_reset(void) {
+    atomic_store(&g_reply_kitty, false);
+    atomic_store(&g_reply_sixel, false);
+    atomic_store(&g_reply_attributes, false);
+}
+
+bool capability_replies_get(bool *kitty, bool *sixel) {
+    if (!atomic_load(&g_reply_attributes)) {
+        return false;
+    }
+    *kitty = atomic_load(&g_reply_kitty);
+    *sixel = atomic_load(&g_reply_sixel);
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// What the startup probes learned about one terminal, so later runs can skip asking
+typedef struct TerminalCapabilities {
+    // ChafaPixelMode the kitty and device-attributes queries found; -1 when never asked
+    int pixel_mode;
+    // Pixels per cell from the text-area-size query (Windows); 0 when never asked
+    uint32_t cell_width;
+    uint32_t cell_height;
+} TerminalCapabilities;
+
+typedef const char *(*CapabilityEnvLookup)(const char *name);
+
+// Names the terminal from the environment: TERM, TERM_PROGRAM and the version variables
+// terminals export, any multiplexer in between, and the machine an SSH session comes from.
+// The SSH client port is left out, so every connection from one machine shares an entry.
+void capability_cache_key(CapabilityEnvLookup lookup, char *out, size_t out_size);
+
+// The entry for `key` in the cache file at `path`, a text file of one line per terminal
+bool capability_cache_lookup(const char *path, const char *key, TerminalCapabilities *out);
+
+// Records `caps` for `key` at `path`, replacing its old entry and keeping the others
+bool capability_cache_store(const char *path, const char *key, const TerminalCapabilities *caps);
+
+// This terminal's entry in the cache directory, read once per run. On a miss `out` holds the
+// "never asked" values and false is returned.
+bool terminal_capabilities_load(TerminalCapabilities *out);
+
+// Replaces this terminal's entry; the next load in this run sees it too
+void terminal_capabilities_save(const TerminalCapabilities *caps);
+
+// Background re-validation: when the probe was skipped, it is sent again once the input
+// thread runs, which hands the replies here instead of reading them as keys.
+// Length of the probe reply `buffer` starts with (at an ESC): the kitty graphics reply or
+// primary device attributes. 0 when it is something else, -1 when it is cut short.
+ptrdiff_t capability_reply_parse(const char *buffer, size_t length);
+
+// Forgets the replies seen so far, before the probe is sent again
+void capability_replies_reset(void);
+
+// What the replies since the reset said; false until the device attributes, which every
+// terminal answers and which come after the kitty reply, arrived
+bool capability_replies_get(bool *kitty, bool *sixel);
@@ -0,0 +1,109 @@
+#include "terminal/chafa_cell_diff.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Unchanged cells between two changed ones are rewritten rather than skipped with a
+// cursor move when the gap is at most this wide; a CUP sequence costs ~8 bytes.
+#define CELL_DIFF_MAX_GAP 4
+#define CELL_COLOR_UNSET (-2)
+
+bool chafa_cell_grid_resize(ChafaCellGrid *grid, const int width, const int height) {
+    const size_t count = (size_t)width * (size_t)height;
+    if (count > (size_t)grid->width * (size_t)grid->height || !grid->cells) {
+        ChafaCell *cells = realloc(grid->cells, (count > 0 ? count : 1) * sizeof(ChafaCell));
+        if (!cells) {
+            return false;
+        }
+        grid->cells = cells;
+    }
+    grid->width = width;
+    grid->height = height;
+    return true;
+}
+
+void chafa_cell_grid_free(ChafaCellGrid *grid) {
+    free(grid->cells);
+    memset(grid, 0, sizeof(*grid));
+}
+
+static void append_color(GString *out, const gint color, const bool background,
+                         const ChafaCanvasMode canvas_mode) {
+    if (color < 0) {
+        g_string_append(out, background ? "49" : "39");
+        return;
+    }
+
+    switch (canvas_mode) {
+    case CHAFA_CANVAS_MODE_TRUECOLOR:
+        g_string_append_printf(out, "%d;2;%d;%d;%d", background ? 48 : 38, (color >> 16) & 0xff,
+                               (color >> 8) & 0xff, color & 0xff);
+        break;
+    case CHAFA_CANVAS_MODE_INDEXED_16:
+    case CHAFA_CANVAS_MODE_INDEXED_16_8:
+    case CHAFA_CANVAS_MODE_INDEXED_8:
+        if (color < 8) {
+            g_string_append_printf(out, "%d", (background ? 40 : 30) + color);
+        } else {
+            g_string_append_printf(out, "%d", (background ? 100 : 90) + (color & 7));
+        }
+        break;
+    default:
+        g_string_append_printf(out, "%d;5;%d", background ? 48 : 38, color);
+        break;
+    }
+}
+
+static void append_cell(GString *out, const ChafaCell *cell, const ChafaCanvasMode canvas_mode,
+                        gint *current_fg, gint *current_bg) {
+    if (canvas_mode != CHAFA_CANVAS_MODE_FGBG &&
+        (cell->fg != *current_fg || cell->bg != *current_bg)) {
+        g_string_append(out, "\x1b[");
+        if (cell->fg != *current_fg) {
+            append_color(out, cell->fg, false, canvas_mode);
+            if (cell->bg != *current_bg) {
+                g_string_append_c(out, ';');
+            }
+        }
+        if (cell->bg != *current_bg) {
+            append_color(out, cell->bg, true, canvas_mode);
+        }
+        g_string_append_c(out, 'm');
+        *current_fg = cell->fg;
+        *current_bg = cell->bg;
+    }
+    g_string_append_unichar(out, cell->symbol);
+}
+
+bool chafa_cell_diff(GString *out, ChafaCellGrid *screen, const ChafaCellGrid *frame,
+                     const ChafaCanvasMode canvas_mode) {
+    if (screen->width != frame->width || screen->height != frame->height) {
+        return false;
+    }
+    gint current_fg = CELL_COLOR_UNSET;
+    gint current_bg = CELL_COLOR_UNSET;
+
+    for (int y = 0; y < frame->height; y++) {
+        ChafaCell *row = &screen->cells[(size_t)y * (size_t)screen->width];
+        const ChafaCell *next = &frame->cells[(size_t)y * (size_t)frame->width];
+        int cursor_x = -1;
+        for (int x = 0; x < frame->width; x++) {
+            const ChafaCell *cell = &next[x];
+            if (cell->symbol == row[x].symbol && cell->fg == row[x].fg && cell->bg == row[x].bg) {
+                continue;
+            }
+
+            if (cursor_x >= 0 && x - cursor_x <= CELL_DIFF_MAX_GAP) {
+                for (; cursor_x < x; cursor_x++) {
+                    append_cell(out, &row[cursor_x], canvas_mode, &current_fg, &current_bg);
+                }
+            } else {
+                g_string_append_printf(out, "\x1b[%d;%dH", y + 1, x + 1);
+            }
+            append_cell(out, cell, canvas_mode, &current_fg, &current_bg);
+            row[x] = *cell;
+            cursor_x = x + 1;
+        }
+    }
+    return true;
+}
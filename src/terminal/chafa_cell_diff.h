@@ -0,0 +1,30 @@
+#pragma once
+#include <chafa.h>
+#include <stdbool.h>
+
+// A symbol cell as written to the terminal
+typedef struct ChafaCell {
+    gunichar symbol;
+    gint fg;
+    gint bg;
+} ChafaCell;
+
+// Cells of a symbol canvas, row by row
+typedef struct ChafaCellGrid {
+    ChafaCell *cells;
+    int width;
+    int height;
+} ChafaCellGrid;
+
+// Sizes `grid` for width x height cells, keeping its memory when it is large enough.
+// Returns false when out of memory.
+bool chafa_cell_grid_resize(ChafaCellGrid *grid, int width, int height);
+void chafa_cell_grid_free(ChafaCellGrid *grid);
+
+// Appends to `out` what turns `screen`, the cells last written to the terminal, into
+// `frame`: each run of changed cells positioned with CUP, unchanged gaps of a few cells
+// rewritten rather than skipped, and SGR only where the colors change, written for
+// `canvas_mode`. `screen` then holds `frame`. Returns false, appending nothing, when the
+// grids differ in size, as after a resize; the frame then has to be printed whole.
+bool chafa_cell_diff(GString *out, ChafaCellGrid *screen, const ChafaCellGrid *frame,
+                     ChafaCanvasMode canvas_mode);
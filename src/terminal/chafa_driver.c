@@ -1,20 +1,60 @@
 #include "terminal/chafa_driver.h"
+#include "core/worker_pool.h"
+#include "terminal/capability_cache.h"
+#include "terminal/chafa_cell_diff.h"
 #include "terminal/terminal.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+// Symbol canvases are split into horizontal bands that are encoded in parallel; a
+// band narrower than this is not worth a thread handoff.
+#define CHAFA_MAX_BANDS 16
+#define CHAFA_MIN_BAND_ROWS 6
+
 typedef struct {
-    ChafaTermInfo *term_info;
     ChafaCanvas *canvas;
+    int first_row;
+    int rows;
+    GString *output;
+} ChafaBand;
+
+typedef struct {
+    ChafaTermInfo *term_info;
+    ChafaBand bands[CHAFA_MAX_BANDS];
+    uint32_t band_count;
+    int band_rows;
+    WorkerPool pool;
+    bool pool_started;
+    // Source frame for the band tasks of the frame being encoded
+    const uint8_t *band_source;
     ChafaPixelMode detected_pixel_mode;
     ChafaCanvasMode detected_canvas_mode;
     ChafaPixelMode pixel_mode;
+    // The canvas mode frames are encoded with, which reduced quality may lower from the
+    // configured one
     ChafaCanvasMode canvas_mode;
+    ChafaCanvasMode configured_canvas_mode;
+    OutputQuality quality;
     uint32_t source_width;
     uint32_t source_height;
+    uint32_t display_width;
+    uint32_t display_height;
+    int canvas_width;
+    int canvas_height;
+    // Cells as last written to the terminal, for incremental symbol output, and those of
+    // the frame being encoded
+    ChafaCellGrid screen;
+    ChafaCellGrid frame;
+    // Encoded frame, reused across frames so it can be queued without a copy
+    GString *frame_output;
+    bool cells_valid;
     bool use_hash_characters;
     bool initialized;
     bool sixel_scrolling_disabled;
+    // The pixel mode came from the capability cache; revalidation_sent once asked again
+    bool revalidate;
+    bool revalidation_sent;
 } ChafaDriverState;
 
 static ChafaDriverState g_state;
@@ -46,29 +86,63 @@ ChafaPixelMode chafa_driver_pixel_mode_from_response(const char *response) {
     return pixel_mode;
 }
 
-static ChafaPixelMode probe_pixel_mode(ChafaTermInfo *term_info) {
-    if (!dcat_isatty(STDIN_FILENO) || !dcat_isatty(STDOUT_FILENO)) {
-        return CHAFA_PIXEL_MODE_SYMBOLS;
+static const char KITTY_GRAPHICS_QUERY[] = "\x1b_Gi=31,s=1,v=1,a=q,t=d,f=24;AAAA\x1b\\";
+#define PIXEL_MODE_QUERY_LENGTH (sizeof(KITTY_GRAPHICS_QUERY) - 1U + CHAFA_TERM_SEQ_LENGTH_MAX)
+
+// The kitty graphics query, then primary device attributes, which every terminal answers.
+// `query` holds PIXEL_MODE_QUERY_LENGTH bytes.
+static size_t emit_pixel_mode_query(ChafaTermInfo *term_info, char *query) {
+    memcpy(query, KITTY_GRAPHICS_QUERY, sizeof(KITTY_GRAPHICS_QUERY) - 1U);
+    const char *query_end = chafa_term_info_emit_query_primary_device_attributes(
+        term_info, query + sizeof(KITTY_GRAPHICS_QUERY) - 1U);
+    return (size_t)(query_end - query);
+}
+
+static bool is_interactive(void) {
+    return dcat_isatty(STDIN_FILENO) && dcat_isatty(STDOUT_FILENO);
+}
+
+// Asks the terminal for kitty graphics and sixel support, waiting for the reply. False when
+// it could not be asked.
+static bool probe_pixel_mode(ChafaTermInfo *term_info, ChafaPixelMode *out) {
+    if (!is_interactive()) {
+        return false;
     }
 
     TermiosState state;
     if (!terminal_begin_query_mode(&state)) {
-        return CHAFA_PIXEL_MODE_SYMBOLS;
+        return false;
     }
-    static const char kitty_query[] = "\x1b_Gi=31,s=1,v=1,a=q,t=d,f=24;AAAA\x1b\\";
-    char query[sizeof(kitty_query) - 1U + CHAFA_TERM_SEQ_LENGTH_MAX];
-    memcpy(query, kitty_query, sizeof(kitty_query) - 1U);
-    const char *query_end = chafa_term_info_emit_query_primary_device_attributes(
-        term_info, query + sizeof(kitty_query) - 1U);
-    safe_write(query, (size_t)(query_end - query));
+    char query[PIXEL_MODE_QUERY_LENGTH];
+    safe_write(query, emit_pixel_mode_query(term_info, query));
     char response[256];
     const ssize_t length = terminal_read_query(response, sizeof(response) - 1U, 0);
     terminal_end_query_mode(&state);
-    if (length <= 0) {
-        return CHAFA_PIXEL_MODE_SYMBOLS;
+    // No reply is an answer too: the next run does not wait for it again
+    *out = CHAFA_PIXEL_MODE_SYMBOLS;
+    if (length > 0) {
+        response[length] = '\0';
+        *out = pixel_mode_from_response(term_info, response, (size_t)length);
+    }
+    return true;
+}
+
+// Terminals that do not advertise a pixel protocol are asked once, and the answer kept for
+// later runs; a run that reuses it asks again in the background (see
+// chafa_driver_revalidate).
+static ChafaPixelMode undetected_pixel_mode(ChafaTermInfo *term_info) {
+    TerminalCapabilities caps;
+    if (terminal_capabilities_load(&caps) && caps.pixel_mode >= 0 &&
+        caps.pixel_mode < (int)CHAFA_PIXEL_MODE_MAX) {
+        g_state.revalidate = true;
+        return (ChafaPixelMode)caps.pixel_mode;
+    }
+    ChafaPixelMode pixel_mode = CHAFA_PIXEL_MODE_SYMBOLS;
+    if (probe_pixel_mode(term_info, &pixel_mode)) {
+        caps.pixel_mode = (int)pixel_mode;
+        terminal_capabilities_save(&caps);
     }
-    response[length] = '\0';
-    return pixel_mode_from_response(term_info, response, (size_t)length);
+    return pixel_mode;
 }
 
 static void initialize(void) {
@@ -88,11 +162,12 @@ static void initialize(void) {
     chafa_term_info_unref(fallback);
 
     if (g_state.detected_pixel_mode == CHAFA_PIXEL_MODE_SYMBOLS) {
-        g_state.detected_pixel_mode = probe_pixel_mode(g_state.term_info);
+        g_state.detected_pixel_mode = undetected_pixel_mode(g_state.term_info);
     }
 
     g_state.pixel_mode = g_state.detected_pixel_mode;
     g_state.canvas_mode = g_state.detected_canvas_mode;
+    g_state.configured_canvas_mode = g_state.detected_canvas_mode;
     g_state.initialized = true;
 }
 
@@ -102,18 +177,58 @@ void chafa_driver_detect(ChafaPixelMode *pixel_mode, ChafaCanvasMode *canvas_mod
     *canvas_mode = g_state.detected_canvas_mode;
 }
 
-void chafa_driver_configure(const ChafaPixelMode pixel_mode, const ChafaCanvasMode canvas_mode) {
-    initialize();
+static void release_canvases(void) {
+    for (uint32_t i = 0; i < g_state.band_count; i++) {
+        chafa_canvas_unref(g_state.bands[i].canvas);
+    }
+    memset(g_state.bands, 0, sizeof(g_state.bands));
+    g_state.band_count = 0;
+}
+
+static void set_modes(const ChafaPixelMode pixel_mode, const ChafaCanvasMode canvas_mode) {
     if (g_state.pixel_mode != pixel_mode || g_state.canvas_mode != canvas_mode) {
-        if (g_state.canvas) {
-            chafa_canvas_unref(g_state.canvas);
-            g_state.canvas = NULL;
-        }
+        release_canvases();
+        g_state.cells_valid = false;
         g_state.pixel_mode = pixel_mode;
         g_state.canvas_mode = canvas_mode;
     }
 }
 
+// Truecolor drops to the 240-color palette once quality is reduced: an indexed color is
+// about half the bytes, and quantized colors change less often between frames.
+static ChafaCanvasMode encoded_canvas_mode(const ChafaCanvasMode canvas_mode,
+                                           const OutputQuality quality) {
+    if (quality >= OUTPUT_QUALITY_REDUCED_COLORS && canvas_mode == CHAFA_CANVAS_MODE_TRUECOLOR) {
+        return CHAFA_CANVAS_MODE_INDEXED_240;
+    }
+    return canvas_mode;
+}
+
+void chafa_driver_configure(const ChafaPixelMode pixel_mode, const ChafaCanvasMode canvas_mode) {
+    initialize();
+    g_state.configured_canvas_mode = canvas_mode;
+    set_modes(pixel_mode, encoded_canvas_mode(canvas_mode, g_state.quality));
+}
+
+void chafa_driver_set_quality(const OutputQuality quality) {
+    initialize();
+    if (quality == g_state.quality) {
+        return;
+    }
+    if ((quality >= OUTPUT_QUALITY_COARSE) != (g_state.quality >= OUTPUT_QUALITY_COARSE)) {
+        release_canvases();
+        g_state.cells_valid = false;
+    }
+    g_state.quality = quality;
+    set_modes(g_state.pixel_mode, encoded_canvas_mode(g_state.configured_canvas_mode, quality));
+}
+
+bool chafa_driver_needs_passthrough(void) {
+    initialize();
+    return chafa_term_info_get_is_pixel_passthrough_needed(g_state.term_info,
+                                                           g_state.pixel_mode) != 0;
+}
+
 ChafaDitherMode chafa_driver_dither_mode(const ChafaPixelMode pixel_mode,
                                          const ChafaCanvasMode canvas_mode) {
     if (pixel_mode == CHAFA_PIXEL_MODE_SIXELS) {
@@ -131,8 +246,43 @@ ChafaDitherMode chafa_driver_dither_mode(const ChafaPixelMode pixel_mode,
     }
 }
 
-static ChafaCanvas *create_canvas(const uint32_t width, const uint32_t height,
-                                  const bool use_hash_characters) {
+static uint32_t choose_band_count(const int canvas_height) {
+    if (g_state.pixel_mode != CHAFA_PIXEL_MODE_SYMBOLS) {
+        return 1;
+    }
+    uint32_t count = dcat_cpu_count();
+    if (count > CHAFA_MAX_BANDS) {
+        count = CHAFA_MAX_BANDS;
+    }
+    const uint32_t by_rows = (uint32_t)(canvas_height / CHAFA_MIN_BAND_ROWS);
+    if (count > by_rows) {
+        count = by_rows;
+    }
+    return count > 0 ? count : 1;
+}
+
+static bool ensure_pool(const uint32_t band_count) {
+    // The calling thread encodes one band itself.
+    const uint32_t threads = band_count - 1U;
+    if (g_state.pool_started && g_state.pool.thread_count >= threads) {
+        return true;
+    }
+    if (g_state.pool_started) {
+        worker_pool_destroy(&g_state.pool);
+        g_state.pool_started = false;
+    }
+    if (!worker_pool_init(&g_state.pool, threads)) {
+        return false;
+    }
+    g_state.pool_started = true;
+    return true;
+}
+
+// width and height are the display area; the source frame may be smaller and is
+// resampled by chafa to fill the canvas. Symbol canvases are split into bands of
+// whole cell rows that share one configuration.
+static bool create_canvases(const uint32_t width, const uint32_t height,
+                            const bool use_hash_characters) {
     ChafaCanvasConfig *config = chafa_canvas_config_new();
 
     int canvas_width;
@@ -149,10 +299,14 @@ static ChafaCanvas *create_canvas(const uint32_t width, const uint32_t height,
                 (int)((width + SYMBOL_CELL_SOURCE_WIDTH - 1U) / SYMBOL_CELL_SOURCE_WIDTH);
             canvas_height =
                 (int)((height + SYMBOL_CELL_SOURCE_HEIGHT - 1U) / SYMBOL_CELL_SOURCE_HEIGHT);
+            ChafaSymbolTags graphics = CHAFA_SYMBOL_TAG_SPACE | CHAFA_SYMBOL_TAG_BLOCK |
+                                       CHAFA_SYMBOL_TAG_BORDER | CHAFA_SYMBOL_TAG_BRAILLE;
+            if (g_state.quality >= OUTPUT_QUALITY_COARSE) {
+                // Fewer shapes leave more cells unchanged for the cell diff to skip
+                graphics = CHAFA_SYMBOL_TAG_SPACE | CHAFA_SYMBOL_TAG_HALF;
+            }
             const ChafaSymbolTags safe_graphics =
-                chafa_term_info_get_safe_symbol_tags(g_state.term_info) &
-                (CHAFA_SYMBOL_TAG_SPACE | CHAFA_SYMBOL_TAG_BLOCK | CHAFA_SYMBOL_TAG_BORDER |
-                 CHAFA_SYMBOL_TAG_BRAILLE);
+                chafa_term_info_get_safe_symbol_tags(g_state.term_info) & graphics;
             chafa_symbol_map_add_by_tags(symbols, CHAFA_SYMBOL_TAG_SPACE | CHAFA_SYMBOL_TAG_SOLID |
                                                       safe_graphics);
             chafa_symbol_map_remove_by_tags(symbols, CHAFA_SYMBOL_TAG_WIDE);
@@ -182,7 +336,8 @@ static ChafaCanvas *create_canvas(const uint32_t width, const uint32_t height,
         }
     }
 
-    chafa_canvas_config_set_geometry(config, canvas_width, canvas_height);
+    g_state.canvas_width = canvas_width;
+    g_state.canvas_height = canvas_height;
     chafa_canvas_config_set_pixel_mode(config, g_state.pixel_mode);
     chafa_canvas_config_set_canvas_mode(config, g_state.canvas_mode);
     chafa_canvas_config_set_dither_mode(
@@ -192,28 +347,141 @@ static ChafaCanvas *create_canvas(const uint32_t width, const uint32_t height,
     }
     chafa_canvas_config_set_transparency_threshold(config, 1.0F);
 
-    ChafaCanvas *canvas = chafa_canvas_new(config);
+    uint32_t band_count = choose_band_count(canvas_height);
+    if (band_count > 1 && !ensure_pool(band_count)) {
+        band_count = 1;
+    }
+    // Bands already spread the work over the cores; chafa's own threads would only
+    // oversubscribe them.
+    chafa_set_n_threads(band_count > 1 ? 1 : -1);
+
+    const int band_rows = (canvas_height + (int)band_count - 1) / (int)band_count;
+    bool ok = true;
+    for (uint32_t i = 0; i < band_count; i++) {
+        ChafaBand *band = &g_state.bands[i];
+        band->first_row = (int)i * band_rows;
+        band->rows = canvas_height - band->first_row < band_rows ? canvas_height - band->first_row
+                                                                : band_rows;
+        chafa_canvas_config_set_geometry(config, canvas_width, band->rows);
+        band->canvas = chafa_canvas_new(config);
+        g_state.band_count = i + 1U;
+        if (!band->canvas) {
+            ok = false;
+            break;
+        }
+    }
+    g_state.band_rows = band_rows;
     chafa_canvas_config_unref(config);
-    return canvas;
+    if (!ok) {
+        release_canvases();
+    }
+    return ok;
 }
 
-static GString *build_frame(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
-                            const bool use_hash_characters) {
+static bool supports_incremental_output(void) {
+    // FGBG_BGFG encodes cells with reverse video, which the raw colors do not expose.
+    return g_state.pixel_mode == CHAFA_PIXEL_MODE_SYMBOLS &&
+           g_state.canvas_mode != CHAFA_CANVAS_MODE_FGBG_BGFG;
+}
+
+static void read_cell(const int x, const int y, ChafaCell *cell) {
+    const ChafaBand *band = &g_state.bands[y / g_state.band_rows];
+    const int band_y = y - band->first_row;
+    cell->symbol = chafa_canvas_get_char_at(band->canvas, x, band_y);
+    chafa_canvas_get_raw_colors_at(band->canvas, x, band_y, &cell->fg, &cell->bg);
+}
+
+static bool snapshot_cells(ChafaCellGrid *grid) {
+    if (!chafa_cell_grid_resize(grid, g_state.canvas_width, g_state.canvas_height)) {
+        return false;
+    }
+    for (int y = 0; y < g_state.canvas_height; y++) {
+        for (int x = 0; x < g_state.canvas_width; x++) {
+            read_cell(x, y, &grid->cells[((size_t)y * (size_t)g_state.canvas_width) + x]);
+        }
+    }
+    return true;
+}
+
+// Band rows map onto source rows proportionally, which is exact whenever the source
+// is rendered at the display size.
+static void draw_band_task(void *context, const uint32_t index) {
+    const bool print = *(const bool *)context;
+    ChafaBand *band = &g_state.bands[index];
+    const uint32_t source_y =
+        (uint32_t)(((uint64_t)band->first_row * g_state.source_height) / g_state.canvas_height);
+    const uint32_t source_end = (uint32_t)(((uint64_t)(band->first_row + band->rows) *
+                                            g_state.source_height) /
+                                           g_state.canvas_height);
+    const size_t stride = (size_t)g_state.source_width * 4U;
+    chafa_canvas_draw_all_pixels(band->canvas, CHAFA_PIXEL_RGBA8_UNASSOCIATED,
+                                 g_state.band_source + ((size_t)source_y * stride),
+                                 (int)g_state.source_width, (int)(source_end - source_y),
+                                 (int)stride);
+    if (print) {
+        band->output = chafa_canvas_print(band->canvas, g_state.term_info);
+    }
+}
+
+static void stitch_bands(GString *out) {
+    for (uint32_t i = 0; i < g_state.band_count; i++) {
+        ChafaBand *band = &g_state.bands[i];
+        if (i > 0) {
+            g_string_append_printf(out, "\x1b[0m\x1b[%d;1H", band->first_row + 1);
+        }
+        if (band->output) {
+            g_string_append_len(out, band->output->str, (gssize)band->output->len);
+            g_string_free(band->output, true);
+            band->output = NULL;
+        }
+    }
+}
+
+static bool build_frame(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
+                        const bool use_hash_characters, GString *out) {
     initialize();
-    if (!g_state.canvas || g_state.source_width != width || g_state.source_height != height ||
+    uint32_t display_width;
+    uint32_t display_height;
+    terminal_get_display_size(width, height, &display_width, &display_height);
+    if (g_state.band_count == 0 || g_state.source_width != width ||
+        g_state.source_height != height || g_state.display_width != display_width ||
+        g_state.display_height != display_height ||
         g_state.use_hash_characters != use_hash_characters) {
-        if (g_state.canvas) {
-            chafa_canvas_unref(g_state.canvas);
+        release_canvases();
+        g_state.cells_valid = false;
+        if (!create_canvases(display_width, display_height, use_hash_characters)) {
+            return false;
         }
-        g_state.canvas = create_canvas(width, height, use_hash_characters);
         g_state.source_width = width;
         g_state.source_height = height;
+        g_state.display_width = display_width;
+        g_state.display_height = display_height;
         g_state.use_hash_characters = use_hash_characters;
     }
 
-    chafa_canvas_draw_all_pixels(g_state.canvas, CHAFA_PIXEL_RGBA8_UNASSOCIATED, framebuffer,
-                                 (int)width, (int)height, (int)(width * 4U));
-    return chafa_canvas_print(g_state.canvas, g_state.term_info);
+    const bool incremental = supports_incremental_output() && g_state.cells_valid;
+    // Full frames are printed inside the band tasks too; diffs read cells afterwards.
+    bool print_bands = !incremental;
+    g_state.band_source = framebuffer;
+    worker_pool_run(&g_state.pool, g_state.band_count, draw_band_task, &print_bands);
+    g_state.band_source = NULL;
+
+    // Emits only the cells that differ from the last frame written to the terminal
+    if (incremental && snapshot_cells(&g_state.frame) &&
+        chafa_cell_diff(out, &g_state.screen, &g_state.frame, g_state.canvas_mode)) {
+        return true;
+    }
+    if (incremental) {
+        // No memory for the frame's cells: print it whole after all
+        for (uint32_t i = 0; i < g_state.band_count; i++) {
+            g_state.bands[i].output =
+                chafa_canvas_print(g_state.bands[i].canvas, g_state.term_info);
+        }
+    }
+    g_state.cells_valid = supports_incremental_output() && snapshot_cells(&g_state.screen);
+    g_string_append(out, "\x1b[H");
+    stitch_bands(out);
+    return true;
 }
 
 void chafa_driver_render(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
@@ -223,28 +491,69 @@ void chafa_driver_render(const uint8_t *framebuffer, const uint32_t width, const
         safe_write("\x1b[?80h", 6);
         g_state.sixel_scrolling_disabled = true;
     }
-    GString *output = build_frame(framebuffer, width, height, use_hash_characters);
-    if (!output) {
+    if (!g_state.frame_output) {
+        g_state.frame_output = g_string_sized_new(4096);
+    }
+    GString *output = g_string_truncate(g_state.frame_output, 0);
+    if (!build_frame(framebuffer, width, height, use_hash_characters, output)) {
         return;
     }
-
-    safe_write("\x1b[H", 3);
-    safe_write(output->str, output->len);
     if (g_state.pixel_mode == CHAFA_PIXEL_MODE_SYMBOLS) {
-        safe_write("\x1b[0m", 4);
+        g_string_append(output, "\x1b[0m");
+    }
+    // frame_output lives until the next frame, so it can be queued without a copy
+    terminal_write_borrowed(output->str, output->len);
+}
+
+void chafa_driver_invalidate(void) {
+    g_state.cells_valid = false;
+}
+
+void chafa_driver_revalidate(void) {
+    if (!g_state.revalidate || g_state.revalidation_sent || !is_interactive()) {
+        return;
+    }
+    capability_replies_reset();
+    char query[PIXEL_MODE_QUERY_LENGTH];
+    safe_write(query, emit_pixel_mode_query(g_state.term_info, query));
+    g_state.revalidation_sent = true;
+}
+
+// Keeps what the background query found for the next run. Without the device attributes
+// reply the terminal was slow or silent, which proves nothing, so the entry stays.
+static void finish_revalidation(void) {
+    bool kitty = false;
+    bool sixel = false;
+    if (!g_state.revalidation_sent || !capability_replies_get(&kitty, &sixel)) {
+        return;
+    }
+    const ChafaPixelMode pixel_mode = kitty   ? CHAFA_PIXEL_MODE_KITTY
+                                      : sixel ? CHAFA_PIXEL_MODE_SIXELS
+                                              : CHAFA_PIXEL_MODE_SYMBOLS;
+    TerminalCapabilities caps;
+    terminal_capabilities_load(&caps);
+    if (caps.pixel_mode != (int)pixel_mode) {
+        caps.pixel_mode = (int)pixel_mode;
+        terminal_capabilities_save(&caps);
     }
-    g_string_free(output, true);
 }
 
 void chafa_driver_cleanup(void) {
+    finish_revalidation();
     if (g_state.sixel_scrolling_disabled) {
         safe_write("\x1b[?80l", 6);
     }
-    if (g_state.canvas) {
-        chafa_canvas_unref(g_state.canvas);
+    release_canvases();
+    if (g_state.pool_started) {
+        worker_pool_destroy(&g_state.pool);
     }
     if (g_state.term_info) {
         chafa_term_info_unref(g_state.term_info);
     }
+    chafa_cell_grid_free(&g_state.screen);
+    chafa_cell_grid_free(&g_state.frame);
+    if (g_state.frame_output) {
+        g_string_free(g_state.frame_output, true);
+    }
     memset(&g_state, 0, sizeof(g_state));
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "terminal/output_driver.h"
 
 #include <chafa.h>
 #include <stdbool.h>
@@ -6,8 +7,19 @@
 
 void chafa_driver_detect(ChafaPixelMode *pixel_mode, ChafaCanvasMode *canvas_mode);
 ChafaPixelMode chafa_driver_pixel_mode_from_response(const char *response);
+// When the pixel mode came from the capability cache instead of asking the terminal, asks
+// again without waiting; the input thread must be reading by then, as it takes the replies.
+// chafa_driver_cleanup updates the cache with them.
+void chafa_driver_revalidate(void);
+// True when pixel sequences must be wrapped for a multiplexer such as tmux.
+bool chafa_driver_needs_passthrough(void);
 ChafaDitherMode chafa_driver_dither_mode(ChafaPixelMode pixel_mode, ChafaCanvasMode canvas_mode);
 void chafa_driver_configure(ChafaPixelMode pixel_mode, ChafaCanvasMode canvas_mode);
+// Symbol output only: trades truecolor for the 240-color palette, then detailed symbols
+// for half blocks. The hash-character mode is unaffected.
+void chafa_driver_set_quality(OutputQuality quality);
 void chafa_driver_render(const uint8_t *framebuffer, uint32_t width, uint32_t height,
                          bool use_hash_characters);
+// Forces the next symbol frame to be printed in full instead of as a cell diff.
+void chafa_driver_invalidate(void);
 void chafa_driver_cleanup(void);
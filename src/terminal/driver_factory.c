@@ -1,53 +1,107 @@
 #include "terminal/driver_factory.h"
+#include "terminal/block_encoder.h"
 #include "terminal/chafa_driver.h"
-#ifndef _WIN32
+#include "terminal/iterm2_encoder.h"
+#include "terminal/kitty_direct.h"
 #include "terminal/kitty_shm.h"
-#endif
+#include "terminal/sixel_encoder.h"
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
-#ifndef _WIN32
 static const OutputDriver g_driver_kitty_shm = {
     .name = "kitty_shm",
     .uses_character_cells = false,
+    .supports_render_scale = true,
     .render_frame = render_kitty_shm,
+    .owns_frame = kitty_shm_owns_frame,
+    .map_frame_ring = kitty_shm_map_frame_ring,
 };
-#endif
 
 static const OutputDriver g_driver_kitty_direct = {
     .name = "kitty_direct",
     .uses_character_cells = false,
-    .render_frame = chafa_driver_render,
+    .supports_render_scale = true,
+    .render_frame = render_kitty_direct,
+    .invalidate = kitty_direct_invalidate,
 };
 
 static const OutputDriver g_driver_sixel = {
     .name = "sixel",
     .uses_character_cells = false,
-    .render_frame = chafa_driver_render,
+    .supports_render_scale = false,
+    .render_frame = render_sixel,
 };
 
 static const OutputDriver g_driver_iterm2 = {
     .name = "iterm2",
     .uses_character_cells = false,
-    .render_frame = chafa_driver_render,
+    .supports_render_scale = true,
+    .render_frame = render_iterm2,
 };
 
 static const OutputDriver g_driver_truecolor = {
     .name = "truecolor",
     .uses_character_cells = true,
+    .supports_render_scale = true,
     .render_frame = chafa_driver_render,
+    .invalidate = chafa_driver_invalidate,
+    .set_quality = chafa_driver_set_quality,
 };
 
 static const OutputDriver g_driver_palette = {
     .name = "palette",
     .uses_character_cells = true,
+    .supports_render_scale = true,
     .render_frame = chafa_driver_render,
+    .invalidate = chafa_driver_invalidate,
+    .set_quality = chafa_driver_set_quality,
 };
 
 static const OutputDriver g_driver_block = {
     .name = "block",
     .uses_character_cells = true,
+    .supports_render_scale = true,
     .render_frame = chafa_driver_render,
+    .invalidate = chafa_driver_invalidate,
+    .set_quality = chafa_driver_set_quality,
+};
+
+static const OutputDriver g_driver_half_blocks = {
+    .name = "half_blocks",
+    .uses_character_cells = true,
+    .supports_render_scale = true,
+    .render_frame = render_half_blocks,
+    .invalidate = block_encoder_invalidate,
+};
+
+static const OutputDriver g_driver_quadrant_blocks = {
+    .name = "quadrant_blocks",
+    .uses_character_cells = true,
+    .supports_render_scale = true,
+    .render_frame = render_quadrant_blocks,
+    .invalidate = block_encoder_invalidate,
+};
+
+// The GPU reduces the frame to cells, so the terminal size in cells must match the render
+// resolution exactly and render scaling is not available.
+static const OutputDriver g_driver_gpu_quadrant_color = {
+    .name = "gpu_quadrant_color",
+    .uses_character_cells = true,
+    .supports_render_scale = false,
+    .cell_format = OUTPUT_CELLS_QUADRANT_COLOR,
+    .render_frame = render_quadrant_color_cells,
+    .invalidate = block_encoder_invalidate,
+};
+
+static const OutputDriver g_driver_gpu_quadrant_mono = {
+    .name = "gpu_quadrant_mono",
+    .uses_character_cells = true,
+    .supports_render_scale = false,
+    .cell_format = OUTPUT_CELLS_QUADRANT_MONO,
+    .render_frame = render_quadrant_mono_cells,
+    .invalidate = block_encoder_invalidate,
 };
 
 static const OutputDriver *select_chafa(const OutputDriver *driver, const ChafaPixelMode pixel_mode,
@@ -56,14 +110,51 @@ static const OutputDriver *select_chafa(const OutputDriver *driver, const ChafaP
     return driver;
 }
 
-const OutputDriver *driver_factory_get(const Args *args) {
-    if (args->use_kitty_shm) {
+// The native encoders cover the truecolor and monochrome block modes; hash
+// characters still need chafa's symbol matching.
+static const OutputDriver *native_or(const Args *args, const OutputDriver *driver) {
+    if ((!args->use_native_characters && !args->use_gpu_cells) || args->use_hash_characters) {
+        return driver;
+    }
+    if (driver == &g_driver_truecolor) {
+        return args->use_gpu_cells ? &g_driver_gpu_quadrant_color : &g_driver_half_blocks;
+    }
+    if (driver == &g_driver_block) {
+        return args->use_gpu_cells ? &g_driver_gpu_quadrant_mono : &g_driver_quadrant_blocks;
+    }
+    return driver;
+}
+
+const OutputDriver *driver_factory_pixel_fallback(const OutputDriver *driver) {
+    if (driver == &g_driver_gpu_quadrant_color) {
+        return &g_driver_half_blocks;
+    }
+    if (driver == &g_driver_gpu_quadrant_mono) {
+        return &g_driver_quadrant_blocks;
+    }
+    return driver;
+}
+
+// File transmission only works when the terminal can open our files. Kitty exports its PID to
+// its own shells; on Windows, WezTerm is the kitty-protocol terminal and is local unless we
+// run under its SSH domain.
+static bool kitty_terminal_is_local(void) {
+    const char *kitty_pid = getenv("KITTY_PID");
+    if (kitty_pid && kitty_pid[0]) {
+        return true;
+    }
 #ifdef _WIN32
-        return select_chafa(&g_driver_kitty_direct, CHAFA_PIXEL_MODE_KITTY,
-                            CHAFA_CANVAS_MODE_TRUECOLOR);
+    const char *program = getenv("TERM_PROGRAM");
+    const char *ssh = getenv("SSH_CONNECTION");
+    return program && strcmp(program, "WezTerm") == 0 && !(ssh && ssh[0]);
 #else
-        return &g_driver_kitty_shm;
+    return false;
 #endif
+}
+
+const OutputDriver *driver_factory_get(const Args *args) {
+    if (args->use_kitty_shm) {
+        return &g_driver_kitty_shm;
     }
     if (args->use_kitty) {
         return select_chafa(&g_driver_kitty_direct, CHAFA_PIXEL_MODE_KITTY,
@@ -73,27 +164,25 @@ const OutputDriver *driver_factory_get(const Args *args) {
         return select_chafa(&g_driver_sixel, CHAFA_PIXEL_MODE_SIXELS, CHAFA_CANVAS_MODE_TRUECOLOR);
     }
     if (args->use_truecolor_characters) {
-        return select_chafa(&g_driver_truecolor, CHAFA_PIXEL_MODE_SYMBOLS,
-                            CHAFA_CANVAS_MODE_TRUECOLOR);
+        return native_or(args, select_chafa(&g_driver_truecolor, CHAFA_PIXEL_MODE_SYMBOLS,
+                                            CHAFA_CANVAS_MODE_TRUECOLOR));
     }
     if (args->use_palette_characters) {
         return select_chafa(&g_driver_palette, CHAFA_PIXEL_MODE_SYMBOLS,
                             CHAFA_CANVAS_MODE_INDEXED_240);
     }
     if (args->use_block_characters) {
-        return select_chafa(&g_driver_block, CHAFA_PIXEL_MODE_SYMBOLS, CHAFA_CANVAS_MODE_FGBG);
+        return native_or(args, select_chafa(&g_driver_block, CHAFA_PIXEL_MODE_SYMBOLS,
+                                            CHAFA_CANVAS_MODE_FGBG));
     }
 
     ChafaPixelMode pixel_mode;
     ChafaCanvasMode canvas_mode;
     chafa_driver_detect(&pixel_mode, &canvas_mode);
 
-#ifndef _WIN32
-    const char *kitty_pid = getenv("KITTY_PID");
-    if (pixel_mode == CHAFA_PIXEL_MODE_KITTY && kitty_pid && kitty_pid[0]) {
+    if (pixel_mode == CHAFA_PIXEL_MODE_KITTY && kitty_terminal_is_local()) {
         return &g_driver_kitty_shm;
     }
-#endif
 
     switch (pixel_mode) {
     case CHAFA_PIXEL_MODE_KITTY:
@@ -108,10 +197,10 @@ const OutputDriver *driver_factory_get(const Args *args) {
     }
 
     if (canvas_mode == CHAFA_CANVAS_MODE_TRUECOLOR) {
-        return select_chafa(&g_driver_truecolor, pixel_mode, canvas_mode);
+        return native_or(args, select_chafa(&g_driver_truecolor, pixel_mode, canvas_mode));
     }
     if (canvas_mode != CHAFA_CANVAS_MODE_FGBG && canvas_mode != CHAFA_CANVAS_MODE_FGBG_BGFG) {
         return select_chafa(&g_driver_palette, pixel_mode, canvas_mode);
     }
-    return select_chafa(&g_driver_block, pixel_mode, canvas_mode);
+    return native_or(args, select_chafa(&g_driver_block, pixel_mode, canvas_mode));
 }
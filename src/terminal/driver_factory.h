@@ -3,3 +3,6 @@
 #include "terminal/output_driver.h"
 
 const OutputDriver *driver_factory_get(const Args *args);
+// The CPU-encoding driver for the same output, for when the renderer cannot produce the
+// cells a driver with a cell_format expects.
+const OutputDriver *driver_factory_pixel_fallback(const OutputDriver *driver);
@@ -0,0 +1,323 @@
+#include "terminal/iterm2_encoder.h"
+#include "core/worker_pool.h"
+#include "terminal/chafa_driver.h"
+#include "terminal/terminal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define ITERM2_MAX_BANDS 8U
+// Each band restarts the deflate window, so very short bands cost compression.
+#define ITERM2_MIN_BAND_ROWS 32U
+#define PNG_FILTER_NONE 0U
+#define PNG_FILTER_UP 2U
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+// One horizontal strip of the image, filtered and deflated independently. Strips end
+// on a sync flush, so their raw deflate streams concatenate into one valid stream.
+typedef struct {
+    z_stream stream;
+    bool stream_ready;
+    uint32_t first_row;
+    uint32_t rows;
+    ByteBuffer filtered;
+    ByteBuffer deflated;
+    uLong adler;
+    bool ok;
+} Iterm2Band;
+
+typedef struct {
+    Iterm2Band bands[ITERM2_MAX_BANDS];
+    uint32_t band_count;
+    WorkerPool pool;
+    bool pool_started;
+    const uint8_t *framebuffer;
+    uint32_t width;
+    ByteBuffer png;
+    ByteBuffer output;
+} Iterm2State;
+
+static Iterm2State g_iterm2;
+
+static bool buffer_reserve(ByteBuffer *buffer, const size_t capacity) {
+    if (buffer->capacity >= capacity) {
+        return true;
+    }
+    uint8_t *data = realloc(buffer->data, capacity);
+    if (!data) {
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static void buffer_free(ByteBuffer *buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+static inline void put_u32_be(uint8_t *dst, const uint32_t value) {
+    dst[0] = (uint8_t)(value >> 24);
+    dst[1] = (uint8_t)(value >> 16);
+    dst[2] = (uint8_t)(value >> 8);
+    dst[3] = (uint8_t)value;
+}
+
+// Drops alpha and applies the Up filter; a fixed filter skips the per-row heuristic
+// and the loop is a plain byte subtraction the compiler vectorizes.
+static void filter_row(uint8_t *out, const uint8_t *row, const uint8_t *previous,
+                       const uint32_t width) {
+    if (!previous) {
+        *out++ = PNG_FILTER_NONE;
+        for (uint32_t x = 0; x < width; x++) {
+            out[(x * 3U) + 0U] = row[(x * 4U) + 0U];
+            out[(x * 3U) + 1U] = row[(x * 4U) + 1U];
+            out[(x * 3U) + 2U] = row[(x * 4U) + 2U];
+        }
+        return;
+    }
+    *out++ = PNG_FILTER_UP;
+    for (uint32_t x = 0; x < width; x++) {
+        out[(x * 3U) + 0U] = (uint8_t)(row[(x * 4U) + 0U] - previous[(x * 4U) + 0U]);
+        out[(x * 3U) + 1U] = (uint8_t)(row[(x * 4U) + 1U] - previous[(x * 4U) + 1U]);
+        out[(x * 3U) + 2U] = (uint8_t)(row[(x * 4U) + 2U] - previous[(x * 4U) + 2U]);
+    }
+}
+
+static void encode_band_task(void *context, const uint32_t index) {
+    (void)context;
+    Iterm2Band *band = &g_iterm2.bands[index];
+    const uint32_t width = g_iterm2.width;
+    const size_t stride = (size_t)width * 4U;
+    const size_t filtered_stride = 1U + ((size_t)width * 3U);
+    const size_t filtered_size = filtered_stride * band->rows;
+    band->ok = false;
+
+    if (!buffer_reserve(&band->filtered, filtered_size)) {
+        return;
+    }
+    for (uint32_t r = 0; r < band->rows; r++) {
+        const uint32_t y = band->first_row + r;
+        const uint8_t *row = g_iterm2.framebuffer + ((size_t)y * stride);
+        filter_row(band->filtered.data + ((size_t)r * filtered_stride), row,
+                   y > 0 ? row - stride : NULL, width);
+    }
+    band->adler = adler32(adler32(0L, Z_NULL, 0), band->filtered.data, (uInt)filtered_size);
+
+    if (!band->stream_ready) {
+        memset(&band->stream, 0, sizeof(band->stream));
+        if (deflateInit2(&band->stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            return;
+        }
+        band->stream_ready = true;
+    } else {
+        deflateReset(&band->stream);
+    }
+
+    // Room for a sync flush marker on top of the bound for the data itself.
+    const size_t bound = deflateBound(&band->stream, (uLong)filtered_size) + 16U;
+    if (!buffer_reserve(&band->deflated, bound)) {
+        return;
+    }
+    const bool last = index + 1U == g_iterm2.band_count;
+    band->stream.next_in = band->filtered.data;
+    band->stream.avail_in = (uInt)filtered_size;
+    band->stream.next_out = band->deflated.data;
+    band->stream.avail_out = (uInt)bound;
+    const int status = deflate(&band->stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((last && status != Z_STREAM_END) || (!last && status != Z_OK) ||
+        band->stream.avail_in != 0) {
+        return;
+    }
+    band->deflated.size = bound - band->stream.avail_out;
+    band->ok = true;
+}
+
+static uint32_t choose_band_count(const uint32_t height) {
+    uint32_t count = dcat_cpu_count();
+    if (count > ITERM2_MAX_BANDS) {
+        count = ITERM2_MAX_BANDS;
+    }
+    const uint32_t by_rows = height / ITERM2_MIN_BAND_ROWS;
+    if (count > by_rows) {
+        count = by_rows;
+    }
+    return count > 0 ? count : 1;
+}
+
+static bool ensure_pool(const uint32_t band_count) {
+    // The calling thread deflates one band itself.
+    const uint32_t threads = band_count - 1U;
+    if (g_iterm2.pool_started && g_iterm2.pool.thread_count >= threads) {
+        return true;
+    }
+    if (g_iterm2.pool_started) {
+        worker_pool_destroy(&g_iterm2.pool);
+        g_iterm2.pool_started = false;
+    }
+    if (!worker_pool_init(&g_iterm2.pool, threads)) {
+        return false;
+    }
+    g_iterm2.pool_started = true;
+    return true;
+}
+
+static void append_chunk_header(uint8_t **cursor, const uint32_t length, const char *type) {
+    put_u32_be(*cursor, length);
+    memcpy(*cursor + 4, type, 4);
+    *cursor += 8;
+}
+
+static void append_chunk_crc(uint8_t **cursor, const uint8_t *type_start) {
+    const uLong crc = crc32(crc32(0L, Z_NULL, 0), type_start, (uInt)(*cursor - type_start));
+    put_u32_be(*cursor, (uint32_t)crc);
+    *cursor += 4;
+}
+
+const uint8_t *iterm2_encode_png(const uint8_t *framebuffer, const uint32_t width,
+                                 const uint32_t height, size_t *out_length) {
+    *out_length = 0;
+    if (width == 0 || height == 0) {
+        return NULL;
+    }
+
+    uint32_t band_count = choose_band_count(height);
+    if (band_count > 1 && !ensure_pool(band_count)) {
+        band_count = 1;
+    }
+    g_iterm2.band_count = band_count;
+    g_iterm2.framebuffer = framebuffer;
+    g_iterm2.width = width;
+    for (uint32_t i = 0; i < band_count; i++) {
+        g_iterm2.bands[i].first_row = (uint32_t)(((uint64_t)height * i) / band_count);
+        g_iterm2.bands[i].rows =
+            (uint32_t)(((uint64_t)height * (i + 1U)) / band_count) - g_iterm2.bands[i].first_row;
+    }
+    if (band_count > 1) {
+        worker_pool_run(&g_iterm2.pool, band_count, encode_band_task, NULL);
+    } else {
+        encode_band_task(NULL, 0);
+    }
+
+    const size_t filtered_stride = 1U + ((size_t)width * 3U);
+    size_t deflated_size = 0;
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (uint32_t i = 0; i < band_count; i++) {
+        const Iterm2Band *band = &g_iterm2.bands[i];
+        if (!band->ok) {
+            return NULL;
+        }
+        deflated_size += band->deflated.size;
+        adler = adler32_combine(adler, band->adler, (z_off_t)(filtered_stride * band->rows));
+    }
+
+    // Signature, IHDR, IDAT framing with the zlib header and trailer, and IEND.
+    const size_t idat_size = 2U + deflated_size + 4U;
+    if (idat_size > 0x7fffffffU ||
+        !buffer_reserve(&g_iterm2.png, 8U + 25U + 12U + idat_size + 12U)) {
+        return NULL;
+    }
+    uint8_t *cursor = g_iterm2.png.data;
+    memcpy(cursor, "\x89PNG\r\n\x1a\n", 8);
+    cursor += 8;
+
+    uint8_t *type_start = cursor + 4;
+    append_chunk_header(&cursor, 13U, "IHDR");
+    put_u32_be(cursor, width);
+    put_u32_be(cursor + 4, height);
+    cursor[8] = 8;  // bit depth
+    cursor[9] = 2;  // truecolor RGB
+    cursor[10] = 0; // deflate
+    cursor[11] = 0; // adaptive filtering
+    cursor[12] = 0; // no interlace
+    cursor += 13;
+    append_chunk_crc(&cursor, type_start);
+
+    type_start = cursor + 4;
+    append_chunk_header(&cursor, (uint32_t)idat_size, "IDAT");
+    // zlib header for a 32K window at the fastest level; 0x7801 is a multiple of 31.
+    *cursor++ = 0x78;
+    *cursor++ = 0x01;
+    for (uint32_t i = 0; i < band_count; i++) {
+        memcpy(cursor, g_iterm2.bands[i].deflated.data, g_iterm2.bands[i].deflated.size);
+        cursor += g_iterm2.bands[i].deflated.size;
+    }
+    put_u32_be(cursor, (uint32_t)adler);
+    cursor += 4;
+    append_chunk_crc(&cursor, type_start);
+
+    type_start = cursor + 4;
+    append_chunk_header(&cursor, 0U, "IEND");
+    append_chunk_crc(&cursor, type_start);
+
+    g_iterm2.png.size = (size_t)(cursor - g_iterm2.png.data);
+    *out_length = g_iterm2.png.size;
+    return g_iterm2.png.data;
+}
+
+void render_iterm2(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
+                   const bool use_hash_characters) {
+    // tmux and screen need the OSC wrapped; chafa already knows how.
+    if (chafa_driver_needs_passthrough()) {
+        chafa_driver_render(framebuffer, width, height, use_hash_characters);
+        return;
+    }
+
+    size_t png_size;
+    const uint8_t *png = iterm2_encode_png(framebuffer, width, height, &png_size);
+    if (!png) {
+        return;
+    }
+
+    // A reduced render scale is stretched back over the full area by the terminal.
+    char size_args[64];
+    uint32_t cols;
+    uint32_t rows;
+    if (terminal_get_display_cells(width, height, &cols, &rows)) {
+        snprintf(size_args, sizeof(size_args), "width=%u;height=%u", cols, rows);
+    } else {
+        snprintf(size_args, sizeof(size_args), "width=%upx;height=%upx", width, height);
+    }
+    char header[160];
+    const int header_length =
+        snprintf(header, sizeof(header), "\x1b[H\x1b]1337;File=inline=1;size=%zu;%s;"
+                                         "preserveAspectRatio=0:",
+                 png_size, size_args);
+
+    const size_t encoded_size = (png_size + 2U) / 3U * 4U;
+    if (!buffer_reserve(&g_iterm2.output, (size_t)header_length + encoded_size + 2U)) {
+        return;
+    }
+    memcpy(g_iterm2.output.data, header, (size_t)header_length);
+    const int written = terminal_base64_encode((const char *)png, (int)png_size,
+                                               (char *)g_iterm2.output.data + header_length);
+    g_iterm2.output.size = (size_t)header_length + (size_t)written;
+    g_iterm2.output.data[g_iterm2.output.size++] = '\a';
+    terminal_write_borrowed((const char *)g_iterm2.output.data, g_iterm2.output.size);
+}
+
+void iterm2_cleanup(void) {
+    if (g_iterm2.pool_started) {
+        worker_pool_destroy(&g_iterm2.pool);
+    }
+    for (uint32_t i = 0; i < ITERM2_MAX_BANDS; i++) {
+        Iterm2Band *band = &g_iterm2.bands[i];
+        if (band->stream_ready) {
+            deflateEnd(&band->stream);
+        }
+        buffer_free(&band->filtered);
+        buffer_free(&band->deflated);
+    }
+    buffer_free(&g_iterm2.png);
+    buffer_free(&g_iterm2.output);
+    memset(&g_iterm2, 0, sizeof(g_iterm2));
+}
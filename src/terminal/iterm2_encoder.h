@@ -0,0 +1,13 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Encodes an RGBA framebuffer as an RGB PNG tuned for speed over size: every row uses
+// the Up filter and row bands are deflated at level 1 in parallel. The returned buffer
+// is owned by the encoder and stays valid until the next call or cleanup.
+const uint8_t *iterm2_encode_png(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                                 size_t *out_length);
+void render_iterm2(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                   bool use_hash_characters);
+void iterm2_cleanup(void);
@@ -0,0 +1,281 @@
+#include "terminal/kitty_direct.h"
+#include "terminal/chafa_driver.h"
+#include "terminal/terminal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+// Kitty requires every chunk except the last to carry a multiple of 4 base64 bytes.
+#define KITTY_CHUNK_SIZE 4096U
+// A changed region covering more than this share of the image is sent as a full frame.
+#define KITTY_FULL_FRAME_RATIO 0.6
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+typedef struct {
+    uint8_t *previous;
+    uint32_t width;
+    uint32_t height;
+    bool has_previous;
+    bool use_frame_edits;
+    bool initialized;
+    ByteBuffer region;
+    ByteBuffer compressed;
+    ByteBuffer encoded;
+    ByteBuffer output;
+} KittyDirectState;
+
+static KittyDirectState g_kitty;
+
+static bool buffer_reserve(ByteBuffer *buffer, const size_t capacity) {
+    if (buffer->capacity >= capacity) {
+        return true;
+    }
+    uint8_t *data = realloc(buffer->data, capacity);
+    if (!data) {
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static bool buffer_append(ByteBuffer *buffer, const void *data, const size_t size) {
+    if (buffer->size + size > buffer->capacity &&
+        !buffer_reserve(buffer, (buffer->size + size) * 2U)) {
+        return false;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return true;
+}
+
+static void buffer_free(ByteBuffer *buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+static void initialize(void) {
+    if (g_kitty.initialized) {
+        return;
+    }
+    // Frame edits (a=f) are only relied on in kitty itself; other terminals that speak
+    // the graphics protocol do not all implement animation frames.
+    const char *term = getenv("TERM");
+    g_kitty.use_frame_edits = term && strcmp(term, "xterm-kitty") == 0;
+    g_kitty.initialized = true;
+}
+
+// Finds the bounding box of pixels that differ from the previous frame. Returns false
+// when nothing changed.
+static bool find_changed_region(const uint8_t *framebuffer, uint32_t *out_x, uint32_t *out_y,
+                                uint32_t *out_width, uint32_t *out_height) {
+    const size_t stride = (size_t)g_kitty.width * 4U;
+    uint32_t min_x = g_kitty.width;
+    uint32_t max_x = 0;
+    uint32_t min_y = g_kitty.height;
+    uint32_t max_y = 0;
+
+    for (uint32_t y = 0; y < g_kitty.height; y++) {
+        const uint32_t *row = (const uint32_t *)(const void *)(framebuffer + (y * stride));
+        const uint32_t *prev = (const uint32_t *)(const void *)(g_kitty.previous + (y * stride));
+        if (memcmp(row, prev, stride) == 0) {
+            continue;
+        }
+
+        uint32_t left = 0;
+        while (row[left] == prev[left]) {
+            left++;
+        }
+        uint32_t right = g_kitty.width - 1U;
+        while (row[right] == prev[right]) {
+            right--;
+        }
+
+        min_x = left < min_x ? left : min_x;
+        max_x = right > max_x ? right : max_x;
+        min_y = y < min_y ? y : min_y;
+        max_y = y;
+    }
+
+    if (min_y > max_y) {
+        return false;
+    }
+    *out_x = min_x;
+    *out_y = min_y;
+    *out_width = max_x - min_x + 1U;
+    *out_height = max_y - min_y + 1U;
+    return true;
+}
+
+// Returns false when out of memory, leaving g_kitty.output incomplete
+static bool append_chunked_payload(const char *header, const int header_length) {
+    const size_t total = g_kitty.encoded.size;
+    size_t offset = 0;
+    bool first = true;
+
+    do {
+        const size_t chunk = total - offset > KITTY_CHUNK_SIZE ? KITTY_CHUNK_SIZE : total - offset;
+        const bool more = offset + chunk < total;
+        bool ok = true;
+        if (first) {
+            ok = buffer_append(&g_kitty.output, header, (size_t)header_length) &&
+                 buffer_append(&g_kitty.output, more ? ",m=1;" : ";", more ? 5U : 1U);
+            first = false;
+        } else {
+            ok = buffer_append(&g_kitty.output, more ? "\x1b_Gm=1;" : "\x1b_Gm=0;", 7U);
+        }
+        if (!ok || !buffer_append(&g_kitty.output, g_kitty.encoded.data + offset, chunk) ||
+            !buffer_append(&g_kitty.output, "\x1b\\", 2U)) {
+            return false;
+        }
+        offset += chunk;
+    } while (offset < total);
+    return true;
+}
+
+// Compresses the pixels when that makes the payload smaller and base64-encodes the
+// result into g_kitty.encoded, setting `out_compressed` when the payload is
+// zlib-compressed. Returns false when out of memory.
+static bool encode_payload(const uint8_t *pixels, const size_t size, bool *out_compressed) {
+    const uint8_t *payload = pixels;
+    size_t payload_size = size;
+    bool compressed = false;
+
+    uLongf compressed_size = compressBound((uLong)size);
+    if (buffer_reserve(&g_kitty.compressed, compressed_size) &&
+        compress2(g_kitty.compressed.data, &compressed_size, pixels, (uLong)size, Z_BEST_SPEED) ==
+            Z_OK &&
+        compressed_size < size) {
+        payload = g_kitty.compressed.data;
+        payload_size = compressed_size;
+        compressed = true;
+    }
+
+    g_kitty.encoded.size = 0;
+    if (!buffer_reserve(&g_kitty.encoded, ((payload_size + 2U) / 3U * 4U) + 1U)) {
+        return false;
+    }
+    g_kitty.encoded.size = (size_t)terminal_base64_encode((const char *)payload,
+                                                          (int)payload_size,
+                                                          (char *)g_kitty.encoded.data);
+    *out_compressed = compressed;
+    return true;
+}
+
+static bool append_full_frame(const uint8_t *framebuffer, const uint32_t width,
+                              const uint32_t height) {
+    bool compressed = false;
+    if (!encode_payload(framebuffer, (size_t)width * height * 4U, &compressed)) {
+        return false;
+    }
+    // A reduced render scale is stretched back over the full area by the terminal.
+    char placement[48] = "";
+    uint32_t cols;
+    uint32_t rows;
+    if (terminal_get_display_cells(width, height, &cols, &rows)) {
+        snprintf(placement, sizeof(placement), ",c=%u,r=%u", cols, rows);
+    }
+    char header[160];
+    const int header_length =
+        snprintf(header, sizeof(header), "\x1b[H\x1b_Ga=T,f=32,i=1,p=1,s=%u,v=%u,q=2,C=1%s%s",
+                 width, height, placement, compressed ? ",o=z" : "");
+    return append_chunked_payload(header, header_length);
+}
+
+static bool append_region(const uint8_t *framebuffer, const uint32_t x, const uint32_t y,
+                          const uint32_t width, const uint32_t height) {
+    const size_t stride = (size_t)g_kitty.width * 4U;
+    const size_t row_size = (size_t)width * 4U;
+    if (!buffer_reserve(&g_kitty.region, row_size * height)) {
+        return false;
+    }
+    for (uint32_t row = 0; row < height; row++) {
+        memcpy(g_kitty.region.data + (row * row_size),
+               framebuffer + ((y + row) * stride) + ((size_t)x * 4U), row_size);
+    }
+
+    bool compressed = false;
+    if (!encode_payload(g_kitty.region.data, row_size * height, &compressed)) {
+        return false;
+    }
+    char header[160];
+    // Edit the root frame in place; X=1 replaces pixels instead of alpha blending.
+    const int header_length = snprintf(header, sizeof(header),
+                                       "\x1b_Ga=f,r=1,i=1,f=32,x=%u,y=%u,s=%u,v=%u,X=1,q=2%s", x,
+                                       y, width, height, compressed ? ",o=z" : "");
+    return append_chunked_payload(header, header_length);
+}
+
+void render_kitty_direct(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
+                         const bool use_hash_characters) {
+    // tmux and screen need the sequences wrapped; chafa already knows how.
+    if (chafa_driver_needs_passthrough()) {
+        chafa_driver_render(framebuffer, width, height, use_hash_characters);
+        return;
+    }
+    initialize();
+
+    const size_t frame_size = (size_t)width * height * 4U;
+    if (g_kitty.width != width || g_kitty.height != height || !g_kitty.previous) {
+        uint8_t *previous = realloc(g_kitty.previous, frame_size);
+        if (!previous) {
+            return;
+        }
+        g_kitty.previous = previous;
+        g_kitty.width = width;
+        g_kitty.height = height;
+        g_kitty.has_previous = false;
+    }
+
+    g_kitty.output.size = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t region_width = width;
+    uint32_t region_height = height;
+    if (g_kitty.has_previous && g_kitty.use_frame_edits) {
+        if (!find_changed_region(framebuffer, &x, &y, &region_width, &region_height)) {
+            return;
+        }
+    }
+
+    const double changed_ratio =
+        ((double)region_width * region_height) / ((double)width * (double)height);
+    bool encoded = false;
+    if (!g_kitty.has_previous || changed_ratio > KITTY_FULL_FRAME_RATIO) {
+        encoded = append_full_frame(framebuffer, width, height);
+    } else {
+        encoded = append_region(framebuffer, x, y, region_width, region_height);
+    }
+    if (!encoded) {
+        // Out of memory: nothing of this frame is written, and the next one goes out whole
+        // rather than as edits to a frame the terminal never received
+        g_kitty.has_previous = false;
+        return;
+    }
+
+    memcpy(g_kitty.previous, framebuffer, frame_size);
+    g_kitty.has_previous = true;
+    terminal_write_borrowed((const char *)g_kitty.output.data, g_kitty.output.size);
+}
+
+void kitty_direct_invalidate(void) {
+    g_kitty.has_previous = false;
+    // Under tmux or screen the frames go out through chafa
+    chafa_driver_invalidate();
+}
+
+void kitty_direct_cleanup(void) {
+    free(g_kitty.previous);
+    buffer_free(&g_kitty.region);
+    buffer_free(&g_kitty.compressed);
+    buffer_free(&g_kitty.encoded);
+    buffer_free(&g_kitty.output);
+    memset(&g_kitty, 0, sizeof(g_kitty));
+}
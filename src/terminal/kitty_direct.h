@@ -0,0 +1,9 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+void render_kitty_direct(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                         bool use_hash_characters);
+// Forces the next frame to be sent whole, placement included, instead of as frame edits.
+void kitty_direct_invalidate(void);
+void kitty_direct_cleanup(void);
@@ -1,66 +1,273 @@
 #include "kitty_shm.h"
 #include "platform/io.h"
 #include "terminal.h"
-#ifdef _WIN32
+#include "terminal/kitty_direct.h"
+
 #include <stdbool.h>
 #include <stdint.h>
-#else
-#include <errno.h>
-#include <fcntl.h>
-#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #endif
 
-#ifdef _WIN32
-
-void render_kitty_shm(const uint8_t *buffer, uint32_t width, uint32_t height,
-                      bool use_hash_characters) {
-    (void)buffer;
-    (void)width;
-    (void)height;
-    (void)use_hash_characters;
-}
+// Frames are written into a ring of slots inside one persistently mapped file and
+// sent with t=f plus an offset. Unlike t=s, the terminal does not unlink regular
+// files after reading them, so the mapping can be reused for the whole session.
+#define KITTY_RING_SLOTS 3
 
+typedef struct {
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
 #else
+    int fd;
+#endif
+    uint8_t *map;
+    size_t map_size;
+    size_t slot_size;
+    uint32_t slot_count;
+    uint32_t next_slot;
+    bool failed;
+    // The renderer copies frames into the ring itself and owns its geometry
+    bool external;
+    char path[256];
+} KittyFrameRing;
 
 static int kitty_pid;
+#ifndef _WIN32
 static int kitty_frame;
+#endif
 static bool kitty_initialized = false;
+#ifdef _WIN32
+static KittyFrameRing kitty_ring = {.file = INVALID_HANDLE_VALUE};
+
+static bool kitty_ring_is_open(void) { return kitty_ring.file != INVALID_HANDLE_VALUE; }
+
+// The file lives in the temp directory, where FILE_ATTRIBUTE_TEMPORARY keeps it in the cache
+// instead of flushing it to disk, and is deleted once the last handle to it closes. The
+// terminal must open it with FILE_SHARE_DELETE, as Rust's std (WezTerm) does by default.
+static bool kitty_ring_open(void) {
+    char dir[MAX_PATH];
+    const DWORD length = GetTempPathA(sizeof(dir), dir);
+    if (length == 0 || length >= sizeof(dir)) {
+        return false;
+    }
+    snprintf(kitty_ring.path, sizeof(kitty_ring.path), "%sdcat-%d-frames", dir, kitty_pid);
+
+    kitty_ring.file =
+        CreateFileA(kitty_ring.path, GENERIC_READ | GENERIC_WRITE,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS,
+                    FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    return kitty_ring_is_open();
+}
+
+static size_t kitty_ring_page_size(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize > 0 ? (size_t)info.dwPageSize : 4096U;
+}
+
+static void kitty_ring_unmap(void) {
+    if (kitty_ring.map) {
+        UnmapViewOfFile(kitty_ring.map);
+    }
+    if (kitty_ring.mapping) {
+        CloseHandle(kitty_ring.mapping);
+    }
+    kitty_ring.map = NULL;
+    kitty_ring.mapping = NULL;
+}
+
+// Creating a mapping larger than the file extends it; a smaller one leaves the tail unused.
+static uint8_t *kitty_ring_resize(const size_t map_size) {
+    const unsigned long long size = map_size;
+    kitty_ring.mapping = CreateFileMappingA(kitty_ring.file, NULL, PAGE_READWRITE,
+                                            (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (!kitty_ring.mapping) {
+        return NULL;
+    }
+    return MapViewOfFile(kitty_ring.mapping, FILE_MAP_ALL_ACCESS, 0, 0, map_size);
+}
+
+static void kitty_ring_close(void) {
+    if (kitty_ring_is_open()) {
+        CloseHandle(kitty_ring.file);
+    }
+    kitty_ring.file = INVALID_HANDLE_VALUE;
+}
+#else
+static KittyFrameRing kitty_ring = {.fd = -1};
+
+static bool kitty_ring_is_open(void) { return kitty_ring.fd != -1; }
+
+static bool kitty_ring_open(void) {
+    const char *dir = "/dev/shm";
+    if (access(dir, W_OK) != 0) {
+        const char *tmpdir = getenv("TMPDIR");
+        dir = (tmpdir && tmpdir[0]) ? tmpdir : "/tmp";
+    }
+    // Both are shared with other users, who could plant a symlink at a predictable name.
+    // mkstemp picks a random one and only ever creates a new file (O_EXCL), retrying on
+    // names that are taken.
+    snprintf(kitty_ring.path, sizeof(kitty_ring.path), "%s/dcat-%d-frames-XXXXXX", dir,
+             kitty_pid);
+    kitty_ring.fd = mkstemp(kitty_ring.path);
+    return kitty_ring_is_open();
+}
+
+static size_t kitty_ring_page_size(void) {
+    const long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096U;
+}
+
+static void kitty_ring_unmap(void) {
+    if (kitty_ring.map) {
+        munmap(kitty_ring.map, kitty_ring.map_size);
+    }
+    kitty_ring.map = NULL;
+}
+
+static uint8_t *kitty_ring_resize(const size_t map_size) {
+    if (ftruncate(kitty_ring.fd, (off_t)map_size) == -1) {
+        return NULL;
+    }
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, kitty_ring.fd, 0);
+    return map != MAP_FAILED ? map : NULL;
+}
+
+static void kitty_ring_close(void) {
+    if (kitty_ring_is_open()) {
+        dcat_close(kitty_ring.fd);
+        unlink(kitty_ring.path);
+    }
+    kitty_ring.fd = -1;
+}
+#endif
+
+static void kitty_ring_release(void) {
+    kitty_ring_unmap();
+    kitty_ring_close();
+    kitty_ring.map_size = 0;
+    kitty_ring.slot_size = 0;
+    kitty_ring.slot_count = 0;
+}
 
 static void kitty_cleanup(void) {
     if (kitty_initialized) {
         static const char *del = "\x1b_Ga=d,d=A,q=2\x1b\\";
         safe_write(del, strlen(del));
     }
+    kitty_ring_release();
 }
 
-void render_kitty_shm(const uint8_t *buffer, uint32_t width, uint32_t height,
-                      bool use_hash_characters) {
-    (void)use_hash_characters;
+static void kitty_init_once(void) {
     if (!kitty_initialized) {
         kitty_pid = dcat_getpid();
+#ifndef _WIN32
         kitty_frame = 0;
+#endif
         atexit(kitty_cleanup);
         kitty_initialized = true;
     }
+}
 
-    size_t data_size = (size_t)width * height * 4;
+// (Re)maps the ring with slot_count slots of at least data_size bytes, rounded up to
+// `alignment` (at least a page).
+static bool kitty_ring_map(const size_t data_size, const uint32_t slot_count,
+                           const size_t alignment) {
+    if (kitty_ring.failed) {
+        return false;
+    }
+    if (!kitty_ring_is_open() && !kitty_ring_open()) {
+        kitty_ring.failed = true;
+        return false;
+    }
 
-    char shm_name[64];
-    snprintf(shm_name, sizeof(shm_name), "/dcat-%d-%d", kitty_pid, kitty_frame);
-    kitty_frame++;
+    size_t granule = kitty_ring_page_size();
+    if (alignment > granule) {
+        granule = alignment;
+    }
+    const size_t slot_size = (data_size + granule - 1U) / granule * granule;
+    if (kitty_ring.map && kitty_ring.slot_size == slot_size &&
+        kitty_ring.slot_count == slot_count) {
+        return true;
+    }
+    const size_t map_size = slot_size * slot_count;
+
+    kitty_ring_unmap();
+    uint8_t *map = kitty_ring_resize(map_size);
+    if (!map) {
+        kitty_ring_release();
+        kitty_ring.failed = true;
+        return false;
+    }
+    kitty_ring.map = map;
+    kitty_ring.map_size = map_size;
+    kitty_ring.slot_size = slot_size;
+    kitty_ring.slot_count = slot_count;
+    kitty_ring.next_slot = 0;
+    return true;
+}
+
+// Returns the mapped slot to fill next, growing the ring when a frame no longer fits.
+static uint8_t *kitty_ring_acquire(const size_t data_size, size_t *out_offset) {
+    if (data_size > kitty_ring.slot_size && !kitty_ring_map(data_size, KITTY_RING_SLOTS, 0)) {
+        return NULL;
+    }
+
+    *out_offset = kitty_ring.slot_size * kitty_ring.next_slot;
+    kitty_ring.next_slot = (kitty_ring.next_slot + 1U) % kitty_ring.slot_count;
+    return kitty_ring.map + *out_offset;
+}
+
+uint8_t *kitty_shm_map_frame_ring(const size_t frame_size, const uint32_t slot_count,
+                                  const size_t alignment, size_t *out_slot_size) {
+    kitty_init_once();
+    if (slot_count == 0 || !kitty_ring_map(frame_size, slot_count, alignment)) {
+        kitty_ring.external = false;
+        return NULL;
+    }
+    kitty_ring.external = true;
+    *out_slot_size = kitty_ring.slot_size;
+    return kitty_ring.map;
+}
+
+bool kitty_shm_owns_frame(const uint8_t *framebuffer, const size_t size) {
+    // Only an external ring is stable across threads: it is remapped by the render thread
+    // alone, after the output pipeline has been flushed.
+    if (!kitty_ring.external || !kitty_ring.map || framebuffer < kitty_ring.map) {
+        return false;
+    }
+    const size_t offset = (size_t)(framebuffer - kitty_ring.map);
+    return offset <= kitty_ring.map_size && size <= kitty_ring.map_size - offset;
+}
 
-    int fd = shm_open(shm_name, O_RDWR | O_CREAT, 0600);
+#ifndef _WIN32
+// Fallback for systems where the frame file cannot be mapped: one shm object per frame.
+static bool write_shm_object(const uint8_t *buffer, const size_t data_size, char *shm_name,
+                             const size_t shm_name_size) {
+    // Only a new object: one someone else created under the name could be read by them
+    int fd = -1;
+    for (int attempt = 0; attempt < 8 && fd == -1; attempt++) {
+        snprintf(shm_name, shm_name_size, "/dcat-%d-%d", kitty_pid, kitty_frame);
+        kitty_frame++;
+        fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd == -1 && errno != EEXIST)
+            return false;
+    }
     if (fd == -1)
-        return;
+        return false;
 
     if (ftruncate(fd, (off_t)data_size) == -1) {
         dcat_close(fd);
-        return;
+        return false;
     }
 
     const uint8_t *src = buffer;
@@ -71,24 +278,77 @@ void render_kitty_shm(const uint8_t *buffer, uint32_t width, uint32_t height,
             if (errno == EINTR)
                 continue;
             dcat_close(fd);
-            return;
+            return false;
         }
         src += written;
         remaining -= (size_t)written;
     }
     dcat_close(fd);
+    return true;
+}
+#endif
 
-    char name_b64[128];
-    int name_b64_len = terminal_base64_encode(shm_name, (int)strlen(shm_name), name_b64);
+void render_kitty_shm(const uint8_t *buffer, uint32_t width, uint32_t height,
+                      bool use_hash_characters) {
+    kitty_init_once();
+
+    size_t data_size = (size_t)width * height * 4;
 
-    char cmd[512];
-    int cmd_len = snprintf(cmd, sizeof(cmd), "\x1b[H\x1b_Gf=32,a=T,t=s,i=1,p=1,s=%u,v=%u,q=2,C=1;",
+    char cmd[768];
+    int cmd_len;
+    const char *name;
+#ifndef _WIN32
+    // Outlives the branch that names the object, as `name` points into it
+    char shm_name[64];
+#endif
+    size_t offset = 0;
+    // A reduced render scale is stretched back over the full area by the terminal.
+    char placement[48] = "";
+    uint32_t cols;
+    uint32_t rows;
+    if (terminal_get_display_cells(width, height, &cols, &rows)) {
+        snprintf(placement, sizeof(placement), "c=%u,r=%u,", cols, rows);
+    }
+    uint8_t *slot = NULL;
+    if (kitty_shm_owns_frame(buffer, data_size)) {
+        // The GPU already copied the frame into the ring.
+        offset = (size_t)(buffer - kitty_ring.map);
+        slot = kitty_ring.map + offset;
+    } else if (!kitty_ring.external) {
+        // An externally owned ring is only ever remapped by the renderer.
+        slot = kitty_ring_acquire(data_size, &offset);
+        if (slot) {
+            memcpy(slot, buffer, data_size);
+        }
+    }
+    if (slot) {
+        name = kitty_ring.path;
+        cmd_len = snprintf(cmd, sizeof(cmd),
+                           "\x1b[H\x1b_Gf=32,a=T,t=f,i=1,p=1,%ss=%u,v=%u,S=%zu,O=%zu,q=2,C=1;",
+                           placement, width, height, data_size, offset);
+    } else {
+#ifdef _WIN32
+        // Windows has no shm objects the terminal could open; send the pixels inline.
+        render_kitty_direct(buffer, width, height, use_hash_characters);
+        return;
+#else
+        (void)use_hash_characters;
+        if (!write_shm_object(buffer, data_size, shm_name, sizeof(shm_name))) {
+            return;
+        }
+        name = shm_name;
+        cmd_len = snprintf(cmd, sizeof(cmd),
+                           "\x1b[H\x1b_Gf=32,a=T,t=s,i=1,p=1,%ss=%u,v=%u,q=2,C=1;", placement,
                            width, height);
+#endif
+    }
+
+    char name_b64[360];
+    int name_b64_len = terminal_base64_encode(name, (int)strlen(name), name_b64);
+
     memcpy(cmd + cmd_len, name_b64, name_b64_len);
     cmd_len += name_b64_len;
     memcpy(cmd + cmd_len, "\x1b\\", 2);
     cmd_len += 2;
     safe_write(cmd, (size_t)cmd_len);
 }
-
-#endif
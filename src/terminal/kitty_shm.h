@@ -1,6 +1,20 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// Sends frames by file through a mapped ring: under /dev/shm on POSIX, a temporary file on
+// Windows. Where the ring cannot be mapped, falls back to one shm object per frame (POSIX) or
+// to kitty_direct (Windows).
 void render_kitty_shm(const uint8_t *buffer, uint32_t width, uint32_t height,
                       bool use_hash_characters);
+
+// Hands the frame ring to the renderer: maps slot_count slots large enough for frame_size
+// bytes, with base and slot size aligned to `alignment`. From then on the ring is only
+// resized through this call, and frames that already live in it are sent without a copy.
+// A slot_count of 0 gives the ring back, to be filled by render_kitty_shm again. Matches
+// VulkanHostReadbackMap.
+uint8_t *kitty_shm_map_frame_ring(size_t frame_size, uint32_t slot_count, size_t alignment,
+                                  size_t *out_slot_size);
+// True when the frame lies inside the ring, i.e. the renderer wrote it there directly.
+bool kitty_shm_owns_frame(const uint8_t *framebuffer, size_t size);
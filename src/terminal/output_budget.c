@@ -0,0 +1,115 @@
+#include "terminal/output_budget.h"
+
+#define OUTPUT_BUDGET_SMOOTHING 0.2
+// A write that took this long waited for the link rather than only filling the queue
+#define OUTPUT_BUDGET_BLOCKED_SECONDS 0.002
+// Over budget past this ratio counts toward a cheaper encoding; under the lower ratio
+// counts toward a richer one, which may cost about twice the bytes.
+#define OUTPUT_BUDGET_OVER_RATIO 1.1
+#define OUTPUT_BUDGET_UNDER_RATIO 0.4
+#define OUTPUT_BUDGET_DOWN_FRAMES 4U
+#define OUTPUT_BUDGET_UP_FRAMES 60U
+#define OUTPUT_BUDGET_COOLDOWN_FRAMES 10U
+// Growth of the rate estimate for each frame written without blocking
+#define OUTPUT_BUDGET_PROBE_STEP 1.02
+// The link no longer counts as the bottleneck once it carries this many average frames
+// per target frame time
+#define OUTPUT_BUDGET_RELEASE_RATIO 4.0
+// Longest pause between frames, so a low estimate cannot freeze the display
+#define OUTPUT_BUDGET_MAX_WAIT_SECONDS 1.0
+
+void output_budget_init(OutputBudget *budget, const double target_frame_time,
+                        const OutputQuality lowest_quality) {
+    *budget = (OutputBudget){0};
+    budget->target_frame_time = target_frame_time;
+    budget->lowest_quality = lowest_quality;
+    budget->quality = OUTPUT_QUALITY_FULL;
+}
+
+static void update_link_rate(OutputBudget *budget, const double write_time, const size_t bytes,
+                             const size_t queued_before, const size_t queued_after) {
+    if (write_time < OUTPUT_BUDGET_BLOCKED_SECONDS) {
+        budget->link_rate *= OUTPUT_BUDGET_PROBE_STEP;
+        return;
+    }
+    // The link was busy for the whole write, so what left the queue meanwhile is its rate
+    const double drained = (double)queued_before + (double)bytes - (double)queued_after;
+    if (drained <= 0.0) {
+        return;
+    }
+    const double rate = drained / write_time;
+    if (budget->link_rate > 0.0) {
+        budget->link_rate += (rate - budget->link_rate) * OUTPUT_BUDGET_SMOOTHING;
+    } else {
+        budget->link_rate = rate;
+    }
+}
+
+bool output_budget_update(OutputBudget *budget, const double write_start, const double write_end,
+                          const size_t bytes, const size_t queued_before,
+                          const size_t queued_after) {
+    budget->write_start = write_start;
+    budget->write_end = write_end;
+    budget->bytes = bytes;
+    budget->queued = queued_after;
+    if (budget->target_frame_time <= 0.0 || bytes == 0) {
+        return false;
+    }
+
+    update_link_rate(budget, write_end - write_start, bytes, queued_before, queued_after);
+    if (budget->has_average) {
+        budget->average_frame_bytes +=
+            ((double)bytes - budget->average_frame_bytes) * OUTPUT_BUDGET_SMOOTHING;
+    } else {
+        budget->average_frame_bytes = (double)bytes;
+        budget->has_average = true;
+    }
+    const double frame_budget = budget->link_rate * budget->target_frame_time;
+    if (frame_budget > budget->average_frame_bytes * OUTPUT_BUDGET_RELEASE_RATIO) {
+        budget->link_rate = 0.0;
+    }
+
+    if (budget->cooldown > 0) {
+        budget->cooldown--;
+        return false;
+    }
+
+    const bool limited = budget->link_rate > 0.0;
+    const bool over =
+        limited && budget->average_frame_bytes > frame_budget * OUTPUT_BUDGET_OVER_RATIO;
+    const bool under =
+        !limited || budget->average_frame_bytes < frame_budget * OUTPUT_BUDGET_UNDER_RATIO;
+    budget->frames_over = over ? budget->frames_over + 1U : 0U;
+    budget->frames_under = under ? budget->frames_under + 1U : 0U;
+
+    OutputQuality quality = budget->quality;
+    if (budget->frames_over >= OUTPUT_BUDGET_DOWN_FRAMES && quality < budget->lowest_quality) {
+        quality = (OutputQuality)(quality + 1);
+    } else if (budget->frames_under >= OUTPUT_BUDGET_UP_FRAMES && quality > OUTPUT_QUALITY_FULL) {
+        quality = (OutputQuality)(quality - 1);
+    } else {
+        return false;
+    }
+
+    // Frame sizes at the old quality say nothing about the new one
+    budget->quality = quality;
+    budget->has_average = false;
+    budget->frames_over = 0;
+    budget->frames_under = 0;
+    budget->cooldown = OUTPUT_BUDGET_COOLDOWN_FRAMES;
+    return true;
+}
+
+double output_budget_next_write_time(const OutputBudget *budget) {
+    if (budget->link_rate <= 0.0) {
+        return budget->write_end;
+    }
+    // Long enough for the link to carry the frame, and for the queue it left to drain
+    double next = budget->write_start + ((double)budget->bytes / budget->link_rate);
+    const double drained = budget->write_end + ((double)budget->queued / budget->link_rate);
+    if (drained > next) {
+        next = drained;
+    }
+    const double latest = budget->write_end + OUTPUT_BUDGET_MAX_WAIT_SECONDS;
+    return next < latest ? next : latest;
+}
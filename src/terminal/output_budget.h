@@ -0,0 +1,42 @@
+#pragma once
+#include "terminal/output_driver.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Keeps frame output within what the link to the terminal carries, e.g. over SSH, where
+// writing faster than the link drains fills the kernel queue until writes block and input
+// lags by seconds. A write that blocks measures the link rate; frames are then paced so the
+// queue stays short, and when the average frame overruns what the link carries per target
+// frame time the quality steps down. As with RenderScaleController, steps need several
+// frames outside the budget and are followed by a cooldown. Without a blocked write the
+// rate estimate creeps up until it no longer limits anything.
+typedef struct OutputBudget {
+    double target_frame_time;
+    OutputQuality lowest_quality; // the cheapest encoding the driver offers
+    OutputQuality quality;
+    double link_rate; // bytes per second, 0 while the link is not the bottleneck
+    double average_frame_bytes;
+    // The latest frame, for pacing the next
+    double write_start;
+    double write_end;
+    size_t bytes;
+    size_t queued;
+    uint32_t frames_over;
+    uint32_t frames_under;
+    uint32_t cooldown;
+    bool has_average;
+} OutputBudget;
+
+void output_budget_init(OutputBudget *budget, double target_frame_time,
+                        OutputQuality lowest_quality);
+// Feeds one written frame: when its write started and ended, its size, and the bytes the
+// terminal had not read before and after it (0 when unknown). Returns true when the quality
+// changed.
+bool output_budget_update(OutputBudget *budget, double write_start, double write_end,
+                          size_t bytes, size_t queued_before, size_t queued_after);
+// When the next frame should be written for the link to have drained the latest one; frames
+// submitted before then replace each other, lowering the frame rate to what the link
+// carries.
+double output_budget_next_write_time(const OutputBudget *budget);
@@ -1,10 +1,44 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// Frames handed to a driver are RGBA pixels unless it takes GPU-built cells: one 8-byte
+// cell per 2x4 pixels, laid out as described for VulkanCellOutput.
+typedef enum OutputCellFormat {
+    OUTPUT_CELLS_NONE,
+    OUTPUT_CELLS_QUADRANT_COLOR,
+    OUTPUT_CELLS_QUADRANT_MONO,
+} OutputCellFormat;
+
+#define OUTPUT_CELL_BYTES 8U
+
+// Cheaper encodings a driver can switch to when the link to the terminal cannot carry
+// full frames, in increasing order of savings (see OutputBudget)
+typedef enum OutputQuality {
+    OUTPUT_QUALITY_FULL,
+    OUTPUT_QUALITY_REDUCED_COLORS,
+    OUTPUT_QUALITY_COARSE, // reduced colors and fewer symbol shapes
+} OutputQuality;
+
 typedef struct OutputDriver {
     const char *name;
     bool uses_character_cells;
+    // The driver can show a frame rendered below the display size stretched to fill it
+    bool supports_render_scale;
+    OutputCellFormat cell_format;
     void (*render_frame)(const uint8_t *framebuffer, uint32_t width, uint32_t height,
                          bool use_hash_characters);
+    // Drops any state about what is on screen so the next frame is written in full
+    void (*invalidate)(void);
+    // The frame already lives in memory the driver sends from, so the pipeline can pass
+    // the pointer through instead of copying the pixels
+    bool (*owns_frame)(const uint8_t *framebuffer, size_t size);
+    // Provides memory the renderer can read frames back into directly; the frames then
+    // satisfy owns_frame. Same contract as VulkanHostReadbackMap.
+    uint8_t *(*map_frame_ring)(size_t frame_size, uint32_t slot_count, size_t alignment,
+                               size_t *out_slot_size);
+    // Switches to a cheaper encoding; drivers without it are only paced. Called from the
+    // thread that renders frames.
+    void (*set_quality)(OutputQuality quality);
 } OutputDriver;
@@ -0,0 +1,236 @@
+#include "terminal/output_pipeline.h"
+#include "core/time_utils.h"
+#include "terminal/terminal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Returns true when `budget`, if any, changed the output quality
+static bool write_frame(const OutputDriver *driver, const OutputFrame *frame,
+                        FrameProfiler *profiler, OutputBudget *budget) {
+    terminal_set_display_size(frame->display_width, frame->display_height);
+    const double encode_start = get_time_seconds();
+    terminal_frame_begin();
+    if (driver->uses_character_cells) {
+        safe_write("\x1b[?2026h", 8);
+    }
+    const uint8_t *pixels = frame->shared_pixels ? frame->shared_pixels : frame->pixels;
+    driver->render_frame(pixels, frame->width, frame->height, frame->use_hash_characters);
+
+    if (frame->show_status_bar) {
+        draw_status_bar(frame->status.fps, frame->status.move_speed,
+                        frame->status.camera_position, frame->status.animation_name,
+                        frame->status.has_gpu_timings ? frame->status.gpu_ms : NULL);
+    }
+    if (driver->uses_character_cells) {
+        safe_write("\x1b[?2026l", 8);
+    }
+    const size_t queued_before = budget ? terminal_output_queued() : 0;
+    const double write_start = get_time_seconds();
+    const size_t bytes = terminal_frame_end();
+    const double write_end = get_time_seconds();
+    if (profiler) {
+        frame_profiler_add_time(profiler, FRAME_STAGE_ENCODE, write_start - encode_start);
+        frame_profiler_add_time(profiler, FRAME_STAGE_WRITE, write_end - write_start);
+        frame_profiler_add_bytes(profiler, bytes);
+    }
+    return budget && output_budget_update(budget, write_start, write_end, bytes, queued_before,
+                                          terminal_output_queued());
+}
+
+#ifdef _WIN32
+static unsigned __stdcall output_thread_func(void *arg) {
+#else
+static void *output_thread_func(void *arg) {
+#endif
+    OutputPipeline *pipeline = arg;
+
+    for (;;) {
+        dcat_mutex_lock(&pipeline->mutex);
+        while (!pipeline->has_pending && !pipeline->stopping) {
+            dcat_cond_wait(&pipeline->cond, &pipeline->mutex);
+        }
+        // Until the link has drained the last frame, newer submissions replace the pending one
+        while (pipeline->adaptive_output && !pipeline->stopping) {
+            const double wait =
+                output_budget_next_write_time(&pipeline->budget) - get_time_seconds();
+            if (wait <= 0.0) {
+                break;
+            }
+            dcat_cond_timed_wait(&pipeline->cond, &pipeline->mutex,
+                                 (unsigned int)(wait * 1000.0) + 1U);
+        }
+        if (pipeline->stopping) {
+            dcat_mutex_unlock(&pipeline->mutex);
+            break;
+        }
+
+        OutputFrame *frame = pipeline->pending;
+        pipeline->pending = pipeline->front;
+        pipeline->front = frame;
+        pipeline->has_pending = false;
+        pipeline->writing = true;
+        const bool full_redraw = pipeline->full_redraw;
+        pipeline->full_redraw = false;
+        dcat_mutex_unlock(&pipeline->mutex);
+
+        if (full_redraw && pipeline->driver->invalidate) {
+            pipeline->driver->invalidate();
+        }
+        const double write_start = get_time_seconds();
+        if (write_frame(pipeline->driver, frame, pipeline->profiler,
+                        pipeline->adaptive_output ? &pipeline->budget : NULL)) {
+            pipeline->driver->set_quality(pipeline->budget.quality);
+        }
+        const double write_time = get_time_seconds() - write_start;
+
+        dcat_mutex_lock(&pipeline->mutex);
+        pipeline->last_write_time = write_time;
+        pipeline->writing = false;
+        dcat_cond_broadcast(&pipeline->cond);
+        dcat_mutex_unlock(&pipeline->mutex);
+    }
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool output_pipeline_start(OutputPipeline *pipeline, const OutputDriver *driver,
+                           const double adaptive_frame_time, FrameProfiler *profiler) {
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->driver = driver;
+    pipeline->profiler = profiler;
+    pipeline->adaptive_output = adaptive_frame_time > 0.0;
+    output_budget_init(&pipeline->budget, adaptive_frame_time,
+                       driver->set_quality ? OUTPUT_QUALITY_COARSE : OUTPUT_QUALITY_FULL);
+    pipeline->back = &pipeline->frames[0];
+    pipeline->pending = &pipeline->frames[1];
+    pipeline->front = &pipeline->frames[2];
+
+    if (!dcat_mutex_init(&pipeline->mutex)) {
+        return false;
+    }
+    if (!dcat_cond_init(&pipeline->cond)) {
+        dcat_mutex_destroy(&pipeline->mutex);
+        return false;
+    }
+    if (!dcat_thread_create(&pipeline->thread, output_thread_func, pipeline)) {
+        dcat_cond_destroy(&pipeline->cond);
+        dcat_mutex_destroy(&pipeline->mutex);
+        return false;
+    }
+    pipeline->started = true;
+    return true;
+}
+
+void output_pipeline_stop(OutputPipeline *pipeline) {
+    if (!pipeline->started) {
+        return;
+    }
+
+    dcat_mutex_lock(&pipeline->mutex);
+    pipeline->stopping = true;
+    dcat_cond_signal(&pipeline->cond);
+    dcat_mutex_unlock(&pipeline->mutex);
+    dcat_thread_join(pipeline->thread);
+    terminal_frame_release();
+
+    dcat_cond_destroy(&pipeline->cond);
+    dcat_mutex_destroy(&pipeline->mutex);
+    for (size_t i = 0; i < sizeof(pipeline->frames) / sizeof(pipeline->frames[0]); i++) {
+        free(pipeline->frames[i].pixels);
+    }
+    memset(pipeline, 0, sizeof(*pipeline));
+}
+
+bool output_pipeline_submit(OutputPipeline *pipeline, const uint8_t *framebuffer,
+                            const uint32_t width, const uint32_t height,
+                            const uint32_t display_width, const uint32_t display_height,
+                            const bool use_hash_characters, const bool show_status_bar,
+                            const OutputStatus *status) {
+    OutputFrame *frame = pipeline->back;
+    size_t size = (size_t)width * height * 4U;
+    if (pipeline->driver->cell_format != OUTPUT_CELLS_NONE) {
+        const size_t cols = (width + SYMBOL_CELL_SOURCE_WIDTH - 1U) / SYMBOL_CELL_SOURCE_WIDTH;
+        const size_t rows = (height + SYMBOL_CELL_SOURCE_HEIGHT - 1U) / SYMBOL_CELL_SOURCE_HEIGHT;
+        size = cols * rows * OUTPUT_CELL_BYTES;
+    }
+    frame->shared_pixels = NULL;
+    if (pipeline->driver->owns_frame && pipeline->driver->owns_frame(framebuffer, size)) {
+        frame->shared_pixels = framebuffer;
+    } else if (frame->capacity < size) {
+        uint8_t *pixels = realloc(frame->pixels, size);
+        if (!pixels) {
+            return false;
+        }
+        frame->pixels = pixels;
+        frame->capacity = size;
+    }
+
+    if (!frame->shared_pixels) {
+        memcpy(frame->pixels, framebuffer, size);
+    }
+    frame->width = width;
+    frame->height = height;
+    frame->display_width = display_width;
+    frame->display_height = display_height;
+    frame->use_hash_characters = use_hash_characters;
+    frame->show_status_bar = show_status_bar;
+    frame->status = *status;
+
+    dcat_mutex_lock(&pipeline->mutex);
+    if (pipeline->has_pending) {
+        pipeline->dropped_frames++;
+    }
+    pipeline->back = pipeline->pending;
+    pipeline->pending = frame;
+    pipeline->has_pending = true;
+    dcat_cond_broadcast(&pipeline->cond);
+    dcat_mutex_unlock(&pipeline->mutex);
+    return true;
+}
+
+bool output_pipeline_holds_frame(OutputPipeline *pipeline, const uint8_t *pixels) {
+    if (!pipeline->started) {
+        return false;
+    }
+    // `front` keeps the frame it wrote until the writer takes the next one
+    dcat_mutex_lock(&pipeline->mutex);
+    const bool held = (pipeline->has_pending && pipeline->pending->shared_pixels == pixels) ||
+                      pipeline->front->shared_pixels == pixels;
+    dcat_mutex_unlock(&pipeline->mutex);
+    return held;
+}
+
+void output_pipeline_request_full_redraw(OutputPipeline *pipeline) {
+    if (!pipeline->started) {
+        return;
+    }
+    dcat_mutex_lock(&pipeline->mutex);
+    pipeline->full_redraw = true;
+    dcat_mutex_unlock(&pipeline->mutex);
+}
+
+void output_pipeline_flush(OutputPipeline *pipeline) {
+    if (!pipeline->started) {
+        return;
+    }
+    dcat_mutex_lock(&pipeline->mutex);
+    while ((pipeline->has_pending || pipeline->writing) && !pipeline->stopping) {
+        dcat_cond_wait(&pipeline->cond, &pipeline->mutex);
+    }
+    dcat_mutex_unlock(&pipeline->mutex);
+}
+
+double output_pipeline_last_write_time(OutputPipeline *pipeline) {
+    if (!pipeline->started) {
+        return 0.0;
+    }
+    dcat_mutex_lock(&pipeline->mutex);
+    const double write_time = pipeline->last_write_time;
+    dcat_mutex_unlock(&pipeline->mutex);
+    return write_time;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "core/frame_profiler.h"
+#include "core/threading.h"
+#include "terminal/output_budget.h"
+#include "terminal/output_driver.h"
+#include "terminal/terminal.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest animation name the status bar shows, with its terminator
+#define OUTPUT_STATUS_NAME_SIZE 96
+
+// Status bar values captured together with the frame they describe. Copied whole into the
+// queue, so nothing in it may point at memory the render thread frees.
+typedef struct OutputStatus {
+    float fps;
+    float move_speed;
+    float camera_position[3];
+    char animation_name[OUTPUT_STATUS_NAME_SIZE];
+    bool has_gpu_timings;
+    float gpu_ms[STATUS_GPU_STAGE_COUNT];
+} OutputStatus;
+
+typedef struct OutputFrame {
+    uint8_t *pixels;
+    size_t capacity;
+    const uint8_t *shared_pixels; // set instead of copying when the driver owns the frame
+    uint32_t width;
+    uint32_t height;
+    uint32_t display_width;
+    uint32_t display_height;
+    bool use_hash_characters;
+    bool show_status_bar;
+    OutputStatus status;
+} OutputFrame;
+
+// Hands readback frames from the render loop to a dedicated encode/write thread.
+// The queue holds a single pending frame: submitting while one is still waiting
+// replaces it, so a slow terminal drops stale frames instead of stalling rendering.
+typedef struct OutputPipeline {
+    const OutputDriver *driver;
+    OutputFrame frames[3];
+    OutputFrame *back;    // owned by the render thread
+    OutputFrame *pending; // latest submitted frame
+    OutputFrame *front;   // owned by the writer thread
+    bool has_pending;
+    bool writing;
+    bool full_redraw;
+    bool stopping;
+    uint64_t dropped_frames;
+    double last_write_time; // seconds spent encoding and writing the latest frame
+    FrameProfiler *profiler; // written only by the writer thread
+    // Paces and cheapens output to what the terminal link carries; written only by the
+    // writer thread
+    OutputBudget budget;
+    bool adaptive_output;
+
+    DcatMutex mutex;
+    DcatCond cond;
+    DcatThread thread;
+    bool started;
+} OutputPipeline;
+
+// `adaptive_frame_time`, when positive, is the frame time the output budget holds frames to
+// (see OutputBudget); 0 writes every frame as it comes. `profiler`, when not NULL, records
+// how long each frame took to encode and write and how many bytes it was.
+bool output_pipeline_start(OutputPipeline *pipeline, const OutputDriver *driver,
+                           double adaptive_frame_time, FrameProfiler *profiler);
+void output_pipeline_stop(OutputPipeline *pipeline);
+// Copies the framebuffer, or the cell grid for drivers with a cell_format, so the caller may
+// reuse it as soon as this returns, unless the driver reports owning it (see
+// OutputDriver.owns_frame). The display size is the area the frame should cover, which is
+// larger than the frame when the render resolution has been scaled down.
+bool output_pipeline_submit(OutputPipeline *pipeline, const uint8_t *framebuffer, uint32_t width,
+                            uint32_t height, uint32_t display_width, uint32_t display_height,
+                            bool use_hash_characters, bool show_status_bar,
+                            const OutputStatus *status);
+double output_pipeline_last_write_time(OutputPipeline *pipeline);
+// Blocks until no frame is pending or being written, e.g. before memory that submitted
+// frames may point into is remapped.
+void output_pipeline_flush(OutputPipeline *pipeline);
+// Whether a frame submitted without a copy (see OutputDriver.owns_frame) is still queued or
+// being written, or is the one written last, which the terminal may not have read yet.
+bool output_pipeline_holds_frame(OutputPipeline *pipeline, const uint8_t *pixels);
+// The next frame written skips any incremental encoding and redraws everything.
+void output_pipeline_request_full_redraw(OutputPipeline *pipeline);
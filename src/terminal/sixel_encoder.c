@@ -0,0 +1,498 @@
+#include "terminal/sixel_encoder.h"
+#include "terminal/chafa_driver.h"
+#include "terminal/terminal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Colours are quantized through a 5-bit-per-channel lookup table.
+#define SIXEL_LUT_SIZE 32768U
+// Frames at least this large build their histogram from every SAMPLE_STEP-th pixel.
+#define SIXEL_SAMPLE_STEP 4U
+#define SIXEL_FULL_SAMPLE_PIXELS 65536U
+// The palette is kept while the frame's quantization error stays within this factor
+// (plus a small absolute slack) of the error measured when it was built.
+#define SIXEL_REBUILD_RATIO 1.5
+#define SIXEL_REBUILD_SLACK 16.0
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    uint64_t weight;
+} ColorBox;
+
+typedef struct {
+    uint8_t palette[SIXEL_MAX_COLORS][3];
+    uint32_t palette_size;
+    bool has_palette;
+    double palette_error;
+    uint8_t lut[SIXEL_LUT_SIZE];
+    uint32_t histogram[SIXEL_LUT_SIZE];
+    uint32_t bin_sums[SIXEL_LUT_SIZE][3];
+    uint16_t bins[SIXEL_LUT_SIZE];
+    uint16_t sorted_bins[SIXEL_LUT_SIZE];
+
+    uint8_t *indices;
+    size_t indices_capacity;
+    uint8_t *band_bits;
+    size_t band_bits_capacity;
+
+    char *output;
+    size_t output_size;
+    size_t output_capacity;
+    bool scrolling_disabled;
+} SixelState;
+
+static SixelState *g_sixel;
+
+static const int8_t BAYER_4X4[4][4] = {
+    {-8, 0, -6, 2},
+    {4, -4, 6, -2},
+    {-5, 3, -7, 1},
+    {7, -1, 5, -3},
+};
+
+static inline uint32_t rgb_key(const uint32_t r, const uint32_t g, const uint32_t b) {
+    return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+}
+
+static inline uint32_t key_channel(const uint32_t key, const int channel) {
+    return (key >> (10 - (channel * 5))) & 31U;
+}
+
+static bool output_reserve(const size_t extra) {
+    const size_t needed = g_sixel->output_size + extra;
+    if (needed <= g_sixel->output_capacity) {
+        return true;
+    }
+    size_t capacity = g_sixel->output_capacity ? g_sixel->output_capacity : 65536U;
+    while (capacity < needed) {
+        capacity *= 2U;
+    }
+    char *output = realloc(g_sixel->output, capacity);
+    if (!output) {
+        return false;
+    }
+    g_sixel->output = output;
+    g_sixel->output_capacity = capacity;
+    return true;
+}
+
+// Callers reserve space first; these append without bounds checks.
+static inline void put_char(const char c) {
+    g_sixel->output[g_sixel->output_size++] = c;
+}
+
+static inline void put_uint(uint32_t value) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + (value % 10U));
+        value /= 10U;
+    } while (value > 0);
+    while (count > 0) {
+        put_char(digits[--count]);
+    }
+}
+
+static void build_histogram(const uint8_t *framebuffer, const uint32_t width,
+                            const uint32_t height, const uint32_t step) {
+    memset(g_sixel->histogram, 0, sizeof(g_sixel->histogram));
+    memset(g_sixel->bin_sums, 0, sizeof(g_sixel->bin_sums));
+    for (uint32_t y = 0; y < height; y += step) {
+        const uint8_t *row = framebuffer + ((size_t)y * width * 4U);
+        for (uint32_t x = 0; x < width; x += step) {
+            const uint8_t *p = row + ((size_t)x * 4U);
+            const uint32_t key = rgb_key(p[0], p[1], p[2]);
+            g_sixel->histogram[key]++;
+            g_sixel->bin_sums[key][0] += p[0];
+            g_sixel->bin_sums[key][1] += p[1];
+            g_sixel->bin_sums[key][2] += p[2];
+        }
+    }
+}
+
+// Stable counting sort of bins[start, end) on one 5-bit channel.
+static void sort_box(const ColorBox *box, const int channel) {
+    uint32_t offsets[33] = {0};
+    for (uint32_t i = box->start; i < box->end; i++) {
+        offsets[key_channel(g_sixel->bins[i], channel) + 1U]++;
+    }
+    for (int i = 1; i < 33; i++) {
+        offsets[i] += offsets[i - 1];
+    }
+    for (uint32_t i = box->start; i < box->end; i++) {
+        const uint16_t bin = g_sixel->bins[i];
+        g_sixel->sorted_bins[box->start + offsets[key_channel(bin, channel)]++] = bin;
+    }
+    memcpy(&g_sixel->bins[box->start], &g_sixel->sorted_bins[box->start],
+           (box->end - box->start) * sizeof(uint16_t));
+}
+
+static int widest_channel(const ColorBox *box, uint32_t *out_range) {
+    uint32_t lo[3] = {31, 31, 31};
+    uint32_t hi[3] = {0, 0, 0};
+    for (uint32_t i = box->start; i < box->end; i++) {
+        for (int c = 0; c < 3; c++) {
+            const uint32_t v = key_channel(g_sixel->bins[i], c);
+            lo[c] = v < lo[c] ? v : lo[c];
+            hi[c] = v > hi[c] ? v : hi[c];
+        }
+    }
+    int channel = 0;
+    for (int c = 1; c < 3; c++) {
+        if (hi[c] - lo[c] > hi[channel] - lo[channel]) {
+            channel = c;
+        }
+    }
+    *out_range = hi[channel] - lo[channel];
+    return channel;
+}
+
+// Median cut over the occupied histogram bins.
+static void build_palette(void) {
+    uint32_t bin_count = 0;
+    for (uint32_t key = 0; key < SIXEL_LUT_SIZE; key++) {
+        if (g_sixel->histogram[key] > 0) {
+            g_sixel->bins[bin_count++] = (uint16_t)key;
+        }
+    }
+
+    ColorBox boxes[SIXEL_MAX_COLORS];
+    uint32_t box_count = 1;
+    boxes[0] = (ColorBox){0, bin_count, 0};
+    for (uint32_t i = 0; i < bin_count; i++) {
+        boxes[0].weight += g_sixel->histogram[g_sixel->bins[i]];
+    }
+
+    while (box_count < SIXEL_MAX_COLORS) {
+        uint32_t best = UINT32_MAX;
+        uint64_t best_score = 0;
+        int best_channel = 0;
+        for (uint32_t i = 0; i < box_count; i++) {
+            if (boxes[i].end - boxes[i].start < 2U) {
+                continue;
+            }
+            uint32_t range;
+            const int channel = widest_channel(&boxes[i], &range);
+            const uint64_t score = boxes[i].weight * (uint64_t)range;
+            if (score > best_score) {
+                best = i;
+                best_score = score;
+                best_channel = channel;
+            }
+        }
+        if (best == UINT32_MAX) {
+            break;
+        }
+
+        ColorBox *box = &boxes[best];
+        sort_box(box, best_channel);
+        uint64_t accumulated = 0;
+        uint32_t split = box->start;
+        while (split < box->end - 1U && accumulated * 2U < box->weight) {
+            accumulated += g_sixel->histogram[g_sixel->bins[split]];
+            split++;
+        }
+        if (split == box->start) {
+            split++;
+            accumulated = g_sixel->histogram[g_sixel->bins[box->start]];
+        }
+
+        boxes[box_count] = (ColorBox){split, box->end, box->weight - accumulated};
+        box->end = split;
+        box->weight = accumulated;
+        box_count++;
+    }
+
+    g_sixel->palette_size = box_count;
+    for (uint32_t i = 0; i < box_count; i++) {
+        uint64_t sum[3] = {0, 0, 0};
+        uint64_t weight = 0;
+        for (uint32_t j = boxes[i].start; j < boxes[i].end; j++) {
+            const uint16_t bin = g_sixel->bins[j];
+            for (int c = 0; c < 3; c++) {
+                sum[c] += g_sixel->bin_sums[bin][c];
+            }
+            weight += g_sixel->histogram[bin];
+        }
+        for (int c = 0; c < 3; c++) {
+            g_sixel->palette[i][c] = weight > 0 ? (uint8_t)(sum[c] / weight) : 0;
+        }
+    }
+}
+
+static void build_lut(void) {
+    int32_t pal_r[SIXEL_MAX_COLORS];
+    int32_t pal_g[SIXEL_MAX_COLORS];
+    int32_t pal_b[SIXEL_MAX_COLORS];
+    int32_t distance[SIXEL_MAX_COLORS];
+    const uint32_t count = g_sixel->palette_size;
+    for (uint32_t i = 0; i < count; i++) {
+        pal_r[i] = g_sixel->palette[i][0];
+        pal_g[i] = g_sixel->palette[i][1];
+        pal_b[i] = g_sixel->palette[i][2];
+    }
+
+    for (uint32_t key = 0; key < SIXEL_LUT_SIZE; key++) {
+        const int32_t r = (int32_t)((key_channel(key, 0) << 3) | 4U);
+        const int32_t g = (int32_t)((key_channel(key, 1) << 3) | 4U);
+        const int32_t b = (int32_t)((key_channel(key, 2) << 3) | 4U);
+        // Structure-of-arrays distance pass so the compiler can vectorize it.
+        for (uint32_t i = 0; i < count; i++) {
+            const int32_t dr = pal_r[i] - r;
+            const int32_t dg = pal_g[i] - g;
+            const int32_t db = pal_b[i] - b;
+            distance[i] = (dr * dr) + (dg * dg) + (db * db);
+        }
+        uint32_t best = 0;
+        for (uint32_t i = 1; i < count; i++) {
+            if (distance[i] < distance[best]) {
+                best = i;
+            }
+        }
+        g_sixel->lut[key] = (uint8_t)best;
+    }
+}
+
+static double measure_error(const uint8_t *framebuffer, const uint32_t width,
+                            const uint32_t height, const uint32_t step) {
+    uint64_t error = 0;
+    uint64_t samples = 0;
+    for (uint32_t y = 0; y < height; y += step) {
+        const uint8_t *row = framebuffer + ((size_t)y * width * 4U);
+        for (uint32_t x = 0; x < width; x += step) {
+            const uint8_t *p = row + ((size_t)x * 4U);
+            const uint8_t *q = g_sixel->palette[g_sixel->lut[rgb_key(p[0], p[1], p[2])]];
+            const int32_t dr = (int32_t)p[0] - q[0];
+            const int32_t dg = (int32_t)p[1] - q[1];
+            const int32_t db = (int32_t)p[2] - q[2];
+            error += (uint64_t)((dr * dr) + (dg * dg) + (db * db));
+            samples++;
+        }
+    }
+    return samples > 0 ? (double)error / (double)samples : 0.0;
+}
+
+// Reuses the previous palette while it still fits the frame, so colours stay stable
+// from frame to frame and the median cut only runs when the scene changes.
+static void update_palette(const uint8_t *framebuffer, const uint32_t width,
+                           const uint32_t height) {
+    const uint32_t step =
+        (size_t)width * height >= SIXEL_FULL_SAMPLE_PIXELS ? SIXEL_SAMPLE_STEP : 1U;
+    if (g_sixel->has_palette) {
+        const double error = measure_error(framebuffer, width, height, step);
+        if (error <= (g_sixel->palette_error * SIXEL_REBUILD_RATIO) + SIXEL_REBUILD_SLACK) {
+            return;
+        }
+    }
+
+    build_histogram(framebuffer, width, height, step);
+    build_palette();
+    build_lut();
+    g_sixel->palette_error = measure_error(framebuffer, width, height, step);
+    g_sixel->has_palette = true;
+}
+
+static void map_pixels(const uint8_t *framebuffer, const uint32_t width, const uint32_t height) {
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *row = framebuffer + ((size_t)y * width * 4U);
+        uint8_t *out = g_sixel->indices + ((size_t)y * width);
+        const int8_t *dither = BAYER_4X4[y & 3U];
+        for (uint32_t x = 0; x < width; x++) {
+            const int32_t d = dither[x & 3U];
+            int32_t r = row[(x * 4U) + 0U] + d;
+            int32_t g = row[(x * 4U) + 1U] + d;
+            int32_t b = row[(x * 4U) + 2U] + d;
+            r = r < 0 ? 0 : (r > 255 ? 255 : r);
+            g = g < 0 ? 0 : (g > 255 ? 255 : g);
+            b = b < 0 ? 0 : (b > 255 ? 255 : b);
+            out[x] = g_sixel->lut[rgb_key((uint32_t)r, (uint32_t)g, (uint32_t)b)];
+        }
+    }
+}
+
+static void emit_color_row(const uint8_t *bits, const uint32_t first, const uint32_t last) {
+    if (first >= 4U) {
+        put_char('!');
+        put_uint(first);
+        put_char('?');
+    } else {
+        for (uint32_t i = 0; i < first; i++) {
+            put_char('?');
+        }
+    }
+
+    uint32_t x = first;
+    while (x <= last) {
+        const uint8_t value = bits[x];
+        uint32_t run = 1;
+        while (x + run <= last && bits[x + run] == value) {
+            run++;
+        }
+        const char c = (char)('?' + value);
+        if (run >= 4U) {
+            put_char('!');
+            put_uint(run);
+            put_char(c);
+        } else {
+            for (uint32_t i = 0; i < run; i++) {
+                put_char(c);
+            }
+        }
+        x += run;
+    }
+}
+
+// band_bits rows are all zero between bands; each colour clears only the columns it
+// touched, so sparse colours cost nothing outside their extent.
+static bool emit_bands(const uint32_t width, const uint32_t height) {
+    bool used[SIXEL_MAX_COLORS] = {false};
+    uint8_t used_list[SIXEL_MAX_COLORS];
+    uint32_t first[SIXEL_MAX_COLORS];
+    uint32_t last[SIXEL_MAX_COLORS];
+
+    for (uint32_t band_y = 0; band_y < height; band_y += 6U) {
+        const uint32_t rows = height - band_y < 6U ? height - band_y : 6U;
+        uint32_t used_count = 0;
+
+        for (uint32_t dy = 0; dy < rows; dy++) {
+            const uint8_t *row = g_sixel->indices + ((size_t)(band_y + dy) * width);
+            for (uint32_t x = 0; x < width; x++) {
+                const uint8_t index = row[x];
+                if (!used[index]) {
+                    used[index] = true;
+                    used_list[used_count++] = index;
+                    first[index] = x;
+                    last[index] = x;
+                } else {
+                    first[index] = x < first[index] ? x : first[index];
+                    last[index] = x > last[index] ? x : last[index];
+                }
+                g_sixel->band_bits[((size_t)index * width) + x] |= (uint8_t)(1U << dy);
+            }
+        }
+
+        for (uint32_t i = 0; i < used_count; i++) {
+            const uint8_t index = used_list[i];
+            uint8_t *bits = g_sixel->band_bits + ((size_t)index * width);
+            if (!output_reserve(((size_t)(last[index] - first[index] + 1U) * 2U) + 32U)) {
+                return false;
+            }
+            put_char('#');
+            put_uint(index);
+            emit_color_row(bits, first[index], last[index]);
+            put_char(i + 1U < used_count ? '$' : '-');
+            memset(bits + first[index], 0, last[index] - first[index] + 1U);
+            used[index] = false;
+        }
+    }
+    return true;
+}
+
+static bool ensure_state(const uint32_t width, const uint32_t height) {
+    if (!g_sixel) {
+        g_sixel = calloc(1, sizeof(SixelState));
+        if (!g_sixel) {
+            return false;
+        }
+    }
+
+    const size_t pixel_count = (size_t)width * height;
+    if (g_sixel->indices_capacity < pixel_count) {
+        uint8_t *indices = realloc(g_sixel->indices, pixel_count);
+        if (!indices) {
+            return false;
+        }
+        g_sixel->indices = indices;
+        g_sixel->indices_capacity = pixel_count;
+    }
+
+    const size_t bits_size = (size_t)width * SIXEL_MAX_COLORS;
+    if (g_sixel->band_bits_capacity < bits_size) {
+        uint8_t *bits = realloc(g_sixel->band_bits, bits_size);
+        if (!bits) {
+            return false;
+        }
+        memset(bits, 0, bits_size);
+        g_sixel->band_bits = bits;
+        g_sixel->band_bits_capacity = bits_size;
+    }
+    return true;
+}
+
+const char *sixel_encode(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
+                         size_t *out_length) {
+    *out_length = 0;
+    if (width == 0 || height == 0 || !ensure_state(width, height)) {
+        return NULL;
+    }
+
+    update_palette(framebuffer, width, height);
+    map_pixels(framebuffer, width, height);
+
+    g_sixel->output_size = 0;
+    if (!output_reserve(64U + ((size_t)g_sixel->palette_size * 20U))) {
+        return NULL;
+    }
+    // P2=1 leaves unset pixels alone; raster attributes declare square pixels.
+    memcpy(g_sixel->output, "\x1bP0;1;0q\"1;1;", 13);
+    g_sixel->output_size = 13;
+    put_uint(width);
+    put_char(';');
+    put_uint(height);
+    for (uint32_t i = 0; i < g_sixel->palette_size; i++) {
+        put_char('#');
+        put_uint(i);
+        put_char(';');
+        put_char('2');
+        for (int c = 0; c < 3; c++) {
+            put_char(';');
+            put_uint(((uint32_t)g_sixel->palette[i][c] * 100U + 127U) / 255U);
+        }
+    }
+
+    if (!emit_bands(width, height) || !output_reserve(2U)) {
+        return NULL;
+    }
+    put_char('\x1b');
+    put_char('\\');
+
+    *out_length = g_sixel->output_size;
+    return g_sixel->output;
+}
+
+void render_sixel(const uint8_t *framebuffer, const uint32_t width, const uint32_t height,
+                  const bool use_hash_characters) {
+    // tmux and screen need the DCS wrapped; chafa already knows how.
+    if (chafa_driver_needs_passthrough()) {
+        chafa_driver_render(framebuffer, width, height, use_hash_characters);
+        return;
+    }
+
+    size_t length;
+    const char *sixel = sixel_encode(framebuffer, width, height, &length);
+    if (!sixel) {
+        return;
+    }
+    if (!g_sixel->scrolling_disabled) {
+        safe_write("\x1b[?80h", 6);
+        g_sixel->scrolling_disabled = true;
+    }
+    safe_write("\x1b[H", 3);
+    terminal_write_borrowed(sixel, length);
+}
+
+void sixel_cleanup(void) {
+    if (!g_sixel) {
+        return;
+    }
+    if (g_sixel->scrolling_disabled) {
+        safe_write("\x1b[?80l", 6);
+    }
+    free(g_sixel->indices);
+    free(g_sixel->band_bits);
+    free(g_sixel->output);
+    free(g_sixel);
+    g_sixel = NULL;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIXEL_MAX_COLORS 256
+
+// Encodes an RGBA framebuffer as a complete sixel image (DCS ... ST). The returned
+// buffer is owned by the encoder and stays valid until the next call or cleanup.
+const char *sixel_encode(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                         size_t *out_length);
+void render_sixel(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                  bool use_hash_characters);
+void sixel_cleanup(void);
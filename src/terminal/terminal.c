@@ -1,5 +1,6 @@
 #include "terminal.h"
 #include "platform/io.h"
+#include "terminal/capability_cache.h"
 #include <chafa.h>
 #include <errno.h>
 #include <signal.h>
@@ -9,6 +10,7 @@
 #ifndef _WIN32
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef _WIN32
@@ -40,6 +42,33 @@ static const char TERMINAL_RECOVERY_SEQUENCE[] = "\x1b[?2026l"
                                                  "\x1b[?25h"
                                                  "\x1b[?1049l";
 
+#define TERMINAL_FRAME_INITIAL_CAPACITY (64U * 1024U)
+#define TERMINAL_FRAME_MAX_SEGMENTS 16
+
+// A run of frame output: either bytes in the arena (data == NULL) or a caller-owned
+// buffer that outlives the frame.
+typedef struct {
+    const char *data;
+    size_t offset;
+    size_t length;
+} TerminalFrameSegment;
+
+typedef struct {
+    char *arena;
+    size_t size;
+    size_t capacity;
+    TerminalFrameSegment segments[TERMINAL_FRAME_MAX_SEGMENTS];
+    uint32_t segment_count;
+} TerminalFrameBuffer;
+
+static TerminalFrameBuffer g_frame_buffer;
+// Only the thread that opened the frame is redirected into it.
+static _Thread_local bool g_frame_open = false;
+// Where frames go; stdout unless headless rendering points it at a file
+static int g_output_fd = STDOUT_FILENO;
+// Bytes flushed since the current frame began
+static size_t g_frame_bytes = 0;
+
 #ifndef _WIN32
 static bool get_winsize(struct winsize *ws) {
     return ioctl(STDOUT_FILENO, TIOCGWINSZ, ws) == 0;
@@ -86,6 +115,21 @@ void get_terminal_size_pixels(uint32_t *width, uint32_t *height) {
         return;
     }
 
+    // The first size of a run comes from the capability cache when an earlier run asked this
+    // terminal; resizes still ask, and keep the cache current
+    TerminalCapabilities caps;
+    const bool cached = terminal_capabilities_load(&caps);
+    if (cached_cols == 0 && cached && caps.cell_width > 0 && caps.cell_height > 0 && cols > 0 &&
+        rows > 0) {
+        *width = cols * caps.cell_width;
+        *height = rows * caps.cell_height;
+        cached_cols = cols;
+        cached_rows = rows;
+        cached_pixel_width = *width;
+        cached_pixel_height = *height;
+        return;
+    }
+
     if (dcat_isatty(STDOUT_FILENO) && dcat_isatty(STDIN_FILENO)) {
         TermiosState ts;
         if (terminal_begin_query_mode(&ts)) {
@@ -109,6 +153,12 @@ void get_terminal_size_pixels(uint32_t *width, uint32_t *height) {
                     cached_pixel_width = *width;
                     cached_pixel_height = *height;
                     chafa_term_info_unref(term_info);
+                    if (cols > 0 && rows > 0 &&
+                        (caps.cell_width != *width / cols || caps.cell_height != *height / rows)) {
+                        caps.cell_width = *width / cols;
+                        caps.cell_height = *height / rows;
+                        terminal_capabilities_save(&caps);
+                    }
                     return;
                 }
             }
@@ -172,6 +222,42 @@ void calculate_render_dimensions(int explicit_width, int explicit_height, bool u
     *out_height = use_hash_characters ? rows : rows * SYMBOL_CELL_SOURCE_HEIGHT;
 }
 
+static uint32_t display_width = 0;
+static uint32_t display_height = 0;
+
+void terminal_set_display_size(const uint32_t width, const uint32_t height) {
+    display_width = width;
+    display_height = height;
+}
+
+void terminal_get_display_size(const uint32_t frame_width, const uint32_t frame_height,
+                               uint32_t *out_width, uint32_t *out_height) {
+    *out_width = display_width > 0 ? display_width : frame_width;
+    *out_height = display_height > 0 ? display_height : frame_height;
+}
+
+bool terminal_get_display_cells(const uint32_t frame_width, const uint32_t frame_height,
+                                uint32_t *out_cols, uint32_t *out_rows) {
+    uint32_t width;
+    uint32_t height;
+    terminal_get_display_size(frame_width, frame_height, &width, &height);
+    if (width == frame_width && height == frame_height) {
+        return false;
+    }
+
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    get_terminal_size(&cols, &rows);
+    get_terminal_size_pixels(&pixel_width, &pixel_height);
+    const uint32_t cell_width = cols > 0 && pixel_width >= cols ? pixel_width / cols : 10U;
+    const uint32_t cell_height = rows > 0 && pixel_height >= rows ? pixel_height / rows : 20U;
+    *out_cols = (width + cell_width - 1U) / cell_width;
+    *out_rows = (height + cell_height - 1U) / cell_height;
+    return *out_cols > 0 && *out_rows > 0;
+}
+
 static TermiosState raw_mode_state;
 static bool raw_mode_enabled = false;
 static bool terminal_recovery_registered = false;
@@ -259,28 +345,185 @@ static void terminal_write_fd(const int fd, const char *data, const size_t size)
     }
 }
 
+static bool frame_buffer_copy(const char *data, const size_t size) {
+    TerminalFrameBuffer *frame = &g_frame_buffer;
+    if (frame->size + size > frame->capacity) {
+        size_t capacity = frame->capacity ? frame->capacity : TERMINAL_FRAME_INITIAL_CAPACITY;
+        while (capacity < frame->size + size) {
+            capacity *= 2U;
+        }
+        char *arena = realloc(frame->arena, capacity);
+        if (!arena) {
+            return false;
+        }
+        frame->arena = arena;
+        frame->capacity = capacity;
+    }
+
+    TerminalFrameSegment *last =
+        frame->segment_count > 0 ? &frame->segments[frame->segment_count - 1] : NULL;
+    if (last && !last->data) {
+        last->length += size;
+    } else if (frame->segment_count < TERMINAL_FRAME_MAX_SEGMENTS) {
+        frame->segments[frame->segment_count++] =
+            (TerminalFrameSegment){.data = NULL, .offset = frame->size, .length = size};
+    } else {
+        return false;
+    }
+    memcpy(frame->arena + frame->size, data, size);
+    frame->size += size;
+    return true;
+}
+
+static void frame_buffer_flush(void) {
+    TerminalFrameBuffer *frame = &g_frame_buffer;
+    for (uint32_t i = 0; i < frame->segment_count; i++) {
+        g_frame_bytes += frame->segments[i].length;
+    }
+#ifdef _WIN32
+    // Borrowed data is copied on Windows, so the arena already holds the whole frame.
+    terminal_write_fd(g_output_fd, frame->arena, frame->size);
+#else
+    struct iovec iov[TERMINAL_FRAME_MAX_SEGMENTS];
+    int count = 0;
+    for (uint32_t i = 0; i < frame->segment_count; i++) {
+        const TerminalFrameSegment *segment = &frame->segments[i];
+        if (segment->length == 0) {
+            continue;
+        }
+        iov[count].iov_base =
+            (void *)(segment->data ? segment->data : frame->arena + segment->offset);
+        iov[count].iov_len = segment->length;
+        count++;
+    }
+
+    struct iovec *cursor = iov;
+    while (count > 0) {
+        ssize_t written = writev(g_output_fd, cursor, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        while (count > 0 && (size_t)written >= cursor->iov_len) {
+            written -= (ssize_t)cursor->iov_len;
+            cursor++;
+            count--;
+        }
+        if (count > 0) {
+            cursor->iov_base = (char *)cursor->iov_base + written;
+            cursor->iov_len -= (size_t)written;
+        }
+    }
+#endif
+    frame->size = 0;
+    frame->segment_count = 0;
+}
+
+void terminal_set_output_fd(const int fd) {
+    g_output_fd = fd;
+}
+
+size_t terminal_output_queued(void) {
+#ifdef TIOCOUTQ
+    int queued = 0;
+    if (ioctl(g_output_fd, TIOCOUTQ, &queued) == 0 && queued > 0) {
+        return (size_t)queued;
+    }
+#endif
+    return 0;
+}
+
 void safe_write(const char *data, size_t size) {
-    terminal_write_fd(STDOUT_FILENO, data, size);
+    if (g_frame_open) {
+        if (frame_buffer_copy(data, size)) {
+            return;
+        }
+        // Out of memory or segments: keep ordering by flushing what we have first.
+        frame_buffer_flush();
+    }
+    terminal_write_fd(g_output_fd, data, size);
 }
 
+void terminal_write_borrowed(const char *data, const size_t size) {
+#ifdef _WIN32
+    // Consoles have no gather write; copying keeps the frame to one WriteFile call.
+    safe_write(data, size);
+#else
+    TerminalFrameBuffer *frame = &g_frame_buffer;
+    if (!g_frame_open) {
+        terminal_write_fd(g_output_fd, data, size);
+        return;
+    }
+    if (frame->segment_count >= TERMINAL_FRAME_MAX_SEGMENTS) {
+        frame_buffer_flush();
+    }
+    frame->segments[frame->segment_count++] =
+        (TerminalFrameSegment){.data = data, .offset = 0, .length = size};
+#endif
+}
+
+void terminal_frame_begin(void) {
+    g_frame_open = true;
+    g_frame_bytes = 0;
+}
+
+size_t terminal_frame_end(void) {
+    if (!g_frame_open) {
+        return 0;
+    }
+    g_frame_open = false;
+    frame_buffer_flush();
+    return g_frame_bytes;
+}
+
+void terminal_frame_release(void) {
+    free(g_frame_buffer.arena);
+    memset(&g_frame_buffer, 0, sizeof(g_frame_buffer));
+}
+
+#define B64_CHAR(v)                                                                               \
+    ((v) < 26   ? 'A' + (v)                                                                       \
+     : (v) < 52 ? 'a' + (v) - 26                                                                  \
+     : (v) < 62 ? '0' + (v) - 52                                                                  \
+     : (v) == 62 ? '+'                                                                            \
+                 : '/')
+#define B64_PAIR(v) {(char)B64_CHAR((v) >> 6), (char)B64_CHAR((v) & 63)}
+#define B64_PAIRS_8(v)                                                                             \
+    B64_PAIR(v), B64_PAIR((v) + 1), B64_PAIR((v) + 2), B64_PAIR((v) + 3), B64_PAIR((v) + 4),      \
+        B64_PAIR((v) + 5), B64_PAIR((v) + 6), B64_PAIR((v) + 7)
+#define B64_PAIRS_64(v)                                                                            \
+    B64_PAIRS_8(v), B64_PAIRS_8((v) + 8), B64_PAIRS_8((v) + 16), B64_PAIRS_8((v) + 24),          \
+        B64_PAIRS_8((v) + 32), B64_PAIRS_8((v) + 40), B64_PAIRS_8((v) + 48), B64_PAIRS_8((v) + 56)
+#define B64_PAIRS_512(v)                                                                           \
+    B64_PAIRS_64(v), B64_PAIRS_64((v) + 64), B64_PAIRS_64((v) + 128), B64_PAIRS_64((v) + 192),   \
+        B64_PAIRS_64((v) + 256), B64_PAIRS_64((v) + 320), B64_PAIRS_64((v) + 384),               \
+        B64_PAIRS_64((v) + 448)
+
+// Both output characters for every 12-bit input value, so each 3-byte group is two
+// lookups and two 2-byte stores instead of four of each.
+static const char BASE64_PAIRS[4096][2] = {
+    B64_PAIRS_512(0),    B64_PAIRS_512(512),  B64_PAIRS_512(1024), B64_PAIRS_512(1536),
+    B64_PAIRS_512(2048), B64_PAIRS_512(2560), B64_PAIRS_512(3072), B64_PAIRS_512(3584),
+};
+
 int terminal_base64_encode(const char *src, const int len, char *dst) {
     static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char *in = (const unsigned char *)src;
     int i = 0;
     int j = 0;
     for (; i + 2 < len; i += 3) {
-        const unsigned char a = (unsigned char)src[i];
-        const unsigned char b = (unsigned char)src[i + 1];
-        const unsigned char c = (unsigned char)src[i + 2];
-        dst[j++] = b64[a >> 2];
-        dst[j++] = b64[((a & 3) << 4) | (b >> 4)];
-        dst[j++] = b64[((b & 0xf) << 2) | (c >> 6)];
-        dst[j++] = b64[c & 0x3f];
+        const uint32_t triple = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        memcpy(dst + j, BASE64_PAIRS[triple >> 12], 2);
+        memcpy(dst + j + 2, BASE64_PAIRS[triple & 0xfffU], 2);
+        j += 4;
     }
     if (i < len) {
-        const unsigned char a = (unsigned char)src[i];
+        const unsigned char a = in[i];
         dst[j++] = b64[a >> 2];
         if (i + 1 < len) {
-            const unsigned char b = (unsigned char)src[i + 1];
+            const unsigned char b = in[i + 1];
             dst[j++] = b64[((a & 3) << 4) | (b >> 4)];
             dst[j++] = b64[(b & 0xf) << 2];
         } else {
@@ -294,7 +537,7 @@ int terminal_base64_encode(const char *src, const int len, char *dst) {
 }
 
 void draw_status_bar(const float fps, const float speed, const float *pos,
-                     const char *animation_name) {
+                     const char *animation_name, const float *gpu_ms) {
     uint32_t cols;
     uint32_t rows;
     get_terminal_size(&cols, &rows);
@@ -307,11 +550,16 @@ void draw_status_bar(const float fps, const float speed, const float *pos,
     if (animation_name && animation_name[0]) {
         snprintf(anim_part, sizeof(anim_part), " | ANIM: %s", animation_name);
     }
+    char gpu_part[128] = "";
+    if (gpu_ms) {
+        snprintf(gpu_part, sizeof(gpu_part), " | GPU ms: SKY %.2f OPAQUE %.2f BLEND %.2f READ %.2f",
+                 gpu_ms[0], gpu_ms[1], gpu_ms[2], gpu_ms[3]);
+    }
 
     const int len = snprintf(buffer, sizeof(buffer),
                              "\x1b[%u;1H\x1b[2K\x1b[7m FPS: %.1f | SPEED: "
-                             "%.2f | POS: %.2f, %.2f, %.2f%s \x1b[0m\x1b[H",
-                             rows, fps, speed, pos[0], pos[1], pos[2], anim_part);
+                             "%.2f | POS: %.2f, %.2f, %.2f%s%s \x1b[0m\x1b[H",
+                             rows, fps, speed, pos[0], pos[1], pos[2], anim_part, gpu_part);
     if (len > 0) {
         size_t written = (size_t)len;
         if (written >= sizeof(buffer)) {
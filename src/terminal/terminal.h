@@ -26,8 +26,38 @@ void calculate_render_dimensions(int explicit_width, int explicit_height, bool u
                                  uint32_t *out_width, uint32_t *out_height);
 
 void safe_write(const char *data, size_t size);
+// Redirects safe_write and frame output, e.g. to a file for headless rendering.
+void terminal_set_output_fd(int fd);
+// Bytes written to the terminal that it has not read yet (TIOCOUTQ); 0 where the kernel does
+// not report it
+size_t terminal_output_queued(void);
 
-void draw_status_bar(float fps, float speed, const float *pos, const char *animation_name);
+// Area a frame should cover on screen, in render pixels at full resolution. With a reduced
+// render scale the frame is smaller than this, and drivers whose protocol can stretch an
+// image use it to keep the on-screen size unchanged. Zero means "the frame's own size".
+void terminal_set_display_size(uint32_t width, uint32_t height);
+void terminal_get_display_size(uint32_t frame_width, uint32_t frame_height, uint32_t *out_width,
+                               uint32_t *out_height);
+// Terminal cells covered by the display area of a pixel-protocol frame. Returns false when
+// the frame is shown at its native size and no explicit placement size is needed.
+bool terminal_get_display_cells(uint32_t frame_width, uint32_t frame_height, uint32_t *out_cols,
+                                uint32_t *out_rows);
+
+// Frame output: between begin and end, safe_write on the calling thread appends to a
+// reused arena and the whole frame is flushed with a single gather write. Borrowed data
+// is queued by reference and must stay valid until terminal_frame_end, which returns the
+// number of bytes the frame wrote.
+void terminal_frame_begin(void);
+size_t terminal_frame_end(void);
+void terminal_write_borrowed(const char *data, size_t size);
+void terminal_frame_release(void);
+
+// Stage times shown by draw_status_bar, in the order of its gpu_ms argument
+#define STATUS_GPU_STAGE_COUNT 4
+
+// `gpu_ms`, when not NULL, holds the skydome, opaque, blend and readback GPU times.
+void draw_status_bar(float fps, float speed, const float *pos, const char *animation_name,
+                     const float *gpu_ms);
 
 typedef struct {
 #ifdef _WIN32
@@ -0,0 +1,122 @@
+#pragma once
+// Harness shared by the benchmark() targets. Every case runs DCAT_BENCH_WARMUP untimed
+// and DCAT_BENCH_REPEAT timed iterations (defaults below), and each executable writes
+// its results as one JSON document to the path in argv[1], or stdout without one.
+#include "core/time_utils.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DEFAULT_WARMUP 2U
+#define BENCH_DEFAULT_REPEAT 10U
+
+#ifndef SPOT_MODEL_DIR
+#define SPOT_MODEL_DIR "fixtures/spot"
+#endif
+
+typedef struct Bench {
+    uint32_t warmup;
+    uint32_t repeat;
+    FILE *out;
+    uint32_t result_count;
+    double *samples;
+} Bench;
+
+// One iteration of a case; returns false on failure, which ends the benchmark
+typedef bool (*BenchIteration)(void *context);
+
+static const char *bench_fixture(const char *name) {
+    static char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", SPOT_MODEL_DIR, name);
+    return path;
+}
+
+static uint32_t bench_env_count(const char *name, const uint32_t fallback) {
+    const char *value = getenv(name);
+    if (!value || !value[0]) {
+        return fallback;
+    }
+    char *end = NULL;
+    const unsigned long parsed = strtoul(value, &end, 10);
+    if (*end != '\0' || parsed > 100000UL) {
+        fprintf(stderr, "Ignoring invalid %s: %s\n", name, value);
+        return fallback;
+    }
+    return (uint32_t)parsed;
+}
+
+static bool bench_begin(Bench *bench, const char *name, const int argc, char **argv) {
+    memset(bench, 0, sizeof(*bench));
+    bench->warmup = bench_env_count("DCAT_BENCH_WARMUP", BENCH_DEFAULT_WARMUP);
+    bench->repeat = bench_env_count("DCAT_BENCH_REPEAT", BENCH_DEFAULT_REPEAT);
+    if (bench->repeat == 0) {
+        bench->repeat = 1;
+    }
+    bench->samples = malloc(bench->repeat * sizeof(double));
+    bench->out = argc > 1 ? fopen(argv[1], "w") : stdout;
+    if (!bench->samples || !bench->out) {
+        fprintf(stderr, "Failed to set up benchmark %s\n", name);
+        free(bench->samples);
+        return false;
+    }
+    fprintf(bench->out, "{\"benchmark\": \"%s\", \"warmup\": %u, \"repeat\": %u, \"results\": [",
+            name, bench->warmup, bench->repeat);
+    return true;
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Times `iteration` and reports it as `case_name`. Each iteration covers `items` units of
+// work (frames, calls), and the times are reported per item; `bytes` is the data one item
+// processes, for a throughput figure, or 0.
+static bool bench_case(Bench *bench, const char *case_name, const BenchIteration iteration,
+                       void *context, const uint32_t items, const double bytes) {
+    for (uint32_t i = 0; i < bench->warmup; i++) {
+        if (!iteration(context)) {
+            fprintf(stderr, "%s failed\n", case_name);
+            return false;
+        }
+    }
+    double total = 0.0;
+    for (uint32_t i = 0; i < bench->repeat; i++) {
+        const double start = get_time_seconds();
+        if (!iteration(context)) {
+            fprintf(stderr, "%s failed\n", case_name);
+            return false;
+        }
+        bench->samples[i] = (get_time_seconds() - start) / (double)items;
+        total += bench->samples[i];
+    }
+    qsort(bench->samples, bench->repeat, sizeof(double), bench_compare_double);
+    const double median = bench->samples[bench->repeat / 2U];
+
+    fprintf(bench->out,
+            "%s\n  {\"case\": \"%s\", \"unit\": \"ms\", \"min\": %.4f, \"median\": %.4f, "
+            "\"mean\": %.4f, \"max\": %.4f",
+            bench->result_count > 0 ? "," : "", case_name, bench->samples[0] * 1e3,
+            median * 1e3, total / bench->repeat * 1e3, bench->samples[bench->repeat - 1U] * 1e3);
+    if (bytes > 0.0) {
+        fprintf(bench->out, ", \"mb_per_s\": %.2f", bytes / median / 1e6);
+    }
+    fprintf(bench->out, "}");
+    bench->result_count++;
+    printf("%-40s median %.4f ms\n", case_name, median * 1e3);
+    return true;
+}
+
+static int bench_end(Bench *bench, const bool ok) {
+    fprintf(bench->out, "\n]}\n");
+    const bool written = fflush(bench->out) == 0 && !ferror(bench->out);
+    if (bench->out != stdout) {
+        fclose(bench->out);
+    }
+    free(bench->samples);
+    return ok && written ? 0 : 1;
+}
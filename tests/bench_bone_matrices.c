@@ -0,0 +1,112 @@
+#include "bench.h"
+#include "graphics/animation.h"
+
+// Pose evaluations per timed iteration; a single call is too short to time on its own
+#define CALLS_PER_ITERATION 200U
+#define KEYS_PER_TRACK 48U
+
+typedef struct PoseCase {
+    Skeleton skeleton;
+    Animation animation;
+    mat4 *bone_matrices;
+    uint32_t *key_cursors;
+    float time;
+} PoseCase;
+
+// A binary tree of `bone_count` bones, each with position, rotation and scale tracks
+static void build_rig(PoseCase *pose, const uint32_t bone_count) {
+    memset(pose, 0, sizeof(*pose));
+    bone_map_init(&pose->skeleton.bone_map);
+    bone_anim_map_init(&pose->animation.bone_anim_map);
+    glm_mat4_identity(pose->skeleton.global_inverse_transform);
+    pose->animation.name = str_dup("bench");
+    pose->animation.duration = (float)KEYS_PER_TRACK;
+    pose->animation.ticks_per_second = 24.0F;
+
+    for (uint32_t i = 0; i < bone_count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "bone%u", i);
+
+        BoneNode node = {.name = str_dup(name), .parent_index = i == 0 ? -1 : (int)(i - 1) / 2};
+        glm_mat4_identity(node.transformation);
+        glm_quat_identity(node.initial_rotation);
+        glm_vec3_one(node.initial_scale);
+        ARRAY_INIT(node.child_indices);
+        ARRAY_PUSH(pose->skeleton.bone_hierarchy, node);
+        if (i > 0) {
+            ARRAY_PUSH(pose->skeleton.bone_hierarchy.data[(i - 1) / 2].child_indices, (int)i);
+        }
+
+        BoneInfo info = {.name = str_dup(name), .index = (int)i};
+        glm_mat4_identity(info.offset_matrix);
+        ARRAY_PUSH(pose->skeleton.bones, info);
+        bone_map_insert(&pose->skeleton.bone_map, name, (int)i);
+
+        BoneAnimation track = {.bone_name = str_dup(name)};
+        for (uint32_t k = 0; k < KEYS_PER_TRACK; k++) {
+            const float t = (float)k;
+            const float phase = (t * 0.13F) + ((float)i * 0.7F);
+            VectorKey position = {t, {sinf(phase) * 0.1F, 1.0F, cosf(phase) * 0.1F}};
+            VectorKey scale = {t, {1.0F, 1.0F, 1.0F}};
+            QuaternionKey rotation = {t, {0.0F, 0.0F, 0.0F, 1.0F}};
+            glm_quatv(rotation.value, phase * 0.2F, (vec3){0.0F, 0.0F, 1.0F});
+            ARRAY_PUSH(track.position_keys, position);
+            ARRAY_PUSH(track.scale_keys, scale);
+            ARRAY_PUSH(track.rotation_keys, rotation);
+        }
+        ARRAY_PUSH(pose->animation.bone_animations, track);
+        bone_anim_map_insert(&pose->animation.bone_anim_map, name, (int)i);
+    }
+    skeleton_flatten(&pose->skeleton);
+    animation_bind_skeleton(&pose->animation, &pose->skeleton);
+    pose->key_cursors = calloc((size_t)bone_count * 3, sizeof(uint32_t));
+}
+
+static bool evaluate_poses(void *context) {
+    PoseCase *pose = context;
+    for (uint32_t i = 0; i < CALLS_PER_ITERATION; i++) {
+        compute_bone_matrices(&pose->skeleton, &pose->animation, pose->time, pose->key_cursors,
+                              pose->bone_matrices);
+        // Step between keys so every call interpolates
+        pose->time += 0.37F;
+        if (pose->time >= pose->animation.duration) {
+            pose->time -= pose->animation.duration;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Bench bench;
+    if (!bench_begin(&bench, "compute_bone_matrices", argc, argv)) {
+        return 1;
+    }
+    mat4 *bone_matrices = aligned_malloc(MAX_BONES * sizeof(mat4));
+    bool ok = bone_matrices != NULL;
+    static const uint32_t bone_counts[] = {16, 64, MAX_BONES};
+    for (size_t i = 0; i < sizeof(bone_counts) / sizeof(bone_counts[0]) && ok; i++) {
+        PoseCase pose;
+        build_rig(&pose, bone_counts[i]);
+        pose.bone_matrices = bone_matrices;
+        char case_name[32];
+        snprintf(case_name, sizeof(case_name), "%u_bones", bone_counts[i]);
+        ok = bench_case(&bench, case_name, evaluate_poses, &pose, CALLS_PER_ITERATION, 0.0);
+
+        // The same rig from compressed tracks, as load_model leaves them
+        if (ok && animation_compress(&pose.animation)) {
+            snprintf(case_name, sizeof(case_name), "%u_bones_compressed", bone_counts[i]);
+            ok = bench_case(&bench, case_name, evaluate_poses, &pose, CALLS_PER_ITERATION, 0.0);
+        }
+
+        // The same rig from fixed-rate tracks (--animation-rate 30)
+        if (ok && animation_resample(&pose.animation, 30.0F)) {
+            snprintf(case_name, sizeof(case_name), "%u_bones_resampled", bone_counts[i]);
+            ok = bench_case(&bench, case_name, evaluate_poses, &pose, CALLS_PER_ITERATION, 0.0);
+        }
+        skeleton_free(&pose.skeleton);
+        animation_free(&pose.animation);
+        free(pose.key_cursors);
+    }
+    aligned_free(bone_matrices);
+    return bench_end(&bench, ok);
+}
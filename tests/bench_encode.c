@@ -0,0 +1,116 @@
+#include "bench.h"
+#include "core/args.h"
+#include "terminal/block_encoder.h"
+#include "terminal/chafa_driver.h"
+#include "terminal/driver_factory.h"
+#include "terminal/iterm2_encoder.h"
+#include "terminal/kitty_direct.h"
+#include "terminal/sixel_encoder.h"
+#include "terminal/terminal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Frames encoded per timed iteration
+#define FRAMES_PER_ITERATION 4U
+
+typedef struct EncodeCase {
+    const OutputDriver *driver;
+    const uint8_t *frames[2];
+    uint32_t width;
+    uint32_t height;
+} EncodeCase;
+
+// The same path as a headless encoded frame: every frame is written in full
+static bool encode_frames(void *context) {
+    const EncodeCase *encode = context;
+    for (uint32_t i = 0; i < FRAMES_PER_ITERATION; i++) {
+        if (encode->driver->invalidate) {
+            encode->driver->invalidate();
+        }
+        terminal_set_display_size(encode->width, encode->height);
+        terminal_frame_begin();
+        encode->driver->render_frame(encode->frames[i % 2U], encode->width, encode->height,
+                                     false);
+        terminal_frame_end();
+    }
+    return true;
+}
+
+// Smooth gradients with a moving stripe, so consecutive frames differ like a spinning model
+static uint8_t *make_frame(const uint32_t width, const uint32_t height, const uint32_t phase) {
+    uint8_t *frame = malloc((size_t)width * height * 4U);
+    if (!frame) {
+        return NULL;
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint8_t *pixel = frame + (((size_t)y * width) + x) * 4U;
+            const bool stripe = ((x + y + (phase * 8U)) / 16U) % 4U == 0;
+            pixel[0] = (uint8_t)(x * 255U / width);
+            pixel[1] = (uint8_t)(y * 255U / height);
+            pixel[2] = stripe ? 255U : 64U;
+            pixel[3] = 255U;
+        }
+    }
+    return frame;
+}
+
+typedef struct DriverChoice {
+    const char *name;
+    Args args;
+} DriverChoice;
+
+int main(int argc, char **argv) {
+    Bench bench;
+    if (!bench_begin(&bench, "encode", argc, argv)) {
+        return 1;
+    }
+    const int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd == -1) {
+        fprintf(stderr, "Failed to open /dev/null\n");
+        return bench_end(&bench, false);
+    }
+    terminal_set_output_fd(null_fd);
+
+    static const DriverChoice drivers[] = {
+        {"kitty_shm", {.use_kitty_shm = true}},
+        {"kitty_direct", {.use_kitty = true}},
+        {"sixel", {.use_sixel = true}},
+        {"truecolor", {.use_truecolor_characters = true}},
+        {"palette", {.use_palette_characters = true}},
+        {"block", {.use_block_characters = true}},
+        {"half_blocks", {.use_truecolor_characters = true, .use_native_characters = true}},
+        {"quadrant_blocks", {.use_block_characters = true, .use_native_characters = true}},
+    };
+    static const uint32_t sizes[][2] = {{160, 96}, {320, 192}, {640, 384}};
+
+    bool ok = true;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && ok; s++) {
+        EncodeCase encode = {.width = sizes[s][0], .height = sizes[s][1]};
+        uint8_t *frame_a = make_frame(encode.width, encode.height, 0);
+        uint8_t *frame_b = make_frame(encode.width, encode.height, 1);
+        ok = frame_a && frame_b;
+        encode.frames[0] = frame_a;
+        encode.frames[1] = frame_b;
+        for (size_t d = 0; d < sizeof(drivers) / sizeof(drivers[0]) && ok; d++) {
+            encode.driver = driver_factory_get(&drivers[d].args);
+            char case_name[64];
+            snprintf(case_name, sizeof(case_name), "%s_%ux%u", drivers[d].name, encode.width,
+                     encode.height);
+            ok = bench_case(&bench, case_name, encode_frames, &encode, FRAMES_PER_ITERATION,
+                            (double)encode.width * encode.height * 4.0);
+        }
+        free(frame_a);
+        free(frame_b);
+    }
+
+    terminal_set_output_fd(STDOUT_FILENO);
+    chafa_driver_cleanup();
+    kitty_direct_cleanup();
+    sixel_cleanup();
+    iterm2_cleanup();
+    block_encoder_cleanup();
+    close(null_fd);
+    return bench_end(&bench, ok);
+}
@@ -0,0 +1,54 @@
+#include "bench.h"
+#include "core/app.h"
+#include "core/args.h"
+
+// Frames rendered per timed iteration, i.e. per headless run
+#define HEADLESS_FRAMES "30"
+#define FRAMES_PER_ITERATION 30U
+
+static bool run_headless(void *context) {
+    return app_run_loop(context) == 0;
+}
+
+// argv[1] is the results path; anything after it is passed to dcat, e.g. --cpu-render.
+// libvips cannot be initialized twice, so one process times one configuration.
+int main(int argc, char **argv) {
+    Bench bench;
+    if (!bench_begin(&bench, "headless_frame", argc, argv)) {
+        return 1;
+    }
+    char model_path[1024];
+    char texture_path[1024];
+    snprintf(model_path, sizeof(model_path), "%s", bench_fixture("spot_triangulated.obj"));
+    snprintf(texture_path, sizeof(texture_path), "%s", bench_fixture("spot_texture.png"));
+
+    enum { BASE_ARG_COUNT = 16, MAX_EXTRA_ARGS = 8 };
+    char *dcat_argv[BASE_ARG_COUNT + MAX_EXTRA_ARGS] = {
+        "dcat",     model_path, "-t", texture_path, "--headless", "rgba", "-o", "/dev/null",
+        "--frames", HEADLESS_FRAMES, "-W", "512", "-H", "512", "--spin", "1",
+    };
+    int dcat_argc = BASE_ARG_COUNT;
+    char case_name[128] = "spot_512x512";
+    for (int i = 2; i < argc && dcat_argc < BASE_ARG_COUNT + MAX_EXTRA_ARGS; i++) {
+        dcat_argv[dcat_argc++] = argv[i];
+        const size_t used = strlen(case_name);
+        snprintf(case_name + used, sizeof(case_name) - used, "_%s", argv[i] + strspn(argv[i], "-"));
+    }
+
+    Args args = {0};
+    if (parse_args(dcat_argc, dcat_argv, &args) != ARGS_PARSE_OK || !validate_args(&args)) {
+        fprintf(stderr, "Invalid headless benchmark arguments\n");
+        return bench_end(&bench, false);
+    }
+    AppContext *app = app_create();
+    if (!app) {
+        return bench_end(&bench, false);
+    }
+    bool ok = app_init(app, &args, argv[0]);
+    if (ok) {
+        ok = bench_case(&bench, case_name, run_headless, app, FRAMES_PER_ITERATION, 0.0);
+    }
+    app_cleanup(app);
+    app_destroy(app);
+    return bench_end(&bench, ok);
+}
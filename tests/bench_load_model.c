@@ -0,0 +1,34 @@
+#include "bench.h"
+#include "graphics/model.h"
+
+typedef struct LoadCase {
+    char path[1024];
+} LoadCase;
+
+static bool load_once(void *context) {
+    const LoadCase *load = context;
+    Mesh mesh;
+    mesh_init(&mesh);
+    bool has_uvs = false;
+    MaterialInfo *materials = NULL;
+    size_t material_count = 0;
+    const bool ok = load_model(load->path, &mesh, &has_uvs, &materials, &material_count);
+    materials_free(materials, material_count);
+    mesh_free(&mesh);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    Bench bench;
+    if (!bench_begin(&bench, "load_model", argc, argv)) {
+        return 1;
+    }
+    static const char *const fixtures[] = {"spot_triangulated.obj", "spot_quadrangulated.obj"};
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]) && ok; i++) {
+        LoadCase load;
+        snprintf(load.path, sizeof(load.path), "%s", bench_fixture(fixtures[i]));
+        ok = bench_case(&bench, fixtures[i], load_once, &load, 1, 0.0);
+    }
+    return bench_end(&bench, ok);
+}
@@ -0,0 +1,349 @@
+#include "graphics/animation.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+static Skeleton g_skeleton;
+static Animation g_animation;
+
+static void add_node(const char *name, const int parent_index, const float offset_y) {
+    BoneNode node = {.name = str_dup(name), .parent_index = parent_index};
+    glm_translate_make(node.transformation, (vec3){0.0F, offset_y, 0.0F});
+    glm_vec3_copy((vec3){0.0F, offset_y, 0.0F}, node.initial_position);
+    glm_quat_identity(node.initial_rotation);
+    glm_vec3_one(node.initial_scale);
+    ARRAY_INIT(node.child_indices);
+    ARRAY_PUSH(g_skeleton.bone_hierarchy, node);
+}
+
+static void add_bone(const char *name) {
+    BoneInfo bone = {.name = str_dup(name), .index = (int)g_skeleton.bones.count};
+    glm_mat4_identity(bone.offset_matrix);
+    ARRAY_PUSH(g_skeleton.bones, bone);
+    bone_map_insert(&g_skeleton.bone_map, name, bone.index);
+}
+
+// root -> arm -> hand, stored children first so the order has to come from the hierarchy.
+// "arm" slides along X with time; "ghost" is a bone no node drives.
+void setUp(void) {
+    memset(&g_skeleton, 0, sizeof(g_skeleton));
+    memset(&g_animation, 0, sizeof(g_animation));
+    bone_map_init(&g_skeleton.bone_map);
+    glm_mat4_identity(g_skeleton.global_inverse_transform);
+
+    add_node("hand", 2, 1.0F);
+    add_node("root", -1, 0.0F);
+    add_node("arm", 1, 0.0F);
+    ARRAY_PUSH(g_skeleton.bone_hierarchy.data[1].child_indices, 2);
+    ARRAY_PUSH(g_skeleton.bone_hierarchy.data[2].child_indices, 0);
+    add_bone("hand");
+    add_bone("arm");
+    add_bone("ghost");
+
+    g_animation.name = str_dup("slide");
+    g_animation.duration = 2.0F;
+    bone_anim_map_init(&g_animation.bone_anim_map);
+    BoneAnimation channel = {.bone_name = str_dup("arm")};
+    for (int i = 0; i < 2; i++) {
+        VectorKey position = {.time = 2.0F * (float)i, .value = {2.0F * (float)i, 0.0F, 0.0F}};
+        ARRAY_PUSH(channel.position_keys, position);
+    }
+    ARRAY_PUSH(g_animation.bone_animations, channel);
+    bone_anim_map_insert(&g_animation.bone_anim_map, "arm", 0);
+}
+
+void tearDown(void) {
+    skeleton_free(&g_skeleton);
+    animation_free(&g_animation);
+}
+
+static void test_flatten_orders_parents_first(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    TEST_ASSERT_EQUAL_size_t(3, g_skeleton.node_order_count);
+    TEST_ASSERT_EQUAL_INT(1, g_skeleton.node_order[0]);
+    TEST_ASSERT_EQUAL_INT(2, g_skeleton.node_order[1]);
+    TEST_ASSERT_EQUAL_INT(0, g_skeleton.node_order[2]);
+    TEST_ASSERT_EQUAL_INT(0, g_skeleton.node_bones[0]);
+    TEST_ASSERT_EQUAL_INT(-1, g_skeleton.node_bones[1]);
+    TEST_ASSERT_EQUAL_INT(1, g_skeleton.node_bones[2]);
+    TEST_ASSERT_EQUAL_size_t(1, g_skeleton.unposed_bone_count);
+    TEST_ASSERT_EQUAL_INT(2, g_skeleton.unposed_bones[0]);
+}
+
+static void test_pose_follows_the_chain(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    mat4 bones[3];
+    memset(bones, 0x7F, sizeof(bones));
+
+    compute_bone_matrices(&g_skeleton, &g_animation, 1.0F, NULL, bones);
+    // The arm is halfway along its track, and the hand sits one unit above it
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, bones[1][3][0]);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, bones[1][3][1]);
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, bones[0][3][0]);
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, bones[0][3][1]);
+    mat4 identity;
+    glm_mat4_identity(identity);
+    TEST_ASSERT_EQUAL_MEMORY(identity, bones[2], sizeof(mat4));
+}
+
+// Without bone_node_to_anim the channels are found by name, with the same result
+static void test_unbound_animation_matches_bound(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    mat4 unbound[3];
+    compute_bone_matrices(&g_skeleton, &g_animation, 0.5F, NULL, unbound);
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    mat4 bound[3];
+    compute_bone_matrices(&g_skeleton, &g_animation, 0.5F, NULL, bound);
+    TEST_ASSERT_EQUAL_MEMORY(bound, unbound, sizeof(bound));
+}
+
+// Gives the arm a track of `count` position keys, one tick apart, moving 1 per tick in X
+// with a bump at every odd key, so finding the wrong key shows in the result
+static void set_arm_track(const int count) {
+    VectorKeyArray *keys = &g_animation.bone_animations.data[0].position_keys;
+    keys->count = 0;
+    for (int i = 0; i < count; i++) {
+        VectorKey key = {.time = (float)i, .value = {(float)i, (float)(i % 2), 0.0F}};
+        ARRAY_PUSH(*keys, key);
+    }
+    g_animation.duration = (float)(count - 1);
+}
+
+// Cursors carried between calls give the binary search's answer going forward, after a
+// jump backwards and past the last key
+static void test_cursors_match_search(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    set_arm_track(16);
+
+    uint32_t cursors[3] = {0};
+    static const float times[] = {0.0F, 0.25F, 1.5F, 2.0F, 2.1F, 9.75F, 3.5F, 15.0F, 20.0F, 0.5F};
+    for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+        mat4 searched[3];
+        mat4 cursored[3];
+        compute_bone_matrices(&g_skeleton, &g_animation, times[i], NULL, searched);
+        compute_bone_matrices(&g_skeleton, &g_animation, times[i], cursors, cursored);
+        TEST_ASSERT_EQUAL_MEMORY(searched, cursored, sizeof(searched));
+    }
+}
+
+// Resampling at the keys' own rate reproduces the keys; between frames it interpolates
+static void test_resampled_pose_matches_keys(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    set_arm_track(8);
+    g_animation.ticks_per_second = 1.0F;
+    TEST_ASSERT_TRUE(animation_resample(&g_animation, 2.0F));
+    TEST_ASSERT_NOT_NULL(g_animation.samples);
+    TEST_ASSERT_EQUAL_UINT32(15, g_animation.samples->frame_count);
+    TEST_ASSERT_EQUAL_UINT8(ANIMATION_KEYS_POSITION, g_animation.samples->channel_keys[0]);
+
+    static const float times[] = {0.0F, 0.5F, 3.0F, 5.25F, 7.0F};
+    for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+        mat4 sampled[3];
+        compute_bone_matrices(&g_skeleton, &g_animation, times[i], NULL, sampled);
+        vec3 expected;
+        interpolate_position(&g_animation.bone_animations.data[0].position_keys, times[i],
+                             expected);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5F, expected[0], sampled[1][3][0]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5F, expected[1], sampled[1][3][1]);
+        // The hand keeps its bind pose on top of the arm
+        TEST_ASSERT_FLOAT_WITHIN(1e-5F, expected[1] + 1.0F, sampled[0][3][1]);
+    }
+}
+
+// Gives the arm `count` keys a tick apart of a slow sway and turn about Z, with a scale that
+// holds still, as a long mocap track would
+static void set_arm_sway(const int count) {
+    BoneAnimation *channel = &g_animation.bone_animations.data[0];
+    channel->position_keys.count = 0;
+    for (int i = 0; i < count; i++) {
+        const float t = (float)i;
+        VectorKey position = {.time = t, .value = {sinf(t * 0.01F), 0.5F * cosf(t * 0.02F), 0.0F}};
+        ARRAY_PUSH(channel->position_keys, position);
+        QuaternionKey rotation = {.time = t};
+        glm_quatv(rotation.value, 0.8F * sinf(t * 0.015F), (vec3){0.0F, 0.0F, 1.0F});
+        ARRAY_PUSH(channel->rotation_keys, rotation);
+        VectorKey scale = {.time = t, .value = {1.0F, 1.0F, 1.0F}};
+        ARRAY_PUSH(channel->scale_keys, scale);
+    }
+    g_animation.duration = (float)(count - 1);
+}
+
+static void assert_poses_within(const mat4 *expected, const mat4 *actual, const float delta) {
+    for (int b = 0; b < 3; b++) {
+        for (int column = 0; column < 4; column++) {
+            for (int row = 0; row < 4; row++) {
+                TEST_ASSERT_FLOAT_WITHIN(delta, expected[b][column][row], actual[b][column][row]);
+            }
+        }
+    }
+}
+
+// Compression drops most keys of a smooth track and one that holds still, and poses stay
+// close to the keys' own
+static void test_compressed_pose_follows_keys(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    set_arm_sway(1200);
+
+    static const float times[] = {0.0F, 0.5F, 100.25F, 417.0F, 900.75F, 1199.0F, 1500.0F};
+    enum { TIME_COUNT = sizeof(times) / sizeof(times[0]) };
+    mat4 expected[TIME_COUNT][3];
+    for (size_t i = 0; i < TIME_COUNT; i++) {
+        compute_bone_matrices(&g_skeleton, &g_animation, times[i], NULL, expected[i]);
+    }
+    const size_t raw_size = 1200 * ((2 * sizeof(VectorKey)) + sizeof(QuaternionKey));
+
+    TEST_ASSERT_TRUE(animation_compress(&g_animation));
+    TEST_ASSERT_NOT_NULL(g_animation.compressed);
+    TEST_ASSERT_EQUAL_size_t(0, g_animation.bone_animations.count);
+    TEST_ASSERT_EQUAL_size_t(1, animation_channel_count(&g_animation));
+    TEST_ASSERT_EQUAL_UINT32(1, g_animation.compressed->tracks[2].key_count);
+    TEST_ASSERT_LESS_THAN_size_t(raw_size / 5, g_animation.compressed->size);
+
+    for (size_t i = 0; i < TIME_COUNT; i++) {
+        mat4 compressed[3];
+        compute_bone_matrices(&g_skeleton, &g_animation, times[i], NULL, compressed);
+        assert_poses_within(expected[i], compressed, 3e-3F);
+    }
+
+    // Resampling reads the compressed tracks
+    g_animation.ticks_per_second = 1.0F;
+    TEST_ASSERT_TRUE(animation_resample(&g_animation, 1.0F));
+    TEST_ASSERT_EQUAL_UINT8(ANIMATION_KEYS_POSITION | ANIMATION_KEYS_ROTATION |
+                                ANIMATION_KEYS_SCALE,
+                            g_animation.samples->channel_keys[0]);
+    mat4 resampled[3];
+    compute_bone_matrices(&g_skeleton, &g_animation, times[3], NULL, resampled);
+    assert_poses_within(expected[3], resampled, 3e-3F);
+}
+
+// Quantization of a track whose range is wide next to its tolerance does not push the
+// decoded track past the tolerance: the extra channels, each one unit from its parent, set
+// positions' tolerance to 1e-3 while the arm travels 100 units
+static void test_compressed_wide_track_stays_within_tolerance(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    for (int c = 0; c < 4; c++) {
+        BoneAnimation still = {.bone_name = str_dup("still")};
+        VectorKey position = {.time = 0.0F, .value = {0.0F, 1.0F, 0.0F}};
+        ARRAY_PUSH(still.position_keys, position);
+        ARRAY_PUSH(g_animation.bone_animations, still);
+    }
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    const int count = 4000;
+    VectorKeyArray *keys = &g_animation.bone_animations.data[0].position_keys;
+    keys->count = 0;
+    for (int i = 0; i < count; i++) {
+        const float t = (float)i;
+        VectorKey key = {.time = t,
+                         .value = {t * 0.025F, 0.3F * sinf(t * 0.05F), 0.002F * sinf(t * 0.7F)}};
+        ARRAY_PUSH(*keys, key);
+    }
+    g_animation.duration = (float)(count - 1);
+    VectorKey *expected = malloc((size_t)count * sizeof(VectorKey));
+    TEST_ASSERT_NOT_NULL(expected);
+    memcpy(expected, keys->data, (size_t)count * sizeof(VectorKey));
+
+    TEST_ASSERT_TRUE(animation_compress(&g_animation));
+    TEST_ASSERT_LESS_THAN_UINT32((uint32_t)count, g_animation.compressed->tracks[0].key_count);
+    for (int i = 0; i < count; i++) {
+        mat4 bones[3];
+        compute_bone_matrices(&g_skeleton, &g_animation, expected[i].time, NULL, bones);
+        for (int c = 0; c < 3; c++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3F, expected[i].value[c], bones[1][3][c]);
+        }
+    }
+    free(expected);
+}
+
+// Cursors over compressed tracks give the binary search's answer, as over the keys
+static void test_compressed_cursors_match_search(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    set_arm_track(16);
+    TEST_ASSERT_TRUE(animation_compress(&g_animation));
+    // The bumps leave every key in place
+    TEST_ASSERT_EQUAL_UINT32(16, g_animation.compressed->tracks[0].key_count);
+    TEST_ASSERT_EQUAL_UINT32(0, g_animation.compressed->tracks[1].key_count);
+
+    uint32_t cursors[3] = {0};
+    static const float times[] = {0.0F, 0.25F, 1.5F, 2.0F, 2.1F, 9.75F, 3.5F, 15.0F, 20.0F, 0.5F};
+    for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+        mat4 searched[3];
+        mat4 cursored[3];
+        compute_bone_matrices(&g_skeleton, &g_animation, times[i], NULL, searched);
+        compute_bone_matrices(&g_skeleton, &g_animation, times[i], cursors, cursored);
+        TEST_ASSERT_EQUAL_MEMORY(searched, cursored, sizeof(searched));
+        // The bump at odd keys survives quantization
+        const float bump = (float)((int)times[i] % 2);
+        if (times[i] == floorf(times[i]) && times[i] < 16.0F) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3F, bump, searched[1][3][1]);
+        }
+    }
+}
+
+static void test_resample_rejects_empty_duration(void) {
+    g_animation.duration = 0.0F;
+    TEST_ASSERT_FALSE(animation_resample(&g_animation, 30.0F));
+    TEST_ASSERT_NULL(g_animation.samples);
+    TEST_ASSERT_FALSE(animation_resample(&g_animation, 0.0F));
+}
+
+// A baked pose is the bone matrices compute_bone_matrices gives at that time, as three rows
+static void test_baked_poses_match_evaluation(void) {
+    TEST_ASSERT_TRUE(skeleton_flatten(&g_skeleton));
+    animation_bind_skeleton(&g_animation, &g_skeleton);
+    g_animation.ticks_per_second = 1.0F;
+    AnimationArray animations = {&g_animation, 1, 1};
+
+    BakedPoses poses;
+    TEST_ASSERT_TRUE(animation_bake_poses(&g_skeleton, &animations, 2.0F, &poses));
+    TEST_ASSERT_EQUAL_UINT32(3, poses.bone_count);
+    TEST_ASSERT_EQUAL_UINT32(5, poses.frame_count);
+    TEST_ASSERT_EQUAL_UINT32(1, poses.clip_count);
+
+    // Pose 3 is at 1.5 ticks
+    mat4 bones[3];
+    compute_bone_matrices(&g_skeleton, &g_animation, 1.5F, NULL, bones);
+    const float *pose = poses.rows + (3 * 3 * 12);
+    for (int b = 0; b < 3; b++) {
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 4; column++) {
+                TEST_ASSERT_EQUAL_FLOAT(bones[b][column][row],
+                                        pose[(b * 12) + (row * 4) + column]);
+            }
+        }
+    }
+
+    // 1.75 ticks is halfway from pose 3 to pose 4, in float4s of three per bone
+    uint32_t offsets[2];
+    float blend = 0.0F;
+    baked_poses_locate(&poses, 0, 1.75F, &offsets[0], &offsets[1], &blend);
+    TEST_ASSERT_EQUAL_UINT32(3 * 3 * 3, offsets[0]);
+    TEST_ASSERT_EQUAL_UINT32(4 * 3 * 3, offsets[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 0.5F, blend);
+    // The end holds the last pose
+    baked_poses_locate(&poses, 0, 2.0F, &offsets[0], &offsets[1], &blend);
+    TEST_ASSERT_EQUAL_UINT32(offsets[0], offsets[1]);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, blend);
+    baked_poses_free(&poses);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_flatten_orders_parents_first);
+    RUN_TEST(test_pose_follows_the_chain);
+    RUN_TEST(test_unbound_animation_matches_bound);
+    RUN_TEST(test_cursors_match_search);
+    RUN_TEST(test_resampled_pose_matches_keys);
+    RUN_TEST(test_compressed_pose_follows_keys);
+    RUN_TEST(test_compressed_wide_track_stays_within_tolerance);
+    RUN_TEST(test_compressed_cursors_match_search);
+    RUN_TEST(test_resample_rejects_empty_duration);
+    RUN_TEST(test_baked_poses_match_evaluation);
+    return UNITY_END();
+}
@@ -34,9 +34,17 @@ static void test_defaults_and_reset(void) {
     TEST_ASSERT_EQUAL_FLOAT(-1.0F, args.camera_distance);
     TEST_ASSERT_EQUAL_FLOAT(1.0F, args.model_scale);
     TEST_ASSERT_EQUAL_FLOAT(0.0F, args.spin_speed);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, args.animation_rate);
+    TEST_ASSERT_FALSE(args.gpu_animation);
     TEST_ASSERT_EQUAL_FLOAT(0.02F, args.mouse_sensitivity);
     TEST_ASSERT_EQUAL_INT(60, args.target_fps);
+    TEST_ASSERT_FALSE(args.adaptive_resolution);
+    TEST_ASSERT_FALSE(args.adaptive_output);
+    TEST_ASSERT_FALSE(args.progressive);
+    TEST_ASSERT_FALSE(args.watch);
+    TEST_ASSERT_FALSE(args.low_memory);
     TEST_ASSERT_FALSE(args.no_lighting);
+    TEST_ASSERT_FALSE(args.cull_backfaces);
     TEST_ASSERT_FALSE(args.fps_controls);
     TEST_ASSERT_FALSE(args.mouse_orbit);
     TEST_ASSERT_FALSE(args.show_status_bar);
@@ -48,6 +56,20 @@ static void test_defaults_and_reset(void) {
     TEST_ASSERT_FALSE(args.use_palette_characters);
     TEST_ASSERT_FALSE(args.use_block_characters);
     TEST_ASSERT_FALSE(args.use_hash_characters);
+    TEST_ASSERT_FALSE(args.use_native_characters);
+    TEST_ASSERT_FALSE(args.use_gpu_cells);
+    TEST_ASSERT_FALSE(args.cpu_render);
+    TEST_ASSERT_NULL(args.gpu_device);
+    TEST_ASSERT_NULL(args.headless_format);
+    TEST_ASSERT_NULL(args.output_path);
+    TEST_ASSERT_EQUAL_INT(1, args.frame_count);
+    TEST_ASSERT_FALSE(args.turntable);
+    TEST_ASSERT_FALSE(args.batch);
+    TEST_ASSERT_NULL(args.stats_path);
+    TEST_ASSERT_NULL(args.replay_path);
+    TEST_ASSERT_NULL(args.latency_mode);
+    TEST_ASSERT_NULL(args.serve_address);
+    TEST_ASSERT_NULL(args.connect_address);
 }
 
 static void test_positional_model_path(void) {
@@ -75,6 +97,14 @@ static void test_string_options(void) {
     char *argv2[] = {"dcat", "--texture", "long.png"};
     TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv2), argv2, &args));
     TEST_ASSERT_EQUAL_STRING("long.png", args.texture_path);
+
+    char *argv3[] = {"dcat", "--stats-json", "stats.json"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv3), argv3, &args));
+    TEST_ASSERT_EQUAL_STRING("stats.json", args.stats_path);
+
+    char *argv4[] = {"dcat", "--gpu", "radeon"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv4), argv4, &args));
+    TEST_ASSERT_EQUAL_STRING("radeon", args.gpu_device);
 }
 
 static void test_int_options(void) {
@@ -109,19 +139,47 @@ static void test_float_options(void) {
     char *argv2[] = {"dcat", "--spin", "1e-2"};
     TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv2), argv2, &args));
     TEST_ASSERT_EQUAL_FLOAT(0.01F, args.spin_speed);
+
+    char *argv3[] = {"dcat", "--animation-rate", "30"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv3), argv3, &args));
+    TEST_ASSERT_EQUAL_FLOAT(30.0F, args.animation_rate);
 }
 
 static void test_flag_options(void) {
     Args args;
-    char *argv[] = {"dcat", "--no-lighting",    "--keyboard-controls", "--mouse-orbit",
-                    "-s",   "--hash-characters"};
+    char *argv[] = {"dcat",
+                    "--no-lighting",
+                    "--cull-backfaces",
+                    "--keyboard-controls",
+                    "--mouse-orbit",
+                    "-s",
+                    "--hash-characters",
+                    "--adaptive-resolution",
+                    "--adaptive-output",
+                    "--progressive",
+                    "--watch",
+                    "--low-memory",
+                    "--gpu-animation",
+                    "--native-characters",
+                    "--gpu-cells",
+                    "--cpu-render"};
     TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv), argv, &args));
     TEST_ASSERT_TRUE(args.no_lighting);
+    TEST_ASSERT_TRUE(args.cull_backfaces);
     // --keyboard-controls intentionally maps to the fps_controls field.
     TEST_ASSERT_TRUE(args.fps_controls);
     TEST_ASSERT_TRUE(args.mouse_orbit);
     TEST_ASSERT_TRUE(args.show_status_bar);
     TEST_ASSERT_TRUE(args.use_hash_characters);
+    TEST_ASSERT_TRUE(args.adaptive_resolution);
+    TEST_ASSERT_TRUE(args.adaptive_output);
+    TEST_ASSERT_TRUE(args.progressive);
+    TEST_ASSERT_TRUE(args.watch);
+    TEST_ASSERT_TRUE(args.low_memory);
+    TEST_ASSERT_TRUE(args.gpu_animation);
+    TEST_ASSERT_TRUE(args.use_native_characters);
+    TEST_ASSERT_TRUE(args.use_gpu_cells);
+    TEST_ASSERT_TRUE(args.cpu_render);
 }
 
 static void test_renderer_flag_mapping(void) {
@@ -304,6 +362,18 @@ static void test_validate_mouse_sensitivity(void) {
     TEST_ASSERT_TRUE(validate_args(&args));
 }
 
+static void test_validate_animation_rate(void) {
+    Args args = parsed_model_only();
+
+    // 0 keeps sampling the keys
+    args.animation_rate = 0.0F;
+    TEST_ASSERT_TRUE(validate_args(&args));
+    args.animation_rate = 60.0F;
+    TEST_ASSERT_TRUE(validate_args(&args));
+    args.animation_rate = -1.0F;
+    TEST_ASSERT_FALSE(validate_args(&args));
+}
+
 static void test_validate_render_mode_exclusivity(void) {
     Args args = parsed_model_only();
 
@@ -334,6 +404,140 @@ static void test_validate_ignores_spin(void) {
     TEST_ASSERT_TRUE(validate_args(&args));
 }
 
+static void test_headless_options(void) {
+    Args args;
+    char *argv[] = {"dcat",     "model.glb", "--headless", "png", "-o", "thumb_%03d.png",
+                    "--frames", "36",        "--turntable"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv), argv, &args));
+    TEST_ASSERT_EQUAL_INT(HEADLESS_FORMAT_PNG, args_headless_format(&args));
+    TEST_ASSERT_EQUAL_STRING("thumb_%03d.png", args.output_path);
+    TEST_ASSERT_EQUAL_INT(36, args.frame_count);
+    TEST_ASSERT_TRUE(args.turntable);
+    TEST_ASSERT_TRUE(validate_args(&args));
+
+    args.frame_count = 0;
+    TEST_ASSERT_FALSE(validate_args(&args));
+}
+
+static void test_validate_headless(void) {
+    Args args = parsed_model_only();
+    TEST_ASSERT_EQUAL_INT(HEADLESS_FORMAT_NONE, args_headless_format(&args));
+
+    char rgba[] = "rgba";
+    char encoded[] = "encoded";
+    char jpeg[] = "jpeg";
+    args.headless_format = rgba;
+    TEST_ASSERT_EQUAL_INT(HEADLESS_FORMAT_RGBA, args_headless_format(&args));
+    TEST_ASSERT_TRUE(validate_args(&args));
+
+    args.headless_format = jpeg;
+    TEST_ASSERT_EQUAL_INT(HEADLESS_FORMAT_INVALID, args_headless_format(&args));
+    TEST_ASSERT_FALSE(validate_args(&args));
+
+    // Kitty shm frames only make sense to a live terminal.
+    args.headless_format = encoded;
+    args.use_kitty_shm = true;
+    TEST_ASSERT_FALSE(validate_args(&args));
+    args.use_kitty_shm = false;
+    args.use_sixel = true;
+    TEST_ASSERT_TRUE(validate_args(&args));
+
+    // Headless-only options are rejected in interactive mode.
+    args = parsed_model_only();
+    args.turntable = true;
+    TEST_ASSERT_FALSE(validate_args(&args));
+}
+
+static void test_validate_latency(void) {
+    Args args = parsed_model_only();
+    TEST_ASSERT_EQUAL_INT(LATENCY_MODE_AUTO, args_latency_mode(&args));
+
+    char *argv[] = {"dcat", "model.glb", "--latency", "low"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv), argv, &args));
+    TEST_ASSERT_EQUAL_INT(LATENCY_MODE_LOW, args_latency_mode(&args));
+    TEST_ASSERT_TRUE(validate_args(&args));
+
+    char pipelined[] = "pipelined";
+    char fast[] = "fast";
+    args.latency_mode = pipelined;
+    TEST_ASSERT_EQUAL_INT(LATENCY_MODE_PIPELINED, args_latency_mode(&args));
+    TEST_ASSERT_TRUE(validate_args(&args));
+
+    args.latency_mode = fast;
+    TEST_ASSERT_EQUAL_INT(LATENCY_MODE_INVALID, args_latency_mode(&args));
+    TEST_ASSERT_FALSE(validate_args(&args));
+}
+
+static void test_validate_streaming(void) {
+    Args args;
+    char *serve_argv[] = {"dcat", "model.glb", "--serve", "unix:/tmp/dcat.sock"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(serve_argv), serve_argv, &args));
+    TEST_ASSERT_EQUAL_STRING("unix:/tmp/dcat.sock", args.serve_address);
+    TEST_ASSERT_TRUE(validate_args(&args));
+    char png[] = "png";
+    args.headless_format = png;
+    TEST_ASSERT_FALSE(validate_args(&args));
+    // Viewers refuse frames over FRAME_STREAM_MAX_PIXELS
+    args.headless_format = NULL;
+    args.width = 8192;
+    args.height = 8192;
+    TEST_ASSERT_TRUE(validate_args(&args));
+    args.height = 8193;
+    TEST_ASSERT_FALSE(validate_args(&args));
+
+    // A viewer needs no model, and takes none
+    char *connect_argv[] = {"dcat", "--connect", "render-box:7070", "--sixel"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK,
+                          parse_args(ARGV_COUNT(connect_argv), connect_argv, &args));
+    TEST_ASSERT_EQUAL_STRING("render-box:7070", args.connect_address);
+    TEST_ASSERT_TRUE(validate_args(&args));
+    char model[] = "model.glb";
+    args.model_path = model;
+    TEST_ASSERT_FALSE(validate_args(&args));
+}
+
+static void test_validate_replay(void) {
+    Args args;
+    char *argv[] = {"dcat", "model.glb", "--replay", "orbit.replay", "--frames", "600"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv), argv, &args));
+    TEST_ASSERT_EQUAL_STRING("orbit.replay", args.replay_path);
+    TEST_ASSERT_TRUE(validate_args(&args));
+    char png[] = "png";
+    args.headless_format = png;
+    TEST_ASSERT_TRUE(validate_args(&args));
+
+    args.frame_count = 0;
+    TEST_ASSERT_FALSE(validate_args(&args));
+    args.frame_count = 600;
+    args.batch = true;
+    TEST_ASSERT_FALSE(validate_args(&args));
+}
+
+static void test_batch_model_paths(void) {
+    Args args;
+    char *argv[] = {"dcat", "a.obj",   "--headless", "png",   "-o",
+                    "%s.png", "--batch", "b.glb",     "-W",    "64", "c.fbx"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(argv), argv, &args));
+    TEST_ASSERT_TRUE(args.batch);
+    TEST_ASSERT_TRUE(validate_args(&args));
+
+    // Option values such as "png" and "64" are not models
+    char *paths[ARGV_COUNT(argv)];
+    TEST_ASSERT_EQUAL_size_t(3, args_model_paths(ARGV_COUNT(argv), argv, paths));
+    TEST_ASSERT_EQUAL_STRING("a.obj", paths[0]);
+    TEST_ASSERT_EQUAL_STRING("b.glb", paths[1]);
+    TEST_ASSERT_EQUAL_STRING("c.fbx", paths[2]);
+
+    // Without MODEL arguments the list comes from stdin
+    char *stdin_argv[] = {"dcat", "--batch", "--headless", "rgba"};
+    TEST_ASSERT_EQUAL_INT(ARGS_PARSE_OK, parse_args(ARGV_COUNT(stdin_argv), stdin_argv, &args));
+    TEST_ASSERT_TRUE(validate_args(&args));
+    TEST_ASSERT_EQUAL_size_t(0, args_model_paths(ARGV_COUNT(stdin_argv), stdin_argv, paths));
+
+    args.headless_format = NULL;
+    TEST_ASSERT_FALSE(validate_args(&args));
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_defaults_and_reset);
@@ -354,7 +558,14 @@ int main(void) {
     RUN_TEST(test_validate_fps_and_scale);
     RUN_TEST(test_validate_camera_distance);
     RUN_TEST(test_validate_mouse_sensitivity);
+    RUN_TEST(test_validate_animation_rate);
     RUN_TEST(test_validate_render_mode_exclusivity);
     RUN_TEST(test_validate_ignores_spin);
+    RUN_TEST(test_headless_options);
+    RUN_TEST(test_validate_headless);
+    RUN_TEST(test_validate_latency);
+    RUN_TEST(test_validate_streaming);
+    RUN_TEST(test_validate_replay);
+    RUN_TEST(test_batch_model_paths);
     return UNITY_END();
 }
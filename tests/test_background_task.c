@@ -0,0 +1,74 @@
+#include "core/background_task.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+typedef struct {
+    atomic_bool released;
+    atomic_int runs;
+    int result;
+} TaskState;
+
+// Holds on until the caller releases it, which only a concurrently running task lives to see
+static void wait_for_release(void *context) {
+    TaskState *state = context;
+    while (!atomic_load(&state->released)) {
+        dcat_sleep_ms(1);
+    }
+    state->result = 42;
+    atomic_fetch_add(&state->runs, 1);
+}
+
+static void count_run(void *context) {
+    TaskState *state = context;
+    state->result = 7;
+    atomic_fetch_add(&state->runs, 1);
+}
+
+static void test_task_overlaps_the_caller_until_joined(void) {
+    TaskState state;
+    memset(&state, 0, sizeof(state));
+    BackgroundTask task;
+    memset(&task, 0, sizeof(task));
+
+    background_task_start(&task, wait_for_release, &state);
+    TEST_ASSERT_TRUE(task.started);
+    TEST_ASSERT_EQUAL_INT(0, atomic_load(&state.runs));
+    atomic_store(&state.released, true);
+    background_task_join(&task);
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&state.runs));
+    TEST_ASSERT_EQUAL_INT(42, state.result);
+    TEST_ASSERT_FALSE(task.started);
+}
+
+static void test_join_is_idempotent(void) {
+    TaskState state;
+    memset(&state, 0, sizeof(state));
+    BackgroundTask task;
+    memset(&task, 0, sizeof(task));
+
+    // Never started: nothing to wait for
+    background_task_join(&task);
+
+    background_task_start(&task, count_run, &state);
+    background_task_join(&task);
+    background_task_join(&task);
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&state.runs));
+    TEST_ASSERT_EQUAL_INT(7, state.result);
+
+    // A task is reusable once joined
+    background_task_start(&task, count_run, &state);
+    background_task_join(&task);
+    TEST_ASSERT_EQUAL_INT(2, atomic_load(&state.runs));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_task_overlaps_the_caller_until_joined);
+    RUN_TEST(test_join_is_idempotent);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+#include "terminal/block_encoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+void setUp(void) {}
+
+void tearDown(void) {
+    block_encoder_cleanup();
+}
+
+static uint8_t *solid_frame(const uint32_t width, const uint32_t height, const uint8_t r,
+                            const uint8_t g, const uint8_t b) {
+    uint8_t *frame = malloc((size_t)width * height * 4U);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        frame[(i * 4U) + 0] = r;
+        frame[(i * 4U) + 1] = g;
+        frame[(i * 4U) + 2] = b;
+        frame[(i * 4U) + 3] = 255;
+    }
+    return frame;
+}
+
+static void test_solid_frame_is_spaces_on_one_background(void) {
+    uint8_t *frame = solid_frame(4, 4, 10, 20, 30);
+    size_t length = 0;
+    const char *output = block_encode(BLOCK_ENCODER_HALF_TRUECOLOR, frame, 4, 4, &length);
+
+    static const char expected[] = "\x1b[1;1H\x1b[48;2;10;20;30m  \x1b[0m";
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected) - 1U, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, output, length);
+    free(frame);
+}
+
+static void test_halves_map_to_foreground_and_background(void) {
+    // One cell: rows 0-1 white, rows 2-3 black.
+    uint8_t *frame = solid_frame(2, 4, 0, 0, 0);
+    memset(frame, 255, 2U * 2U * 4U);
+    size_t length = 0;
+    const char *output = block_encode(BLOCK_ENCODER_HALF_TRUECOLOR, frame, 2, 4, &length);
+
+    static const char expected[] = "\x1b[1;1H\x1b[38;2;255;255;255;48;2;0;0;0m▀\x1b[0m";
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected) - 1U, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, output, length);
+    free(frame);
+}
+
+static void test_unchanged_frame_emits_nothing(void) {
+    uint8_t *frame = solid_frame(8, 8, 50, 60, 70);
+    size_t length = 0;
+    block_encode(BLOCK_ENCODER_HALF_TRUECOLOR, frame, 8, 8, &length);
+    TEST_ASSERT_GREATER_THAN(0, length);
+
+    block_encode(BLOCK_ENCODER_HALF_TRUECOLOR, frame, 8, 8, &length);
+    TEST_ASSERT_EQUAL_size_t(0, length);
+
+    // Changing one cell rewrites only that cell.
+    frame[0] = 90;
+    const char *output = block_encode(BLOCK_ENCODER_HALF_TRUECOLOR, frame, 8, 8, &length);
+    static const char expected[] = "\x1b[1;1H\x1b[38;2;60;60;70;48;2;50;60;70m▀\x1b[0m";
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected) - 1U, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, output, length);
+
+    block_encoder_invalidate();
+    block_encode(BLOCK_ENCODER_HALF_TRUECOLOR, frame, 8, 8, &length);
+    TEST_ASSERT_GREATER_THAN(sizeof(expected), length);
+    free(frame);
+}
+
+static void test_quadrants_follow_luma(void) {
+    // Bright top-left and bottom-right quadrants give the diagonal glyph.
+    uint8_t *frame = solid_frame(2, 4, 0, 0, 0);
+    const size_t stride = 2U * 4U;
+    for (int y = 0; y < 2; y++) {
+        memset(frame + ((size_t)y * stride), 255, 4);
+        memset(frame + ((size_t)(y + 2) * stride) + 4, 255, 4);
+    }
+    size_t length = 0;
+    const char *output = block_encode(BLOCK_ENCODER_QUADRANT_MONO, frame, 2, 4, &length);
+
+    static const char expected[] = "\x1b[1;1H▚";
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected) - 1U, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, output, length);
+    free(frame);
+}
+
+static void test_color_cells_use_their_quadrant_glyph(void) {
+    // Two cells as the GPU writes them: a ▚ on black, then a solid grey cell.
+    const uint32_t cells[4] = {0x09FF8000U, 0x000000U, 0x00404040U, 0x404040U};
+    size_t length = 0;
+    const char *output = block_encode_cells(BLOCK_ENCODER_QUADRANT_TRUECOLOR,
+                                            (const uint8_t *)cells, 2, 1, &length);
+
+    static const char expected[] =
+        "\x1b[1;1H\x1b[38;2;255;128;0;48;2;0;0;0m▚\x1b[48;2;64;64;64m \x1b[0m";
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected) - 1U, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, output, length);
+
+    block_encode_cells(BLOCK_ENCODER_QUADRANT_TRUECOLOR, (const uint8_t *)cells, 2, 1, &length);
+    TEST_ASSERT_EQUAL_size_t(0, length);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_solid_frame_is_spaces_on_one_background);
+    RUN_TEST(test_halves_map_to_foreground_and_background);
+    RUN_TEST(test_unchanged_frame_emits_nothing);
+    RUN_TEST(test_quadrants_follow_luma);
+    RUN_TEST(test_color_cells_use_their_quadrant_glyph);
+    return UNITY_END();
+}
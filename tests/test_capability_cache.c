@@ -0,0 +1,126 @@
+#include "terminal/capability_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+// Relative to the test's working directory (the build tree under meson test)
+#define CACHE_PATH "test_capability_cache.txt"
+
+// The environment capability_cache_key sees: name=value pairs
+static const char *g_environment[8];
+
+static const char *fake_lookup(const char *name) {
+    const size_t length = strlen(name);
+    for (size_t i = 0; i < sizeof(g_environment) / sizeof(g_environment[0]); i++) {
+        if (g_environment[i] && strncmp(g_environment[i], name, length) == 0 &&
+            g_environment[i][length] == '=') {
+            return g_environment[i] + length + 1;
+        }
+    }
+    return NULL;
+}
+
+static void key_for(const char *a, const char *b, const char *c, char out[32]) {
+    memset(g_environment, 0, sizeof(g_environment));
+    g_environment[0] = a;
+    g_environment[1] = b;
+    g_environment[2] = c;
+    capability_cache_key(fake_lookup, out, 32);
+}
+
+void setUp(void) {
+    remove(CACHE_PATH);
+    capability_replies_reset();
+}
+
+void tearDown(void) {
+    remove(CACHE_PATH);
+}
+
+static void test_key_follows_terminal_and_ssh_client(void) {
+    char plain[32];
+    char same[32];
+    char other[32];
+    key_for("TERM=xterm-256color", "TERM_PROGRAM=WezTerm", "TERM_PROGRAM_VERSION=20240203",
+            plain);
+    key_for("TERM=xterm-256color", "TERM_PROGRAM=WezTerm", "TERM_PROGRAM_VERSION=20240203",
+            same);
+    TEST_ASSERT_EQUAL_STRING(plain, same);
+    key_for("TERM=xterm-256color", "TERM_PROGRAM=WezTerm", "TERM_PROGRAM_VERSION=20240720",
+            other);
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(plain, other));
+
+    // A new connection from the same machine only changes ports
+    key_for("TERM=xterm-256color", "SSH_CONNECTION=10.0.0.2 50122 10.0.0.1 22", NULL, same);
+    key_for("TERM=xterm-256color", "SSH_CONNECTION=10.0.0.2 50388 10.0.0.1 22", NULL, other);
+    TEST_ASSERT_EQUAL_STRING(same, other);
+    key_for("TERM=xterm-256color", "SSH_CONNECTION=10.0.0.3 50388 10.0.0.1 22", NULL, other);
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(same, other));
+
+    // Inside tmux the terminal answers through it, whichever session it is
+    key_for("TERM=tmux-256color", "TMUX=/tmp/tmux-1000/default,123,0", NULL, same);
+    key_for("TERM=tmux-256color", "TMUX=/tmp/tmux-1000/default,456,2", NULL, other);
+    TEST_ASSERT_EQUAL_STRING(same, other);
+    key_for("TERM=tmux-256color", NULL, NULL, other);
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(same, other));
+}
+
+static void test_cache_keeps_one_entry_per_terminal(void) {
+    TerminalCapabilities caps;
+    TEST_ASSERT_FALSE(capability_cache_lookup(CACHE_PATH, "a", &caps));
+
+    const TerminalCapabilities sixel = {.pixel_mode = 2, .cell_width = 0, .cell_height = 0};
+    const TerminalCapabilities kitty = {.pixel_mode = 1, .cell_width = 9, .cell_height = 18};
+    TEST_ASSERT_TRUE(capability_cache_store(CACHE_PATH, "a", &sixel));
+    TEST_ASSERT_TRUE(capability_cache_store(CACHE_PATH, "b", &sixel));
+    TEST_ASSERT_TRUE(capability_cache_store(CACHE_PATH, "a", &kitty));
+
+    TEST_ASSERT_TRUE(capability_cache_lookup(CACHE_PATH, "a", &caps));
+    TEST_ASSERT_EQUAL_INT(1, caps.pixel_mode);
+    TEST_ASSERT_EQUAL_UINT32(9, caps.cell_width);
+    TEST_ASSERT_EQUAL_UINT32(18, caps.cell_height);
+    TEST_ASSERT_TRUE(capability_cache_lookup(CACHE_PATH, "b", &caps));
+    TEST_ASSERT_EQUAL_INT(2, caps.pixel_mode);
+    TEST_ASSERT_FALSE(capability_cache_lookup(CACHE_PATH, "c", &caps));
+}
+
+static void test_replies_are_taken_out_of_input(void) {
+    bool kitty = false;
+    bool sixel = false;
+    static const char kitty_reply[] = "\x1b_Gi=31;OK\x1b\\";
+    static const char attributes[] = "\x1b[?62;4;22c";
+
+    TEST_ASSERT_EQUAL_INT((int)sizeof(kitty_reply) - 1,
+                          (int)capability_reply_parse(kitty_reply, sizeof(kitty_reply) - 1U));
+    // Kitty answers first; only the device attributes finish the reply
+    TEST_ASSERT_FALSE(capability_replies_get(&kitty, &sixel));
+    TEST_ASSERT_EQUAL_INT(-1, (int)capability_reply_parse(attributes, 6));
+    TEST_ASSERT_EQUAL_INT((int)sizeof(attributes) - 1,
+                          (int)capability_reply_parse(attributes, sizeof(attributes) - 1U));
+    TEST_ASSERT_TRUE(capability_replies_get(&kitty, &sixel));
+    TEST_ASSERT_TRUE(kitty);
+    TEST_ASSERT_TRUE(sixel);
+
+    capability_replies_reset();
+    static const char refused[] = "\x1b_Gi=31;ENOTSUPPORTED:x\x1b\\\x1b[?1;2c";
+    const ptrdiff_t first = capability_reply_parse(refused, sizeof(refused) - 1U);
+    TEST_ASSERT_EQUAL_INT(25, (int)first);
+    TEST_ASSERT_EQUAL_INT(7, (int)capability_reply_parse(refused + first, 7));
+    TEST_ASSERT_TRUE(capability_replies_get(&kitty, &sixel));
+    TEST_ASSERT_FALSE(kitty);
+    TEST_ASSERT_FALSE(sixel);
+
+    // Keys and other reports are left to the key parser
+    TEST_ASSERT_EQUAL_INT(0, (int)capability_reply_parse("\x1b[A", 3));
+    TEST_ASSERT_EQUAL_INT(0, (int)capability_reply_parse("\x1b[?2026;2$y", 11));
+    TEST_ASSERT_EQUAL_INT(0, (int)capability_reply_parse("q", 1));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_key_follows_terminal_and_ssh_client);
+    RUN_TEST(test_cache_keeps_one_entry_per_terminal);
+    RUN_TEST(test_replies_are_taken_out_of_input);
+    return UNITY_END();
+}
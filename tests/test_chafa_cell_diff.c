@@ -0,0 +1,129 @@
+#include "terminal/chafa_cell_diff.h"
+
+#include <string.h>
+#include <unity.h>
+
+#define GRID_WIDTH 12
+#define GRID_HEIGHT 3
+#define RED 0xFF0000
+#define BLUE 0x0000FF
+
+static ChafaCellGrid g_screen;
+static ChafaCellGrid g_frame;
+static GString *g_out;
+
+static void fill_grid(ChafaCellGrid *grid, const gunichar symbol, const gint fg, const gint bg) {
+    for (int i = 0; i < grid->width * grid->height; i++) {
+        grid->cells[i] = (ChafaCell){symbol, fg, bg};
+    }
+}
+
+static ChafaCell *cell_at(const ChafaCellGrid *grid, const int x, const int y) {
+    return &grid->cells[(y * grid->width) + x];
+}
+
+// Both grids start as the same screen of blank cells in the terminal's default colors
+void setUp(void) {
+    memset(&g_screen, 0, sizeof(g_screen));
+    memset(&g_frame, 0, sizeof(g_frame));
+    TEST_ASSERT_TRUE(chafa_cell_grid_resize(&g_screen, GRID_WIDTH, GRID_HEIGHT));
+    TEST_ASSERT_TRUE(chafa_cell_grid_resize(&g_frame, GRID_WIDTH, GRID_HEIGHT));
+    fill_grid(&g_screen, ' ', -1, -1);
+    fill_grid(&g_frame, ' ', -1, -1);
+    g_out = g_string_new(NULL);
+}
+
+void tearDown(void) {
+    chafa_cell_grid_free(&g_screen);
+    chafa_cell_grid_free(&g_frame);
+    g_string_free(g_out, true);
+}
+
+static void assert_screen_matches_frame(void) {
+    TEST_ASSERT_EQUAL_MEMORY(g_frame.cells, g_screen.cells,
+                             (size_t)GRID_WIDTH * GRID_HEIGHT * sizeof(ChafaCell));
+}
+
+static void test_unchanged_frame_writes_nothing(void) {
+    TEST_ASSERT_TRUE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_TRUECOLOR));
+    TEST_ASSERT_EQUAL_size_t(0, g_out->len);
+    assert_screen_matches_frame();
+}
+
+static void test_single_changed_cell_is_positioned_and_colored(void) {
+    *cell_at(&g_frame, 3, 1) = (ChafaCell){'#', RED, BLUE};
+    TEST_ASSERT_TRUE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_TRUECOLOR));
+    TEST_ASSERT_EQUAL_STRING("\x1b[2;4H\x1b[38;2;255;0;0;48;2;0;0;255m#", g_out->str);
+    assert_screen_matches_frame();
+
+    // Written once, the cell is not written again
+    g_string_truncate(g_out, 0);
+    TEST_ASSERT_TRUE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_TRUECOLOR));
+    TEST_ASSERT_EQUAL_size_t(0, g_out->len);
+}
+
+// Changed cells a short gap apart share one cursor move, the gap rewritten as it was; a
+// wider gap is skipped with another. Colors are only set when they change.
+static void test_gaps_between_changes(void) {
+    *cell_at(&g_frame, 0, 0) = (ChafaCell){'a', 1, 2};
+    *cell_at(&g_frame, 3, 0) = (ChafaCell){'b', 1, 2};
+    *cell_at(&g_frame, 10, 0) = (ChafaCell){'c', 1, 2};
+    TEST_ASSERT_TRUE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_INDEXED_240));
+    TEST_ASSERT_EQUAL_STRING("\x1b[1;1H\x1b[38;5;1;48;5;2ma\x1b[39;49m  \x1b[38;5;1;48;5;2mb"
+                             "\x1b[1;11Hc",
+                             g_out->str);
+    assert_screen_matches_frame();
+}
+
+static void test_full_change_rewrites_every_row(void) {
+    fill_grid(&g_frame, '#', RED, BLUE);
+    TEST_ASSERT_TRUE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_TRUECOLOR));
+    GString *expected = g_string_new(NULL);
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        g_string_append_printf(expected, "\x1b[%d;1H", y + 1);
+        if (y == 0) {
+            g_string_append(expected, "\x1b[38;2;255;0;0;48;2;0;0;255m");
+        }
+        for (int x = 0; x < GRID_WIDTH; x++) {
+            g_string_append_c(expected, '#');
+        }
+    }
+    TEST_ASSERT_EQUAL_STRING(expected->str, g_out->str);
+    g_string_free(expected, true);
+    assert_screen_matches_frame();
+}
+
+// FGBG output has no colors to set, only symbols
+static void test_fgbg_writes_symbols_only(void) {
+    *cell_at(&g_frame, 0, 2) = (ChafaCell){'#', RED, BLUE};
+    TEST_ASSERT_TRUE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_FGBG));
+    TEST_ASSERT_EQUAL_STRING("\x1b[3;1H#", g_out->str);
+}
+
+// A resized canvas cannot be diffed against the old screen: nothing is written, and the
+// caller prints the frame whole
+static void test_resize_needs_a_full_frame(void) {
+    TEST_ASSERT_TRUE(chafa_cell_grid_resize(&g_frame, GRID_WIDTH + 4, GRID_HEIGHT));
+    fill_grid(&g_frame, '#', RED, BLUE);
+    TEST_ASSERT_FALSE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_TRUECOLOR));
+    TEST_ASSERT_EQUAL_size_t(0, g_out->len);
+    TEST_ASSERT_EQUAL_INT(GRID_WIDTH, g_screen.width);
+    TEST_ASSERT_EQUAL_UINT32(' ', cell_at(&g_screen, 0, 0)->symbol);
+
+    // Shrinking keeps the grid's memory
+    ChafaCell *cells = g_frame.cells;
+    TEST_ASSERT_TRUE(chafa_cell_grid_resize(&g_frame, GRID_WIDTH, GRID_HEIGHT - 1));
+    TEST_ASSERT_EQUAL_PTR(cells, g_frame.cells);
+    TEST_ASSERT_FALSE(chafa_cell_diff(g_out, &g_screen, &g_frame, CHAFA_CANVAS_MODE_TRUECOLOR));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unchanged_frame_writes_nothing);
+    RUN_TEST(test_single_changed_cell_is_positioned_and_colored);
+    RUN_TEST(test_gaps_between_changes);
+    RUN_TEST(test_full_change_rewrites_every_row);
+    RUN_TEST(test_fgbg_writes_symbols_only);
+    RUN_TEST(test_resize_needs_a_full_frame);
+    return UNITY_END();
+}
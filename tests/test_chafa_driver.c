@@ -55,6 +55,20 @@ static void test_explicit_flags_keep_their_driver_names(void) {
     TEST_ASSERT_EQUAL_STRING("block", driver_factory_get(&args)->name);
 }
 
+static void test_native_characters_replace_truecolor_and_block_only(void) {
+    Args args = {.use_native_characters = true, .use_truecolor_characters = true};
+    TEST_ASSERT_EQUAL_STRING("half_blocks", driver_factory_get(&args)->name);
+    args = (Args){.use_native_characters = true, .use_block_characters = true};
+    TEST_ASSERT_EQUAL_STRING("quadrant_blocks", driver_factory_get(&args)->name);
+    args = (Args){.use_native_characters = true, .use_palette_characters = true};
+    TEST_ASSERT_EQUAL_STRING("palette", driver_factory_get(&args)->name);
+    // Hash characters need chafa's symbol matching.
+    args = (Args){.use_native_characters = true,
+                  .use_truecolor_characters = true,
+                  .use_hash_characters = true};
+    TEST_ASSERT_EQUAL_STRING("truecolor", driver_factory_get(&args)->name);
+}
+
 static void test_noise_dithering_is_limited_to_quantized_output(void) {
     static const ChafaCanvasMode indexed_modes[] = {
         CHAFA_CANVAS_MODE_INDEXED_256, CHAFA_CANVAS_MODE_INDEXED_240, CHAFA_CANVAS_MODE_INDEXED_16,
@@ -95,6 +109,7 @@ int main(void) {
     RUN_TEST(test_pixel_protocol_responses_are_detected);
     RUN_TEST(test_chafa_sequences_are_parsed_inside_mixed_input);
     RUN_TEST(test_explicit_flags_keep_their_driver_names);
+    RUN_TEST(test_native_characters_replace_truecolor_and_block_only);
     RUN_TEST(test_noise_dithering_is_limited_to_quantized_output);
     RUN_TEST(test_character_modes_render_two_by_four_samples_per_cell);
     return UNITY_END();
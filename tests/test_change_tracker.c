@@ -0,0 +1,80 @@
+#include "core/change_tracker.h"
+#include "core/time_utils.h"
+
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_notify_advances_generation(void) {
+    ChangeTracker tracker;
+    TEST_ASSERT_TRUE(change_tracker_init(&tracker));
+    const uint64_t start = change_tracker_generation(&tracker);
+
+    change_tracker_notify(&tracker);
+    change_tracker_notify(&tracker);
+    TEST_ASSERT_EQUAL_UINT64(start + 2, change_tracker_generation(&tracker));
+
+    // A change made before the wait is not lost: the wait returns without sleeping.
+    TEST_ASSERT_EQUAL_UINT64(start + 2, change_tracker_wait(&tracker, start, 10000U));
+
+    change_tracker_destroy(&tracker);
+}
+
+static void test_wait_times_out_without_changes(void) {
+    ChangeTracker tracker;
+    TEST_ASSERT_TRUE(change_tracker_init(&tracker));
+    const uint64_t seen = change_tracker_generation(&tracker);
+
+    const double start = get_time_seconds();
+    TEST_ASSERT_EQUAL_UINT64(seen, change_tracker_wait(&tracker, seen, 20U));
+    TEST_ASSERT_TRUE(get_time_seconds() - start < 5.0);
+
+    change_tracker_destroy(&tracker);
+}
+
+typedef struct {
+    ChangeTracker *tracker;
+} NotifierArgs;
+
+#ifdef _WIN32
+static unsigned __stdcall notify_later(void *arg) {
+#else
+static void *notify_later(void *arg) {
+#endif
+    NotifierArgs *args = arg;
+    dcat_sleep_ms(20);
+    change_tracker_notify(args->tracker);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static void test_notify_wakes_waiter(void) {
+    ChangeTracker tracker;
+    TEST_ASSERT_TRUE(change_tracker_init(&tracker));
+    const uint64_t seen = change_tracker_generation(&tracker);
+
+    NotifierArgs args = {&tracker};
+    DcatThread thread;
+    TEST_ASSERT_TRUE(dcat_thread_create(&thread, notify_later, &args));
+    uint64_t generation = seen;
+    // Bounded retries so a spurious wakeup cannot fail the test, but a lost one would.
+    for (int i = 0; i < 100 && generation == seen; i++) {
+        generation = change_tracker_wait(&tracker, seen, 100U);
+    }
+    dcat_thread_join(thread);
+    TEST_ASSERT_EQUAL_UINT64(seen + 1, generation);
+
+    change_tracker_destroy(&tracker);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_notify_advances_generation);
+    RUN_TEST(test_wait_times_out_without_changes);
+    RUN_TEST(test_notify_wakes_waiter);
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+#include "renderer/cpu_rasterizer.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#define WIDTH 64U
+#define HEIGHT 48U
+
+static CpuRasterizer rasterizer;
+static uint8_t pixels[WIDTH * HEIGHT * 4];
+static Mesh mesh;
+static DrawList draws;
+static FrameUniforms unlit;
+
+void setUp(void) {
+    TEST_ASSERT_TRUE(cpu_rasterizer_init(&rasterizer, 0));
+    TEST_ASSERT_TRUE(cpu_rasterizer_resize(&rasterizer, WIDTH, HEIGHT));
+    memset(&mesh, 0, sizeof(mesh));
+    memset(&draws, 0, sizeof(draws));
+    memset(&unlit, 0, sizeof(unlit));
+}
+
+void tearDown(void) {
+    cpu_rasterizer_destroy(&rasterizer);
+    ARRAY_FREE(mesh.vertices);
+    ARRAY_FREE(mesh.indices);
+    draw_list_free(&draws);
+}
+
+// Adds a triangle given directly in clip space (the tests use identity transforms)
+static void add_triangle(const float a[3], const float b[3], const float c[3]) {
+    const float *corners[3] = {a, b, c};
+    for (int i = 0; i < 3; i++) {
+        Vertex v = {0};
+        memcpy(v.position, corners[i], sizeof(v.position));
+        v.normal[2] = 1.0F;
+        v.tangent[0] = 1.0F;
+        v.bitangent[1] = 1.0F;
+        ARRAY_PUSH(mesh.indices, (uint32_t)mesh.vertices.count);
+        ARRAY_PUSH(mesh.vertices, v);
+    }
+}
+
+static void draw(const RenderMaterial *materials, const uint32_t material_count) {
+    draw_list_build(&draws);
+    CpuFrame frame = {.mesh = &mesh,
+                      .draws = &draws,
+                      .materials = materials,
+                      .material_count = material_count,
+                      .lighting = &unlit};
+    glm_mat4_identity(frame.mvp);
+    glm_mat4_identity(frame.model);
+    cpu_rasterizer_draw(&rasterizer, &frame, pixels);
+}
+
+static const uint8_t *pixel_at(const uint32_t x, const uint32_t y) {
+    return &pixels[((y * WIDTH) + x) * 4];
+}
+
+// The unlit shader output for a linear colour value
+static uint8_t expected_unlit(const float linear) {
+    const float mapped = powf(1.0F - expf(-linear), 1.0F / 2.2F);
+    return (uint8_t)((mapped * 255.0F) + 0.5F);
+}
+
+static RenderMaterial solid_material(const float r, const float g, const float b,
+                                     const float a) {
+    static const uint8_t white[4] = {255, 255, 255, 255};
+    static Texture texture = {1, 1, (uint8_t *)white, 4, false};
+    RenderMaterial material = {.diffuse = &texture,
+                               .alpha_mode = a < 1.0F ? ALPHA_MODE_BLEND : ALPHA_MODE_OPAQUE,
+                               .base_color = {r, g, b, a}};
+    return material;
+}
+
+static void test_covers_triangle_and_clears_the_rest(void) {
+    add_triangle((float[3]){-1.0F, -1.0F, 0.5F}, (float[3]){1.0F, -1.0F, 0.5F},
+                 (float[3]){-1.0F, 1.0F, 0.5F});
+    draw_list_add(&draws, DRAW_PASS_OPAQUE, 0, 0, 0, 3);
+    const RenderMaterial material = solid_material(1.0F, 0.0F, 0.0F, 1.0F);
+    draw(&material, 1);
+
+    // NDC y = -1 is the top row, as in the Vulkan viewport
+    const uint8_t *inside = pixel_at(2, 2);
+    TEST_ASSERT_EQUAL_UINT8(expected_unlit(1.0F), inside[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, inside[1]);
+    TEST_ASSERT_EQUAL_UINT8(255, inside[3]);
+    const uint8_t *outside = pixel_at(WIDTH - 2, HEIGHT - 2);
+    TEST_ASSERT_EQUAL_UINT8(0, outside[0]);
+    TEST_ASSERT_EQUAL_UINT8(255, outside[3]);
+}
+
+static void test_nearer_surface_wins_in_either_order(void) {
+    const float *near_z[3] = {(float[3]){-1.0F, -1.0F, 0.2F}, (float[3]){3.0F, -1.0F, 0.2F},
+                              (float[3]){-1.0F, 3.0F, 0.2F}};
+    const float *far_z[3] = {(float[3]){-1.0F, -1.0F, 0.8F}, (float[3]){3.0F, -1.0F, 0.8F},
+                             (float[3]){-1.0F, 3.0F, 0.8F}};
+    add_triangle(far_z[0], far_z[1], far_z[2]);
+    add_triangle(near_z[0], near_z[1], near_z[2]);
+    add_triangle(far_z[0], far_z[1], far_z[2]);
+    const RenderMaterial materials[2] = {solid_material(0.0F, 1.0F, 0.0F, 1.0F),
+                                         solid_material(1.0F, 0.0F, 0.0F, 1.0F)};
+    // Far, near (red), far again: the red triangle must stay on top
+    draw_list_add(&draws, DRAW_PASS_OPAQUE, 0, 0, 0, 3);
+    draw_list_add(&draws, DRAW_PASS_OPAQUE, 1, 1, 3, 3);
+    draw_list_add(&draws, DRAW_PASS_OPAQUE, 0, 0, 6, 3);
+    draw(materials, 2);
+
+    for (uint32_t y = 0; y < HEIGHT; y += 7) {
+        for (uint32_t x = 0; x < WIDTH; x += 5) {
+            TEST_ASSERT_EQUAL_UINT8(expected_unlit(1.0F), pixel_at(x, y)[0]);
+            TEST_ASSERT_EQUAL_UINT8(0, pixel_at(x, y)[1]);
+        }
+    }
+}
+
+static void test_shared_edges_blend_exactly_once(void) {
+    // Two triangles splitting the screen along a diagonal
+    add_triangle((float[3]){-1.0F, -1.0F, 0.5F}, (float[3]){1.0F, -1.0F, 0.5F},
+                 (float[3]){1.0F, 1.0F, 0.5F});
+    add_triangle((float[3]){-1.0F, -1.0F, 0.5F}, (float[3]){1.0F, 1.0F, 0.5F},
+                 (float[3]){-1.0F, 1.0F, 0.5F});
+    draw_list_add(&draws, DRAW_PASS_BLEND, 0, 0, 0, 6);
+    const RenderMaterial material = solid_material(1.0F, 1.0F, 1.0F, 0.5F);
+    draw(&material, 1);
+
+    const uint8_t first = pixel_at(0, 0)[0];
+    TEST_ASSERT_NOT_EQUAL(0, first);
+    for (uint32_t y = 0; y < HEIGHT; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+            TEST_ASSERT_EQUAL_UINT8(first, pixel_at(x, y)[0]);
+        }
+    }
+}
+
+static void test_threads_match_serial_output(void) {
+    srand(7);
+    RenderMaterial materials[3] = {solid_material(1.0F, 0.2F, 0.0F, 1.0F),
+                                   solid_material(0.1F, 0.8F, 0.3F, 1.0F),
+                                   solid_material(0.0F, 0.3F, 1.0F, 0.4F)};
+    for (uint32_t t = 0; t < 300; t++) {
+        float corners[3][3];
+        for (int i = 0; i < 3; i++) {
+            corners[i][0] = ((float)rand() / (float)RAND_MAX * 2.4F) - 1.2F;
+            corners[i][1] = ((float)rand() / (float)RAND_MAX * 2.4F) - 1.2F;
+            corners[i][2] = (float)rand() / (float)RAND_MAX;
+        }
+        add_triangle(corners[0], corners[1], corners[2]);
+        const uint32_t material = t % 3;
+        draw_list_add(&draws, material == 2 ? DRAW_PASS_BLEND : DRAW_PASS_OPAQUE, material,
+                      material, t * 3, 3);
+    }
+    draw(materials, 3);
+    uint8_t *serial = malloc(sizeof(pixels));
+    TEST_ASSERT_NOT_NULL(serial);
+    memcpy(serial, pixels, sizeof(pixels));
+
+    cpu_rasterizer_destroy(&rasterizer);
+    TEST_ASSERT_TRUE(cpu_rasterizer_init(&rasterizer, 3));
+    TEST_ASSERT_TRUE(cpu_rasterizer_resize(&rasterizer, WIDTH, HEIGHT));
+    draw(materials, 3);
+    TEST_ASSERT_EQUAL_MEMORY(serial, pixels, sizeof(pixels));
+    free(serial);
+}
+
+static void test_triangle_behind_the_camera_is_clipped(void) {
+    // One vertex behind the near plane (z < 0): only the visible part is drawn
+    add_triangle((float[3]){-1.0F, -1.0F, 0.5F}, (float[3]){1.0F, -1.0F, 0.5F},
+                 (float[3]){0.0F, 1.0F, -0.5F});
+    draw_list_add(&draws, DRAW_PASS_OPAQUE, 0, 0, 0, 3);
+    const RenderMaterial material = solid_material(1.0F, 0.0F, 0.0F, 1.0F);
+    draw(&material, 1);
+
+    TEST_ASSERT_EQUAL_UINT8(expected_unlit(1.0F), pixel_at(WIDTH / 2, 1)[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, pixel_at(WIDTH / 2, HEIGHT - 2)[0]);
+}
+
+static void test_back_faces_are_culled_only_when_asked(void) {
+    // Clockwise on screen, so facing away, in the top-left corner; counter-clockwise in the
+    // bottom-right one
+    add_triangle((float[3]){-1.0F, -1.0F, 0.5F}, (float[3]){0.0F, -1.0F, 0.5F},
+                 (float[3]){-1.0F, 0.0F, 0.5F});
+    add_triangle((float[3]){1.0F, 1.0F, 0.5F}, (float[3]){1.0F, 0.0F, 0.5F},
+                 (float[3]){0.0F, 1.0F, 0.5F});
+    draw_list_add(&draws, DRAW_PASS_OPAQUE, 0, 0, 0, 6);
+    draw_list_build(&draws);
+    const RenderMaterial material = solid_material(1.0F, 0.0F, 0.0F, 1.0F);
+    CpuFrame frame = {.mesh = &mesh,
+                      .draws = &draws,
+                      .materials = &material,
+                      .material_count = 1,
+                      .lighting = &unlit,
+                      .cull_backfaces = true};
+    glm_mat4_identity(frame.mvp);
+    glm_mat4_identity(frame.model);
+    cpu_rasterizer_draw(&rasterizer, &frame, pixels);
+    TEST_ASSERT_EQUAL_UINT8(0, pixel_at(2, 2)[0]);
+    TEST_ASSERT_EQUAL_UINT8(expected_unlit(1.0F), pixel_at(WIDTH - 3, HEIGHT - 3)[0]);
+
+    frame.cull_backfaces = false;
+    cpu_rasterizer_draw(&rasterizer, &frame, pixels);
+    TEST_ASSERT_EQUAL_UINT8(expected_unlit(1.0F), pixel_at(2, 2)[0]);
+}
+
+static void test_sky_is_redrawn_only_when_the_camera_turns(void) {
+    // A one-texel panorama: every view ray sees its colour
+    uint8_t texel[4] = {200, 0, 0, 255};
+    const Texture panorama = {.width = 1, .height = 1, .data = texel, .data_size = 4};
+    add_triangle((float[3]){-1.0F, -1.0F, 0.5F}, (float[3]){0.0F, -1.0F, 0.5F},
+                 (float[3]){-1.0F, 0.0F, 0.5F});
+    draw_list_add(&draws, DRAW_PASS_OPAQUE, 0, 0, 0, 3);
+    draw_list_build(&draws);
+    const RenderMaterial material = solid_material(0.0F, 1.0F, 0.0F, 1.0F);
+    CpuFrame frame = {.mesh = &mesh,
+                      .draws = &draws,
+                      .materials = &material,
+                      .material_count = 1,
+                      .lighting = &unlit,
+                      .skydome_texture = &panorama};
+    glm_mat4_identity(frame.mvp);
+    glm_mat4_identity(frame.model);
+    glm_mat4_identity(frame.skydome_rays);
+    cpu_rasterizer_draw(&rasterizer, &frame, pixels);
+    TEST_ASSERT_EQUAL_UINT8(200, pixel_at(WIDTH - 2, HEIGHT - 2)[0]);
+    TEST_ASSERT_EQUAL_UINT8(255, pixel_at(WIDTH - 2, HEIGHT - 2)[3]);
+    // The model still covers the sky
+    TEST_ASSERT_EQUAL_UINT8(0, pixel_at(2, 2)[0]);
+
+    // Same rays: the cached sky is copied without sampling the panorama again
+    texel[0] = 0;
+    texel[2] = 200;
+    cpu_rasterizer_draw(&rasterizer, &frame, pixels);
+    TEST_ASSERT_EQUAL_UINT8(200, pixel_at(WIDTH - 2, HEIGHT - 2)[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, pixel_at(2, 2)[0]);
+
+    frame.skydome_rays[0][0] = -1.0F;
+    cpu_rasterizer_draw(&rasterizer, &frame, pixels);
+    TEST_ASSERT_EQUAL_UINT8(0, pixel_at(WIDTH - 2, HEIGHT - 2)[0]);
+    TEST_ASSERT_EQUAL_UINT8(200, pixel_at(WIDTH - 2, HEIGHT - 2)[2]);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_covers_triangle_and_clears_the_rest);
+    RUN_TEST(test_nearer_surface_wins_in_either_order);
+    RUN_TEST(test_shared_edges_blend_exactly_once);
+    RUN_TEST(test_threads_match_serial_output);
+    RUN_TEST(test_triangle_behind_the_camera_is_clipped);
+    RUN_TEST(test_back_faces_are_culled_only_when_asked);
+    RUN_TEST(test_sky_is_redrawn_only_when_the_camera_turns);
+    return UNITY_END();
+}
@@ -0,0 +1,69 @@
+#include "renderer/device_choice.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+// Relative to the test's working directory (the build tree under meson test)
+#define CACHE_PATH "test_device_choice_cache.txt"
+
+static const char *const NAMES[] = {"llvmpipe (LLVM 17.0.6, 256 bits)",
+                                    "NVIDIA GeForce RTX 3060", "AMD Radeon Graphics (RADV)"};
+
+void setUp(void) {
+    remove(CACHE_PATH);
+}
+
+void tearDown(void) {
+    remove(CACHE_PATH);
+}
+
+static void test_spec_picks_by_index_or_name(void) {
+    TEST_ASSERT_EQUAL_INT(1, device_choice_match("1", NAMES, 3));
+    TEST_ASSERT_EQUAL_INT(-1, device_choice_match("3", NAMES, 3));
+    TEST_ASSERT_EQUAL_INT(1, device_choice_match("geforce", NAMES, 3));
+    TEST_ASSERT_EQUAL_INT(2, device_choice_match("RADV", NAMES, 3));
+    // Not a whole number, so a name
+    TEST_ASSERT_EQUAL_INT(0, device_choice_match("17.0", NAMES, 3));
+    TEST_ASSERT_EQUAL_INT(-1, device_choice_match("intel", NAMES, 3));
+    TEST_ASSERT_EQUAL_INT(-1, device_choice_match("", NAMES, 3));
+}
+
+static void test_fastest_skips_unmeasured_devices(void) {
+    const double seconds[] = {INFINITY, 0.004, 0.002, INFINITY};
+    TEST_ASSERT_EQUAL_INT(2, device_choice_fastest(seconds, 4));
+    TEST_ASSERT_EQUAL_INT(-1, device_choice_fastest(seconds, 1));
+}
+
+static void test_cache_keeps_one_entry_per_device(void) {
+    double seconds = 0.0;
+    TEST_ASSERT_FALSE(device_choice_cache_lookup(CACHE_PATH, "a-640x480", &seconds));
+
+    TEST_ASSERT_TRUE(device_choice_cache_store(CACHE_PATH, "a-640x480", 0.003));
+    TEST_ASSERT_TRUE(device_choice_cache_store(CACHE_PATH, "b-640x480", 0.005));
+    TEST_ASSERT_TRUE(device_choice_cache_store(CACHE_PATH, "a-640x480", 0.001));
+
+    TEST_ASSERT_TRUE(device_choice_cache_lookup(CACHE_PATH, "a-640x480", &seconds));
+    TEST_ASSERT_FLOAT_WITHIN(1e-9F, 0.001F, (float)seconds);
+    TEST_ASSERT_TRUE(device_choice_cache_lookup(CACHE_PATH, "b-640x480", &seconds));
+    TEST_ASSERT_FLOAT_WITHIN(1e-9F, 0.005F, (float)seconds);
+    // Another output size is another measurement
+    TEST_ASSERT_FALSE(device_choice_cache_lookup(CACHE_PATH, "a-1280x720", &seconds));
+
+    FILE *f = fopen(CACHE_PATH, "r");
+    TEST_ASSERT_NOT_NULL(f);
+    int lines = 0;
+    for (int c = fgetc(f); c != EOF; c = fgetc(f)) {
+        lines += c == '\n';
+    }
+    fclose(f);
+    TEST_ASSERT_EQUAL_INT(2, lines);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_spec_picks_by_index_or_name);
+    RUN_TEST(test_fastest_skips_unmeasured_devices);
+    RUN_TEST(test_cache_keeps_one_entry_per_device);
+    return UNITY_END();
+}
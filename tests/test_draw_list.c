@@ -0,0 +1,155 @@
+#include "renderer/draw_list.h"
+
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_contiguous_ranges_of_one_material_merge(void) {
+    DrawList list = {0};
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 0, 30);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 30, 60);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 120, 6);
+    draw_list_build(&list);
+
+    TEST_ASSERT_EQUAL_size_t(2, list.commands.count);
+    TEST_ASSERT_EQUAL_UINT32(0, list.commands.data[0].first_index);
+    TEST_ASSERT_EQUAL_UINT32(90, list.commands.data[0].index_count);
+    TEST_ASSERT_EQUAL_UINT32(1, list.commands.data[0].instance_count);
+    TEST_ASSERT_EQUAL_UINT32(120, list.commands.data[1].first_index);
+    TEST_ASSERT_EQUAL_size_t(1, list.batches.count);
+    TEST_ASSERT_EQUAL_UINT32(2, list.batches.data[0].command_count);
+    draw_list_free(&list);
+}
+
+static void test_opaque_draws_group_by_descriptor_and_material(void) {
+    DrawList list = {0};
+    // Materials 0 and 2 share textures (descriptor 0); material 1 has its own
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 0, 3);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 1, 1, 3, 3);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 2, 6, 3);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 9, 3);
+    draw_list_build(&list);
+
+    TEST_ASSERT_EQUAL_size_t(2, list.batches.count);
+    const DrawBatch *shared = &list.batches.data[0];
+    TEST_ASSERT_EQUAL_UINT32(0, shared->descriptor);
+    TEST_ASSERT_EQUAL_UINT32(3, shared->command_count);
+    TEST_ASSERT_EQUAL_UINT32(0, list.commands.data[0].first_instance);
+    TEST_ASSERT_EQUAL_UINT32(0, list.commands.data[1].first_instance);
+    TEST_ASSERT_EQUAL_UINT32(9, list.commands.data[1].first_index);
+    TEST_ASSERT_EQUAL_UINT32(2, list.commands.data[2].first_instance);
+    TEST_ASSERT_EQUAL_UINT32(1, list.batches.data[1].descriptor);
+    TEST_ASSERT_EQUAL_UINT32(3, list.batches.data[1].first_command);
+    draw_list_free(&list);
+}
+
+static void test_blend_draws_follow_opaque_in_submission_order(void) {
+    DrawList list = {0};
+    draw_list_add(&list, DRAW_PASS_BLEND, 1, 1, 0, 3);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 3, 3);
+    draw_list_add(&list, DRAW_PASS_BLEND, 0, 2, 6, 3);
+    draw_list_add(&list, DRAW_PASS_BLEND, 1, 1, 9, 3);
+    draw_list_build(&list);
+
+    TEST_ASSERT_EQUAL_size_t(4, list.commands.count);
+    TEST_ASSERT_EQUAL_UINT32(3, list.commands.data[0].first_index);
+    TEST_ASSERT_EQUAL_UINT32(0, list.commands.data[1].first_index);
+    TEST_ASSERT_EQUAL_UINT32(6, list.commands.data[2].first_index);
+    TEST_ASSERT_EQUAL_UINT32(9, list.commands.data[3].first_index);
+    // The blended draws alternate descriptors, so none of them share a batch
+    TEST_ASSERT_EQUAL_size_t(4, list.batches.count);
+    TEST_ASSERT_EQUAL_INT(DRAW_PASS_OPAQUE, list.batches.data[0].pass);
+    TEST_ASSERT_EQUAL_INT(DRAW_PASS_BLEND, list.batches.data[1].pass);
+    draw_list_free(&list);
+}
+
+static void test_reset_keeps_capacity_and_skips_empty_ranges(void) {
+    DrawList list = {0};
+    for (uint32_t i = 0; i < 100; i++) {
+        draw_list_add(&list, DRAW_PASS_OPAQUE, i % 4, i % 4, i * 3, 3);
+    }
+    draw_list_build(&list);
+    TEST_ASSERT_EQUAL_size_t(100, list.commands.count);
+    TEST_ASSERT_EQUAL_size_t(4, list.batches.count);
+
+    const size_t capacity = list.commands.capacity;
+    draw_list_reset(&list);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 0, 0);
+    draw_list_build(&list);
+    TEST_ASSERT_EQUAL_size_t(0, list.commands.count);
+    TEST_ASSERT_EQUAL_size_t(0, list.batches.count);
+    TEST_ASSERT_EQUAL_size_t(capacity, list.commands.capacity);
+    draw_list_free(&list);
+}
+
+static void test_meshlet_draws_get_one_command_each(void) {
+    DrawList list = {0};
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 0, 3);
+    draw_list_add_meshlets(&list, DRAW_PASS_OPAQUE, 0, 0, 5, 4);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 3, 3);
+    draw_list_add_meshlets(&list, DRAW_PASS_OPAQUE, 0, 1, 0, 0);
+    draw_list_build(&list);
+
+    // The plain draws still merge; the meshlet commands stay empty for the culling pass
+    TEST_ASSERT_EQUAL_size_t(1, list.batches.count);
+    TEST_ASSERT_EQUAL_size_t(5, list.commands.count);
+    TEST_ASSERT_EQUAL_UINT32(5, list.batches.data[0].command_count);
+    TEST_ASSERT_EQUAL_UINT32(6, list.commands.data[0].index_count);
+    TEST_ASSERT_EQUAL_size_t(1, list.culls.count);
+    const DrawCull *cull = &list.culls.data[0];
+    TEST_ASSERT_EQUAL_UINT32(1, cull->first_command);
+    TEST_ASSERT_EQUAL_UINT32(5, cull->first_meshlet);
+    TEST_ASSERT_EQUAL_UINT32(4, cull->meshlet_count);
+    for (uint32_t i = 1; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, list.commands.data[i].instance_count);
+    }
+
+    draw_list_reset(&list);
+    TEST_ASSERT_EQUAL_size_t(0, list.culls.count);
+    draw_list_free(&list);
+}
+
+static void test_hash_follows_what_is_recorded(void) {
+    DrawList list = {0};
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 0, 30);
+    draw_list_add(&list, DRAW_PASS_BLEND, 1, 1, 30, 6);
+    draw_list_build(&list);
+    const uint64_t batches = draw_list_hash(&list, false);
+    const uint64_t commands = draw_list_hash(&list, true);
+
+    // The same draws next frame hash the same
+    draw_list_reset(&list);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 0, 30);
+    draw_list_add(&list, DRAW_PASS_BLEND, 1, 1, 30, 6);
+    draw_list_build(&list);
+    TEST_ASSERT_TRUE(draw_list_hash(&list, false) == batches);
+    TEST_ASSERT_TRUE(draw_list_hash(&list, true) == commands);
+
+    // A coarser LOD only changes the commands, which indirect draws read from the buffer
+    draw_list_reset(&list);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 0, 0, 0, 12);
+    draw_list_add(&list, DRAW_PASS_BLEND, 1, 1, 30, 6);
+    draw_list_build(&list);
+    TEST_ASSERT_TRUE(draw_list_hash(&list, false) == batches);
+    TEST_ASSERT_FALSE(draw_list_hash(&list, true) == commands);
+
+    // Another descriptor set is another bind
+    draw_list_reset(&list);
+    draw_list_add(&list, DRAW_PASS_OPAQUE, 2, 0, 0, 30);
+    draw_list_add(&list, DRAW_PASS_BLEND, 1, 1, 30, 6);
+    draw_list_build(&list);
+    TEST_ASSERT_FALSE(draw_list_hash(&list, false) == batches);
+    draw_list_free(&list);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_contiguous_ranges_of_one_material_merge);
+    RUN_TEST(test_opaque_draws_group_by_descriptor_and_material);
+    RUN_TEST(test_blend_draws_follow_opaque_in_submission_order);
+    RUN_TEST(test_reset_keeps_capacity_and_skips_empty_ranges);
+    RUN_TEST(test_meshlet_draws_get_one_command_each);
+    RUN_TEST(test_hash_follows_what_is_recorded);
+    return UNITY_END();
+}
@@ -0,0 +1,78 @@
+#include "platform/file_watch.h"
+
+#include <stdio.h>
+#include <unity.h>
+
+// Relative to the test's working directory (the build tree under meson test)
+#define WATCHED_PATH "test_file_watch_watched.txt"
+#define OTHER_PATH "test_file_watch_other.txt"
+#define REPLACEMENT_PATH "test_file_watch_replacement.txt"
+#define LATE_PATH "test_file_watch_late.txt"
+// Long enough for the polling fallback, which sees sizes change at once
+#define WAIT_MS 2000U
+
+static FileWatch g_watch;
+
+static void write_file(const char *path, const char *contents) {
+    FILE *file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+void setUp(void) {
+    remove(LATE_PATH);
+    write_file(WATCHED_PATH, "a");
+    write_file(OTHER_PATH, "b");
+    TEST_ASSERT_TRUE(file_watch_init(&g_watch));
+}
+
+void tearDown(void) {
+    file_watch_free(&g_watch);
+    remove(WATCHED_PATH);
+    remove(OTHER_PATH);
+    remove(REPLACEMENT_PATH);
+    remove(LATE_PATH);
+}
+
+static void test_reports_only_watched_files(void) {
+    TEST_ASSERT_TRUE(file_watch_add(&g_watch, WATCHED_PATH));
+    TEST_ASSERT_TRUE(file_watch_add(&g_watch, WATCHED_PATH));
+    TEST_ASSERT_EQUAL_size_t(1, g_watch.file_count);
+    TEST_ASSERT_EQUAL_size_t(0, file_watch_wait(&g_watch, 0));
+
+    write_file(OTHER_PATH, "changed");
+    TEST_ASSERT_EQUAL_size_t(0, file_watch_wait(&g_watch, 50U));
+    write_file(WATCHED_PATH, "changed");
+    TEST_ASSERT_EQUAL_size_t(1, file_watch_wait(&g_watch, WAIT_MS));
+    TEST_ASSERT_TRUE(g_watch.files[0].changed);
+    // Reported once
+    TEST_ASSERT_EQUAL_size_t(0, file_watch_wait(&g_watch, 0));
+    TEST_ASSERT_FALSE(g_watch.files[0].changed);
+}
+
+static void test_renaming_over_a_file_changes_it(void) {
+    TEST_ASSERT_TRUE(file_watch_add(&g_watch, WATCHED_PATH));
+    write_file(REPLACEMENT_PATH, "replaced");
+    remove(WATCHED_PATH);
+    TEST_ASSERT_EQUAL_INT(0, rename(REPLACEMENT_PATH, WATCHED_PATH));
+    TEST_ASSERT_EQUAL_size_t(1, file_watch_wait(&g_watch, WAIT_MS));
+}
+
+static void test_files_may_appear_later(void) {
+    TEST_ASSERT_TRUE(file_watch_add(&g_watch, WATCHED_PATH));
+    TEST_ASSERT_TRUE(file_watch_add(&g_watch, LATE_PATH));
+    TEST_ASSERT_EQUAL_size_t(1, g_watch.directory_count);
+    write_file(LATE_PATH, "late");
+    TEST_ASSERT_EQUAL_size_t(1, file_watch_wait(&g_watch, WAIT_MS));
+    TEST_ASSERT_FALSE(g_watch.files[0].changed);
+    TEST_ASSERT_TRUE(g_watch.files[1].changed);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reports_only_watched_files);
+    RUN_TEST(test_renaming_over_a_file_changes_it);
+    RUN_TEST(test_files_may_appear_later);
+    return UNITY_END();
+}
@@ -0,0 +1,60 @@
+#include "core/frame_pacer.h"
+
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define PERIOD 0.01
+
+static void test_deadlines_keep_cadence(void) {
+    FramePacer pacer;
+    frame_pacer_init(&pacer, PERIOD);
+    frame_pacer_reset(&pacer, 1.0);
+
+    // However late within its period a frame ends, the next is due one period after the last
+    double deadline = 0.0;
+    TEST_ASSERT_EQUAL_UINT32(0, frame_pacer_schedule(&pacer, 1.002, &deadline));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.01F, (float)deadline);
+    TEST_ASSERT_EQUAL_UINT32(0, frame_pacer_schedule(&pacer, 1.0195, &deadline));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.02F, (float)deadline);
+    TEST_ASSERT_EQUAL_UINT64(0, pacer.missed_deadlines);
+    frame_pacer_destroy(&pacer);
+}
+
+static void test_overrun_skips_missed_deadlines(void) {
+    FramePacer pacer;
+    frame_pacer_init(&pacer, PERIOD);
+    frame_pacer_reset(&pacer, 1.0);
+
+    // Due at 1.01, ends at 1.035: misses 1.01, 1.02 and 1.03 and starts the next at once
+    double deadline = 0.0;
+    TEST_ASSERT_EQUAL_UINT32(3, frame_pacer_schedule(&pacer, 1.035, &deadline));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.035F, (float)deadline);
+    TEST_ASSERT_EQUAL_UINT64(3, pacer.missed_deadlines);
+
+    // Back on the original grid rather than shifted by the overrun
+    TEST_ASSERT_EQUAL_UINT32(0, frame_pacer_schedule(&pacer, 1.037, &deadline));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.04F, (float)deadline);
+    frame_pacer_destroy(&pacer);
+}
+
+static void test_unpaced_never_waits(void) {
+    FramePacer pacer;
+    frame_pacer_init(&pacer, 0.0);
+    frame_pacer_reset(&pacer, 1.0);
+
+    double deadline = 0.0;
+    TEST_ASSERT_EQUAL_UINT32(0, frame_pacer_schedule(&pacer, 5.0, &deadline));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 5.0F, (float)deadline);
+    TEST_ASSERT_EQUAL_UINT32(0, frame_pacer_wait(&pacer));
+    frame_pacer_destroy(&pacer);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_deadlines_keep_cadence);
+    RUN_TEST(test_overrun_skips_missed_deadlines);
+    RUN_TEST(test_unpaced_never_waits);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#include "core/frame_profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+static ProfileHistogram histogram;
+
+void setUp(void) {
+    memset(&histogram, 0, sizeof(histogram));
+}
+void tearDown(void) {}
+
+static void test_empty_histogram_reports_zero(void) {
+    TEST_ASSERT_EQUAL_UINT64(0, profile_histogram_percentile(&histogram, 0.5));
+    TEST_ASSERT_EQUAL_UINT64(0, profile_histogram_percentile(&histogram, 0.99));
+}
+
+static void test_small_values_are_exact(void) {
+    for (uint64_t v = 0; v < 8; v++) {
+        profile_histogram_add(&histogram, v);
+    }
+    TEST_ASSERT_EQUAL_UINT64(3, profile_histogram_percentile(&histogram, 0.5));
+    TEST_ASSERT_EQUAL_UINT64(7, profile_histogram_percentile(&histogram, 1.0));
+    TEST_ASSERT_EQUAL_UINT64(7, histogram.max);
+    TEST_ASSERT_EQUAL_UINT64(28, histogram.sum);
+}
+
+static void test_percentiles_stay_within_bucket_precision(void) {
+    // 1..10000 in order: the p-th percentile is p * 10000
+    for (uint64_t v = 1; v <= 10000; v++) {
+        profile_histogram_add(&histogram, v);
+    }
+    const double fractions[3] = {0.50, 0.95, 0.99};
+    for (int i = 0; i < 3; i++) {
+        const double expected = fractions[i] * 10000.0;
+        const double actual = (double)profile_histogram_percentile(&histogram, fractions[i]);
+        TEST_ASSERT_TRUE(actual >= expected * (1.0 - (1.0 / 8.0)));
+        TEST_ASSERT_TRUE(actual <= expected * (1.0 + (1.0 / 8.0)));
+    }
+    TEST_ASSERT_EQUAL_UINT64(10000, profile_histogram_percentile(&histogram, 1.0));
+}
+
+static void test_outlier_only_moves_the_tail(void) {
+    for (int i = 0; i < 99; i++) {
+        profile_histogram_add(&histogram, 1000);
+    }
+    profile_histogram_add(&histogram, 1000000);
+    const uint64_t p50 = profile_histogram_percentile(&histogram, 0.50);
+    TEST_ASSERT_TRUE(p50 >= 875 && p50 <= 1125);
+    TEST_ASSERT_EQUAL_UINT64(p50, profile_histogram_percentile(&histogram, 0.99));
+    TEST_ASSERT_EQUAL_UINT64(1000000, profile_histogram_percentile(&histogram, 1.0));
+}
+
+static void test_huge_values_land_in_the_last_bucket(void) {
+    profile_histogram_add(&histogram, UINT64_MAX / 2U);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[PROFILE_HISTOGRAM_BUCKETS - 1U]);
+    TEST_ASSERT_TRUE(profile_histogram_percentile(&histogram, 0.5) <= histogram.max);
+}
+
+static void test_json_lists_every_stage(void) {
+    FrameProfiler profiler;
+    frame_profiler_init(&profiler);
+    frame_profiler_add_time(&profiler, FRAME_STAGE_ENCODE, 0.002);
+    frame_profiler_add_time(&profiler, FRAME_STAGE_ENCODE, -1.0);
+    frame_profiler_add_bytes(&profiler, 4096);
+    frame_profiler_add_missed_deadlines(&profiler, 3);
+    TEST_ASSERT_EQUAL_UINT64(2000, profiler.stages[FRAME_STAGE_ENCODE].max);
+    TEST_ASSERT_EQUAL_UINT32(1, profiler.stages[FRAME_STAGE_ENCODE].buckets[0]);
+
+    FILE *stream = tmpfile();
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_TRUE(frame_profiler_write_json(&profiler, stream));
+    const long size = ftell(stream);
+    TEST_ASSERT_TRUE(size > 0);
+    char *json = calloc(1, (size_t)size + 1U);
+    TEST_ASSERT_NOT_NULL(json);
+    rewind(stream);
+    TEST_ASSERT_EQUAL_size_t((size_t)size, fread(json, 1, (size_t)size, stream));
+    fclose(stream);
+
+    const char *names[] = {"\"input\"",      "\"animation\"",  "\"fence_wait\"",
+                           "\"record\"",     "\"encode\"",     "\"write\"",
+                           "\"pace_sleep\"", "\"gpu_readback\"", "\"bytes_per_frame\""};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        TEST_ASSERT_NOT_NULL(strstr(json, names[i]));
+    }
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"encode\": {\"count\": 2, \"mean_ms\": 1.000"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"max_ms\": 2.000"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"p99\": 4096.000"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"missed_deadlines\": 3"));
+    free(json);
+}
+
+static void test_report_skips_empty_stages(void) {
+    FrameProfiler profiler;
+    frame_profiler_init(&profiler);
+    frame_profiler_add_time(&profiler, FRAME_STAGE_RECORD, 0.004);
+    frame_profiler_add_bytes(&profiler, 1000);
+    frame_profiler_add_bytes(&profiler, 3000);
+
+    FILE *stream = tmpfile();
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_TRUE(frame_profiler_write_report(&profiler, stream));
+    const long size = ftell(stream);
+    TEST_ASSERT_TRUE(size > 0);
+    char *report = calloc(1, (size_t)size + 1U);
+    TEST_ASSERT_NOT_NULL(report);
+    rewind(stream);
+    TEST_ASSERT_EQUAL_size_t((size_t)size, fread(report, 1, (size_t)size, stream));
+    fclose(stream);
+
+    TEST_ASSERT_NOT_NULL(strstr(report, "record"));
+    TEST_ASSERT_NOT_NULL(strstr(report, "4.000"));
+    TEST_ASSERT_NULL(strstr(report, "fence_wait"));
+    TEST_ASSERT_NOT_NULL(strstr(report, "bytes written: 4000"));
+    free(report);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_histogram_reports_zero);
+    RUN_TEST(test_small_values_are_exact);
+    RUN_TEST(test_percentiles_stay_within_bucket_precision);
+    RUN_TEST(test_outlier_only_moves_the_tail);
+    RUN_TEST(test_huge_values_land_in_the_last_bucket);
+    RUN_TEST(test_json_lists_every_stage);
+    RUN_TEST(test_report_skips_empty_stages);
+    return UNITY_END();
+}
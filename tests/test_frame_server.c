@@ -0,0 +1,116 @@
+#include "core/frame_server.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+// Winsock counts its initializations, so each test can have its own
+void setUp(void) {
+    TEST_ASSERT_TRUE(dcat_net_init());
+}
+void tearDown(void) {
+    dcat_net_cleanup();
+}
+
+#define FRAME_WIDTH 4U
+#define FRAME_HEIGHT 3U
+#define FRAME_BYTES (FRAME_WIDTH * FRAME_HEIGHT * 4U)
+
+static void fill_frame(uint8_t *pixels, const uint8_t seed) {
+    for (uint32_t i = 0; i < FRAME_BYTES; i++) {
+        pixels[i] = (uint8_t)(seed + i);
+    }
+}
+
+// Reads one frame off a viewer's connection and checks it is `expected`
+static void expect_frame(const DcatSocket socket, const uint8_t *expected) {
+    uint8_t header[FRAME_STREAM_HEADER_BYTES];
+    uint32_t width = 0;
+    uint32_t height = 0;
+    TEST_ASSERT_TRUE(dcat_net_recv_all(socket, header, sizeof(header)));
+    TEST_ASSERT_TRUE(frame_stream_decode_header(header, &width, &height));
+    TEST_ASSERT_EQUAL_UINT32(FRAME_WIDTH, width);
+    TEST_ASSERT_EQUAL_UINT32(FRAME_HEIGHT, height);
+    uint8_t pixels[FRAME_BYTES];
+    TEST_ASSERT_TRUE(dcat_net_recv_all(socket, pixels, sizeof(pixels)));
+    TEST_ASSERT_EQUAL_MEMORY(expected, pixels, FRAME_BYTES);
+}
+
+static void test_header_round_trip(void) {
+    uint8_t header[FRAME_STREAM_HEADER_BYTES];
+    uint32_t width = 0;
+    uint32_t height = 0;
+    frame_stream_encode_header(640, 480, header);
+    TEST_ASSERT_EQUAL_MEMORY("DCF1", header, 4);
+    TEST_ASSERT_EQUAL_UINT8(0x80, header[4]);
+    TEST_ASSERT_EQUAL_UINT8(0x02, header[5]);
+    TEST_ASSERT_TRUE(frame_stream_decode_header(header, &width, &height));
+    TEST_ASSERT_EQUAL_UINT32(640, width);
+    TEST_ASSERT_EQUAL_UINT32(480, height);
+
+    frame_stream_encode_header(0, 480, header);
+    TEST_ASSERT_FALSE(frame_stream_decode_header(header, &width, &height));
+    frame_stream_encode_header(FRAME_STREAM_MAX_SIDE + 1U, 480, header);
+    TEST_ASSERT_FALSE(frame_stream_decode_header(header, &width, &height));
+    // Each side is in range, but the frame is too large to allocate for
+    frame_stream_encode_header(FRAME_STREAM_MAX_SIDE, FRAME_STREAM_MAX_SIDE, header);
+    TEST_ASSERT_FALSE(frame_stream_decode_header(header, &width, &height));
+    frame_stream_encode_header(8192, 8192, header);
+    TEST_ASSERT_TRUE(frame_stream_decode_header(header, &width, &height));
+    frame_stream_encode_header(FRAME_STREAM_MAX_SIDE, 2, header);
+    TEST_ASSERT_TRUE(frame_stream_decode_header(header, &width, &height));
+    frame_stream_encode_header(640, 480, header);
+    header[0] = 'X';
+    TEST_ASSERT_FALSE(frame_stream_decode_header(header, &width, &height));
+}
+
+static void test_viewers_receive_the_latest_frame(void) {
+    FrameServer server;
+    TEST_ASSERT_TRUE(frame_server_start(&server, "127.0.0.1:0"));
+    const uint16_t port = frame_server_port(&server);
+    TEST_ASSERT_TRUE(port != 0);
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", (unsigned int)port);
+
+    // Published before anyone connects: each viewer starts from it
+    uint8_t first[FRAME_BYTES];
+    fill_frame(first, 1);
+    TEST_ASSERT_TRUE(frame_server_publish(&server, first, FRAME_WIDTH, FRAME_HEIGHT));
+
+    const DcatSocket viewers[2] = {dcat_net_connect(address), dcat_net_connect(address)};
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_TRUE(viewers[i] != DCAT_INVALID_SOCKET);
+        expect_frame(viewers[i], first);
+    }
+
+    uint8_t second[FRAME_BYTES];
+    fill_frame(second, 100);
+    TEST_ASSERT_TRUE(frame_server_publish(&server, second, FRAME_WIDTH, FRAME_HEIGHT));
+    for (int i = 0; i < 2; i++) {
+        expect_frame(viewers[i], second);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, frame_server_client_count(&server));
+
+    // Stopping closes every connection
+    frame_server_stop(&server);
+    uint8_t byte = 0;
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_FALSE(dcat_net_recv_all(viewers[i], &byte, 1));
+        dcat_net_close(viewers[i]);
+    }
+}
+
+static void test_bad_addresses_fail(void) {
+    FrameServer server;
+    TEST_ASSERT_FALSE(frame_server_start(&server, "no-port"));
+    TEST_ASSERT_FALSE(frame_server_start(&server, "127.0.0.1:"));
+    TEST_ASSERT_TRUE(dcat_net_connect("unix:") == DCAT_INVALID_SOCKET);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_header_round_trip);
+    RUN_TEST(test_viewers_receive_the_latest_frame);
+    RUN_TEST(test_bad_addresses_fail);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include "core/frame_writer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_format_path_expands_frame_number(void) {
+    char path[64];
+    TEST_ASSERT_TRUE(frame_writer_format_path("out_%04d.png", 7, NULL, path, sizeof(path)));
+    TEST_ASSERT_EQUAL_STRING("out_0007.png", path);
+    TEST_ASSERT_TRUE(frame_writer_format_path("%d.rgba", 123, NULL, path, sizeof(path)));
+    TEST_ASSERT_EQUAL_STRING("123.rgba", path);
+    TEST_ASSERT_TRUE(frame_writer_format_path("100%%_%d", 1, NULL, path, sizeof(path)));
+    TEST_ASSERT_EQUAL_STRING("100%_1", path);
+}
+
+static void test_format_path_rejects_bad_patterns(void) {
+    char path[16];
+    TEST_ASSERT_FALSE(frame_writer_format_path("plain.png", 0, NULL, path, sizeof(path)));
+    TEST_ASSERT_FALSE(frame_writer_format_path("%d_%d.png", 0, NULL, path, sizeof(path)));
+    TEST_ASSERT_FALSE(frame_writer_format_path("%s.png", 0, NULL, path, sizeof(path)));
+    TEST_ASSERT_FALSE(frame_writer_format_path("%0123d", 0, NULL, path, sizeof(path)));
+    // Truncation is an error, not a silently shortened path.
+    TEST_ASSERT_FALSE(frame_writer_format_path("a_very_long_name_%d", 0, NULL, path, sizeof(path)));
+}
+
+static void test_format_path_expands_model_name(void) {
+    char path[64];
+    TEST_ASSERT_TRUE(frame_writer_format_path("%s/%s_%02d.png", 3, "chair", path, sizeof(path)));
+    TEST_ASSERT_EQUAL_STRING("chair/chair_03.png", path);
+    TEST_ASSERT_TRUE(frame_writer_path_uses_name("thumbs/%s.png"));
+    TEST_ASSERT_FALSE(frame_writer_path_uses_name("thumbs/100%%s.png"));
+    TEST_ASSERT_FALSE(frame_writer_path_uses_name("thumbs/%d.png"));
+    TEST_ASSERT_FALSE(frame_writer_path_uses_name(NULL));
+}
+
+static void test_single_file_holds_every_frame(void) {
+    // Relative to the test's working directory (the build tree under meson test)
+    const char *path = "test_frame_writer_output.bin";
+
+    FrameWriter writer;
+    TEST_ASSERT_TRUE(frame_writer_open(&writer, path, NULL));
+    for (uint32_t i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(frame_writer_begin(&writer, i));
+        TEST_ASSERT_TRUE(frame_writer_write(&writer, "ab", 2));
+        TEST_ASSERT_TRUE(frame_writer_end(&writer));
+    }
+    frame_writer_close(&writer);
+
+    FILE *file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    char contents[16] = {0};
+    TEST_ASSERT_EQUAL_size_t(6, fread(contents, 1, sizeof(contents), file));
+    fclose(file);
+    remove(path);
+    TEST_ASSERT_EQUAL_STRING("ababab", contents);
+}
+
+static void test_rejects_malformed_output_path(void) {
+    FrameWriter writer;
+    TEST_ASSERT_FALSE(frame_writer_open(&writer, "frame_%x.png", NULL));
+    TEST_ASSERT_FALSE(frame_writer_open(&writer, "%d_%d", NULL));
+    TEST_ASSERT_FALSE(frame_writer_open(&writer, "%s.png", NULL));
+    TEST_ASSERT_TRUE(frame_writer_open(&writer, "-", NULL));
+    frame_writer_close(&writer);
+}
+
+// A batch of a/robot.glb and b/robot.gltf must not write both models to robot's files
+static void test_batch_names_stay_unique(void) {
+    BatchNames names = {0};
+    char name[64];
+    TEST_ASSERT_TRUE(batch_names_claim(&names, "a/robot.glb", name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("robot", name);
+    TEST_ASSERT_TRUE(batch_names_claim(&names, "b\\robot.gltf", name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("robot-2", name);
+    TEST_ASSERT_TRUE(batch_names_claim(&names, "c/Robot.obj", name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("Robot-3", name);
+    // A model really named robot-2 moves on past the one already given out
+    TEST_ASSERT_TRUE(batch_names_claim(&names, "robot-2.fbx", name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("robot-2-2", name);
+    TEST_ASSERT_TRUE(batch_names_claim(&names, "chair", name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("chair", name);
+    TEST_ASSERT_EQUAL_size_t(5, names.count);
+
+    char path[64];
+    char first[64];
+    TEST_ASSERT_TRUE(frame_writer_format_path("%s_%d.png", 0, names.names[0], first,
+                                              sizeof(first)));
+    TEST_ASSERT_TRUE(frame_writer_format_path("%s_%d.png", 0, names.names[1], path,
+                                              sizeof(path)));
+    TEST_ASSERT_TRUE(strcmp(first, path) != 0);
+    batch_names_free(&names);
+    TEST_ASSERT_EQUAL_size_t(0, names.count);
+}
+
+// A suffix takes the end of a name that fills the output
+static void test_batch_names_truncate_for_the_suffix(void) {
+    BatchNames names = {0};
+    char name[8];
+    TEST_ASSERT_TRUE(batch_names_claim(&names, "dir/longmodelname.glb", name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("longmod", name);
+    TEST_ASSERT_TRUE(batch_names_claim(&names, "longmodelname.obj", name, sizeof(name)));
+    TEST_ASSERT_EQUAL_STRING("longm-2", name);
+    batch_names_free(&names);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_format_path_expands_frame_number);
+    RUN_TEST(test_format_path_rejects_bad_patterns);
+    RUN_TEST(test_format_path_expands_model_name);
+    RUN_TEST(test_single_file_holds_every_frame);
+    RUN_TEST(test_rejects_malformed_output_path);
+    RUN_TEST(test_batch_names_stay_unique);
+    RUN_TEST(test_batch_names_truncate_for_the_suffix);
+    return UNITY_END();
+}
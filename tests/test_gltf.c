@@ -0,0 +1,316 @@
+#include "graphics/gltf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// Relative to the test's working directory (the build tree under meson test)
+#define GLB_PATH "test_gltf.glb"
+
+static Mesh g_mesh;
+static MaterialInfo *g_materials;
+static size_t g_material_count;
+static bool g_has_uvs;
+static uint8_t g_bin[1024];
+static size_t g_bin_size;
+
+void setUp(void) {
+    mesh_init(&g_mesh);
+    g_materials = NULL;
+    g_material_count = 0;
+    g_bin_size = 0;
+}
+
+void tearDown(void) {
+    mesh_free(&g_mesh);
+    materials_free(g_materials, g_material_count);
+    remove(GLB_PATH);
+}
+
+// Appends to the BIN chunk at a 4-byte boundary and returns the offset
+static size_t append(const void *data, const size_t size) {
+    g_bin_size = (g_bin_size + 3U) & ~(size_t)3U;
+    const size_t offset = g_bin_size;
+    memcpy(g_bin + offset, data, size);
+    g_bin_size += size;
+    return offset;
+}
+
+static void put_u32(FILE *f, const uint32_t value) {
+    fwrite(&value, sizeof(value), 1, f);
+}
+
+static void write_glb(const char *json) {
+    const size_t json_size = (strlen(json) + 3U) & ~(size_t)3U;
+    const size_t bin_size = (g_bin_size + 3U) & ~(size_t)3U;
+    FILE *f = fopen(GLB_PATH, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    put_u32(f, 0x46546C67U);
+    put_u32(f, 2);
+    put_u32(f, (uint32_t)(12U + 8U + json_size + (bin_size ? 8U + bin_size : 0U)));
+    put_u32(f, (uint32_t)json_size);
+    put_u32(f, 0x4E4F534AU);
+    fputs(json, f);
+    for (size_t i = strlen(json); i < json_size; i++) {
+        fputc(' ', f);
+    }
+    if (bin_size) {
+        put_u32(f, (uint32_t)bin_size);
+        put_u32(f, 0x004E4942U);
+        fwrite(g_bin, 1, g_bin_size, f);
+        for (size_t i = g_bin_size; i < bin_size; i++) {
+            fputc(0, f);
+        }
+    }
+    fclose(f);
+}
+
+static bool load(void) {
+    return gltf_load_glb(GLB_PATH, &g_mesh, &g_has_uvs, &g_materials, &g_material_count);
+}
+
+static const float QUAD_POSITIONS[4][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}};
+static const float QUAD_UVS[4][2] = {{0, 1}, {1, 1}, {1, 0}, {0, 0}};
+static const float QUAD_NORMALS[4][3] = {{0, 0, 1}, {0, 0, 1}, {0, 0, 1}, {0, 0, 1}};
+static const uint16_t QUAD_INDICES[6] = {0, 1, 2, 0, 2, 3};
+static const char IMAGE[8] = "\x89PNGfake";
+
+static void test_static_scene_is_baked(void) {
+    append(QUAD_POSITIONS, sizeof(QUAD_POSITIONS));
+    append(QUAD_UVS, sizeof(QUAD_UVS));
+    append(QUAD_NORMALS, sizeof(QUAD_NORMALS));
+    append(QUAD_INDICES, sizeof(QUAD_INDICES));
+    append(IMAGE, sizeof(IMAGE));
+    // The parent moves the child, which scales its mesh; the second primitive has normals
+    // and no material
+    write_glb(
+        "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+        "\"nodes\":[{\"name\":\"parent\",\"translation\":[0,0,5],\"children\":[1]},"
+        "{\"name\":\"child\",\"scale\":[2,2,2],\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":["
+        "{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":3,\"material\":0},"
+        "{\"attributes\":{\"POSITION\":0,\"NORMAL\":2},\"indices\":3}]}],"
+        "\"materials\":[{\"alphaMode\":\"BLEND\",\"pbrMetallicRoughness\":{"
+        "\"baseColorFactor\":[0.5,0.25,1,1],\"baseColorTexture\":{\"index\":0},"
+        "\"metallicFactor\":0,\"roughnessFactor\":0.5}}],"
+        "\"textures\":[{\"source\":0}],"
+        "\"images\":[{\"bufferView\":4,\"mimeType\":\"image/png\"}],"
+        "\"accessors\":["
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1,\"componentType\":5126,\"count\":4,\"type\":\"VEC2\"},"
+        "{\"bufferView\":2,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+        "{\"bufferView\":3,\"componentType\":5123,\"count\":6,\"type\":\"SCALAR\"}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":48},"
+        "{\"buffer\":0,\"byteOffset\":48,\"byteLength\":32},"
+        "{\"buffer\":0,\"byteOffset\":80,\"byteLength\":48},"
+        "{\"buffer\":0,\"byteOffset\":128,\"byteLength\":12},"
+        "{\"buffer\":0,\"byteOffset\":140,\"byteLength\":8}],"
+        "\"buffers\":[{\"byteLength\":148}]}");
+    TEST_ASSERT_TRUE(load());
+    TEST_ASSERT_TRUE(g_has_uvs);
+    TEST_ASSERT_FALSE(g_mesh.has_animations);
+
+    // Without normals each triangle has its own vertices, for flat shading
+    TEST_ASSERT_EQUAL_size_t(6 + 4, g_mesh.vertices.count);
+    TEST_ASSERT_EQUAL_size_t(6 + 6, g_mesh.indices.count);
+    TEST_ASSERT_EQUAL_size_t(2, g_mesh.submeshes.count);
+    TEST_ASSERT_EQUAL_UINT32(6, g_mesh.submeshes.data[1].index_offset);
+    for (uint32_t i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL_UINT32(i, g_mesh.indices.data[i]);
+        TEST_ASSERT_EQUAL_UINT32(6 + QUAD_INDICES[i], g_mesh.indices.data[6 + i]);
+    }
+
+    const Vertex *corner = &g_mesh.vertices.data[2]; // source vertex 2
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 2.0F, corner->position[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 2.0F, corner->position[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 5.0F, corner->position[2]);
+    // UVs as stored: glTF's v already runs down the image
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, corner->texcoord[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 0.0F, corner->texcoord[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, corner->normal[2]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, g_mesh.vertices.data[6 + 3].normal[2]);
+    TEST_ASSERT_EQUAL_INT(-1, corner->bone_ids[0]);
+    // No normal map, so the default tangent frame
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, corner->tangent[0]);
+
+    // The file's material, then the default for the primitive without one
+    TEST_ASSERT_EQUAL_size_t(2, g_material_count);
+    TEST_ASSERT_EQUAL_UINT32(0, g_mesh.submeshes.data[0].material_index);
+    TEST_ASSERT_EQUAL_UINT32(1, g_mesh.submeshes.data[1].material_index);
+    const MaterialInfo *mat = &g_materials[0];
+    TEST_ASSERT_EQUAL_INT(ALPHA_MODE_BLEND, mat->alpha_mode);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 0.25F, mat->base_color[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 68.0F, mat->shininess);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 0.175F, mat->specular_strength);
+    TEST_ASSERT_EQUAL_STRING("*0", mat->diffuse_path);
+    TEST_ASSERT_EQUAL_size_t(sizeof(IMAGE), mat->embedded_diffuse_size);
+    TEST_ASSERT_EQUAL_MEMORY(IMAGE, mat->embedded_diffuse, sizeof(IMAGE));
+    TEST_ASSERT_NULL(mat->normal_path);
+    TEST_ASSERT_NULL(g_materials[1].diffuse_path);
+}
+
+static void test_normal_map_gets_tangents(void) {
+    append(QUAD_POSITIONS, sizeof(QUAD_POSITIONS));
+    append(QUAD_UVS, sizeof(QUAD_UVS));
+    append(QUAD_NORMALS, sizeof(QUAD_NORMALS));
+    append(QUAD_INDICES, sizeof(QUAD_INDICES));
+    write_glb("{\"asset\":{\"version\":\"2.0\"},\"nodes\":[{\"mesh\":0}],"
+              "\"meshes\":[{\"primitives\":[{\"attributes\":"
+              "{\"POSITION\":0,\"TEXCOORD_0\":1,\"NORMAL\":2},\"indices\":3,\"material\":0}]}],"
+              "\"materials\":[{\"normalTexture\":{\"index\":0}}],"
+              "\"textures\":[{\"source\":0}],\"images\":[{\"uri\":\"tex/normal%20map.png\"}],"
+              "\"accessors\":["
+              "{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+              "{\"bufferView\":1,\"componentType\":5126,\"count\":4,\"type\":\"VEC2\"},"
+              "{\"bufferView\":2,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+              "{\"bufferView\":3,\"componentType\":5123,\"count\":6,\"type\":\"SCALAR\"}],"
+              "\"bufferViews\":[{\"buffer\":0,\"byteLength\":48},"
+              "{\"buffer\":0,\"byteOffset\":48,\"byteLength\":32},"
+              "{\"buffer\":0,\"byteOffset\":80,\"byteLength\":48},"
+              "{\"buffer\":0,\"byteOffset\":128,\"byteLength\":12}],"
+              "\"buffers\":[{\"byteLength\":140}]}");
+    TEST_ASSERT_TRUE(load());
+    TEST_ASSERT_EQUAL_size_t(4, g_mesh.vertices.count);
+    TEST_ASSERT_EQUAL_STRING("tex/normal map.png", g_materials[0].normal_path);
+
+    // u grows along +x and v down the image along -y, so the bitangent points up +y
+    for (size_t i = 0; i < g_mesh.vertices.count; i++) {
+        const Vertex *v = &g_mesh.vertices.data[i];
+        TEST_ASSERT_FLOAT_WITHIN(1e-5F, 1.0F, v->tangent[0]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5F, 1.0F, v->bitangent[1]);
+    }
+}
+
+static void test_skin_and_animation_are_read(void) {
+    static const float positions[3][3] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}};
+    static const uint8_t joints[3][4] = {{0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}};
+    static const float weights[3][4] = {{1, 0, 0, 0}, {0.5F, 0, 0, 0}, {0, 0, 0, 0}};
+    // Column-major: the joint sits one unit up
+    static const float inverse_bind[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, -1, 0, 1};
+    static const float times[2] = {0.0F, 1.5F};
+    static const float translations[2][3] = {{0, 1, 0}, {0, 2, 0}};
+    append(positions, sizeof(positions));
+    append(joints, sizeof(joints));
+    append(weights, sizeof(weights));
+    append(inverse_bind, sizeof(inverse_bind));
+    append(times, sizeof(times));
+    append(translations, sizeof(translations));
+    write_glb("{\"asset\":{\"version\":\"2.0\"},\"scenes\":[{\"nodes\":[0]}],"
+              "\"nodes\":[{\"name\":\"root\",\"children\":[1,2]},"
+              "{\"name\":\"joint\",\"translation\":[0,1,0]},"
+              "{\"name\":\"joint\",\"mesh\":0,\"skin\":0,\"translation\":[9,9,9]}],"
+              "\"skins\":[{\"joints\":[1],\"inverseBindMatrices\":3}],"
+              "\"meshes\":[{\"primitives\":[{\"attributes\":"
+              "{\"POSITION\":0,\"JOINTS_0\":1,\"WEIGHTS_0\":2}}]}],"
+              "\"animations\":[{\"name\":\"lift\",\"samplers\":[{\"input\":4,\"output\":5}],"
+              "\"channels\":[{\"sampler\":0,\"target\":{\"node\":1,\"path\":\"translation\"}},"
+              "{\"sampler\":0,\"target\":{\"node\":1,\"path\":\"weights\"}}]}],"
+              "\"accessors\":["
+              "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+              "{\"bufferView\":1,\"componentType\":5121,\"count\":3,\"type\":\"VEC4\"},"
+              "{\"bufferView\":2,\"componentType\":5126,\"count\":3,\"type\":\"VEC4\"},"
+              "{\"bufferView\":3,\"componentType\":5126,\"count\":1,\"type\":\"MAT4\"},"
+              "{\"bufferView\":4,\"componentType\":5126,\"count\":2,\"type\":\"SCALAR\"},"
+              "{\"bufferView\":5,\"componentType\":5126,\"count\":2,\"type\":\"VEC3\"}],"
+              "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},"
+              "{\"buffer\":0,\"byteOffset\":36,\"byteLength\":12},"
+              "{\"buffer\":0,\"byteOffset\":48,\"byteLength\":48},"
+              "{\"buffer\":0,\"byteOffset\":96,\"byteLength\":64},"
+              "{\"buffer\":0,\"byteOffset\":160,\"byteLength\":8},"
+              "{\"buffer\":0,\"byteOffset\":168,\"byteLength\":24}],"
+              "\"buffers\":[{\"byteLength\":192}]}");
+    TEST_ASSERT_TRUE(load());
+    TEST_ASSERT_FALSE(g_has_uvs);
+    TEST_ASSERT_TRUE(g_mesh.has_animations);
+
+    // The bind pose as stored, whatever the skinned node's own transform
+    TEST_ASSERT_EQUAL_size_t(3, g_mesh.vertices.count);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, g_mesh.vertices.data[1].position[0]);
+
+    // Repeated names are made unique, and nodes keep them in the skeleton
+    const Skeleton *skeleton = &g_mesh.skeleton;
+    TEST_ASSERT_EQUAL_size_t(3, skeleton->bone_hierarchy.count);
+    TEST_ASSERT_EQUAL_STRING("root", skeleton->bone_hierarchy.data[0].name);
+    TEST_ASSERT_EQUAL_STRING("joint", skeleton->bone_hierarchy.data[1].name);
+    TEST_ASSERT_EQUAL_STRING("joint#2", skeleton->bone_hierarchy.data[2].name);
+    TEST_ASSERT_EQUAL_INT(0, skeleton->bone_hierarchy.data[2].parent_index);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, skeleton->bone_hierarchy.data[1].initial_position[1]);
+
+    // The joint, then the node holding the mesh for the vertex no joint moves
+    TEST_ASSERT_EQUAL_size_t(2, skeleton->bones.count);
+    TEST_ASSERT_EQUAL_STRING("joint", skeleton->bones.data[0].name);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, -1.0F, skeleton->bones.data[0].offset_matrix[3][1]);
+    TEST_ASSERT_EQUAL_STRING("joint#2", skeleton->bones.data[1].name);
+    TEST_ASSERT_EQUAL_INT(0, g_mesh.vertices.data[0].bone_ids[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 0.5F, g_mesh.vertices.data[1].bone_weights[0]);
+    TEST_ASSERT_EQUAL_INT(-1, g_mesh.vertices.data[1].bone_ids[1]);
+    TEST_ASSERT_EQUAL_INT(1, g_mesh.vertices.data[2].bone_ids[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, g_mesh.vertices.data[2].bone_weights[0]);
+
+    // Milliseconds, as Assimp reports glTF animations; the weights channel is dropped
+    TEST_ASSERT_EQUAL_size_t(1, g_mesh.animations.count);
+    const Animation *animation = &g_mesh.animations.data[0];
+    TEST_ASSERT_EQUAL_STRING("lift", animation->name);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3F, 1000.0F, animation->ticks_per_second);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3F, 1500.0F, animation->duration);
+    TEST_ASSERT_EQUAL_size_t(1, animation->bone_animations.count);
+    const BoneAnimation *channel = &animation->bone_animations.data[0];
+    TEST_ASSERT_EQUAL_STRING("joint", channel->bone_name);
+    TEST_ASSERT_EQUAL_size_t(2, channel->position_keys.count);
+    TEST_ASSERT_EQUAL_size_t(0, channel->rotation_keys.count);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 2.0F, channel->position_keys.data[1].value[1]);
+    TEST_ASSERT_EQUAL_INT(0, animation->bone_node_to_anim[1]);
+    TEST_ASSERT_EQUAL_INT(-1, animation->bone_node_to_anim[0]);
+}
+
+static void test_unsupported_files_are_left_to_assimp(void) {
+    append(QUAD_POSITIONS, sizeof(QUAD_POSITIONS));
+    static const char *const rejected[] = {
+        // A buffer outside the file
+        "{\"asset\":{\"version\":\"2.0\"},\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0}}]}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":48}],"
+        "\"buffers\":[{\"byteLength\":48,\"uri\":\"quad.bin\"}]}",
+        // Compressed geometry
+        "{\"asset\":{\"version\":\"2.0\"},\"extensionsRequired\":[\"KHR_draco_mesh_compression\"]}",
+        // Triangle strips
+        "{\"asset\":{\"version\":\"2.0\"},\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"mode\":5}]}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":48}],\"buffers\":[{\"byteLength\":48}]}",
+        // An accessor running past its view
+        "{\"asset\":{\"version\":\"2.0\"},\"nodes\":[{\"mesh\":0}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0}}]}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":5,\"type\":\"VEC3\"}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":48}],\"buffers\":[{\"byteLength\":48}]}",
+        "{\"asset\":{\"version\":\"1.0\"}}",
+        "{\"asset\":",
+    };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        write_glb(rejected[i]);
+        bool has_uvs = false;
+        TEST_ASSERT_FALSE_MESSAGE(
+            gltf_load_glb(GLB_PATH, &g_mesh, &has_uvs, &g_materials, &g_material_count),
+            rejected[i]);
+        TEST_ASSERT_EQUAL_size_t(0, g_mesh.vertices.count);
+        TEST_ASSERT_NULL(g_materials);
+    }
+
+    FILE *f = fopen(GLB_PATH, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", f);
+    fclose(f);
+    bool has_uvs = false;
+    TEST_ASSERT_FALSE(gltf_load_glb(GLB_PATH, &g_mesh, &has_uvs, &g_materials, &g_material_count));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_static_scene_is_baked);
+    RUN_TEST(test_normal_map_gets_tangents);
+    RUN_TEST(test_skin_and_animation_are_read);
+    RUN_TEST(test_unsupported_files_are_left_to_assimp);
+    return UNITY_END();
+}
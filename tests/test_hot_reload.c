@@ -0,0 +1,117 @@
+#include "core/hot_reload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vips/vips.h>
+
+#ifndef SPOT_MODEL_DIR
+#define SPOT_MODEL_DIR "fixtures/spot"
+#endif
+
+// Copies in the test's working directory (the build tree under meson test), which the test
+// rewrites to trigger reloads
+#define MODEL_PATH "test_hot_reload_model.obj"
+#define TEXTURE_PATH "test_hot_reload_texture.png"
+// Generous bound on one reload, so a hung reloader fails the test instead of the run
+#define POLL_LIMIT 100U
+
+static ChangeTracker g_changes;
+static HotReload g_reload;
+static Mesh g_mesh;
+static MaterialInfo *g_materials;
+static size_t g_material_count;
+
+static void copy_file(const char *from, const char *to, const char *suffix) {
+    FILE *in = fopen(from, "rb");
+    TEST_ASSERT_NOT_NULL(in);
+    FILE *out = fopen(to, "wb");
+    TEST_ASSERT_NOT_NULL(out);
+    char buffer[4096];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        TEST_ASSERT_EQUAL_size_t(read, fwrite(buffer, 1, read, out));
+    }
+    if (suffix) {
+        fputs(suffix, out);
+    }
+    fclose(in);
+    fclose(out);
+}
+
+void setUp(void) {
+    copy_file(SPOT_MODEL_DIR "/spot_triangulated.obj", MODEL_PATH, NULL);
+    copy_file(SPOT_MODEL_DIR "/spot_texture.png", TEXTURE_PATH, NULL);
+    TEST_ASSERT_TRUE(change_tracker_init(&g_changes));
+    mesh_init(&g_mesh);
+    bool has_uvs = false;
+    TEST_ASSERT_TRUE(load_model(MODEL_PATH, &g_mesh, &has_uvs, &g_materials, &g_material_count));
+    TEST_ASSERT_TRUE(hot_reload_start(&g_reload, MODEL_PATH, TEXTURE_PATH, NULL, g_materials,
+                                      g_material_count, &g_changes));
+}
+
+void tearDown(void) {
+    hot_reload_stop(&g_reload);
+    change_tracker_destroy(&g_changes);
+    materials_free(g_materials, g_material_count);
+    mesh_free(&g_mesh);
+    remove(MODEL_PATH);
+    remove(TEXTURE_PATH);
+}
+
+static void wait_for_result(HotReloadResult *result) {
+    uint64_t seen = change_tracker_generation(&g_changes);
+    for (uint32_t i = 0; i < POLL_LIMIT; i++) {
+        if (hot_reload_take(&g_reload, result)) {
+            return;
+        }
+        seen = change_tracker_wait(&g_changes, seen, 100U);
+    }
+    TEST_FAIL_MESSAGE("reload never arrived");
+}
+
+static void test_texture_change_reloads_only_textures(void) {
+    copy_file(SPOT_MODEL_DIR "/spot_texture.png", TEXTURE_PATH, NULL);
+    HotReloadResult result;
+    wait_for_result(&result);
+    TEST_ASSERT_FALSE(result.has_model);
+    TEST_ASSERT_EQUAL_size_t(g_material_count, result.count);
+    for (size_t i = 0; i < result.count; i++) {
+        // The override names the changed file for every material
+        TEST_ASSERT_TRUE(result.replaced[i]);
+        TEST_ASSERT_TRUE(result.diffuse[i].width > 1);
+    }
+    hot_reload_result_free(&result);
+}
+
+static void test_model_change_keeps_unchanged_textures(void) {
+    copy_file(SPOT_MODEL_DIR "/spot_triangulated.obj", MODEL_PATH, "# edited\n");
+    HotReloadResult result;
+    wait_for_result(&result);
+    TEST_ASSERT_TRUE(result.has_model);
+    TEST_ASSERT_EQUAL_size_t(g_mesh.vertices.count, result.mesh.vertices.count);
+    TEST_ASSERT_EQUAL_size_t(g_material_count, result.material_count);
+    for (size_t i = 0; i < result.count; i++) {
+        TEST_ASSERT_FALSE(result.replaced[i]);
+    }
+    hot_reload_result_free(&result);
+}
+
+static void test_nothing_pending_without_changes(void) {
+    HotReloadResult result;
+    TEST_ASSERT_FALSE(hot_reload_take(&g_reload, &result));
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    if (VIPS_INIT(argv[0])) {
+        return 1;
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_texture_change_reloads_only_textures);
+    RUN_TEST(test_model_change_keeps_unchanged_textures);
+    RUN_TEST(test_nothing_pending_without_changes);
+    const int result = UNITY_END();
+    vips_shutdown();
+    return result;
+}
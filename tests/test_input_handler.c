@@ -7,9 +7,9 @@ void setUp(void) {}
 void tearDown(void) {}
 
 static void test_character_cell_delta_uses_raw_sensitivity(void) {
-    Camera camera = {.position = {0.0F, 0.0F, 1.0F}};
+    InputCommands commands = {0};
     InputThreadData data = {
-        .camera = &camera,
+        .commands = &commands,
         .mouse_orbit = true,
         .mouse_sensitivity = 0.02F,
     };
@@ -21,12 +21,55 @@ static void test_character_cell_delta_uses_raw_sensitivity(void) {
     TEST_ASSERT_EQUAL_INT(MOUSE_CSI_HANDLED,
                           mouse_parse_csi(&data, "<32;11;12M", 11, &consumed, &tracker));
 
-    TEST_ASSERT_FLOAT_WITHIN(0.0001F, 0.02F, camera.yaw);
-    TEST_ASSERT_FLOAT_WITHIN(0.0001F, -0.04F, camera.pitch);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001F, 0.02F, (float)commands.orbit_yaw);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001F, -0.04F, (float)commands.orbit_pitch);
+}
+
+static void test_snapshot_reads_latest_published(void) {
+    InputSnapshot snapshot;
+    input_snapshot_init(&snapshot);
+    TEST_ASSERT_EQUAL_INT64(0, input_snapshot_read(&snapshot)->zoom_steps);
+
+    InputCommands commands = {0};
+    for (int i = 1; i <= 3; i++) {
+        commands.zoom_steps = i;
+        input_snapshot_publish(&snapshot, &commands);
+    }
+    const InputCommands *read = input_snapshot_read(&snapshot);
+    TEST_ASSERT_EQUAL_INT64(3, read->zoom_steps);
+
+    // Nothing newer: the reader keeps its slot while the writer fills the others
+    TEST_ASSERT_EQUAL_PTR(read, input_snapshot_read(&snapshot));
+    commands.zoom_steps = 4;
+    input_snapshot_publish(&snapshot, &commands);
+    TEST_ASSERT_EQUAL_INT64(3, read->zoom_steps);
+    TEST_ASSERT_EQUAL_INT64(4, input_snapshot_read(&snapshot)->zoom_steps);
+}
+
+static void test_discrete_keys_count_presses(void) {
+    InputCommands commands = {0};
+    InputSnapshot snapshot;
+    input_snapshot_init(&snapshot);
+    InputThreadData data = {.commands = &commands, .snapshot = &snapshot};
+
+    handle_key(&data, 'm', 1, 1);
+    handle_key(&data, 'm', 1, 3); // release
+    handle_key(&data, 'm', 1, 1);
+    handle_key(&data, '2', 1, 1);
+    handle_key(&data, 'p', 1, 1);
+    handle_key(&data, 'e', 1, 1);
+
+    TEST_ASSERT_EQUAL_UINT(2, atomic_load(&snapshot.wireframe_toggles));
+    TEST_ASSERT_EQUAL_UINT(1, atomic_load(&snapshot.next_animations));
+    TEST_ASSERT_EQUAL_UINT(0, atomic_load(&snapshot.previous_animations));
+    TEST_ASSERT_EQUAL_UINT(1, atomic_load(&snapshot.play_toggles));
+    TEST_ASSERT_EQUAL_INT64(1, commands.zoom_steps);
 }
 
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_character_cell_delta_uses_raw_sensitivity);
+    RUN_TEST(test_snapshot_reads_latest_published);
+    RUN_TEST(test_discrete_keys_count_presses);
     return UNITY_END();
 }
@@ -0,0 +1,127 @@
+#include "terminal/iterm2_encoder.h"
+#include "terminal/terminal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <zlib.h>
+
+void setUp(void) {}
+
+void tearDown(void) {
+    iterm2_cleanup();
+}
+
+static uint32_t read_u32_be(const uint8_t *src) {
+    return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | src[3];
+}
+
+static void reference_base64(const uint8_t *src, const size_t len, char *dst) {
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t j = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        const uint32_t a = src[i];
+        const uint32_t b = i + 1 < len ? src[i + 1] : 0U;
+        const uint32_t c = i + 2 < len ? src[i + 2] : 0U;
+        dst[j++] = b64[a >> 2];
+        dst[j++] = b64[((a & 3U) << 4) | (b >> 4)];
+        dst[j++] = i + 1 < len ? b64[((b & 0xfU) << 2) | (c >> 6)] : '=';
+        dst[j++] = i + 2 < len ? b64[c & 0x3fU] : '=';
+    }
+    dst[j] = '\0';
+}
+
+static void test_base64_matches_reference(void) {
+    TEST_ASSERT_EQUAL_INT(8, terminal_base64_encode("foobar", 6, (char[16]){0}));
+    char small[16];
+    terminal_base64_encode("fo", 2, small);
+    TEST_ASSERT_EQUAL_STRING("Zm8=", small);
+
+    // Lengths around the 48-byte block size exercise the block loop and every tail.
+    uint8_t input[200];
+    for (size_t i = 0; i < sizeof(input); i++) {
+        input[i] = (uint8_t)((i * 151U) + 7U);
+    }
+    for (int len = 0; len <= (int)sizeof(input); len++) {
+        char expected[300];
+        char actual[300];
+        reference_base64(input, (size_t)len, expected);
+        const int written = terminal_base64_encode((const char *)input, len, actual);
+        TEST_ASSERT_EQUAL_INT((int)strlen(expected), written);
+        TEST_ASSERT_EQUAL_STRING(expected, actual);
+    }
+}
+
+// Decodes the PNG produced by the encoder (RGB, Up/None filters only) back to RGB.
+static void decode_png(const uint8_t *png, const size_t length, const uint32_t width,
+                       const uint32_t height, uint8_t *rgb) {
+    TEST_ASSERT_EQUAL_MEMORY("\x89PNG\r\n\x1a\n", png, 8);
+    TEST_ASSERT_EQUAL_MEMORY("IHDR", png + 12, 4);
+    TEST_ASSERT_EQUAL_UINT32(width, read_u32_be(png + 16));
+    TEST_ASSERT_EQUAL_UINT32(height, read_u32_be(png + 20));
+    TEST_ASSERT_EQUAL_UINT8(2, png[25]);
+
+    const uint8_t *idat = png + 33;
+    const uint32_t idat_length = read_u32_be(idat);
+    TEST_ASSERT_EQUAL_MEMORY("IDAT", idat + 4, 4);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)crc32(0L, idat + 4, idat_length + 4U),
+                             read_u32_be(idat + 8 + idat_length));
+    TEST_ASSERT_EQUAL_size_t(length, 33U + 12U + idat_length + 12U);
+    TEST_ASSERT_EQUAL_MEMORY("IEND", png + length - 8, 4);
+
+    const size_t stride = 1U + ((size_t)width * 3U);
+    uint8_t *filtered = malloc(stride * height);
+    uLongf filtered_size = (uLongf)(stride * height);
+    TEST_ASSERT_EQUAL_INT(Z_OK, uncompress(filtered, &filtered_size, idat + 8, idat_length));
+    TEST_ASSERT_EQUAL_size_t(stride * height, filtered_size);
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *row = filtered + ((size_t)y * stride);
+        uint8_t *out = rgb + ((size_t)y * width * 3U);
+        TEST_ASSERT_EQUAL_UINT8(y == 0 ? 0 : 2, row[0]);
+        for (size_t x = 0; x < (size_t)width * 3U; x++) {
+            out[x] = (uint8_t)(row[1 + x] + (y > 0 ? out[x - ((size_t)width * 3U)] : 0U));
+        }
+    }
+    free(filtered);
+}
+
+static void check_round_trip(const uint32_t width, const uint32_t height) {
+    uint8_t *pixels = malloc((size_t)width * height * 4U);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        pixels[(i * 4U) + 0U] = (uint8_t)(i * 7U);
+        pixels[(i * 4U) + 1U] = (uint8_t)(i / width);
+        pixels[(i * 4U) + 2U] = (uint8_t)((i % width) * 3U);
+        pixels[(i * 4U) + 3U] = 255;
+    }
+
+    size_t length = 0;
+    const uint8_t *png = iterm2_encode_png(pixels, width, height, &length);
+    TEST_ASSERT_NOT_NULL(png);
+
+    uint8_t *rgb = malloc((size_t)width * height * 3U);
+    decode_png(png, length, width, height, rgb);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        TEST_ASSERT_EQUAL_MEMORY(pixels + (i * 4U), rgb + (i * 3U), 3);
+    }
+    free(rgb);
+    free(pixels);
+}
+
+static void test_small_image_round_trips(void) {
+    check_round_trip(5, 3);
+}
+
+static void test_banded_image_round_trips(void) {
+    // Tall enough to be split into several independently deflated bands.
+    check_round_trip(97, 301);
+    check_round_trip(64, 512);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_base64_matches_reference);
+    RUN_TEST(test_small_image_round_trips);
+    RUN_TEST(test_banded_image_round_trips);
+    return UNITY_END();
+}
@@ -0,0 +1,107 @@
+#include "core/json.h"
+
+#include <locale.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+static JsonDocument g_doc;
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+    json_free(&g_doc);
+}
+
+static bool parse(const char *text) {
+    return json_parse(text, strlen(text), &g_doc);
+}
+
+static void test_members_and_elements_are_found_in_order(void) {
+    TEST_ASSERT_TRUE(parse("{\"nodes\": [{\"name\": \"a\", \"children\": [1, 2]}, {}, "
+                           "{\"name\": \"c\"}], \"scene\": 0, \"asset\": {\"version\": \"2.0\"}}"));
+    TEST_ASSERT_EQUAL_INT(JSON_OBJECT, g_doc.tokens[0].type);
+
+    const int nodes = json_object_get(&g_doc, 0, "nodes");
+    TEST_ASSERT_EQUAL_size_t(3, json_array_size(&g_doc, nodes));
+    const int first = json_array_get(&g_doc, nodes, 0);
+    const int children = json_object_get(&g_doc, first, "children");
+    TEST_ASSERT_EQUAL_size_t(2, json_array_size(&g_doc, children));
+    TEST_ASSERT_EQUAL_INT(2, (int)json_number(&g_doc, json_array_get(&g_doc, children, 1), -1.0));
+    const int third = json_array_get(&g_doc, nodes, 2);
+    TEST_ASSERT_TRUE(json_string_equals(&g_doc, json_object_get(&g_doc, third, "name"), "c"));
+    TEST_ASSERT_EQUAL_INT(-1, json_object_get(&g_doc, json_array_get(&g_doc, nodes, 1), "name"));
+
+    // Members after a nested value are still reached
+    const int asset = json_object_get(&g_doc, 0, "asset");
+    TEST_ASSERT_TRUE(
+        json_string_equals(&g_doc, json_object_get(&g_doc, asset, "version"), "2.0"));
+    TEST_ASSERT_EQUAL_INT(0, (int)json_number(&g_doc, json_object_get(&g_doc, 0, "scene"), -1.0));
+
+    // Absent and mistyped lookups fall through
+    TEST_ASSERT_EQUAL_INT(-1, json_array_get(&g_doc, nodes, 3));
+    TEST_ASSERT_EQUAL_INT(-1, json_object_get(&g_doc, nodes, "name"));
+    TEST_ASSERT_EQUAL_size_t(0, json_array_size(&g_doc, -1));
+    TEST_ASSERT_FLOAT_WITHIN(0.0F, 7.0F, (float)json_number(&g_doc, asset, 7.0));
+}
+
+static void test_numbers_ignore_the_locale(void) {
+    // A locale with a decimal comma, when the system has one
+    setlocale(LC_NUMERIC, "de_DE.UTF-8");
+    TEST_ASSERT_TRUE(parse("[0.5, -1.25e2, 3E-1, 1e400, -0, 16777217]"));
+    const int array = 0;
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 0.5F,
+                             (float)json_number(&g_doc, json_array_get(&g_doc, array, 0), 0.0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, -125.0F,
+                             (float)json_number(&g_doc, json_array_get(&g_doc, array, 1), 0.0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 0.3F,
+                             (float)json_number(&g_doc, json_array_get(&g_doc, array, 2), 0.0));
+    TEST_ASSERT_TRUE(isinf(json_number(&g_doc, json_array_get(&g_doc, array, 3), 0.0)));
+    TEST_ASSERT_TRUE(json_number(&g_doc, json_array_get(&g_doc, array, 5), 0.0) == 16777217.0);
+    setlocale(LC_NUMERIC, "C");
+}
+
+static void test_strings_are_unescaped(void) {
+    TEST_ASSERT_TRUE(parse("{\"a\\u0062\": \"tab\\there \\\"q\\\" \\u00e9 \\ud83d\\ude00 \\/\"}"));
+    const int value = json_object_get(&g_doc, 0, "ab");
+    TEST_ASSERT_TRUE(value >= 0);
+    char *text = json_string_dup(&g_doc, value);
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_EQUAL_STRING("tab\there \"q\" \xc3\xa9 \xf0\x9f\x98\x80 /", text);
+    free(text);
+    TEST_ASSERT_NULL(json_string_dup(&g_doc, 0));
+}
+
+static void test_malformed_input_is_rejected(void) {
+    static const char *const bad[] = {
+        "", "{", "[1,]", "{\"a\" 1}", "{\"a\": 1,}", "[1 2]", "\"open", "[01x]", "tru", "[-]",
+        "[1.]", "\"\\x\"", "\"\\u12g4\"", "{} {}", "[\"a\nb\"]", "{1: 2}",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_FALSE_MESSAGE(parse(bad[i]), bad[i]);
+    }
+
+    // Nesting stops at 64 levels rather than at the end of the stack
+    char deep[200];
+    memset(deep, '[', 100);
+    memset(deep + 100, ']', 100);
+    TEST_ASSERT_FALSE(json_parse(deep, sizeof(deep), &g_doc));
+    TEST_ASSERT_TRUE(json_parse(deep + 40, 120, &g_doc));
+    json_free(&g_doc);
+
+    // The JSON chunk of a binary glTF is padded, with spaces or NULs
+    static const char padded[] = "{\"a\": true}  \0\0";
+    TEST_ASSERT_TRUE(json_parse(padded, sizeof(padded) - 1U, &g_doc));
+    TEST_ASSERT_EQUAL_INT(JSON_TRUE, g_doc.tokens[json_object_get(&g_doc, 0, "a")].type);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_members_and_elements_are_found_in_order);
+    RUN_TEST(test_numbers_ignore_the_locale);
+    RUN_TEST(test_strings_are_unescaped);
+    RUN_TEST(test_malformed_input_is_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,190 @@
+#include "terminal/kitty_shm.h"
+#include "terminal/terminal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define FRAME_WIDTH 4U
+#define FRAME_HEIGHT 4U
+#define FRAME_SIZE ((size_t)FRAME_WIDTH * FRAME_HEIGHT * 4U)
+
+static FILE *g_capture;
+
+// What render_kitty_shm told the terminal: the file and where in it the frame is
+typedef struct SentFrame {
+    char path[256];
+    size_t size;
+    size_t offset;
+    bool in_file; // t=f, a ring slot, rather than a shm object of its own
+} SentFrame;
+
+void setUp(void) {
+    g_capture = tmpfile();
+    TEST_ASSERT_NOT_NULL(g_capture);
+    terminal_set_output_fd(fileno(g_capture));
+}
+
+void tearDown(void) {
+    terminal_set_output_fd(fileno(stdout));
+    fclose(g_capture);
+}
+
+static int base64_value(const char c) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const char *at = strchr(alphabet, c);
+    return c != '\0' && at ? (int)(at - alphabet) : -1;
+}
+
+static void base64_decode(const char *in, const size_t length, char *out, const size_t out_size) {
+    size_t written = 0;
+    unsigned int bits = 0;
+    int bit_count = 0;
+    for (size_t i = 0; i < length && in[i] != '='; i++) {
+        const int value = base64_value(in[i]);
+        TEST_ASSERT_TRUE(value >= 0);
+        bits = (bits << 6) | (unsigned int)value;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            TEST_ASSERT_TRUE(written + 1U < out_size);
+            out[written++] = (char)((bits >> bit_count) & 0xFFU);
+        }
+    }
+    out[written] = '\0';
+}
+
+static size_t command_number(const char *command, const char *key) {
+    const char *at = strstr(command, key);
+    TEST_ASSERT_NOT_NULL(at);
+    return (size_t)strtoull(at + strlen(key), NULL, 10);
+}
+
+// Renders `pixels` and parses the command it wrote
+static SentFrame send_frame(const uint8_t *pixels) {
+    TEST_ASSERT_EQUAL_INT(0, fseek(g_capture, 0, SEEK_END));
+    const long start = ftell(g_capture);
+    render_kitty_shm(pixels, FRAME_WIDTH, FRAME_HEIGHT, false);
+    TEST_ASSERT_EQUAL_INT(0, fseek(g_capture, 0, SEEK_END));
+    const long end = ftell(g_capture);
+    TEST_ASSERT_TRUE(end > start);
+    char command[1024];
+    TEST_ASSERT_TRUE((size_t)(end - start) < sizeof(command));
+    TEST_ASSERT_EQUAL_INT(0, fseek(g_capture, start, SEEK_SET));
+    const size_t length = fread(command, 1, (size_t)(end - start), g_capture);
+    TEST_ASSERT_EQUAL_size_t((size_t)(end - start), length);
+    command[length] = '\0';
+
+    SentFrame sent;
+    memset(&sent, 0, sizeof(sent));
+    sent.in_file = strstr(command, ",t=f,") != NULL;
+    if (sent.in_file) {
+        sent.size = command_number(command, ",S=");
+        sent.offset = command_number(command, ",O=");
+    }
+    const char *payload = strrchr(command, ';');
+    const char *terminator = strstr(command, "\x1b\\");
+    TEST_ASSERT_NOT_NULL(payload);
+    TEST_ASSERT_NOT_NULL(terminator);
+    base64_decode(payload + 1, (size_t)(terminator - payload - 1), sent.path, sizeof(sent.path));
+    return sent;
+}
+
+// The frame as the terminal would read it from the ring file
+static void assert_file_holds_frame(const SentFrame *sent, const uint8_t *pixels) {
+    TEST_ASSERT_TRUE(sent->in_file);
+    TEST_ASSERT_EQUAL_size_t(FRAME_SIZE, sent->size);
+    FILE *file = fopen(sent->path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    uint8_t read[FRAME_SIZE];
+    TEST_ASSERT_EQUAL_INT(0, fseek(file, (long)sent->offset, SEEK_SET));
+    TEST_ASSERT_EQUAL_size_t(FRAME_SIZE, fread(read, 1, FRAME_SIZE, file));
+    fclose(file);
+    TEST_ASSERT_EQUAL_MEMORY(pixels, read, FRAME_SIZE);
+}
+
+static void fill_frame(uint8_t *pixels, const uint8_t value) {
+    memset(pixels, value, FRAME_SIZE);
+}
+
+// Frames go into the ring's slots in turn, wrapping after the last, and each is in the file
+// where the command says while the next ones are written
+static void test_frames_rotate_through_the_ring(void) {
+    uint8_t frames[4][FRAME_SIZE];
+    SentFrame sent[4];
+    for (int i = 0; i < 4; i++) {
+        fill_frame(frames[i], (uint8_t)(0x10 * (i + 1)));
+        sent[i] = send_frame(frames[i]);
+        TEST_ASSERT_TRUE(sent[i].in_file);
+        TEST_ASSERT_EQUAL_STRING(sent[0].path, sent[i].path);
+    }
+    const size_t slot_size = sent[1].offset;
+    TEST_ASSERT_TRUE(slot_size >= FRAME_SIZE);
+    TEST_ASSERT_EQUAL_size_t(0, sent[0].offset);
+    TEST_ASSERT_EQUAL_size_t(2 * slot_size, sent[2].offset);
+    // Three slots: the fourth frame takes the first slot's place
+    TEST_ASSERT_EQUAL_size_t(0, sent[3].offset);
+
+    assert_file_holds_frame(&sent[1], frames[1]);
+    assert_file_holds_frame(&sent[2], frames[2]);
+    assert_file_holds_frame(&sent[3], frames[3]);
+}
+
+// Once the renderer maps the ring, frames it reads back into a slot are sent from there
+// without a copy
+static void test_renderer_owned_ring_sends_in_place(void) {
+    size_t slot_size = 0;
+    uint8_t *ring = kitty_shm_map_frame_ring(FRAME_SIZE, 2, 256, &slot_size);
+    TEST_ASSERT_NOT_NULL(ring);
+    TEST_ASSERT_TRUE(slot_size >= FRAME_SIZE);
+    TEST_ASSERT_EQUAL_size_t(0, slot_size % 256U);
+
+    uint8_t *second = ring + slot_size;
+    TEST_ASSERT_TRUE(kitty_shm_owns_frame(second, FRAME_SIZE));
+    TEST_ASSERT_FALSE(kitty_shm_owns_frame(ring + (2 * slot_size), 1));
+    uint8_t outside[FRAME_SIZE];
+    TEST_ASSERT_FALSE(kitty_shm_owns_frame(outside, FRAME_SIZE));
+
+    fill_frame(second, 0x5A);
+    const SentFrame sent = send_frame(second);
+    TEST_ASSERT_EQUAL_size_t(slot_size, sent.offset);
+    assert_file_holds_frame(&sent, second);
+
+#ifndef _WIN32
+    // A frame outside the renderer's ring is not copied in; it goes out in a shm object
+    fill_frame(outside, 0x33);
+    const SentFrame fallback = send_frame(outside);
+    TEST_ASSERT_FALSE(fallback.in_file);
+    TEST_ASSERT_EQUAL_INT(0, shm_unlink(fallback.path));
+#endif
+}
+
+// A renderer that cannot read frames into the ring after all (e.g. the Vulkan import failed)
+// gives it back, and frames are copied into it again instead of each going out on its own
+static void test_released_ring_takes_frames_again(void) {
+    size_t slot_size = 0;
+    uint8_t *ring = kitty_shm_map_frame_ring(FRAME_SIZE, 2, 256, &slot_size);
+    TEST_ASSERT_NOT_NULL(ring);
+    TEST_ASSERT_NULL(kitty_shm_map_frame_ring(0, 0, 0, &slot_size));
+    TEST_ASSERT_FALSE(kitty_shm_owns_frame(ring, FRAME_SIZE));
+
+    uint8_t frame[FRAME_SIZE];
+    fill_frame(frame, 0x77);
+    const SentFrame sent = send_frame(frame);
+    assert_file_holds_frame(&sent, frame);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    // The ring is process-wide: the renderer keeps it from when it maps it until it gives it
+    // back
+    RUN_TEST(test_frames_rotate_through_the_ring);
+    RUN_TEST(test_renderer_owned_ring_sends_in_place);
+    RUN_TEST(test_released_ring_takes_frames_again);
+    return UNITY_END();
+}
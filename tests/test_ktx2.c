@@ -0,0 +1,113 @@
+#include "graphics/ktx2.h"
+
+#include <string.h>
+#include <unity.h>
+
+#define VK_FORMAT_BC7_SRGB 146U
+// An 8x8 BC7 chain: 2x2 blocks, then one block for each of 4x4, 2x2 and 1x1
+#define LEVEL_COUNT 4U
+#define DATA_OFFSET 256U
+#define FILE_SIZE (DATA_OFFSET + 4U * 16U + 3U * 16U)
+
+static uint8_t g_file[FILE_SIZE];
+static Texture g_texture;
+
+static void put_u32(const size_t offset, const uint32_t value) {
+    memcpy(g_file + offset, &value, sizeof(value));
+}
+
+static void put_u64(const size_t offset, const uint64_t value) {
+    memcpy(g_file + offset, &value, sizeof(value));
+}
+
+static void build_file(const uint32_t vk_format, const uint32_t supercompression) {
+    static const uint8_t identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32,
+                                           0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    memset(g_file, 0, sizeof(g_file));
+    memcpy(g_file, identifier, sizeof(identifier));
+    put_u32(12, vk_format);
+    put_u32(16, 1);
+    put_u32(20, 8);
+    put_u32(24, 8);
+    put_u32(36, 1);
+    put_u32(40, LEVEL_COUNT);
+    put_u32(44, supercompression);
+    uint64_t offset = DATA_OFFSET;
+    for (uint32_t level = 0; level < LEVEL_COUNT; level++) {
+        const uint64_t length = level == 0 ? 64U : 16U;
+        put_u64(80 + level * 24U, offset);
+        put_u64(80 + level * 24U + 8U, length);
+        put_u64(80 + level * 24U + 16U, length);
+        memset(g_file + offset, (int)(level + 1U), (size_t)length);
+        offset += length;
+    }
+}
+
+void setUp(void) {
+    memset(&g_texture, 0, sizeof(g_texture));
+    texture_set_gpu_formats(TEXTURE_FORMAT_BIT(TEXTURE_FORMAT_BC7));
+}
+
+void tearDown(void) {
+    texture_set_gpu_formats(0);
+    texture_free(&g_texture);
+}
+
+static void test_loads_block_chain(void) {
+    build_file(VK_FORMAT_BC7_SRGB, 0);
+    TEST_ASSERT_TRUE(ktx2_is_file(g_file, sizeof(g_file)));
+    TEST_ASSERT_TRUE(texture_from_ktx2(&g_texture, g_file, sizeof(g_file), 0));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC7, g_texture.format);
+    TEST_ASSERT_EQUAL_UINT32(8, g_texture.width);
+    TEST_ASSERT_EQUAL_UINT32(LEVEL_COUNT, g_texture.mip_levels);
+    TEST_ASSERT_EQUAL_size_t(4 * 16 + 3 * 16, g_texture.data_size);
+    TEST_ASSERT_EQUAL_UINT8(1, g_texture.data[0]);
+    TEST_ASSERT_EQUAL_UINT8(4, g_texture.data[g_texture.data_size - 1]);
+}
+
+static void test_max_size_skips_large_levels(void) {
+    build_file(VK_FORMAT_BC7_SRGB, 0);
+    TEST_ASSERT_TRUE(texture_from_ktx2(&g_texture, g_file, sizeof(g_file), 4));
+    TEST_ASSERT_EQUAL_UINT32(4, g_texture.width);
+    TEST_ASSERT_EQUAL_UINT32(LEVEL_COUNT - 1, g_texture.mip_levels);
+    TEST_ASSERT_EQUAL_size_t(3 * 16, g_texture.data_size);
+    TEST_ASSERT_EQUAL_UINT8(2, g_texture.data[0]);
+}
+
+static void test_memory_loads_recognise_ktx2(void) {
+    build_file(VK_FORMAT_BC7_SRGB, 0);
+    TEST_ASSERT_TRUE(texture_from_memory(&g_texture, g_file, sizeof(g_file)));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC7, g_texture.format);
+}
+
+static void test_rejects_what_cannot_be_sampled(void) {
+    build_file(VK_FORMAT_BC7_SRGB, 0);
+    texture_set_gpu_formats(0);
+    TEST_ASSERT_FALSE(texture_from_ktx2(&g_texture, g_file, sizeof(g_file), 0));
+    TEST_ASSERT_NULL(g_texture.data);
+
+    // Basis Universal and zstd need a transcoder
+    texture_set_gpu_formats(TEXTURE_FORMAT_BIT(TEXTURE_FORMAT_BC7));
+    build_file(0, 1);
+    TEST_ASSERT_FALSE(texture_from_ktx2(&g_texture, g_file, sizeof(g_file), 0));
+    build_file(VK_FORMAT_BC7_SRGB, 2);
+    TEST_ASSERT_FALSE(texture_from_ktx2(&g_texture, g_file, sizeof(g_file), 0));
+}
+
+static void test_rejects_truncated_levels(void) {
+    build_file(VK_FORMAT_BC7_SRGB, 0);
+    TEST_ASSERT_FALSE(texture_from_ktx2(&g_texture, g_file, sizeof(g_file) - 1, 0));
+    put_u64(80 + 8, 32);
+    TEST_ASSERT_FALSE(texture_from_ktx2(&g_texture, g_file, sizeof(g_file), 0));
+    TEST_ASSERT_NULL(g_texture.data);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_loads_block_chain);
+    RUN_TEST(test_max_size_skips_large_levels);
+    RUN_TEST(test_memory_loads_recognise_ktx2);
+    RUN_TEST(test_rejects_what_cannot_be_sampled);
+    RUN_TEST(test_rejects_truncated_levels);
+    return UNITY_END();
+}
@@ -0,0 +1,251 @@
+#include "graphics/mesh_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// Relative to the test's working directory (the build tree under meson test); an empty
+// cache directory puts the entries there too
+#define SOURCE_PATH "test_mesh_cache_source.obj"
+#define CACHE_DIRECTORY ""
+
+static Mesh g_mesh;
+static Mesh g_loaded;
+static MaterialInfo *g_materials;
+static size_t g_material_count;
+
+static void write_source(const char *contents) {
+    FILE *file = fopen(SOURCE_PATH, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static void build_mesh(Mesh *mesh) {
+    for (int i = 0; i < 3; i++) {
+        Vertex v = {.position = {(float)i, (float)(i * 2), -1.0F},
+                    .texcoord = {0.5F * (float)i, 0.25F},
+                    .normal = {0.0F, 0.0F, 1.0F},
+                    .bone_ids = {i % 2, -1, -1, -1},
+                    .bone_weights = {1.0F, 0.0F, 0.0F, 0.0F}};
+        ARRAY_PUSH(mesh->vertices, v);
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        ARRAY_PUSH(mesh->indices, i);
+    }
+    SubMesh submesh = {.index_offset = 0,
+                       .index_count = 3,
+                       .bounds_radius = 2.0F,
+                       .meshlet_offset = 0,
+                       .meshlet_count = 1};
+    ARRAY_PUSH(mesh->submeshes, submesh);
+    Meshlet meshlet = {.radius = 1.5F, .cone_axis = {0.0F, 0.0F, 1.0F}, .index_count = 3};
+    ARRAY_PUSH(mesh->meshlets, meshlet);
+    mesh->coordinate_system_transform[1][2] = 3.0F;
+
+    mesh->has_animations = true;
+    bone_map_init(&mesh->skeleton.bone_map);
+    glm_mat4_identity(mesh->skeleton.global_inverse_transform);
+    const char *names[] = {"root", "arm"};
+    for (int i = 0; i < 2; i++) {
+        BoneInfo bone = {.name = str_dup(names[i]), .index = i};
+        glm_mat4_identity(bone.offset_matrix);
+        bone.offset_matrix[3][0] = (float)i;
+        ARRAY_PUSH(mesh->skeleton.bones, bone);
+        bone_map_insert(&mesh->skeleton.bone_map, names[i], i);
+
+        BoneNode node = {.name = str_dup(names[i]), .parent_index = i - 1};
+        glm_mat4_identity(node.transformation);
+        node.initial_scale[0] = node.initial_scale[1] = node.initial_scale[2] = 1.0F;
+        node.initial_rotation[3] = 1.0F;
+        ARRAY_PUSH(mesh->skeleton.bone_hierarchy, node);
+    }
+    ARRAY_PUSH(mesh->skeleton.bone_hierarchy.data[0].child_indices, 1);
+
+    Animation animation = {.name = str_dup("wave"), .duration = 2.0F, .ticks_per_second = 24.0F};
+    bone_anim_map_init(&animation.bone_anim_map);
+    BoneAnimation channel = {.bone_name = str_dup("arm")};
+    for (int i = 0; i < 3; i++) {
+        VectorKey position = {.time = (float)i, .value = {(float)i, 0.0F, 0.0F}};
+        ARRAY_PUSH(channel.position_keys, position);
+        QuaternionKey rotation = {.time = (float)i, .value = {0.0F, 0.0F, 0.0F, 1.0F}};
+        ARRAY_PUSH(channel.rotation_keys, rotation);
+    }
+    VectorKey scale = {.time = 0.0F, .value = {1.0F, 1.0F, 1.0F}};
+    ARRAY_PUSH(channel.scale_keys, scale);
+    ARRAY_PUSH(animation.bone_animations, channel);
+    bone_anim_map_insert(&animation.bone_anim_map, "arm", 0);
+    animation_bind_skeleton(&animation, &mesh->skeleton);
+    ARRAY_PUSH(mesh->animations, animation);
+}
+
+static void build_materials(MaterialInfo **out_materials, size_t *out_count) {
+    MaterialInfo *materials = calloc(2, sizeof(MaterialInfo));
+    TEST_ASSERT_NOT_NULL(materials);
+    material_info_init(&materials[0]);
+    material_info_init(&materials[1]);
+    materials[0].diffuse_path = str_dup("spot_texture.png");
+    materials[0].alpha_mode = ALPHA_MODE_MASK;
+    materials[0].base_color[1] = 0.5F;
+    materials[1].diffuse_path = str_dup("*0");
+    materials[1].normal_path = str_dup("/abs/normal.png");
+    materials[1].embedded_diffuse = malloc(5);
+    TEST_ASSERT_NOT_NULL(materials[1].embedded_diffuse);
+    memcpy(materials[1].embedded_diffuse, "\x89PNG!", 5);
+    materials[1].embedded_diffuse_size = 5;
+    *out_materials = materials;
+    *out_count = 2;
+}
+
+static void store_fixture(MeshCacheKey *key) {
+    write_source("v 0 0 0\n");
+    TEST_ASSERT_TRUE(mesh_cache_key(SOURCE_PATH, CACHE_DIRECTORY, key));
+    MaterialInfo *materials = NULL;
+    size_t count = 0;
+    build_materials(&materials, &count);
+    const bool stored = mesh_cache_store(key, SOURCE_PATH, &g_mesh, true, materials, count);
+    materials_free(materials, count);
+    TEST_ASSERT_TRUE(stored);
+}
+
+static bool load(const MeshCacheKey *key, const char *source_path) {
+    bool has_uvs = false;
+    return mesh_cache_load(key, source_path, &g_loaded, &has_uvs, &g_materials,
+                           &g_material_count) &&
+           has_uvs;
+}
+
+void setUp(void) {
+    mesh_init(&g_mesh);
+    mesh_init(&g_loaded);
+    g_materials = NULL;
+    g_material_count = 0;
+    build_mesh(&g_mesh);
+}
+
+void tearDown(void) {
+    mesh_free(&g_mesh);
+    mesh_free(&g_loaded);
+    materials_free(g_materials, g_material_count);
+    remove(SOURCE_PATH);
+}
+
+static void test_round_trip_restores_geometry(void) {
+    MeshCacheKey key;
+    store_fixture(&key);
+    TEST_ASSERT_TRUE(load(&key, SOURCE_PATH));
+    remove(key.cache_path);
+
+    TEST_ASSERT_EQUAL_size_t(g_mesh.vertices.count, g_loaded.vertices.count);
+    TEST_ASSERT_EQUAL_MEMORY(g_mesh.vertices.data, g_loaded.vertices.data,
+                             g_mesh.vertices.count * sizeof(Vertex));
+    TEST_ASSERT_EQUAL_size_t(3, g_loaded.indices.count);
+    TEST_ASSERT_EQUAL_UINT32(2, g_loaded.indices.data[2]);
+    TEST_ASSERT_EQUAL_size_t(1, g_loaded.submeshes.count);
+    TEST_ASSERT_EQUAL_FLOAT(2.0F, g_loaded.submeshes.data[0].bounds_radius);
+    TEST_ASSERT_EQUAL_size_t(1, g_loaded.meshlets.count);
+    TEST_ASSERT_EQUAL_MEMORY(g_mesh.meshlets.data, g_loaded.meshlets.data, sizeof(Meshlet));
+    TEST_ASSERT_EQUAL_FLOAT(3.0F, g_loaded.coordinate_system_transform[1][2]);
+}
+
+static void test_round_trip_restores_skeleton_and_animation(void) {
+    MeshCacheKey key;
+    store_fixture(&key);
+    TEST_ASSERT_TRUE(load(&key, SOURCE_PATH));
+    remove(key.cache_path);
+
+    TEST_ASSERT_TRUE(g_loaded.has_animations);
+    TEST_ASSERT_EQUAL_size_t(2, g_loaded.skeleton.bones.count);
+    TEST_ASSERT_EQUAL_INT(1, bone_map_find(&g_loaded.skeleton.bone_map, "arm"));
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, g_loaded.skeleton.bones.data[1].offset_matrix[3][0]);
+    TEST_ASSERT_EQUAL_size_t(2, g_loaded.skeleton.bone_hierarchy.count);
+    const BoneNode *root = &g_loaded.skeleton.bone_hierarchy.data[0];
+    TEST_ASSERT_EQUAL_INT(-1, root->parent_index);
+    TEST_ASSERT_EQUAL_size_t(1, root->child_indices.count);
+    TEST_ASSERT_EQUAL_INT(1, root->child_indices.data[0]);
+    // Loading flattens the skeleton for evaluation
+    TEST_ASSERT_EQUAL_size_t(2, g_loaded.skeleton.node_order_count);
+    TEST_ASSERT_EQUAL_INT(0, g_loaded.skeleton.node_order[0]);
+    TEST_ASSERT_EQUAL_INT(1, g_loaded.skeleton.node_bones[1]);
+
+    TEST_ASSERT_EQUAL_size_t(1, g_loaded.animations.count);
+    const Animation *animation = &g_loaded.animations.data[0];
+    TEST_ASSERT_EQUAL_STRING("wave", animation->name);
+    TEST_ASSERT_EQUAL_FLOAT(24.0F, animation->ticks_per_second);
+    const BoneAnimation *channel = &animation->bone_animations.data[0];
+    TEST_ASSERT_EQUAL_size_t(3, channel->position_keys.count);
+    TEST_ASSERT_EQUAL_FLOAT(2.0F, channel->position_keys.data[2].value[0]);
+    TEST_ASSERT_EQUAL_size_t(3, channel->rotation_keys.count);
+    TEST_ASSERT_EQUAL_FLOAT(1.0F, channel->rotation_keys.data[1].value[3]);
+    TEST_ASSERT_EQUAL_size_t(1, channel->scale_keys.count);
+    // Node 0 has no channel, node 1 ("arm") drives channel 0
+    TEST_ASSERT_EQUAL_INT(-1, animation->bone_node_to_anim[0]);
+    TEST_ASSERT_EQUAL_INT(0, animation->bone_node_to_anim[1]);
+}
+
+static void test_round_trip_restores_materials(void) {
+    MeshCacheKey key;
+    store_fixture(&key);
+    // Another spelling of the same file shares the entry; relative paths follow it
+    TEST_ASSERT_TRUE(load(&key, "./" SOURCE_PATH));
+    remove(key.cache_path);
+
+    TEST_ASSERT_EQUAL_size_t(2, g_material_count);
+    TEST_ASSERT_EQUAL_STRING("./spot_texture.png", g_materials[0].diffuse_path);
+    TEST_ASSERT_NULL(g_materials[0].normal_path);
+    TEST_ASSERT_EQUAL_INT(ALPHA_MODE_MASK, g_materials[0].alpha_mode);
+    TEST_ASSERT_EQUAL_FLOAT(0.5F, g_materials[0].base_color[1]);
+    TEST_ASSERT_EQUAL_STRING("*0", g_materials[1].diffuse_path);
+    TEST_ASSERT_EQUAL_STRING("/abs/normal.png", g_materials[1].normal_path);
+    TEST_ASSERT_EQUAL_size_t(5, g_materials[1].embedded_diffuse_size);
+    TEST_ASSERT_EQUAL_MEMORY("\x89PNG!", g_materials[1].embedded_diffuse, 5);
+    TEST_ASSERT_NULL(g_materials[1].embedded_normal);
+}
+
+static void test_changed_source_misses(void) {
+    MeshCacheKey stored;
+    store_fixture(&stored);
+    write_source("v 1 0 0\n");
+    MeshCacheKey key;
+    TEST_ASSERT_TRUE(mesh_cache_key(SOURCE_PATH, CACHE_DIRECTORY, &key));
+    TEST_ASSERT_EQUAL_STRING(stored.cache_path, key.cache_path);
+    TEST_ASSERT_NOT_EQUAL(stored.source_hash, key.source_hash);
+    TEST_ASSERT_FALSE(load(&key, SOURCE_PATH));
+    remove(key.cache_path);
+}
+
+static void test_truncated_entry_misses(void) {
+    MeshCacheKey key;
+    store_fixture(&key);
+    FILE *file = fopen(key.cache_path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    char head[512];
+    const size_t head_size = fread(head, 1, sizeof(head), file);
+    fclose(file);
+    file = fopen(key.cache_path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(head, 1, head_size, file);
+    fclose(file);
+
+    TEST_ASSERT_FALSE(load(&key, SOURCE_PATH));
+    TEST_ASSERT_NULL(g_materials);
+    TEST_ASSERT_EQUAL_size_t(0, g_loaded.vertices.count);
+    remove(key.cache_path);
+}
+
+static void test_missing_source_has_no_key(void) {
+    MeshCacheKey key;
+    TEST_ASSERT_FALSE(mesh_cache_key("does_not_exist.obj", CACHE_DIRECTORY, &key));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_restores_geometry);
+    RUN_TEST(test_round_trip_restores_skeleton_and_animation);
+    RUN_TEST(test_round_trip_restores_materials);
+    RUN_TEST(test_changed_source_misses);
+    RUN_TEST(test_truncated_entry_misses);
+    RUN_TEST(test_missing_source_has_no_key);
+    return UNITY_END();
+}
@@ -0,0 +1,78 @@
+#include "graphics/mesh_edit.h"
+
+#include <string.h>
+#include <unity.h>
+
+static Mesh g_previous;
+static Mesh g_mesh;
+
+static void build_strip(Mesh *mesh, const uint32_t vertex_count) {
+    memset(mesh, 0, sizeof(*mesh));
+    mesh->generation = 1;
+    for (uint32_t i = 0; i < vertex_count; i++) {
+        Vertex vertex = {.position = {(float)i, (float)(i % 2), 0.0F},
+                         .bone_ids = {-1, -1, -1, -1}};
+        ARRAY_PUSH(mesh->vertices, vertex);
+    }
+    for (uint32_t i = 0; i + 2 < vertex_count; i++) {
+        const uint32_t triangle[3] = {i, i + 1, i + 2};
+        for (int k = 0; k < 3; k++) {
+            ARRAY_PUSH(mesh->indices, triangle[k]);
+        }
+    }
+}
+
+void setUp(void) {
+    build_strip(&g_previous, 10);
+}
+
+void tearDown(void) {
+    ARRAY_FREE(g_previous.vertices);
+    ARRAY_FREE(g_previous.indices);
+    ARRAY_FREE(g_mesh.vertices);
+    ARRAY_FREE(g_mesh.indices);
+}
+
+static void test_unchanged_reload_has_empty_ranges(void) {
+    build_strip(&g_mesh, 10);
+    mesh_edit_diff(&g_previous, &g_mesh);
+    TEST_ASSERT_EQUAL_UINT64(2, g_mesh.generation);
+    TEST_ASSERT_EQUAL_UINT64(1, g_mesh.edit.base_generation);
+    TEST_ASSERT_EQUAL_UINT32(0, g_mesh.edit.vertex_count);
+    TEST_ASSERT_EQUAL_UINT32(0, g_mesh.edit.index_count);
+}
+
+static void test_ranges_span_the_changes(void) {
+    build_strip(&g_mesh, 10);
+    g_mesh.vertices.data[3].texcoord[0] = 0.5F;
+    g_mesh.vertices.data[6].normal[1] = 1.0F;
+    g_mesh.indices.data[20] = 0;
+    mesh_edit_diff(&g_previous, &g_mesh);
+    TEST_ASSERT_EQUAL_UINT32(3, g_mesh.edit.first_vertex);
+    TEST_ASSERT_EQUAL_UINT32(4, g_mesh.edit.vertex_count);
+    TEST_ASSERT_EQUAL_UINT32(20, g_mesh.edit.first_index);
+    TEST_ASSERT_EQUAL_UINT32(1, g_mesh.edit.index_count);
+}
+
+static void test_new_counts_replace_the_whole_mesh(void) {
+    build_strip(&g_mesh, 11);
+    mesh_edit_diff(&g_previous, &g_mesh);
+    TEST_ASSERT_EQUAL_UINT64(2, g_mesh.generation);
+    TEST_ASSERT_EQUAL_UINT64(0, g_mesh.edit.base_generation);
+
+    // Released geometry has nothing left to compare against
+    ARRAY_FREE(g_mesh.vertices);
+    ARRAY_FREE(g_mesh.indices);
+    build_strip(&g_mesh, 10);
+    g_previous.geometry_released = true;
+    mesh_edit_diff(&g_previous, &g_mesh);
+    TEST_ASSERT_EQUAL_UINT64(0, g_mesh.edit.base_generation);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unchanged_reload_has_empty_ranges);
+    RUN_TEST(test_ranges_span_the_changes);
+    RUN_TEST(test_new_counts_replace_the_whole_mesh);
+    return UNITY_END();
+}
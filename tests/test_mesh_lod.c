@@ -0,0 +1,185 @@
+#include "graphics/mesh_lod.h"
+
+#include <math.h>
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A (size + 1)^2 vertex grid in the XZ plane, optionally bent into a bump. With
+// `seam_column` >= 0 that column of vertices is duplicated, as a UV seam would be, and the
+// quads right of it use the copies.
+static void build_grid(Mesh *mesh, const int size, const bool bumpy, const int seam_column) {
+    *mesh = (Mesh){0};
+    const int row = size + 1;
+    for (int z = 0; z <= size; z++) {
+        for (int x = 0; x <= size; x++) {
+            const float u = (float)x / (float)size;
+            const float v = (float)z / (float)size;
+            const float height = bumpy ? 0.25F * sinf(u * 3.14159F) * sinf(v * 3.14159F) : 0.0F;
+            Vertex vertex = {.position = {u, height, v}, .texcoord = {u, v}};
+            ARRAY_PUSH(mesh->vertices, vertex);
+        }
+    }
+    const uint32_t seam_base = (uint32_t)mesh->vertices.count;
+    if (seam_column >= 0) {
+        for (int z = 0; z <= size; z++) {
+            Vertex copy = mesh->vertices.data[(z * row) + seam_column];
+            copy.texcoord[0] += 1.0F;
+            ARRAY_PUSH(mesh->vertices, copy);
+        }
+    }
+    for (int z = 0; z < size; z++) {
+        for (int x = 0; x < size; x++) {
+            uint32_t corner[4] = {(uint32_t)((z * row) + x), (uint32_t)((z * row) + x + 1),
+                                  (uint32_t)(((z + 1) * row) + x),
+                                  (uint32_t)(((z + 1) * row) + x + 1)};
+            if (seam_column >= 0 && x == seam_column) {
+                corner[0] = seam_base + (uint32_t)z;
+                corner[2] = seam_base + (uint32_t)z + 1;
+            }
+            const uint32_t quad[6] = {corner[0], corner[2], corner[1],
+                                      corner[1], corner[2], corner[3]};
+            for (int i = 0; i < 6; i++) {
+                ARRAY_PUSH(mesh->indices, quad[i]);
+            }
+        }
+    }
+    const SubMesh submesh = {.index_offset = 0, .index_count = (uint32_t)mesh->indices.count};
+    ARRAY_PUSH(mesh->submeshes, submesh);
+}
+
+static void free_grid(Mesh *mesh) {
+    ARRAY_FREE(mesh->vertices);
+    ARRAY_FREE(mesh->indices);
+    ARRAY_FREE(mesh->submeshes);
+}
+
+static double total_area(const Mesh *mesh, const uint32_t *indices, const size_t count) {
+    double area = 0.0;
+    for (size_t i = 0; i + 2 < count; i += 3) {
+        const float *a = mesh->vertices.data[indices[i]].position;
+        const float *b = mesh->vertices.data[indices[i + 1]].position;
+        const float *c = mesh->vertices.data[indices[i + 2]].position;
+        const double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const double e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        const double n[3] = {(e1[1] * e2[2]) - (e1[2] * e2[1]), (e1[2] * e2[0]) - (e1[0] * e2[2]),
+                             (e1[0] * e2[1]) - (e1[1] * e2[0])};
+        area += 0.5 * sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+    }
+    return area;
+}
+
+static bool references(const uint32_t *indices, const size_t count, const uint32_t vertex) {
+    for (size_t i = 0; i < count; i++) {
+        if (indices[i] == vertex) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void test_flat_grid_keeps_its_outline(void) {
+    Mesh mesh;
+    build_grid(&mesh, 32, false, -1);
+    uint32_t *out = malloc(mesh.indices.count * sizeof(uint32_t));
+    float error = 1.0F;
+    const size_t count = simplify_triangles(mesh.vertices.data, mesh.vertices.count,
+                                            mesh.indices.data, mesh.indices.count,
+                                            mesh.indices.count / 4, out, &error);
+
+    TEST_ASSERT_EQUAL_size_t(0, count % 3);
+    TEST_ASSERT_LESS_THAN_size_t(mesh.indices.count / 2, count);
+    // Border vertices are locked and nothing folds, so the plane stays covered exactly
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 1.0F, (float)total_area(&mesh, out, count));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 0.0F, error);
+    TEST_ASSERT_TRUE(references(out, count, 0));
+    TEST_ASSERT_TRUE(references(out, count, 32));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_LESS_THAN_UINT(mesh.vertices.count, out[i]);
+    }
+    free(out);
+    free_grid(&mesh);
+}
+
+static void test_uv_seam_vertices_survive(void) {
+    Mesh mesh;
+    build_grid(&mesh, 32, false, 16);
+    uint32_t *out = malloc(mesh.indices.count * sizeof(uint32_t));
+    float error = 0.0F;
+    const size_t count = simplify_triangles(mesh.vertices.data, mesh.vertices.count,
+                                            mesh.indices.data, mesh.indices.count,
+                                            mesh.indices.count / 4, out, &error);
+
+    TEST_ASSERT_LESS_THAN_size_t(mesh.indices.count / 2, count);
+    const uint32_t row = 33;
+    for (uint32_t z = 0; z <= 32; z++) {
+        TEST_ASSERT_TRUE(references(out, count, (z * row) + 16));
+        TEST_ASSERT_TRUE(references(out, count, (uint32_t)(33 * 33) + z));
+    }
+    free(out);
+    free_grid(&mesh);
+}
+
+static void test_build_lods_appends_coarser_levels(void) {
+    Mesh mesh;
+    build_grid(&mesh, 96, true, -1);
+    const size_t full_count = mesh.indices.count;
+    mesh_build_lods(&mesh);
+
+    const SubMesh *submesh = &mesh.submeshes.data[0];
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT(2, submesh->lod_count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01F, 0.5F, submesh->bounds_center[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01F, 0.5F, submesh->bounds_center[2]);
+    TEST_ASSERT_GREATER_THAN_FLOAT(0.7F, submesh->bounds_radius);
+
+    uint32_t previous_offset = (uint32_t)full_count;
+    uint32_t previous_count = submesh->index_count;
+    float previous_error = 0.0F;
+    for (uint32_t i = 0; i < submesh->lod_count; i++) {
+        const SubMeshLod *lod = &submesh->lods[i];
+        TEST_ASSERT_EQUAL_UINT(previous_offset, lod->index_offset);
+        TEST_ASSERT_LESS_THAN_UINT(previous_count, lod->index_count);
+        TEST_ASSERT_TRUE(lod->error >= previous_error);
+        previous_offset = lod->index_offset + lod->index_count;
+        previous_count = lod->index_count;
+        previous_error = lod->error;
+    }
+    TEST_ASSERT_EQUAL_size_t(previous_offset, mesh.indices.count);
+    // The bump is 0.25 high; no level may flatten it by more than that
+    TEST_ASSERT_GREATER_THAN_FLOAT(0.0F, previous_error);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.25F, previous_error);
+    free_grid(&mesh);
+}
+
+static void test_small_submeshes_skip_lods(void) {
+    Mesh mesh;
+    build_grid(&mesh, 16, true, -1);
+    const size_t full_count = mesh.indices.count;
+    mesh_build_lods(&mesh);
+    TEST_ASSERT_EQUAL_UINT(0, mesh.submeshes.data[0].lod_count);
+    TEST_ASSERT_EQUAL_size_t(full_count, mesh.indices.count);
+    free_grid(&mesh);
+}
+
+static void test_select_lod_by_pixel_error(void) {
+    SubMesh submesh = {.lod_count = 3,
+                       .lods = {{0, 0, 0.001F}, {0, 0, 0.01F}, {0, 0, 0.1F}}};
+    TEST_ASSERT_EQUAL_UINT(0, submesh_select_lod(&submesh, 10000.0F));
+    TEST_ASSERT_EQUAL_UINT(1, submesh_select_lod(&submesh, 100.0F));
+    TEST_ASSERT_EQUAL_UINT(2, submesh_select_lod(&submesh, 50.0F));
+    TEST_ASSERT_EQUAL_UINT(3, submesh_select_lod(&submesh, 5.0F));
+
+    submesh.lod_count = 0;
+    TEST_ASSERT_EQUAL_UINT(0, submesh_select_lod(&submesh, 0.0F));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_flat_grid_keeps_its_outline);
+    RUN_TEST(test_uv_seam_vertices_survive);
+    RUN_TEST(test_build_lods_appends_coarser_levels);
+    RUN_TEST(test_small_submeshes_skip_lods);
+    RUN_TEST(test_select_lod_by_pixel_error);
+    return UNITY_END();
+}
@@ -0,0 +1,192 @@
+#include "graphics/mesh_optimize.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#define GRID_SIZE 24
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A (size + 1)^2 vertex grid in the XY plane facing +Z, with its quads in a scrambled order
+static void build_shuffled_grid(Mesh *mesh, const int size) {
+    *mesh = (Mesh){0};
+    const int row = size + 1;
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            Vertex vertex = {.position = {(float)x, (float)y, 0.0F}, .normal = {0.0F, 0.0F, 1.0F}};
+            ARRAY_PUSH(mesh->vertices, vertex);
+        }
+    }
+    const uint32_t quad_count = (uint32_t)(size * size);
+    uint32_t state = 12345U;
+    uint32_t *order = malloc(quad_count * sizeof(uint32_t));
+    TEST_ASSERT_NOT_NULL(order);
+    for (uint32_t i = 0; i < quad_count; i++) {
+        order[i] = i;
+    }
+    for (uint32_t i = quad_count - 1; i > 0; i--) {
+        state = (state * 1664525U) + 1013904223U;
+        const uint32_t j = state % (i + 1);
+        const uint32_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (uint32_t q = 0; q < quad_count; q++) {
+        const uint32_t x = order[q] % (uint32_t)size;
+        const uint32_t y = order[q] / (uint32_t)size;
+        const uint32_t base = (y * (uint32_t)row) + x;
+        const uint32_t quad[6] = {base, base + 1, base + row, base + 1, base + row + 1, base + row};
+        for (int i = 0; i < 6; i++) {
+            ARRAY_PUSH(mesh->indices, quad[i]);
+        }
+    }
+    free(order);
+    const SubMesh submesh = {.index_offset = 0, .index_count = (uint32_t)mesh->indices.count};
+    ARRAY_PUSH(mesh->submeshes, submesh);
+}
+
+static void free_grid(Mesh *mesh) {
+    ARRAY_FREE(mesh->vertices);
+    ARRAY_FREE(mesh->indices);
+    ARRAY_FREE(mesh->submeshes);
+}
+
+// Each triangle rotated so its smallest corner leads, which keeps the winding
+typedef struct Triangle {
+    uint32_t v[3];
+} Triangle;
+
+static int compare_triangles(const void *a, const void *b) {
+    return memcmp(a, b, sizeof(Triangle));
+}
+
+// Identifies corners by grid position, so renumbering the vertices does not matter
+static void canonical_triangles(const Mesh *mesh, Triangle *out) {
+    const size_t count = mesh->indices.count / 3;
+    for (size_t t = 0; t < count; t++) {
+        uint32_t v[3];
+        for (int c = 0; c < 3; c++) {
+            const float *p = mesh->vertices.data[mesh->indices.data[(t * 3) + c]].position;
+            v[c] = ((uint32_t)p[1] * (GRID_SIZE + 1)) + (uint32_t)p[0];
+        }
+        int first = 0;
+        for (int c = 1; c < 3; c++) {
+            if (v[c] < v[first]) {
+                first = c;
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            out[t].v[c] = v[(first + c) % 3];
+        }
+    }
+    qsort(out, count, sizeof(Triangle), compare_triangles);
+}
+
+static void assert_same_triangles(const Mesh *before, const Mesh *after) {
+    const size_t count = before->indices.count / 3;
+    Triangle *a = malloc(count * sizeof(Triangle));
+    Triangle *b = malloc(count * sizeof(Triangle));
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    canonical_triangles(before, a);
+    canonical_triangles(after, b);
+    const int same = memcmp(a, b, count * sizeof(Triangle));
+    free(a);
+    free(b);
+    TEST_ASSERT_EQUAL_INT(0, same);
+}
+
+static void copy_mesh(const Mesh *source, Mesh *out) {
+    *out = (Mesh){0};
+    for (size_t i = 0; i < source->vertices.count; i++) {
+        ARRAY_PUSH(out->vertices, source->vertices.data[i]);
+    }
+    for (size_t i = 0; i < source->indices.count; i++) {
+        ARRAY_PUSH(out->indices, source->indices.data[i]);
+    }
+    for (size_t i = 0; i < source->submeshes.count; i++) {
+        ARRAY_PUSH(out->submeshes, source->submeshes.data[i]);
+    }
+}
+
+static void test_vertex_cache_order_beats_shuffled_order(void) {
+    Mesh mesh;
+    build_shuffled_grid(&mesh, GRID_SIZE);
+    const float before = simulate_vertex_cache(mesh.indices.data, mesh.indices.count,
+                                               mesh.vertices.count, MESH_OPTIMIZE_CACHE_SIZE);
+    uint32_t *clusters = malloc((mesh.indices.count / 3) * sizeof(uint32_t));
+    TEST_ASSERT_NOT_NULL(clusters);
+    const size_t cluster_count = optimize_vertex_cache(mesh.indices.data, mesh.indices.count,
+                                                       mesh.vertices.count, clusters);
+    const float after = simulate_vertex_cache(mesh.indices.data, mesh.indices.count,
+                                              mesh.vertices.count, MESH_OPTIMIZE_CACHE_SIZE);
+    TEST_ASSERT_TRUE(cluster_count >= 1);
+    TEST_ASSERT_EQUAL_UINT32(0, clusters[0]);
+    for (size_t i = 1; i < cluster_count; i++) {
+        TEST_ASSERT_TRUE(clusters[i] > clusters[i - 1]);
+    }
+    free(clusters);
+    free_grid(&mesh);
+    TEST_ASSERT_TRUE(before > 1.5F);
+    TEST_ASSERT_TRUE(after < 1.0F);
+}
+
+static void test_mesh_optimize_keeps_triangles_and_winding(void) {
+    Mesh mesh;
+    Mesh original;
+    build_shuffled_grid(&mesh, GRID_SIZE);
+    copy_mesh(&mesh, &original);
+    mesh_optimize(&mesh, NULL, 0);
+
+    TEST_ASSERT_EQUAL_size_t(original.vertices.count, mesh.vertices.count);
+    TEST_ASSERT_EQUAL_size_t(original.indices.count, mesh.indices.count);
+    assert_same_triangles(&original, &mesh);
+    free_grid(&mesh);
+    free_grid(&original);
+}
+
+static void test_mesh_optimize_numbers_vertices_by_first_use(void) {
+    Mesh mesh;
+    build_shuffled_grid(&mesh, GRID_SIZE);
+    mesh_optimize(&mesh, NULL, 0);
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < mesh.indices.count; i++) {
+        TEST_ASSERT_TRUE(mesh.indices.data[i] <= next);
+        if (mesh.indices.data[i] == next) {
+            next++;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(mesh.vertices.count, next);
+    free_grid(&mesh);
+}
+
+static void test_blended_submesh_keeps_triangle_order(void) {
+    Mesh mesh;
+    Mesh original;
+    build_shuffled_grid(&mesh, GRID_SIZE);
+    copy_mesh(&mesh, &original);
+    MaterialInfo material = {.alpha_mode = ALPHA_MODE_BLEND};
+    mesh_optimize(&mesh, &material, 1);
+
+    // Only the numbering changes: each triangle still has the same corners in the same place
+    for (size_t i = 0; i < mesh.indices.count; i++) {
+        const float *a = original.vertices.data[original.indices.data[i]].position;
+        const float *b = mesh.vertices.data[mesh.indices.data[i]].position;
+        TEST_ASSERT_EQUAL_FLOAT(a[0], b[0]);
+        TEST_ASSERT_EQUAL_FLOAT(a[1], b[1]);
+    }
+    free_grid(&mesh);
+    free_grid(&original);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_vertex_cache_order_beats_shuffled_order);
+    RUN_TEST(test_mesh_optimize_keeps_triangles_and_winding);
+    RUN_TEST(test_mesh_optimize_numbers_vertices_by_first_use);
+    RUN_TEST(test_blended_submesh_keeps_triangle_order);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include "graphics/meshlet.h"
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A (size + 1)^2 vertex grid in the XZ plane, facing +Y
+static void build_grid(Mesh *mesh, const int size) {
+    *mesh = (Mesh){0};
+    const int row = size + 1;
+    for (int z = 0; z <= size; z++) {
+        for (int x = 0; x <= size; x++) {
+            const float u = (float)x / (float)size;
+            const float v = (float)z / (float)size;
+            Vertex vertex = {.position = {u, 0.0F, v}, .texcoord = {u, v}};
+            ARRAY_PUSH(mesh->vertices, vertex);
+        }
+    }
+    for (int z = 0; z < size; z++) {
+        for (int x = 0; x < size; x++) {
+            const uint32_t corner[4] = {(uint32_t)((z * row) + x), (uint32_t)((z * row) + x + 1),
+                                        (uint32_t)(((z + 1) * row) + x),
+                                        (uint32_t)(((z + 1) * row) + x + 1)};
+            const uint32_t quad[6] = {corner[0], corner[2], corner[1],
+                                      corner[1], corner[2], corner[3]};
+            for (int i = 0; i < 6; i++) {
+                ARRAY_PUSH(mesh->indices, quad[i]);
+            }
+        }
+    }
+    const SubMesh submesh = {.index_offset = 0, .index_count = (uint32_t)mesh->indices.count};
+    ARRAY_PUSH(mesh->submeshes, submesh);
+}
+
+static void free_grid(Mesh *mesh) {
+    ARRAY_FREE(mesh->vertices);
+    ARRAY_FREE(mesh->indices);
+    ARRAY_FREE(mesh->submeshes);
+    ARRAY_FREE(mesh->meshlets);
+}
+
+// Distinct vertices the meshlet references
+static uint32_t count_vertices(const Mesh *mesh, const Meshlet *meshlet) {
+    uint32_t count = 0;
+    const uint32_t *indices = mesh->indices.data + meshlet->index_offset;
+    for (uint32_t i = 0; i < meshlet->index_count; i++) {
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++) {
+            seen = indices[j] == indices[i];
+        }
+        count += seen ? 0U : 1U;
+    }
+    return count;
+}
+
+static void identity(mat4 m) {
+    memset(m, 0, sizeof(mat4));
+    for (int i = 0; i < 4; i++) {
+        m[i][i] = 1.0F;
+    }
+}
+
+static void test_meshlets_cover_the_submesh(void) {
+    Mesh mesh;
+    build_grid(&mesh, 64);
+    mesh_build_meshlets(&mesh);
+
+    const SubMesh *submesh = &mesh.submeshes.data[0];
+    TEST_ASSERT_EQUAL_UINT(0, submesh->meshlet_offset);
+    TEST_ASSERT_EQUAL_size_t(mesh.meshlets.count, submesh->meshlet_count);
+    TEST_ASSERT_GREATER_THAN_UINT(64, submesh->meshlet_count);
+
+    uint32_t next_index = 0;
+    for (size_t m = 0; m < mesh.meshlets.count; m++) {
+        const Meshlet *meshlet = &mesh.meshlets.data[m];
+        TEST_ASSERT_EQUAL_UINT(next_index, meshlet->index_offset);
+        TEST_ASSERT_EQUAL_UINT(0, meshlet->index_count % 3);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT(MESHLET_MAX_TRIANGLES * 3, meshlet->index_count);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT(MESHLET_MAX_VERTICES, count_vertices(&mesh, meshlet));
+        for (uint32_t i = 0; i < meshlet->index_count; i++) {
+            const float *p = mesh.vertices.data[mesh.indices.data[meshlet->index_offset + i]]
+                                 .position;
+            const float d[3] = {p[0] - meshlet->center[0], p[1] - meshlet->center[1],
+                                p[2] - meshlet->center[2]};
+            TEST_ASSERT_TRUE(sqrtf((d[0] * d[0]) + (d[1] * d[1]) + (d[2] * d[2])) <=
+                             meshlet->radius + 1e-5F);
+        }
+        // A flat grid faces one way, so every cone is a single direction
+        TEST_ASSERT_FLOAT_WITHIN(1e-4F, 1.0F, meshlet->cone_axis[1]);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3F, 0.0F, meshlet->cone_cutoff);
+        next_index = meshlet->index_offset + meshlet->index_count;
+    }
+    TEST_ASSERT_EQUAL_UINT(submesh->index_count, next_index);
+    free_grid(&mesh);
+}
+
+static void test_small_submeshes_have_no_meshlets(void) {
+    Mesh mesh;
+    build_grid(&mesh, 16);
+    mesh_build_meshlets(&mesh);
+    TEST_ASSERT_EQUAL_size_t(0, mesh.meshlets.count);
+    TEST_ASSERT_EQUAL_UINT(0, mesh.submeshes.data[0].meshlet_count);
+    free_grid(&mesh);
+}
+
+static void test_frustum_planes_reject_outside_meshlets(void) {
+    // Clip space is model space: the frustum is the box |x|, |y| <= w with w = 1
+    mat4 mvp;
+    mat4 model;
+    identity(mvp);
+    identity(model);
+    const vec3 camera = {0.0F, 0.0F, -5.0F};
+    MeshletCullView view;
+    meshlet_cull_view_init(&view, mvp, model, camera, false);
+
+    Meshlet meshlet = {.center = {0.0F, 0.0F, 0.0F}, .radius = 0.5F, .cone_cutoff = 1.0F};
+    TEST_ASSERT_TRUE(meshlet_visible(&meshlet, &view));
+    meshlet.center[0] = 1.4F;
+    TEST_ASSERT_TRUE(meshlet_visible(&meshlet, &view));
+    meshlet.center[0] = 1.6F;
+    TEST_ASSERT_FALSE(meshlet_visible(&meshlet, &view));
+    meshlet.center[0] = 0.0F;
+    meshlet.center[1] = -1.6F;
+    TEST_ASSERT_FALSE(meshlet_visible(&meshlet, &view));
+}
+
+static void test_back_facing_cones_are_culled_only_when_asked(void) {
+    Mesh mesh;
+    build_grid(&mesh, 64);
+    mesh_build_meshlets(&mesh);
+    const Meshlet *meshlet = &mesh.meshlets.data[0];
+
+    // A wide frustum, so only the cone decides
+    mat4 mvp;
+    mat4 model;
+    identity(mvp);
+    identity(model);
+    mvp[3][3] = 100.0F;
+    const vec3 below = {meshlet->center[0], -1.0F, meshlet->center[2]};
+    const vec3 above = {meshlet->center[0], 1.0F, meshlet->center[2]};
+    MeshletCullView view;
+
+    meshlet_cull_view_init(&view, mvp, model, below, true);
+    TEST_ASSERT_FALSE(meshlet_visible(meshlet, &view));
+    meshlet_cull_view_init(&view, mvp, model, above, true);
+    TEST_ASSERT_TRUE(meshlet_visible(meshlet, &view));
+    meshlet_cull_view_init(&view, mvp, model, below, false);
+    TEST_ASSERT_TRUE(meshlet_visible(meshlet, &view));
+
+    // The camera moves into model space, and mirroring turns the test off
+    model[3][1] = -2.0F;
+    meshlet_cull_view_init(&view, mvp, model, below, true);
+    TEST_ASSERT_TRUE(meshlet_visible(meshlet, &view));
+    identity(model);
+    model[0][0] = -1.0F;
+    meshlet_cull_view_init(&view, mvp, model, below, true);
+    TEST_ASSERT_FALSE(view.cull_backfaces);
+    free_grid(&mesh);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_meshlets_cover_the_submesh);
+    RUN_TEST(test_small_submeshes_have_no_meshlets);
+    RUN_TEST(test_frustum_planes_reject_outside_meshlets);
+    RUN_TEST(test_back_facing_cones_are_culled_only_when_asked);
+    return UNITY_END();
+}
@@ -177,6 +177,35 @@ static void test_camera_setup_empty_defaults(void) {
     TEST_ASSERT_EQUAL_FLOAT(1.0F, setup.model_scale);
 }
 
+// Released geometry keeps its counts, and the camera framing its bounds give is unchanged.
+static void test_release_geometry_keeps_framing(void) {
+    bool has_uvs;
+    MaterialInfo *mats;
+    size_t count;
+    load_ok("spot_triangulated.obj", &has_uvs, &mats, &count);
+    materials_free(mats, count);
+
+    const size_t vertex_count = g_mesh.vertices.count;
+    const size_t index_count = g_mesh.indices.count;
+    CameraSetup before;
+    mesh_camera_setup(&g_mesh, &before);
+
+    mesh_release_geometry(&g_mesh);
+    TEST_ASSERT_TRUE(g_mesh.geometry_released);
+    TEST_ASSERT_NULL(g_mesh.vertices.data);
+    TEST_ASSERT_NULL(g_mesh.indices.data);
+    TEST_ASSERT_EQUAL_size_t(vertex_count, g_mesh.vertices.count);
+    TEST_ASSERT_EQUAL_size_t(index_count, g_mesh.indices.count);
+
+    CameraSetup after;
+    mesh_camera_setup(&g_mesh, &after);
+    TEST_ASSERT_EQUAL_FLOAT(before.model_scale, after.model_scale);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(before.position[i], after.position[i]);
+        TEST_ASSERT_EQUAL_FLOAT(before.target[i], after.target[i]);
+    }
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_load_triangulated_geometry);
@@ -187,5 +216,6 @@ int main(void) {
     RUN_TEST(test_load_missing_file_fails);
     RUN_TEST(test_camera_setup_from_loaded_model);
     RUN_TEST(test_camera_setup_empty_defaults);
+    RUN_TEST(test_release_geometry_keeps_framing);
     return UNITY_END();
 }
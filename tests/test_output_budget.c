@@ -0,0 +1,99 @@
+#include "terminal/output_budget.h"
+
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define TARGET_FRAME_TIME (1.0 / 30.0)
+#define FAST_WRITE_TIME 0.0001
+
+// Writes `frames` frames of `bytes` each, one per target frame time, over a link carrying
+// `rate` bytes per second with nothing left queued; a rate of 0 never blocks. Returns the
+// time after the last frame.
+static double feed(OutputBudget *budget, double now, const size_t bytes, const double rate,
+                   const int frames) {
+    for (int i = 0; i < frames; i++) {
+        const double write_time = rate > 0.0 ? (double)bytes / rate : FAST_WRITE_TIME;
+        output_budget_update(budget, now, now + write_time, bytes, 0, 0);
+        now += write_time > TARGET_FRAME_TIME ? write_time : TARGET_FRAME_TIME;
+    }
+    return now;
+}
+
+static void test_fast_link_is_left_alone(void) {
+    OutputBudget budget;
+    output_budget_init(&budget, TARGET_FRAME_TIME, OUTPUT_QUALITY_COARSE);
+    feed(&budget, 0.0, 200000, 0.0, 300);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_QUALITY_FULL, budget.quality);
+    TEST_ASSERT_TRUE(budget.link_rate == 0.0);
+    TEST_ASSERT_TRUE(output_budget_next_write_time(&budget) == budget.write_end);
+}
+
+static void test_slow_link_steps_quality_down(void) {
+    OutputBudget budget;
+    output_budget_init(&budget, TARGET_FRAME_TIME, OUTPUT_QUALITY_COARSE);
+
+    // 20 KB frames over a 100 KB/s link: six times what it carries at 30 FPS
+    TEST_ASSERT_FALSE(output_budget_update(&budget, 0.0, 0.2, 20000, 0, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1.0F, 100000.0F, (float)budget.link_rate);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_QUALITY_FULL, budget.quality);
+
+    feed(&budget, 0.2, 20000, 100000.0, 10);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_QUALITY_REDUCED_COLORS, budget.quality);
+    feed(&budget, 10.0, 20000, 100000.0, 200);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_QUALITY_COARSE, budget.quality);
+}
+
+static void test_lowest_quality_is_respected(void) {
+    OutputBudget budget;
+    output_budget_init(&budget, TARGET_FRAME_TIME, OUTPUT_QUALITY_FULL);
+    feed(&budget, 0.0, 20000, 100000.0, 200);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_QUALITY_FULL, budget.quality);
+    // Still paced to the link
+    TEST_ASSERT_TRUE(budget.link_rate > 0.0);
+}
+
+static void test_next_write_waits_for_the_link(void) {
+    OutputBudget budget;
+    output_budget_init(&budget, TARGET_FRAME_TIME, OUTPUT_QUALITY_COARSE);
+
+    // 10 KB written in 0.1 s: the link carries 100 KB/s, so the next frame waits until it
+    // has carried this one
+    output_budget_update(&budget, 1.0, 1.1, 10000, 0, 0);
+    TEST_ASSERT_FLOAT_WITHIN(0.001F, 1.1F, (float)output_budget_next_write_time(&budget));
+
+    // A write that fills the queue without blocking waits for the queue to drain too
+    output_budget_update(&budget, 2.0, 2.0 + FAST_WRITE_TIME, 1000, 0, 30000);
+    const double rate = budget.link_rate;
+    TEST_ASSERT_FLOAT_WITHIN(0.001F, (float)(2.0 + FAST_WRITE_TIME + (30000.0 / rate)),
+                             (float)output_budget_next_write_time(&budget));
+
+    // Never more than a second, however low the estimate
+    output_budget_update(&budget, 3.0, 3.0 + FAST_WRITE_TIME, 1000, 0, 100000000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001F, (float)(4.0 + FAST_WRITE_TIME),
+                             (float)output_budget_next_write_time(&budget));
+}
+
+static void test_quality_recovers_when_the_link_clears(void) {
+    OutputBudget budget;
+    output_budget_init(&budget, TARGET_FRAME_TIME, OUTPUT_QUALITY_COARSE);
+    const double now = feed(&budget, 0.0, 20000, 100000.0, 300);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_QUALITY_COARSE, budget.quality);
+
+    // Writes stop blocking: the estimate probes upward until it no longer limits, then the
+    // quality climbs back one step at a time
+    feed(&budget, now, 20000, 0.0, 1000);
+    TEST_ASSERT_TRUE(budget.link_rate == 0.0);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_QUALITY_FULL, budget.quality);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fast_link_is_left_alone);
+    RUN_TEST(test_slow_link_steps_quality_down);
+    RUN_TEST(test_lowest_quality_is_respected);
+    RUN_TEST(test_next_write_waits_for_the_link);
+    RUN_TEST(test_quality_recovers_when_the_link_clears);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+#include "terminal/output_pipeline.h"
+#include "core/types.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+static atomic_bool g_released;
+static atomic_int g_frames_begun;
+static FILE *g_capture;
+static OutputPipeline g_pipeline;
+
+// Holds the writer thread inside the first frame until the test releases it, so the frames
+// submitted meanwhile stay queued
+static void hold_frame(const uint8_t *framebuffer, uint32_t width, uint32_t height,
+                       bool use_hash_characters) {
+    (void)framebuffer;
+    (void)width;
+    (void)height;
+    (void)use_hash_characters;
+    atomic_fetch_add(&g_frames_begun, 1);
+    while (!atomic_load(&g_released)) {
+        dcat_sleep_ms(1);
+    }
+}
+
+// Frames the driver sends from in place, as kitty_shm does from its ring
+static uint8_t g_ring[3][2 * 2 * 4];
+
+static bool ring_owns_frame(const uint8_t *framebuffer, size_t size) {
+    return framebuffer >= g_ring[0] && framebuffer + size <= g_ring[0] + sizeof(g_ring);
+}
+
+static const OutputDriver g_holding_driver = {
+    .name = "holding", .render_frame = hold_frame, .owns_frame = ring_owns_frame};
+
+void setUp(void) {
+    atomic_store(&g_released, false);
+    atomic_store(&g_frames_begun, 0);
+    g_capture = tmpfile();
+    TEST_ASSERT_NOT_NULL(g_capture);
+    terminal_set_output_fd(fileno(g_capture));
+    TEST_ASSERT_TRUE(output_pipeline_start(&g_pipeline, &g_holding_driver, 0.0, NULL));
+}
+
+void tearDown(void) {
+    atomic_store(&g_released, true);
+    output_pipeline_stop(&g_pipeline);
+    terminal_set_output_fd(fileno(stdout));
+    fclose(g_capture);
+}
+
+static bool submit_pixels(const uint8_t *pixels, const char *animation_name) {
+    OutputStatus status = {.fps = 30.0F};
+    snprintf(status.animation_name, sizeof(status.animation_name), "%s", animation_name);
+    return output_pipeline_submit(&g_pipeline, pixels, 2, 2, 2, 2, false, true, &status);
+}
+
+static bool submit_frame(const char *animation_name) {
+    static const uint8_t pixels[2 * 2 * 4] = {0};
+    return submit_pixels(pixels, animation_name);
+}
+
+static void wait_for_frames_begun(const int count) {
+    while (atomic_load(&g_frames_begun) < count) {
+        dcat_sleep_ms(1);
+    }
+}
+
+// What the writer has written so far, as a string the caller frees
+static char *captured_output(void) {
+    TEST_ASSERT_EQUAL_INT(0, fseek(g_capture, 0, SEEK_END));
+    const long size = ftell(g_capture);
+    TEST_ASSERT_TRUE(size >= 0);
+    char *output = calloc((size_t)size + 1U, 1);
+    TEST_ASSERT_NOT_NULL(output);
+    rewind(g_capture);
+    TEST_ASSERT_EQUAL_size_t((size_t)size, fread(output, 1, (size_t)size, g_capture));
+    return output;
+}
+
+// A --watch reload frees the old mesh, animation names included, while a frame that shows
+// one of them can still be waiting for the writer. The queued frame keeps its own copy.
+static void test_queued_status_outlives_the_mesh(void) {
+    TEST_ASSERT_TRUE(submit_frame("idle"));
+    wait_for_frames_begun(1);
+
+    char *mesh_animation_name = str_dup("walk");
+    TEST_ASSERT_NOT_NULL(mesh_animation_name);
+    TEST_ASSERT_TRUE(submit_frame(mesh_animation_name));
+    memset(mesh_animation_name, 'x', strlen(mesh_animation_name));
+    free(mesh_animation_name);
+
+    atomic_store(&g_released, true);
+    output_pipeline_flush(&g_pipeline);
+    TEST_ASSERT_EQUAL_INT(2, atomic_load(&g_frames_begun));
+
+    char *output = captured_output();
+    const char *idle = strstr(output, "ANIM: idle");
+    const char *walk = strstr(output, "ANIM: walk");
+    TEST_ASSERT_NOT_NULL(idle);
+    TEST_ASSERT_NOT_NULL(walk);
+    TEST_ASSERT_TRUE(idle < walk);
+    free(output);
+}
+
+// A frame sent in place is held while it waits, while it is written, and after, until the
+// writer moves on to the next one; the renderer must not draw into it until then
+static void test_frames_sent_in_place_are_held(void) {
+    TEST_ASSERT_TRUE(submit_pixels(g_ring[0], "first"));
+    wait_for_frames_begun(1);
+    TEST_ASSERT_TRUE(submit_pixels(g_ring[1], "second"));
+    TEST_ASSERT_TRUE(output_pipeline_holds_frame(&g_pipeline, g_ring[0]));
+    TEST_ASSERT_TRUE(output_pipeline_holds_frame(&g_pipeline, g_ring[1]));
+    TEST_ASSERT_FALSE(output_pipeline_holds_frame(&g_pipeline, g_ring[2]));
+
+    // A newer frame replacing the queued one lets go of it
+    TEST_ASSERT_TRUE(submit_pixels(g_ring[2], "third"));
+    TEST_ASSERT_FALSE(output_pipeline_holds_frame(&g_pipeline, g_ring[1]));
+    TEST_ASSERT_TRUE(output_pipeline_holds_frame(&g_pipeline, g_ring[2]));
+
+    atomic_store(&g_released, true);
+    output_pipeline_flush(&g_pipeline);
+    TEST_ASSERT_FALSE(output_pipeline_holds_frame(&g_pipeline, g_ring[0]));
+    TEST_ASSERT_TRUE(output_pipeline_holds_frame(&g_pipeline, g_ring[2]));
+
+    // Copied frames are never held
+    static const uint8_t copied[2 * 2 * 4] = {0};
+    TEST_ASSERT_TRUE(submit_pixels(copied, "copied"));
+    output_pipeline_flush(&g_pipeline);
+    TEST_ASSERT_FALSE(output_pipeline_holds_frame(&g_pipeline, copied));
+    TEST_ASSERT_FALSE(output_pipeline_holds_frame(&g_pipeline, g_ring[2]));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_queued_status_outlives_the_mesh);
+    RUN_TEST(test_frames_sent_in_place_are_held);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+#include "core/render_scale.h"
+
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define TARGET_FRAME_TIME (1.0 / 30.0)
+
+static void feed(RenderScaleController *controller, const double frame_time, const int frames) {
+    for (int i = 0; i < frames; i++) {
+        render_scale_update(controller, frame_time);
+    }
+}
+
+static void test_starts_at_full_resolution(void) {
+    RenderScaleController controller;
+    render_scale_init(&controller, TARGET_FRAME_TIME);
+    TEST_ASSERT_EQUAL_FLOAT(RENDER_SCALE_MAX, controller.scale);
+
+    // Frames inside the budget never move the scale above full resolution.
+    feed(&controller, TARGET_FRAME_TIME * 0.2, 200);
+    TEST_ASSERT_EQUAL_FLOAT(RENDER_SCALE_MAX, controller.scale);
+}
+
+static void test_overrun_scales_down_within_bounds(void) {
+    RenderScaleController controller;
+    render_scale_init(&controller, TARGET_FRAME_TIME);
+
+    // A single slow frame is smoothed away.
+    TEST_ASSERT_FALSE(render_scale_update(&controller, TARGET_FRAME_TIME * 4.0));
+    TEST_ASSERT_EQUAL_FLOAT(RENDER_SCALE_MAX, controller.scale);
+
+    feed(&controller, TARGET_FRAME_TIME * 3.0, 20);
+    TEST_ASSERT_TRUE(controller.scale < RENDER_SCALE_MAX);
+
+    feed(&controller, TARGET_FRAME_TIME * 10.0, 500);
+    TEST_ASSERT_EQUAL_FLOAT(RENDER_SCALE_MIN, controller.scale);
+}
+
+static void test_headroom_scales_back_up(void) {
+    RenderScaleController controller;
+    render_scale_init(&controller, TARGET_FRAME_TIME);
+    feed(&controller, TARGET_FRAME_TIME * 3.0, 40);
+    const float reduced = controller.scale;
+    TEST_ASSERT_TRUE(reduced < RENDER_SCALE_MAX);
+
+    feed(&controller, TARGET_FRAME_TIME * 0.3, 400);
+    TEST_ASSERT_EQUAL_FLOAT(RENDER_SCALE_MAX, controller.scale);
+}
+
+static void test_frames_near_budget_hold_the_scale(void) {
+    RenderScaleController controller;
+    render_scale_init(&controller, TARGET_FRAME_TIME);
+    feed(&controller, TARGET_FRAME_TIME * 3.0, 40);
+    const float reduced = controller.scale;
+
+    // Between the two thresholds neither direction accumulates.
+    feed(&controller, TARGET_FRAME_TIME * 0.9, 400);
+    TEST_ASSERT_EQUAL_FLOAT(reduced, controller.scale);
+}
+
+static void test_apply_scales_dimensions(void) {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    render_scale_apply(1.0F, 1920, 1080, &width, &height);
+    TEST_ASSERT_EQUAL_UINT32(1920, width);
+    TEST_ASSERT_EQUAL_UINT32(1080, height);
+
+    render_scale_apply(0.5F, 1920, 1080, &width, &height);
+    TEST_ASSERT_EQUAL_UINT32(960, width);
+    TEST_ASSERT_EQUAL_UINT32(540, height);
+
+    // Tiny outputs keep a usable minimum, but never grow past the display size.
+    render_scale_apply(0.35F, 20, 8, &width, &height);
+    TEST_ASSERT_EQUAL_UINT32(16, width);
+    TEST_ASSERT_EQUAL_UINT32(8, height);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_at_full_resolution);
+    RUN_TEST(test_overrun_scales_down_within_bounds);
+    RUN_TEST(test_headroom_scales_back_up);
+    RUN_TEST(test_frames_near_budget_hold_the_scale);
+    RUN_TEST(test_apply_scales_dimensions);
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include "core/replay.h"
+
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define STEP 0.5F
+
+static void test_parse_events(void) {
+    ReplayScript script;
+    TEST_ASSERT_TRUE(replay_script_parse(&script,
+                                         "# warm up, then circle the model\n"
+                                         "\n"
+                                         "0 orbit 90 -45   # degrees per second\n"
+                                         "10 zoom 2\n"
+                                         "10 keys w shift\n"
+                                         "20 animation next\n"
+                                         "20 animation previous\n"
+                                         "30 play\n"
+                                         "40 wireframe\n"
+                                         "50 pan 1 0.5\n"
+                                         "60 keys",
+                                         "test"));
+    TEST_ASSERT_EQUAL_size_t(9, script.count);
+    TEST_ASSERT_EQUAL_INT(REPLAY_ORBIT, script.events[0].command);
+    TEST_ASSERT_EQUAL_UINT32(0, script.events[0].frame);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.5707963F, (float)script.events[0].x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, -0.7853982F, (float)script.events[0].y);
+    TEST_ASSERT_EQUAL_INT(REPLAY_ZOOM, script.events[1].command);
+    TEST_ASSERT_EQUAL_INT(REPLAY_KEYS, script.events[2].command);
+    TEST_ASSERT_TRUE(script.events[2].keys.w);
+    TEST_ASSERT_TRUE(script.events[2].keys.shift);
+    TEST_ASSERT_FALSE(script.events[2].keys.s);
+    TEST_ASSERT_EQUAL_INT(REPLAY_NEXT_ANIMATION, script.events[3].command);
+    TEST_ASSERT_EQUAL_INT(REPLAY_PREVIOUS_ANIMATION, script.events[4].command);
+    TEST_ASSERT_EQUAL_INT(REPLAY_PLAY, script.events[5].command);
+    TEST_ASSERT_EQUAL_INT(REPLAY_WIREFRAME, script.events[6].command);
+    TEST_ASSERT_EQUAL_INT(REPLAY_PAN, script.events[7].command);
+    TEST_ASSERT_EQUAL_UINT32(60, script.events[8].frame);
+    TEST_ASSERT_FALSE(script.events[8].keys.w);
+    replay_script_free(&script);
+}
+
+static void test_rejects_malformed_lines(void) {
+    ReplayScript script;
+    const char *bad[] = {"0 spin 1\n",
+                         "x orbit 1 2\n",
+                         "0 orbit 1\n",
+                         "0 orbit 1 two\n",
+                         "0 keys w q\n",
+                         "0 animation last\n",
+                         "0 play now\n",
+                         "-1 wireframe\n",
+                         "5 zoom 1\n2 zoom 2\n",
+                         "0\n"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_FALSE_MESSAGE(replay_script_parse(&script, bad[i], "test"), bad[i]);
+        TEST_ASSERT_NULL(script.events);
+    }
+}
+
+static void test_player_holds_motions_between_events(void) {
+    ReplayScript script;
+    TEST_ASSERT_TRUE(replay_script_parse(&script,
+                                         "0 zoom 3\n"
+                                         "0 pan 2 -2\n"
+                                         "2 zoom 0\n"
+                                         "2 keys d\n",
+                                         "test"));
+    ReplayPlayer player;
+    replay_player_init(&player, &script);
+
+    // Frame 0 sets the rates; nothing has moved yet
+    replay_player_step(&player, 0.0F);
+    TEST_ASSERT_EQUAL_INT64(0, player.commands.zoom_steps);
+    // Frame 1: half a second at 3 steps per second is 1.5 steps, one of them whole
+    replay_player_step(&player, STEP);
+    TEST_ASSERT_EQUAL_INT64(1, player.commands.zoom_steps);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 1.0F, (float)player.commands.pan_x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, -1.0F, (float)player.commands.pan_y);
+    TEST_ASSERT_FALSE(player.commands.keys.d);
+    // Frame 2 still moves by the last rates before stopping the zoom
+    replay_player_step(&player, STEP);
+    TEST_ASSERT_EQUAL_INT64(3, player.commands.zoom_steps);
+    TEST_ASSERT_TRUE(player.commands.keys.d);
+    replay_player_step(&player, STEP);
+    TEST_ASSERT_EQUAL_INT64(3, player.commands.zoom_steps);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6F, 3.0F, (float)player.commands.pan_x);
+    replay_script_free(&script);
+}
+
+static void test_player_counts_discrete_events_once(void) {
+    ReplayScript script;
+    TEST_ASSERT_TRUE(replay_script_parse(&script,
+                                         "1 wireframe\n"
+                                         "1 animation next\n"
+                                         "3 animation next\n"
+                                         "3 play\n",
+                                         "test"));
+    ReplayPlayer player;
+    replay_player_init(&player, &script);
+    replay_player_step(&player, STEP);
+    TEST_ASSERT_EQUAL_UINT(0, player.wireframe_toggles);
+    replay_player_step(&player, STEP);
+    TEST_ASSERT_EQUAL_UINT(1, player.wireframe_toggles);
+    TEST_ASSERT_EQUAL_UINT(1, player.next_animations);
+    replay_player_step(&player, STEP);
+    replay_player_step(&player, STEP);
+    replay_player_step(&player, STEP);
+    TEST_ASSERT_EQUAL_UINT(1, player.wireframe_toggles);
+    TEST_ASSERT_EQUAL_UINT(2, player.next_animations);
+    TEST_ASSERT_EQUAL_UINT(1, player.play_toggles);
+    TEST_ASSERT_EQUAL_UINT(0, player.previous_animations);
+    replay_script_free(&script);
+}
+
+static void test_missing_file_fails(void) {
+    ReplayScript script;
+    TEST_ASSERT_FALSE(replay_script_load(&script, "does/not/exist.replay"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_events);
+    RUN_TEST(test_rejects_malformed_lines);
+    RUN_TEST(test_player_holds_motions_between_events);
+    RUN_TEST(test_player_counts_discrete_events_once);
+    RUN_TEST(test_missing_file_fails);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+#include "core/scene_loader.h"
+
+#include <stdlib.h>
+#include <unity.h>
+#include <vips/vips.h>
+
+#ifndef SPOT_MODEL_DIR
+#define SPOT_MODEL_DIR "fixtures/spot"
+#endif
+
+#define SPOT_MODEL SPOT_MODEL_DIR "/spot_triangulated.obj"
+#define SPOT_TEXTURE SPOT_MODEL_DIR "/spot_texture.png"
+// Generous bound on one step of a load, so a hung loader fails the test instead of the run
+#define POLL_LIMIT 600U
+
+static ChangeTracker g_changes;
+static SceneLoader g_loader;
+
+void setUp(void) {
+    TEST_ASSERT_TRUE(change_tracker_init(&g_changes));
+}
+
+void tearDown(void) {
+    scene_loader_stop(&g_loader);
+    change_tracker_destroy(&g_changes);
+}
+
+static void wait_for_geometry(Mesh *mesh, MaterialInfo **materials, size_t *material_count,
+                              bool *failed) {
+    bool has_uvs = false;
+    uint64_t seen = change_tracker_generation(&g_changes);
+    for (uint32_t i = 0; i < POLL_LIMIT; i++) {
+        if (scene_loader_take_geometry(&g_loader, mesh, &has_uvs, materials, material_count,
+                                       failed) ||
+            *failed) {
+            return;
+        }
+        seen = change_tracker_wait(&g_changes, seen, 100U);
+    }
+    TEST_FAIL_MESSAGE("geometry never arrived");
+}
+
+static void test_delivers_geometry_then_textures(void) {
+    TEST_ASSERT_TRUE(
+        scene_loader_start(&g_loader, SPOT_MODEL, SPOT_TEXTURE, NULL, &g_changes));
+    Mesh mesh;
+    MaterialInfo *materials = NULL;
+    size_t material_count = 0;
+    bool failed = false;
+    wait_for_geometry(&mesh, &materials, &material_count, &failed);
+    TEST_ASSERT_FALSE(failed);
+    TEST_ASSERT_TRUE(mesh.vertices.count > 0);
+    TEST_ASSERT_TRUE(material_count > 0);
+
+    size_t delivered = 0;
+    uint64_t seen = change_tracker_generation(&g_changes);
+    for (uint32_t i = 0; i < POLL_LIMIT && !scene_loader_done(&g_loader); i++) {
+        size_t material = 0;
+        Texture diffuse;
+        Texture normal;
+        while (scene_loader_take_textures(&g_loader, &material, &diffuse, &normal)) {
+            TEST_ASSERT_TRUE(material < material_count);
+            // The override replaces the 1x1 default gray
+            TEST_ASSERT_TRUE(diffuse.width > 1);
+            TEST_ASSERT_NOT_NULL(normal.data);
+            texture_free(&diffuse);
+            texture_free(&normal);
+            delivered++;
+        }
+        seen = change_tracker_wait(&g_changes, seen, 100U);
+    }
+    TEST_ASSERT_TRUE(scene_loader_done(&g_loader));
+    TEST_ASSERT_EQUAL_size_t(material_count, delivered);
+
+    scene_loader_stop(&g_loader);
+    materials_free(materials, material_count);
+    mesh_free(&mesh);
+}
+
+static void test_missing_model_fails(void) {
+    TEST_ASSERT_TRUE(scene_loader_start(&g_loader, SPOT_MODEL_DIR "/does_not_exist.obj", NULL,
+                                        NULL, &g_changes));
+    Mesh mesh;
+    MaterialInfo *materials = NULL;
+    size_t material_count = 0;
+    bool failed = false;
+    wait_for_geometry(&mesh, &materials, &material_count, &failed);
+    TEST_ASSERT_TRUE(failed);
+    TEST_ASSERT_FALSE(scene_loader_done(&g_loader));
+}
+
+static void test_stop_frees_untaken_results(void) {
+    TEST_ASSERT_TRUE(
+        scene_loader_start(&g_loader, SPOT_MODEL, SPOT_TEXTURE, NULL, &g_changes));
+    // Whatever the loader got to before this is freed, which the sanitizer builds check
+    scene_loader_stop(&g_loader);
+    TEST_ASSERT_FALSE(g_loader.started);
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    if (VIPS_INIT(argv[0])) {
+        return 1;
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_delivers_geometry_then_textures);
+    RUN_TEST(test_missing_model_fails);
+    RUN_TEST(test_stop_frees_untaken_results);
+    const int result = UNITY_END();
+    vips_shutdown();
+    return result;
+}
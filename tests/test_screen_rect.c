@@ -0,0 +1,75 @@
+#include "renderer/screen_rect.h"
+
+#include <cglm/cglm.h>
+#include <unity.h>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// A camera 5 units in front of the origin looking at it, 90 degrees vertically
+static void view_projection(mat4 out, const float aspect) {
+    mat4 view;
+    mat4 projection;
+    glm_lookat((vec3){0.0F, 0.0F, 5.0F}, (vec3){0.0F, 0.0F, 0.0F}, (vec3){0.0F, 1.0F, 0.0F},
+               view);
+    glm_perspective_rh_zo(glm_rad(90.0F), aspect, 0.1F, 100.0F, projection);
+    glm_mat4_mul(projection, view, out);
+}
+
+static void test_small_box_covers_the_middle(void) {
+    mat4 mvp;
+    view_projection(mvp, 1.0F);
+    // The front face at distance 4.5 spans ±0.5/4.5 of the half-height
+    const ScreenRect rect = screen_rect_from_bounds(mvp, (vec3){-0.5F, -0.5F, -0.5F},
+                                                    (vec3){0.5F, 0.5F, 0.5F}, 180, 180);
+    TEST_ASSERT_FALSE(screen_rect_empty(rect));
+    TEST_ASSERT_TRUE(rect.x >= 78 && rect.x <= 80);
+    TEST_ASSERT_TRUE(rect.x + rect.width >= 100 && rect.x + rect.width <= 102);
+    TEST_ASSERT_EQUAL_UINT32(rect.x, rect.y);
+    TEST_ASSERT_EQUAL_UINT32(rect.width, rect.height);
+}
+
+static void test_box_around_the_eye_covers_everything(void) {
+    mat4 mvp;
+    view_projection(mvp, 2.0F);
+    const ScreenRect rect = screen_rect_from_bounds(mvp, (vec3){-1.0F, -1.0F, -1.0F},
+                                                    (vec3){1.0F, 1.0F, 6.0F}, 200, 100);
+    TEST_ASSERT_EQUAL_UINT32(0, rect.x);
+    TEST_ASSERT_EQUAL_UINT32(0, rect.y);
+    TEST_ASSERT_EQUAL_UINT32(200, rect.width);
+    TEST_ASSERT_EQUAL_UINT32(100, rect.height);
+}
+
+static void test_box_off_screen_covers_nothing(void) {
+    mat4 mvp;
+    view_projection(mvp, 1.0F);
+    const ScreenRect rect = screen_rect_from_bounds(mvp, (vec3){20.0F, -0.5F, -0.5F},
+                                                    (vec3){21.0F, 0.5F, 0.5F}, 100, 100);
+    TEST_ASSERT_TRUE(screen_rect_empty(rect));
+}
+
+static void test_union(void) {
+    const ScreenRect a = {10, 20, 5, 5};
+    const ScreenRect b = {30, 2, 10, 4};
+    const ScreenRect both = screen_rect_union(a, b);
+    TEST_ASSERT_EQUAL_UINT32(10, both.x);
+    TEST_ASSERT_EQUAL_UINT32(2, both.y);
+    TEST_ASSERT_EQUAL_UINT32(30, both.width);
+    TEST_ASSERT_EQUAL_UINT32(23, both.height);
+
+    const ScreenRect empty = {0, 0, 0, 0};
+    const ScreenRect same = screen_rect_union(empty, a);
+    TEST_ASSERT_EQUAL_UINT32(10, same.x);
+    TEST_ASSERT_EQUAL_UINT32(5, same.width);
+    TEST_ASSERT_TRUE(screen_rect_empty(screen_rect_union(empty, empty)));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_small_box_covers_the_middle);
+    RUN_TEST(test_box_around_the_eye_covers_everything);
+    RUN_TEST(test_box_off_screen_covers_nothing);
+    RUN_TEST(test_union);
+    return UNITY_END();
+}
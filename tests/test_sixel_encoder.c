@@ -0,0 +1,87 @@
+#include "terminal/sixel_encoder.h"
+
+#include <string.h>
+#include <unity.h>
+
+void setUp(void) {}
+
+void tearDown(void) {
+    sixel_cleanup();
+}
+
+static void fill(uint8_t *pixels, const size_t count, const uint8_t r, const uint8_t g,
+                 const uint8_t b) {
+    for (size_t i = 0; i < count; i++) {
+        pixels[(i * 4U) + 0U] = r;
+        pixels[(i * 4U) + 1U] = g;
+        pixels[(i * 4U) + 2U] = b;
+        pixels[(i * 4U) + 3U] = 255;
+    }
+}
+
+static void test_solid_band_is_run_length_encoded(void) {
+    uint8_t pixels[8 * 6 * 4];
+    fill(pixels, 8 * 6, 255, 0, 0);
+
+    size_t length = 0;
+    const char *sixel = sixel_encode(pixels, 8, 6, &length);
+    TEST_ASSERT_NOT_NULL(sixel);
+
+    static const char expected[] = "\x1bP0;1;0q\"1;1;8;6#0;2;100;0;0#0!8~-\x1b\\";
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected) - 1U, length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, sixel, length);
+}
+
+static void test_partial_band_sets_only_covered_rows(void) {
+    uint8_t pixels[2 * 3 * 4];
+    fill(pixels, 2 * 3, 0, 0, 0);
+
+    size_t length = 0;
+    const char *sixel = sixel_encode(pixels, 2, 3, &length);
+    TEST_ASSERT_NOT_NULL(sixel);
+    // Three rows set the low three sixel bits: '?' + 7 == 'F'.
+    TEST_ASSERT_NOT_NULL(strstr(sixel, "#0FF-"));
+}
+
+static void test_two_colors_share_a_band(void) {
+    uint8_t pixels[4 * 6 * 4];
+    for (uint32_t y = 0; y < 6; y++) {
+        fill(pixels + (y * 4U * 4U), 2, 255, 255, 255);
+        fill(pixels + (y * 4U * 4U) + 8U, 2, 0, 0, 0);
+    }
+
+    size_t length = 0;
+    const char *sixel = sixel_encode(pixels, 4, 6, &length);
+    TEST_ASSERT_NOT_NULL(sixel);
+    // Each colour is drawn with a carriage return ('$') between them; trailing empty
+    // columns are omitted.
+    TEST_ASSERT_TRUE(strstr(sixel, "~~$") != NULL);
+    TEST_ASSERT_TRUE(strstr(sixel, "??~~-") != NULL);
+}
+
+static void test_palette_is_reused_for_similar_frames(void) {
+    uint8_t pixels[8 * 6 * 4];
+    fill(pixels, 8 * 6, 40, 80, 120);
+
+    size_t length = 0;
+    const char *first = sixel_encode(pixels, 8, 6, &length);
+    TEST_ASSERT_NOT_NULL(first);
+    char palette[32];
+    const char *entry = strstr(first, "#0;2;");
+    TEST_ASSERT_NOT_NULL(entry);
+    memcpy(palette, entry, 16);
+
+    fill(pixels, 8 * 6, 41, 81, 121);
+    const char *second = sixel_encode(pixels, 8, 6, &length);
+    TEST_ASSERT_NOT_NULL(second);
+    TEST_ASSERT_EQUAL_MEMORY(palette, strstr(second, "#0;2;"), 16);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_solid_band_is_run_length_encoded);
+    RUN_TEST(test_partial_band_sets_only_covered_rows);
+    RUN_TEST(test_two_colors_share_a_band);
+    RUN_TEST(test_palette_is_reused_for_similar_frames);
+    return UNITY_END();
+}
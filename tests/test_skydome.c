@@ -0,0 +1,69 @@
+#include "graphics/skydome.h"
+
+#include <cglm/cglm.h>
+#include <unity.h>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_size_matches_output_resolution(void) {
+    // 50 pixels per unit of tan at 60 degrees: 86.6 pixels per radian around the circle
+    TEST_ASSERT_EQUAL_UINT32(545, skydome_size_for_output(100, glm_rad(60.0F)));
+    TEST_ASSERT_TRUE(skydome_size_for_output(200, glm_rad(60.0F)) >
+                     skydome_size_for_output(100, glm_rad(60.0F)));
+    // A narrower view magnifies the panorama
+    TEST_ASSERT_TRUE(skydome_size_for_output(100, glm_rad(30.0F)) >
+                     skydome_size_for_output(100, glm_rad(60.0F)));
+    TEST_ASSERT_EQUAL_UINT32(64, skydome_size_for_output(1, glm_rad(60.0F)));
+}
+
+static void test_direction_uv_follows_the_panorama(void) {
+    float uv[2];
+    skydome_direction_uv((vec3){1.0F, 0.0F, 0.0F}, uv);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5F, 0.0F, uv[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5F, 0.5F, uv[1]);
+    skydome_direction_uv((vec3){0.0F, 0.0F, 2.0F}, uv);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5F, 0.25F, uv[0]);
+    skydome_direction_uv((vec3){0.0F, 0.0F, -1.0F}, uv);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5F, 0.75F, uv[0]);
+    skydome_direction_uv((vec3){0.0F, 3.0F, 0.0F}, uv);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5F, 0.0F, uv[1]);
+    skydome_direction_uv((vec3){0.0F, -1.0F, 0.0F}, uv);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5F, 1.0F, uv[1]);
+}
+
+static void test_rays_ignore_the_camera_position(void) {
+    mat4 projection;
+    glm_perspective_rh_zo(glm_rad(60.0F), 1.0F, 0.01F, 100.0F, projection);
+    // Flipped for Vulkan, as camera_projection_matrix does
+    projection[1][1] *= -1.0F;
+    mat4 view;
+    glm_lookat((vec3){5.0F, 1.0F, 3.0F}, (vec3){5.0F, 1.0F, 2.0F}, (vec3){0.0F, 1.0F, 0.0F},
+               view);
+    mat4 rays;
+    skydome_ray_matrix(view, projection, rays);
+
+    // The centre of the view looks down -z, wherever the camera is
+    vec4 ray;
+    glm_mat4_mulv(rays, (vec4){0.0F, 0.0F, 1.0F, 1.0F}, ray);
+    vec3 direction = {ray[0] / ray[3], ray[1] / ray[3], ray[2] / ray[3]};
+    glm_vec3_normalize(direction);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 0.0F, direction[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, 0.0F, direction[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, -1.0F, direction[2]);
+
+    // The top edge of the view, down in Vulkan's NDC, is half the field of view up
+    glm_mat4_mulv(rays, (vec4){0.0F, -1.0F, 1.0F, 1.0F}, ray);
+    glm_vec3_copy((vec3){ray[0] / ray[3], ray[1] / ray[3], ray[2] / ray[3]}, direction);
+    glm_vec3_normalize(direction);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4F, sinf(glm_rad(30.0F)), direction[1]);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_size_matches_output_resolution);
+    RUN_TEST(test_direction_uv_follows_the_panorama);
+    RUN_TEST(test_rays_ignore_the_camera_position);
+    return UNITY_END();
+}
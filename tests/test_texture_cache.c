@@ -0,0 +1,98 @@
+#include "graphics/texture_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+// Relative to the test's working directory (the build tree under meson test)
+#define CACHE_DIRECTORY ""
+
+static const uint8_t g_source[] = "not really an image, only bytes to key on";
+static TextureCacheKey g_key;
+static Texture g_texture;
+static Texture g_loaded;
+
+void setUp(void) {
+    memset(&g_texture, 0, sizeof(g_texture));
+    memset(&g_loaded, 0, sizeof(g_loaded));
+    TEST_ASSERT_TRUE(texture_cache_key(g_source, sizeof(g_source), TEXTURE_FORMAT_BC7, 1024,
+                                       false, CACHE_DIRECTORY, &g_key));
+    g_texture.width = 4;
+    g_texture.height = 4;
+    g_texture.data_size = 3 * 16;
+    g_texture.data = malloc(g_texture.data_size);
+    TEST_ASSERT_NOT_NULL(g_texture.data);
+    for (size_t i = 0; i < g_texture.data_size; i++) {
+        g_texture.data[i] = (uint8_t)i;
+    }
+    g_texture.format = TEXTURE_FORMAT_BC7;
+    g_texture.mip_levels = 3;
+    g_texture.has_transparency = true;
+}
+
+void tearDown(void) {
+    remove(g_key.cache_path);
+    texture_free(&g_texture);
+    texture_free(&g_loaded);
+}
+
+static void test_store_then_load(void) {
+    TEST_ASSERT_FALSE(texture_cache_load(&g_key, &g_loaded));
+    TEST_ASSERT_TRUE(texture_cache_store(&g_key, &g_texture));
+    TEST_ASSERT_TRUE(texture_cache_load(&g_key, &g_loaded));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC7, g_loaded.format);
+    TEST_ASSERT_EQUAL_UINT32(4, g_loaded.width);
+    TEST_ASSERT_EQUAL_UINT32(3, g_loaded.mip_levels);
+    TEST_ASSERT_TRUE(g_loaded.has_transparency);
+    TEST_ASSERT_EQUAL_size_t(g_texture.data_size, g_loaded.data_size);
+    TEST_ASSERT_EQUAL_MEMORY(g_texture.data, g_loaded.data, g_texture.data_size);
+}
+
+static void test_entries_are_per_variant(void) {
+    TEST_ASSERT_TRUE(texture_cache_store(&g_key, &g_texture));
+    TextureCacheKey other;
+    // Another size budget or role is another entry
+    TEST_ASSERT_TRUE(texture_cache_key(g_source, sizeof(g_source), TEXTURE_FORMAT_BC7, 512,
+                                       false, CACHE_DIRECTORY, &other));
+    TEST_ASSERT_FALSE(strcmp(g_key.cache_path, other.cache_path) == 0);
+    TEST_ASSERT_FALSE(texture_cache_load(&other, &g_loaded));
+    TEST_ASSERT_TRUE(texture_cache_key(g_source, sizeof(g_source), TEXTURE_FORMAT_BC7, 1024,
+                                       true, CACHE_DIRECTORY, &other));
+    TEST_ASSERT_FALSE(texture_cache_load(&other, &g_loaded));
+    // The same bytes key the same entry wherever they came from
+    uint8_t copy[sizeof(g_source)];
+    memcpy(copy, g_source, sizeof(g_source));
+    TEST_ASSERT_TRUE(texture_cache_key(copy, sizeof(copy), TEXTURE_FORMAT_BC7, 1024, false,
+                                       CACHE_DIRECTORY, &other));
+    TEST_ASSERT_TRUE(texture_cache_load(&other, &g_loaded));
+}
+
+static void test_truncated_entry_is_a_miss(void) {
+    TEST_ASSERT_TRUE(texture_cache_store(&g_key, &g_texture));
+    FILE *file = fopen(g_key.cache_path, "r+b");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fclose(file);
+    // Rewrite it one byte short
+    uint8_t *bytes = malloc((size_t)size);
+    TEST_ASSERT_NOT_NULL(bytes);
+    file = fopen(g_key.cache_path, "rb");
+    TEST_ASSERT_EQUAL_size_t((size_t)size, fread(bytes, 1, (size_t)size, file));
+    fclose(file);
+    file = fopen(g_key.cache_path, "wb");
+    fwrite(bytes, 1, (size_t)size - 1, file);
+    fclose(file);
+    free(bytes);
+    TEST_ASSERT_FALSE(texture_cache_load(&g_key, &g_loaded));
+    TEST_ASSERT_NULL(g_loaded.data);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_store_then_load);
+    RUN_TEST(test_entries_are_per_variant);
+    RUN_TEST(test_truncated_entry_is_a_miss);
+    return UNITY_END();
+}
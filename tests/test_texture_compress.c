@@ -0,0 +1,180 @@
+#include "graphics/texture_compress.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+static const int bc7_weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static Texture g_texture;
+
+void setUp(void) {
+    memset(&g_texture, 0, sizeof(g_texture));
+}
+
+void tearDown(void) {
+    texture_set_gpu_formats(0);
+    texture_free(&g_texture);
+}
+
+static uint32_t get_bits(const uint8_t *block, uint32_t *pos, const uint32_t count) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; i++, (*pos)++) {
+        value |= (uint32_t)((block[*pos / 8U] >> (*pos % 8U)) & 1U) << i;
+    }
+    return value;
+}
+
+// Reference decode of the one BC7 mode the encoder writes
+static void decode_bc7_mode6(const uint8_t *block, uint8_t out[16][4]) {
+    uint32_t pos = 0;
+    TEST_ASSERT_EQUAL_UINT32(1U << 6, get_bits(block, &pos, 7));
+    int endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = (int)get_bits(block, &pos, 7) << 1;
+        endpoints[1][c] = (int)get_bits(block, &pos, 7) << 1;
+    }
+    const int p0 = (int)get_bits(block, &pos, 1);
+    const int p1 = (int)get_bits(block, &pos, 1);
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] |= p0;
+        endpoints[1][c] |= p1;
+    }
+    for (int t = 0; t < 16; t++) {
+        const int w = bc7_weights[get_bits(block, &pos, t == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++) {
+            out[t][c] = (uint8_t)(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+        }
+    }
+}
+
+static void decode_bc4(const uint8_t *block, uint8_t out[16]) {
+    const int r0 = block[0];
+    const int r1 = block[1];
+    int palette[8] = {r0, r1};
+    for (int i = 2; i < 8; i++) {
+        palette[i] = r0 > r1 ? ((8 - i) * r0 + (i - 1) * r1) / 7
+                             : (i < 6 ? ((6 - i) * r0 + (i - 1) * r1) / 5 : (i == 6 ? 0 : 255));
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++) {
+        bits |= (uint64_t)block[2 + i] << (8 * i);
+    }
+    for (int t = 0; t < 16; t++) {
+        out[t] = (uint8_t)palette[(bits >> (3 * t)) & 7U];
+    }
+}
+
+static void make_rgba(const uint32_t width, const uint32_t height) {
+    g_texture.width = width;
+    g_texture.height = height;
+    g_texture.data_size = (size_t)width * height * 4U;
+    g_texture.data = malloc(g_texture.data_size);
+    g_texture.format = TEXTURE_FORMAT_RGBA8;
+    g_texture.mip_levels = 1;
+    TEST_ASSERT_NOT_NULL(g_texture.data);
+}
+
+static void test_target_follows_gpu_formats(void) {
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_RGBA8, texture_compress_target(false));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_RGBA8, texture_compress_target(true));
+    texture_set_gpu_formats(TEXTURE_FORMAT_BIT(TEXTURE_FORMAT_BC7));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC7, texture_compress_target(true));
+    texture_set_gpu_formats(TEXTURE_FORMAT_BIT(TEXTURE_FORMAT_BC7) |
+                            TEXTURE_FORMAT_BIT(TEXTURE_FORMAT_BC5));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC7, texture_compress_target(false));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC5, texture_compress_target(true));
+}
+
+static void test_bc7_round_trip_with_mip_chain(void) {
+    // 8x6 exercises a partial block row along the bottom of level 0
+    make_rgba(8, 6);
+    uint8_t original[8 * 6 * 4];
+    for (uint32_t i = 0; i < 8 * 6; i++) {
+        const uint8_t texel[4] = {(uint8_t)(i * 5U), (uint8_t)(255U - i * 3U), 90,
+                                  (uint8_t)(255U - i)};
+        memcpy(g_texture.data + i * 4U, texel, 4);
+    }
+    memcpy(original, g_texture.data, sizeof(original));
+    TEST_ASSERT_TRUE(texture_compress(&g_texture, TEXTURE_FORMAT_BC7, false));
+
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC7, g_texture.format);
+    TEST_ASSERT_EQUAL_UINT32(4, g_texture.mip_levels);
+    // 8x6, 4x3, 2x1 and 1x1: 2x2 blocks, then one block per level
+    TEST_ASSERT_EQUAL_size_t(4 * 16 + 3 * 16, g_texture.data_size);
+    TEST_ASSERT_EQUAL_UINT32(8, g_texture.width);
+
+    int worst = 0;
+    for (uint32_t b = 0; b < 4; b++) {
+        uint8_t decoded[16][4];
+        decode_bc7_mode6(g_texture.data + b * 16U, decoded);
+        for (uint32_t t = 0; t < 16; t++) {
+            const uint32_t x = (b % 2U) * 4U + t % 4U;
+            const uint32_t y = (b / 2U) * 4U + t / 4U;
+            if (y >= 6) {
+                continue;
+            }
+            for (int c = 0; c < 4; c++) {
+                const int error = abs(decoded[t][c] - original[(y * 8U + x) * 4U + c]);
+                worst = error > worst ? error : worst;
+            }
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_INT(8, worst);
+}
+
+static void test_mips_filter_in_linear_light(void) {
+    // Black and white average to 50% linear light, which is 188 in sRGB, not 128
+    make_rgba(2, 2);
+    const uint8_t texels[16] = {0, 0, 0, 255, 255, 255, 255, 255,
+                                255, 255, 255, 255, 0, 0, 0, 255};
+    memcpy(g_texture.data, texels, sizeof(texels));
+    TEST_ASSERT_TRUE(texture_compress(&g_texture, TEXTURE_FORMAT_BC7, false));
+    TEST_ASSERT_EQUAL_UINT32(2, g_texture.mip_levels);
+    uint8_t decoded[16][4];
+    decode_bc7_mode6(g_texture.data + 16, decoded);
+    TEST_ASSERT_INT_WITHIN(2, 188, decoded[0][0]);
+    TEST_ASSERT_INT_WITHIN(1, 255, decoded[0][3]);
+}
+
+static void test_bc5_keeps_normal_xy(void) {
+    make_rgba(4, 4);
+    for (uint32_t i = 0; i < 16; i++) {
+        const uint8_t texel[4] = {(uint8_t)(100U + i * 4U), (uint8_t)(180U - i * 2U), 230, 255};
+        memcpy(g_texture.data + i * 4U, texel, 4);
+    }
+    uint8_t original[64];
+    memcpy(original, g_texture.data, sizeof(original));
+    TEST_ASSERT_TRUE(texture_compress(&g_texture, TEXTURE_FORMAT_BC5, true));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC5, g_texture.format);
+    TEST_ASSERT_EQUAL_size_t(3 * 16, g_texture.data_size);
+
+    uint8_t x[16];
+    uint8_t y[16];
+    decode_bc4(g_texture.data, x);
+    decode_bc4(g_texture.data + 8, y);
+    for (uint32_t t = 0; t < 16; t++) {
+        TEST_ASSERT_INT_WITHIN(5, original[t * 4U], x[t]);
+        TEST_ASSERT_INT_WITHIN(3, original[t * 4U + 1U], y[t]);
+    }
+}
+
+static void test_only_rgba8_is_compressed(void) {
+    make_rgba(4, 4);
+    memset(g_texture.data, 7, g_texture.data_size);
+    TEST_ASSERT_FALSE(texture_compress(&g_texture, TEXTURE_FORMAT_ASTC_4X4, false));
+    TEST_ASSERT_TRUE(texture_compress(&g_texture, TEXTURE_FORMAT_BC7, false));
+    // Already compressed
+    TEST_ASSERT_FALSE(texture_compress(&g_texture, TEXTURE_FORMAT_BC5, true));
+    TEST_ASSERT_EQUAL_INT(TEXTURE_FORMAT_BC7, g_texture.format);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_target_follows_gpu_formats);
+    RUN_TEST(test_bc7_round_trip_with_mip_chain);
+    RUN_TEST(test_mips_filter_in_linear_light);
+    RUN_TEST(test_bc5_keeps_normal_xy);
+    RUN_TEST(test_only_rgba8_is_compressed);
+    return UNITY_END();
+}
@@ -0,0 +1,184 @@
+#include "graphics/texture_loader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <vips/vips.h>
+
+#ifndef SPOT_MODEL_DIR
+#define SPOT_MODEL_DIR "fixtures/spot"
+#endif
+
+#define SPOT_MODEL SPOT_MODEL_DIR "/spot_triangulated.obj"
+#define SPOT_TEXTURE SPOT_MODEL_DIR "/spot_texture.png"
+#define MATERIAL_COUNT 4
+
+static MaterialInfo g_materials[MATERIAL_COUNT];
+static Texture g_diffuse[MATERIAL_COUNT];
+static Texture g_normal[MATERIAL_COUNT];
+static int g_ready[MATERIAL_COUNT];
+
+void setUp(void) {
+    memset(g_diffuse, 0, sizeof(g_diffuse));
+    memset(g_normal, 0, sizeof(g_normal));
+    memset(g_ready, 0, sizeof(g_ready));
+    for (size_t i = 0; i < MATERIAL_COUNT; i++) {
+        material_info_init(&g_materials[i]);
+    }
+}
+
+void tearDown(void) {
+    texture_set_max_size(0);
+    for (size_t i = 0; i < MATERIAL_COUNT; i++) {
+        texture_free(&g_diffuse[i]);
+        texture_free(&g_normal[i]);
+        material_info_free(&g_materials[i]);
+    }
+}
+
+static void count_ready(void *context, const size_t material) {
+    (void)context;
+    g_ready[material]++;
+}
+
+static void test_shared_image_decodes_into_every_material(void) {
+    // Materials 0, 1 and 3 name the same image, 2 has none
+    g_materials[0].diffuse_path = str_dup(SPOT_TEXTURE);
+    g_materials[1].diffuse_path = str_dup(SPOT_TEXTURE);
+    g_materials[3].diffuse_path = str_dup(SPOT_TEXTURE);
+    g_materials[1].normal_path = str_dup(SPOT_TEXTURE);
+    load_material_textures(SPOT_MODEL, NULL, NULL, g_materials, MATERIAL_COUNT, g_diffuse,
+                           g_normal, count_ready, NULL, NULL);
+
+    for (size_t i = 0; i < MATERIAL_COUNT; i++) {
+        TEST_ASSERT_EQUAL_INT(1, g_ready[i]);
+        TEST_ASSERT_NOT_NULL(g_diffuse[i].data);
+        TEST_ASSERT_NOT_NULL(g_normal[i].data);
+    }
+    TEST_ASSERT_TRUE(g_diffuse[0].width > 1);
+    TEST_ASSERT_EQUAL_UINT32(1, g_diffuse[2].width);
+    // One set of pixels shared by all three, which outlives any one of them being freed
+    TEST_ASSERT_TRUE(g_diffuse[0].data == g_diffuse[1].data);
+    TEST_ASSERT_TRUE(g_diffuse[0].data == g_diffuse[3].data);
+    texture_free(&g_diffuse[0]);
+    TEST_ASSERT_EQUAL_size_t(g_diffuse[1].data_size, g_diffuse[3].data_size);
+    TEST_ASSERT_EQUAL_MEMORY(g_diffuse[1].data, g_diffuse[3].data, g_diffuse[1].data_size);
+    // The same file as a normal map is its own decode, with normal-map fallbacks
+    TEST_ASSERT_EQUAL_UINT32(g_diffuse[1].width, g_normal[1].width);
+    TEST_ASSERT_TRUE(g_normal[1].data != g_diffuse[1].data);
+    TEST_ASSERT_EQUAL_UINT32(1, g_normal[0].width);
+}
+
+static unsigned char *read_fixture(const char *path, size_t *out_size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *out_size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *bytes = malloc(*out_size);
+    if (bytes && fread(bytes, 1, *out_size, file) != *out_size) {
+        free(bytes);
+        bytes = NULL;
+    }
+    fclose(file);
+    return bytes;
+}
+
+static void test_equal_embedded_bytes_share_one_decode(void) {
+    // Separate copies of the same bytes, as two embedded textures of one file would be
+    for (size_t i = 0; i < 2; i++) {
+        g_materials[i].diffuse_path = str_dup("*0");
+        g_materials[i].embedded_diffuse =
+            read_fixture(SPOT_TEXTURE, &g_materials[i].embedded_diffuse_size);
+        TEST_ASSERT_NOT_NULL(g_materials[i].embedded_diffuse);
+    }
+    load_material_textures(SPOT_MODEL, NULL, NULL, g_materials, MATERIAL_COUNT, g_diffuse,
+                           g_normal, NULL, NULL, NULL);
+    TEST_ASSERT_TRUE(g_diffuse[0].width > 1);
+    TEST_ASSERT_TRUE(g_diffuse[0].data == g_diffuse[1].data);
+}
+
+static void test_overrides_apply_to_every_material(void) {
+    load_material_textures(SPOT_MODEL, SPOT_TEXTURE, NULL, g_materials, MATERIAL_COUNT,
+                           g_diffuse, g_normal, NULL, NULL, NULL);
+    for (size_t i = 0; i < MATERIAL_COUNT; i++) {
+        TEST_ASSERT_TRUE(g_diffuse[i].width > 1);
+    }
+}
+
+static void test_cancelled_load_uses_defaults(void) {
+    g_materials[0].diffuse_path = str_dup(SPOT_TEXTURE);
+    atomic_bool cancelled;
+    atomic_init(&cancelled, true);
+    load_material_textures(SPOT_MODEL, NULL, NULL, g_materials, MATERIAL_COUNT, g_diffuse,
+                           g_normal, count_ready, NULL, &cancelled);
+    TEST_ASSERT_EQUAL_INT(1, g_ready[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, g_diffuse[0].width);
+}
+
+static void test_max_size_shrinks_on_load(void) {
+    // The fixture is 1024x1024
+    texture_set_max_size(256);
+    g_materials[0].diffuse_path = str_dup(SPOT_TEXTURE);
+    load_material_textures(SPOT_MODEL, NULL, NULL, g_materials, 1, g_diffuse, g_normal, NULL,
+                           NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(256, g_diffuse[0].width);
+    TEST_ASSERT_EQUAL_UINT32(256, g_diffuse[0].height);
+    TEST_ASSERT_EQUAL_size_t((size_t)256 * 256 * 4, g_diffuse[0].data_size);
+
+    // Images already within the budget decode as they are
+    texture_set_max_size(4096);
+    Texture full = {0};
+    TEST_ASSERT_TRUE(texture_from_file(&full, SPOT_TEXTURE));
+    TEST_ASSERT_EQUAL_UINT32(1024, full.width);
+    texture_free(&full);
+}
+
+static void test_max_size_for_output(void) {
+    TEST_ASSERT_EQUAL_UINT32(256, texture_max_size_for_output(80, 24));
+    TEST_ASSERT_EQUAL_UINT32(1024, texture_max_size_for_output(320, 180));
+    TEST_ASSERT_EQUAL_UINT32(4096, texture_max_size_for_output(1920, 1080));
+    TEST_ASSERT_EQUAL_UINT32(16384, texture_max_size_for_output(20000, 100));
+}
+
+static void test_transparency_scan_finds_one_texel(void) {
+    // 4097 texels: past the word loop's 4 KiB checkpoints and into the odd tail
+    Texture tex = {0};
+    tex.format = TEXTURE_FORMAT_RGBA8;
+    tex.data_size = (size_t)4097 * 4;
+    tex.data = malloc(tex.data_size);
+    TEST_ASSERT_NOT_NULL(tex.data);
+    memset(tex.data, 0xFF, tex.data_size);
+    texture_update_transparency(&tex);
+    TEST_ASSERT_FALSE(tex.has_transparency);
+
+    const size_t texels[] = {0, 1500, 4096};
+    for (size_t i = 0; i < sizeof(texels) / sizeof(texels[0]); i++) {
+        memset(tex.data, 0xFF, tex.data_size);
+        tex.data[texels[i] * 4 + 3] = 0xFE;
+        texture_update_transparency(&tex);
+        TEST_ASSERT_TRUE(tex.has_transparency);
+    }
+    texture_free(&tex);
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    if (VIPS_INIT(argv[0])) {
+        return 1;
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_shared_image_decodes_into_every_material);
+    RUN_TEST(test_equal_embedded_bytes_share_one_decode);
+    RUN_TEST(test_overrides_apply_to_every_material);
+    RUN_TEST(test_cancelled_load_uses_defaults);
+    RUN_TEST(test_max_size_shrinks_on_load);
+    RUN_TEST(test_max_size_for_output);
+    RUN_TEST(test_transparency_scan_finds_one_texel);
+    const int result = UNITY_END();
+    vips_shutdown();
+    return result;
+}
@@ -0,0 +1,117 @@
+#include "graphics/vertex_format.h"
+
+#include <math.h>
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_half_round_trips_texcoords(void) {
+    const float values[] = {0.0F, 1.0F, -1.0F, 0.5F, 0.25F, 2.0F, 1024.0F, -0.125F};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        TEST_ASSERT_EQUAL_FLOAT(values[i], half_to_float(float_to_half(values[i])));
+    }
+
+    // UVs in [0, 1] keep about three decimal digits
+    TEST_ASSERT_FLOAT_WITHIN(0.0005F, 0.3333F, half_to_float(float_to_half(0.3333F)));
+    TEST_ASSERT_EQUAL_HEX16(0x3C00, float_to_half(1.0F));
+    TEST_ASSERT_EQUAL_HEX16(0x7C00, float_to_half(1.0e6F));
+    TEST_ASSERT_EQUAL_HEX16(0x0001, float_to_half(5.9604645e-8F));
+}
+
+static void test_octahedral_round_trips_unit_vectors(void) {
+    const float normals[][3] = {{0.0F, 0.0F, 1.0F},  {0.0F, 0.0F, -1.0F}, {1.0F, 0.0F, 0.0F},
+                                {0.0F, -1.0F, 0.0F}, {0.6F, 0.0F, -0.8F}, {0.48F, 0.6F, 0.64F},
+                                {-0.48F, 0.6F, -0.64F}};
+    for (size_t i = 0; i < sizeof(normals) / sizeof(normals[0]); i++) {
+        int16_t encoded[2];
+        float decoded[3];
+        encode_octahedral(normals[i], encoded);
+        decode_octahedral(encoded, decoded);
+        TEST_ASSERT_FLOAT_WITHIN(0.001F, normals[i][0], decoded[0]);
+        TEST_ASSERT_FLOAT_WITHIN(0.001F, normals[i][1], decoded[1]);
+        TEST_ASSERT_FLOAT_WITHIN(0.001F, normals[i][2], decoded[2]);
+    }
+}
+
+static void test_pack_vertex_keeps_bitangent_sign(void) {
+    Vertex vertex = {.position = {1.0F, 2.0F, 3.0F},
+                     .texcoord = {0.5F, 0.75F},
+                     .normal = {0.0F, 0.0F, 1.0F},
+                     .tangent = {1.0F, 0.0F, 0.0F},
+                     .bitangent = {0.0F, 1.0F, 0.0F}};
+    PackedVertex packed;
+    pack_vertex(&vertex, &packed);
+    TEST_ASSERT_EQUAL_FLOAT(2.0F, packed.position[1]);
+    TEST_ASSERT_EQUAL_FLOAT(0.75F, half_to_float(packed.texcoord[1]));
+    TEST_ASSERT_EQUAL_INT8(127, packed.tangent[0]);
+    TEST_ASSERT_EQUAL_INT8(127, packed.tangent[3]);
+
+    // Mirrored UVs flip the bitangent
+    vertex.bitangent[1] = -1.0F;
+    pack_vertex(&vertex, &packed);
+    TEST_ASSERT_EQUAL_INT8(-127, packed.tangent[3]);
+}
+
+static void test_pack_skin_normalizes_weights(void) {
+    const Vertex vertex = {.bone_ids = {3, 7, -1, -1}, .bone_weights = {0.3F, 0.1F, 0.0F, 0.0F}};
+    PackedSkin skin;
+    pack_skin(&vertex, &skin);
+    TEST_ASSERT_EQUAL_UINT16(3, skin.joints[0]);
+    TEST_ASSERT_EQUAL_UINT16(7, skin.joints[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, skin.weights[2]);
+    TEST_ASSERT_EQUAL_INT(255, skin.weights[0] + skin.weights[1] + skin.weights[2] +
+                                   skin.weights[3]);
+    TEST_ASSERT_UINT8_WITHIN(1, 191, skin.weights[0]);
+
+    const Vertex unbound = {.bone_ids = {-1, -1, -1, -1}};
+    pack_skin(&unbound, &skin);
+    TEST_ASSERT_EQUAL_UINT8(0, skin.weights[0]);
+}
+
+static void test_pack_skin_orders_influences_by_weight(void) {
+    const Vertex vertex = {.bone_ids = {-1, 4, 9, 2}, .bone_weights = {0.0F, 0.2F, 0.0F, 0.6F}};
+    PackedSkin skin;
+    pack_skin(&vertex, &skin);
+    TEST_ASSERT_EQUAL_UINT16(2, skin.joints[0]);
+    TEST_ASSERT_EQUAL_UINT16(4, skin.joints[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, skin.weights[2]);
+    TEST_ASSERT_EQUAL_UINT8(0, skin.weights[3]);
+    TEST_ASSERT_UINT8_WITHIN(1, 191, skin.weights[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, packed_skin_influences(&skin));
+
+    const Vertex unbound = {.bone_ids = {-1, -1, -1, -1}};
+    pack_skin(&unbound, &skin);
+    TEST_ASSERT_EQUAL_UINT32(0, packed_skin_influences(&skin));
+}
+
+// Skeletons past MAX_BONES are posed from baked poses, so joints above 255 are kept
+static void test_pack_skin_keeps_wide_joints(void) {
+    const Vertex vertex = {.bone_ids = {300, 1000, -1, -1}, .bone_weights = {0.5F, 0.5F}};
+    PackedSkin skin;
+    pack_skin(&vertex, &skin);
+    TEST_ASSERT_EQUAL_UINT16(300, skin.joints[0]);
+    TEST_ASSERT_EQUAL_UINT16(1000, skin.joints[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, packed_skin_influences(&skin));
+}
+
+static void test_skin_stream_only_for_bound_vertices(void) {
+    Vertex vertices[2] = {{.bone_ids = {-1, -1, -1, -1}}, {.bone_ids = {-1, -1, -1, -1}}};
+    VertexArray array = {vertices, 2, 2};
+    TEST_ASSERT_FALSE(vertices_have_skin(&array));
+
+    vertices[1].bone_ids[2] = 0;
+    TEST_ASSERT_TRUE(vertices_have_skin(&array));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_half_round_trips_texcoords);
+    RUN_TEST(test_octahedral_round_trips_unit_vectors);
+    RUN_TEST(test_pack_vertex_keeps_bitangent_sign);
+    RUN_TEST(test_pack_skin_normalizes_weights);
+    RUN_TEST(test_pack_skin_orders_influences_by_weight);
+    RUN_TEST(test_pack_skin_keeps_wide_joints);
+    RUN_TEST(test_skin_stream_only_for_bound_vertices);
+    return UNITY_END();
+}
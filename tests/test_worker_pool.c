@@ -0,0 +1,64 @@
+#include "core/worker_pool.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <unity.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define TASK_COUNT 64
+
+typedef struct {
+    atomic_uint calls[TASK_COUNT];
+} TaskLog;
+
+static void record_task(void *context, const uint32_t index) {
+    TaskLog *log = context;
+    atomic_fetch_add(&log->calls[index], 1U);
+}
+
+static void assert_each_task_ran(TaskLog *log, const unsigned int times) {
+    for (uint32_t i = 0; i < TASK_COUNT; i++) {
+        TEST_ASSERT_EQUAL_UINT(times, atomic_load(&log->calls[i]));
+    }
+}
+
+static void test_every_index_runs_once(void) {
+    WorkerPool pool;
+    TEST_ASSERT_TRUE(worker_pool_init(&pool, 4));
+
+    TaskLog log;
+    memset(&log, 0, sizeof(log));
+    worker_pool_run(&pool, TASK_COUNT, record_task, &log);
+    assert_each_task_ran(&log, 1);
+
+    // The pool is reusable; later runs start from index zero again.
+    for (int run = 0; run < 50; run++) {
+        worker_pool_run(&pool, TASK_COUNT, record_task, &log);
+    }
+    assert_each_task_ran(&log, 51);
+
+    worker_pool_destroy(&pool);
+}
+
+static void test_pool_without_threads_runs_serially(void) {
+    WorkerPool pool;
+    TEST_ASSERT_TRUE(worker_pool_init(&pool, 0));
+    TEST_ASSERT_EQUAL_UINT(0, pool.thread_count);
+
+    TaskLog log;
+    memset(&log, 0, sizeof(log));
+    worker_pool_run(&pool, TASK_COUNT, record_task, &log);
+    worker_pool_run(&pool, 0, record_task, &log);
+    assert_each_task_ran(&log, 1);
+
+    worker_pool_destroy(&pool);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_index_runs_once);
+    RUN_TEST(test_pool_without_threads_runs_serially);
+    return UNITY_END();
+}